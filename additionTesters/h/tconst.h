@@ -31,12 +31,73 @@
 #define DELAY			18
 #define PSEMVIRT		19
 #define VSEMVIRT		20
+#define GETCPUTIMES		21
+#define READTRACE		22
+#define GETLATENCY		23
+#define DISK_PUTV		24
+#define DISK_GETV		25
+#define AIOSUBMIT		26
+#define AIOWAIT			27
+#define DELAYMICRO		28
+#define PSEMTIMED		29
+#define VSEMNAMED		30
+#define BATCH			31
+#define GETCOUNTERS		32
+#define PROFILE			33
+#define GETLOCKSTATS	34
+#define GETDEVSTATS	35
+#define MSGSEND		36
+#define MSGRECEIVE	37
+#define SHMATTACH	38
+#define PSEMNAMED	39
+#define GETSYSSTATS	40
+#define STREAMPRINTER	41
+#define STREAMTERMINAL	42
+#define RESPAWN			43
+#define REAP			44
+#define PINPAGES		45
+#define FUTEXWAIT		46
+#define FUTEXWAKE		47
+#define FORK			48
+#define THREADCREATE	49
+#define THREADJOIN		50
+#define THREADEXIT		51
+#define DISKMAP			52
+#define DISKMAPSHIFT	24
+#define WAITANY			53
+#define WAITAIO			0
+#define WAITSEM			1
+#define WAITTERM		2
+#define WAITNET			3
+#define WAITFOREVER		-1
+#define NETSEND			54
+#define NETRECV			55
+#define NETGIVEPAGE		0x100
+#define GETBOOTTIMES	56
+#define BOOTPHASES		14
+#define IOSHARE			57
+#define IOWEIGHTMAX		8
+#define GETGROUPSTATS	58
+#define RGROUPS			4
+#define VOLUMEPUT		59
+#define VOLUMEGET		60
+#define VOLUMEMAX		16
+#define CHECKPOINT		61
+#define CKPTRESUMED		1
 
 #define SEG0			0x00000000
 #define SEG1			0x40000000
 #define SEG2			0x80000000
 #define SEG3			0xC0000000
 
+#define TIMEPAGEADDR	0x8001F000
+
+/* SYS32 (GETCOUNTERS) block layout; its size, PERFCOUNTS, comes from
+ * ../h/const.h, which a tester reading the whole block includes */
+#define SELFASID		-1
+#define PERF_PAGEFAULT	3
+#define PERF_EVICTION	4
+
 /***************************************************************/
 
 #endif
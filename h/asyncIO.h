@@ -0,0 +1,27 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+/******************************* asyncIO.h ***********************************
+ *
+ * This header file contains the declarations for the asynchronous disk and
+ * flash I/O syscalls (SYS26/SYS27) and their worker daemons.
+ * It establishes the interface for the asyncIO.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/deviceSupportDMA.h"
+#include "../h/blockCache.h"
+
+/* Function Declarations */
+extern void             initAsyncIO();                                          /* Empty the request slots, launch the workers */
+extern int              aioSubmitSyscallHandler(support_PTR supportStruct);     /* Handles SYS26 (AIOSUBMIT) */
+extern int              aioWaitSyscallHandler(support_PTR supportStruct);       /* Handles SYS27 (AIOWAIT) */
+extern int              aioInFlight(int asid, memaddr cb);                      /* Check if a request is still in flight */
+extern int              aioSubmitBlock(int asid, int line, int write, int devNum, int block, int frame, int *status, int *doneSem); /* Queue a kernel transfer on a pinned frame */
+extern int              aioPrefetch(int asid, int line, int devNum, int block);  /* Queue a read-ahead into the block cache */
+
+#endif /* ASYNCIO_H */
@@ -0,0 +1,34 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+/******************************* blockCache.h ********************************
+ *
+ * This header file contains the declarations for the block cache behind
+ * the SYS14-17 DMA syscalls.
+ * It establishes the interface for the blockCache.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/deviceSupportDMA.h"
+
+/* Global Variables */
+extern unsigned int     blockCacheHits;                                                 /* Requests served without device I/O */
+extern unsigned int     blockCacheMisses;                                               /* Requests that had to fill an entry */
+extern unsigned int     blockCachePrefetches;                                           /* Entries filled by read-ahead */
+
+/* Function Declarations */
+extern void             initBlockCache();                                               /* Empty the cache, launch the flusher */
+extern int              cachedRead(int line, int devNum, int block, memaddr dest, int asid);  /* Read a block through the cache */
+extern int              cachedWrite(int line, int devNum, int block, memaddr src, int asid);  /* Write a block into the cache */
+extern void             flushBlockCache();                                              /* Write every dirty block back */
+extern void             lockBlockCache();                                               /* Gain the cache mutex for uncached I/O */
+extern void             unlockBlockCache();                                             /* Release the cache mutex */
+extern int              dropCachedBlock(int line, int devNum, int block);               /* Write back and forget a block (mutex held) */
+extern int              startPrefetch(int line, int devNum, int block, int *index);     /* Claim an entry for a block to read ahead */
+extern void             fillPrefetch(int index, int line, int devNum, int block, int asid); /* Fill a claimed entry from its device */
+
+#endif /* BLOCKCACHE_H */
@@ -0,0 +1,23 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/******************************* checkpoint.h *************************************
+ *
+ * This header file contains the declarations for U-proc checkpoints,
+ * which save a quiescent U-proc to disk (SYS61) and resume it at the
+ * next boot. It establishes the interface for the checkpoint.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void         initCheckpoints(uprocConfig_PTR config);            /* Find the valid checkpoints of the configured U-procs */
+extern void         resumeFromCheckpoint(state_PTR state, int asid);    /* Make a new U-proc start by restoring its checkpoint */
+extern int          checkpointSyscallHandler(support_PTR supportStruct); /* Handles SYS61 (CHECKPOINT) */
+extern void         dropCheckpoint(int asid);                           /* Invalidate an exiting U-proc's checkpoint */
+
+#endif /* CHECKPOINT_H */
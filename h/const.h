@@ -14,6 +14,8 @@
 /* Hardware & software constants */
 #define PAGESIZE            4096            /* page size in bytes	*/
 #define WORDLEN             4               /* word size in bytes	*/
+#define STATEWORDS          35              /* words in a state_t (4 + STATEREGNUM)	*/
+#define BURSTWORDS          8               /* words moved per iteration of the memOps.c loops (the loops are unrolled to match)	*/
 
 /* timer, timescale, TOD-LO and other bus regs */
 #define RAMBASEADDR         0x10000000
@@ -60,6 +62,7 @@
 #define TRANSTATUS          2
 #define TRANCOMMAND         3
 #define TRANSM_BIT          0x0000000F
+#define TERMHALFDONE(S)     ((((S) & TRANSM_BIT) != READY) && (((S) & TRANSM_BIT) != BUSY))  /* Terminal half has a completion to acknowledge */
 
 /* device common STATUS codes */
 #define UNINSTALLED         0
@@ -93,6 +96,9 @@
 /* Macro to load the Interval Timer */
 #define LDIT(T)             ((*((cpu_t *)INTERVALTMR)) = (T) * (*((cpu_t *)TIMESCALEADDR)))
 
+/* Macro to acknowledge the Interval Timer without arming another tick */
+#define STOPIT()            ((*((cpu_t *)INTERVALTMR)) = MAXINT)
+
 /* Macro to read the TOD clock */
 #define STCK(T)             ((T) = ((*((cpu_t *)TODLOADDR)) / (*((cpu_t *)TIMESCALEADDR))))
 
@@ -111,6 +117,13 @@
 #define GETCPUTIME          6
 #define WAITCLOCK           7
 #define GETSUPPORTPTR       8
+#define DRAINTRACE          -1              /* Nucleus-only: copy out scheduler trace events */
+#define READLATENCY         -2              /* Nucleus-only: copy out one line's latency histograms */
+#define WAITUNTIL           -3              /* Nucleus-only: block until a TOD, optionally on a semaphore */
+#define MAKEMUTEX           -4              /* Nucleus-only: make a semaphore a priority-inheriting mutex */
+#define TLBSHOOTDOWN        -5              /* Nucleus-only: wait until other processors drop the TLB entries of some ASIDs */
+#define MAXSYSCALL          GETSUPPORTPTR   /* Highest nucleus SYSCALL number */
+#define MINSYSCALL          TLBSHOOTDOWN    /* Lowest (negative) nucleus SYSCALL number */
 
 /* Exception Types */
 #define INTERRUPTS          0
@@ -147,9 +160,80 @@
 #define QUANTUM             5000            /* Time slice quantum in microseconds */
 #define CLOCKINTERVAL       100000UL        /* Clock tick interval in microseconds */
 #define MILLION             1000000         /* One million for time calculations */
+#define TICKLESS            TRUE            /* Only arm the pseudo-clock while someone waits on it */
+#define ONESHOTTIMER        TRUE            /* With TICKLESS, arm the interval timer for exact WAITUNTIL deadlines */
+
+/* Timer Wheel Constants */
+#define TIMERSLOTS          32              /* Slots in the nucleus timer wheel (power of two) */
+#define TIMERMASK           (TIMERSLOTS - 1)    /* Mask to wrap a tick number to its slot */
+#define TICKOF(T)           (((T) + CLOCKINTERVAL - 1) / CLOCKINTERVAL)    /* First tick at or after TOD T */
+#define NOSLOT              -1              /* p_timerSlot of a process not on the wheel */
+#define TIMEDOUT            1               /* WAITUNTIL result when the deadline passed */
+
+/* Scheduler Constants */
+#define SCHEDLEVELS         4               /* Number of MLFQ priority levels (0 is the highest) */
+#define HIGHESTLEVEL        0               /* Level for new, woken and boosted processes */
+#define LOWESTLEVEL         (SCHEDLEVELS - 1)   /* Level CPU-bound processes sink to */
+#define PROMOTELIMIT        2               /* Early exits (blocking before quantum expiry) to rise one level */
+#define BOOSTINTERVAL       1000000         /* Microseconds between starvation boosts to the highest level */
+#define NOTREADY            -1              /* p_readyLevel of a PCB that is on no ready queue */
+#define PRIORITYINHERIT     TRUE            /* A mutex owner runs at the level of its best waiter */
+#define NOBOOST             -1              /* p_basePriority of a process no mutex waiter boosts */
+#define MUTEXHASHBITS       6               /* log2 of the mutex owner table size */
+#define MUTEXSLOTS          (1 << MUTEXHASHBITS) /* Semaphores that can be made mutexes */
+#define MINQUANTUM          1000            /* Smallest adaptive quantum in microseconds */
+#define MAXQUANTUM          80000           /* Largest adaptive quantum in microseconds */
+#define ADAPTWINDOW         16              /* Slices observed at a level before its quantum adapts */
+#define ADAPTHIGH           12              /* Full slices per window that double the quantum */
+#define ADAPTLOW            4               /* Full slices per window below which the quantum halves */
+#define HANDOFF             FALSE           /* SYS4 switches straight to the woken process */
+#define FAULTBOOST          TRUE            /* A page-in whose I/O ends while its mutexes are contended runs next */
+#define FASTSYSCALL         TRUE            /* SYS3-4, SYS6 and SYS8 that can not block return straight from the BIOS data page */
+#define MLFQCLASS           0               /* Multi-level feedback queue scheduling */
+#define STRIDECLASS         1               /* Proportional-share (stride) scheduling */
+#define SCHEDCLASS          MLFQCLASS       /* Scheduling class in use */
+#define STRIDEONE           1000            /* Pass units charged per microsecond at one ticket */
+#define DEFAULTTICKETS      100             /* Tickets of a process created without any */
+#define DEBRUIJN32          0x077CB531      /* De Bruijn sequence used for find-first-set */
+#define DEBRUIJNSHIFT       27              /* Shift selecting the top 5 bits of the product */
+
+/* Multiprocessor Constants */
+#define CPUCOUNT            1               /* Processors the nucleus runs on (the machine must have as many) */
+#define MAXCPUS             16              /* Most processors uMPS3 offers */
+#define BOOTCPU             0               /* Processor that boots, takes every device interrupt and runs the Support Level */
+#define CPUID()             ((CPUCOUNT > 1) ? getPRID() : BOOTCPU)  /* Processor executing (no coprocessor read on one) */
+#define CPUPOLL             5000            /* Microseconds an idle processor waits before looking at the ready queue again */
+#define EXCSTATE(cpu)       ((state_PTR)(BIOSDATAPAGE + ((cpu) * STATEWORDS * WORDLEN))) /* Exception state saved by the BIOS for a processor */
+#define PASSUPOF(cpu)       ((passupvector_t *)(PASSUPVECTOR + ((cpu) * PASSUPSIZE)))  /* Pass Up Vector of a processor */
+#define PASSUPSIZE          0x10            /* Bytes in one Pass Up Vector */
+#define IRTBASE             0x10000300      /* Interrupt Routing Table */
+#define IRTENTRIES          48              /* Its entries: 8 per interrupt line 2-7 */
+#define IRTSTATIC(cpu)      (cpu)           /* Entry routing a source to one processor (RP bit off) */
+#define IRTDYNAMIC(mask)    (IRTRPBIT | (mask)) /* Entry routing a source to the lowest-priority processor of a mask */
+#define IRTRPBIT            0x10000000      /* IRT entry Routing Policy bit (dynamic routing) */
+#define IRTINDEX(L, D)      ((((L) - ITINT) * DEV_PER_LINE) + (D)) /* IRT entry of device D on line L */
+#define CPUBIT(cpu)         (1U << (cpu))   /* Bit of a processor in a processor mask */
+#define IPIINT              0               /* Interrupt line of inter-processor messages */
+#define IPIINTERRUPT        LINEINTERRUPT(IPIINT) /* Its Cause pending bit */
+#define IPIINBOX            0x10000400      /* This processor's IPI Inbox (a write acknowledges the oldest message) */
+#define IPIOUTBOX           0x10000404      /* This processor's IPI Outbox (recipient mask and message) */
+#define IPIRECIPSHIFT       16              /* Shift of the recipient mask in an Outbox write */
+#define IPITLBFLUSH         1               /* Message asking a processor to clear its TLB */
+#define IPIKILL             2               /* Message asking a processor to reap its terminated process */
+#define TPRADDR             0x10000408      /* This processor's Task Priority Register */
+#define TPRIDLE             0               /* Task priority of an idle processor (preferred by dynamic routing) */
+#define TPRBUSY             1               /* Task priority of a processor running a process */
+#define IRQBOOT             0               /* IRQROUTING: every device interrupt goes to the boot processor */
+#define IRQSPREAD           1               /* IRQROUTING: device D on line L goes to processor (L + D) % CPUCOUNT */
+#define IRQDYNAMIC          2               /* IRQROUTING: the IRT picks the processor with the lowest task priority */
+#define IRQROUTING          IRQSPREAD       /* How device interrupts are routed when CPUCOUNT > 1 */
 
 /* Device Constants */
 #define DEVICE_COUNT        49              /* Total number of devices */
+#define DEVDESCCOUNT        (DEVICE_COUNT - 1)  /* Device descriptors (every semaphore but the pseudo-clock's) */
+#define DEVINDEX(L, D)      ((((L) - MAPINT) * DEV_PER_LINE) + (D)) /* Semaphore/mutex index of device D on line L */
+#define TERMRECVINDEX(D)    (DEVINDEX(TERMINT, D) + DEV_PER_LINE)  /* Semaphore/mutex index of terminal D's receiver */
+#define DEVMAPSIZE          256             /* Distinct values of an 8-bit interrupt device bitmap */
 #define DEV_PER_LINE        8
 #define MAPINT              3               /* First device interrupt line */
 
@@ -162,6 +246,8 @@
 #define NETWORKINTERRUPT    0x00002000
 #define PRINTERINTERRUPT    0x00004000
 #define TERMINTERRUPT       0x00008000
+#define DEVINTERRUPTS       0x0000F800      /* Pending bits of all device lines */
+#define LINEINTERRUPT(L)    (1U << (CAUSE_IP_SHIFT + (L)))  /* Pending bit of interrupt line L */
 
 /* Addresses in RAM */
 #define OS_HEADER           ((memaddr *)KERNEL_STACK)   /* 0x20001000 */
@@ -172,9 +258,7 @@
 #define SWAPPOOLSTART_UNALIGNED (KERNEL_STACK + OS_TEXT_SIZE + OS_DATA_SIZE)   /* Swap pool start address is at the end of the text and data sections */
 #define SWAPPOOLSTART           (((SWAPPOOLSTART_UNALIGNED + PAGESIZE - 1) / PAGESIZE) * PAGESIZE)  /* Align to page boundary */
 #define FRAMETOADDR(frameNum)   (SWAPPOOLSTART + ((frameNum) * PAGESIZE)) /* Frame to address */
-#define DMABUFFERSTART      (SWAPPOOLSTART + (SWAPPOOLSIZE * PAGESIZE))     /* DMA buffer start address */
-#define DISK_DMABUFFER_ADDR(i)   (DMABUFFERSTART + ((i) * PAGESIZE))         /* Disk DMA buffer address */
-#define FLASH_DMABUFFER_ADDR(i)  (DMABUFFERSTART + ((DEV_PER_LINE + (i)) * PAGESIZE))   /* Flash DMA buffer address */
+#define ADDRTOFRAME(addr)       (((addr) - SWAPPOOLSTART) / PAGESIZE)     /* Address to frame */
 
 #define UPROC_STACK_BASE(i) (RAMTOP - ((i) * 2 * PAGESIZE))     /* Stack from one page below the top */
 #define UPROC_TLB_STACK(i)  (UPROC_STACK_BASE(i) + PAGESIZE)    /* Page fault stack */
@@ -184,12 +268,139 @@
 #define UPAGESTACK          0xBFFFF000
 #define LASTUPROCPAGE       (KUSEG + ((MAXPAGES - 2) * PAGESIZE))   /* Last user process page address */
 #define DAEMON_STACK        (UPROC_STACK_BASE(MAXUPROC) - PAGESIZE) /* Daemon stack base address */
+#define CLEANER_STACK       (DAEMON_STACK - PAGESIZE)               /* Page cleaner stack base address */
+#define FLUSHER_STACK       (CLEANER_STACK - PAGESIZE)              /* Block cache flusher stack base address */
+#define AIOWORKERS          2                                       /* Asynchronous I/O worker daemons */
+#define AIO_STACK(i)        (FLUSHER_STACK - (((i) + 1) * PAGESIZE)) /* Stack base address of AIO worker i */
+#define TRACER_STACK        AIO_STACK(AIOWORKERS)                   /* Trace writer stack base address */
+#define TERMSTACKSIZE       (PAGESIZE / 4)                          /* Stack of each terminal daemon */
+#define TERMSTACKS          (5 * DEV_PER_LINE)                      /* Terminal writers, readers, printer spoolers, then NIC receivers and transmitters (whole pages) */
+#define TERMSTACKTOP        (TRACER_STACK - PAGESIZE)               /* Terminal daemon stacks start below the trace writer */
+#define TERM_STACK(i)       (TERMSTACKTOP - ((i) * TERMSTACKSIZE))  /* Stack base address of terminal daemon i */
+#define LOADER_STACK(i)     TERM_STACK(i)                           /* Phase 4 image loader i borrows terminal daemon stack i */
+#define NET_STACK(i)        TERM_STACK((3 * DEV_PER_LINE) + (i))    /* Stack of NIC daemon i (receivers, then transmitters) */
+#define LAZYLOAD            TRUE                                    /* Phase 4 pages fault from flash until first swapped to DISK0 */
+
+/* Layout below the stacks, from the top of RAM (RAMTOP is read at boot) */
+#define DMABUFFERCOUNT      (2 * DEV_PER_LINE)                      /* One DMA buffer per disk and flash device */
+#define DMABUFFERSTART      (TERMSTACKTOP - (TERMSTACKS * TERMSTACKSIZE) - (DMABUFFERCOUNT * PAGESIZE)) /* DMA buffers end at the daemon stacks */
+#define DISK_DMABUFFER_ADDR(i)   (DMABUFFERSTART + ((i) * PAGESIZE))         /* Disk DMA buffer address (phase 5: of ASID i+1) */
+#define FLASH_DMABUFFER_ADDR(i)  (DMABUFFERSTART + ((DEV_PER_LINE + (i)) * PAGESIZE))   /* Flash DMA buffer address */
+#define DISKSCAN            TRUE                                    /* Grant disks in C-LOOK order (FALSE: arrival order) */
+#define NOCYLINDER          (-1)                                    /* Disk head position not yet known */
+#define DMALINES            2                                       /* Lines with grant queues: DISKINT, then FLASHINT */
+#define DMAQUEUE(line)      ((line) - DISKINT)                      /* Grant queues of a DMA line */
+#define IOFAIRSHARE         TRUE                                    /* Grant disks and flash across ASIDs by deficit round robin */
+#define IOQUANTUM           2                                       /* Blocks an ASID is credited per round per unit of weight */
+#define DEFAULTIOWEIGHT     1                                       /* I/O weight of a U-proc that never set one */
+#define IOWEIGHTMAX         8                                       /* Highest I/O weight SYS57 accepts */
+#define SYSTEMASID          0                                       /* ASID charged for I/O done for no U-proc */
+#define RGROUPS             4                                       /* Resource groups in the group table */
+#define RGDEFAULT           0                                       /* Group with no limits, for U-procs not assigned another */
+#define NOGROUP             (-1)                                    /* ASID in no resource group */
+#define RGNOLIMIT           0                                       /* rg_maxFrames: limited by the swap pool alone */
+#define GROUPPERIOD         100000                                  /* Microseconds over which CPU shares are enforced */
+#define BLOCKCACHE          TRUE                                    /* Serve SYS14-17 through the block cache */
+#define BCACHEFLUSH         1000000                                 /* Microseconds between block cache flushes */
+#define NOBLOCK             (-1)                                    /* Block cache entry holds no block */
+#define READAHEAD           TRUE                                    /* Read ahead of sequential SYS15/SYS17 streams into the block cache */
+#define RAMAXWINDOW         4                                       /* Most blocks read ahead of one stream */
+#define RAFILLMAX           (BCACHEBLOCKS / 2)                      /* Most block cache entries being filled by read-ahead at once */
+#define NOFILL              0                                       /* cb_fill: no read-ahead pending */
+#define FILLQUEUED          1                                       /* cb_fill: read-ahead waiting for a worker */
+#define FILLRUNNING         2                                       /* cb_fill: a worker is reading the block */
+#define FLASHLOG            TRUE                                    /* Log-structure the user blocks from FLASHLOGBASE of each flash device */
+#define FLASHLOGBASE        MAXPAGES                                /* First logged block (past the image blocks of a region based at 0) */
+#define LOGSEGBLOCKS        4                                       /* Flash blocks in one log segment */
+#define LOGSEGS             7                                       /* Segments in a device's log */
+#define LOGSLOTS            (LOGSEGS * LOGSEGBLOCKS)                /* Physical blocks of a device's log (at most 32) */
+#define FLASHLOGBLOCKS      (LOGSLOTS - (2 * LOGSEGBLOCKS))         /* Logical blocks a log holds (two segments spare) */
+#define LOGCKPT             (FLASHLOGBASE + LOGSLOTS)               /* First of a log's two checkpoint blocks */
+#define LOGAREAEND          (LOGCKPT + 2)                           /* First block past a log */
+#define LOGCLEANMIN         2                                       /* Free segments the cleaner keeps per log */
+#define LOGMAGIC            0x4C4F4731                              /* Valid log checkpoint ("LOG1") */
+#define LOGFREE             (-1)                                    /* Log slot holds nothing */
+#define LOGWRITING          (-2)                                    /* Log slot is being written */
+#define LOGSTALE            (-3)                                    /* Log slot was overwritten since the last checkpoint */
+#define TERMBUFFERED        TRUE                                    /* SYS12 copies into a ring drained by a writer daemon */
+#define TERMRINGSIZE        256                                     /* Characters buffered per terminal transmitter */
+#define TYPEAHEAD           TRUE                                    /* A reader daemon keeps each terminal receiver armed */
+#define TERMINPUTSIZE       256                                     /* Characters of type-ahead buffered per terminal */
+#define PRINTSPOOLED        TRUE                                    /* SYS11 copies into a spool printed by a daemon */
+#define PRINTSPOOLSIZE      1024                                    /* Characters spooled per printer */
+#define USERSEMS            32                                      /* Named semaphores shared by the U-procs */
+#define MAILBOXSLOTS        4                                       /* Messages queued per ASID's mailbox */
+#define MSGINLINE           64                                      /* Largest message copied inline (bytes) */
+#define MSGRETRIES          4                                       /* Tries to fault in and detach a page message */
+#define SHMSEGMENTS         4                                       /* Named shared memory segments */
+#define SHMMAXPAGES         8                                       /* Most pages in one segment */
+#define SHMFLASH            0                                       /* Flash device holding the segments' backing store */
+#define SHMBLOCK            64                                      /* Its first block (segment s, page i at SHMBLOCK + s * SHMMAXPAGES + i) */
+#define NOSEGMENT           -1                                      /* A page in no shared segment */
+#define DISKMAPS            4                                       /* Disk-mapped regions (segments SHMSEGMENTS and up) */
+#define DISKMAPMAXPAGES     16                                      /* Most pages in one disk-mapped region */
+#define SEGMENTS            (SHMSEGMENTS + DISKMAPS)                /* Segment slots: named ones, then disk maps */
+#define NODISKMAP           -1                                      /* Disk of a segment backed by SHMFLASH */
+#define DISKMAPSHIFT        24                                      /* SYS52 a3: disk number above the first sector */
+#define DISKMAPADDR(d, s)   (((d) << DISKMAPSHIFT) | (s))           /* SYS52 a3 for disk d from sector s */
+#define FUTEXSLOTS          16                                      /* Futex wait table entries (power of two) */
+#define FUTEXHASHBITS       4                                       /* log2(FUTEXSLOTS) */
+#define FUTEXRETRIES        4                                       /* Tries to fault in a futex word's page */
+#define FUTEXSHARED         (MAXUPROC + 1)                          /* Futex key space of shared segment 0 (the ASIDs are below) */
+#define AIOSLOTS            (2 * MAXUPROC)                          /* Asynchronous requests in flight at once */
+#define AIOPENDING          0                                       /* aio_status of a request still in flight */
+#define WAITANYMAX          8                                       /* Most events one SYS53 waits on */
+#define WAITERS             (MAXUPROC + MAXTHREADS)                 /* SYS53 waiter slots (one per U-proc or thread) */
+#define WAITAIO             0                                       /* SYS53 event: an aiocb_t's request is done */
+#define WAITSEM             1                                       /* SYS53 event: a named semaphore has a unit (taken) */
+#define WAITTERM            2                                       /* SYS53 event: a terminal has an input line for SYS13 */
+#define WAITNET             3                                       /* SYS53 event: a NIC has a received packet for SYS55 */
+#define WAITFOREVER         -1                                      /* SYS53 timeout: no deadline */
+#define NOEVENT             -1                                      /* No SYS53 event is ready */
+#define NETRXRING           4                                       /* Receive buffers (frames) posted per NIC */
+#define NETTXRING           8                                       /* Packets queued for transmission per NIC */
+#define NETTXBATCH          4                                       /* Transmissions completed per ring update */
+#define NETPACKETMAX        1514                                    /* Largest packet (one Ethernet frame) */
+#define NETRETRY            10000                                   /* Microseconds between tries for a receive frame */
+#define NETGIVEPAGE         0x100                                   /* SYS54 a3 flag: send by giving the page away */
+#define DISKIOVMAX          16                                      /* Most sectors in one vectored disk syscall */
+#define VOLUMESTRIPE        4                                       /* Sectors of one stripe unit of the disk volume */
+#define VOLUMEMAX           16                                      /* Most sectors in one disk volume syscall */
+#define BCACHEBLOCKS        8                                       /* Frames of the block cache for SYS14-17 */
+#define BCACHESTART         (DMABUFFERSTART - (BCACHEBLOCKS * PAGESIZE)) /* Block cache frames end at the DMA buffers */
+#define BCACHE_ADDR(i)      (BCACHESTART + ((i) * PAGESIZE))        /* Block cache frame address */
+#define FLASH_BOUNCE_ADDR(asid) BCACHE_ADDR((asid) - 1)                 /* Phase 4 flash syscall buffer of an ASID (borrows a cache frame) */
+#define KMEMFRAMES          8                                       /* Extra slab frames for the size-class caches (kmemAlloc) */
+#define SLABFRAMES          (2 + (2 * (CPUCOUNT - 1)) + KMEMFRAMES) /* Frames reserved for kernel slabs (plus a stack and a time page per extra processor) */
+#define THREAD_STACK_BASE(t) (BCACHESTART - (((2 * (t)) + 1) * PAGESIZE)) /* Exception stacks of thread slot t end at the block cache */
+#define THREAD_TLB_STACK(t) (THREAD_STACK_BASE(t) + PAGESIZE)       /* Its page fault stack */
+#define THREAD_GEN_STACK(t) (THREAD_STACK_BASE(t))                  /* Its general exception stack */
+#define THREADSTACKEND      (BCACHESTART - (2 * MAXTHREADS * PAGESIZE)) /* Below the last thread slot's stacks */
+#define SLABEND             THREADSTACKEND                          /* End of the frames free for kernel slabs */
+#define SLABSTART           (SLABEND - (SLABFRAMES * PAGESIZE))     /* First kernel slab frame */
+#define SLABINDEX(a)        (((a) - SLABSTART) / PAGESIZE)          /* Slab frame index of a kernel address in it */
+#define SWAPPOOLEND         SLABSTART                               /* The swap pool and its metadata fill RAM up to here */
+#define NOFRAME             0                                       /* No kernel frame left */
+#define KMEMCLASSES         8                                       /* Size classes of the kernel object caches */
+#define KMEMMINSHIFT        4                                       /* log2 of the smallest class (16 bytes; classes double up to PAGESIZE / 2) */
+#define KMEMMAXSIZE         (1 << (KMEMMINSHIFT + KMEMCLASSES - 1)) /* Largest object kmemAlloc hands out */
+#define KMEMWHOLE           -1                                      /* Slab frame class: handed out whole */
+#define KMEMFREE            -2                                      /* Slab frame class: free */
+#define NOSLAB              -1                                      /* End of a slab frame list */
 
 /* Hardware Constants */
 #define PRINTCHR	        2
 #define MAXSTRINGLEN        128
 #define BYTELEN	            8
 #define RECVD	            5
+#define NOTINSTALLED        0               /* Device status of an absent device */
+#define NETREADCONF         2               /* NIC command: read the configuration into DATA0 */
+#define NETREADNET          3               /* NIC command: receive a packet into DATA0 (length in DATA1) */
+#define NETWRITENET         4               /* NIC command: send DATA1 bytes at DATA0 */
+#define NETCONFIGURE        5               /* NIC command: set the configuration from DATA0 */
+#define NETCONFINT          0x4             /* NIC configuration: interrupt when a packet arrives */
+#define NETREADPENDING      0x80            /* NIC status: received packets are waiting */
+#define NETSTATUSMASK       0x7F            /* NIC status code bits */
 #define TERMSTATMASK        0x000000FF
 #define NEWLINE             0x0A            /* Newline character for terminal and printer output */
 #define READ                2               /* BackingStoreRW read command */
@@ -208,17 +419,197 @@
 #define DISK_COMMAND_SECT_SHIFT 8           /* Disk command sector shift */
 
 /* Virtual Memory Constants */
-#define MAXUPROC            8               /* Maximum number of U-procs to create */
+#define MAXUPROC            8               /* Most U-procs (ASIDs 1..MAXUPROC); the boot configuration may run fewer */
+#define CONFIGDISK          0               /* Disk holding the U-proc boot configuration block */
+#define CONFIGSECTOR        0               /* Its sector */
+#define CONFIGMAGIC         0x50434647      /* "PCFG": first word of a valid configuration block */
+#define TODEVEND            0               /* Configured region length: up to the end of the flash device */
 #define MAXPAGES            32              /* Maximum number of pages to allocate */
-#define SWAPPOOLSIZE        (MAXUPROC * 2)  /* Size of the swap pool */
+#define SWAPPOOLSIZE        (MAXUPROC * 2)  /* Size of the swap pool (phases 3-4; phase 5 sizes it from RAM at boot) */
 #define VPNSHIFT            12              /* Virtual Page Number shift */
 #define VPNMASK             0xFFFFF000      /* Virtual Page Number mask */
 #define VALIDON             0x00000200      /* Valid bit for page table entries */
 #define DIRTYON             0x00000400      /* Dirty bit for page table entries */
 #define UNOCCUPIED          -1              /* Unoccupied asid */
 #define PROBESHIFT          31              /* Shift for probe in index */
+#define TLBSIZE             16              /* TLB entries (must match the machine configuration) */
+#define TLBINDEXSHIFT       8               /* Shift of the entry number in the Index register */
+#define ASIDMASK            0x00000FC0      /* ASID field of EntryHi */
+#define TLBPRELOAD          TRUE            /* Preload a U-proc's recent pages into the TLB on dispatch */
+#define RECENTPAGES         4               /* Recent pages remembered per U-proc (TLB entries 0 to RECENTPAGES-1) */
+#define TLBSWEEPMIN         4               /* Sharers from which one TLB sweep beats a probe per sharer */
 #define ASIDSHIFT           6               /* Shift for ASID */
 #define USTACKNUM           31              /* Stack page number for user processes */
+#define STACKEXTPAGES       8               /* Pages the stack may grow below the stack page (at most 32) */
+#define USTACKLIMIT         (UPAGESTACK - (STACKEXTPAGES * PAGESIZE))   /* Lowest stack extension page address */
+#define STACKEXTINDEX(addr) (((UPAGESTACK - ((addr) & VPNMASK)) >> VPNSHIFT) - 1) /* Slot of a stack extension page */
+#define ALLSTACKEXT         (0xFFFFFFFF >> (32 - STACKEXTPAGES))        /* Mask of every stack extension page */
+#define TIMEPAGE            TRUE            /* Map the nucleus time page read-only into every U-proc */
+#define UTIMEPAGE           (KUSEG + ((MAXPAGES - 1) * PAGESIZE))  /* User address of the time page (above the last U-proc page) */
+#define PAGEINDEX(entryHI)  (((entryHI) >> VPNSHIFT) & (MAXPAGES - 1)) /* Page table slot of a VPN: KUSEG pages 0-30 and the stack page (VPN 0xBFFFF) land on 0-31 */
+#define PFNMASK             0xFFFFF000      /* Page Frame Number mask of EntryLo */
+#define NOSWAPFRAME         -1              /* End of a free-frame or owned-frame list */
+#define FIFOPOLICY          0               /* Evict swap pool frames in FIFO order */
+#define CLOCKPOLICY         1               /* Evict with CLOCK (second chance) over software reference bits */
+#define REPLACEMENT         CLOCKPOLICY     /* Page replacement policy in use */
+#define READAHEADMAX        4               /* Most pages read ahead on an in-order fault (0 disables) */
+#define PAGECLEANER         TRUE            /* Run the page cleaner daemon */
+#define CLEANINTERVAL       100000          /* Microseconds between page cleaner passes */
+#define CLEANAHEAD          4               /* Frames ahead of the replacement pointer the cleaner looks at */
+#define WBCLUSTER           4               /* Most dirty pages of one ASID a clustered write-back writes */
+#define ZEROFILL            TRUE            /* Zero BSS and stack pages in RAM instead of reading them */
+#define IDLEWORK            TRUE            /* Zero free frames and start the page cleaner while the nucleus idles */
+#define IDLEZEROBATCH       4               /* Most free frames zeroed per idle entry */
+#define COMPRESSSWAP        TRUE            /* Write pages back compressed into a RAM arena before flash */
+#define ZSWAPFRAMES         8               /* Swap pool frames given to the compressed arena (at most a quarter) */
+#define ZCHUNKWORDS         32              /* Words per arena chunk */
+#define ZCHUNKS             (ZSWAPFRAMES * (PAGESIZE / (ZCHUNKWORDS * WORDLEN))) /* Chunks in a full arena */
+#define ZMAXWORDS           (PAGESIZE / WORDLEN / 2) /* Largest compressed page kept (a multiple of ZCHUNKWORDS) */
+#define ZMINRUN             3               /* Shortest run of one word encoded as a run */
+#define ZRUNBIT             0x80000000      /* Token header bit: a run of one word, not literal words */
+#define NOCHUNK             -1              /* End of an arena chunk chain */
+#define IMAGESHADOW         TRUE            /* Write data pages back below the stack blocks, keeping the image intact */
+#define SWAPSTRIPE          TRUE            /* Stripe each ASID's shadow and stack blocks across the regions of a group */
+#define STRIPEWIDTH         4               /* Most regions (on distinct flash devices) in a stripe group */
+#define SHADOWPAGES         (IMAGESHADOW ? MAXPAGES : 0) /* Flash blocks reserved for shadow copies of image pages */
+#define REGIONMIN           (MAXPAGES + SHADOWPAGES + STACKEXTPAGES) /* Fewest flash blocks one ASID's backing store takes */
+#define PAGEBIT(page)       (1U << (page))  /* Bit of a page in a per-ASID page mask */
+#define CHECKPOINTS         TRUE            /* SYS61 saves a U-proc to disk and the next boot resumes it */
+#define CKPTDISK            CONFIGDISK      /* Disk holding the checkpoints (no U-proc reaches DISK0) */
+#define CKPTBASE            (CONFIGSECTOR + 1) /* First sector of ASID 1's checkpoint slot */
+#define CKPTPAGES           (MAXPAGES + STACKEXTPAGES) /* Most pages one checkpoint holds */
+#define CKPTSLOT            (1 + CKPTPAGES) /* Sectors per ASID: the header, then the pages */
+#define CKPTSECTOR(asid)    (CKPTBASE + (((asid) - 1) * CKPTSLOT)) /* Header sector of an ASID's checkpoint */
+#define CKPTMAGIC           0x434B5054      /* "CKPT": first word of a valid checkpoint header */
+#define PFFCONTROL          TRUE            /* Run the page-fault-frequency controller */
+#define RSSFLOOR            2               /* Fewest frames the controller leaves a U-proc */
+#define WIREMAXPAGES        8               /* Most pages one ASID keeps wired with SYS45 */
+#define WIRERETRIES         4               /* Faults SYS45 takes on one page before giving up */
+#define PFFLOWER            5000            /* Microseconds between faults under which a U-proc gets a frame */
+#define PFFUPPER            50000           /* Microseconds between faults over which a U-proc gives one back */
+#define PFFSUSPEND          200000          /* Microseconds the worst offender is suspended under pressure */
+#define VICTIMCACHE         4               /* Evicted frames kept intact for minor faults (0 disables) */
+#define SHAREDTEXT          TRUE            /* Map identical text pages of different U-procs to one frame */
+#define ASIDBIT(asid)       (1U << (asid))  /* Bit of an ASID in a frame's sharer mask */
+#define POOLMAPS            6               /* State bitmaps in the swap pool metadata */
+#define MAPWORDS(frames)    (((frames) + 31) >> 5)  /* Words in a bitmap with a bit per frame */
+#define TESTFRAME(map, f)   (((map)[(f) >> 5] >> ((f) & 31)) & 1U) /* Test a frame's bit in a swap pool bitmap */
+#define SETFRAME(map, f)    ((map)[(f) >> 5] |= (1U << ((f) & 31)))  /* Set it */
+#define CLEARFRAME(map, f)  ((map)[(f) >> 5] &= ~(1U << ((f) & 31))) /* Clear it */
+#define PAGEHASHBITS        6               /* log2 of the number of (asid, vpn) to frame hash buckets */
+#define PAGEBUCKETS         (1 << PAGEHASHBITS) /* (asid, vpn) to frame hash buckets */
+#define PAGEHASHMULT        0x9E3779B9      /* Fibonacci hashing multiplier (2^32 / phi) */
+#define FNVOFFSET           0x811C9DC5      /* FNV-1a offset basis for text page fingerprints */
+#define FNVPRIME            0x01000193      /* FNV-1a prime */
+#define AOUTTEXTFILESIZE    5               /* aout header word: .text file size (0x0014) */
+#define AOUTDATAFILESIZE    9               /* aout header word: .data file size (0x0024) */
+
+/* Active Semaphore List Constants */
+#define ASLHASHBITS         5                           /* log2 of the number of ASL hash buckets */
+#define ASLBUCKETS          (1 << ASLHASHBITS)          /* ASL hash buckets */
+#define ASLHASHMULT         0x9E3779B9                  /* Fibonacci hashing multiplier (2^32 / phi) */
+
+/* Scheduler Trace Constants */
+#define TRACING             TRUE            /* Record scheduler events in the trace ring */
+#define TRACESIZE           128             /* Events held by the trace ring (power of two) */
+#define TRACEMASK           (TRACESIZE - 1) /* Mask to wrap a trace ring index */
+#define TRACECHUNK          8               /* Events copied per nucleus call by SYS22 */
+#define TRACE_DISPATCH      0               /* Scheduler dispatched a process */
+#define TRACE_PREEMPT       1               /* Quantum expired (PLT) */
+#define TRACE_BLOCK         2               /* Process blocked on a semaphore */
+#define TRACE_UNBLOCK       3               /* Process woken from a semaphore */
+
+/* Binary Trace Sink Constants */
+#define TRACESINK           TRUE            /* Stream binary trace records to a flash device no region uses */
+#define TRACERECSIZE        16              /* Bytes of one trace record */
+#define TRACEPAGERECS       (PAGESIZE / TRACERECSIZE) /* Records in one trace page (the first is its header) */
+#define TRACEFLUSH          10000           /* Microseconds between the trace writer's passes */
+#define TRACETICKETS        10              /* Stride tickets of the trace writer */
+#define TRACEMAGIC          0x5452          /* tr_asid of a page header ("TR") */
+#define TRK_NONE            0               /* Unused record (tail of the last page) */
+#define TRK_PAGE            1               /* Page header: event = page sequence number, arg = records dropped before it */
+#define TRK_SCHED           2               /* event = TRACE_DISPATCH, _PREEMPT, _BLOCK or _UNBLOCK, arg = PCB address */
+#define TRK_INTERRUPT       3               /* event = interrupt line, or PERFLINES + device semaphore index */
+#define TRK_PAGING          4               /* event = PERF_TLBREFILL, _PAGEFAULT, _EVICTION or _WRITEBACK */
+#define TRK_SYSCALL         5               /* event = SYSCALL number */
+
+/* Deferred Interrupt Constants */
+#define DEFERIRQ            TRUE            /* Device interrupts only acknowledge and queue; the rest runs in batches */
+#define DEFERSLOTS          DEVDESCCOUNT    /* Queued completions (one per device semaphore at most) */
+#define DEFERBUDGET         4               /* Completions finished between polls for new interrupts */
+
+/* Latency Histogram Constants */
+#define LATENCYSTATS        TRUE            /* Record interrupt-to-run latency histograms */
+#define LATLINES            (TERMINT - ITINT + 1)   /* Lines with histograms (pseudo-clock and devices) */
+#define LATBUCKETS          20              /* Bucket b counts latencies in [2^b, 2^(b+1)) us */
+#define LATKINDS            3               /* Histograms kept per line */
+#define LAT_DEVICE          0               /* Interrupt entry to V of the device semaphore */
+#define LAT_SCHED           1               /* V of the device semaphore to dispatch */
+#define LAT_TOTAL           2               /* Interrupt entry to dispatch */
+
+/* Performance Counter Constants */
+#define PERFSTATS           TRUE            /* Keep the nucleus-wide and per-ASID performance counters */
+#define PERFSUMMARY         TRUE            /* test() prints the counters on PERFPRINTER at shutdown */
+#define PERFPRINTER         0               /* Printer the shutdown summary goes to */
+#define PERFLINELEN         128             /* Longest line of the shutdown summary */
+#define PERFDIGITS          10              /* Decimal digits of an unsigned int */
+#define PERFBLOCKS          (MAXUPROC + 1)  /* Counter blocks: nucleus-wide, then one per ASID */
+#define PERF_CSWITCH        0               /* Dispatch of a process other than the last one run */
+#define PERF_PREEMPT        1               /* Quantum expired (PLT) */
+#define PERF_TLBREFILL      2               /* TLB refill */
+#define PERF_PAGEFAULT      3               /* Page fault (TLB-Invalid) taken by the pager */
+#define PERF_EVICTION       4               /* Page that lost its frame to another page */
+#define PERF_WRITEBACK      5               /* Dirty page written to its backing store */
+#define PERF_BLOCKEDP       6               /* P that blocked (including SYS5, SYS7 and WAITUNTIL) */
+#define PERF_WAKINGV        7               /* V that woke a blocked process */
+#define PERF_SYSCALL        8               /* Plus (SYSCALL number - MINSYSCALL) */
+#define PERFSYSCALLS        (SUPMAXSYSCALL - MINSYSCALL + 1) /* SYSCALL numbers counted, from MINSYSCALL up */
+#define PERF_LINE           (PERF_SYSCALL + PERFSYSCALLS) /* Plus interrupt line */
+#define PERFLINES           8               /* Interrupt lines counted */
+#define PERF_DEVICE         (PERF_LINE + PERFLINES)       /* Plus device semaphore index */
+#define PERFCOUNTS          (PERF_DEVICE + DEVICE_COUNT)  /* Counters in a block */
+#define SELFASID            -1              /* SYS32 a2: the caller's own block */
+
+/* Sampling Profiler Constants */
+#define PROFILING           TRUE            /* Let U-procs profile their PCs with SYS33 */
+#define PROFBUCKETS         128             /* PC buckets of a profile */
+#define PROFSHIFT           6               /* log2 bytes of code per bucket (16 instructions) */
+#define PROFMININTERVAL     100             /* Shortest sampling interval (us) */
+#define PROFSTOP            0               /* SYS33 a1: stop sampling */
+#define PROFSTART           1               /* SYS33 a1: empty the profile and start sampling */
+#define PROFREAD            2               /* SYS33 a1: copy the profile out */
+
+/* Semaphore Contention Constants */
+#define LOCKSTATS           TRUE            /* Count P operations and their waits per semaphore */
+#define LOCKHASHBITS        7               /* log2 of the slots of the statistics table */
+#define LOCKSLOTS           (1 << LOCKHASHBITS) /* Semaphores the table can tell apart */
+#define LOCKCHUNK           8               /* Entries copied per call by SYS34 */
+#define NOLINE              -1              /* p_wakeLine of a process not woken by an interrupt */
+
+/* Device Statistics Constants */
+#define DEVSTATS            TRUE            /* Time and count the commands of every device */
+#define DEVCMDCODES         8               /* Command codes counted separately (the low byte, 0-7) */
+#define DEVCMDMASK          0x000000FF      /* Command code of a command register value */
+#define NOCOMMAND           -1              /* ds_command of a device with no command in flight */
+
+/* Boot Timing Constants (each phase is stamped with the TOD it ended at) */
+#define BOOTREPORT          TRUE            /* test() prints the boot phases on PERFPRINTER once the U-procs start */
+#define BOOTFASTSTART       TRUE            /* Create every U-proc before fingerprinting their text */
+#define BOOTPASSUP          0               /* Boot phase: Pass Up Vector set */
+#define BOOTDEVICES         1               /* Boot phase: device table built */
+#define BOOTSLAB            2               /* Boot phase: slab frames ready (other processors started) */
+#define BOOTPCBS            3               /* Boot phase: PCB pool built */
+#define BOOTASL             4               /* Boot phase: ASL built */
+#define BOOTNUCLEUS         5               /* Boot phase: scheduler and statistics ready, first process made */
+#define BOOTTEST            6               /* Boot phase: test() dispatched */
+#define BOOTDRIVERS         7               /* Boot phase: device mutexes, drivers and daemons ready */
+#define BOOTSWAPPOOL        8               /* Boot phase: support structures and swap pool ready */
+#define BOOTCONFIG          9               /* Boot phase: U-proc configuration read, backing stores set */
+#define BOOTFIRSTUPROC      10              /* Boot phase: first U-proc created */
+#define BOOTUPROCS          11              /* Boot phase: every U-proc created */
+#define BOOTFIRSTRUN        12              /* Boot phase: a U-proc ran (its first page fault) */
+#define BOOTTEXTPRINTS      13              /* Boot phase: text fingerprints taken */
+#define BOOTPHASES          14              /* Boot phases stamped */
 
 /* SYS calls */
 #define TERMINATE           9               /* SYSCALL number for TERMINATE (SYS9) */
@@ -231,5 +622,63 @@
 #define FLASH_PUT		    16              /* SYSCALL number for FLASH PUT (SYS16) */
 #define	FLASH_GET		    17              /* SYSCALL number for FLASH GET (SYS17) */
 #define DELAY			    18              /* SYSCALL number for DELAY (SYS18) */
+#define GETCPUTIMES         21              /* SYSCALL number for GET CPU TIMES (SYS21) */
+#define READTRACE           22              /* SYSCALL number for READ TRACE (SYS22) */
+#define GETLATENCY          23              /* SYSCALL number for GET LATENCY (SYS23) */
+#define DISK_PUTV           24              /* SYSCALL number for vectored DISK PUT (SYS24) */
+#define DISK_GETV           25              /* SYSCALL number for vectored DISK GET (SYS25) */
+#define AIOSUBMIT           26              /* SYSCALL number for ASYNC I/O SUBMIT (SYS26) */
+#define AIOWAIT             27              /* SYSCALL number for ASYNC I/O WAIT (SYS27) */
+#define DELAYMICRO          28              /* SYSCALL number for MICROSECOND DELAY (SYS28) */
+#define PSEMTIMED           29              /* SYSCALL number for TIMED P ON A NAMED SEMAPHORE (SYS29) */
+#define VSEMNAMED           30              /* SYSCALL number for V ON A NAMED SEMAPHORE (SYS30) */
+#define BATCH               31              /* SYSCALL number for BATCHED SYSCALLS (SYS31) */
+#define BATCHMAX            32              /* Most records one SYS31 runs */
+#define BATCHSTOPFAIL       1               /* SYS31 flag: stop after the first negative result */
+#define GETCOUNTERS         32              /* SYSCALL number for GET PERFORMANCE COUNTERS (SYS32) */
+#define PROFILE             33              /* SYSCALL number for PC SAMPLING PROFILER (SYS33) */
+#define GETLOCKSTATS        34              /* SYSCALL number for GET SEMAPHORE CONTENTION (SYS34) */
+#define GETDEVSTATS         35              /* SYSCALL number for GET DEVICE STATISTICS (SYS35) */
+#define MSGSEND             36              /* SYSCALL number for SEND MESSAGE (SYS36) */
+#define MSGRECEIVE          37              /* SYSCALL number for RECEIVE MESSAGE (SYS37) */
+#define SHMATTACH           38              /* SYSCALL number for ATTACH SHARED SEGMENT (SYS38) */
+#define PSEMNAMED           39              /* SYSCALL number for P ON A NAMED SEMAPHORE (SYS39) */
+#define GETSYSSTATS         40              /* SYSCALL number for GET SYSCALL STATISTICS (SYS40) */
+#define STREAMPRINTER       41              /* SYSCALL number for STREAM TO PRINTER (SYS41) */
+#define STREAMTERMINAL      42              /* SYSCALL number for STREAM TO TERMINAL (SYS42) */
+#define RESPAWN             43              /* SYSCALL number for RESPAWN FROM THE CACHED IMAGE (SYS43) */
+#define REAP                44              /* SYSCALL number for REAP AN EXITED U-PROC (SYS44) */
+#define REAPNOWAIT          1               /* SYS44 flag: return ERROR instead of waiting for an exit */
+#define PINPAGES            45              /* SYSCALL number for PIN OR UNPIN USER PAGES (SYS45) */
+#define PINRELEASE          1               /* SYS45 flag: unpin the pages instead */
+#define FUTEXWAIT           46              /* SYSCALL number for WAIT ON A USER WORD (SYS46) */
+#define FUTEXWAKE           47              /* SYSCALL number for WAKE WAITERS ON A USER WORD (SYS47) */
+#define FORK                48              /* SYSCALL number for CLONE THE CALLING U-PROC (SYS48) */
+#define THREADCREATE        49              /* SYSCALL number for CREATE A THREAD (SYS49) */
+#define THREADJOIN          50              /* SYSCALL number for JOIN A THREAD (SYS50) */
+#define THREADEXIT          51              /* SYSCALL number for EXIT THE CALLING THREAD (SYS51) */
+#define MAXTHREADS          8               /* Thread slots shared by all U-procs (beyond their main threads) */
+#define NOTHREAD            -1              /* Thread slot of a U-proc's main thread */
+#define THREADFREE          0               /* Thread slot state: unused */
+#define THREADRUNNING       1               /* Thread slot state: its thread has not exited */
+#define THREADEXITED        2               /* Thread slot state: exited, waiting to be joined */
+#define DISKMAP             52              /* SYSCALL number for MAP DISK SECTORS INTO MEMORY (SYS52) */
+#define WAITANY             53              /* SYSCALL number for WAIT FOR ANY OF SEVERAL EVENTS (SYS53) */
+#define NETSEND             54              /* SYSCALL number for SEND A PACKET (SYS54) */
+#define NETRECV             55              /* SYSCALL number for RECEIVE A PACKET (SYS55) */
+#define GETBOOTTIMES        56              /* SYSCALL number for GET BOOT PHASE TIMES (SYS56) */
+#define IOSHARE             57              /* SYSCALL number for SET I/O WEIGHT AND READ I/O SHARE (SYS57) */
+#define GETGROUPSTATS       58              /* SYSCALL number for GET RESOURCE GROUP STATISTICS (SYS58) */
+#define VOLUMEPUT           59              /* SYSCALL number for WRITE TO THE DISK VOLUME (SYS59) */
+#define VOLUMEGET           60              /* SYSCALL number for READ FROM THE DISK VOLUME (SYS60) */
+#define CHECKPOINT          61              /* SYSCALL number for CHECKPOINT THE CALLING U-PROC (SYS61) */
+#define CKPTRESUMED         1               /* SYS61 result in a U-proc resumed from its checkpoint */
+#define EXITRECORDS         MAXUPROC        /* Exit records queued for SYS44 (the oldest is dropped when full) */
+#define EXITSYS9            0               /* Exit reason: the U-proc called SYS9 */
+#define EXITTRAP            1               /* Exit reason: terminated for a trap or bad SYSCALL arguments */
+#define SUPMINSYSCALL       TERMINATE       /* Lowest Support Level SYSCALL number */
+#define SUPMAXSYSCALL       CHECKPOINT      /* Highest Support Level SYSCALL number */
+#define SUPSYSCALLS         (SUPMAXSYSCALL - SUPMINSYSCALL + 1) /* Entries in the SYSCALL table */
+#define NOARG               0               /* SYSCALL table: no such argument */
 
 #endif
\ No newline at end of file
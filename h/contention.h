@@ -0,0 +1,25 @@
+#ifndef CONTENTION_H
+#define CONTENTION_H
+
+/******************************* contention.h *************************************
+ *
+ * This header file contains the declarations for the semaphore contention
+ * statistics.
+ * It establishes the interface for the contention.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         initLockStats();                                    /* Empty the statistics table */
+extern void         lockAcquired(int *semAdd, int contended);           /* Count a P */
+extern void         lockWaited(int *semAdd, cpu_t wait);                /* Count the wait of a woken P */
+extern int          readLockStats(lockStat_PTR buffer, int first, int maxStats); /* Copy out table entries */
+
+#endif /* CONTENTION_H */
@@ -17,6 +17,7 @@
 
 /* Function Declarations */
 extern void             delaySyscallHandler(support_PTR supportStruct);     /* SYS18 handler */
+extern void             delayMicroSyscallHandler(support_PTR supportStruct); /* SYS28 handler */
 extern void             initADL();                                          /* Initialize Delay Facility */
 
 #endif /* DELAYDAEMON_H */
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef DEVICESTATS_H
+#define DEVICESTATS_H
+
+/******************************* deviceStats.h *************************************
+ *
+ * This header file contains the declarations for the per-device
+ * utilization statistics.
+ * It establishes the interface for the deviceStats.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         initDevStats();                                     /* Empty the device statistics */
+extern void         devIssued(int device, unsigned int command);        /* Stamp a command being issued */
+extern void         devCompleted(int device, unsigned int status);      /* Count a completed command */
+extern int          readDevStats(int device, devStat_PTR buffer);       /* Copy out a device's statistics */
+
+#endif /* DEVICESTATS_H */
@@ -17,10 +17,23 @@
 #include "initProc.h"
 
 /* Function Declarations */
+extern void             initDiskQueues();                                                       /* Empty the per-device request queues */
+extern void             acquireDevice(int line, int devNum, diskRequest_PTR request, int block, int asid); /* Queue for a disk or flash grant */
+extern void             releaseDevice(int line, int devNum, int blocks);                        /* Charge the grant and pass it on */
+extern void             resetIOShare(int asid, int parent);                                     /* Give a new U-proc a fresh I/O share */
+extern void             readIOShare(int asid, ioShare_PTR share);                               /* Sum an ASID's I/O share over the devices */
+extern int              ioShareSyscallHandler(support_PTR supportStruct);                       /* Handles SYS57 (IOSHARE) */
 extern int              diskRW(int operation, int diskNum, int sector, memaddr bufferAddr);     /* Perform read/write on disk */
 extern int              flashRW(int operation, int flashNum, int blockNum, memaddr bufferAddr); /* Perform read/write on flash */
+extern int              diskTransfer(int operation, int diskNum, int sector, memaddr bufferAddr, int asid);   /* Disk read/write under the disk grant */
+extern int              flashTransfer(int operation, int flashNum, int blockNum, memaddr bufferAddr, int asid); /* Flash read/write under the flash grant */
+extern int              diskSectors(int diskNum);                                               /* Number of sectors on a disk */
+extern int              validUserBlock(int line, int devNum, int block);                        /* Check a user DMA request's device and block */
+extern int              userBlockIO(support_PTR supportStruct, int line, int write, int devNum, int block, memaddr logicalAddress); /* Move a block between a user page and a device */
 extern int              diskPutSyscallHandler(support_PTR supportStruct);                       /* Handles SYS14 (DISK_PUT) */
 extern int              diskGetSyscallHandler(support_PTR supportStruct);                       /* Handles SYS15 (DISK_GET) */
+extern int              diskPutVSyscallHandler(support_PTR supportStruct);                      /* Handles SYS24 (DISK_PUTV) */
+extern int              diskGetVSyscallHandler(support_PTR supportStruct);                      /* Handles SYS25 (DISK_GETV) */
 extern int              flashPutSyscallHandler(support_PTR supportStruct);                      /* Handles SYS16 (FLASH_PUT) */
 extern int              flashGetSyscallHandler(support_PTR supportStruct);                      /* Handles SYS17 (FLASH_GET) */
 
@@ -0,0 +1,23 @@
+#ifndef DISKVOLUME_H
+#define DISKVOLUME_H
+
+/******************************* diskVolume.h *************************************
+ *
+ * This header file contains the declarations for the disk volume, which
+ * stripes one linear sector space across the user disks (SYS59/SYS60).
+ * It establishes the interface for the diskVolume.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/asyncIO.h"
+
+/* Function Declarations */
+extern void         initDiskVolume();                                   /* Find the member disks and the volume size */
+extern int          volumeSectors();                                    /* Sectors in the volume */
+extern int          volumePutSyscallHandler(support_PTR supportStruct); /* Handles SYS59 (VOLUMEPUT) */
+extern int          volumeGetSyscallHandler(support_PTR supportStruct); /* Handles SYS60 (VOLUMEGET) */
+
+#endif /* DISKVOLUME_H */
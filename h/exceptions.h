@@ -32,12 +32,18 @@ extern void         waitIO();                                           /* Wait
 extern void         getCpuTime();                                       /* Get CPU time */
 extern void         waitClock();                                        /* Wait for clock */
 extern void         getSupportPtr();                                    /* Get support pointer */
+extern void         waitUntil();                                        /* Wait until a TOD */
+extern void         tlbShootdown();                                     /* Wait for other processors to drop ASIDs' TLB entries */
+extern void         noteTLBASID(int cpu, pcb_PTR p);                    /* A processor's TLB may now hold a process's entries */
+extern int          releaseShootdowns(int cpu);                         /* Do a pending TLB flush and wake its waiters */
 extern void         tlbExceptionHandler();                              /* TLB exception handler */
 extern void         programTrapHandler();                               /* Program Trap handler */
 extern void         passUpOrDie(int exceptionType);                     /* Pass up or die */
 extern void         copyState(state_t *dest, state_t *src);             /* Copy state */
 extern int          updateCurrentProcess(state_t *exceptionState);      /* Update current process */
+extern void         chargeEntryTime(state_t *exceptionState);           /* Charge time since dispatch */
 extern void         updateProcessTime();                                /* Update process time */
+extern void         chargeBlockedTime(pcb_PTR p, cpu_t currentTOD);     /* Credit soft-blocked time */
 
 /***************************************************************/
 
@@ -0,0 +1,25 @@
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+/******************************* flashLog.h *************************************
+ *
+ * This header file contains the declarations for the flash logs, which
+ * remap the user blocks of each flash device onto a log written in order.
+ * It establishes the interface for the flashLog.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/deviceSupportDMA.h"
+
+/* Function Declarations */
+extern void         initFlashLogs();                                    /* Recover the log of every device that can hold one */
+extern int          flashLogged(int flashNum, int block);               /* Check if a block lives in its device's log */
+extern int          logReservedBlock(int flashNum, int block);          /* Check if a block is a log's spare or checkpoint */
+extern int          logTransfer(int operation, int flashNum, int block, memaddr bufferAddr, int asid); /* Read or append a logged block */
+extern void         cleanFlashLogs();                                   /* Clean segments and checkpoint every log */
+extern void         syncFlashLogs();                                    /* Checkpoint every changed log */
+
+#endif /* FLASHLOG_H */
@@ -0,0 +1,23 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+/******************************* futex.h ***********************************
+ *
+ * This header file contains the declarations for the futex wait table
+ * U-procs block on when a lock word in their memory is contended.
+ * It establishes the interface for the futex.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void             initFutexes();                                          /* Empty the futex wait table */
+extern int              futexWaitSyscallHandler(support_PTR supportStruct);     /* Handles SYS46 (FUTEXWAIT) */
+extern int              futexWakeSyscallHandler(support_PTR supportStruct);     /* Handles SYS47 (FUTEXWAKE) */
+
+#endif /* FUTEX_H */
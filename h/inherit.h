@@ -0,0 +1,27 @@
+#ifndef INHERIT_H
+#define INHERIT_H
+
+/******************************* inherit.h *************************************
+ *
+ * This header file contains the declarations for the priority-inheriting
+ * mutexes.
+ * It establishes the interface for the inherit.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         initMutexes();                                      /* Empty the mutex owner table */
+extern int          makeMutex(int *semAdd);                             /* Make a semaphore a priority-inheriting mutex */
+extern void         mutexAcquired(int *semAdd, pcb_PTR p);              /* Record a P on a mutex */
+extern void         mutexReleased(int *semAdd, pcb_PTR woken);          /* Record a V on a mutex */
+extern void         mutexOwnerGone(pcb_PTR p);                          /* Forget a terminated owner */
+extern int          ownsContendedMutex(pcb_PTR p);                      /* Check if anyone waits on a mutex a process holds */
+
+#endif /* INHERIT_H */
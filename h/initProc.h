@@ -20,5 +20,6 @@ extern int deviceMutex[DEVICE_COUNT];       /* Semaphores for device mutual excl
 
 /* Function Declarations */
 extern void             test();             /* Test function to be called by the initital.c */
+extern void             initExceptContexts(support_PTR supportStruct, memaddr tlbStack, memaddr genStack); /* Point exception contexts at the handlers */
 
 #endif /* INITPROC_H */
\ No newline at end of file
@@ -17,17 +17,34 @@
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
 #include "../h/initProc.h"          /* For test() */
+#include "../h/trace.h"
+#include "../h/slab.h"
+#include "../h/memOps.h"
+#include "../h/spinlock.h"
+#include "../h/timer.h"
+#include "../h/profiler.h"
+#include "../h/contention.h"
+#include "../h/inherit.h"
+#include "../h/deviceStats.h"
+#include "../h/resourceGroup.h"
 
 /* Global Variables */
 extern int          processCount;                       /* Number of processes in system */
 extern int          softBlockCount;                     /* Number of blocked processes */
-extern pcb_PTR      readyQueueHigh;                     /* Ready queue (High Priority) */
-extern pcb_PTR      readyQueueLow;                      /* Ready queue (Low Priority) */
-extern pcb_PTR      currentProcess;                     /* Currently executing process */
+extern pcb_PTR      readyQueueHigh;                     /* Ready queue (High Priority, phases 2-4) */
+extern pcb_PTR      readyQueueLow;                      /* Ready queue (Low Priority, phases 2-4) */
+extern readyQueue_t readyQueues[MAXCPUS];               /* MLFQ ready queues of each processor */
+extern pcb_PTR      cpuProcess[MAXCPUS];                /* Process each processor executes */
 extern int          deviceSemaphores[DEVICE_COUNT];     /* Array of device semaphores */
-extern cpu_t        startTOD;                           /* Time of day at system start */
+extern cpu_t        cpuStartTOD[MAXCPUS];               /* Time of day each processor's process was charged up to */
+extern cpu_t        bootTOD[BOOTPHASES];                /* Time of day each boot phase ended (0 until it does) */
+
+/* The executing processor's entries */
+#define currentProcess      (cpuProcess[CPUID()])       /* Currently executing process */
+#define startTOD            (cpuStartTOD[CPUID()])      /* Time of day the current process was charged up to */
 
 /* Function Declarations */
 void                main();
+extern void         markBootPhase(int phase);           /* Stamp the end of a boot phase (the first time only) */
 
 #endif /* INITIAL_H */
\ No newline at end of file
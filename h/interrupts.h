@@ -16,8 +16,21 @@
 #include "../h/scheduler.h"
 #include "../h/exceptions.h"
 
+/* Global Variables */
+extern devDesc_t        deviceTable[DEVDESCCOUNT];  /* Per-device registers, semaphores and mutexes */
+
+/* Device Descriptor Lookup */
+#define DEVDESC(L, D)           (&deviceTable[DEVINDEX(L, D)])      /* Descriptor of device D on line L */
+#define TERMRECVDESC(D)         (&deviceTable[TERMRECVINDEX(D)])    /* Descriptor of terminal D's receiver */
+
 /* Function Declarations */
+extern void             initDeviceTable();          /* Precompute the device descriptors */
+extern void             routeInterrupts();          /* Program the Interrupt Routing Table */
+extern unsigned int     cpuInterruptCount(int cpu, int line); /* Interrupts a processor took on a line */
 extern void             interruptHandler();         /* Interrupt handler */
+extern void             armPseudoClock();           /* Arm the next pseudo-clock tick */
+extern void             armTimerTick(unsigned int tick);    /* Arm the interval timer for a given tick */
+extern void             armTimerAt(cpu_t fireTOD);          /* Arm the interval timer for a given TOD */
 
 /***************************************************************/
 
@@ -0,0 +1,25 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+/******************************* mailbox.h *********************************
+ *
+ * This header file contains the declarations for the per-ASID mailboxes
+ * U-procs pass messages through.
+ * It establishes the interface for the mailbox.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void             initMailboxes();                                        /* Empty every mailbox */
+extern void             closeMailbox(int asid);                                 /* Drop a terminating U-proc's mail */
+extern void             openMailbox(int asid);                                  /* Reopen a mailbox for a clone */
+extern int              msgSendSyscallHandler(support_PTR supportStruct);       /* Handles SYS36 (MSGSEND) */
+extern int              msgReceiveSyscallHandler(support_PTR supportStruct);    /* Handles SYS37 (MSGRECEIVE) */
+
+#endif /* MAILBOX_H */
@@ -0,0 +1,24 @@
+#ifndef MEMOPS_H
+#define MEMOPS_H
+
+/******************************* memOps.h *************************************
+ *
+ * This header file contains the declarations for the word copy and fill
+ * routines shared by the nucleus and the Support Level.
+ * It establishes the interface for the memOps.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         copyWords(unsigned int *dest, unsigned int *src, int words);        /* Copy words */
+extern void         setWords(unsigned int *dest, unsigned int value, int words);        /* Fill words with a value */
+extern void         copyPage(unsigned int *dest, unsigned int *src);                    /* Copy a page */
+extern void         zeroPage(unsigned int *dest);                                       /* Zero a page */
+
+#endif /* MEMOPS_H */
@@ -0,0 +1,24 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+/******************************* network.h *********************************
+ *
+ * This header file contains the declarations for the network driver,
+ * which moves packets between the NICs and U-procs through frames.
+ * It establishes the interface for the network.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void             initNetwork();                                          /* Post the receive rings, launch the NIC daemons */
+extern int              netSendSyscallHandler(support_PTR supportStruct);       /* Handles SYS54 (NETSEND) */
+extern int              netRecvSyscallHandler(support_PTR supportStruct);       /* Handles SYS55 (NETRECV) */
+extern int              netPacketReady(int nicNum);                             /* Check if SYS55 would not block */
+
+#endif /* NETWORK_H */
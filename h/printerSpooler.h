@@ -0,0 +1,22 @@
+#ifndef PRINTERSPOOLER_H
+#define PRINTERSPOOLER_H
+
+/******************************* printerSpooler.h ****************************
+ *
+ * This header file contains the declarations for the printer spools and
+ * their spool daemons.
+ * It establishes the interface for the printerSpooler.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+
+/* Function Declarations */
+extern void             initPrinters();                                                 /* Empty the spools, launch the daemons */
+extern int              spoolPrinterOutput(int printNum, char *charAddress, int length); /* Spool a SYS11 string */
+extern void             drainPrinters();                                                /* Wait for all spooled output */
+
+#endif /* PRINTERSPOOLER_H */
@@ -0,0 +1,28 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/******************************* profiler.h *************************************
+ *
+ * This header file contains the declarations for the PLT-driven sampling
+ * profiler of U-proc program counters.
+ * It establishes the interface for the profiler.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         initProfiler();                                     /* Stop and empty every profile */
+extern int          startProfile(int asid, unsigned int interval);      /* Empty and start an ASID's profile */
+extern void         stopProfile(int asid);                              /* Stop an ASID's profile */
+extern int          readProfile(int asid, profHist_PTR buffer);         /* Copy out an ASID's profile */
+extern void         profileSample(pcb_PTR p);                           /* Record the PC of a process */
+extern unsigned int profileTimer(unsigned int quantum);                 /* PLT value for a quantum */
+extern unsigned int profileBanked();                                    /* Take back quantum held past the PLT */
+
+#endif /* PROFILER_H */
@@ -0,0 +1,24 @@
+#ifndef REAPER_H
+#define REAPER_H
+
+/******************************* reaper.h **********************************
+ *
+ * This header file contains the declarations for the exit records of
+ * terminated U-procs and the SYSCALL that reaps them.
+ * It establishes the interface for the reaper.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void             initReaper();                                           /* Empty the exit record queue */
+extern void             recordExit(int asid, int reason);                       /* Queue the exit record of the current U-proc */
+extern int              readExit(int asid, exitRecord_PTR buffer);              /* Copy out an ASID's last exit record */
+extern int              reapSyscallHandler(support_PTR supportStruct);          /* Handles SYS44 (REAP) */
+
+#endif /* REAPER_H */
@@ -0,0 +1,30 @@
+#ifndef RESOURCEGROUP_H
+#define RESOURCEGROUP_H
+
+/******************************* resourceGroup.h *************************************
+ *
+ * This header file contains the declarations for the resource groups,
+ * which bound the CPU share, resident frames and I/O weight of U-procs.
+ * It establishes the interface for the resourceGroup.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         initResourceGroups();                               /* Empty every group */
+extern void         joinGroup(int asid, int group);                     /* Put a new U-proc in a group */
+extern void         leaveGroup(int asid);                               /* Take a terminated U-proc out of its group */
+extern int          groupOf(int asid);                                  /* Group of an ASID (NOGROUP if none) */
+extern int          groupTickets(int asid, int tickets);                /* Stride tickets scaled by the group's CPU share */
+extern int          groupFrameLimit(int asid);                          /* Resident frame limit of an ASID's group */
+extern int          groupIOWeight(int asid);                            /* I/O weight of an ASID's group */
+extern int          chargeGroup(pcb_PTR p);                             /* Charge CPU time, tell if the group is over its share */
+extern int          readGroupStats(int group, groupStat_PTR buffer);    /* Copy out a group's limits and usage */
+
+#endif /* RESOURCEGROUP_H */
@@ -17,9 +17,21 @@
 #include "../h/exceptions.h"
 #include "../h/interrupts.h"
 
+/* Global Variables */
+extern memaddr      cpuTimePage[MAXCPUS];                                       /* Frame of each processor's U-proc time page (NOFRAME if none) */
+
+/* The executing processor's time page */
+#define timePage            (cpuTimePage[CPUID()])
+
 /* Function Declarations */
+extern void         initScheduler();                                            /* Initialize scheduler state */
 extern void         scheduler();                                                /* Scheduler */ 
 extern void         loadProcessState(state_t *state, unsigned int quantum);     /* Load process state */
 extern pcb_PTR      getProcess(pcb_PTR process);                                /* Get process */
+extern void         insertReadyQueue(pcb_PTR p);                                /* Make a process ready at its level */
+extern void         promoteProcess(pcb_PTR p);                                  /* Credit an early exit */
+extern void         demoteProcess(pcb_PTR p);                                   /* Demote after quantum expiry */
+extern void         handoffProcess(pcb_PTR target, unsigned int quantum);       /* Switch directly to a woken process */
+extern void         expeditePageIn(pcb_PTR p);                                  /* Run a page-in holding up a mutex next */
 
 #endif /* SCHEDULER_H */
\ No newline at end of file
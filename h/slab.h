@@ -0,0 +1,27 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+/******************************* slab.h **************************************
+ *
+ * This header file contains the declarations for the kernel frame allocator
+ * that grows the PCB and semaphore descriptor pools, and the size-class
+ * object caches built on it.
+ * It establishes the interface for the slab.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/const.h"
+#include "../h/types.h"
+#include "../h/spinlock.h"
+
+/* Function Declarations */
+extern void         initSlab();                 /* Mark the free kernel frames */
+extern memaddr      allocSlabFrame();           /* Take one kernel frame (NOFRAME if none) */
+extern memaddr      kmemAlloc(int size);        /* Allocate a kernel object (NOFRAME if none) */
+extern void         kmemFree(memaddr object);   /* Free an object from kmemAlloc */
+extern int          kmemCacheStats(int sizeClass, kmemStat_PTR stats); /* Copy out one cache's statistics */
+
+#endif /* SLAB_H */
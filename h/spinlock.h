@@ -0,0 +1,25 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+/******************************* spinlock.h *************************************
+ *
+ * This header file contains the declarations for the spinlocks that keep
+ * the nucleus consistent across processors.
+ * It establishes the interface for the spinlock.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Function Declarations */
+extern void         acquireSpin(volatile unsigned int *lock);                  /* Spin until a lock is taken */
+extern void         releaseSpin(volatile unsigned int *lock);                  /* Release a lock */
+extern void         acquireKernel();                                            /* Take the nucleus lock on kernel entry */
+extern void         releaseKernel();                                            /* Release it before leaving the nucleus */
+
+#endif /* SPINLOCK_H */
@@ -0,0 +1,24 @@
+#ifndef TERMINALDAEMON_H
+#define TERMINALDAEMON_H
+
+/******************************* terminalDaemon.h ****************************
+ *
+ * This header file contains the declarations for the buffered terminal
+ * output and type-ahead input rings and their daemons.
+ * It establishes the interface for the terminalDaemon.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+
+/* Function Declarations */
+extern void             initTerminals();                                                /* Empty the rings, launch the writers */
+extern int              bufferTerminalOutput(int termNum, char *charAddress, int length); /* Buffer a SYS12 string */
+extern int              readBufferedLine(int termNum, char *charAddress);               /* Copy a buffered line for SYS13 */
+extern int              terminalInputReady(int termNum);                                /* Check if SYS13 would not block */
+extern void             drainTerminals();                                               /* Wait for all buffered output */
+
+#endif /* TERMINALDAEMON_H */
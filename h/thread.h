@@ -0,0 +1,27 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+/******************************* thread.h **********************************
+ *
+ * This header file contains the declarations for the threads a U-proc
+ * runs in its own address space beside its main one.
+ * It establishes the interface for the thread.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/vmSupport.h"
+
+/* Function Declarations */
+extern void             initThreads();                                          /* Free every thread slot */
+extern int              threadCreateSyscallHandler(support_PTR supportStruct);  /* Handles SYS49 (THREADCREATE) */
+extern int              threadJoinSyscallHandler(support_PTR supportStruct);    /* Handles SYS50 (THREADJOIN) */
+extern int              threadExitSyscallHandler(support_PTR supportStruct);    /* Handles SYS51 (THREADEXIT) */
+extern void             exitThread(support_PTR supportStruct, int value);       /* End the calling thread */
+extern void             waitForThreads(int asid);                               /* Wait until a U-proc's threads have ended */
+extern int              liveThreads(int asid);                                  /* Count a U-proc's threads still running */
+
+#endif /* THREAD_H */
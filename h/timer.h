@@ -0,0 +1,29 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/******************************* timer.h *************************************
+ *
+ * This header file contains the declarations for the nucleus timer wheel
+ * behind the WAITUNTIL call.
+ * It establishes the interface for the timer.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/asl.h"
+#include "../h/initial.h"
+#include "../h/scheduler.h"
+#include "../h/exceptions.h"
+
+/* Function Declarations */
+extern void         initTimers();                               /* Empty the timer wheel */
+extern void         insertTimer(pcb_PTR p, cpu_t deadline);     /* Put a process on the wheel */
+extern void         removeTimer(pcb_PTR p);                     /* Take a process off the wheel */
+extern void         expireTimers(cpu_t currentTOD);             /* Wake every process whose deadline passed */
+extern unsigned int nextTimerTick();                            /* Tick of the next occupied slot (0 if none) */
+extern cpu_t        nextTimerDeadline();                        /* Earliest deadline due on that tick (0 if none) */
+
+#endif /* TIMER_H */
@@ -0,0 +1,35 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/******************************* trace.h *************************************
+ *
+ * This header file contains the declarations for the scheduler event trace
+ * and the interrupt latency histograms.
+ * It establishes the interface for the trace.c module.
+ * 
+ * Written by Aryah Rao and Anish Reddy
+ * 
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "/usr/include/umps3/umps/libumps.h"
+#include "../h/const.h"
+#include "../h/types.h"
+
+/* Global Variables */
+extern perfBlock_t  perfBlocks[PERFBLOCKS];                             /* Performance counter blocks */
+
+/* Function Declarations */
+extern void         initTrace();                                        /* Empty the trace ring */
+extern void         traceEvent(int type, pcb_PTR p, int *semAdd);       /* Record a scheduler event */
+extern int          drainTrace(traceEvent_PTR buffer, int maxEvents);   /* Copy out and remove events */
+extern void         recordWakeLatency(pcb_PTR p, int line, cpu_t irqTOD, cpu_t wakeTOD); /* Stamp an interrupt wake-up */
+extern void         recordRunLatency(pcb_PTR p, cpu_t runTOD);          /* Close a wake-up at dispatch */
+extern int          readLatency(int line, latencyHist_PTR buffer);      /* Copy out one line's histograms */
+extern void         perfCount(int counter, int asid);                   /* Count one event */
+extern void         perfCountSyscall(int number, int asid);             /* Count one SYSCALL by number */
+extern void         perfDispatch(pcb_PTR p);                            /* Count a context switch */
+extern int          readPerf(int asid, perfBlock_PTR buffer);           /* Copy out one counter block */
+extern int          processASID(pcb_PTR p);                             /* ASID of a process (0 if kernel) */
+
+#endif /* TRACE_H */
@@ -0,0 +1,24 @@
+#ifndef TRACESINK_H
+#define TRACESINK_H
+
+/******************************* traceSink.h *************************************
+ *
+ * This header file contains the declarations for the binary trace sink,
+ * which streams fixed-size trace records to a flash device of their own.
+ * It establishes the interface for the traceSink.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/deviceSupportDMA.h"
+#include "../h/spinlock.h"
+
+/* Function Declarations */
+extern void         initTraceSink();                                    /* Claim a flash device and launch the trace writer */
+extern void         traceRecord(int kind, unsigned int event, int asid, unsigned int arg); /* Append one trace record */
+extern int          traceSinkDevice(int flashNum);                      /* Check if a flash device holds the trace */
+extern void         syncTraceSink();                                    /* Write out the buffered records and stop */
+
+#endif /* TRACESINK_H */
@@ -31,6 +31,24 @@ typedef struct {
 #define t_transm_command	d_data1
 
 
+/* Device Descriptor: everything the interrupt path and drivers need for
+ * one device (terminal receivers get their own descriptor) */
+typedef struct devDesc_t {
+	device_t 				*dd_reg;		/* Device register block */
+	int 					*dd_sem;		/* Nucleus device semaphore */
+	int 					*dd_mutex;		/* Support Level device mutex (set by the Support Level) */
+} devDesc_t, *devDesc_PTR;
+
+/* A device completion acknowledged by the interrupt top half and waiting
+ * for its bottom half (interrupts.c) */
+typedef struct deferred_t {
+	int 					df_index;		/* Device semaphore index */
+	unsigned int 			df_status;		/* Status read before the ACK */
+	int 					df_line;		/* Interrupt line */
+	cpu_t 					df_tod;			/* TOD of the interrupt entry (latency stamp) */
+} deferred_t, *deferred_PTR;
+
+
 /* Bus Register Area */
 typedef struct {
 	unsigned int 			rambase;
@@ -95,9 +113,248 @@ typedef struct support_t {
 	struct support_t 		*sup_next; 				/* Pointer to next support structure */
 	unsigned int 			sup_textSize; 			/* Text size */
     int                     sup_privateSem;         /* Private semaphore for delay facility */
+    int                     sup_textPages;          /* Leading image pages that hold only text */
+    unsigned int            sup_textPrint[MAXPAGES];/* Fingerprint of each of those pages */
+    unsigned int            sup_faultCount;         /* Page faults taken */
+    cpu_t                   sup_lastFault;          /* TOD of the last page fault */
+    cpu_t                   sup_faultGap;           /* Smoothed time between page faults */
+    int                     sup_rssLimit;           /* Resident-set limit set by the fault-frequency controller */
+    int                     sup_recentPages[RECENTPAGES]; /* Pages touched last, preloaded into the TLB on dispatch */
+    int                     sup_recentNext;         /* Next slot of sup_recentPages to overwrite */
+    pageTableEntry_PTR      sup_stackTable;         /* Second-level table of stack extension pages (or NULL) */
+    struct support_t        *sup_space;             /* Support structure holding the address space (a thread's U-proc's) */
+    int                     sup_thread;             /* Thread slot, or NOTHREAD for a U-proc's main thread */
+    int                     *sup_faultMutex;        /* Mutex the page-in under way takes back after its I/O (or NULL) */
 } support_t, *support_PTR;
 
 
+/* Thread Slot: a U-proc thread beyond the main one (SYS49-51) */
+typedef struct thread_t {
+	int 					th_state;				/* THREADFREE, THREADRUNNING or THREADEXITED */
+	int 					th_asid;				/* ASID of the U-proc it belongs to */
+	int 					th_value;				/* Exit value passed to SYS51 (ERROR after a trap) */
+	int 					th_joinSem;				/* Semaphore V'd when it exits */
+} thread_t, *thread_PTR;
+
+
+/* Backing Store Region of one U-proc: its image starts at block ui_base,
+ * its shadow and stack extension blocks end the region */
+typedef struct uprocImage_t {
+	int 					ui_flash;				/* Flash device */
+	int 					ui_base;				/* First block of the region */
+	int 					ui_blocks;				/* Blocks in the region (TODEVEND: to the end of the device) */
+} uprocImage_t, *uprocImage_PTR;
+
+
+/* Exit Record of a terminated U-proc (queued for SYS44) */
+typedef struct exitRecord_t {
+	int 					er_asid;				/* ASID that exited */
+	int 					er_reason;				/* EXITSYS9 or EXITTRAP */
+	cpu_t 					er_cpuTime;				/* CPU time used (us) */
+	unsigned int 			er_faults;				/* Page faults taken */
+	unsigned int 			er_ioCount;				/* Device operations it waited for */
+} exitRecord_t, *exitRecord_PTR;
+
+
+/* Futex Wait Table Entry (free while no one waits) */
+typedef struct futex_t {
+	int 					fx_space;				/* Key space: the ASID, or FUTEXSHARED + segment */
+	memaddr 				fx_addr;				/* Key address: the user word's virtual address */
+	int 					fx_sem;					/* Semaphore the waiters block on (minus the waiters) */
+} futex_t, *futex_PTR;
+
+
+/* Flash Log Checkpoint (block LOGCKPT or LOGCKPT + 1 of a logged flash device) */
+typedef struct flashLogCkpt_t {
+	unsigned int 			lc_magic;				/* LOGMAGIC */
+	unsigned int 			lc_seq;					/* Checkpoint number (the higher valid one wins) */
+	short 					lc_map[FLASHLOGBLOCKS];	/* Log slot of each logical block */
+	unsigned int 			lc_sum;					/* Checksum of the above */
+} flashLogCkpt_t, *flashLogCkpt_PTR;
+
+
+/* Checkpoint Header (sector CKPTSECTOR(asid) of disk CKPTDISK); the pages follow it in ck_page order */
+typedef struct ckptHeader_t {
+	unsigned int 			ck_magic;				/* CKPTMAGIC */
+	int 					ck_asid;				/* ASID it was taken of */
+	uprocImage_t 			ck_image;				/* Region the U-proc ran from (must match at boot) */
+	state_t 				ck_state;				/* State to resume, just past its SYS61 */
+	int 					ck_pages;				/* Pages saved */
+	int 					ck_hot;					/* How many of them, first, were resident */
+	unsigned char 			ck_page[CKPTPAGES];		/* Page number of each */
+	unsigned int 			ck_sum;					/* Checksum of the above */
+} ckptHeader_t, *ckptHeader_PTR;
+
+
+/* U-proc Boot Configuration (sector CONFIGSECTOR of disk CONFIGDISK) */
+typedef struct uprocConfig_t {
+	unsigned int 			uc_magic;				/* CONFIGMAGIC */
+	int 					uc_count;				/* U-procs to create (ASIDs 1..uc_count) */
+	uprocImage_t 			uc_image[MAXUPROC];		/* Backing store of each, indexed by ASID - 1 */
+} uprocConfig_t, *uprocConfig_PTR;
+
+
+/* Pending Disk or Flash Request (on the requesting caller's stack) */
+typedef struct diskRequest_t {
+	int 					dr_cylinder;			/* Cylinder the request will seek to (0 on flash) */
+	int 					dr_asid;				/* ASID its transfer is charged to */
+	int 					dr_sem;					/* Private semaphore signalled when the device is granted */
+	cpu_t 					dr_queued;				/* TOD it was queued at */
+	struct diskRequest_t 	*dr_next;				/* Next request queued on the device */
+} diskRequest_t, *diskRequest_PTR;
+
+
+/* One Sector of a Vectored Disk Syscall (SYS24/SYS25) */
+typedef struct diskIOVec_t {
+	memaddr 				iov_base;				/* User page to copy from/to */
+	int 					iov_sector;				/* Linear sector on the disk */
+} diskIOVec_t, *diskIOVec_PTR;
+
+
+/* Time Page (read-only in every U-proc at UTIMEPAGE); tp_sequence is odd
+ * while the nucleus rewrites it, so a reader retries until it reads the
+ * same even value before and after */
+typedef struct timePage_t {
+	unsigned int 			tp_sequence;			/* Bumped before and after each update */
+	cpu_t 					tp_tod;					/* TOD of the last dispatch */
+	unsigned int 			tp_ticks;				/* Pseudo-clock ticks since boot (tp_tod / CLOCKINTERVAL) */
+	cpu_t 					tp_cpuTime;				/* p_time of the process dispatched */
+} timePage_t, *timePage_PTR;
+
+
+/* One Call of a Batched Syscall (SYS31) */
+typedef struct batchRecord_t {
+	int 					br_number;				/* Support Level SYSCALL number */
+	int 					br_a1;					/* Its arguments */
+	int 					br_a2;
+	int 					br_a3;
+	int 					br_result;				/* Its v0, written back */
+} batchRecord_t, *batchRecord_PTR;
+
+
+/* Support Level SYSCALL Table Entry: the service and the user buffer it
+ * takes, which dispatchSyscall validates before calling it */
+typedef struct sysEntry_t {
+	int 					(*se_handler)(support_PTR);	/* Service (unusedSyscall if the number has none) */
+	int 					se_buffer;				/* Argument (1-3) holding a user buffer address (NOARG if none) */
+	int 					se_count;				/* Argument holding its element count (NOARG for one element) */
+	int 					se_size;				/* Bytes per element */
+	int 					se_minCount;			/* Fewest elements allowed */
+	int 					se_maxCount;			/* Most elements allowed */
+} sysEntry_t, *sysEntry_PTR;
+
+
+/* Call Statistics of one Support Level SYSCALL number (returned by SYS40) */
+typedef struct sysStat_t {
+	unsigned int 			ss_calls;				/* Calls handled */
+	cpu_t 					ss_totalTime;			/* Trap to return, summed (us) */
+	cpu_t 					ss_maxTime;				/* Longest call (us) */
+} sysStat_t, *sysStat_PTR;
+
+
+/* Boot Phase Times (returned by SYS56): the TOD each phase ended at, 0 if not reached */
+typedef struct bootTimes_t {
+	cpu_t 					bt_phase[BOOTPHASES];	/* Indexed by BOOTPASSUP..BOOTTEXTPRINTS */
+} bootTimes_t, *bootTimes_PTR;
+
+
+/* An ASID's I/O Share (returned by SYS57), summed over the disks and flash devices */
+typedef struct ioShare_t {
+	int 					is_weight;				/* Its weight in the deficit round robin */
+	int 					is_grants;				/* Requests granted a device */
+	int 					is_blocks;				/* Sectors and blocks transferred */
+	cpu_t 					is_waitTime;			/* Time its requests spent queued */
+} ioShare_t, *ioShare_PTR;
+
+
+/* Resource Group Limits (one entry of the group table) */
+typedef struct resourceGroup_t {
+	int 					rg_cpuShare;			/* Percent of each GROUPPERIOD's CPU time its members get at their own level */
+	int 					rg_maxFrames;			/* Most swap pool frames its members hold together (RGNOLIMIT: any) */
+	int 					rg_ioWeight;			/* I/O weight its members start with, and the most they may set */
+} resourceGroup_t, *resourceGroup_PTR;
+
+
+/* Resource Group Usage (returned by SYS58) */
+typedef struct groupStat_t {
+	resourceGroup_t 		gs_limits;				/* The group's limits */
+	int 					gs_members;				/* Live U-procs in it */
+	int 					gs_resident;			/* Swap pool frames they hold */
+	int 					gs_ioBlocks;			/* Sectors and blocks they moved (live members only) */
+	int 					gs_throttled;			/* Times a member was made ready over the group's CPU share */
+	cpu_t 					gs_cpuTime;				/* CPU time charged to it since boot */
+	cpu_t 					gs_periodTime;			/* CPU time charged to it in the current GROUPPERIOD */
+} groupStat_t, *groupStat_PTR;
+
+
+/* Block Cache Entry (its data lives in the frame BCACHE_ADDR(index)) */
+typedef struct cacheBlock_t {
+	int 					cb_line;				/* DISKINT or FLASHINT */
+	int 					cb_dev;					/* Device number on the line */
+	int 					cb_block;				/* Sector/block held (NOBLOCK if empty) */
+	int 					cb_dirty;				/* Written since last reaching the device */
+	int 					cb_asid;				/* ASID charged for its write-back (the last writer) */
+	cpu_t 					cb_lastUse;				/* TOD of the last hit or fill (LRU) */
+	int 					cb_fill;				/* Read-ahead state (NOFILL, FILLQUEUED, FILLRUNNING) */
+	int 					cb_waiters;				/* Requests waiting for a running fill */
+} cacheBlock_t, *cacheBlock_PTR;
+
+
+/* Asynchronous I/O Control Block (in the U-proc's address space, SYS26/SYS27) */
+typedef struct aiocb_t {
+	int 					aio_line;				/* DISKINT or FLASHINT */
+	int 					aio_write;				/* TRUE to write the buffer to the device */
+	int 					aio_dev;				/* Device number on the line */
+	int 					aio_block;				/* Sector (disk) or block (flash) number */
+	memaddr 				aio_buffer;				/* User page to transfer */
+	int 					aio_status;				/* AIOPENDING until done, then READY or the error */
+} aiocb_t, *aiocb_PTR;
+
+
+/* Asynchronous I/O Request Queued to the Workers */
+typedef struct aioRequest_t {
+	int 					ar_asid;				/* Submitting ASID (UNOCCUPIED if the slot is free) */
+	memaddr 				ar_cb;					/* User address of the control block */
+	aiocb_t 				ar_cbCopy;				/* The control block as submitted */
+	int 					ar_dataFrame;			/* Pinned frame of the buffer */
+	int 					ar_cbFrame;				/* Pinned frame of the control block */
+	int 					*ar_status;				/* Physical address of the control block's aio_status */
+	int 					ar_done;				/* Request finished */
+	int 					ar_doneSem;				/* Waiters in SYS27 block here */
+	int 					ar_waiters;				/* Number of them */
+	int 					*ar_notify;				/* Kernel caller's semaphore (NULL for SYS26 requests) */
+	int 					ar_prefetch;			/* Block cache entry a read-ahead fills (NOBLOCK if none) */
+	struct aioRequest_t 	*ar_next;				/* Next request in the work queue or free list */
+} aioRequest_t, *aioRequest_PTR;
+
+
+/* Wait-Any Event (in the U-proc's address space, an array for SYS53) */
+typedef struct waitEvent_t {
+	int 					we_kind;				/* WAITAIO, WAITSEM, WAITTERM or WAITNET */
+	int 					we_handle;				/* aiocb_t address, named semaphore ID, terminal or NIC number */
+} waitEvent_t, *waitEvent_PTR;
+
+
+/* Wait-Any Waiter: a U-proc or thread blocked in SYS53 */
+typedef struct waiter_t {
+	int 					wt_asid;				/* ASID of the caller (UNOCCUPIED if the slot is free) */
+	int 					wt_sem;					/* It sleeps here; any event it watches V's it */
+	int 					wt_count;				/* Events watched */
+	waitEvent_t 			wt_events[WAITANYMAX];	/* The events, copied from the caller */
+} waiter_t, *waiter_PTR;
+
+
+/* Kernel Object Cache Statistics: one size class of kmemAlloc */
+typedef struct kmemStat_t {
+	unsigned int 			ks_size;				/* Object size of the class (bytes) */
+	unsigned int 			ks_frames;				/* Slab frames the class holds */
+	unsigned int 			ks_inUse;				/* Objects allocated and not yet freed */
+	unsigned int 			ks_free;				/* Objects free in its frames */
+	unsigned int 			ks_allocs;				/* kmemAlloc calls served */
+	unsigned int 			ks_failures;			/* kmemAlloc calls that found no frame */
+} kmemStat_t, *kmemStat_PTR;
+
+
 /* Swap Pool Data Structure */
 typedef struct swapPoolEntry_t {
     int 					asid;                  	/* ASID */
@@ -105,11 +362,40 @@ typedef struct swapPoolEntry_t {
     int 					valid;                 	/* Entry validity flag */
     pageTableEntry_PTR 		pte;    				/* Pointer to page table entry */
 	int 					dirty;                	/* Dirty flag */
+	int 					referenced;				/* Set by a TLB refill since the clock hand last passed */
+	int 					nextFrame;				/* Next frame on the free stack or the owner's list */
+	int 					prevFrame;				/* Previous frame on the owner's list */
+	unsigned int 			sharers;				/* Bit per ASID mapping the frame (the owner included) */
+	int 					refCount;				/* Number of ASIDs mapping the frame */
+	int 					busy;					/* I/O on the frame is running without the swap pool mutex */
+	int 					wbAsid;					/* ASID of the old page a busy frame is writing back (or UNOCCUPIED) */
+	int 					wbVpn;					/* Page number of that old page */
+	unsigned int 			wbSharers;				/* Copy-on-write sharers (bit per ASID) it is also written back for */
+	int 					zeroed;					/* A free frame already holds zeros (set while idle) */
+	unsigned int 			wiredBy;				/* Bit per ASID keeping the frame resident with SYS45 */
 } swapPoolEntry_t, *swapPoolEntry_PTR;
 
 
-/* Process Control Block */
+/* Shared Memory Segment: the same pages of every attached ASID's page
+ * table, kept in frames shared through the sharer mask above, and backed
+ * by SHMFLASH or (a disk-mapped region, SYS52) by a range of disk sectors */
+typedef struct shmSegment_t {
+	int 					sh_basePage;			/* First page number (the same in every ASID) */
+	int 					sh_pages;				/* Pages in the segment (0 if not created) */
+	unsigned int 			sh_attached;			/* Bit per attached ASID */
+	unsigned int 			sh_zeroFill;			/* Pages with no backing store copy yet (bit per page) */
+	int 					sh_disk;				/* Disk backing a disk-mapped region (NODISKMAP for SHMFLASH) */
+	int 					sh_sector;				/* Its first sector (page i at sh_sector + i) */
+} shmSegment_t, *shmSegment_PTR;
+
+
+/* Process Control Block
+ * Fields read by queue, tree, ASL and timer wheel walks come first, packed
+ * together; the saved state and accounting follow. p_next and p_prev must
+ * stay first: the ASL keeps its free descriptors on a PCB queue. */
 typedef struct pcb_t{
+	/* ---------------- hot: queue, tree and scheduling fields ---------------- */
+
 	/* process queue fields */
 	struct pcb_t 			*p_next;
 	struct pcb_t 			*p_prev;
@@ -120,20 +406,64 @@ typedef struct pcb_t{
 	struct pcb_t 			*p_next_sib;
 	struct pcb_t 			*p_prev_sib;
 
+	/* blocking information */
+	int 					*p_semAdd;
+	struct semd_t 			*p_semd;				/* ASL descriptor whose queue holds this PCB (NULL if none) */
+	cpu_t 					p_time;
+
+	/* MLFQ fields */
+	int 					priority;
+	int 					earlyExits;
+	int 					p_readyLevel;			/* Ready queue level holding this PCB (NOTREADY if none) */
+	int 					p_basePriority;			/* Own level while a mutex waiter boosts it (NOBOOST if not) */
+	int 					p_readyCPU;				/* Processor whose ready queue holds this PCB (with p_readyLevel) */
+	int 					p_lastCPU;				/* Processor it last ran on (where it is queued when woken) */
+	int 					p_killed;				/* Terminated while running on another processor, which reaps it */
+
+	/* Stride scheduling fields */
+	int 					p_tickets;				/* CPU share weight */
+	unsigned int 			p_pass;					/* Virtual time: CPU time charged per ticket */
+	cpu_t 					p_passTime;				/* p_time already charged to p_pass */
+
+	/* Resource group fields */
+	cpu_t 					p_groupTime;			/* p_time already charged to its resource group */
+
+	/* Timer wheel fields */
+	struct pcb_t 			*p_timerNext;			/* Next process in the same wheel slot */
+	struct pcb_t 			*p_timerPrev;			/* Previous process in the same wheel slot */
+	int 					p_timerSlot;			/* Wheel slot holding this PCB (NOSLOT if none) */
+	cpu_t 					p_deadline;				/* TOD the process is waiting for */
+
+	/* ---------------- cold: saved state and accounting ---------------- */
+
 	/* process state information */
 	state_t 				p_s;
-	cpu_t 					p_time;
-	int 					*p_semAdd;
 
 	/* support layer information */
 	support_t 				*p_supportStruct;
 
-	/* MLFQ fields */
-	int 					priority;
-	int 					earlyExits;
+	/* CPU time breakdown (p_time = user + support + kernel) */
+	cpu_t 					p_userTime;				/* Time running in user mode */
+	cpu_t 					p_supportTime;			/* Time running in kernel mode outside the nucleus */
+	cpu_t 					p_kernelTime;			/* Time spent in the nucleus on its behalf */
+	cpu_t 					p_blockedTime;			/* Time spent soft-blocked on I/O or the clock */
+	cpu_t 					p_blockStart;			/* TOD when the process last blocked */
+
+	/* Interrupt-to-run latency stamps */
+	int 					p_wakeLine;				/* Line whose interrupt woke the process (NOLINE if none) */
+	cpu_t 					p_irqTOD;				/* TOD at entry of the interrupt that woke it */
+	cpu_t 					p_wakeTOD;				/* TOD of the V that woke it */
 } pcb_t, *pcb_PTR;
 
 
+/* Ready Queue (one per processor): one process queue per MLFQ level plus a non-empty bitmap */
+typedef struct readyQueue_t {
+	pcb_PTR 				rq_tail[SCHEDLEVELS];	/* Tail pointer of each level's process queue */
+	unsigned int 			rq_bitmap;				/* Bit n is set while level n is non-empty */
+	int 					rq_count;				/* Processes queued on every level */
+} readyQueue_t;
+
+
 /* Semaphore Descriptor */
 typedef struct semd_t {
     struct semd_t 			*s_next; 		/* Pointer to next semaphore descriptor */
@@ -143,9 +473,102 @@ typedef struct semd_t {
 } semd_t, *semd_PTR;
 
 
+/* CPU Time Breakdown (returned by SYS6 with a buffer and by SYS21) */
+typedef struct cpuTimes_t {
+	cpu_t 					ct_user;		/* Time running in user mode */
+	cpu_t 					ct_support;		/* Time running in the support level */
+	cpu_t 					ct_kernel;		/* Time spent in the nucleus */
+	cpu_t 					ct_blocked;		/* Time spent soft-blocked */
+} cpuTimes_t, *cpuTimes_PTR;
+
+
+/* Scheduler Trace Event */
+typedef struct traceEvent_t {
+	cpu_t 					te_tod;			/* Time of day of the event */
+	int 					te_type;		/* TRACE_DISPATCH, _PREEMPT, _BLOCK or _UNBLOCK */
+	pcb_PTR 				te_pcb;			/* Process the event is about */
+	int 					te_asid;		/* Its ASID (0 for kernel processes) */
+	int 					*te_semAdd;		/* Semaphore for block/unblock events */
+} traceEvent_t, *traceEvent_PTR;
+
+
+/* Binary Trace Record (TRACERECSIZE bytes, streamed to the trace flash device) */
+typedef struct traceRecord_t {
+	unsigned int 			tr_tod;			/* Low word of the TOD clock */
+	unsigned char 			tr_kind;		/* TRK_PAGE, _SCHED, _INTERRUPT, _PAGING or _SYSCALL */
+	unsigned char 			tr_cpu;			/* Processor that recorded it */
+	unsigned short 			tr_asid;		/* ASID (0 for kernel processes; TRACEMAGIC in a header) */
+	unsigned int 			tr_event;		/* Event within the kind */
+	unsigned int 			tr_arg;			/* Argument of the event */
+} traceRecord_t, *traceRecord_PTR;
+
+
+/* Interrupt Latency Histograms of one line (returned by SYS23) */
+typedef struct latencyHist_t {
+	unsigned int 			lh_count[LATKINDS][LATBUCKETS];	/* Indexed by LAT_* kind, then log2 bucket */
+} latencyHist_t, *latencyHist_PTR;
+
+
+/* Performance Counter Block (nucleus-wide or one ASID's, returned by SYS32) */
+typedef struct perfBlock_t {
+	unsigned int 			pb_count[PERFCOUNTS];	/* Indexed by PERF_* counter */
+} perfBlock_t, *perfBlock_PTR;
+
+
+/* PC Sampling Profile of one ASID (returned by SYS33); bucket b counts
+ * samples with KUSEG + (b << PROFSHIFT) <= PC < KUSEG + ((b + 1) << PROFSHIFT) */
+typedef struct profHist_t {
+	unsigned int 			ph_samples;				/* Samples taken */
+	unsigned int 			ph_other;				/* Samples outside the buckets (support level, stack) */
+	unsigned int 			ph_count[PROFBUCKETS];	/* Samples per PC bucket */
+} profHist_t, *profHist_PTR;
+
+
+/* Contention Statistics of one Semaphore (returned by SYS34) */
+typedef struct lockStat_t {
+	int 					*ls_semAdd;				/* Semaphore address (NULL for a free slot) */
+	unsigned int 			ls_acquires;			/* P operations */
+	unsigned int 			ls_contended;			/* Of those, P operations that blocked */
+	cpu_t 					ls_totalWait;			/* Time blocked, summed over the woken P operations */
+	cpu_t 					ls_maxWait;				/* Longest of those waits */
+} lockStat_t, *lockStat_PTR;
+
+
+/* Owner of one Priority-Inheriting Mutex (made with SYS-4) */
+typedef struct mutex_t {
+	int 					*m_semAdd;				/* Semaphore address (NULL for a free slot) */
+	struct pcb_t 			*m_owner;				/* Process holding it (NULL if free or unknown) */
+} mutex_t, *mutex_PTR;
+
+
+/* Statistics of one Device (returned by SYS35); devices are numbered as
+ * their semaphores, devregarea_t order with the terminal receivers last */
+typedef struct devStat_t {
+	cpu_t 					ds_busyTime;			/* Time from command issue (SYS5) to interrupt, summed */
+	unsigned int 			ds_ops[DEVCMDCODES];	/* Completed commands per command code */
+	unsigned int 			ds_bytes;				/* Bytes moved by the completed commands */
+	unsigned int 			ds_errors;				/* Completions with an error status */
+	unsigned int 			ds_lastError;			/* Status of the last of those (0 if none) */
+	unsigned int 			ds_waiters;				/* Processes blocked on its Support Level mutex */
+	int 					ds_command;				/* Code of the command in flight (NOCOMMAND if idle) */
+	cpu_t 					ds_issueTOD;			/* When that command was issued */
+} devStat_t, *devStat_PTR;
+
+
+/* Mailbox Message: up to MSGINLINE bytes held inline, or a whole page
+ * moved as its swap pool frame */
+typedef struct message_t {
+	int 					msg_sender;				/* ASID of the sender */
+	int 					msg_length;				/* Bytes in the message */
+	int 					msg_frame;				/* Frame of a page message (NOSWAPFRAME if inline) */
+	char 					msg_data[MSGINLINE];	/* Inline contents */
+} message_t, *message_PTR;
+
+
 /* Delay Descriptor */
 typedef struct delayd_t {
     struct delayd_t 		*d_next;		/* Pointer to next delay descriptor */
+    struct delayd_t 		*d_child;		/* First child in the phase 5 delay heap (d_next is its sibling) */
     int 					d_wakeTime;		/* Wakeup time */
     support_t 				*d_supStruct;	/* Support structure of the process */
 } delayd_t, *delayd_PTR;
@@ -0,0 +1,24 @@
+#ifndef USERSEMAPHORE_H
+#define USERSEMAPHORE_H
+
+/******************************* userSemaphore.h *****************************
+ *
+ * This header file contains the declarations for the named semaphores
+ * U-procs synchronize on through the Support Level.
+ * It establishes the interface for the userSemaphore.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+
+/* Function Declarations */
+extern void             initUserSemaphores();                                   /* Zero the named semaphores */
+extern int              pSemTimedSyscallHandler(support_PTR supportStruct);     /* Handles SYS29 (PSEMTIMED) */
+extern int              vSemNamedSyscallHandler(support_PTR supportStruct);     /* Handles SYS30 (VSEMNAMED) */
+extern int              pSemNamedSyscallHandler(support_PTR supportStruct);     /* Handles SYS39 (PSEMNAMED) */
+extern int              tryTakeSemaphore(int semId);                            /* Take a unit without blocking */
+
+#endif /* USERSEMAPHORE_H */
@@ -16,15 +16,41 @@
 #include "../h/initProc.h"
 #include "../h/deviceSupportDMA.h"
 
+/* Global Variables */
+extern unsigned int     tlbRefills;                             /* TLB refills served since boot */
+
 /* Function Declarations */
 extern void             initSupportStructFreeList();            /* Initialize the Support Structure free list */
 extern support_PTR      allocateSupportStruct();                /* Allocate a Support Structure from the free list */
 extern void             initSwapPool();                         /* Initialize all swap pool data structures */
+extern void             registerText(support_PTR supportStruct);    /* Register a new U-proc, sharing no text yet */
+extern void             fingerprintText(support_PTR supportStruct); /* Fingerprint a registered U-proc's text pages */
+extern void             setBackingStore(int asid, int flashNum, int base, int blocks); /* Set the flash region an ASID pages from */
+extern void             stripeBackingStores();                  /* Group the configured regions into swap stripes */
+extern int              reservedBlock(int flashNum, int block); /* Check if a flash block is a U-proc's backing store */
 extern void             pager();                                /* Pager function for handling page faults */
+extern int              idleWork();                             /* Do bounded swap pool work while the nucleus idles */
 extern void             uTLB_RefillHandler();                   /* TLB refill handler */
 extern void             terminateUProcess(int *mutex);          /* Terminate the current user process */
+extern void             exitUProcess(int *mutex, int reason);   /* Terminate it, recording why */
+extern void             resetAddressSpace(support_PTR supportStruct); /* Reset a respawning U-proc to its image */
+extern int              cloneAddressSpace(support_PTR parent, support_PTR child); /* Give a clone a copy-on-write address space */
+extern void             discardClone(support_PTR supportStruct); /* Free a clone that never ran */
 extern void             setInterrupts(int toggle);              /* Set interrupts on or off */
 extern void             resumeState(state_t *state);            /* Load processor state */
 extern int              validateUserAddress(memaddr address);   /* Check if an address is in user space */
+extern int              pinUserPage(support_PTR supportStruct, memaddr vAddress, int deviceWrites); /* Pin a resident page for zero-copy DMA */
+extern void             unpinUserPage(int frameNum);            /* Release a pinned page */
+extern int              readResidentWord(support_PTR supportStruct, memaddr vAddress, int *word); /* Read a user word if resident */
+extern int              sharedSegment(int asid, memaddr vAddress); /* Shared segment holding an address */
+extern int              detachUserPage(support_PTR supportStruct, memaddr vAddress); /* Take a page's frame for a message */
+extern int              attachUserPage(support_PTR supportStruct, memaddr vAddress, int frameNum); /* Map a message frame as a page */
+extern void             releaseMessageFrame(int frameNum);      /* Free a message frame that was not mapped */
+extern int              groupResident(int group);               /* Count the frames a resource group holds */
+extern int              takeTransitFrame();                     /* Take a free frame to carry a packet */
+extern int              snapshotPages(support_PTR supportStruct, unsigned char *pages, int *hot); /* List the pages a checkpoint saves */
+extern int              shmAttachSyscallHandler(support_PTR supportStruct); /* Handles SYS38 (SHMATTACH) */
+extern int              diskMapSyscallHandler(support_PTR supportStruct); /* Handles SYS52 (DISKMAP) */
+extern int              pinPagesSyscallHandler(support_PTR supportStruct); /* Handles SYS45 (PINPAGES) */
 
 #endif /* VMSUPPORT_H */
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef WAITANY_H
+#define WAITANY_H
+
+/******************************* waitAny.h *********************************
+ *
+ * This header file contains the declarations for SYS53, which blocks a
+ * U-proc until the first of several I/O and semaphore events.
+ * It establishes the interface for the waitAny.c module.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ****************************************************************************/
+
+/* Included Header Files */
+#include "../h/initProc.h"
+#include "../h/asyncIO.h"
+#include "../h/userSemaphore.h"
+#include "../h/terminalDaemon.h"
+#include "../h/network.h"
+
+/* Function Declarations */
+extern void             initWaiters();                                          /* Free every waiter slot */
+extern int              waitAnySyscallHandler(support_PTR supportStruct);       /* Handles SYS53 (WAITANY) */
+extern void             notifyWaiters(int kind, int asid, int handle);          /* Wake the waiters watching an event */
+
+#endif /* WAITANY_H */
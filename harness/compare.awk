@@ -0,0 +1,82 @@
+#
+# compare.awk: Compares harness results with the stored baseline.
+#
+# Usage: awk [-v nobaseline=1] -f compare.awk thresholds baseline results
+#
+# thresholds has one "<bench>.<metric> <higher|lower> <percent>" line per
+# gated metric: "higher" metrics (throughput) fail when they drop more
+# than <percent> below the baseline, "lower" metrics (latency, faults)
+# when they rise more than <percent> above it. baseline and results hold
+# "bench=<name> metric=<metric> value=<n> unit=<u>" lines; a metric that
+# several U-procs report (benchSwap) is averaged. Exits 1 if any gated
+# metric regressed, is missing from the results or has no baseline; with
+# nobaseline set, a metric without a baseline is reported and passes.
+#
+# Written by Aryah Rao and Anish Reddy
+
+# field "key=value" of the current line
+function field(key,    i) {
+	for (i = 1; i <= NF; i++) {
+		if (index($i, key "=") == 1) {
+			return substr($i, length(key) + 2)
+		}
+	}
+	return ""
+}
+
+/^#/ || NF == 0 { next }
+
+FILENAME == ARGV[1] {
+	direction[$1] = $2
+	percent[$1] = $3
+	order[++gated] = $1
+	next
+}
+
+{
+	name = field("bench") "." field("metric")
+	if (FILENAME == ARGV[2]) {
+		baseSum[name] += field("value"); baseCount[name]++
+		unit[name] = field("unit")
+	} else {
+		runSum[name] += field("value"); runCount[name]++
+	}
+}
+
+END {
+	failed = 0
+	for (i = 1; i <= gated; i++) {
+		name = order[i]
+		if (!(name in baseCount)) {
+			printf "%-28s NO BASELINE\n", name
+			if (!nobaseline) {
+				failed = 1
+			}
+			continue
+		}
+		if (!(name in runCount)) {
+			printf "%-28s MISSING\n", name
+			failed = 1
+			continue
+		}
+		base = baseSum[name] / baseCount[name]
+		value = runSum[name] / runCount[name]
+		change = (base == 0) ? 0 : (value - base) * 100 / base
+		verdict = "ok"
+		if (direction[name] == "higher" && change < -percent[name]) {
+			verdict = "REGRESSED"
+		}
+		if (direction[name] == "lower" && change > percent[name]) {
+			verdict = "REGRESSED"
+		}
+		if (base == 0 && direction[name] == "lower" && value > 0) {
+			verdict = "REGRESSED"
+		}
+		if (verdict != "ok") {
+			failed = 1
+		}
+		printf "%-28s %10d -> %10d %s %+6.1f%% (limit %s%%) %s\n", name, base, value, \
+			unit[name], change, percent[name], verdict
+	}
+	exit failed
+}
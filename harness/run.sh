@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# run.sh: Runs one harness machine config and prints its results.
+#
+# Usage: run.sh <config> <seconds>
+#
+# The old terminal transcripts of the config are removed, the simulator
+# ($UMPS3, default "umps3") is started on it and killed after <seconds>
+# if it has not exited by then, and every "bench=..." line the U-procs
+# wrote to their terminals is printed on stdout. $UMPS3 must power the
+# machine on by itself: set it to a command (or wrapper) that does.
+#
+# Written by Aryah Rao and Anish Reddy
+
+config=$1
+seconds=$2
+UMPS3=${UMPS3:-umps3}
+
+if [ -z "$config" ] || [ -z "$seconds" ]; then
+	echo "usage: run.sh <config> <seconds>" >&2
+	exit 2
+fi
+
+rm -f "$config"-term*.umps "$config"-printer*.umps
+timeout "$seconds" $UMPS3 "$config" >/dev/null 2>&1
+
+# each line of a transcript is one terminal line; keep the results only
+found=0
+for transcript in "$config"-term*.umps; do
+	[ -f "$transcript" ] || continue
+	grep '^bench=' "$transcript" | tr -d '\r'
+	found=1
+done
+
+if [ $found -eq 0 ]; then
+	echo "run.sh: $config left no terminal output" >&2
+	exit 1
+fi
+exit 0
@@ -0,0 +1,159 @@
+/******************************* tracedump.c *************************************
+ *
+ * Host-side decoder of the binary trace the phase5 trace sink streams to
+ * flash (record format in phase5/traceSink.c).
+ *
+ * Usage: tracedump <flash file>
+ *
+ * The flash file is the simulator's file of the trace device (e.g.
+ * flash7.umps). Its device header is skipped by finding the first page
+ * header (kind TRK_PAGE, asid TRACEMAGIC) at a word offset below one
+ * page. Every block from there that starts with a page header is read,
+ * the pages are put in sequence order (the sink wraps around the device)
+ * and each record is printed as one line:
+ *
+ *	<tod> cpu=<n> asid=<n> <kind> <event> arg=<hex>
+ *
+ * A page header prints as "page <seq> dropped=<n>"; a gap in the page
+ * sequence numbers (pages written over, or lost) prints as "gap".
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Must match h/const.h */
+#define PAGESIZE        4096
+#define TRACERECSIZE    16
+#define TRACEPAGERECS   (PAGESIZE / TRACERECSIZE)
+#define TRACEMAGIC      0x5452
+#define TRK_NONE        0
+#define TRK_PAGE        1
+#define TRK_SCHED       2
+#define TRK_INTERRUPT   3
+#define TRK_PAGING      4
+#define TRK_SYSCALL     5
+#define PERFLINES       8
+#define PERF_TLBREFILL  2
+
+static const char *schedEvents[] = { "dispatch", "preempt", "block", "unblock" };
+static const char *pagingEvents[] = { "tlbrefill", "pagefault", "eviction", "writeback" };
+
+/* One page of the file: its sequence number and where it starts */
+typedef struct page_t {
+	unsigned long	seq;
+	long			offset;
+} page_t;
+
+/* Little-endian word at p */
+static unsigned long word(const unsigned char *p) {
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+		   ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* Is the record at p a page header? */
+static int pageHeader(const unsigned char *p) {
+	return (p[4] == TRK_PAGE) && ((p[6] | (p[7] << 8)) == TRACEMAGIC);
+}
+
+static int bySeq(const void *a, const void *b) {
+	unsigned long x = ((const page_t *)a)->seq;
+	unsigned long y = ((const page_t *)b)->seq;
+	return (x < y) ? -1 : (x > y);
+}
+
+/* Print one record */
+static void printRecord(const unsigned char *p) {
+	unsigned long event = word(p + 8);
+	printf("%10lu cpu=%u asid=%u ", word(p), p[5], p[6] | (p[7] << 8));
+	switch (p[4]) {
+		case TRK_SCHED:
+			printf("sched %s", (event < 4) ? schedEvents[event] : "?");
+			break;
+		case TRK_INTERRUPT:
+			if (event < PERFLINES) {
+				printf("interrupt line%lu", event);
+			} else {
+				printf("interrupt device%lu", event - PERFLINES);
+			}
+			break;
+		case TRK_PAGING:
+			printf("paging %s", ((event >= PERF_TLBREFILL) && (event < PERF_TLBREFILL + 4)) ?
+				   pagingEvents[event - PERF_TLBREFILL] : "?");
+			break;
+		case TRK_SYSCALL:
+			printf("syscall %ld", (long)(int)event);
+			break;
+		default:
+			printf("kind%u %lu", p[4], event);
+			break;
+	}
+	printf(" arg=0x%08lx\n", word(p + 12));
+}
+
+int main(int argc, char **argv) {
+	FILE *file;
+	unsigned char *data;
+	long size, start, offset;
+	page_t *pages;
+	int count, i, r;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: tracedump <flash file>\n");
+		return 2;
+	}
+	file = fopen(argv[1], "rb");
+	if (file == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data = malloc(size > 0 ? size : 1);
+	if ((data == NULL) || (fread(data, 1, size, file) != (size_t)size)) {
+		fprintf(stderr, "tracedump: can not read %s\n", argv[1]);
+		return 1;
+	}
+	fclose(file);
+
+	/* Skip the device header: the first page header below one page */
+	for (start = 0; (start < PAGESIZE) && (start + PAGESIZE <= size); start += 4) {
+		if (pageHeader(data + start)) {
+			break;
+		}
+	}
+	if ((start >= PAGESIZE) || (start + PAGESIZE > size)) {
+		fprintf(stderr, "tracedump: no trace pages in %s\n", argv[1]);
+		return 1;
+	}
+
+	/* Collect the pages and order them */
+	pages = malloc(((size - start) / PAGESIZE + 1) * sizeof(page_t));
+	count = 0;
+	for (offset = start; offset + PAGESIZE <= size; offset += PAGESIZE) {
+		if (pageHeader(data + offset)) {
+			pages[count].seq = word(data + offset + 8);
+			pages[count].offset = offset;
+			count++;
+		}
+	}
+	qsort(pages, count, sizeof(page_t), bySeq);
+
+	for (i = 0; i < count; i++) {
+		const unsigned char *page = data + pages[i].offset;
+		if ((i > 0) && (pages[i].seq != pages[i - 1].seq + 1)) {
+			printf("gap\n");
+		}
+		printf("page %lu dropped=%lu\n", pages[i].seq, word(page + 12));
+		for (r = 1; r < TRACEPAGERECS; r++) {
+			if (page[(r * TRACERECSIZE) + 4] == TRK_NONE) {
+				break;
+			}
+			printRecord(page + (r * TRACERECSIZE));
+		}
+	}
+	return 0;
+}
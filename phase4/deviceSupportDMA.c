@@ -14,8 +14,15 @@
  *   backing store) via syscalls is prohibited and results in process termination.
  * - Parameter Validation: User-provided addresses and device/sector/block numbers
  *   are validated; invalid parameters lead to process termination.
+ * - Seek Elision: The driver remembers each disk's head cylinder and issues
+ *   SEEKCYL only when a transfer targets a different one, so sequential
+ *   sectors on one cylinder cost a single interrupt each. Any failed command
+ *   forgets the position so the next transfer seeks again
  * - Mutex Management: The module assumes that the caller holds the appropriate
  *   device mutex before calling diskRW/flashRW.
+ * - Flash Buffering: With LAZYLOAD set the pager reads U-proc images from
+ *   flash, so SYS16/SYS17 copy user memory (which may page fault) through
+ *   a per-ASID buffer while holding no flash mutex.
  *
  * Functions:
  * - flashRW: Performs read/write to flash device
@@ -37,6 +44,15 @@
 /*----------------------------------------------------------------------------*/
 HIDDEN void copyBlock(memaddr *src, memaddr *dest);
 
+/*----------------------------------------------------------------------------*/
+/* Module variables */
+/*----------------------------------------------------------------------------*/
+/* Cylinder each disk's head is on (NOCYLINDER until the first seek) */
+HIDDEN int diskCylinderPos[DEV_PER_LINE] = {
+    NOCYLINDER, NOCYLINDER, NOCYLINDER, NOCYLINDER,
+    NOCYLINDER, NOCYLINDER, NOCYLINDER, NOCYLINDER
+};
+
 /*----------------------------------------------------------------------------*/
 /* Global Function Implementations */
 /*----------------------------------------------------------------------------*/
@@ -47,6 +63,7 @@ HIDDEN void copyBlock(memaddr *src, memaddr *dest);
  * Description: Performs a read or write operation on a specified disk
  *              and sector using the provided physical address
  *              Handles geometry calculation, SEEK, and READ/WRITE commands
+ *              The SEEK is skipped when the head is already on the cylinder.
  *              Assumes the caller holds the appropriate device mutex.
  *
  * Parameters:
@@ -84,13 +101,18 @@ int diskRW(int operation, int diskNum, int linearSector, memaddr bufferAddr) {
     unsigned int head = (linearSector % sectors_per_cylinder) / max_sector;
     unsigned int sector = (linearSector % sectors_per_cylinder) % max_sector;
 
-    /* Perform SEEKCYL Operation atomically */
-    setInterrupts(OFF);
-    devRegisterArea->devreg[devIndex].d_command = (cylinder << DISK_SEEK_CYL_SHIFT) | SEEKCYL;
-    int status = SYSCALL(WAITIO, DISKINT, diskNum, FALSE);
-    setInterrupts(ON);
-    if (status != READY) {
-        return -status;
+    /* Perform SEEKCYL Operation atomically, unless the head is already there */
+    int status;
+    if (diskCylinderPos[diskNum] != (int)cylinder) {
+        setInterrupts(OFF);
+        devRegisterArea->devreg[devIndex].d_command = (cylinder << DISK_SEEK_CYL_SHIFT) | SEEKCYL;
+        status = SYSCALL(WAITIO, DISKINT, diskNum, FALSE);
+        setInterrupts(ON);
+        if (status != READY) {
+            diskCylinderPos[diskNum] = NOCYLINDER;
+            return -status;
+        }
+        diskCylinderPos[diskNum] = cylinder;
     }
 
     /* Perform READBLK/WRITEBLK Operation atomically */
@@ -100,8 +122,9 @@ int diskRW(int operation, int diskNum, int linearSector, memaddr bufferAddr) {
     status = SYSCALL(WAITIO, DISKINT, diskNum, FALSE);
     setInterrupts(ON);
 
-    /* Return status */
+    /* Return status; after a failure the head position is no longer trusted */
     if (status != READY) {
+        diskCylinderPos[diskNum] = NOCYLINDER;
         status = -status;
     }
     return status;
@@ -273,11 +296,19 @@ int flashPutSyscallHandler(support_PTR supportStruct) {
     memaddr flashDmaBufferAddr = FLASH_DMABUFFER_ADDR(flashNum);
     int devIndex = ((FLASHINT - MAPINT) * DEV_PER_LINE) + (flashNum);
 
+    if (LAZYLOAD) {
+        /* Fault the data in before taking the mutex the pager may need */
+        flashDmaBufferAddr = FLASH_BOUNCE_ADDR(supportStruct->sup_asid);
+        copyBlock((memaddr *)logicalAddress, (memaddr *)flashDmaBufferAddr);
+    }
+
     /* Acquire device mutex */
     SYSCALL(PASSEREN, (int)&deviceMutex[devIndex], 0, 0);
 
     /* Copy data from user logical address to kernel DMA buffer */
-    copyBlock((memaddr *)logicalAddress, (memaddr *)flashDmaBufferAddr);
+    if (!LAZYLOAD) {
+        copyBlock((memaddr *)logicalAddress, (memaddr *)flashDmaBufferAddr);
+    }
 
     /* Call flashRW using the DMA buffer address (mutex is held) */
     int status = flashRW(WRITE, flashNum, blockNum, flashDmaBufferAddr);
@@ -318,6 +349,9 @@ int flashGetSyscallHandler(support_PTR supportStruct) {
     /* Get DMA buffer address */
     memaddr flashDmaBufferAddr = FLASH_DMABUFFER_ADDR(flashNum);
     int devIndex = ((FLASHINT - MAPINT) * DEV_PER_LINE) + (flashNum);
+    if (LAZYLOAD) {
+        flashDmaBufferAddr = FLASH_BOUNCE_ADDR(supportStruct->sup_asid);
+    }
 
     /* Acquire device mutex */
     SYSCALL(PASSEREN, (int)&deviceMutex[devIndex], 0, 0);
@@ -326,13 +360,18 @@ int flashGetSyscallHandler(support_PTR supportStruct) {
     int status = flashRW(READ, flashNum, blockNum, flashDmaBufferAddr);
 
     /* If read was successful, copy data from DMA buffer to user (while mutex is held) */
-    if (status == READY) {
+    if ((status == READY) && !LAZYLOAD) {
         copyBlock((memaddr *)flashDmaBufferAddr, (memaddr *)logicalAddress);
     }
 
     /* Release device mutex */
     SYSCALL(VERHOGEN, (int)&deviceMutex[devIndex], 0, 0);
 
+    /* The private buffer is copied out after the mutex, as a fault may need it */
+    if ((status == READY) && LAZYLOAD) {
+        copyBlock((memaddr *)flashDmaBufferAddr, (memaddr *)logicalAddress);
+    }
+
     return status;
 }
 
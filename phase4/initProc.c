@@ -18,9 +18,17 @@
  * process termination. The test waits for all child processes to terminate before
  * terminating.
  *
+ * Each U-proc's image is copied from its flash device to DISK0 by its own
+ * loader process, so the eight flash devices are read in parallel and their
+ * blocks queue up for DISK0 while another loader's block is being written.
+ * A loader creates its U-proc as soon as that image is in place, and then
+ * parks until test() terminates.
+ *
  * Functions:
  * - test: Entry point for the Support Level initialization and U-proc creation
- * - createUProcess: Creates a U-process using a predefined support structure
+ * - createUProcess: Sets up a U-proc's support structure and launches its loader
+ * - imageLoader: Copies one U-proc's image to the backing store, then creates it
+ * - copyImageToBackingStore: Copies the .text and .data blocks flash to DISK0
  * 
  * Written by Aryah Rao and Anish Reddy
  *
@@ -35,10 +43,17 @@
 int masterSema4;                             /* Master semaphore for synchronization */
 int deviceMutex[DEVICE_COUNT];               /* Semaphores for device mutual exclusion */
 
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int loadFailed;                       /* A loader could not copy or create its U-proc */
+HIDDEN int loaderPark;                       /* Loaders wait here once their U-proc runs */
+
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
 /*----------------------------------------------------------------------------*/
 HIDDEN int createUProcess(int processASID);
+HIDDEN void imageLoader(int processASID, support_PTR newSupport);
 HIDDEN int copyImageToBackingStore(int processASID, support_PTR newSupport);
 
 /*----------------------------------------------------------------------------*/
@@ -66,6 +81,8 @@ void test() {
     initSupportStructFreeList(); /* Initialize the free list of support structures */
     initSwapPool(); /* Initialize the Swap Pool data structure */
     masterSema4 = 0; /* Initialize the master semaphore for synchronization */
+    loadFailed = FALSE;
+    loaderPark = 0;
 
     /* Create user processes */
     int asid;
@@ -75,9 +92,12 @@ void test() {
         }
     }
 
-    /* After all U-procs have been created, wait on the master semaphore for each user process */
+    /* Wait on the master semaphore for each user process (a failed loader signals it too) */
     for (asid = 1; asid <= MAXUPROC; asid++) {
         SYSCALL(PASSEREN, (int)&masterSema4, 0, 0); 
+        if (loadFailed) {
+            SYSCALL(TERMINATEPROCESS, 0, 0, 0); /* Nuke it! */
+        }
     }
     /* All children have terminated, now terminate the test process */
     SYSCALL(TERMINATEPROCESS, 0, 0, 0);
@@ -88,15 +108,15 @@ void test() {
 /* ========================================================================
  * Function: createUProcess
  *
- * Description: Creates a new user process with the given processASID
- *              Sets up initial processor state, support structure, and
- *              copies initial image to backing store (DISK0).
+ * Description: Sets up the support structure of a new user process with
+ *              the given processASID and launches the loader that copies
+ *              its initial image to backing store (DISK0) and creates it
  *
  * Parameters:
  *              processASID - ID of the process to create (1 to MAXUPROC)
  *
  * Returns:
- *              SUCCESS if user process was created successfully
+ *              SUCCESS if the loader was launched
  *              ERROR otherwise
  *
  * ======================================================================== */
@@ -128,21 +148,56 @@ int createUProcess(int processASID) {
     newSupport->sup_exceptContext[GENERALEXCEPT].c_status = ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
     newSupport->sup_exceptContext[GENERALEXCEPT].c_stackPtr = (memaddr) (UPROC_GEN_STACK(processASID));
 
+    /* Launch the loader, in kernel mode on its own stack */
+    state_t loaderState;
+    loaderState.s_pc = (memaddr)imageLoader;
+    loaderState.s_t9 = (memaddr)imageLoader;
+    loaderState.s_sp = LOADER_STACK(processASID - 1);
+    loaderState.s_a0 = processASID;
+    loaderState.s_a1 = (memaddr)newSupport;
+    loaderState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+    loaderState.s_entryHI = 0; /* ASID 0 */
+    return SYSCALL(CREATEPROCESS, (int)&loaderState, 0, 0);
+}
+
+/* ========================================================================
+ * Function: imageLoader
+ *
+ * Description: Loader process of one U-proc. Copies its initial image
+ *              from flash to backing store (DISK0) and creates it. On a
+ *              failure it flags test() through the master semaphore. It
+ *              then parks, since terminating would take the U-proc with it
+ *
+ * Parameters:
+ *              processASID - ID of the process to create (1 to MAXUPROC)
+ *              newSupport - Pointer to the process's support structure
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void imageLoader(int processASID, support_PTR newSupport) {
+    int status = ERROR;
+
     /* Copy initial image from Flash to Backing Store (DISK0) */
-    if (copyImageToBackingStore(processASID, newSupport) != SUCCESS) {
-        return ERROR;
-    }
+    if (copyImageToBackingStore(processASID, newSupport) == SUCCESS) {
+        /* Initial processor state */
+        state_t initialState;
+        initialState.s_pc = UTEXTSTART;
+        initialState.s_t9 = UTEXTSTART;
+        initialState.s_sp = USTACKPAGE;
+        initialState.s_entryHI = processASID << ASIDSHIFT;
+        initialState.s_status = ALLOFF | STATUS_KUp | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
 
-    /* Initial processor state */
-    state_t initialState;
-    initialState.s_pc = UTEXTSTART;
-    initialState.s_t9 = UTEXTSTART;
-    initialState.s_sp = USTACKPAGE;
-    initialState.s_entryHI = processASID << ASIDSHIFT;
-    initialState.s_status = ALLOFF | STATUS_KUp | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+        /* Create user process */
+        status = SYSCALL(CREATEPROCESS, (int)&initialState, (int)newSupport, 0);
+    }
+    if (status != SUCCESS) {
+        loadFailed = TRUE;
+        SYSCALL(VERHOGEN, (int)&masterSema4, 0, 0);
+    }
 
-    /* Create user process */
-    return SYSCALL(CREATEPROCESS, (int)&initialState, (int)newSupport, 0);
+    /* Park until test() terminates */
+    SYSCALL(PASSEREN, (int)&loaderPark, 0, 0);
 }
 
 /* ========================================================================
@@ -150,34 +205,38 @@ int createUProcess(int processASID) {
  *
  * Description: Copies the initialized .text and .data sections of a U-proc
  *              from its assigned flash device to its allocated space on DISK0
- *              using flashRW and diskRW helpers. Acquires/releases appropriate
- *              device mutexes for each operation. Reads the .aout header to
- *              determine sizes.
+ *              using flashRW and diskRW helpers. Reads the .aout header to
+ *              determine sizes. Each block is read into the flash device's
+ *              own DMA buffer and written to DISK0 straight from it, so the
+ *              flash mutex is held for the whole copy and the DISK0 mutex
+ *              only for each block's write, letting other loaders' flash
+ *              reads proceed meanwhile. With LAZYLOAD set only the header
+ *              is read; the pager faults pages from flash as they are used.
  *
  * Parameters:
  *              processID - The ASID of the process (1 to MAXUPROC)
  *              newSupport - Pointer to the process's support structure
-  *
+ *
  * Returns:
  *              SUCCESS if copy completed successfully
  *              ERROR otherwise
-* 
+ *
  * ======================================================================== */
 HIDDEN int copyImageToBackingStore(int processID, support_PTR newSupport) {
     int flashNum = processID - 1;
     int diskNum = 0;
     int blockNum = 0;
-    memaddr tempBuffer = DISK_DMABUFFER_ADDR(diskNum);
+    memaddr tempBuffer = FLASH_DMABUFFER_ADDR(flashNum);
     int diskDevIndex = ((DISKINT - MAPINT) * DEV_PER_LINE) + (diskNum);
     int flashDevIndex = ((FLASHINT - MAPINT) * DEV_PER_LINE) + (flashNum);
 
-    /* Gain disk0 and flash0 mutex */
-    SYSCALL(PASSEREN, (int)&deviceMutex[diskDevIndex], 0, 0);
+    /* Gain the flash mutex (and with it the flash DMA buffer) */
     SYSCALL(PASSEREN, (int)&deviceMutex[flashDevIndex], 0, 0);
     
     /* Read Block 0 header info */
     int status = flashRW(READ, flashNum, blockNum, tempBuffer);
     if (status != READY) {
+        SYSCALL(VERHOGEN, (int)&deviceMutex[flashDevIndex], 0, 0);
         return ERROR;
     }
 
@@ -196,34 +255,39 @@ HIDDEN int copyImageToBackingStore(int processID, support_PTR newSupport) {
         numBlocksToCopy = 1; /* Should copy at least block 0 */
     } 
     if (numBlocksToCopy >= MAXPAGES) {
+        SYSCALL(VERHOGEN, (int)&deviceMutex[flashDevIndex], 0, 0);
         return ERROR; /* Too many blocks to copy */
     } 
 
-    /* Write Block 0 to Disk */
-    int linearSector = (processID - 1) * MAXPAGES + blockNum;
-    status = diskRW(WRITEBLK, diskNum, linearSector, tempBuffer);
-    if (status != READY) {
-        return ERROR;
+    /* Lazy loading: the pager reads the image from flash on demand */
+    if (LAZYLOAD) {
+        numBlocksToCopy = 0;
     }
 
-    /* Loop for remaining blocks */
-    blockNum = 1;
+    /* Block 0 is already in the buffer; read each later block before its write */
     while (blockNum < numBlocksToCopy) {
-        /* Read block from Flash */
-        status = flashRW(READ, flashNum, blockNum, tempBuffer);
-        if (status != READY) {
-            return ERROR;
+        if (blockNum > 0) {
+            /* Read block from Flash */
+            status = flashRW(READ, flashNum, blockNum, tempBuffer);
+            if (status != READY) {
+                SYSCALL(VERHOGEN, (int)&deviceMutex[flashDevIndex], 0, 0);
+                return ERROR;
+            }
         }
-        /* Write block to Disk using diskRW */
-        linearSector = (processID - 1) * MAXPAGES + blockNum;
+
+        /* Write block to Disk using diskRW, holding DISK0 only for the write */
+        int linearSector = (processID - 1) * MAXPAGES + blockNum;
+        SYSCALL(PASSEREN, (int)&deviceMutex[diskDevIndex], 0, 0);
         status = diskRW(WRITEBLK, diskNum, linearSector, tempBuffer);
+        SYSCALL(VERHOGEN, (int)&deviceMutex[diskDevIndex], 0, 0);
         if (status != READY) {
+            SYSCALL(VERHOGEN, (int)&deviceMutex[flashDevIndex], 0, 0);
             return ERROR;
         }
         blockNum++;
     }
-    /* Release DISK0 and FLASH0 mutexes */
-    SYSCALL(VERHOGEN, (int)&deviceMutex[diskDevIndex], 0, 0);
+
+    /* Release the flash mutex */
     SYSCALL(VERHOGEN, (int)&deviceMutex[flashDevIndex], 0, 0);
     return SUCCESS;
 }
@@ -34,9 +34,9 @@ int processCount;                       /* Number of processes in system */
 int softBlockCount;                     /* Number of blocked processes */
 pcb_PTR readyQueueHigh;                 /* Ready queue (High Priority) */
 pcb_PTR readyQueueLow;                  /* Ready queue (Low Priority) */
-pcb_PTR currentProcess;                 /* Currently executing process */
+pcb_PTR cpuProcess[MAXCPUS];           /* Process each processor executes (one here) */
 int deviceSemaphores[DEVICE_COUNT];     /* Array of device semaphores */
-cpu_t startTOD;                         /* Time of day at system start */
+cpu_t cpuStartTOD[MAXCPUS];             /* Time of day each processor's process was charged up to */
 
 /******************** External Declarations ********************/
 /* External declaration for the test & uTLB_RefillHandler function provided by Phase 2 Test */
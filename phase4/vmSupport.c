@@ -12,6 +12,10 @@
  *   if there are any unoccupied frames first, otherwise it chooses the next frame
  * - Process Termination: When a process terminates, all its physical frames and
  *   swap entries are immediately reclaimed for use by other processes
+ * - Lazy Loading: With LAZYLOAD set a page is read straight from the U-proc's
+ *   flash image until it is first evicted dirty; from then on its DISK0
+ *   swap slot holds it. swappedPages records, per ASID, which pages have
+ *   a swap slot copy, and is cleared when the U-proc terminates
  *
  * Functions:
  * - pager: Handles TLB miss exceptions by loading pages into memory
@@ -55,6 +59,7 @@ HIDDEN support_PTR supportFreeList = NULL;      /* Head of the support structure
 HIDDEN swapPoolEntry_t swapPool[SWAPPOOLSIZE];  /* Swap Pool data structure */
 HIDDEN int swapPoolMutex;                       /* Semaphore for Swap Pool access */
 HIDDEN int nextFrameNum;                        /* Next integer for FIFO replacement */
+HIDDEN unsigned int swappedPages[MAXUPROC + 1]; /* Pages of each ASID with a DISK0 swap slot copy */
 
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
@@ -153,6 +158,11 @@ void initSwapPool() {
 
     /* Initialize the Swap Pool semaphore */
     swapPoolMutex = 1;
+
+    /* No page has been swapped out yet */
+    for (i = 0; i < (MAXUPROC + 1); i++) {
+        swappedPages[i] = 0;
+    }
 }
 
 
@@ -487,6 +497,9 @@ int updateFrameNum() {
  *
  * Description: Performs read or write operations on the backing store (DISK0)
  *              by acquiring the DISK0 mutex and calling the diskRW helper.
+ *              With LAZYLOAD set, a page never written to DISK0 is read
+ *              from its block of the U-proc's flash image instead, and a
+ *              successful write marks the page as swapped.
  *
  * Parameters:
  *              operation - The operation to perform (READBLK or WRITEBLK)
@@ -498,9 +511,20 @@ int updateFrameNum() {
  *              Result from diskRW (READY or negative error code)
  * ======================================================================== */
 int backingStoreRW(int operation, int frameNum, int processASID, int pageNum) {
+    memaddr frameAddress = FRAMETOADDR(frameNum);
+
+    /* Not swapped out yet: the page is still in the flash image */
+    if (LAZYLOAD && (operation == READBLK) && !(swappedPages[processASID] & (1 << pageNum))) {
+        int flashNum = processASID - 1;
+        int flashIndex = ((FLASHINT - MAPINT) * DEV_PER_LINE) + (flashNum);
+        SYSCALL(PASSEREN, (int)&deviceMutex[flashIndex], 0, 0);
+        int flashStatus = flashRW(READ, flashNum, pageNum, frameAddress);
+        SYSCALL(VERHOGEN, (int)&deviceMutex[flashIndex], 0, 0);
+        return flashStatus;
+    }
+
     /* Backing store is always DISK0 */
     int diskNum = 0;
-    memaddr frameAddress = FRAMETOADDR(frameNum);
     int devIndex = ((DISKINT - MAPINT) * DEV_PER_LINE) + (diskNum);
 
     /* Calculate linear sector on DISK0 */
@@ -515,6 +539,10 @@ int backingStoreRW(int operation, int frameNum, int processASID, int pageNum) {
     /* Release DISK0 mutex */
     SYSCALL(VERHOGEN, (int)&deviceMutex[devIndex], 0, 0);
 
+    /* Later faults on this page read the swap slot */
+    if ((operation == WRITEBLK) && (status == READY)) {
+        swappedPages[processASID] |= (1 << pageNum);
+    }
     return status;
 }
 
@@ -546,6 +574,7 @@ void clearSwapPoolEntries(int asid) {
             swapPool[i].pte = NULL;
         }
     }
+    swappedPages[asid] = 0; /* A new U-proc with this ASID starts from its flash image */
     setInterrupts(ON);
     /* Release swap pool mutual exclusion */
     SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
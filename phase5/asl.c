@@ -14,13 +14,20 @@
  *
  * Helpers:
  *
+ * hashSemAdd                -   Map a semaphore address to its hash bucket
  * findSemd                  -   Find the semaphore descriptor for the given semAdd
  * dropFromSemaphoreQueue    -   Remove a PCB from the process queue of a semaphore
+ * growSemds                 -   Carve a fresh kernel frame into free descriptors
  *
- * The ASL is implemented as a sorted doubly linked list.
- * It is sorted in descending order of semAdd.
+ * The ASL is implemented as a hash table of ASLBUCKETS buckets keyed on
+ * semAdd (Fibonacci hashing, so the contiguous device semaphores spread
+ * over all buckets). Each bucket is an unsorted, NULL terminated doubly
+ * linked chain of the active descriptors hashing to it, so lookups are
+ * O(1) on average instead of a walk of every active semaphore.
+ * Descriptors come from the static semdTable first; when the free list
+ * runs dry a slab frame is carved into more, so MAXPROC does not cap the
+ * number of active semaphores.
  * We implement the methods for ASL in this module.
- * We use two sentinel nodes at the head and tail of the list.
  * The free list of semaphore descriptors is implemented as a circular DLL.
  * We use methods from the Process Control Block (PCB) module.
  * The process queue of a semaphore is implemented as a circular DLL.
@@ -30,16 +37,19 @@
 
 #include "../h/pcb.h"
 #include "../h/asl.h"
+#include "../h/slab.h"
 
 /******************** Hidden Helper Function Declarations *********************/
 
-HIDDEN semd_PTR findSemd(int *semAdd, semd_PTR *prev);                          /* Find the semaphore descriptor */
-HIDDEN pcb_PTR dropFromSemaphoreQueue(semd_PTR semd, semd_PTR prev, pcb_PTR p); /* Remove a PCB from the process queue of a semaphore */
+HIDDEN int hashSemAdd(int *semAdd);                                             /* Map a semaphore address to its bucket */
+HIDDEN semd_PTR findSemd(int *semAdd);                                          /* Find the semaphore descriptor */
+HIDDEN pcb_PTR dropFromSemaphoreQueue(semd_PTR semd, pcb_PTR p);                /* Remove a PCB from the process queue of a semaphore */
+HIDDEN void growSemds();                                                        /* Carve a kernel frame into free descriptors */
 
 /******************** Hidden Global Variables **********************/
 
-HIDDEN semd_t semdTable[MAXPROC + 2]; /* HIDDEN array of semaphore descriptors (Adding 2 for sentinels)*/
-HIDDEN semd_PTR semd_h;               /* Head of the Active Semaphore List (ASL) */
+HIDDEN semd_t semdTable[MAXPROC];     /* HIDDEN array of semaphore descriptors */
+HIDDEN semd_PTR semdHash[ASLBUCKETS]; /* Head of each ASL hash bucket chain */
 HIDDEN semd_PTR semdFree_h;           /* Head of the free semaphore descriptor list */
 
 /******************** ASL Global Functions ********************/
@@ -48,7 +58,7 @@ HIDDEN semd_PTR semdFree_h;           /* Head of the free semaphore descriptor l
  * Function: insertBlocked
  *
  * Description: Inserts a PCB into the process queue of a semaphore.
- * Maintains sorted order in ASL.
+ * A new descriptor is pushed on the front of its hash bucket.
  *
  * Parameters:
  *               semAdd - Address of the semaphore
@@ -64,12 +74,14 @@ int insertBlocked(int *semAdd, pcb_PTR p) {
     }
 
     /* Find the semaphore descriptor */
-    semd_PTR prev;
-    semd_PTR semd = findSemd(semAdd, &prev);
+    semd_PTR semd = findSemd(semAdd);
 
     /* Check if the semaphore descriptor exists in the ASL */
     if (semd == NULL) {
-        /* Check if the free list is empty */
+        /* Check if the free list is empty, growing it from the slab if so */
+        if (semdFree_h == NULL) {
+            growSemds();
+        }
         if (semdFree_h == NULL) {
             return TRUE; /* No free semaphores */
         }
@@ -81,16 +93,20 @@ int insertBlocked(int *semAdd, pcb_PTR p) {
         semd->s_semAdd = semAdd;
         semd->s_procQ = NULL;
 
-        /* Insert into sorted ASL */
-        semd->s_next = prev->s_next;
-        semd->s_prev = prev;
-        prev->s_next->s_prev = semd;
-        prev->s_next = semd;
+        /* Push onto the front of its hash bucket */
+        int bucket = hashSemAdd(semAdd);
+        semd->s_next = semdHash[bucket];
+        semd->s_prev = NULL;
+        if (semdHash[bucket] != NULL) {
+            semdHash[bucket]->s_prev = semd;
+        }
+        semdHash[bucket] = semd;
     }
 
     /* Insert process into semaphore queue */
     insertProcQ(&(semd->s_procQ), p);
     p->p_semAdd = semAdd;
+    p->p_semd = semd;
 
     return FALSE;
 }
@@ -109,17 +125,17 @@ int insertBlocked(int *semAdd, pcb_PTR p) {
  * ======================================================================== */
 pcb_PTR removeBlocked(int *semAdd) {
     /* Find the semaphore descriptor */
-    semd_PTR prev;
-    semd_PTR semd = findSemd(semAdd, &prev);
+    semd_PTR semd = findSemd(semAdd);
 
     /* Call dropFromSemaphoreQueue to remove the first process from the queue */
-    return dropFromSemaphoreQueue(semd, prev, NULL);
+    return dropFromSemaphoreQueue(semd, NULL);
 }
 
 /* ========================================================================
  * Function: outBlocked
  *
- * Description: Removes a specific PCB from its semaphore queue.
+ * Description: Removes a specific PCB from its semaphore queue. The PCB
+ * records its descriptor, so no hash lookup is needed.
  *
  * Parameters:
  *               p - Pointer to the PCB
@@ -129,12 +145,11 @@ pcb_PTR removeBlocked(int *semAdd) {
  *               NULL if the process queue is empty
  * ======================================================================== */
 pcb_PTR outBlocked(pcb_PTR p) {
-    /* Find the semaphore descriptor */
-    semd_PTR prev;
-    semd_PTR semd = findSemd(p->p_semAdd, &prev);
+    /* The descriptor is recorded in the PCB by insertBlocked */
+    semd_PTR semd = (p->p_semAdd != NULL) ? p->p_semd : NULL;
 
     /* Call dropFromSemaphoreQueue to remove the process from the queue */
-    return dropFromSemaphoreQueue(semd, prev, p);
+    return dropFromSemaphoreQueue(semd, p);
 }
 
 /* ========================================================================
@@ -151,8 +166,7 @@ pcb_PTR outBlocked(pcb_PTR p) {
  * ======================================================================== */
 pcb_PTR headBlocked(int *semAdd) {
     /* Find the semaphore descriptor */
-    semd_PTR prev;
-    semd_PTR semd = findSemd(semAdd, &prev);
+    semd_PTR semd = findSemd(semAdd);
 
     /* Check if the semaphore exists */
     if (semd == NULL) {
@@ -172,7 +186,7 @@ pcb_PTR headBlocked(int *semAdd) {
  * Function: initASL
  *
  * Description: Initializes the ASL and free list.
- * Creates two sentinel nodes at the head and tail of the ASL.
+ * Empties every hash bucket.
  *
  * Parameters:
  *               None
@@ -181,26 +195,17 @@ pcb_PTR headBlocked(int *semAdd) {
  *               None
  * ======================================================================== */
 void initASL() {
-    /* Create the head sentinel node for the ASL */
-    semd_h = &semdTable[0];
-    semd_h->s_semAdd = 0; /* Smallest possible semaphore address */
-
-    /* Create the tail sentinel node for the ASL */
-    semd_PTR tailSentinel = &semdTable[1];
-    tailSentinel->s_semAdd = (int *)MAXINT; /* Largest possible semaphore address */
-
-    /* Link the two sentinels together */
-    semd_h->s_next = tailSentinel;
-    semd_h->s_prev = NULL;
-    tailSentinel->s_next = NULL;
-    tailSentinel->s_prev = semd_h;
+    /* Empty every hash bucket */
+    int i;
+    for (i = 0; i < ASLBUCKETS; i++) {
+        semdHash[i] = NULL;
+    }
 
     /* Initialize the free list*/
     semdFree_h = NULL;
 
-    /* Insert the rest of the semaphore descriptors into the free list */
-    int i;
-    for (i = 2; i < MAXPROC + 2; i++) {
+    /* Insert the semaphore descriptors into the free list */
+    for (i = 0; i < MAXPROC; i++) {
         /* Using the queue helper */
         insertProcQ((pcb_PTR *)&semdFree_h, (pcb_PTR)&semdTable[i]);
     }
@@ -208,44 +213,46 @@ void initASL() {
 
 /******************** Hidden Helper Functions **********************/
 
+/* ========================================================================
+ * Function: hashSemAdd
+ *
+ * Description: Maps a semaphore address to its hash bucket. Semaphores are
+ * word aligned, so the low two bits are dropped before the multiplicative
+ * hash, whose top ASLHASHBITS bits select the bucket.
+ *
+ * Parameters:
+ *               semAdd - Address of the semaphore
+ * Returns:
+ *               Bucket index in [0, ASLBUCKETS)
+ * ======================================================================== */
+HIDDEN int hashSemAdd(int *semAdd) {
+    return (int)((((memaddr)semAdd >> 2) * ASLHASHMULT) >> (32 - ASLHASHBITS));
+}
+
 /* ========================================================================
  * Function: findSemd
  *
- * Description: Finds the semaphore descriptor for the given semAdd.
- * Maintains a pointer to the previous node to assist insertion/removal.
+ * Description: Finds the semaphore descriptor for the given semAdd by
+ * walking the chain of its hash bucket.
  *
  * Parameters:
  *               semAdd - Address of the semaphore
- *               prev - Pointer to store previous node
  * Returns:
  *               Pointer to the found semaphore descriptor, or NULL if not found
  * ======================================================================== */
-HIDDEN semd_PTR findSemd(int *semAdd, semd_PTR *prev) {
+HIDDEN semd_PTR findSemd(int *semAdd) {
     /* Check if the semaphore is NULL */
     if (semAdd == NULL) {
         return NULL;
     }
 
-    /* Start the search from the first real semaphore (skip head sentinel) */
-    semd_PTR curr = semd_h->s_next;
-
-    /* Keep track of the previous node (start with head sentinel) */
-    *prev = semd_h;
-
-    /* Traverse the ASL while the current node's semAdd is smaller */
-    while (curr->s_semAdd < semAdd) {
-        /* Move forward in the list */
-        *prev = curr;
+    /* Walk the bucket chain looking for semAdd */
+    semd_PTR curr = semdHash[hashSemAdd(semAdd)];
+    while ((curr != NULL) && (curr->s_semAdd != semAdd)) {
         curr = curr->s_next;
     }
 
-    /* Check if the current node's semAdd matches semAdd */
-    if (curr->s_semAdd == semAdd) {
-        return curr; /* Found the semaphore */
-    }
-    else {
-        return NULL; /* Semaphore not in ASL */
-    }
+    return curr; /* NULL if the semaphore is not in the ASL */
 }
 
 /* ========================================================================
@@ -255,14 +262,13 @@ HIDDEN semd_PTR findSemd(int *semAdd, semd_PTR *prev) {
  *
  * Parameters:
  *               semd - Pointer to the semaphore descriptor
- *               prev - Pointer to the previous semaphore descriptor in ASL
  *               p - Pointer to the PCB to be removed (NULL for removeBlocked)
  *
  * Returns:
  *               Pointer to the removed PCB
  *               NULL if the process queue is empty
  * ======================================================================== */
-HIDDEN pcb_PTR dropFromSemaphoreQueue(semd_PTR semd, semd_PTR prev, pcb_PTR p) {
+HIDDEN pcb_PTR dropFromSemaphoreQueue(semd_PTR semd, pcb_PTR p) {
     /* Check if the semaphore exists */
     if (semd == NULL) {
         return NULL;
@@ -285,16 +291,50 @@ HIDDEN pcb_PTR dropFromSemaphoreQueue(semd_PTR semd, semd_PTR prev, pcb_PTR p) {
     }
     else {
         removed->p_semAdd = NULL; /* Clear p_semAdd */
+        removed->p_semd = NULL;
     }
 
     /* Check if the semaphore's process queue is now empty */
     if (emptyProcQ(semd->s_procQ)) {
-        /* Remove semaphore from ASL */
-        prev->s_next = semd->s_next;
-        semd->s_next->s_prev = prev;
+        /* Unlink semaphore from its hash bucket */
+        if (semd->s_prev != NULL) {
+            semd->s_prev->s_next = semd->s_next;
+        } else {
+            semdHash[hashSemAdd(semd->s_semAdd)] = semd->s_next;
+        }
+        if (semd->s_next != NULL) {
+            semd->s_next->s_prev = semd->s_prev;
+        }
 
         /* Return the semaphore descriptor to the free list */
         insertProcQ((pcb_PTR *)&semdFree_h, (pcb_PTR)semd);
     }
     return removed;
 }
+
+/* ========================================================================
+ * Function: growSemds
+ *
+ * Description: Takes a kernel frame from the slab and adds every semaphore
+ * descriptor that fits in it to the free list. Does nothing if RAM is
+ * exhausted.
+ *
+ * Parameters:
+ *               None
+ *
+ * Returns:
+ *               None
+ * ======================================================================== */
+HIDDEN void growSemds() {
+    memaddr frame = allocSlabFrame();
+    if (frame == NOFRAME) {
+        return;
+    }
+
+    semd_PTR slab = (semd_PTR)frame;
+    int i;
+    for (i = 0; i < (int)(PAGESIZE / sizeof(semd_t)); i++) {
+        /* Using the queue helper */
+        insertProcQ((pcb_PTR *)&semdFree_h, (pcb_PTR)&slab[i]);
+    }
+}
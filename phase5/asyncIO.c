@@ -0,0 +1,565 @@
+/******************************* asyncIO.c *************************************
+ *
+ * Module: Asynchronous I/O
+ *
+ * Description:
+ * This module implements SYS26 (AIOSUBMIT) and SYS27 (AIOWAIT), which let a
+ * U-proc start a disk or flash block transfer and keep computing while it
+ * runs. The request is described by an aiocb_t control block in the
+ * U-proc's own address space; SYS26 queues it to a pool of AIOWORKERS
+ * kernel worker daemons and returns at once. The worker stores the final
+ * status in the control block's aio_status (AIOPENDING until then) and
+ * wakes any U-proc waiting for it in SYS27.
+ *
+ * Policy Decisions:
+ * - Pinned Pages: The workers run with ASID 0 and can not reach user
+ *   addresses, so SYS26 faults the buffer and control block pages in and
+ *   pins their frames (pinUserPage) for the life of the request. The
+ *   worker uses the frames' physical addresses, and releases the pins
+ *   once the status is stored
+ * - Fallback: If no request slot is free, the buffer is not page-aligned,
+ *   or either page can not be pinned, SYS26 performs the transfer itself
+ *   before returning; the control block looks the same to the caller
+ * - Workers: Any worker takes the oldest queued request, so up to
+ *   AIOWORKERS devices are kept busy at once; a disk's requests still pass
+ *   through its elevator queue and the block cache as with SYS14-17
+ * - Completion: SYS27 blocks on the request's own semaphore until it is
+ *   done. A slot is only reused after its last waiter has left, so a V
+ *   can never land on a reused slot. The worker also wakes any SYS53
+ *   caller watching the control block, which aioInFlight then reports
+ *   as done
+ * - One Request per Control Block: SYS26 on a control block whose request
+ *   is still in flight fails with ERROR
+ * - Parameter Validation: A bad control block address, device, block or
+ *   buffer terminates the U-proc, as with SYS14-17
+ * - Kernel Requests: aioSubmitBlock queues a transfer for kernel code (the
+ *   disk volume) on a frame it already pinned. Such a request has no
+ *   control block: the worker stores the status in a kernel word, frees
+ *   the slot and V's the caller's semaphore
+ * - Read-Ahead: aioPrefetch queues the fill of a block cache entry that
+ *   startPrefetch claimed for a sequential stream's next block. Nobody
+ *   waits on the slot; readers of the block wait in the cache instead
+ *
+ * Functions:
+ * - initAsyncIO: Initializes the request slots and launches the workers
+ * - aioSubmitSyscallHandler: Implements SYS26 (AIOSUBMIT)
+ * - aioWaitSyscallHandler: Implements SYS27 (AIOWAIT)
+ * - aioInFlight: Checks if a control block's request is still in flight
+ * - aioSubmitBlock: Queues a kernel transfer on a pinned frame
+ * - aioPrefetch: Queues a read-ahead into the block cache
+ * - aioWorker: Worker daemon serving queued requests
+ * - findRequest: Finds a U-proc's in-flight request for a control block
+ * - freeRequest: Returns a finished request to the free list
+ * - validControlBlock: Checks a control block address
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/asyncIO.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* waitAny.c */
+extern void notifyWaiters(int kind, int asid, int handle);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN aioRequest_t aioTable[AIOSLOTS];     /* Request slots */
+HIDDEN aioRequest_PTR aioFree_h;            /* Head of the free slot list */
+HIDDEN aioRequest_PTR aioQueue_h;           /* Oldest queued request */
+HIDDEN aioRequest_PTR aioQueue_t;           /* Newest queued request */
+HIDDEN int aioMutex;                        /* Request table mutual exclusion semaphore */
+HIDDEN int aioWorkSem;                      /* Number of queued requests */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void aioWorker();
+HIDDEN aioRequest_PTR findRequest(int asid, memaddr cb);
+HIDDEN void freeRequest(aioRequest_PTR request);
+HIDDEN int validControlBlock(memaddr cb);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initAsyncIO
+ *
+ * Description: Puts every request slot on the free list, empties the work
+ *              queue and launches the worker daemons
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initAsyncIO() {
+    aioFree_h = NULL;
+    int i;
+    for (i = 0; i < AIOSLOTS; i++) {
+        aioTable[i].ar_asid = UNOCCUPIED;
+        aioTable[i].ar_next = aioFree_h;
+        aioFree_h = &aioTable[i];
+    }
+    aioQueue_h = NULL;
+    aioQueue_t = NULL;
+    aioMutex = 1;
+    aioWorkSem = 0;
+
+    /* Launch the workers */
+    for (i = 0; i < AIOWORKERS; i++) {
+        state_t workerState;
+        workerState.s_pc = (memaddr)aioWorker;
+        workerState.s_t9 = (memaddr)aioWorker;
+        workerState.s_sp = AIO_STACK(i);
+        workerState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+        workerState.s_entryHI = 0; /* ASID 0 */
+        SYSCALL(CREATEPROCESS, (int)&workerState, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: aioSubmitSyscallHandler
+ *
+ * Description: Handles SYS26 (AIOSUBMIT). a1 = address of an aiocb_t.
+ *              Validates it, sets its aio_status to AIOPENDING and queues
+ *              it to the workers with its pages pinned; if that is not
+ *              possible, performs the transfer before returning
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              READY once the request is queued or done
+ *              ERROR if the control block already has a request in flight
+ *              ERROR if parameters are invalid (terminates the process)
+ * ======================================================================== */
+int aioSubmitSyscallHandler(support_PTR supportStruct) {
+    /* Extract and validate parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr cb = exceptState->s_a1;
+    if (!validControlBlock(cb)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+    aiocb_PTR userCb = (aiocb_PTR)cb;
+    aiocb_t request = *userCb;
+    if (!validUserBlock(request.aio_line, request.aio_dev, request.aio_block) ||
+        !validateUserAddress(request.aio_buffer)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    /* A control block can only carry one request at a time */
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    if (findRequest(supportStruct->sup_asid, cb) != NULL) {
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        return ERROR;
+    }
+
+    /* Fault both pages in (the buffer dirty if the device writes it) */
+    userCb->aio_status = AIOPENDING;
+    volatile unsigned int *touch = (unsigned int *)request.aio_buffer;
+    unsigned int word = *touch;
+    if (!request.aio_write) {
+        *touch = word;
+    }
+
+    /* Take a slot and pin the pages */
+    aioRequest_PTR slot = aioFree_h;
+    int dataFrame = NOSWAPFRAME;
+    int cbFrame = NOSWAPFRAME;
+    if (slot != NULL) {
+        dataFrame = pinUserPage(supportStruct, request.aio_buffer, !request.aio_write);
+        if (dataFrame != NOSWAPFRAME) {
+            cbFrame = pinUserPage(supportStruct, cb & VPNMASK, TRUE);
+            if (cbFrame == NOSWAPFRAME) {
+                unpinUserPage(dataFrame);
+            }
+        }
+    }
+    if (cbFrame == NOSWAPFRAME) {
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+
+        /* Fall back to a synchronous transfer */
+        userCb->aio_status = userBlockIO(supportStruct, request.aio_line, request.aio_write,
+                                         request.aio_dev, request.aio_block, request.aio_buffer);
+        return READY;
+    }
+
+    /* Fill in the slot and append it to the work queue */
+    aioFree_h = slot->ar_next;
+    slot->ar_asid = supportStruct->sup_asid;
+    slot->ar_cb = cb;
+    slot->ar_cbCopy = request;
+    slot->ar_dataFrame = dataFrame;
+    slot->ar_cbFrame = cbFrame;
+    slot->ar_status = &((aiocb_PTR)(FRAMETOADDR(cbFrame) + (cb & (PAGESIZE - 1))))->aio_status;
+    slot->ar_done = FALSE;
+    slot->ar_doneSem = 0;
+    slot->ar_waiters = 0;
+    slot->ar_notify = NULL;
+    slot->ar_prefetch = NOBLOCK;
+    slot->ar_next = NULL;
+    if (aioQueue_t == NULL) {
+        aioQueue_h = slot;
+    } else {
+        aioQueue_t->ar_next = slot;
+    }
+    aioQueue_t = slot;
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+
+    /* Hand it to a worker */
+    SYSCALL(VERHOGEN, (int)&aioWorkSem, 0, 0);
+    return READY;
+}
+
+/* ========================================================================
+ * Function: aioWaitSyscallHandler
+ *
+ * Description: Handles SYS27 (AIOWAIT). a1 = address of an aiocb_t the
+ *              U-proc submitted. Blocks until that request is done
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              The request's final aio_status (READY or the error)
+ *              ERROR if the address is invalid (terminates the process)
+ * ======================================================================== */
+int aioWaitSyscallHandler(support_PTR supportStruct) {
+    /* Extract and validate parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr cb = exceptState->s_a1;
+    if (!validControlBlock(cb)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    aioRequest_PTR request = findRequest(supportStruct->sup_asid, cb);
+    if (request != NULL) {
+        /* Wait for the worker, then let the slot go if we are the last one out */
+        request->ar_waiters++;
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&request->ar_doneSem, 0, 0);
+        SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+        request->ar_waiters--;
+        if (request->ar_waiters == 0) {
+            freeRequest(request);
+        }
+    }
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+
+    return ((aiocb_PTR)cb)->aio_status;
+}
+
+/* ========================================================================
+ * Function: aioInFlight
+ *
+ * Description: Checks if an ASID's request for a control block is still
+ *              in flight (SYS53 readiness)
+ *
+ * Parameters:
+ *              asid - Submitting ASID
+ *              cb - User address of the control block
+ *
+ * Returns:
+ *              TRUE until the request's status is stored, else FALSE
+ * ======================================================================== */
+int aioInFlight(int asid, memaddr cb) {
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    int inFlight = (findRequest(asid, cb) != NULL);
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+    return inFlight;
+}
+
+/* ========================================================================
+ * Function: aioSubmitBlock
+ *
+ * Description: Queues a transfer for kernel code on a frame the caller
+ *              pinned. The worker performs it like a SYS26 request,
+ *              releases the frame's pin, stores the status in *status and
+ *              V's *doneSem; both must stay in place until then
+ *
+ * Parameters:
+ *              asid - ASID the transfer is charged to
+ *              line - DISKINT or FLASHINT
+ *              write - TRUE to write the frame to the device, FALSE to read
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              frame - Pinned swap pool frame to transfer
+ *              status - Kernel word the final status is stored in
+ *              doneSem - Semaphore V'd once the status is stored
+ *
+ * Returns:
+ *              TRUE if the request is queued
+ *              FALSE if no slot is free (the frame stays pinned)
+ * ======================================================================== */
+int aioSubmitBlock(int asid, int line, int write, int devNum, int block, int frame, int *status, int *doneSem) {
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    aioRequest_PTR slot = aioFree_h;
+    if (slot == NULL) {
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        return FALSE;
+    }
+
+    /* Fill in the slot and append it to the work queue */
+    aioFree_h = slot->ar_next;
+    slot->ar_asid = asid;
+    slot->ar_cb = 0;
+    slot->ar_cbCopy.aio_line = line;
+    slot->ar_cbCopy.aio_write = write;
+    slot->ar_cbCopy.aio_dev = devNum;
+    slot->ar_cbCopy.aio_block = block;
+    slot->ar_cbCopy.aio_buffer = FRAMETOADDR(frame);
+    slot->ar_cbCopy.aio_status = AIOPENDING;
+    slot->ar_dataFrame = frame;
+    slot->ar_cbFrame = NOSWAPFRAME;
+    slot->ar_status = status;
+    slot->ar_done = FALSE;
+    slot->ar_doneSem = 0;
+    slot->ar_waiters = 0;
+    slot->ar_notify = doneSem;
+    slot->ar_prefetch = NOBLOCK;
+    slot->ar_next = NULL;
+    if (aioQueue_t == NULL) {
+        aioQueue_h = slot;
+    } else {
+        aioQueue_t->ar_next = slot;
+    }
+    aioQueue_t = slot;
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+
+    /* Hand it to a worker */
+    SYSCALL(VERHOGEN, (int)&aioWorkSem, 0, 0);
+    return TRUE;
+}
+
+/* ========================================================================
+ * Function: aioPrefetch
+ *
+ * Description: Reads a block ahead into the block cache: takes a request
+ *              slot, claims the block's entry (startPrefetch) and queues
+ *              the fill to the workers. Called in the reading U-proc's
+ *              context
+ *
+ * Parameters:
+ *              asid - ASID the fill is charged to
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number on the device
+ *
+ * Returns:
+ *              TRUE if the block is cached, being filled or now queued
+ *              FALSE if no cache entry or request slot is free
+ * ======================================================================== */
+int aioPrefetch(int asid, int line, int devNum, int block) {
+    /* Take a slot first, so a claimed entry always has its fill queued */
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    aioRequest_PTR slot = aioFree_h;
+    if (slot != NULL) {
+        aioFree_h = slot->ar_next;
+        slot->ar_asid = asid;
+        slot->ar_cb = 0;
+        slot->ar_done = FALSE;
+    }
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+    if (slot == NULL) {
+        return FALSE;
+    }
+
+    int index;
+    int cached = startPrefetch(line, devNum, block, &index);
+    SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+    if (index == NOBLOCK) {
+        /* Already cached, or no entry to fill */
+        freeRequest(slot);
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        return cached;
+    }
+
+    /* Fill in the slot and append it to the work queue */
+    slot->ar_cbCopy.aio_line = line;
+    slot->ar_cbCopy.aio_write = FALSE;
+    slot->ar_cbCopy.aio_dev = devNum;
+    slot->ar_cbCopy.aio_block = block;
+    slot->ar_cbCopy.aio_buffer = BCACHE_ADDR(index);
+    slot->ar_cbCopy.aio_status = AIOPENDING;
+    slot->ar_dataFrame = NOSWAPFRAME;
+    slot->ar_cbFrame = NOSWAPFRAME;
+    slot->ar_status = NULL;
+    slot->ar_doneSem = 0;
+    slot->ar_waiters = 0;
+    slot->ar_notify = NULL;
+    slot->ar_prefetch = index;
+    slot->ar_next = NULL;
+    if (aioQueue_t == NULL) {
+        aioQueue_h = slot;
+    } else {
+        aioQueue_t->ar_next = slot;
+    }
+    aioQueue_t = slot;
+    SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+
+    /* Hand it to a worker */
+    SYSCALL(VERHOGEN, (int)&aioWorkSem, 0, 0);
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: aioWorker
+ *
+ * Description: Worker daemon. Takes the oldest queued request, performs
+ *              its transfer on the pinned buffer frame, stores the status
+ *              in the pinned control block, releases both pins and wakes
+ *              the request's waiters (freeing the slot if there are none).
+ *              A kernel request's status goes to its kernel word, and its
+ *              caller is woken instead. A read-ahead fills its block cache
+ *              entry and just frees the slot
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void aioWorker() {
+    while (TRUE) {
+        /* Wait for work */
+        SYSCALL(PASSEREN, (int)&aioWorkSem, 0, 0);
+        SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+        aioRequest_PTR request = aioQueue_h;
+        aioQueue_h = request->ar_next;
+        if (aioQueue_h == NULL) {
+            aioQueue_t = NULL;
+        }
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        aiocb_PTR cb = &request->ar_cbCopy;
+
+        /* A read-ahead fills its cache entry; nobody waits on the slot */
+        if (request->ar_prefetch != NOBLOCK) {
+            fillPrefetch(request->ar_prefetch, cb->aio_line, cb->aio_dev, cb->aio_block, request->ar_asid);
+            SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+            freeRequest(request);
+            SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+            continue;
+        }
+
+        /* Perform the transfer on the frame itself */
+        memaddr frame = FRAMETOADDR(request->ar_dataFrame);
+        int status;
+        if (BLOCKCACHE) {
+            if ((cb->aio_line == DISKINT) && (cb->aio_block >= diskSectors(cb->aio_dev))) {
+                status = ERROR;
+            } else if (cb->aio_write) {
+                status = cachedWrite(cb->aio_line, cb->aio_dev, cb->aio_block, frame, request->ar_asid);
+            } else {
+                status = cachedRead(cb->aio_line, cb->aio_dev, cb->aio_block, frame, request->ar_asid);
+            }
+        } else if (cb->aio_line == DISKINT) {
+            status = diskTransfer(cb->aio_write ? WRITEBLK : READBLK, cb->aio_dev, cb->aio_block, frame, request->ar_asid);
+        } else {
+            status = flashTransfer(cb->aio_write ? WRITE : READ, cb->aio_dev, cb->aio_block, frame, request->ar_asid);
+        }
+
+        /* Report the status while the control block is still pinned */
+        *request->ar_status = status;
+        unpinUserPage(request->ar_dataFrame);
+        if (request->ar_notify != NULL) {
+            /* A kernel request: nobody waits on the slot itself */
+            int *notify = request->ar_notify;
+            SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+            freeRequest(request);
+            SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+            SYSCALL(VERHOGEN, (int)notify, 0, 0);
+            continue;
+        }
+        unpinUserPage(request->ar_cbFrame);
+
+        /* Wake the waiters */
+        SYSCALL(PASSEREN, (int)&aioMutex, 0, 0);
+        int asid = request->ar_asid;
+        memaddr cbAddress = request->ar_cb;
+        request->ar_done = TRUE;
+        if (request->ar_waiters == 0) {
+            freeRequest(request);
+        } else {
+            int i;
+            for (i = 0; i < request->ar_waiters; i++) {
+                SYSCALL(VERHOGEN, (int)&request->ar_doneSem, 0, 0);
+            }
+        }
+        SYSCALL(VERHOGEN, (int)&aioMutex, 0, 0);
+        notifyWaiters(WAITAIO, asid, cbAddress);
+    }
+}
+
+/* ========================================================================
+ * Function: findRequest
+ *
+ * Description: Finds the slot of an ASID's unfinished request for a
+ *              control block (a finished slot may linger for its waiters).
+ *              Called with the request table mutex held
+ *
+ * Parameters:
+ *              asid - Submitting ASID
+ *              cb - User address of the control block
+ *
+ * Returns:
+ *              The slot, or NULL if no such request is in flight
+ * ======================================================================== */
+aioRequest_PTR findRequest(int asid, memaddr cb) {
+    int i;
+    for (i = 0; i < AIOSLOTS; i++) {
+        if ((aioTable[i].ar_asid == asid) && (aioTable[i].ar_cb == cb) && !aioTable[i].ar_done) {
+            return &aioTable[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========================================================================
+ * Function: freeRequest
+ *
+ * Description: Returns a slot to the free list. Called with the request
+ *              table mutex held
+ *
+ * Parameters:
+ *              request - Slot to free
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void freeRequest(aioRequest_PTR request) {
+    request->ar_asid = UNOCCUPIED;
+    request->ar_next = aioFree_h;
+    aioFree_h = request;
+}
+
+/* ========================================================================
+ * Function: validControlBlock
+ *
+ * Description: Checks that a control block address is word-aligned, in
+ *              user space and does not cross a page boundary
+ *
+ * Parameters:
+ *              cb - User address of the control block
+ *
+ * Returns:
+ *              TRUE if the address is usable, else FALSE
+ * ======================================================================== */
+int validControlBlock(memaddr cb) {
+    memaddr last = cb + sizeof(aiocb_t) - 1;
+    return ((cb & (WORDLEN - 1)) == 0) && validateUserAddress(cb) &&
+           ((cb & VPNMASK) == (last & VPNMASK));
+}
@@ -0,0 +1,639 @@
+/******************************* blockCache.c **********************************
+ *
+ * Module: Block Cache
+ *
+ * Description:
+ * This module keeps recently used disk sectors and flash blocks of the user
+ * DMA syscalls (SYS14-17) in BCACHEBLOCKS kernel frames carved out of RAM
+ * just below the DMA buffers, so a block read again by the same or another
+ * U-proc is copied from RAM instead of going to the device.
+ *
+ * Policy Decisions:
+ * - Replacement: A miss takes an empty entry if there is one, otherwise the
+ *   least recently used one (by the TOD of its last hit or fill)
+ * - Write-Back: A write only updates the cached copy and marks it dirty. A
+ *   dirty block reaches the device when it is evicted, when the flusher
+ *   daemon wakes (every BCACHEFLUSH microseconds), or on the final flush
+ *   before test() terminates. A write of a whole block never reads it first
+ * - Errors: A failed fill or eviction write-back fails the request with the
+ *   device status and leaves the cache as it was. A failed flush leaves the
+ *   block dirty to be retried on the next pass
+ * - Mutual Exclusion: One mutex guards the whole cache and is held across
+ *   the device I/O of a miss or write-back, which takes the device's own
+ *   lock under it (cache mutex first, then device). The pager never takes
+ *   the cache mutex, so a user page fault while copying is safe
+ * - Coherence: I/O that bypasses the cache (the vectored disk calls) holds
+ *   the cache mutex and drops every cached copy of its blocks first
+ * - Statistics: Hits and misses are counted in blockCacheHits and
+ *   blockCacheMisses
+ * - I/O Share: A fill is charged to the reading ASID, a write-back to the
+ *   last ASID that wrote the block, whenever and by whom it happens
+ * - Read-Ahead: A read-ahead (startPrefetch) claims an entry for its block
+ *   at once, FILLQUEUED, and an asynchronous I/O worker later fills the
+ *   frame without the cache mutex (fillPrefetch, FILLRUNNING), so hits on
+ *   other blocks go on meanwhile. A read of a block whose fill is still
+ *   queued takes the fill over and reads it itself (a write just claims
+ *   the entry), so no one waits behind the worker queue; only a running
+ *   fill is waited for. An entry with a fill pending is never chosen for
+ *   replacement, and at most RAFILLMAX are pending at once so a miss
+ *   always finds a victim. A block dropped while being filled stays
+ *   dropped, and a failed fill just empties the entry
+ *
+ * Functions:
+ * - initBlockCache: Empties the cache and launches the flusher daemon
+ * - cachedRead: Reads a block through the cache
+ * - cachedWrite: Writes a block into the cache
+ * - flushBlockCache: Writes every dirty block to its device
+ * - lockBlockCache: Gains the cache mutex for I/O that bypasses the cache
+ * - unlockBlockCache: Releases the cache mutex
+ * - dropCachedBlock: Writes back and forgets a block (cache mutex held)
+ * - startPrefetch: Claims an entry for a block to read ahead
+ * - fillPrefetch: Fills a claimed entry from its device
+ * - blockFlusher: The flusher daemon
+ * - findBlock: Looks up a cached block
+ * - waitBlock: Looks up a cached block, finishing or waiting out its fill
+ * - endFill: Ends the fill of an entry and wakes its waiters
+ * - claimBlock: Picks and empties an entry for a new block
+ * - writeBackBlock: Writes one dirty entry to its device
+ * - blockIO: Performs one device transfer for the cache
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/blockCache.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* deviceSupportDMA.c */
+extern void copyBlock(memaddr *src, memaddr *dest);
+/* flashLog.c */
+extern void cleanFlashLogs();
+
+/*----------------------------------------------------------------------------*/
+/* Global Variables */
+/*----------------------------------------------------------------------------*/
+unsigned int blockCacheHits;                    /* Requests served without device I/O */
+unsigned int blockCacheMisses;                  /* Requests that had to fill an entry */
+unsigned int blockCachePrefetches;              /* Entries filled by read-ahead */
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN cacheBlock_t blockCache[BCACHEBLOCKS];   /* Cache entries; entry i's data is at BCACHE_ADDR(i) */
+HIDDEN int cacheMutex;                          /* Block cache mutual exclusion semaphore */
+HIDDEN int fillSem[BCACHEBLOCKS];               /* Requests waiting for each entry's fill block here */
+HIDDEN int cacheFilling;                        /* Entries with a read-ahead fill pending */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void blockFlusher();
+HIDDEN int findBlock(int line, int devNum, int block);
+HIDDEN int waitBlock(int line, int devNum, int block, int read, int asid);
+HIDDEN void endFill(int index, int status);
+HIDDEN int claimBlock(int *status);
+HIDDEN int writeBackBlock(int index);
+HIDDEN int blockIO(int write, int line, int devNum, int block, memaddr address, int asid);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initBlockCache
+ *
+ * Description: Empties every cache entry, clears the counters and, with
+ *              BLOCKCACHE set, launches the flusher daemon
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initBlockCache() {
+    int i;
+    for (i = 0; i < BCACHEBLOCKS; i++) {
+        blockCache[i].cb_line = 0;
+        blockCache[i].cb_dev = 0;
+        blockCache[i].cb_block = NOBLOCK;
+        blockCache[i].cb_dirty = FALSE;
+        blockCache[i].cb_asid = SYSTEMASID;
+        blockCache[i].cb_lastUse = 0;
+        blockCache[i].cb_fill = NOFILL;
+        blockCache[i].cb_waiters = 0;
+        fillSem[i] = 0;
+    }
+    blockCacheHits = 0;
+    blockCacheMisses = 0;
+    blockCachePrefetches = 0;
+    cacheMutex = 1;
+    cacheFilling = 0;
+
+    /* Launch the flusher daemon */
+    if (BLOCKCACHE) {
+        state_t flusherState;
+        flusherState.s_pc = (memaddr)blockFlusher;
+        flusherState.s_t9 = (memaddr)blockFlusher;
+        flusherState.s_sp = FLUSHER_STACK;
+        flusherState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+        flusherState.s_entryHI = 0; /* ASID 0 */
+        SYSCALL(CREATEPROCESS, (int)&flusherState, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: cachedRead
+ *
+ * Description: Copies a block to dest, from the cache on a hit (after
+ *              finishing or waiting out a read-ahead of it), otherwise
+ *              after filling an entry from the device
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              dest - Address to copy the block to
+ *              asid - ASID a fill is charged to
+ *
+ * Returns:
+ *              READY on success
+ *              Negative device status (or ERROR) if the fill or an
+ *              eviction write-back failed
+ * ======================================================================== */
+int cachedRead(int line, int devNum, int block, memaddr dest, int asid) {
+    int status = READY;
+
+    /* Gain cache mutual exclusion */
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+
+    int index = waitBlock(line, devNum, block, TRUE, asid);
+    if (index != NOBLOCK) {
+        blockCacheHits++;
+    } else {
+        blockCacheMisses++;
+        index = claimBlock(&status);
+        if (index != NOBLOCK) {
+            status = blockIO(FALSE, line, devNum, block, BCACHE_ADDR(index), asid);
+            if (status == READY) {
+                blockCache[index].cb_line = line;
+                blockCache[index].cb_dev = devNum;
+                blockCache[index].cb_block = block;
+            } else {
+                index = NOBLOCK;
+            }
+        }
+    }
+
+    if (index != NOBLOCK) {
+        STCK(blockCache[index].cb_lastUse);
+        copyBlock((memaddr *)BCACHE_ADDR(index), (memaddr *)dest);
+    }
+
+    /* Release cache mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+    return status;
+}
+
+/* ========================================================================
+ * Function: cachedWrite
+ *
+ * Description: Copies a block from src into its cache entry (claiming one
+ *              on a miss, without reading the device) and marks it dirty
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number; the caller
+ *                      has checked that it exists on the device
+ *              src - Address to copy the block from
+ *              asid - ASID its write-back is charged to
+ *
+ * Returns:
+ *              READY on success
+ *              Negative device status (or ERROR) if an eviction
+ *              write-back failed
+ * ======================================================================== */
+int cachedWrite(int line, int devNum, int block, memaddr src, int asid) {
+    int status = READY;
+
+    /* Gain cache mutual exclusion */
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+
+    int index = waitBlock(line, devNum, block, FALSE, asid);
+    if (index != NOBLOCK) {
+        blockCacheHits++;
+    } else {
+        blockCacheMisses++;
+        index = claimBlock(&status);
+        if (index != NOBLOCK) {
+            blockCache[index].cb_line = line;
+            blockCache[index].cb_dev = devNum;
+            blockCache[index].cb_block = block;
+        }
+    }
+
+    if (index != NOBLOCK) {
+        STCK(blockCache[index].cb_lastUse);
+        copyBlock((memaddr *)src, (memaddr *)BCACHE_ADDR(index));
+        blockCache[index].cb_dirty = TRUE;
+        blockCache[index].cb_asid = asid;
+    }
+
+    /* Release cache mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+    return status;
+}
+
+/* ========================================================================
+ * Function: flushBlockCache
+ *
+ * Description: Writes every dirty block to its device. Blocks whose write
+ *              fails stay dirty
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void flushBlockCache() {
+    /* Gain cache mutual exclusion */
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+
+    int i;
+    for (i = 0; i < BCACHEBLOCKS; i++) {
+        if (blockCache[i].cb_dirty) {
+            writeBackBlock(i);
+        }
+    }
+
+    /* Release cache mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: lockBlockCache
+ *
+ * Description: Gains the cache mutex for I/O that bypasses the cache, so
+ *              no cached copy of its blocks can appear meanwhile
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void lockBlockCache() {
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: unlockBlockCache
+ *
+ * Description: Releases the cache mutex taken by lockBlockCache
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void unlockBlockCache() {
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: dropCachedBlock
+ *
+ * Description: Writes a cached block back if it is dirty and empties its
+ *              entry. An entry with a read-ahead fill pending is emptied
+ *              at once (it is clean): a queued fill is called off, a
+ *              running one leaves it empty. Called with the cache mutex
+ *              held (lockBlockCache)
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *
+ * Returns:
+ *              READY if the block is no longer cached
+ *              Negative device status (or ERROR) if the write-back failed;
+ *              the block then stays cached and dirty
+ * ======================================================================== */
+int dropCachedBlock(int line, int devNum, int block) {
+    int index = findBlock(line, devNum, block);
+    if (index == NOBLOCK) {
+        return READY;
+    }
+    if (blockCache[index].cb_fill == FILLQUEUED) {
+        endFill(index, ERROR);
+        return READY;
+    }
+    int status = READY;
+    if (blockCache[index].cb_dirty) {
+        status = writeBackBlock(index);
+    }
+    if (status == READY) {
+        blockCache[index].cb_block = NOBLOCK;
+    }
+    return status;
+}
+
+/* ========================================================================
+ * Function: startPrefetch
+ *
+ * Description: Claims an entry for a block to read ahead with its fill
+ *              queued, so the block counts as cached from now on. The
+ *              caller queues its fillPrefetch
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number; the caller
+ *                      has checked that it exists on the device
+ *              index - Set to the claimed entry, NOBLOCK if the block is
+ *                      already cached or being filled
+ *
+ * Returns:
+ *              TRUE if the block is or will be cached
+ *              FALSE if RAFILLMAX fills are pending or an eviction
+ *              write-back failed
+ * ======================================================================== */
+int startPrefetch(int line, int devNum, int block, int *index) {
+    int status = READY;
+    int claimed = FALSE;
+    *index = NOBLOCK;
+
+    /* Gain cache mutual exclusion */
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+
+    if (findBlock(line, devNum, block) != NOBLOCK) {
+        claimed = TRUE;
+    } else if (cacheFilling < RAFILLMAX) {
+        *index = claimBlock(&status);
+        if (*index != NOBLOCK) {
+            blockCache[*index].cb_line = line;
+            blockCache[*index].cb_dev = devNum;
+            blockCache[*index].cb_block = block;
+            blockCache[*index].cb_fill = FILLQUEUED;
+            STCK(blockCache[*index].cb_lastUse);
+            cacheFilling++;
+            claimed = TRUE;
+        }
+    }
+
+    /* Release cache mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+    return claimed;
+}
+
+/* ========================================================================
+ * Function: fillPrefetch
+ *
+ * Description: Reads a block into the entry startPrefetch claimed for it,
+ *              without the cache mutex, then ends the fill; does nothing if
+ *              a reader took the fill over or the block was dropped
+ *              meanwhile. Called by an asynchronous I/O worker
+ *
+ * Parameters:
+ *              index - Claimed entry
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              asid - ASID the fill is charged to
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void fillPrefetch(int index, int line, int devNum, int block, int asid) {
+    /* Check the claim is still ours */
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+    if ((blockCache[index].cb_fill != FILLQUEUED) || (blockCache[index].cb_block != block) ||
+        (blockCache[index].cb_dev != devNum) || (blockCache[index].cb_line != line)) {
+        SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+        return;
+    }
+    blockCache[index].cb_fill = FILLRUNNING;
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+
+    int status = blockIO(FALSE, line, devNum, block, BCACHE_ADDR(index), asid);
+
+    SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+    if (status == READY) {
+        blockCachePrefetches++;
+    }
+    endFill(index, status);
+    SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: blockFlusher
+ *
+ * Description: The flusher daemon. Every BCACHEFLUSH microseconds it
+ *              writes the dirty blocks back, then lets the flash logs
+ *              clean and checkpoint
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void blockFlusher() {
+    while (TRUE) {
+        /* Sleep until the next pass */
+        cpu_t currTime;
+        STCK(currTime);
+        SYSCALL(WAITUNTIL, (int)(currTime + BCACHEFLUSH), 0, 0);
+
+        flushBlockCache();
+        if (FLASHLOG) {
+            cleanFlashLogs(); /* Clean and checkpoint the logs the flush appended to */
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: findBlock
+ *
+ * Description: Looks up the entry holding a block. Called with the cache
+ *              mutex held
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *
+ * Returns:
+ *              Index of the entry, NOBLOCK if the block is not cached
+ * ======================================================================== */
+int findBlock(int line, int devNum, int block) {
+    int i;
+    for (i = 0; i < BCACHEBLOCKS; i++) {
+        if ((blockCache[i].cb_block == block) && (blockCache[i].cb_dev == devNum) &&
+            (blockCache[i].cb_line == line)) {
+            return i;
+        }
+    }
+    return NOBLOCK;
+}
+
+/* ========================================================================
+ * Function: waitBlock
+ *
+ * Description: Looks up the entry holding a block like findBlock. If its
+ *              read-ahead is still queued, takes it over: a read fills the
+ *              entry here, a write (which replaces the whole block) just
+ *              keeps it. If the fill is running, waits for it (giving up
+ *              the cache mutex meanwhile) and looks again. Called with the
+ *              cache mutex held
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              read - TRUE if the caller reads the block
+ *              asid - ASID a fill taken over is charged to
+ *
+ * Returns:
+ *              Index of the filled entry, NOBLOCK if the block is not cached
+ * ======================================================================== */
+int waitBlock(int line, int devNum, int block, int read, int asid) {
+    int index = findBlock(line, devNum, block);
+    while ((index != NOBLOCK) && (blockCache[index].cb_fill == FILLRUNNING)) {
+        blockCache[index].cb_waiters++;
+        SYSCALL(VERHOGEN, (int)&cacheMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&fillSem[index], 0, 0);
+        SYSCALL(PASSEREN, (int)&cacheMutex, 0, 0);
+        index = findBlock(line, devNum, block);
+    }
+
+    if ((index != NOBLOCK) && (blockCache[index].cb_fill == FILLQUEUED)) {
+        int status = read ? blockIO(FALSE, line, devNum, block, BCACHE_ADDR(index), asid) : READY;
+        endFill(index, status);
+        if (status != READY) {
+            index = NOBLOCK;
+        }
+    }
+    return index;
+}
+
+/* ========================================================================
+ * Function: endFill
+ *
+ * Description: Ends a read-ahead fill (run, taken over or called off):
+ *              the entry may be replaced again, is emptied if the fill
+ *              failed, and its waiters look it up again. Called with the
+ *              cache mutex held
+ *
+ * Parameters:
+ *              index - Entry being filled
+ *              status - READY if its frame now holds the block
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void endFill(int index, int status) {
+    blockCache[index].cb_fill = NOFILL;
+    cacheFilling--;
+    if (status != READY) {
+        blockCache[index].cb_block = NOBLOCK;
+    }
+    while (blockCache[index].cb_waiters > 0) {
+        blockCache[index].cb_waiters--;
+        SYSCALL(VERHOGEN, (int)&fillSem[index], 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: claimBlock
+ *
+ * Description: Picks an empty entry, or else the least recently used one,
+ *              writing it back first if it is dirty, and empties it.
+ *              Entries with a fill pending are skipped. Called with the
+ *              cache mutex held
+ *
+ * Parameters:
+ *              status - Set to the write-back status if it failed
+ *
+ * Returns:
+ *              Index of the claimed entry, NOBLOCK if the write-back failed
+ * ======================================================================== */
+int claimBlock(int *status) {
+    int victim = NOBLOCK;
+    int i;
+    for (i = 0; i < BCACHEBLOCKS; i++) {
+        if (blockCache[i].cb_fill != NOFILL) {
+            continue;
+        }
+        if (blockCache[i].cb_block == NOBLOCK) {
+            return i;
+        }
+        if ((victim == NOBLOCK) || (blockCache[i].cb_lastUse < blockCache[victim].cb_lastUse)) {
+            victim = i;
+        }
+    }
+
+    if (blockCache[victim].cb_dirty) {
+        int writeStatus = writeBackBlock(victim);
+        if (writeStatus != READY) {
+            *status = writeStatus;
+            return NOBLOCK;
+        }
+    }
+    blockCache[victim].cb_block = NOBLOCK;
+    return victim;
+}
+
+/* ========================================================================
+ * Function: writeBackBlock
+ *
+ * Description: Writes a dirty entry to its device and marks it clean if
+ *              the write succeeded. Called with the cache mutex held
+ *
+ * Parameters:
+ *              index - Entry to write back
+ *
+ * Returns:
+ *              READY on success, negative device status (or ERROR) on error
+ * ======================================================================== */
+int writeBackBlock(int index) {
+    int status = blockIO(TRUE, blockCache[index].cb_line, blockCache[index].cb_dev,
+                         blockCache[index].cb_block, BCACHE_ADDR(index), blockCache[index].cb_asid);
+    if (status == READY) {
+        blockCache[index].cb_dirty = FALSE;
+    }
+    return status;
+}
+
+/* ========================================================================
+ * Function: blockIO
+ *
+ * Description: Moves one block between a cache frame and its device,
+ *              taking the device's grant for the transfer
+ *
+ * Parameters:
+ *              write - TRUE to write the frame, FALSE to read into it
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              address - Cache frame address
+ *              asid - ASID the transfer is charged to
+ *
+ * Returns:
+ *              READY on success, negative device status (or ERROR) on error
+ * ======================================================================== */
+int blockIO(int write, int line, int devNum, int block, memaddr address, int asid) {
+    if (line == DISKINT) {
+        return diskTransfer(write ? WRITEBLK : READBLK, devNum, block, address, asid);
+    }
+    return flashTransfer(write ? WRITE : READ, devNum, block, address, asid);
+}
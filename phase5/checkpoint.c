@@ -0,0 +1,386 @@
+/******************************* checkpoint.c *************************************
+ *
+ * Module: Checkpoints
+ *
+ * Description:
+ * This module implements SYS61 (CHECKPOINT), which saves the calling
+ * U-proc to a slot of disk CKPTDISK so that the next boot resumes it
+ * where it left off instead of starting its image over. A checkpoint is
+ * the saved state just past the SYSCALL (with CKPTRESUMED in v0) and the
+ * U-proc's private pages that differ from its image; its support
+ * structure and page table are rebuilt at boot as for any U-proc, and the
+ * pages left out come from the image or are zero-filled again.
+ *
+ * Policy Decisions:
+ * - Layout: ASID n's slot starts at sector CKPTSECTOR(n) of CKPTDISK,
+ *   past the boot configuration: a header sector, then one sector per
+ *   saved page in header order. No U-proc can reach DISK0 with SYS14-15
+ *   or the disk volume, so the slots are written around the block cache
+ * - Quiescence: Only the main thread of a configured U-proc running its
+ *   own image, with no other thread and no shared segment or disk map,
+ *   may checkpoint; anything else gets ERROR. Mailbox messages,
+ *   asynchronous I/O in flight, named semaphores and wired pages are not
+ *   saved, so a U-proc should checkpoint with none of them outstanding
+ * - Hot First: The pages resident at SYS61 (its working set) are saved
+ *   first, then those only in its own backing store (snapshotPages), so
+ *   a restore reads the working set first in one ascending sweep of
+ *   consecutive sectors
+ * - Consistency: The old header is overwritten with zeroes before any
+ *   page is written and the new one is written last, so a crash during
+ *   SYS61 leaves no checkpoint rather than a torn one. A header holds the
+ *   region the U-proc ran from and a checksum; at boot it is used only if
+ *   it is intact and the configuration still gives the ASID that region
+ * - Resume: A configured U-proc with a valid checkpoint is created in
+ *   kernel mode at resumeCheckpoint on its general exception stack. That
+ *   loads its first page (finding its text and BSS), reads each saved
+ *   page into a free frame and maps it dirty (attachUserPage), copying it
+ *   in instead when no frame is free, and then loads the saved state. If
+ *   a read fails the checkpoint is dropped and the U-proc starts its image
+ * - Lifetime: A checkpoint stays valid until its U-proc exits (SYS9 or a
+ *   trap), so a U-proc resumes from its last SYS61 at every boot until it
+ *   finishes. A newer SYS61 replaces it
+ * - Buffer: Pages and headers go through the U-proc's disk DMA buffer,
+ *   which only its own threads use, and it has none running
+ *
+ * Functions:
+ * - initCheckpoints: Finds the valid checkpoints of the configured U-procs
+ * - resumeFromCheckpoint: Makes a new U-proc start by restoring its checkpoint
+ * - checkpointSyscallHandler: Implements SYS61 (CHECKPOINT)
+ * - dropCheckpoint: Invalidates an exiting U-proc's checkpoint
+ * - resumeCheckpoint: Restores a U-proc's pages and resumes its saved state
+ * - validHeader: Checks a checkpoint header read from disk
+ * - headerSum: Computes a checkpoint header's checksum
+ * - ckptPageAddress: Returns the user address of a page number
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+#include "../h/checkpoint.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* sysSupport.c */
+extern support_PTR getCurrentSupportStruct();
+/* thread.c */
+extern int liveThreads(int asid);
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void resumeCheckpoint();
+HIDDEN int validHeader(ckptHeader_PTR header, int asid);
+HIDDEN unsigned int headerSum(ckptHeader_PTR header);
+HIDDEN memaddr ckptPageAddress(int pageNum);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int ckptSlots;                           /* ASIDs 1..ckptSlots may checkpoint */
+HIDDEN uprocImage_t ckptImage[MAXUPROC + 1];    /* Configured region of each of them */
+HIDDEN int ckptValid[MAXUPROC + 1];             /* Its slot holds a valid checkpoint */
+HIDDEN ckptHeader_t ckptHeader[MAXUPROC + 1];   /* Header of each checkpoint found at boot */
+HIDDEN state_t ckptStart[MAXUPROC + 1];         /* Image start state, if the restore fails */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initCheckpoints
+ *
+ * Description: Gives every configured U-proc whose slot fits on CKPTDISK
+ *              a checkpoint slot, and reads each slot's header to find
+ *              the valid checkpoints. Called once at boot, after the
+ *              configuration is read and before any U-proc is created
+ *              (the header is read through ASID 1's DMA buffer)
+ *
+ * Parameters:
+ *              config - The boot configuration
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initCheckpoints(uprocConfig_PTR config) {
+    ckptSlots = 0;
+    if (DEVDESC(DISKINT, CKPTDISK)->dd_reg->d_status != NOTINSTALLED) {
+        int sectors = diskSectors(CKPTDISK);
+        while ((ckptSlots < config->uc_count) && (CKPTSECTOR(ckptSlots + 2) <= sectors)) {
+            ckptSlots++;
+        }
+    }
+
+    ckptHeader_PTR block = (ckptHeader_PTR)DISK_DMABUFFER_ADDR(0);
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        ckptValid[asid] = FALSE;
+        if (asid > ckptSlots) {
+            continue;
+        }
+        copyWords((unsigned int *)&ckptImage[asid], (unsigned int *)&config->uc_image[asid - 1],
+                  sizeof(uprocImage_t) / WORDLEN);
+        if (CHECKPOINTS &&
+            (diskTransfer(READBLK, CKPTDISK, CKPTSECTOR(asid), (memaddr)block, SYSTEMASID) == READY) &&
+            validHeader(block, asid)) {
+            copyWords((unsigned int *)&ckptHeader[asid], (unsigned int *)block, sizeof(ckptHeader_t) / WORDLEN);
+            ckptValid[asid] = TRUE;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: resumeFromCheckpoint
+ *
+ * Description: Called as a configured U-proc is created: if it has a
+ *              valid checkpoint, its initial state is swapped for one
+ *              running resumeCheckpoint in kernel mode on its general
+ *              exception stack. The image start state is kept in case
+ *              the restore fails
+ *
+ * Parameters:
+ *              state - Initial state of the U-proc, changed if it resumes
+ *              asid - ASID of the U-proc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void resumeFromCheckpoint(state_PTR state, int asid) {
+    if (!CHECKPOINTS || (asid > ckptSlots) || !ckptValid[asid]) {
+        return;
+    }
+    copyWords((unsigned int *)&ckptStart[asid], (unsigned int *)state, sizeof(state_t) / WORDLEN);
+    state->s_pc = (memaddr)resumeCheckpoint;
+    state->s_t9 = (memaddr)resumeCheckpoint;
+    state->s_sp = UPROC_GEN_STACK(asid);
+    state->s_entryHI = asid << ASIDSHIFT;
+    state->s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+}
+
+/* ========================================================================
+ * Function: checkpointSyscallHandler
+ *
+ * Description: Implements SYS61: saves the calling U-proc to its slot.
+ *              The old header is zeroed, the listed pages (resident ones
+ *              first) are copied out through the DMA buffer one sector
+ *              each, and the new header, holding the saved state with
+ *              CKPTRESUMED as the SYSCALL's result, is written last
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *
+ * Returns:
+ *              SUCCESS once the checkpoint is on disk (CKPTRESUMED when
+ *              it is resumed), ERROR if the caller may not checkpoint or
+ *              a write failed (no checkpoint is left then)
+ * ======================================================================== */
+int checkpointSyscallHandler(support_PTR supportStruct) {
+    int asid = supportStruct->sup_asid;
+    if (!CHECKPOINTS || (asid > ckptSlots) || (supportStruct->sup_thread != NOTHREAD) || (liveThreads(asid) > 0)) {
+        return ERROR;
+    }
+    unsigned char pages[CKPTPAGES];
+    int hot;
+    int count = snapshotPages(supportStruct, pages, &hot);
+    if (count == ERROR) {
+        return ERROR;
+    }
+
+    /* From here the old checkpoint is gone */
+    memaddr buffer = DISK_DMABUFFER_ADDR(asid - 1);
+    dropCheckpoint(asid);
+
+    /* Copy the pages out; touching one not resident faults it in */
+    int i;
+    for (i = 0; i < count; i++) {
+        copyPage((unsigned int *)buffer, (unsigned int *)ckptPageAddress(pages[i]));
+        if (diskTransfer(WRITEBLK, CKPTDISK, CKPTSECTOR(asid) + 1 + i, buffer, asid) != READY) {
+            return ERROR;
+        }
+    }
+
+    /* The header last: it makes the checkpoint valid */
+    ckptHeader_PTR header = (ckptHeader_PTR)buffer;
+    zeroPage((unsigned int *)buffer);
+    header->ck_magic = CKPTMAGIC;
+    header->ck_asid = asid;
+    copyWords((unsigned int *)&header->ck_image, (unsigned int *)&ckptImage[asid], sizeof(uprocImage_t) / WORDLEN);
+    copyWords((unsigned int *)&header->ck_state, (unsigned int *)&supportStruct->sup_exceptState[GENERALEXCEPT],
+              sizeof(state_t) / WORDLEN);
+    header->ck_state.s_v0 = CKPTRESUMED;
+    header->ck_pages = count;
+    header->ck_hot = hot;
+    for (i = 0; i < count; i++) {
+        header->ck_page[i] = pages[i];
+    }
+    header->ck_sum = headerSum(header);
+    if (diskTransfer(WRITEBLK, CKPTDISK, CKPTSECTOR(asid), buffer, asid) != READY) {
+        return ERROR;
+    }
+    ckptValid[asid] = TRUE;
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * Function: dropCheckpoint
+ *
+ * Description: Zeroes a U-proc's checkpoint header, so no boot resumes
+ *              it. Called by the U-proc itself (exitUProcess, SYS61),
+ *              with no other thread of it running
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void dropCheckpoint(int asid) {
+    if ((asid > ckptSlots) || !ckptValid[asid]) {
+        return;
+    }
+    memaddr buffer = DISK_DMABUFFER_ADDR(asid - 1);
+    zeroPage((unsigned int *)buffer);
+    diskTransfer(WRITEBLK, CKPTDISK, CKPTSECTOR(asid), buffer, asid);
+    ckptValid[asid] = FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: resumeCheckpoint
+ *
+ * Description: Runs first in a U-proc created from its checkpoint, in
+ *              kernel mode under its ASID. Its first page is loaded from
+ *              the image before anything else, since that load finds the
+ *              text and BSS pages. Each saved page is then read in header
+ *              order (the working set first) into a free frame that is
+ *              mapped dirty as the page, or copied in through the DMA
+ *              buffer if no frame is free or the page can not be mapped.
+ *              Ends by loading the saved state; a failed read drops the
+ *              checkpoint and starts the U-proc's image over instead
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None (does not return)
+ * ======================================================================== */
+void resumeCheckpoint() {
+    support_PTR supportStruct = getCurrentSupportStruct();
+    int asid = supportStruct->sup_asid;
+    ckptHeader_PTR header = &ckptHeader[asid];
+    memaddr buffer = DISK_DMABUFFER_ADDR(asid - 1);
+
+    volatile unsigned int *touch = (unsigned int *)KUSEG;
+    (void)*touch;
+
+    int status = READY;
+    int i;
+    for (i = 0; (status == READY) && (i < header->ck_pages); i++) {
+        memaddr page = ckptPageAddress(header->ck_page[i]);
+        int sector = CKPTSECTOR(asid) + 1 + i;
+        int frameNum = takeTransitFrame();
+        if (frameNum == NOSWAPFRAME) {
+            status = diskTransfer(READBLK, CKPTDISK, sector, buffer, asid);
+            if (status == READY) {
+                copyPage((unsigned int *)page, (unsigned int *)buffer);
+            }
+        } else {
+            status = diskTransfer(READBLK, CKPTDISK, sector, FRAMETOADDR(frameNum), asid);
+            if ((status != READY) || !attachUserPage(supportStruct, page, frameNum)) {
+                if (status == READY) {
+                    copyPage((unsigned int *)page, (unsigned int *)FRAMETOADDR(frameNum));
+                }
+                releaseMessageFrame(frameNum);
+            }
+        }
+    }
+
+    if (status != READY) {
+        dropCheckpoint(asid);
+        resetAddressSpace(supportStruct);
+        resumeState(&ckptStart[asid]);
+    }
+    resumeState(&header->ck_state);
+}
+
+/* ========================================================================
+ * Function: validHeader
+ *
+ * Description: Checks a header read from an ASID's slot: the magic
+ *              number, ASID and checksum, a page list that fits, and the
+ *              region the configuration gives the ASID now
+ *
+ * Parameters:
+ *              header - Header read from disk
+ *              asid - ASID whose slot it was read from
+ *
+ * Returns:
+ *              TRUE if the checkpoint can be resumed, else FALSE
+ * ======================================================================== */
+int validHeader(ckptHeader_PTR header, int asid) {
+    if ((header->ck_magic != CKPTMAGIC) || (header->ck_asid != asid) || (header->ck_sum != headerSum(header)) ||
+        (header->ck_pages < 0) || (header->ck_pages > CKPTPAGES) ||
+        (header->ck_hot < 0) || (header->ck_hot > header->ck_pages) ||
+        (header->ck_image.ui_flash != ckptImage[asid].ui_flash) ||
+        (header->ck_image.ui_base != ckptImage[asid].ui_base) ||
+        (header->ck_image.ui_blocks != ckptImage[asid].ui_blocks)) {
+        return FALSE;
+    }
+    int i;
+    for (i = 0; i < header->ck_pages; i++) {
+        if (header->ck_page[i] >= CKPTPAGES) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* ========================================================================
+ * Function: headerSum
+ *
+ * Description: Computes a header's checksum over its words before ck_sum,
+ *              rotating the running sum before each is added so that
+ *              swapped words change it too
+ *
+ * Parameters:
+ *              header - Checkpoint header
+ *
+ * Returns:
+ *              The checksum
+ * ======================================================================== */
+unsigned int headerSum(ckptHeader_PTR header) {
+    unsigned int *word = (unsigned int *)header;
+    int words = ((memaddr)&header->ck_sum - (memaddr)header) / WORDLEN;
+    unsigned int sum = CKPTMAGIC;
+    int i;
+    for (i = 0; i < words; i++) {
+        sum = ((sum << 5) | (sum >> 27)) + word[i];
+    }
+    return sum;
+}
+
+/* ========================================================================
+ * Function: ckptPageAddress
+ *
+ * Description: Returns the user address of a page number, the inverse of
+ *              pageNumber: KUSEG pages, the stack page, then the stack
+ *              extension pages going down from it
+ *
+ * Parameters:
+ *              pageNum - Page number (below CKPTPAGES)
+ *
+ * Returns:
+ *              The page-aligned user address
+ * ======================================================================== */
+memaddr ckptPageAddress(int pageNum) {
+    if (pageNum >= MAXPAGES) {
+        return UPAGESTACK - ((pageNum - MAXPAGES + 1) * PAGESIZE);
+    }
+    if (pageNum == USTACKNUM) {
+        return UPAGESTACK;
+    }
+    return KUSEG + (pageNum << VPNSHIFT);
+}
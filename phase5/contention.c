@@ -0,0 +1,181 @@
+/******************************* contention.c *************************************
+ *
+ * Module: Semaphore Contention Statistics
+ *
+ * Description:
+ * This module counts, per semaphore address, the P operations done on it,
+ * how many of them blocked, and the total and longest time the blocked
+ * ones waited. All Support Level mutual exclusion (swapPoolMutex,
+ * adlMutex, deviceMutex[], masterSema4, ...) is done with nucleus
+ * semaphores, so this tells how contended each of them is.
+ *
+ * Implementation:
+ * Statistics live in a static open-addressing table of LOCKSLOTS entries
+ * keyed by semaphore address (Fibonacci hashed like the ASL, linear
+ * probing), so recording never allocates. passeren counts every P; a P
+ * that blocks is stamped with p_blockStart as before, and verhogen counts
+ * the wait of the process it wakes. Device and pseudo-clock semaphores are
+ * counted too (SYS5 and SYS7 are P operations). Once the table is full,
+ * new addresses are not counted. The Support Level copies the table out
+ * with SYS34.
+ *
+ * Functions:
+ * - initLockStats: Empties the statistics table.
+ * - lockAcquired: Counts a P on a semaphore.
+ * - lockWaited: Counts the wait of a P that was woken.
+ * - readLockStats: Copies out part of the table.
+ * - lockSlot: Finds (or claims) the entry of a semaphore.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/contention.h"
+
+/******************** Module Variables ********************/
+HIDDEN lockStat_t lockStats[LOCKSLOTS];     /* Statistics of each semaphore seen */
+
+/******************** Function Prototypes ********************/
+HIDDEN lockStat_PTR lockSlot(int *semAdd);
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initLockStats
+ *
+ * Description: Empties the statistics table.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initLockStats() {
+    int slot;
+    for (slot = 0; slot < LOCKSLOTS; slot++) {
+        lockStats[slot].ls_semAdd = NULL;
+        lockStats[slot].ls_acquires = 0;
+        lockStats[slot].ls_contended = 0;
+        lockStats[slot].ls_totalWait = 0;
+        lockStats[slot].ls_maxWait = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: lockAcquired
+ *
+ * Description: Counts a P on a semaphore, and whether it blocked.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *              contended - TRUE if the P blocked
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void lockAcquired(int *semAdd, int contended) {
+    if (!LOCKSTATS) {
+        return;
+    }
+
+    lockStat_PTR stat = lockSlot(semAdd);
+    if (stat != NULL) {
+        stat->ls_acquires++;
+        if (contended) {
+            stat->ls_contended++;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: lockWaited
+ *
+ * Description: Counts the time a woken P spent blocked on a semaphore.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *              wait - Time blocked (us)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void lockWaited(int *semAdd, cpu_t wait) {
+    if (!LOCKSTATS) {
+        return;
+    }
+
+    lockStat_PTR stat = lockSlot(semAdd);
+    if (stat != NULL) {
+        stat->ls_totalWait += wait;
+        if (wait > stat->ls_maxWait) {
+            stat->ls_maxWait = wait;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: readLockStats
+ *
+ * Description: Copies up to maxStats used entries, starting with the
+ *              first-th used one, into buffer with interrupts off. The
+ *              statistics keep counting; they are not cleared.
+ *
+ * Parameters:
+ *              buffer - Destination array (in kernel memory)
+ *              first - Used entries to skip
+ *              maxStats - Capacity of the destination array
+ *
+ * Returns:
+ *              Number of entries copied
+ * ======================================================================== */
+int readLockStats(lockStat_PTR buffer, int first, int maxStats) {
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+
+    int count = 0;
+    int slot;
+    for (slot = 0; (slot < LOCKSLOTS) && (count < maxStats); slot++) {
+        if (lockStats[slot].ls_semAdd == NULL) {
+            continue;
+        }
+        if (first > 0) {
+            first--;
+            continue;
+        }
+        buffer[count++] = lockStats[slot];
+    }
+
+    setSTATUS(status);
+    return count;
+}
+
+/* ========================================================================
+ * Function: lockSlot
+ *
+ * Description: Finds the entry of a semaphore, claiming a free one the
+ *              first time the semaphore is seen.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *
+ * Returns:
+ *              Its entry, or NULL if the table is full
+ * ======================================================================== */
+HIDDEN lockStat_PTR lockSlot(int *semAdd) {
+    unsigned int slot = (((unsigned int)semAdd >> 2) * ASLHASHMULT) >> (32 - LOCKHASHBITS);
+    int probes;
+    for (probes = 0; probes < LOCKSLOTS; probes++) {
+        lockStat_PTR stat = &lockStats[slot];
+        if (stat->ls_semAdd == semAdd) {
+            return stat;
+        }
+        if (stat->ls_semAdd == NULL) {
+            stat->ls_semAdd = semAdd;
+            return stat;
+        }
+        slot = (slot + 1) & (LOCKSLOTS - 1);
+    }
+    return NULL;
+}
@@ -3,19 +3,39 @@
  * Module: Delay Daemon
  *
  * Implements the delay facility for user processes using an
- * Active Delay List (ADL) and a Delay Daemon process. The ADL is a sorted
- * singly linked list of delay descriptors, each representing a sleeping
- * U-proc and its wakeup time. The Delay Daemon wakes up sleeping U-procs
- * at the appropriate time.
+ * Active Delay List (ADL) and a Delay Daemon process. The ADL is a pairing
+ * min-heap of delay descriptors ordered by wakeup time, each representing
+ * a sleeping U-proc. A descriptor's d_child is its first child and d_next
+ * its next sibling, so insertion is a single constant time merge with the
+ * root, and taking the earliest deadline off costs O(log n) amortized. The
+ * Delay Daemon wakes up sleeping U-procs at the appropriate time.
+ *
+ * SYS18 sleeps for whole seconds and SYS28 for microseconds; both land on
+ * the same ADL, and with the nucleus arming its interval timer for the
+ * exact WAITUNTIL deadline a wakeup is not rounded to a pseudo-clock tick.
+ *
+ * Descriptors come from a free list seeded with a static table and grown a
+ * kernel frame at a time from the slab, so the number of pending delays is
+ * bounded only by RAM rather than one per U-proc.
+ *
+ * The Delay Daemon does not poll the pseudo-clock. It sleeps with the
+ * nucleus WAITUNTIL call until the deadline at the head of the ADL, as a P
+ * on daemonSem, and parks on daemonSem alone while the ADL is empty. A
+ * SYS18 whose descriptor lands at the head of the ADL V-s daemonSem so the
+ * daemon wakes early and sleeps again for the new, nearer deadline.
  *
  * Functions:
  *   - initADL: Initializes the ADL and launches the Delay Daemon
  *   - delaySyscallHandler: Handles the SYS18 (Delay) system call
+ *   - delayMicroSyscallHandler: Handles the SYS28 (Microsecond Delay) call
+ *   - sleepFor: Puts the calling U-proc on the ADL for a number of microseconds
  *   - delayDaemon: The Delay Daemon process
- *   - findDelayd: Find the delay descriptor for a given wake time
+ *   - mergeDelayd: Merge two delay heaps
  *   - allocDelayd: Allocate a delay descriptor from the free list
  *   - freeDelayd: Return a delay descriptor to the free list
- *   - insertADL: Insert a delay descriptor into the ADL in sorted order
+ *   - growDelayds: Add a slab frame of descriptors to the free list
+ *   - insertADL: Insert a delay descriptor into the ADL heap
+ *   - popADL: Remove the descriptor with the earliest wake time
  *   - removeExpiredADL: Remove expired descriptors from the ADL, wake up
  *                       processes, and free descriptors
  *
@@ -28,20 +48,23 @@
 /*----------------------------------------------------------------------------*/
 /* Hidden Global Variables */
 /*----------------------------------------------------------------------------*/
-HIDDEN delayd_t delaydTable[MAXUPROC + 2];  /* Static array of delay descriptors (+2 for two sentinel nodes) */
-HIDDEN delayd_PTR adl_h;                    /* Head sentinel for ADL */
-HIDDEN delayd_PTR adl_t;                    /* Tail sentinel for ADL */
+HIDDEN delayd_t delaydTable[MAXUPROC];      /* Static array of delay descriptors seeding the free list */
+HIDDEN delayd_PTR adlRoot;                  /* Root of the ADL heap (earliest wake time), NULL if empty */
 HIDDEN delayd_PTR delaydFree_h;             /* Head of free list */
 HIDDEN int adlMutex;                        /* ADL mutual exclusion semaphore */
+HIDDEN int daemonSem;                       /* V-ed when a new ADL head needs the Delay Daemon sooner */
 
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
 /*----------------------------------------------------------------------------*/
 HIDDEN void delayDaemon();
-HIDDEN delayd_PTR findDelayd(int wakeTime, delayd_PTR *prev);
+HIDDEN void sleepFor(support_PTR supportStruct, int micros);
+HIDDEN delayd_PTR mergeDelayd(delayd_PTR a, delayd_PTR b);
 HIDDEN delayd_PTR allocDelayd();
 HIDDEN void freeDelayd(delayd_PTR node);
+HIDDEN void growDelayds();
 HIDDEN void insertADL(delayd_PTR node);
+HIDDEN delayd_PTR popADL();
 HIDDEN void removeExpiredADL(cpu_t currTime);
 
 /*----------------------------------------------------------------------------*/
@@ -52,7 +75,8 @@ HIDDEN void removeExpiredADL(cpu_t currTime);
  * Function: initADL
  *
  * Description: Initializes the ADL and launches the Delay Daemon process
- *              Sets up the two sentinels, free list, and ADL semaphore
+ *              Empties the heap, seeds the free list, and sets up the ADL
+ *              semaphore
  *
  * Parameters:
  *              None
@@ -62,22 +86,17 @@ HIDDEN void removeExpiredADL(cpu_t currTime);
  * 
  * ======================================================================== */
 void initADL() {
-    /* Set up head and tail sentinels */
-    adl_h = &delaydTable[0];
-    adl_t = &delaydTable[1];
-    adl_h->d_wakeTime = 0;           /* Smallest possible wake time */
-    adl_t->d_wakeTime = MAXINT;      /* Largest possible wake time */
-    adl_h->d_next = adl_t;
-    adl_t->d_next = NULL;
+    /* Empty heap */
+    adlRoot = NULL;
 
-    /* Initialize free list with the rest of the descriptors */
+    /* Initialize free list with the static descriptors */
     delaydFree_h = NULL;
     int i;
-    for (i = 2; i < (MAXUPROC + 2); ++i) {
-        delaydTable[i].d_next = delaydFree_h;
-        delaydFree_h = &delaydTable[i];
+    for (i = 0; i < MAXUPROC; ++i) {
+        freeDelayd(&delaydTable[i]);
     }
     adlMutex = 1; /* Initialize ADL mutex */
+    daemonSem = 0;
 
     /* Launch Delay Daemon */
     state_t daemonState;
@@ -106,11 +125,53 @@ void initADL() {
 void delaySyscallHandler(support_PTR supportStruct) {
     /* Validate number of seconds */
     int seconds = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
-    if (seconds < 0) {
+    if ((seconds < 0) || (seconds > (MAXINT / MILLION))) {
         terminateUProcess(NULL); /* Terminate process */
         return;
     }
+    sleepFor(supportStruct, seconds * MILLION);
+}
+
+/* ========================================================================
+ * Function: delayMicroSyscallHandler
+ *
+ * Description: Handles the SYS28 (Microsecond Delay) system call: Puts
+ *              the calling U-proc to sleep for the requested number of
+ *              microseconds
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the support structure of the calling process
+ *
+ * Returns:
+ *              None
+ * 
+ * ======================================================================== */
+void delayMicroSyscallHandler(support_PTR supportStruct) {
+    /* Validate number of microseconds */
+    int micros = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    if (micros < 0) {
+        terminateUProcess(NULL); /* Terminate process */
+        return;
+    }
+    sleepFor(supportStruct, micros);
+}
 
+/* ========================================================================
+ * Function: sleepFor
+ *
+ * Description: Puts a delay descriptor for the calling U-proc on the ADL
+ *              and blocks the U-proc on its private semaphore until the
+ *              Delay Daemon wakes it
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the support structure of the calling process
+ *              micros - Microseconds to sleep (validated)
+ *
+ * Returns:
+ *              None
+ * 
+ * ======================================================================== */
+HIDDEN void sleepFor(support_PTR supportStruct, int micros) {
     /* Gain ADL mutual exclusion */
     SYSCALL(PASSEREN, (int)&adlMutex, 0, 0);
 
@@ -124,12 +185,17 @@ void delaySyscallHandler(support_PTR supportStruct) {
     /* Initialize delay descriptor */
     cpu_t currTime;
     STCK(currTime);
-    delayd_node->d_wakeTime = currTime + (seconds * 1000000);
+    delayd_node->d_wakeTime = currTime + micros;
     delayd_node->d_supStruct = supportStruct;
     
     /* Insert into ADL */
     insertADL(delayd_node);
 
+    /* A new earliest deadline: wake the Delay Daemon to sleep for it instead */
+    if (adlRoot == delayd_node) {
+        SYSCALL(VERHOGEN, (int)&daemonSem, 0, 0);
+    }
+
     /* Atomically release ADL mutex and block on private semaphore */
     setInterrupts(OFF);
     SYSCALL(VERHOGEN, (int)&adlMutex, 0, 0);
@@ -140,8 +206,10 @@ void delaySyscallHandler(support_PTR supportStruct) {
 /* ========================================================================
  * Function: delayDaemon
  *
- * Description: The Delay Daemon process. Waits for pseudo-clock and then
- *              wakes up any U-procs whose delay has expired
+ * Description: The Delay Daemon process. Wakes up any U-procs whose delay
+ *              has expired, then sleeps until the next deadline on the ADL
+ *              (or indefinitely while it is empty) unless daemonSem is V-ed
+ *              first by a SYS18 with an earlier deadline
  *
  * Parameters:
  *              None
@@ -152,9 +220,6 @@ void delaySyscallHandler(support_PTR supportStruct) {
  * ======================================================================== */
 HIDDEN void delayDaemon() {
     while (TRUE) {
-        /* Wait for pseudo-clock */
-        SYSCALL(WAITCLOCK, 0, 0, 0);
-
         /* Gain ADL mutual exclusion */
         SYSCALL(PASSEREN, (int)&adlMutex, 0, 0);
 
@@ -163,8 +228,18 @@ HIDDEN void delayDaemon() {
         STCK(currTime);
         removeExpiredADL(currTime);
 
-        /* Release ADL mutual exclusion */
+        /* Note the next deadline, then release ADL mutual exclusion */
+        int adlEmpty = (adlRoot == NULL);
+        cpu_t nextWake = adlEmpty ? 0 : adlRoot->d_wakeTime;
         SYSCALL(VERHOGEN, (int)&adlMutex, 0, 0);
+
+        /* Sleep until then; an insert at the head since the check above
+         * has already V-ed daemonSem, so it can not be missed */
+        if (adlEmpty) {
+            SYSCALL(PASSEREN, (int)&daemonSem, 0, 0);
+        } else {
+            SYSCALL(WAITUNTIL, (int)nextWake, (int)&daemonSem, 0);
+        }
     }
 }
 
@@ -173,47 +248,52 @@ HIDDEN void delayDaemon() {
 /*----------------------------------------------------------------------------*/
 
 /* ========================================================================
- * Function: findDelayd
+ * Function: mergeDelayd
  *
- * Description: Finds the delay descriptor with the smallest d_wakeTime
- *              greater than or equal to the given wakeTime
- *              Maintains a pointer to the previous node to assist insertion
+ * Description: Merges two delay heaps by making the root with the later
+ *              wake time the first child of the other
  *
  * Parameters:
- *              wakeTime - The wake time to search for
- *              prev - Pointer to store previous node
+ *              a - Root of one heap (or NULL)
+ *              b - Root of the other heap (or NULL)
  *
  * Returns:
- *              Pointer to the found delay descriptor, or tail sentinel if not found
+ *              Root of the merged heap
  * 
  * ======================================================================== */
-HIDDEN delayd_PTR findDelayd(int wakeTime, delayd_PTR *prev) {
-    delayd_PTR curr = adl_h->d_next; /* Start after head sentinel */
-    *prev = adl_h;
-    while (curr->d_wakeTime < wakeTime) { /* Sorted ascending by d_wakeTime */
-        *prev = curr;
-        curr = curr->d_next;
+HIDDEN delayd_PTR mergeDelayd(delayd_PTR a, delayd_PTR b) {
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    if (b->d_wakeTime < a->d_wakeTime) {
+        delayd_PTR swap = a;
+        a = b;
+        b = swap;
     }
-    return curr;
+    b->d_next = a->d_child;
+    a->d_child = b;
+    return a;
 }
 
 /* ========================================================================
  * Function: allocDelayd
  *
- * Description: Allocates a delay descriptor from the free list
+ * Description: Allocates a delay descriptor from the free list, growing
+ *              the list from the slab when it is empty
  * 
  * Parameters:
  *              None
  *
  * Returns:
- *              Pointer to allocated delayd_t, or NULL if free list is empty
+ *              Pointer to allocated delayd_t, or NULL if RAM is exhausted
  * 
  * ======================================================================== */
 HIDDEN delayd_PTR allocDelayd() {
-    if (!delaydFree_h) return NULL;
+    if (delaydFree_h == NULL) growDelayds();
+    if (delaydFree_h == NULL) return NULL;
     delayd_PTR node = delaydFree_h;
     delaydFree_h = delaydFree_h->d_next;
     node->d_next = NULL;
+    node->d_child = NULL;
     return node;
 }
 
@@ -234,11 +314,40 @@ HIDDEN void freeDelayd(delayd_PTR node) {
     delaydFree_h = node;
 }
 
+/* ========================================================================
+ * Function: growDelayds
+ *
+ * Description: Takes a kernel frame from the slab and adds every delay
+ *              descriptor that fits in it to the free list. The nucleus
+ *              takes slab frames too, so interrupts are off around the
+ *              allocation. Does nothing if RAM is exhausted
+ *
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * 
+ * ======================================================================== */
+HIDDEN void growDelayds() {
+    setInterrupts(OFF);
+    memaddr frame = allocSlabFrame();
+    setInterrupts(ON);
+    if (frame == NOFRAME) {
+        return;
+    }
+
+    delayd_PTR slab = (delayd_PTR)frame;
+    int i;
+    for (i = 0; i < (int)(PAGESIZE / sizeof(delayd_t)); i++) {
+        freeDelayd(&slab[i]);
+    }
+}
+
 /* ========================================================================
  * Function: insertADL
  *
- * Description: Inserts a delay descriptor into the ADL in ascending order
- *              of wake time
+ * Description: Inserts a delay descriptor into the ADL heap
  *
  * Parameters:
  *              node - Pointer to the delay descriptor to insert
@@ -248,10 +357,58 @@ HIDDEN void freeDelayd(delayd_PTR node) {
  * 
  * ======================================================================== */
 HIDDEN void insertADL(delayd_PTR node) {
-    delayd_PTR prev;
-    delayd_PTR curr = findDelayd(node->d_wakeTime, &prev);
-    node->d_next = curr;
-    prev->d_next = node;
+    node->d_next = NULL;
+    node->d_child = NULL;
+    adlRoot = mergeDelayd(adlRoot, node);
+}
+
+/* ========================================================================
+ * Function: popADL
+ *
+ * Description: Removes the root (earliest wake time) of the ADL heap and
+ *              rebuilds the heap from its children: they are merged in
+ *              pairs left to right, then the pairs are merged right to
+ *              left
+ *
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              The removed descriptor, or NULL if the ADL is empty
+ * 
+ * ======================================================================== */
+HIDDEN delayd_PTR popADL() {
+    delayd_PTR top = adlRoot;
+    if (top == NULL) return NULL;
+
+    /* First pass: merge the children in pairs, stacking the results */
+    delayd_PTR pairs = NULL;
+    delayd_PTR curr = top->d_child;
+    while (curr != NULL) {
+        delayd_PTR second = curr->d_next;
+        delayd_PTR rest = NULL;
+        curr->d_next = NULL;
+        if (second != NULL) {
+            rest = second->d_next;
+            second->d_next = NULL;
+        }
+        delayd_PTR merged = mergeDelayd(curr, second);
+        merged->d_next = pairs;
+        pairs = merged;
+        curr = rest;
+    }
+
+    /* Second pass: merge the stacked pairs into one heap */
+    adlRoot = NULL;
+    while (pairs != NULL) {
+        delayd_PTR next = pairs->d_next;
+        pairs->d_next = NULL;
+        adlRoot = mergeDelayd(adlRoot, pairs);
+        pairs = next;
+    }
+
+    top->d_child = NULL;
+    return top;
 }
 
 /* ========================================================================
@@ -270,19 +427,14 @@ HIDDEN void insertADL(delayd_PTR node) {
  * 
  * ======================================================================== */
 HIDDEN void removeExpiredADL(cpu_t currTime) {
-    delayd_PTR prev = adl_h;
-    delayd_PTR curr = adl_h->d_next;
-
-    while (curr != adl_t && curr->d_wakeTime <= currTime) {
-        delayd_PTR next = curr->d_next;
+    while ((adlRoot != NULL) && (adlRoot->d_wakeTime <= currTime)) {
+        delayd_PTR curr = popADL();
         /* Check if the process still exists before waking it up */
         if (curr->d_supStruct != NULL && curr->d_supStruct->sup_asid != UNOCCUPIED) {
             /* Wake up the sleeping process */
             SYSCALL(VERHOGEN, (int)&(curr->d_supStruct->sup_privateSem), 0, 0);
         }
-        /* Remove from ADL and free descriptor */
-        prev->d_next = next;
+        /* Free descriptor */
         freeDelayd(curr);
-        curr = next;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,244 @@
+/******************************* deviceStats.c *************************************
+ *
+ * Module: Device Utilization Statistics
+ *
+ * Description:
+ * This module keeps, for every device, the time it spent busy, the commands
+ * it completed by command code, the bytes they moved and the errors they
+ * returned, so saturated disks and flash devices can be spotted. The number
+ * of processes queued on the device's Support Level mutex is read from the
+ * ASL when the statistics are copied out, with SYS35.
+ *
+ * Implementation:
+ * Every driver writes its command and issues SYS5 with interrupts off, so
+ * waitIO is where a command starts: it stamps the TOD and the command code
+ * from the command register. The interrupt that acknowledges the device
+ * ends it: wakeDeviceWaiter adds the busy time and counts the command, its
+ * bytes (a page for disk and flash block transfers, a character for
+ * printers and terminals) and its status. Devices are numbered like their
+ * semaphores (DEVINDEX): devregarea_t order, terminal receivers last.
+ *
+ * Functions:
+ * - initDevStats: Empties the statistics of every device.
+ * - devIssued: Stamps a command being issued to a device.
+ * - devCompleted: Counts the command a device interrupt completes.
+ * - readDevStats: Copies out the statistics of a device.
+ * - commandBytes: Returns the bytes a command moves.
+ * - statusFailed: Tells whether a completion status is an error.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/deviceStats.h"
+#include "../h/interrupts.h"
+
+/******************** Module Variables ********************/
+HIDDEN devStat_t devStats[DEVDESCCOUNT];    /* Statistics of each device */
+
+/******************** Function Prototypes ********************/
+HIDDEN unsigned int commandBytes(int device, int command);
+HIDDEN int statusFailed(int device, unsigned int status);
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initDevStats
+ *
+ * Description: Empties the statistics of every device.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initDevStats() {
+    int device;
+    for (device = 0; device < DEVDESCCOUNT; device++) {
+        devStat_PTR stat = &devStats[device];
+        stat->ds_busyTime = 0;
+        int code;
+        for (code = 0; code < DEVCMDCODES; code++) {
+            stat->ds_ops[code] = 0;
+        }
+        stat->ds_bytes = 0;
+        stat->ds_errors = 0;
+        stat->ds_lastError = 0;
+        stat->ds_waiters = 0;
+        stat->ds_command = NOCOMMAND;
+        stat->ds_issueTOD = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: devIssued
+ *
+ * Description: Stamps the command a process is about to wait for with
+ *              SYS5. Called by waitIO, with interrupts off.
+ *
+ * Parameters:
+ *              device - Device number (DEVINDEX order)
+ *              command - Value of its command register
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void devIssued(int device, unsigned int command) {
+    if (!DEVSTATS) {
+        return;
+    }
+
+    devStat_PTR stat = &devStats[device];
+    stat->ds_command = command & DEVCMDMASK;
+    STCK(stat->ds_issueTOD);
+}
+
+/* ========================================================================
+ * Function: devCompleted
+ *
+ * Description: Counts the command an acknowledged device interrupt
+ *              completes: its busy time, its code, its bytes and, if the
+ *              status is an error, the error. Called by wakeDeviceWaiter.
+ *              An interrupt with no command stamped is not counted.
+ *
+ * Parameters:
+ *              device - Device number (DEVINDEX order)
+ *              status - Completion status of the device
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void devCompleted(int device, unsigned int status) {
+    if (!DEVSTATS) {
+        return;
+    }
+
+    devStat_PTR stat = &devStats[device];
+    int command = stat->ds_command;
+    if (command == NOCOMMAND) {
+        return;
+    }
+
+    cpu_t now;
+    STCK(now);
+    stat->ds_busyTime += now - stat->ds_issueTOD;
+    stat->ds_command = NOCOMMAND;
+    if (command < DEVCMDCODES) {
+        stat->ds_ops[command]++;
+    }
+
+    if (statusFailed(device, status)) {
+        stat->ds_errors++;
+        stat->ds_lastError = status;
+    } else {
+        stat->ds_bytes += commandBytes(device, command);
+    }
+}
+
+/* ========================================================================
+ * Function: readDevStats
+ *
+ * Description: Copies the statistics of a device into buffer with
+ *              interrupts off, filling in ds_waiters by walking the ASL
+ *              queue of the device's Support Level mutex. The statistics
+ *              keep counting; they are not cleared.
+ *
+ * Parameters:
+ *              device - Device number (DEVINDEX order)
+ *              buffer - Destination statistics (in kernel memory)
+ *
+ * Returns:
+ *              The device number, -1 if it is invalid
+ * ======================================================================== */
+int readDevStats(int device, devStat_PTR buffer) {
+    if ((device < 0) || (device >= DEVDESCCOUNT)) {
+        return -1;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+
+    devStat_PTR stat = &devStats[device];
+    stat->ds_waiters = 0;
+    if (deviceTable[device].dd_mutex != NULL) {
+        pcb_PTR head = headBlocked(deviceTable[device].dd_mutex);
+        if (head != NULL) {
+            pcb_PTR p = head;
+            do {
+                stat->ds_waiters++;
+                p = p->p_next;
+            } while (p != head);
+        }
+    }
+
+    buffer->ds_busyTime = stat->ds_busyTime;
+    int code;
+    for (code = 0; code < DEVCMDCODES; code++) {
+        buffer->ds_ops[code] = stat->ds_ops[code];
+    }
+    buffer->ds_bytes = stat->ds_bytes;
+    buffer->ds_errors = stat->ds_errors;
+    buffer->ds_lastError = stat->ds_lastError;
+    buffer->ds_waiters = stat->ds_waiters;
+    buffer->ds_command = stat->ds_command;
+    buffer->ds_issueTOD = stat->ds_issueTOD;
+
+    setSTATUS(status);
+    return device;
+}
+
+/* ========================================================================
+ * Function: commandBytes
+ *
+ * Description: Returns the bytes a completed command moved: a page for a
+ *              disk or flash block read or write, a character for a
+ *              printer or terminal transfer, nothing for anything else
+ *              (seeks, resets).
+ *
+ * Parameters:
+ *              device - Device number (DEVINDEX order)
+ *              command - Command code
+ *
+ * Returns:
+ *              Bytes moved
+ * ======================================================================== */
+HIDDEN unsigned int commandBytes(int device, int command) {
+    if (device >= TERMRECVINDEX(0)) {
+        return (command == PRINTCHR) ? 1 : 0;   /* RECEIVECHAR has PRINTCHR's code */
+    }
+
+    int line = (device / DEV_PER_LINE) + MAPINT;
+    if (line == DISKINT) {
+        return ((command == READBLK) || (command == WRITEBLK)) ? PAGESIZE : 0;
+    }
+    if (line == FLASHINT) {
+        return ((command == READ) || (command == WRITE)) ? PAGESIZE : 0;
+    }
+    if ((line == PRNTINT) || (line == TERMINT)) {
+        return (command == PRINTCHR) ? 1 : 0;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Function: statusFailed
+ *
+ * Description: Tells whether a completion status is an error: anything
+ *              but READY, or for a terminal half anything but RECVD
+ *              (character transmitted or received).
+ *
+ * Parameters:
+ *              device - Device number (DEVINDEX order)
+ *              status - Completion status
+ *
+ * Returns:
+ *              TRUE for an error status, FALSE otherwise
+ * ======================================================================== */
+HIDDEN int statusFailed(int device, unsigned int status) {
+    if (device >= DEVINDEX(TERMINT, 0)) {
+        return (status & TERMSTATMASK) != RECVD;
+    }
+    return status != READY;
+}
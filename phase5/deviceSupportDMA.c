@@ -0,0 +1,1210 @@
+/******************************* deviceSupportDMA.c ******************************
+ *
+ * Module: DMA Device Support
+ *
+ * Description:
+ * This module implements support for block-based DMA devices (disk and flash)
+ * and provides handlers for SYS14–SYS17 system calls. It manages data transfer
+ * between user space and device DMA buffers.
+ *
+ * Policy Decisions:
+ * - DMA Buffering: Dedicated kernel DMA buffers are used for all disk/flash
+ *   operations initiated via syscalls to ensure proper physical memory alignment
+ * - Backing Store Protection: Access via syscalls to a U-proc's backing
+ *   region on flash (its MAXPAGES image blocks and the STACKEXTPAGES +
+ *   SHADOWPAGES stack extension and image shadow blocks ending the
+ *   region, see reservedBlock) is prohibited and results in process
+ *   termination.
+ * - Parameter Validation: User-provided addresses and device/sector/block numbers
+ *   are validated; invalid parameters lead to process termination.
+ * - Seek Elision: The driver remembers each disk's head cylinder and issues
+ *   SEEKCYL only when a transfer targets a different one, so sequential
+ *   sectors on one cylinder cost a single interrupt each. Any failed command
+ *   forgets the position so the next transfer seeks again
+ * - Mutex Management: The module assumes that the caller holds the device's
+ *   grant (acquireDevice) before calling diskRW/flashRW.
+ * - Device Scheduling: Each disk and flash device keeps a queue of pending
+ *   requests. A caller enqueues its request (with its cylinder and the ASID
+ *   it is charged to) under the device's mutex and, if the device is busy,
+ *   blocks on the request's own semaphore until granted. When a request
+ *   finishes, its caller grants the device to the next one. The mutex only
+ *   guards the queue, so the device is never held while blocked
+ * - Fair Share: With IOFAIRSHARE set the next request comes from the ASIDs
+ *   in deficit round robin: the ASID whose round it is keeps the device
+ *   while it has requests queued and credit left, each block moved costing
+ *   one unit; then the next ASID with requests queued is credited its
+ *   weight (its resource group's, or lower if set with SYS57) times
+ *   IOQUANTUM. An ASID
+ *   whose queue runs dry loses unspent credit but keeps debt (a vectored
+ *   batch can overdraw). Within one ASID, and for every request without
+ *   IOFAIRSHARE, disks go in C-LOOK order with DISKSCAN set (the nearest
+ *   cylinder at or past the head, else the lowest cylinder), flash and the
+ *   rest in arrival order. So a U-proc issuing back-to-back requests gets
+ *   its share of a device but cannot starve the others of theirs. The
+ *   ASIDs' grants, blocks and queueing time are counted for SYS57
+ * - Vectored Disk I/O: SYS24/SYS25 take a user array of (page, sector)
+ *   pairs, validate all of it before any transfer, and stream the sectors
+ *   in ascending order under one disk grant, so the batch pays one queue
+ *   wait and seeks only between cylinders. The first failing sector stops
+ *   the batch
+ * - Block Cache: With BLOCKCACHE set, SYS14-17 read and write through the
+ *   block cache (blockCache.c) instead of the DMA buffers; a disk sector
+ *   past the end of the disk fails with ERROR before reaching the cache.
+ *   The vectored calls bypass the cache after dropping its copies of
+ *   their sectors
+ * - Zero-Copy: A transfer that bypasses the block cache points d_data0
+ *   straight at the user's frame when the buffer is page-aligned and
+ *   resident (pinUserPage keeps the frame in place for the transfer). Only
+ *   unaligned or non-resident buffers, or reads into shared text, go
+ *   through the DMA buffers and copyBlock
+ * - Read-Ahead: With READAHEAD (and BLOCKCACHE) set, SYS15/SYS17 follow
+ *   each ASID's stream on each device. A read of the block after the last
+ *   one read grows the stream's window (1, then doubling up to
+ *   RAMAXWINDOW); any other read closes it. The blocks up to a window
+ *   past the one just read are queued to the asynchronous I/O workers to
+ *   fill block cache entries (aioPrefetch), each block once, so a
+ *   sequential reader finds its next blocks in RAM or on their way. The
+ *   window stops at the end of the device and at reserved flash blocks,
+ *   and read-ahead that finds no cache entry or request slot is retried
+ *   on the next read
+ * - Flash Logs: With FLASHLOG set, flashTransfer hands the logged blocks
+ *   of a flash device (see flashLog.c) to logTransfer, which appends
+ *   writes to the device's log. The log's spare slots and checkpoints are
+ *   reserved like backing store blocks, and transfers that would use the
+ *   flash DMA buffer under the grant use the U-proc's disk DMA buffer
+ *   instead, as logTransfer takes the grant itself
+ * - Trace Device: The flash device the binary trace sink claimed at boot
+ *   (traceSink.c) may not be named by U-procs at all
+ * - Disk Buffers: Disk DMA buffers belong to U-procs (one per ASID) rather
+ *   than disks, so several requests can be queued on one disk at once, and
+ *   user copies happen outside the disk grant. The threads of a U-proc
+ *   take turns with its buffer under the ASID's buffer mutex
+ *
+ * Functions:
+ * - initDiskQueues: Initializes the per-device request queues
+ * - acquireDevice: Queues a request and waits for the device to be granted
+ * - releaseDevice: Charges a finished request and grants the next one
+ * - resetIOShare: Gives an ASID a fresh I/O share
+ * - readIOShare: Sums an ASID's I/O share over the devices
+ * - ioShareSyscallHandler: Implements SYS57 (IOSHARE)
+ * - diskTransfer: Performs one disk read/write under the disk grant
+ * - flashTransfer: Performs one flash read/write under the flash grant
+ * - diskSectors: Returns the number of sectors on a disk
+ * - flashRW: Performs read/write to flash device
+ * - diskRW: Performs read/write to disk device
+ * - diskPutSyscallHandler: Implements SYS14 (DISK_PUT)
+ * - diskGetSyscallHandler: Implements SYS15 (DISK_GET)
+ * - diskPutVSyscallHandler: Implements SYS24 (vectored DISK_PUT)
+ * - diskGetVSyscallHandler: Implements SYS25 (vectored DISK_GET)
+ * - flashPutSyscallHandler: Implements SYS16 (FLASH_PUT)
+ * - flashGetSyscallHandler: Implements SYS17 (FLASH_GET)
+ * - validUserBlock: Checks the device and block of a user DMA request
+ * - userBlockIO: Moves one block between a user page and a device
+ * - copyBlock: Copies one page between memory and device or cache buffers
+ * - pickRequest: Picks the next request of a device in fair share order
+ * - nearestRequest: Picks an ASID's next request in elevator order
+ * - grantRequest: Records a request's grant of its device
+ * - diskCylinder: Finds the cylinder of a linear sector
+ * - diskVectorRW: Validates and streams a vectored disk request
+ * - readAhead: Follows a read stream and queues its read-ahead
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/deviceSupportDMA.h"
+#include "../h/blockCache.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* asyncIO.c */
+extern int aioPrefetch(int asid, int line, int devNum, int block);
+/* flashLog.c */
+extern int flashLogged(int flashNum, int block);
+extern int logReservedBlock(int flashNum, int block);
+extern int logTransfer(int operation, int flashNum, int block, memaddr bufferAddr, int asid);
+/* traceSink.c */
+extern int traceSinkDevice(int flashNum);
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Declarations */
+/*----------------------------------------------------------------------------*/
+void copyBlock(memaddr *src, memaddr *dest);
+HIDDEN diskRequest_PTR pickRequest(int line, int devNum);
+HIDDEN diskRequest_PTR nearestRequest(int line, int devNum, int asid);
+HIDDEN void grantRequest(int line, int devNum, diskRequest_PTR request);
+HIDDEN int diskCylinder(int diskNum, int linearSector);
+HIDDEN int diskVectorRW(support_PTR supportStruct, int operation);
+HIDDEN void readAhead(int line, int devNum, int block, int asid);
+
+/*----------------------------------------------------------------------------*/
+/* Module variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN diskRequest_PTR ioQueue[DMALINES][DEV_PER_LINE];   /* Pending requests of each disk and flash device, oldest first */
+HIDDEN int ioBusy[DMALINES][DEV_PER_LINE];                /* A request holds the device's grant */
+HIDDEN int ioHolder[DMALINES][DEV_PER_LINE];              /* ASID charged for the granted request */
+HIDDEN int ioTurn[DMALINES][DEV_PER_LINE];                /* ASID whose round the device is serving */
+HIDDEN int ioDeficit[DMALINES][DEV_PER_LINE][MAXUPROC + 1]; /* Blocks each ASID may still move this round */
+HIDDEN int ioGrants[DMALINES][DEV_PER_LINE][MAXUPROC + 1];  /* Requests of each ASID granted the device */
+HIDDEN int ioBlocks[DMALINES][DEV_PER_LINE][MAXUPROC + 1];  /* Blocks each ASID moved on the device */
+HIDDEN cpu_t ioWait[DMALINES][DEV_PER_LINE][MAXUPROC + 1];  /* Time each ASID's requests spent queued */
+HIDDEN int ioWeight[MAXUPROC + 1];                 /* I/O weight of each ASID */
+HIDDEN int diskHead[DEV_PER_LINE];                 /* Cylinder of each disk's last granted request */
+HIDDEN int diskCylinderPos[DEV_PER_LINE];          /* Cylinder each disk's head is on (NOCYLINDER if unknown) */
+HIDDEN int bufferMutex[MAXUPROC + 1];              /* Semaphores for each ASID's disk DMA buffer */
+HIDDEN int raNext[DMALINES][DEV_PER_LINE][MAXUPROC + 1];    /* Block each ASID's stream reads next (NOBLOCK if none) */
+HIDDEN int raWindow[DMALINES][DEV_PER_LINE][MAXUPROC + 1];  /* Blocks read ahead of each stream */
+HIDDEN int raIssued[DMALINES][DEV_PER_LINE][MAXUPROC + 1];  /* First block of each stream not yet read ahead */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/******************************************************************************
+ * Function: initDiskQueues
+ *
+ * Description: Empties every disk's and flash device's request queue,
+ *              marks it idle with no I/O charged to any ASID, forgets each
+ *              disk's head position, gives every ASID the default I/O
+ *              weight and frees every DMA buffer
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void initDiskQueues() {
+    int q, i, asid;
+    for (q = 0; q < DMALINES; q++) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            ioQueue[q][i] = NULL;
+            ioBusy[q][i] = FALSE;
+            ioHolder[q][i] = SYSTEMASID;
+            ioTurn[q][i] = SYSTEMASID;
+            for (asid = 0; asid <= MAXUPROC; asid++) {
+                ioDeficit[q][i][asid] = 0;
+                ioGrants[q][i][asid] = 0;
+                ioBlocks[q][i][asid] = 0;
+                ioWait[q][i][asid] = 0;
+                raNext[q][i][asid] = NOBLOCK;
+                raWindow[q][i][asid] = 0;
+                raIssued[q][i][asid] = 0;
+            }
+        }
+    }
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        diskHead[i] = 0;
+        diskCylinderPos[i] = NOCYLINDER;
+    }
+    for (i = 0; i <= MAXUPROC; i++) {
+        bufferMutex[i] = 1;
+        ioWeight[i] = DEFAULTIOWEIGHT;
+    }
+}
+
+
+/******************************************************************************
+ * Function: acquireDevice
+ *
+ * Description: Adds a request for a disk sector or flash block, charged to
+ *              asid, to the end of the device's queue. If the device is
+ *              idle the request is granted at once; otherwise the caller
+ *              blocks on the request's semaphore until releaseDevice picks
+ *              it. The request must stay live (it is on the caller's
+ *              stack) until then.
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              request - Caller's request descriptor
+ *              block - Sector (disk) or block (flash) the caller will access
+ *              asid - ASID the transfer is charged to (SYSTEMASID for none)
+ *
+ * Returns:
+ *              None (the device is granted to the caller)
+ *****************************************************************************/
+void acquireDevice(int line, int devNum, diskRequest_PTR request, int block, int asid) {
+    int q = DMAQUEUE(line);
+    int *devMutex = DEVDESC(line, devNum)->dd_mutex;
+    request->dr_cylinder = (line == DISKINT) ? diskCylinder(devNum, block) : 0;
+    request->dr_asid = asid;
+    request->dr_sem = 0;
+    request->dr_next = NULL;
+    STCK(request->dr_queued);
+
+    /* Gain the queue's mutual exclusion */
+    SYSCALL(PASSEREN, (int)devMutex, 0, 0);
+    if (!ioBusy[q][devNum]) {
+        /* Idle device: take it */
+        ioBusy[q][devNum] = TRUE;
+        grantRequest(line, devNum, request);
+        SYSCALL(VERHOGEN, (int)devMutex, 0, 0);
+        return;
+    }
+
+    /* Join the end of the queue */
+    if (ioQueue[q][devNum] == NULL) {
+        ioQueue[q][devNum] = request;
+    } else {
+        diskRequest_PTR tail = ioQueue[q][devNum];
+        while (tail->dr_next != NULL) {
+            tail = tail->dr_next;
+        }
+        tail->dr_next = request;
+    }
+    SYSCALL(VERHOGEN, (int)devMutex, 0, 0);
+
+    /* Wait to be granted */
+    SYSCALL(PASSEREN, (int)&request->dr_sem, 0, 0);
+}
+
+
+/******************************************************************************
+ * Function: releaseDevice
+ *
+ * Description: Charges the blocks the finished request moved to its ASID,
+ *              then passes the device on to the request pickRequest
+ *              chooses. An empty queue leaves the device idle.
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              blocks - Sectors or blocks the request moved
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void releaseDevice(int line, int devNum, int blocks) {
+    int q = DMAQUEUE(line);
+    int *devMutex = DEVDESC(line, devNum)->dd_mutex;
+
+    /* Gain the queue's mutual exclusion */
+    SYSCALL(PASSEREN, (int)devMutex, 0, 0);
+    int holder = ioHolder[q][devNum];
+    ioBlocks[q][devNum][holder] += blocks;
+    ioDeficit[q][devNum][holder] -= blocks;
+
+    diskRequest_PTR next = pickRequest(line, devNum);
+    if (next == NULL) {
+        ioBusy[q][devNum] = FALSE;
+    } else {
+        /* Unlink the chosen request and grant it the device */
+        if (ioQueue[q][devNum] == next) {
+            ioQueue[q][devNum] = next->dr_next;
+        } else {
+            diskRequest_PTR prev = ioQueue[q][devNum];
+            while (prev->dr_next != next) {
+                prev = prev->dr_next;
+            }
+            prev->dr_next = next->dr_next;
+        }
+        grantRequest(line, devNum, next);
+        SYSCALL(VERHOGEN, (int)&next->dr_sem, 0, 0);
+    }
+    SYSCALL(VERHOGEN, (int)devMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ * Function: resetIOShare
+ *
+ * Description: Gives a new U-proc's ASID a fresh I/O share: no credit,
+ *              debt or accounting on any device, and the weight of the
+ *              U-proc it was cloned from (its resource group's for a new
+ *              one, which must have joined its group already)
+ *
+ * Parameters:
+ *              asid - ASID of the new U-proc
+ *              parent - ASID it was cloned from, UNOCCUPIED if none
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void resetIOShare(int asid, int parent) {
+    int q, i;
+    for (q = 0; q < DMALINES; q++) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            int *devMutex = DEVDESC(DISKINT + q, i)->dd_mutex;
+            SYSCALL(PASSEREN, (int)devMutex, 0, 0);
+            ioDeficit[q][i][asid] = 0;
+            ioGrants[q][i][asid] = 0;
+            ioBlocks[q][i][asid] = 0;
+            ioWait[q][i][asid] = 0;
+            raNext[q][i][asid] = NOBLOCK;
+            raWindow[q][i][asid] = 0;
+            SYSCALL(VERHOGEN, (int)devMutex, 0, 0);
+        }
+    }
+    ioWeight[asid] = (parent == UNOCCUPIED) ? groupIOWeight(asid) : ioWeight[parent];
+}
+
+
+/******************************************************************************
+ * Function: readIOShare
+ *
+ * Description: Sums an ASID's grants, blocks and queueing time over the
+ *              disks and flash devices, with its current weight
+ *
+ * Parameters:
+ *              asid - ASID whose share to read
+ *              share - Destination share (in kernel memory)
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void readIOShare(int asid, ioShare_PTR share) {
+    share->is_weight = ioWeight[asid];
+    share->is_grants = 0;
+    share->is_blocks = 0;
+    share->is_waitTime = 0;
+    int q, i;
+    for (q = 0; q < DMALINES; q++) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            share->is_grants += ioGrants[q][i][asid];
+            share->is_blocks += ioBlocks[q][i][asid];
+            share->is_waitTime += ioWait[q][i][asid];
+        }
+    }
+}
+
+
+/******************************************************************************
+ * Function: ioShareSyscallHandler
+ *
+ * Description: Handles SYS57 (IOSHARE). Sets the calling U-proc's I/O
+ *              weight to a2 (0 keeps it), but no higher than its resource
+ *              group's, and copies its share, summed over the disks and
+ *              flash devices, to the ioShare_t at a1
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              The weight it had before the call
+ *              ERROR if the weight is invalid (terminates the process)
+ *
+ *****************************************************************************/
+int ioShareSyscallHandler(support_PTR supportStruct) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    ioShare_PTR userShare = (ioShare_PTR)exceptState->s_a1;
+    int weight = exceptState->s_a2;
+    int asid = supportStruct->sup_asid;
+
+    /* Validate parameters */
+    if ((weight < 0) || (weight > IOWEIGHTMAX)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    int previous = ioWeight[asid];
+    if (weight != 0) {
+        ioWeight[asid] = MIN(weight, groupIOWeight(asid));
+    }
+
+    ioShare_t share;
+    readIOShare(asid, &share);
+    *userShare = share;
+
+    return previous;
+}
+
+
+/******************************************************************************
+ * Function: diskRW
+ *
+ * Description: Performs a read or write operation on a specified disk
+ *              and sector using the provided physical address
+ *              Handles geometry calculation, SEEK, and READ/WRITE commands
+ *              The SEEK is skipped when the head is already on the cylinder.
+ *              Assumes the caller holds the disk's grant (acquireDevice).
+ *
+ * Parameters:
+ *              operation - READBLK (3) or WRITEBLK (4)
+ *              diskNum - Disk device number (0-7)
+ *              sector - Linear sector number on the disk
+ *              bufferAddr - Physical address of the buffer to read into/write from
+ *
+ * Returns:
+ *              READY (1) on successful completion
+ *              Negative value of the device status code on error
+ *              ERROR (-1) for invalid disk parameters
+ *
+ *****************************************************************************/
+int diskRW(int operation, int diskNum, int linearSector, memaddr bufferAddr) {
+    /* Look up the disk's registers */
+    device_t *disk = DEVDESC(DISKINT, diskNum)->dd_reg;
+
+    /* Read disk parameters from d_data1 */
+    unsigned int disk_data1 = disk->d_data1;
+    unsigned int max_sector = (disk_data1 & DISKSECTORMASK);
+    unsigned int max_head = (disk_data1 & DISKHEADRMASK) >> DISK_DATA1_HEAD_SHIFT;
+    unsigned int max_cylinder  = (disk_data1 & DISKCYLINDERRMASK) >> DISK_DATA1_CYL_SHIFT;
+    unsigned int sectors_per_cylinder = max_head * max_sector;
+    unsigned int total_sectors = max_cylinder * sectors_per_cylinder;
+
+    /* Check for invalid disk parameters */
+    if (linearSector >= total_sectors || max_sector == 0 || max_head == 0 || max_cylinder == 0) {
+        return ERROR;
+    }
+
+    /* Calculate target cylinder, head, sector */
+    unsigned int cylinder = linearSector / sectors_per_cylinder;
+    unsigned int head = (linearSector % sectors_per_cylinder) / max_sector;
+    unsigned int sector = (linearSector % sectors_per_cylinder) % max_sector;
+
+    /* Perform SEEKCYL Operation atomically, unless the head is already there */
+    int status;
+    if (diskCylinderPos[diskNum] != (int)cylinder) {
+        setInterrupts(OFF);
+        disk->d_command = (cylinder << DISK_SEEK_CYL_SHIFT) | SEEKCYL;
+        status = SYSCALL(WAITIO, DISKINT, diskNum, FALSE);
+        setInterrupts(ON);
+        if (status != READY) {
+            diskCylinderPos[diskNum] = NOCYLINDER;
+            return -status;
+        }
+        diskCylinderPos[diskNum] = cylinder;
+    }
+
+    /* Perform READBLK/WRITEBLK Operation atomically */
+    setInterrupts(OFF);
+    disk->d_data0 = bufferAddr;
+    disk->d_command = (head << DISK_COMMAND_HEAD_SHIFT) | (sector << DISK_COMMAND_SECT_SHIFT) | operation;
+    status = SYSCALL(WAITIO, DISKINT, diskNum, FALSE);
+    setInterrupts(ON);
+
+    /* Return status; after a failure the head position is no longer trusted */
+    if (status != READY) {
+        diskCylinderPos[diskNum] = NOCYLINDER;
+        status = -status;
+    }
+    return status;
+}
+
+
+/******************************************************************************
+ * Function: flashRW
+ *
+ * Description: Performs a read or write operation on a flash device using
+ *              the provided physical address.
+ *              **Assumes the caller holds the device's grant (acquireDevice).**
+ *
+ * Parameters:
+ *              operation - READ (2) or WRITE (3)
+ *              flashNum - Flash device number (0-7)
+ *              blockNum - Block number on the flash device
+ *              address - The physical address to use for the device's d_data0
+ *
+ * Returns:
+ *              READY (1) on successful completion
+ *              Negative value of the device status code on error
+ *
+ *****************************************************************************/
+int flashRW(int operation, int flashNum, int blockNum, memaddr address) {
+    /* Look up the flash device's registers */
+    device_t *flash = DEVDESC(FLASHINT, flashNum)->dd_reg;
+
+    /* Perform atomic device operation */
+    setInterrupts(OFF);
+    flash->d_data0 = address;
+    flash->d_command = (blockNum << FLASHSHIFT) | operation;
+    int status = SYSCALL(WAITIO, FLASHINT, flashNum, FALSE);
+    setInterrupts(ON);
+
+    /* Return status */
+    if (status != READY) {
+        status = -status; 
+    }
+    return status;
+}
+
+
+/******************************************************************************
+ * Function: diskTransfer
+ *
+ * Description: Performs one disk read or write, waiting for the disk's
+ *              grant and passing it on afterwards
+ *
+ * Parameters:
+ *              operation - READBLK or WRITEBLK
+ *              diskNum - Disk device number (1-7)
+ *              linearSector - Linear sector number on the disk
+ *              bufferAddr - Physical address of the buffer
+ *              asid - ASID the transfer is charged to
+ *
+ * Returns:
+ *              Result of diskRW (READY, negative device status or ERROR)
+ *****************************************************************************/
+int diskTransfer(int operation, int diskNum, int linearSector, memaddr bufferAddr, int asid) {
+    diskRequest_t request;
+    acquireDevice(DISKINT, diskNum, &request, linearSector, asid);
+    int status = diskRW(operation, diskNum, linearSector, bufferAddr);
+    releaseDevice(DISKINT, diskNum, 1);
+    return status;
+}
+
+
+/******************************************************************************
+ * Function: flashTransfer
+ *
+ * Description: Performs one flash read or write, waiting for the flash
+ *              device's grant and passing it on afterwards. A logged
+ *              block goes to its device's log instead
+ *
+ * Parameters:
+ *              operation - READ or WRITE
+ *              flashNum - Flash device number (0-7)
+ *              blockNum - Block number on the flash device
+ *              bufferAddr - Physical address of the buffer
+ *              asid - ASID the transfer is charged to
+ *
+ * Returns:
+ *              Result of flashRW (READY or negative device status)
+ *****************************************************************************/
+int flashTransfer(int operation, int flashNum, int blockNum, memaddr bufferAddr, int asid) {
+    if (FLASHLOG && flashLogged(flashNum, blockNum)) {
+        return logTransfer(operation, flashNum, blockNum, bufferAddr, asid);
+    }
+    diskRequest_t request;
+    acquireDevice(FLASHINT, flashNum, &request, blockNum, asid);
+    int status = flashRW(operation, flashNum, blockNum, bufferAddr);
+    releaseDevice(FLASHINT, flashNum, 1);
+    return status;
+}
+
+
+/******************************************************************************
+ * Function: diskSectors
+ *
+ * Description: Computes the number of sectors on a disk from its geometry
+ *
+ * Parameters:
+ *              diskNum - Disk device number (0-7)
+ *
+ * Returns:
+ *              Cylinders * heads * sectors of the disk
+ *****************************************************************************/
+int diskSectors(int diskNum) {
+    unsigned int disk_data1 = DEVDESC(DISKINT, diskNum)->dd_reg->d_data1;
+    unsigned int max_sector = (disk_data1 & DISKSECTORMASK);
+    unsigned int max_head = (disk_data1 & DISKHEADRMASK) >> DISK_DATA1_HEAD_SHIFT;
+    unsigned int max_cylinder  = (disk_data1 & DISKCYLINDERRMASK) >> DISK_DATA1_CYL_SHIFT;
+    return max_cylinder * max_head * max_sector;
+}
+
+
+/******************************************************************************
+ * Function: diskPutSyscallHandler
+ *
+ * Description: Handles SYS14 (DISK_PUT). Validates the request and writes
+ *              the user's page to the sector with userBlockIO.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Result of the diskRW operation (READY or negative error code)
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int diskPutSyscallHandler(support_PTR supportStruct) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr logicalAddress = exceptState->s_a1;
+    int diskNum = exceptState->s_a2;
+    int linearSector = exceptState->s_a3;
+
+    /* Validate parameters */
+    if (!validUserBlock(DISKINT, diskNum, linearSector) || !validateUserAddress(logicalAddress)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    return userBlockIO(supportStruct, DISKINT, TRUE, diskNum, linearSector, logicalAddress);
+}
+
+
+/******************************************************************************
+ * Function: diskGetSyscallHandler
+ *
+ * Description: Handles SYS15 (DISK_GET). Validates the request, reads
+ *              the sector into the user's page with userBlockIO and reads
+ *              ahead of a sequential stream.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Result of the diskRW operation (READY or negative error code)
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int diskGetSyscallHandler(support_PTR supportStruct) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr logicalAddress = exceptState->s_a1;
+    int diskNum = exceptState->s_a2;
+    int linearSector = exceptState->s_a3;
+
+    /* Validate parameters */
+    if (!validUserBlock(DISKINT, diskNum, linearSector) || !validateUserAddress(logicalAddress)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    int status = userBlockIO(supportStruct, DISKINT, FALSE, diskNum, linearSector, logicalAddress);
+    if (status == READY) {
+        readAhead(DISKINT, diskNum, linearSector, supportStruct->sup_asid);
+    }
+    return status;
+}
+
+
+/******************************************************************************
+ * Function: diskPutVSyscallHandler
+ *
+ * Description: Handles SYS24 (DISK_PUTV). Writes a vector of user pages to
+ *              their sectors under a single disk grant.
+ *              a1 = address of a diskIOVec_t array, a2 = disk number,
+ *              a3 = number of entries (1..DISKIOVMAX)
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Number of sectors written on success
+ *              Negative device status of the first failing sector
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int diskPutVSyscallHandler(support_PTR supportStruct) {
+    return diskVectorRW(supportStruct, WRITEBLK);
+}
+
+
+/******************************************************************************
+ * Function: diskGetVSyscallHandler
+ *
+ * Description: Handles SYS25 (DISK_GETV). Reads a vector of sectors into
+ *              their user pages under a single disk grant.
+ *              a1 = address of a diskIOVec_t array, a2 = disk number,
+ *              a3 = number of entries (1..DISKIOVMAX)
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Number of sectors read on success
+ *              Negative device status of the first failing sector
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int diskGetVSyscallHandler(support_PTR supportStruct) {
+    return diskVectorRW(supportStruct, READBLK);
+}
+
+
+/******************************************************************************
+ * Function: flashPutSyscallHandler
+ *
+ * Description: Handles SYS16 (FLASH_PUT). Validates the request and writes
+ *              the user's page to the block with userBlockIO.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Result of the flashRW operation (READY or negative error code)
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int flashPutSyscallHandler(support_PTR supportStruct) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr logicalAddress = exceptState->s_a1;
+    int flashNum = exceptState->s_a2;
+    int blockNum = exceptState->s_a3;
+
+    /* Validate parameters */
+    if (!validUserBlock(FLASHINT, flashNum, blockNum) || !validateUserAddress(logicalAddress)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    return userBlockIO(supportStruct, FLASHINT, TRUE, flashNum, blockNum, logicalAddress);
+}
+
+/******************************************************************************
+ * Function: flashGetSyscallHandler
+ *
+ * Description: Handles SYS17 (FLASH_GET). Validates the request, reads
+ *              the block into the user's page with userBlockIO and reads
+ *              ahead of a sequential stream.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Result of the flashRW operation (READY or negative error code)
+ *              ERROR if parameters are invalid (terminates the process)
+ *
+ *****************************************************************************/
+int flashGetSyscallHandler(support_PTR supportStruct) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr logicalAddress = exceptState->s_a1;
+    int flashNum = exceptState->s_a2;
+    int blockNum = exceptState->s_a3;
+
+    /* Validate parameters */
+    if (!validUserBlock(FLASHINT, flashNum, blockNum) || !validateUserAddress(logicalAddress)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    int status = userBlockIO(supportStruct, FLASHINT, FALSE, flashNum, blockNum, logicalAddress);
+    if (status == READY) {
+        readAhead(FLASHINT, flashNum, blockNum, supportStruct->sup_asid);
+    }
+    return status;
+}
+
+/******************************************************************************
+ * Function: validUserBlock
+ *
+ * Description: Checks that a device and block may be named by a user DMA
+ *              request: disks 1-7 and any sector (diskRW checks the upper
+ *              bound), flash devices 0-7 and blocks on the device outside
+ *              every U-proc's backing store and flash log area past the
+ *              log's blocks, on any device but the trace sink's
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *
+ * Returns:
+ *              TRUE if the request may proceed, else FALSE
+ *****************************************************************************/
+int validUserBlock(int line, int devNum, int block) {
+    if (line == DISKINT) {
+        return (devNum > 0) && (devNum < DEV_PER_LINE) && (block >= 0);
+    }
+    return (line == FLASHINT) && (devNum >= 0) && (devNum < DEV_PER_LINE) && (block >= 0) &&
+           (block < (int)DEVDESC(FLASHINT, devNum)->dd_reg->d_data1) && !reservedBlock(devNum, block) &&
+           !logReservedBlock(devNum, block) && !traceSinkDevice(devNum);
+}
+
+
+/******************************************************************************
+ * Function: userBlockIO
+ *
+ * Description: Moves one block between a user page and a disk or flash
+ *              device: through the block cache with BLOCKCACHE set, else
+ *              straight to or from the user's frame if pinUserPage can pin
+ *              it, else through a DMA buffer (the U-proc's for disks, the
+ *              device's under its grant for flash) and copyBlock. Called in
+ *              the U-proc's context with a validated request, and charged
+ *              to its ASID
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *              line - DISKINT or FLASHINT
+ *              write - TRUE to write the page to the device, FALSE to read
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) number
+ *              logicalAddress - User address of the page
+ *
+ * Returns:
+ *              READY on success
+ *              Negative device status on error
+ *              ERROR for a disk sector past the end of the disk
+ *****************************************************************************/
+int userBlockIO(support_PTR supportStruct, int line, int write, int devNum, int block, memaddr logicalAddress) {
+    /* Go through the block cache */
+    if (BLOCKCACHE) {
+        if ((line == DISKINT) && (block >= diskSectors(devNum))) {
+            return ERROR;
+        }
+        return write ? cachedWrite(line, devNum, block, logicalAddress, supportStruct->sup_asid)
+                     : cachedRead(line, devNum, block, logicalAddress, supportStruct->sup_asid);
+    }
+
+    /* Transfer straight from/into the user's frame if it is resident */
+    int status;
+    int pinned = pinUserPage(supportStruct, logicalAddress, !write);
+    if (pinned != NOSWAPFRAME) {
+        if (line == DISKINT) {
+            status = diskTransfer(write ? WRITEBLK : READBLK, devNum, block, FRAMETOADDR(pinned), supportStruct->sup_asid);
+        } else {
+            status = flashTransfer(write ? WRITE : READ, devNum, block, FRAMETOADDR(pinned), supportStruct->sup_asid);
+        }
+        unpinUserPage(pinned);
+        return status;
+    }
+
+    if ((line == DISKINT) || (FLASHLOG && flashLogged(devNum, block))) {
+        /* This U-proc's own DMA buffer: only its threads contend for it */
+        memaddr diskDmaBufferAddr = DISK_DMABUFFER_ADDR(supportStruct->sup_asid - 1);
+        SYSCALL(PASSEREN, (int)&bufferMutex[supportStruct->sup_asid], 0, 0);
+        if (write) {
+            copyBlock((memaddr *)logicalAddress, (memaddr *)diskDmaBufferAddr);
+        }
+        if (line == DISKINT) {
+            status = diskTransfer(write ? WRITEBLK : READBLK, devNum, block, diskDmaBufferAddr, supportStruct->sup_asid);
+        } else {
+            status = flashTransfer(write ? WRITE : READ, devNum, block, diskDmaBufferAddr, supportStruct->sup_asid);
+        }
+        if (!write && (status == READY)) {
+            copyBlock((memaddr *)diskDmaBufferAddr, (memaddr *)logicalAddress);
+        }
+        SYSCALL(VERHOGEN, (int)&bufferMutex[supportStruct->sup_asid], 0, 0);
+        return status;
+    }
+
+    /* The flash device's DMA buffer, used under its grant */
+    memaddr flashDmaBufferAddr = FLASH_DMABUFFER_ADDR(devNum);
+    diskRequest_t request;
+    acquireDevice(FLASHINT, devNum, &request, block, supportStruct->sup_asid);
+    if (write) {
+        copyBlock((memaddr *)logicalAddress, (memaddr *)flashDmaBufferAddr);
+    }
+    status = flashRW(write ? WRITE : READ, devNum, block, flashDmaBufferAddr);
+    if (!write && (status == READY)) {
+        copyBlock((memaddr *)flashDmaBufferAddr, (memaddr *)logicalAddress);
+    }
+    releaseDevice(FLASHINT, devNum, 1);
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/******************************************************************************
+ * Function: copyBlock
+ *
+ * Description: Copies PAGESIZE (4096) bytes word by word from source to destination
+ *
+ * Parameters:
+ *              src - Pointer to the source buffer
+ *              dest - Pointer to the destination buffer
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void copyBlock(memaddr *src, memaddr *dest) {
+    copyPage((unsigned int *)dest, (unsigned int *)src);
+}
+
+
+/******************************************************************************
+ * Function: pickRequest
+ *
+ * Description: Picks the request a device is granted to next. Without
+ *              IOFAIRSHARE it is nearestRequest over the whole queue. With
+ *              it, the ASID whose round it is keeps the device while it has
+ *              a request queued and credit left; otherwise the round passes
+ *              to the next ASID (in ASID order) with a request queued,
+ *              which is credited its weight times IOQUANTUM blocks, until
+ *              one has credit. An ASID with nothing queued keeps its debt
+ *              but not its credit. Called with the device's mutex held
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *
+ * Returns:
+ *              The request to grant, NULL if the queue is empty
+ *****************************************************************************/
+diskRequest_PTR pickRequest(int line, int devNum) {
+    int q = DMAQUEUE(line);
+    if (ioQueue[q][devNum] == NULL) {
+        return NULL;
+    }
+    if (!IOFAIRSHARE) {
+        return nearestRequest(line, devNum, UNOCCUPIED);
+    }
+
+    int asid = ioTurn[q][devNum];
+    diskRequest_PTR next = nearestRequest(line, devNum, asid);
+    if (next == NULL) {
+        ioDeficit[q][devNum][asid] = MIN(ioDeficit[q][devNum][asid], 0);
+    }
+    while ((next == NULL) || (ioDeficit[q][devNum][asid] <= 0)) {
+        /* Its round is over: credit the next ASID with requests queued */
+        asid = (asid + 1) % (MAXUPROC + 1);
+        next = nearestRequest(line, devNum, asid);
+        if (next != NULL) {
+            ioDeficit[q][devNum][asid] += ioWeight[asid] * IOQUANTUM;
+        } else {
+            ioDeficit[q][devNum][asid] = MIN(ioDeficit[q][devNum][asid], 0);
+        }
+    }
+    ioTurn[q][devNum] = asid;
+    return next;
+}
+
+
+/******************************************************************************
+ * Function: nearestRequest
+ *
+ * Description: Picks the next of a device's queued requests charged to
+ *              one ASID (or to any): on a disk with DISKSCAN set, the one
+ *              with the nearest cylinder at or past the head, or the lowest
+ *              cylinder if there is none (C-LOOK, ties in arrival order);
+ *              otherwise the oldest. Called with the device's mutex held
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              asid - ASID whose requests to consider, UNOCCUPIED for all
+ *
+ * Returns:
+ *              The chosen request, NULL if there is none
+ *****************************************************************************/
+diskRequest_PTR nearestRequest(int line, int devNum, int asid) {
+    diskRequest_PTR oldest = NULL;
+    diskRequest_PTR ahead = NULL;
+    diskRequest_PTR lowest = NULL;
+    diskRequest_PTR curr;
+    for (curr = ioQueue[DMAQUEUE(line)][devNum]; curr != NULL; curr = curr->dr_next) {
+        if ((asid != UNOCCUPIED) && (curr->dr_asid != asid)) {
+            continue;
+        }
+        if (oldest == NULL) {
+            oldest = curr;
+        }
+        /* C-LOOK: sweep upward from the head, then wrap to the lowest cylinder */
+        if ((line == DISKINT) && (curr->dr_cylinder >= diskHead[devNum]) &&
+            ((ahead == NULL) || (curr->dr_cylinder < ahead->dr_cylinder))) {
+            ahead = curr;
+        }
+        if ((lowest == NULL) || (curr->dr_cylinder < lowest->dr_cylinder)) {
+            lowest = curr;
+        }
+    }
+
+    if (!DISKSCAN || (line != DISKINT) || (oldest == NULL)) {
+        return oldest;
+    }
+    return (ahead != NULL) ? ahead : lowest;
+}
+
+
+/******************************************************************************
+ * Function: grantRequest
+ *
+ * Description: Records that a request is granted its device: its ASID is
+ *              charged for the transfer and credited a grant and the time
+ *              it waited, and a disk's head moves to its cylinder. Called
+ *              with the device's mutex held
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              request - The granted request
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void grantRequest(int line, int devNum, diskRequest_PTR request) {
+    int q = DMAQUEUE(line);
+    cpu_t now;
+    STCK(now);
+    ioHolder[q][devNum] = request->dr_asid;
+    ioGrants[q][devNum][request->dr_asid]++;
+    ioWait[q][devNum][request->dr_asid] += now - request->dr_queued;
+    if (line == DISKINT) {
+        diskHead[devNum] = request->dr_cylinder;
+    }
+}
+
+
+/******************************************************************************
+ * Function: diskCylinder
+ *
+ * Description: Computes the cylinder of a linear sector from the disk's
+ *              geometry, as diskRW does. An invalid sector maps to cylinder
+ *              0; diskRW rejects it once granted.
+ *
+ * Parameters:
+ *              diskNum - Disk device number (1-7)
+ *              linearSector - Linear sector number on the disk
+ *
+ * Returns:
+ *              The cylinder number
+ *****************************************************************************/
+int diskCylinder(int diskNum, int linearSector) {
+    unsigned int disk_data1 = DEVDESC(DISKINT, diskNum)->dd_reg->d_data1;
+    unsigned int max_sector = (disk_data1 & DISKSECTORMASK);
+    unsigned int max_head = (disk_data1 & DISKHEADRMASK) >> DISK_DATA1_HEAD_SHIFT;
+    unsigned int sectors_per_cylinder = max_head * max_sector;
+    if (sectors_per_cylinder == 0) {
+        return 0;
+    }
+    return linearSector / sectors_per_cylinder;
+}
+
+
+/******************************************************************************
+ * Function: diskVectorRW
+ *
+ * Description: Common body of SYS24/SYS25. Copies the user's vector into
+ *              the kernel, validates the disk, count, every page and every
+ *              sector, then acquires the disk once for the lowest sector and
+ *              transfers the entries in ascending sector order (ties in
+ *              vector order) through the U-proc's DMA buffer. With
+ *              BLOCKCACHE set the cache mutex is held throughout, after
+ *              dropping (and writing back) cached copies of the sectors.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *              operation - READBLK or WRITEBLK
+ *
+ * Returns:
+ *              Number of sectors transferred on success
+ *              Negative device status of the first failing sector
+ *              ERROR if parameters are invalid (terminates the process)
+ *****************************************************************************/
+int diskVectorRW(support_PTR supportStruct, int operation) {
+    /* Extract parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr vecAddress = exceptState->s_a1;
+    int diskNum = exceptState->s_a2;
+    int count = exceptState->s_a3;
+    memaddr vecEnd = vecAddress + (count * sizeof(diskIOVec_t)) - 1;
+
+    /* Validate the disk, count and the vector itself */
+    if (diskNum <= 0 || diskNum >= DEV_PER_LINE || count <= 0 || count > DISKIOVMAX ||
+        !validateUserAddress(vecAddress) || !validateUserAddress(vecEnd)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+
+    /* Snapshot the vector and validate every entry before touching the disk */
+    diskIOVec_t vec[DISKIOVMAX];
+    diskIOVec_PTR userVec = (diskIOVec_PTR)vecAddress;
+    int i;
+    for (i = 0; i < count; i++) {
+        vec[i] = userVec[i];
+        if (vec[i].iov_sector < 0 || !validateUserAddress(vec[i].iov_base)) {
+            terminateUProcess(NULL);
+            return ERROR;
+        }
+    }
+
+    /* Get this U-proc's DMA buffer address (its threads take turns) */
+    memaddr diskDmaBufferAddr = DISK_DMABUFFER_ADDR(supportStruct->sup_asid - 1);
+    SYSCALL(PASSEREN, (int)&bufferMutex[supportStruct->sup_asid], 0, 0);
+
+    /* Keep the block cache out of the way: no cached copy may go stale or be stale */
+    int status = READY;
+    if (BLOCKCACHE) {
+        lockBlockCache();
+        for (i = 0; (i < count) && (status == READY); i++) {
+            status = dropCachedBlock(DISKINT, diskNum, vec[i].iov_sector);
+        }
+        if (status != READY) {
+            unlockBlockCache();
+            SYSCALL(VERHOGEN, (int)&bufferMutex[supportStruct->sup_asid], 0, 0);
+            return status;
+        }
+    }
+
+    /* Stream the entries in ascending sector order under one grant */
+    diskRequest_t request;
+    unsigned int done = 0;
+    int transferred = 0;
+    while ((transferred < count) && (status == READY)) {
+        /* Pick the lowest sector not yet transferred */
+        int next = -1;
+        for (i = 0; i < count; i++) {
+            if (!(done & (1U << i)) && ((next < 0) || (vec[i].iov_sector < vec[next].iov_sector))) {
+                next = i;
+            }
+        }
+        done |= (1U << next);
+
+        /* The first (lowest) sector positions the request in the disk queue */
+        if (transferred == 0) {
+            acquireDevice(DISKINT, diskNum, &request, vec[next].iov_sector, supportStruct->sup_asid);
+        }
+
+        /* Use the user's own frame if it is resident, else the DMA buffer */
+        int pinned = pinUserPage(supportStruct, vec[next].iov_base, (operation == READBLK));
+        if (pinned != NOSWAPFRAME) {
+            status = diskRW(operation, diskNum, vec[next].iov_sector, FRAMETOADDR(pinned));
+            unpinUserPage(pinned);
+        } else {
+            if (operation == WRITEBLK) {
+                copyBlock((memaddr *)vec[next].iov_base, (memaddr *)diskDmaBufferAddr);
+            }
+            status = diskRW(operation, diskNum, vec[next].iov_sector, diskDmaBufferAddr);
+            if ((operation == READBLK) && (status == READY)) {
+                copyBlock((memaddr *)diskDmaBufferAddr, (memaddr *)vec[next].iov_base);
+            }
+        }
+        transferred++;
+    }
+
+    /* Hand the disk to the next request, charging the batch */
+    releaseDevice(DISKINT, diskNum, transferred);
+    if (BLOCKCACHE) {
+        unlockBlockCache();
+    }
+    SYSCALL(VERHOGEN, (int)&bufferMutex[supportStruct->sup_asid], 0, 0);
+
+    return (status == READY) ? transferred : status;
+}
+
+
+/******************************************************************************
+ * Function: readAhead
+ *
+ * Description: Follows an ASID's read stream on a device after it read a
+ *              block: a read of the next block grows the window, any other
+ *              read closes it. Then queues read-ahead of the blocks up to
+ *              a window past this one that were not read ahead yet,
+ *              stopping at the end of the device, at a reserved flash
+ *              block, or when aioPrefetch finds no room (to retry on the
+ *              next read). Races between threads of one U-proc only
+ *              disturb their shared stream
+ *
+ * Parameters:
+ *              line - DISKINT or FLASHINT
+ *              devNum - Device number on the line
+ *              block - Sector (disk) or block (flash) just read
+ *              asid - ASID of the reader
+ *
+ * Returns:
+ *              None
+ *****************************************************************************/
+void readAhead(int line, int devNum, int block, int asid) {
+    if (!READAHEAD || !BLOCKCACHE) {
+        return;
+    }
+
+    int q = DMAQUEUE(line);
+    if (block == raNext[q][devNum][asid]) {
+        raWindow[q][devNum][asid] = (raWindow[q][devNum][asid] == 0) ? 1 : MIN(2 * raWindow[q][devNum][asid], RAMAXWINDOW);
+    } else {
+        raWindow[q][devNum][asid] = 0;
+    }
+    raNext[q][devNum][asid] = block + 1;
+    if ((raWindow[q][devNum][asid] == 0) || (raIssued[q][devNum][asid] <= block)) {
+        raIssued[q][devNum][asid] = block + 1;
+    }
+
+    int last = block + raWindow[q][devNum][asid];
+    int deviceEnd = (line == DISKINT) ? diskSectors(devNum) : (int)DEVDESC(FLASHINT, devNum)->dd_reg->d_data1;
+    while ((raIssued[q][devNum][asid] <= last) && (raIssued[q][devNum][asid] < deviceEnd) &&
+           validUserBlock(line, devNum, raIssued[q][devNum][asid]) &&
+           aioPrefetch(asid, line, devNum, raIssued[q][devNum][asid])) {
+        raIssued[q][devNum][asid]++;
+    }
+}
@@ -0,0 +1,271 @@
+/******************************* diskVolume.c *************************************
+ *
+ * Module: Disk Volume
+ *
+ * Description:
+ * This module implements SYS59 (VOLUMEPUT) and SYS60 (VOLUMEGET), which
+ * address the user disks (DISK1-7) as one striped (RAID-0) volume. The
+ * volume's linear sector space is cut into stripe units of VOLUMESTRIPE
+ * sectors dealt round robin to the member disks, so a request for
+ * consecutive sectors spreads over every disk, and the parts on different
+ * disks are transferred at the same time by the asynchronous I/O workers.
+ *
+ * Policy Decisions:
+ * - Members: The disks found installed at boot (DISK0 holds the boot
+ *   configuration and is left out), in disk number order. Each gives the
+ *   volume the same whole number of stripe units, as many as its smallest
+ *   member holds; sectors past that on a bigger disk stay reachable only
+ *   through SYS14/SYS15
+ * - Mapping: Volume sector s lies in stripe unit u = s / VOLUMESTRIPE, on
+ *   member u mod n (n members), at sector (u / n) * VOLUMESTRIPE +
+ *   s mod VOLUMESTRIPE of that disk
+ * - Parallel Transfers: Every sector of a request goes to the asynchronous
+ *   I/O workers (aioSubmitBlock) on the caller's pinned frame, in rounds of
+ *   one sector per member, so the workers take sectors of different disks
+ *   and each disk's own queue orders the rest. The caller then blocks
+ *   until all of them are done. A sector whose page can not be pinned, or
+ *   that finds no free request slot, is transferred by the caller itself
+ *   (userBlockIO) while the others run
+ * - Consistency: Both paths go through the block cache with BLOCKCACHE
+ *   set, as SYS14/SYS15 do, so the volume and the member disks see the
+ *   same sectors
+ * - Errors: Every sector is tried; the first failing sector in volume order
+ *   decides the result. A request reaching past the end of the volume
+ *   fails with ERROR before any transfer
+ * - Parameter Validation: A buffer that is not page-aligned or not in user
+ *   space, a negative first sector or a count outside 1-VOLUMEMAX
+ *   terminates the U-proc, as with SYS14-17
+ *
+ * Functions:
+ * - initDiskVolume: Finds the member disks and the volume size
+ * - volumeSectors: Returns the number of sectors in the volume
+ * - volumePutSyscallHandler: Implements SYS59 (VOLUMEPUT)
+ * - volumeGetSyscallHandler: Implements SYS60 (VOLUMEGET)
+ * - volumeRW: Validates a volume request and runs its sectors in parallel
+ * - volumeMap: Maps a volume sector to a member disk and sector
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+#include "../h/diskVolume.h"
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN int volumeRW(support_PTR supportStruct, int write);
+HIDDEN int volumeMap(int sector, int *diskNum);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int volumeMember[DEV_PER_LINE];      /* Disk number of each member */
+HIDDEN int volumeDisks;                     /* Number of members */
+HIDDEN int volumeUnits;                     /* Stripe units each member holds */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initDiskVolume
+ *
+ * Description: Makes every installed disk but DISK0 a member and sizes
+ *              the volume by its smallest member
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initDiskVolume() {
+    volumeDisks = 0;
+    volumeUnits = 0;
+    int diskNum;
+    for (diskNum = 1; diskNum < DEV_PER_LINE; diskNum++) {
+        int units = diskSectors(diskNum) / VOLUMESTRIPE;
+        if (units > 0) {
+            if ((volumeDisks == 0) || (units < volumeUnits)) {
+                volumeUnits = units;
+            }
+            volumeMember[volumeDisks] = diskNum;
+            volumeDisks++;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: volumeSectors
+ *
+ * Description: Returns the number of sectors in the volume
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              The volume size in sectors (0 with no member disks)
+ * ======================================================================== */
+int volumeSectors() {
+    return volumeDisks * volumeUnits * VOLUMESTRIPE;
+}
+
+/* ========================================================================
+ * Function: volumePutSyscallHandler
+ *
+ * Description: Handles SYS59 (VOLUMEPUT). a1 = first of count consecutive
+ *              user pages, a2 = first volume sector, a3 = count. Writes
+ *              the pages to consecutive volume sectors
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              The count on success
+ *              Negative device status of the first failing sector
+ *              ERROR if the request reaches past the end of the volume
+ *              ERROR if parameters are invalid (terminates the process)
+ * ======================================================================== */
+int volumePutSyscallHandler(support_PTR supportStruct) {
+    return volumeRW(supportStruct, TRUE);
+}
+
+/* ========================================================================
+ * Function: volumeGetSyscallHandler
+ *
+ * Description: Handles SYS60 (VOLUMEGET). a1 = first of count consecutive
+ *              user pages, a2 = first volume sector, a3 = count. Reads
+ *              consecutive volume sectors into the pages
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              The count on success
+ *              Negative device status of the first failing sector
+ *              ERROR if the request reaches past the end of the volume
+ *              ERROR if parameters are invalid (terminates the process)
+ * ======================================================================== */
+int volumeGetSyscallHandler(support_PTR supportStruct) {
+    return volumeRW(supportStruct, FALSE);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: volumeRW
+ *
+ * Description: Common body of SYS59/SYS60. Validates the request, maps
+ *              each sector to its member disk, queues the sectors to the
+ *              workers one round of members at a time (transferring any it
+ *              can not queue itself) and waits for them all
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *              write - TRUE to write the pages to the volume, FALSE to read
+ *
+ * Returns:
+ *              The count on success
+ *              Negative device status of the first failing sector
+ *              ERROR if the request reaches past the end of the volume
+ *              ERROR if parameters are invalid (terminates the process)
+ * ======================================================================== */
+int volumeRW(support_PTR supportStruct, int write) {
+    /* Extract and validate parameters */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr buffer = exceptState->s_a1;
+    int first = exceptState->s_a2;
+    int count = exceptState->s_a3;
+    if (((buffer & (PAGESIZE - 1)) != 0) || (first < 0) || (count <= 0) || (count > VOLUMEMAX) ||
+        !validateUserAddress(buffer) || !validateUserAddress(buffer + (count * PAGESIZE) - 1)) {
+        terminateUProcess(NULL);
+        return ERROR;
+    }
+    if (first + count > volumeSectors()) {
+        return ERROR;
+    }
+
+    /* Map the sectors; round r holds the r-th sector of each member */
+    int diskNum[VOLUMEMAX];
+    int sector[VOLUMEMAX];
+    int round[VOLUMEMAX];
+    int status[VOLUMEMAX];
+    int i, j;
+    for (i = 0; i < count; i++) {
+        sector[i] = volumeMap(first + i, &diskNum[i]);
+        round[i] = 0;
+        for (j = 0; j < i; j++) {
+            if (diskNum[j] == diskNum[i]) {
+                round[i]++;
+            }
+        }
+    }
+
+    /* Queue the sectors round by round so the workers start on different disks */
+    int doneSem = 0;
+    int queued = 0;
+    int started = 0;
+    int r;
+    for (r = 0; started < count; r++) {
+        for (i = 0; i < count; i++) {
+            if (round[i] != r) {
+                continue;
+            }
+            started++;
+
+            /* Fault the page in (dirty if the disk writes it) and pin it */
+            memaddr page = buffer + (i * PAGESIZE);
+            volatile unsigned int *touch = (unsigned int *)page;
+            unsigned int word = *touch;
+            if (!write) {
+                *touch = word;
+            }
+            int frame = pinUserPage(supportStruct, page, !write);
+            if ((frame != NOSWAPFRAME) &&
+                aioSubmitBlock(supportStruct->sup_asid, DISKINT, write, diskNum[i], sector[i],
+                               frame, &status[i], &doneSem)) {
+                queued++;
+            } else {
+                /* No pin or no slot: do this one here while the rest run */
+                if (frame != NOSWAPFRAME) {
+                    unpinUserPage(frame);
+                }
+                status[i] = userBlockIO(supportStruct, DISKINT, write, diskNum[i], sector[i], page);
+            }
+        }
+    }
+
+    /* Wait for the workers */
+    while (queued > 0) {
+        SYSCALL(PASSEREN, (int)&doneSem, 0, 0);
+        queued--;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (status[i] != READY) {
+            return status[i];
+        }
+    }
+    return count;
+}
+
+/* ========================================================================
+ * Function: volumeMap
+ *
+ * Description: Maps a volume sector to the member disk holding its stripe
+ *              unit and the sector on that disk
+ *
+ * Parameters:
+ *              sector - Volume sector (below volumeSectors())
+ *              diskNum - Set to the member's disk number
+ *
+ * Returns:
+ *              The sector on the member disk
+ * ======================================================================== */
+int volumeMap(int sector, int *diskNum) {
+    int unit = sector / VOLUMESTRIPE;
+    *diskNum = volumeMember[unit % volumeDisks];
+    return ((unit / volumeDisks) * VOLUMESTRIPE) + (sector % VOLUMESTRIPE);
+}
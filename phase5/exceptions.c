@@ -19,24 +19,56 @@
  * process state from the BIOS data page before handling SYSCALLs (for blocking
  * calls). For non-blocking calls, the CPU time is updated again after the call to
  * account for the time spent in the nucleus.
+ * Each kernel entry reads the TOD clock once: the time since the last
+ * dispatch is charged as user or support time depending on the mode the
+ * exception interrupted (KUp), and the time until the process is resumed or
+ * blocks is charged as nucleus time. Soft-blocked time runs from the block
+ * to the interrupt that wakes the process.
+ * 
+ * Fast Path Policy:
+ * With FASTSYSCALL set, a SYS3 that will not block, a SYS4 that will not
+ * hand off, SYS6 and SYS8 are done by fastSyscall before
+ * updateCurrentProcess. They work in place on the BIOS data page state:
+ * the state is not copied to p_s (the next entry overwrites p_s anyway),
+ * the TOD is read once (chargeEntryTime), and the PLT keeps counting the
+ * running quantum instead of being reloaded, then LDST returns from the
+ * saved state. The few microseconds the call spends in the nucleus are
+ * charged with the caller's next entry as the time it interrupted
+ * (support time: only kernel mode processes make these calls).
  * 
  * Functions:
  * - exceptionHandler: Main exception handler that routes exceptions to
  *                      appropriate handlers.
  * - syscallHandler: Handles system call exceptions by dispatching to appropriate
  *                      system service based on the system call number in a0.
+ * - fastSyscall: Handles a SYSCALL that can not block in place on the BIOS
+ *                      data page and returns straight to the caller.
  * - createProcess: Implements SYS1 (CREATEPROCESS) system call. Creates a new
  *                      process with state provided by the caller.
+ * - terminateProcess: Implements SYS2 (TERMINATEPROCESS) system call.
+ *                      Terminates a process and its subtree iteratively.
+ * - reapProcess: Takes a childless process off every queue and frees it.
  * - passeren: Implements SYS2 (PASSEREN) system call. Passes the current
  *                      process to a semaphore, blocking the current process.
  * - waitClock: Implements SYS3 (WAITCLOCK) system call. Blocks the current
  *                      process until the next clock tick.
  * - getCpuTime: Implements SYS4 (GETCPUTIME) system call. Returns the current
  *                      process's CPU time.
+ * - cpuTimeReply: Writes the CPU time reply of SYS6 into a state.
  * - waitIO: Implements SYS5 (WAITIO) system call. Blocks the current process
  *                      until an I/O operation completes.
  * - getSupportPtr: Implements SYS6 (GETSUPPORTPTR) system call. Returns the
  *                      support structure pointer for the current process.
+ * - waitUntil: Implements the nucleus-only WAITUNTIL call. Blocks until a TOD,
+ *                      optionally as a P on a semaphore that gives up then.
+ * - tlbShootdown: Implements the nucleus-only TLBSHOOTDOWN call. Asks the
+ *                      processors that may hold entries of the given ASIDs
+ *                      to clear their TLB and blocks until one has.
+ * - noteTLBASID: Records that a processor's TLB may hold a process's entries.
+ * - releaseShootdowns: Clears a processor's TLB if asked to and wakes the
+ *                      TLBSHOOTDOWN waiters on it.
+ *                      (The nucleus-only MAKEMUTEX call is handled by inherit.c;
+ *                      P and V on such a mutex also record its owner there.)
  * - tlbExceptionHandler: Handles TLB-related exceptions by implementing the
  *                      Pass Up or Die approach.
  * - programTrapHandler: Handles program trap exceptions by implementing the
@@ -48,6 +80,34 @@
  *                      state and calculates remaining time quantum.
  * - updateProcessTime: Updates the CPU time for the current process based on
  *                      elapsed time since last update.
+ * - chargeEntryTime: Charges the time since dispatch on kernel entry.
+ * - chargeBlockedTime: Credits a woken process with its soft-blocked time.
+ *
+ * Multiprocessor Policy:
+ * With CPUCOUNT above one, every entry takes the nucleus lock and reads the
+ * exception state the BIOS saved for the executing processor. A pass up on
+ * a processor other than the boot one does not LDCXT there: the Support
+ * Level context is loaded into p_s and the process is requeued, and only
+ * the boot processor takes kernel mode processes (see pickRemote), so all
+ * Support Level code runs there. A process terminated while another
+ * processor runs it is not freed at once: it is marked p_killed and sent
+ * an IPIKILL, and that processor reaps the PCB on its next nucleus entry
+ * (the IPI, or an exception taken first) before scheduling, so the PCB
+ * stays valid while the processor still runs it or refills its TLB.
+ *
+ * TLB Shootdown Policy:
+ * Each processor but the boot one keeps its TLB across dispatches, and
+ * tlbASIDs[] records the ASIDs it ran since its last clear. When the Support
+ * Level takes a permission away (TLBSHOOTDOWN, after changing the page table
+ * entries), only processors whose mask meets the ASIDs given are sent an
+ * IPITLBFLUSH message, all with a single Outbox write, and the caller waits
+ * on each until it has cleared its TLB. A processor already sent a flush it
+ * has not done gets no second message: the pending flush comes after the
+ * caller's page table changes, so it drops their entries as well, and
+ * invalidations made in a row cost one clear. A processor clears its TLB on
+ * the IPI, or on entering the scheduler if that comes first. Permissions
+ * only granted need no shootdown: a stale entry there faults, and the pass
+ * up drops it from the faulting processor's TLB (passUpOrDie).
  *
  * Written by Aryah Rao and Anish Reddy
  *
@@ -56,6 +116,17 @@
 /******************** Included Header Files ********************/
 #include "../h/exceptions.h"
 
+/******************** Module Variables ********************/
+HIDDEN int timerSem = 0;    /* WAITUNTIL sleepers without a semaphore of their own block here */
+HIDDEN int shootdownSem[MAXCPUS];   /* TLBSHOOTDOWN callers waiting for each processor to clear its TLB */
+HIDDEN unsigned int tlbASIDs[MAXCPUS];  /* ASIDs each processor's TLB may hold entries of */
+HIDDEN unsigned int flushPending;   /* Processors sent an IPITLBFLUSH they have not done yet */
+
+/******************** Function Prototypes ********************/
+HIDDEN void reapProcess(pcb_PTR process);
+HIDDEN void fastSyscall(state_PTR exceptionState);
+HIDDEN void cpuTimeReply(state_PTR state);
+
 /******************** Function Definitions ********************/
 
 /* ========================================================================
@@ -71,13 +142,26 @@
  *              Does not return (control passes to specific handlers)
  * ======================================================================== */
 void exceptionHandler() {
+    /* Only one processor at a time runs the nucleus */
+    acquireKernel();
+
     /* Get exception state from the BIOS data page */
-    state_PTR exceptionState = (state_PTR )BIOSDATAPAGE;
+    state_PTR exceptionState = EXCSTATE(CPUID());
     
     /* Extract exception code from the Cause register */
     unsigned int cause = exceptionState->s_cause;
     int excCode = (cause & CAUSE_EXCCODE_MASK) >> CAUSE_EXCCODE_SHIFT;
 
+    /* The process this processor ran was terminated from another one:
+     * its PCB was left to be reaped here, where it no longer runs */
+    if ((currentProcess != mkEmptyProcQ()) && currentProcess->p_killed) {
+        reapProcess(currentProcess);
+        currentProcess = mkEmptyProcQ();
+        if (excCode != INTERRUPTS) {
+            scheduler();
+        }
+    }
+
     /* Dispatch to the appropriate exception handler based on exception code */
     switch (excCode) {
         case INTERRUPTS:
@@ -120,13 +204,18 @@ void exceptionHandler() {
  * ======================================================================== */
 void syscallHandler() {
     /* Get exception state from BIOS data page */
-    state_PTR exceptionState = (state_PTR )BIOSDATAPAGE;
+    state_PTR exceptionState = EXCSTATE(CPUID());
 
     /* Increment PC before handling syscall to point to next instruction */
     exceptionState->s_pc += WORDLEN;
 
-    /* If Syscall greater than 8, then pass up the exception */
-    if ((exceptionState->s_a0 > 8) || (exceptionState->s_a0 < 1)) {
+    /* If Syscall is not a nucleus service, then pass up the exception. This
+     * happens before updateCurrentProcess, so a Support Level syscall is
+     * copied once, straight from the BIOS data page into the support
+     * structure, never into p_s: the process LDCXTs away and is resumed
+     * from sup_exceptState */
+    if ((exceptionState->s_a0 > MAXSYSCALL) || (exceptionState->s_a0 < MINSYSCALL) ||
+        (exceptionState->s_a0 == 0)) {
         passUpOrDie(GENERALEXCEPT);
         return;
     }
@@ -142,8 +231,14 @@ void syscallHandler() {
         return;
     }
 
+    /* Calls that can not block return from here without copying the state */
+    if (FASTSYSCALL) {
+        fastSyscall(exceptionState);
+    }
+
     /* Update current process state and get remaining time quantum */
     int quantumLeft = updateCurrentProcess(exceptionState);
+    perfCountSyscall(exceptionState->s_a0, processASID(currentProcess));
 
     /* Dispatch to appropriate system call service based on system call number in a0 */
     switch (exceptionState->s_a0) {
@@ -162,7 +257,14 @@ void syscallHandler() {
             break;
             
         case VERHOGEN: /* SYS4: V operation (signal) on a semaphore */
-            verhogen((int *)currentProcess->p_s.s_a1);
+            {
+                pcb_PTR woken = verhogen((int *)currentProcess->p_s.s_a1);
+                if (HANDOFF && (woken != mkEmptyProcQ()) && (quantumLeft > 0)) {
+                    /* Donate the rest of the quantum to the woken process */
+                    updateProcessTime();
+                    handoffProcess(woken, quantumLeft);
+                }
+            }
             break;
             
         case WAITIO: /* SYS5: Wait for I/O completion */
@@ -180,6 +282,28 @@ void syscallHandler() {
         case GETSUPPORTPTR: /* SYS8: Get support structure pointer */
             getSupportPtr();
             break;
+
+        case DRAINTRACE: /* SYS-1: Copy out scheduler trace events */
+            currentProcess->p_s.s_v0 = drainTrace((traceEvent_PTR)currentProcess->p_s.s_a1,
+                                                  currentProcess->p_s.s_a2);
+            break;
+
+        case READLATENCY: /* SYS-2: Copy out one line's interrupt latency histograms */
+            currentProcess->p_s.s_v0 = readLatency(currentProcess->p_s.s_a1,
+                                                   (latencyHist_PTR)currentProcess->p_s.s_a2);
+            break;
+
+        case WAITUNTIL: /* SYS-3: Block until a TOD, optionally on a semaphore */
+            waitUntil();
+            break;
+
+        case MAKEMUTEX: /* SYS-4: Make a semaphore a priority-inheriting mutex */
+            currentProcess->p_s.s_v0 = makeMutex((int *)currentProcess->p_s.s_a1);
+            break;
+
+        case TLBSHOOTDOWN: /* SYS-5: Wait until other processors drop some ASIDs' entries */
+            tlbShootdown();
+            break;
             
         default: /* Invalid system call number - pass to support level or terminate */
             passUpOrDie(GENERALEXCEPT);
@@ -197,6 +321,66 @@ void syscallHandler() {
     scheduler();
 }
 
+/* ========================================================================
+ * Function: fastSyscall
+ *
+ * Description: Does SYS3 on a semaphore that will not block, SYS4 that will
+ *              not hand off, SYS6 and SYS8 in place on the BIOS data page
+ *              state, charging the time up to the call with one TOD read,
+ *              and resumes the caller with LDST without reloading the PLT.
+ *              Any other call returns for the full path.
+ * 
+ * Parameters:
+ *              exceptionState - SYSCALL state saved by the BIOS (PC already
+ *                               advanced, caller known to be in kernel mode)
+ * 
+ * Returns:
+ *              Only if the call needs the full path
+ * ======================================================================== */
+HIDDEN void fastSyscall(state_PTR exceptionState) {
+    int number = exceptionState->s_a0;
+    int *semAdd = (int *)exceptionState->s_a1;
+    switch (number) {
+        case PASSEREN:
+            if (*semAdd <= 0) {
+                return; /* Would block */
+            }
+            break;
+        case VERHOGEN:
+            if (HANDOFF && (*semAdd < 0)) {
+                return; /* May hand the quantum to the process it wakes */
+            }
+            break;
+        case GETCPUTIME:
+        case GETSUPPORTPTR:
+            break;
+        default:
+            return;
+    }
+
+    /* The one TOD read: time up to the call, and p_time for SYS6 */
+    chargeEntryTime(exceptionState);
+    perfCountSyscall(number, processASID(currentProcess));
+
+    switch (number) {
+        case PASSEREN:
+            passeren(semAdd);
+            break;
+        case VERHOGEN:
+            verhogen(semAdd);
+            break;
+        case GETCPUTIME:
+            cpuTimeReply(exceptionState);
+            break;
+        default: /* GETSUPPORTPTR */
+            exceptionState->s_v0 = (int)currentProcess->p_supportStruct;
+    }
+
+    /* The PLT still runs the quantum: resume the caller as saved */
+    releaseKernel();
+    LDST(exceptionState);
+}
+
 /* ========================================================================
  * Function: createProcess
  *
@@ -230,12 +414,17 @@ void createProcess() {
             newPCB->p_supportStruct = NULL;
         }
 
+        /* Set the stride scheduling tickets if provided in a3 */
+        if (currentProcess->p_s.s_a3 > 0) {
+            newPCB->p_tickets = currentProcess->p_s.s_a3;
+        }
+
         /* Set parent and add to parent's child list */
         newPCB->p_prnt = currentProcess;
         insertChild(currentProcess, newPCB);
 
-        /* Add to high priority ready queue */
-        insertProcQ(&readyQueueHigh, newPCB);
+        /* Add to the ready queue of its level (allocPcb starts it at the highest) */
+        insertReadyQueue(newPCB);
 
         /* Update system process count */
         processCount++;
@@ -252,7 +441,12 @@ void createProcess() {
  * Function: terminateProcess
  *
  * Description: Implements SYS2 (TERMINATEPROCESS) system call. Terminates
- *              a process and all its descendents recursively.
+ *              a process and all its descendents. The subtree is walked
+ *              iteratively in post-order: the walk descends first-child
+ *              links to a leaf, reaps it (it is then its parent's first
+ *              child, so unlinking it is O(1)) and climbs back to the
+ *              parent. The parent links are the walk's stack, so the
+ *              whole teardown is O(subtree size) with no recursion.
  * 
  * Parameters:
  *              process - Pointer to the process to terminate, or NULL for
@@ -266,16 +460,61 @@ void terminateProcess(pcb_PTR process) {
         process = currentProcess;
     }
 
-    /* Recursively terminate all children */
-    while (!emptyChild(process)) {
-        terminateProcess(removeChild(process));
-    }
-    
-    /* Remove from parent's child list */
+    /* Remove from parent's child list, so the walk stops at the root */
     if (process->p_prnt != mkEmptyProcQ()) {
         outChild(process);
     }
 
+    int killedCurrent = FALSE;
+    pcb_PTR victim = process;
+    while (victim != mkEmptyProcQ()) {
+        /* Descend to a leaf of what is left of the subtree */
+        while (!emptyChild(victim)) {
+            victim = victim->p_child;
+        }
+
+        /* Reap it and climb back to its parent */
+        pcb_PTR parent = victim->p_prnt;
+        if (parent != mkEmptyProcQ()) {
+            removeChild(parent);
+        }
+        if (victim == currentProcess) {
+            killedCurrent = TRUE;
+        }
+        reapProcess(victim);
+        victim = parent;
+    }
+
+    /* Special handling if the current process was terminated */
+    if (killedCurrent) {
+        currentProcess = mkEmptyProcQ();
+        scheduler();
+    }
+}
+
+/* ========================================================================
+ * Function: reapProcess
+ *
+ * Description: Takes a process with no children out of whatever holds it
+ *              (the timer wheel, a semaphore's ASL queue or a ready queue)
+ *              and returns its PCB to the free list. Each removal is O(1):
+ *              the PCB records its ready level and its semaphore descriptor.
+ *              A process running on another processor is only marked
+ *              p_killed; that processor reaps it on its next entry.
+ * 
+ * Parameters:
+ *              process - Pointer to the process, already out of the tree
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void reapProcess(pcb_PTR process) {
+    /* A WAITUNTIL sleeper also leaves the timer wheel */
+    if (process->p_timerSlot != NOSLOT) {
+        removeTimer(process);
+        softBlockCount--;
+    }
+
     /* Remove from appropriate queue based on process state */
     if (process->p_semAdd != NULL) {
         /* Process is blocked on a semaphore */
@@ -295,6 +534,23 @@ void terminateProcess(pcb_PTR process) {
             /* Regular semaphore */
             (*semAdd)++;
         }
+    } else if (process == currentProcess) {
+        /* The current process is on no queue */
+        processCount--;
+    } else if ((CPUCOUNT > 1) && (process->p_readyLevel == NOTREADY)) {
+        /* Running on another processor: freeing the PCB now would pull it
+         * from under that processor, so mark it and send it an IPIKILL to
+         * reap it on its next nucleus entry */
+        int cpu;
+        for (cpu = 0; cpu < CPUCOUNT; cpu++) {
+            if (cpuProcess[cpu] == process) {
+                if (!process->p_killed) {
+                    *((unsigned int *)IPIOUTBOX) = (CPUBIT(cpu) << IPIRECIPSHIFT) | IPIKILL;
+                }
+                process->p_killed = TRUE;
+                return;
+            }
+        }
     } else {
         /* Process is in ready queue */
         pcb_PTR removedProcess = getProcess(process);
@@ -305,13 +561,8 @@ void terminateProcess(pcb_PTR process) {
         }
     }
 
-    /* Special handling if terminating current process */
-    if (process == currentProcess) {
-        currentProcess = mkEmptyProcQ();
-        processCount--;
-        freePcb(process);
-        scheduler();
-    }
+    /* It no longer holds any mutex */
+    mutexOwnerGone(process);
 
     /* Return PCB to free list */
     freePcb(process);
@@ -335,14 +586,27 @@ void passeren(int *semAdd) {
 
     /* Decrement semaphore value */
     (*semAdd)--;
+    lockAcquired(semAdd, *semAdd < 0);
+    if (*semAdd >= 0) {
+        mutexAcquired(semAdd, currentProcess);
+    }
 
     /* Check if process should block */
     if (*semAdd < 0) {
         /* Update process time before blocking */
         updateProcessTime();
+        currentProcess->p_blockStart = startTOD;
+
+        /* Blocking before the quantum expires counts towards promotion */
+        promoteProcess(currentProcess);
+
+        /* A waiter on a mutex lends its level to the owner */
+        mutexAcquired(semAdd, currentProcess);
 
         /* Block process on semaphore */
         insertBlocked(semAdd, currentProcess);
+        traceEvent(TRACE_BLOCK, currentProcess, semAdd);
+        perfCount(PERF_BLOCKEDP, processASID(currentProcess));
 
         /* Current process is now blocked */
         currentProcess = mkEmptyProcQ();
@@ -381,10 +645,24 @@ pcb_PTR verhogen(int *semAdd) {
         p = removeBlocked(semAdd);
 
         if (p != mkEmptyProcQ()) {
-            /* Add unblocked process to high priority ready queue */
-            insertProcQ(&readyQueueHigh, p);
+            /* A timed P was satisfied before its deadline: cancel the timer */
+            if (p->p_timerSlot != NOSLOT) {
+                removeTimer(p);
+                softBlockCount--;
+            }
+
+            /* Add unblocked process to the ready queue of its level */
+            traceEvent(TRACE_UNBLOCK, p, semAdd);
+            perfCount(PERF_WAKINGV, processASID(p));
+            if (LOCKSTATS) {
+                cpu_t currentTOD;
+                STCK(currentTOD);
+                lockWaited(semAdd, currentTOD - p->p_blockStart);
+            }
+            insertReadyQueue(p);
         }
     }
+    mutexReleased(semAdd, p);
 
     return p;
     
@@ -413,18 +691,26 @@ void waitIO() {
     int device = currentProcess->p_s.s_a2;
     int term_read = currentProcess->p_s.s_a3;  /* For terminals: 1 for read, 0 for write */
     
-    /* Calculate device semaphore index */
-    int devSemaphoreIndex = DEVPERINT * (line - DISKINT) + device;
+    /* Look up the device semaphore */
+    devDesc_PTR desc = DEVDESC(line, device);
+    unsigned int command = desc->dd_reg->d_command;
+    if (line == TERMINT) {
+        command = desc->dd_reg->t_transm_command;
+    }
     if (line == TERMINT && term_read) {
         /* Terminal read operations use a different semaphore */
-        devSemaphoreIndex += DEVPERINT;
+        desc = TERMRECVDESC(device);
+        command = desc->dd_reg->t_recv_command;
     }
+
+    /* The driver has just written the command: the device is busy from here */
+    devIssued(desc - deviceTable, command);
     
     /* Increment soft block count for this I/O operation */
     softBlockCount++;
 
     /* Block the process on the device semaphore */
-    passeren(&deviceSemaphores[devSemaphoreIndex]);
+    passeren(desc->dd_sem);
 
     /* Control is returned to syscallHandler, which will either
     * resume the current process or call the scheduler as needed */
@@ -434,10 +720,12 @@ void waitIO() {
  * Function: getCpuTime
  *
  * Description: Implements SYS6 (GETCPUTIME) system call. Returns the CPU
- *              time used by the current process.
+ *              time used by the current process. If a1 holds the address of
+ *              a cpuTimes_t, it is filled with the user, support, nucleus
+ *              and soft-blocked components.
  * 
  * Parameters:
- *              None
+ *              None (optional cpuTimes_t address in a1)
  * 
  * Returns:
  *              None (places result in v0 register)
@@ -446,16 +734,40 @@ void getCpuTime() {
     /* Already incremented PC in syscallHandler */
     /* Current Process already updated with CPU time, new process state (exceptionState) in syscallHandler */
 
-    /* Update time to account for kernel execution */
-    updateProcessTime();
-
-    /* Store CPU time in v0 register for return to caller */
-    currentProcess->p_s.s_v0 = currentProcess->p_time;
+    cpuTimeReply(&currentProcess->p_s);
 
     /* Control is returned to syscallHandler, which will either
     * resume the current process or call the scheduler as needed */
 }
 
+/* ========================================================================
+ * Function: cpuTimeReply
+ *
+ * Description: Places the current process's CPU time (updated on kernel
+ *              entry) in the v0 of a state and, if its a1 holds the address
+ *              of a cpuTimes_t, fills in the time breakdown.
+ * 
+ * Parameters:
+ *              state - State of the SYS6 caller (p_s, or the BIOS data
+ *                      page state on the fast path)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void cpuTimeReply(state_PTR state) {
+    state->s_v0 = currentProcess->p_time;
+
+    /* If a buffer was passed in a1, also return the time breakdown
+     * (callers without one pass 0, which is not this system's NULL) */
+    cpuTimes_PTR times = (cpuTimes_PTR)state->s_a1;
+    if (times != 0) {
+        times->ct_user = currentProcess->p_userTime;
+        times->ct_support = currentProcess->p_supportTime;
+        times->ct_kernel = currentProcess->p_kernelTime;
+        times->ct_blocked = currentProcess->p_blockedTime;
+    }
+}
+
 /* ========================================================================
  * Function: waitClock
  *
@@ -475,6 +787,9 @@ void waitClock() {
     /* Increment soft block count */
     softBlockCount++;
 
+    /* Make sure a tick is coming (the timer is stopped while nobody waits) */
+    armPseudoClock();
+
     /* Block on pseudoclock semaphore */
     passeren(&deviceSemaphores[DEVICE_COUNT-1]);
 
@@ -505,6 +820,164 @@ void getSupportPtr() {
     * resume the current process or call the scheduler as needed */
 }
 
+/* ========================================================================
+ * Function: waitUntil
+ *
+ * Description: Implements the nucleus-only WAITUNTIL call. Blocks the
+ *              current process until the TOD clock reaches a1. If a2 holds
+ *              a semaphore address (0 for none) the call is a P on it that
+ *              gives up at the deadline. The process sits on the timer
+ *              wheel, so it is readied once its deadline has passed rather
+ *              than on every pseudo-clock tick. With ONESHOTTIMER set the
+ *              interval timer is armed for the deadline itself.
+ * 
+ * Parameters:
+ *              None (deadline in a1, optional semaphore address in a2)
+ * 
+ * Returns:
+ *              None (v0 is 0 if the semaphore was acquired, TIMEDOUT if the
+ *              deadline passed first)
+ * ======================================================================== */
+void waitUntil() {
+    /* Already incremented PC in syscallHandler */
+    /* Current Process already updated with CPU time, new process state (exceptionState) in syscallHandler */
+
+    cpu_t deadline = (cpu_t)currentProcess->p_s.s_a1;
+    int *semAdd = (int *)currentProcess->p_s.s_a2;
+    if (semAdd == 0) {
+        semAdd = &timerSem;
+    }
+    currentProcess->p_s.s_v0 = 0;
+
+    /* A P that would not block needs no timer */
+    if (*semAdd > 0) {
+        passeren(semAdd);
+        return;
+    }
+
+    /* Deadline already passed */
+    cpu_t currentTOD;
+    STCK(currentTOD);
+    if (deadline <= currentTOD) {
+        currentProcess->p_s.s_v0 = TIMEDOUT;
+        return;
+    }
+
+    /* Sleep on the wheel and the semaphore; whichever fires first wins */
+    softBlockCount++;
+    insertTimer(currentProcess, deadline);
+    if (ONESHOTTIMER) {
+        armTimerAt(deadline);
+    } else {
+        armTimerTick(TICKOF(deadline));
+    }
+    passeren(semAdd);
+
+    /* Control is returned to syscallHandler, which will either
+    * resume the current process or call the scheduler as needed */
+}
+
+/* ========================================================================
+ * Function: tlbShootdown
+ *
+ * Description: Implements the nucleus-only TLBSHOOTDOWN call. The first
+ *              call of a shootdown (a2 = 0) sends IPITLBFLUSH, in one Outbox
+ *              write, to every other processor whose TLB may hold entries of
+ *              an ASID in the mask in a1 and has no flush pending. Then it
+ *              looks at the processors from a2 up for one still to clear
+ *              its TLB and blocks the caller until it has. The caller has
+ *              already changed the page table entries, so a processor
+ *              refilling meanwhile loads the new ones.
+ * 
+ * Parameters:
+ *              None (ASID mask in a1, first processor to look at in a2)
+ * 
+ * Returns:
+ *              None (v0 is the processor to look at next, CPUCOUNT once
+ *              every processor has been looked at)
+ * ======================================================================== */
+void tlbShootdown() {
+    /* Already incremented PC in syscallHandler */
+    /* Current Process already updated with CPU time, new process state (exceptionState) in syscallHandler */
+
+    unsigned int asids = currentProcess->p_s.s_a1;
+    int first = MAX((int)currentProcess->p_s.s_a2, 0);
+    int cpu;
+    if (first == 0) {
+        unsigned int targets = 0;
+        for (cpu = 0; cpu < CPUCOUNT; cpu++) {
+            if ((cpu != CPUID()) && (tlbASIDs[cpu] & asids)) {
+                targets |= CPUBIT(cpu);
+            }
+        }
+        /* A flush already pending comes after these changes: no second message */
+        unsigned int send = targets & ~flushPending;
+        flushPending |= targets;
+        if (send != 0) {
+            *((unsigned int *)IPIOUTBOX) = (send << IPIRECIPSHIFT) | IPITLBFLUSH;
+        }
+    }
+
+    for (cpu = first; cpu < CPUCOUNT; cpu++) {
+        if ((cpu != CPUID()) && (flushPending & CPUBIT(cpu)) && (tlbASIDs[cpu] & asids)) {
+            /* The semaphore never goes positive, so this blocks */
+            currentProcess->p_s.s_v0 = cpu + 1;
+            passeren(&shootdownSem[cpu]);
+            return;
+        }
+    }
+    currentProcess->p_s.s_v0 = CPUCOUNT;
+}
+
+/* ========================================================================
+ * Function: noteTLBASID
+ *
+ * Description: Records that the TLB of a processor may hold entries of a
+ *              process's ASID from now on. Called whenever a processor
+ *              other than the boot one loads a process.
+ * 
+ * Parameters:
+ *              cpu - Processor loading the process
+ *              p - Process it loads
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void noteTLBASID(int cpu, pcb_PTR p) {
+    tlbASIDs[cpu] |= ASIDBIT(processASID(p));
+}
+
+/* ========================================================================
+ * Function: releaseShootdowns
+ *
+ * Description: If a processor was asked to flush, clears its TLB, leaves
+ *              only its current process's ASID in its mask, and wakes every
+ *              TLBSHOOTDOWN caller waiting on it. Called on the processor
+ *              itself, by the scheduler and on an IPI.
+ * 
+ * Parameters:
+ *              cpu - Executing processor
+ * 
+ * Returns:
+ *              TRUE if the TLB was cleared, else FALSE
+ * ======================================================================== */
+int releaseShootdowns(int cpu) {
+    if (!(flushPending & CPUBIT(cpu))) {
+        return FALSE;
+    }
+
+    TLBCLR();
+    flushPending &= ~CPUBIT(cpu);
+    tlbASIDs[cpu] = 0;
+    if (cpuProcess[cpu] != mkEmptyProcQ()) {
+        noteTLBASID(cpu, cpuProcess[cpu]);
+    }
+    while (shootdownSem[cpu] < 0) {
+        verhogen(&shootdownSem[cpu]);
+    }
+    return TRUE;
+}
+
 /* ========================================================================
  * Function: tlbExceptionHandler
  *
@@ -556,11 +1029,40 @@ void passUpOrDie(int exceptionType) {
     if (currentProcess != mkEmptyProcQ() && currentProcess->p_supportStruct != NULL) {
         /* Process has support structure - pass exception to the support level */
         
+        /* Charge the time up to the exception (pass ups skip updateCurrentProcess) */
+        chargeEntryTime(EXCSTATE(CPUID()));
+
         /* Copy exception state to the appropriate field in the support structure */
         copyState(&currentProcess->p_supportStruct->sup_exceptState[exceptionType], 
-                 (state_PTR)BIOSDATAPAGE);
+                 EXCSTATE(CPUID()));
+
+        /* The Support Level only runs on the boot processor: start the
+         * handler from the ready queue instead, where only it picks it up */
+        if (CPUID() != BOOTCPU) {
+            /* A TLB exception may come from an entry older than the page
+             * table (no shootdown for added permissions): drop it here */
+            if (exceptionType == PGFAULTEXCEPT) {
+                setENTRYHI(EXCSTATE(CPUID())->s_entryHI);
+                TLBP();
+                unsigned int index = getINDEX();
+                if (!((index >> PROBESHIFT) & ON)) {
+                    setENTRYHI(index << VPNSHIFT);
+                    setENTRYLO(0);
+                    TLBWI();
+                }
+            }
+            context_t *context = &currentProcess->p_supportStruct->sup_exceptContext[exceptionType];
+            currentProcess->p_s.s_pc = context->c_pc;
+            currentProcess->p_s.s_t9 = context->c_pc;
+            currentProcess->p_s.s_sp = context->c_stackPtr;
+            currentProcess->p_s.s_status = context->c_status;
+            insertReadyQueue(currentProcess);
+            currentProcess = mkEmptyProcQ();
+            scheduler();
+        }
 
         /* Load support level context to handle the exception */
+        releaseKernel();
         LDCXT(currentProcess->p_supportStruct->sup_exceptContext[exceptionType].c_stackPtr,
               currentProcess->p_supportStruct->sup_exceptContext[exceptionType].c_status,
               currentProcess->p_supportStruct->sup_exceptContext[exceptionType].c_pc);
@@ -574,7 +1076,9 @@ void passUpOrDie(int exceptionType) {
 /* ========================================================================
  * Function: copyState
  *
- * Description: Helper function to make a deep copy of a processor state.
+ * Description: Helper function to make a deep copy of a processor state,
+ *              as one block of STATEWORDS words (entryHI, cause, status, pc
+ *              and the registers, in state_t order), five words a pass.
  * 
  * Parameters:
  *              dest - Destination state structure
@@ -589,17 +1093,8 @@ void copyState(state_PTR dest, state_PTR src) {
         return;
     }
 
-    /* Copy special registers */
-    dest->s_entryHI = src->s_entryHI;
-    dest->s_cause = src->s_cause;
-    dest->s_status = src->s_status;
-    dest->s_pc = src->s_pc;
-    
-    /* Copy general purpose registers */
-    int i;
-    for (i = 0; i < STATEREGNUM; i++) {
-        dest->s_reg[i] = src->s_reg[i];
-    }
+    /* Copy the whole state in word bursts */
+    copyWords((unsigned int *)dest, (unsigned int *)src, STATEWORDS);
 }
 
 /* ========================================================================
@@ -617,14 +1112,14 @@ void copyState(state_PTR dest, state_PTR src) {
 int updateCurrentProcess(state_PTR exceptionState) {
     /* Check if current process exists */
     if (currentProcess != mkEmptyProcQ()) {
-        /* Save quantum left */
-        int quantumLeft = getTIMER();
+        /* Save quantum left, including any the profiler held back from the PLT */
+        int quantumLeft = (int)getTIMER() + (int)profileBanked();
 
         /* Update process state with exception state */
         copyState(&currentProcess->p_s, exceptionState);
 
         /* Update CPU time for the current process */
-        updateProcessTime();
+        chargeEntryTime(exceptionState);
 
         return quantumLeft;
     }
@@ -632,11 +1127,41 @@ int updateCurrentProcess(state_PTR exceptionState) {
     return 0; /* No current process */
 }
 
+/* ========================================================================
+ * Function: chargeEntryTime
+ *
+ * Description: Reads the TOD clock once on kernel entry and charges the time
+ *              since the current process was dispatched to user time or to
+ *              support time, depending on the mode the exception interrupted.
+ * 
+ * Parameters:
+ *              exceptionState - Pointer to exception state from BIOS data page
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void chargeEntryTime(state_PTR exceptionState) {
+    cpu_t currentTOD;
+    STCK(currentTOD);
+    cpu_t elapsed = currentTOD - startTOD;
+
+    if ((exceptionState->s_status & STATUS_KUp) != ALLOFF) {
+        currentProcess->p_userTime += elapsed;
+    } else {
+        currentProcess->p_supportTime += elapsed;
+    }
+    currentProcess->p_time += elapsed;
+
+    /* Time from here until dispatch or block is nucleus time */
+    startTOD = currentTOD;
+}
+
 /* ========================================================================
  * Function: updateProcessTime
  *
  * Description: Updates the CPU time for the current process based on elapsed
- *              time since last update.
+ *              time since last update. Called while in the nucleus, so the
+ *              time is charged as nucleus time.
  * 
  * Parameters:
  *              None
@@ -651,10 +1176,28 @@ void updateProcessTime() {
         cpu_t currentTOD;
         STCK(currentTOD);
         
-        /* Add elapsed time to process's accumulated CPU time */
+        /* Add elapsed time to process's accumulated CPU and nucleus time */
         currentProcess->p_time += (currentTOD - startTOD);
+        currentProcess->p_kernelTime += (currentTOD - startTOD);
 
         /* Update start time for next measurement */
         startTOD = currentTOD;
     }
 }
+
+/* ========================================================================
+ * Function: chargeBlockedTime
+ *
+ * Description: Adds the time since a process blocked to its soft-blocked
+ *              time. Called by the interrupt handlers as they wake it.
+ * 
+ * Parameters:
+ *              p - Pointer to the process being woken
+ *              currentTOD - Time of day of the wake-up
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void chargeBlockedTime(pcb_PTR p, cpu_t currentTOD) {
+    p->p_blockedTime += (currentTOD - p->p_blockStart);
+}
@@ -0,0 +1,651 @@
+/******************************* flashLog.c *************************************
+ *
+ * Module: Flash Logs
+ *
+ * Description:
+ * This module turns the user-visible blocks FLASHLOGBASE and up of each
+ * flash device (past the image blocks of a backing region based at 0)
+ * into a log-structured store. The FLASHLOGBLOCKS logical blocks U-procs
+ * name in SYS16/SYS17 are remapped onto LOGSLOTS physical log slots, and
+ * every write is appended at the log head instead of overwriting its
+ * block in place, so scattered writes land on consecutive flash blocks.
+ * A RAM map gives each logical block's slot, and is checkpointed to flash
+ * so it survives a reboot.
+ *
+ * Policy Decisions:
+ * - Layout: Slot s is block FLASHLOGBASE + s; LOGCKPT and LOGCKPT + 1
+ *   hold alternate checkpoints; the rest of the area (logical blocks
+ *   FLASHLOGBLOCKS and up) is spare and may not be named by U-procs
+ *   (logReservedBlock). A device gets a log only if the whole area fits
+ *   on it, none of it is a U-proc's backing store or the segments'
+ *   store, and the device is not the trace sink's; otherwise its blocks
+ *   stay in place
+ * - Staging: With BLOCKCACHE set the block cache is the staging buffer:
+ *   SYS16 only dirties a cache entry, and the flusher's pass appends the
+ *   dirty blocks to the log one after another. Without it each write is
+ *   appended synchronously
+ * - Appending: The head fills a segment of LOGSEGBLOCKS slots in order,
+ *   then moves to the next wholly free segment (any free slot if none).
+ *   The slot a write replaces becomes stale
+ * - Cleaning: After each flush the flusher daemon keeps LOGCLEANMIN free
+ *   segments per log: it picks the full segment with the fewest live
+ *   blocks, moves them to the head under one device grant, and
+ *   checkpoints. A user write that races a move wins; the moved copy is
+ *   dropped
+ * - Recovery: A checkpoint holds a sequence number, the whole map and a
+ *   checksum. At boot the higher valid one is loaded; with none the map
+ *   is the identity, so blocks written before the log existed keep their
+ *   contents. A stale slot is only reused after a checkpoint no longer
+ *   naming it is on flash, so the map of any checkpoint on flash is
+ *   always intact. Writes after the last checkpoint are lost in a crash;
+ *   the flusher checkpoints a changed log every BCACHEFLUSH microseconds
+ *   and test() before shutdown
+ * - Reads: A read looks its slot up while holding the device's grant, so
+ *   no write can reuse that slot before the read is done
+ * - Space: There are always more slots than logical blocks. A write that
+ *   finds no free slot checkpoints to free the stale ones, or waits for
+ *   the writes in flight
+ *
+ * Functions:
+ * - initFlashLogs: Recovers the log of every device that can hold one
+ * - flashLogged: Checks if a block lives in its device's log
+ * - logReservedBlock: Checks if a block is a log's spare or checkpoint
+ * - logTransfer: Reads or appends a logged block
+ * - cleanFlashLogs: Cleans segments and checkpoints every log
+ * - syncFlashLogs: Checkpoints every changed log
+ * - logArea: Checks if a device can hold a log
+ * - recoverLog: Loads a log's newest valid checkpoint
+ * - validCheckpoint: Checks a checkpoint read from flash
+ * - checkpointLog: Writes a log's map and frees its stale slots
+ * - allocSlot: Takes the next free slot at the log head
+ * - freeSegment: Finds a wholly free segment
+ * - cleanSegment: Moves the live blocks out of a segment
+ * - wakeWriters: Wakes the writers waiting for a free slot
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+#include "../h/flashLog.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* vmSupport.c */
+extern int reservedBlock(int flashNum, int block);
+/* traceSink.c */
+extern int traceSinkDevice(int flashNum);
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN int logArea(int flashNum);
+HIDDEN void recoverLog(int flashNum);
+HIDDEN int validCheckpoint(flashLogCkpt_PTR ckpt);
+HIDDEN void checkpointLog(int flashNum);
+HIDDEN int allocSlot(int flashNum);
+HIDDEN int freeSegment(int flashNum, int from);
+HIDDEN void cleanSegment(int flashNum, int segment);
+HIDDEN void wakeWriters(int flashNum);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int logActive[DEV_PER_LINE];                     /* The device's user blocks are logged */
+HIDDEN short logMap[DEV_PER_LINE][FLASHLOGBLOCKS];      /* Slot of each logical block */
+HIDDEN short logOwner[DEV_PER_LINE][LOGSLOTS];          /* Logical block in each slot (or LOGFREE, LOGWRITING, LOGSTALE) */
+HIDDEN int logHead[DEV_PER_LINE];                       /* Next slot to append to */
+HIDDEN unsigned int logSeq[DEV_PER_LINE];               /* Number of the last checkpoint */
+HIDDEN int logChanged[DEV_PER_LINE];                    /* The map changed since the last checkpoint */
+HIDDEN int logMutex[DEV_PER_LINE];                      /* Guards a log's map and slots */
+HIDDEN int logCkptMutex[DEV_PER_LINE];                  /* One checkpoint of a log at a time */
+HIDDEN int logSpaceSem[DEV_PER_LINE];                   /* Writers waiting for a free slot block here */
+HIDDEN int logSpaceWaiters[DEV_PER_LINE];               /* Number of them */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initFlashLogs
+ *
+ * Description: Gives every flash device that can hold a log one, loaded
+ *              from its newest valid checkpoint. Called once at boot after
+ *              the backing regions are set and before any U-proc runs
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initFlashLogs() {
+    int flashNum;
+    for (flashNum = 0; flashNum < DEV_PER_LINE; flashNum++) {
+        logActive[flashNum] = FALSE;
+        logMutex[flashNum] = 1;
+        logCkptMutex[flashNum] = 1;
+        logSpaceSem[flashNum] = 0;
+        logSpaceWaiters[flashNum] = 0;
+        if (FLASHLOG && logArea(flashNum)) {
+            recoverLog(flashNum);
+            logActive[flashNum] = TRUE;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: flashLogged
+ *
+ * Description: Checks if a flash block is one of the logical blocks of
+ *              its device's log
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *              block - Block number on the device
+ *
+ * Returns:
+ *              TRUE if reads and writes of the block go through the log
+ * ======================================================================== */
+int flashLogged(int flashNum, int block) {
+    return logActive[flashNum] && (block >= FLASHLOGBASE) && (block < FLASHLOGBASE + FLASHLOGBLOCKS);
+}
+
+/* ========================================================================
+ * Function: logReservedBlock
+ *
+ * Description: Checks if a flash block is in a log's area past its
+ *              logical blocks (spare slots and checkpoints)
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *              block - Block number on the device
+ *
+ * Returns:
+ *              TRUE if U-procs may not name the block
+ * ======================================================================== */
+int logReservedBlock(int flashNum, int block) {
+    return logActive[flashNum] && (block >= FLASHLOGBASE + FLASHLOGBLOCKS) && (block < LOGAREAEND);
+}
+
+/* ========================================================================
+ * Function: logTransfer
+ *
+ * Description: Reads a logged block from its slot, or appends a write of
+ *              it at the log head and points the map at the new slot once
+ *              the write succeeded. flashTransfer routes logged blocks here
+ *
+ * Parameters:
+ *              operation - READ or WRITE
+ *              flashNum - Flash device number
+ *              block - Logical block number (flashLogged)
+ *              bufferAddr - Physical address of the buffer
+ *              asid - ASID the transfer is charged to
+ *
+ * Returns:
+ *              READY on success, negative device status on error
+ * ======================================================================== */
+int logTransfer(int operation, int flashNum, int block, memaddr bufferAddr, int asid) {
+    int logical = block - FLASHLOGBASE;
+    diskRequest_t request;
+    int status;
+
+    if (operation == READ) {
+        /* Look the slot up under the grant, so no write reuses it meanwhile */
+        acquireDevice(FLASHINT, flashNum, &request, block, asid);
+        SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+        int slot = logMap[flashNum][logical];
+        SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+        status = flashRW(READ, flashNum, FLASHLOGBASE + slot, bufferAddr);
+        releaseDevice(FLASHINT, flashNum, 1);
+        return status;
+    }
+
+    /* Take a slot at the head, freeing stale ones or waiting if there is none */
+    SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+    int slot = allocSlot(flashNum);
+    while (slot == NOBLOCK) {
+        int stale = FALSE;
+        int i;
+        for (i = 0; i < LOGSLOTS; i++) {
+            if (logOwner[flashNum][i] == LOGSTALE) {
+                stale = TRUE;
+            }
+        }
+        if (stale) {
+            SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+            checkpointLog(flashNum);
+        } else {
+            logSpaceWaiters[flashNum]++;
+            SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+            SYSCALL(PASSEREN, (int)&logSpaceSem[flashNum], 0, 0);
+        }
+        SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+        slot = allocSlot(flashNum);
+    }
+    logOwner[flashNum][slot] = LOGWRITING;
+    SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+
+    acquireDevice(FLASHINT, flashNum, &request, FLASHLOGBASE + slot, asid);
+    status = flashRW(WRITE, flashNum, FLASHLOGBASE + slot, bufferAddr);
+    releaseDevice(FLASHINT, flashNum, 1);
+
+    /* Point the map at the new copy; the old one goes stale */
+    SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+    if (status == READY) {
+        logOwner[flashNum][logMap[flashNum][logical]] = LOGSTALE;
+        logMap[flashNum][logical] = slot;
+        logOwner[flashNum][slot] = logical;
+        logChanged[flashNum] = TRUE;
+    } else {
+        logOwner[flashNum][slot] = LOGFREE;
+    }
+    wakeWriters(flashNum);
+    SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+    return status;
+}
+
+/* ========================================================================
+ * Function: cleanFlashLogs
+ *
+ * Description: For every log: while it has fewer than LOGCLEANMIN free
+ *              segments, moves the live blocks out of the full segment
+ *              with the fewest and checkpoints so its slots are free;
+ *              then checkpoints the log if it changed. Called by the block
+ *              cache flusher after each flush
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void cleanFlashLogs() {
+    int flashNum;
+    for (flashNum = 0; flashNum < DEV_PER_LINE; flashNum++) {
+        if (!logActive[flashNum]) {
+            continue;
+        }
+
+        int pass;
+        for (pass = 0; pass < LOGSEGS; pass++) {
+            /* Count the free segments and pick the full one with the fewest live blocks */
+            SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+            int free = 0;
+            int victim = NOBLOCK;
+            int victimLive = LOGSEGBLOCKS;
+            int seg;
+            for (seg = 0; seg < LOGSEGS; seg++) {
+                int live = 0;
+                int empty = 0;
+                int busy = FALSE;
+                int i;
+                for (i = seg * LOGSEGBLOCKS; i < (seg + 1) * LOGSEGBLOCKS; i++) {
+                    if (logOwner[flashNum][i] >= 0) {
+                        live++;
+                    } else if (logOwner[flashNum][i] == LOGFREE) {
+                        empty++;
+                    } else if (logOwner[flashNum][i] == LOGWRITING) {
+                        busy = TRUE;
+                    }
+                }
+                if (empty == LOGSEGBLOCKS) {
+                    free++;
+                } else if ((empty == 0) && !busy && (live < victimLive)) {
+                    victim = seg;
+                    victimLive = live;
+                }
+            }
+            SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+            if ((free >= LOGCLEANMIN) || (victim == NOBLOCK)) {
+                break;
+            }
+
+            cleanSegment(flashNum, victim);
+            checkpointLog(flashNum);
+        }
+
+        if (logChanged[flashNum]) {
+            checkpointLog(flashNum);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: syncFlashLogs
+ *
+ * Description: Checkpoints every log whose map changed since its last
+ *              checkpoint. Called by test() before shutdown, after the
+ *              block cache is flushed
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void syncFlashLogs() {
+    int flashNum;
+    for (flashNum = 0; flashNum < DEV_PER_LINE; flashNum++) {
+        if (logActive[flashNum] && logChanged[flashNum]) {
+            checkpointLog(flashNum);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: logArea
+ *
+ * Description: Checks that a flash device is installed, holds the whole
+ *              log area clear of the stack and shadow blocks a region
+ *              spanning the device would reserve (a clone may take one
+ *              later), that no block of it is a U-proc's backing store
+ *              or the shared segments' store, and that the trace sink did
+ *              not claim the device
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              TRUE if the device can hold a log
+ * ======================================================================== */
+int logArea(int flashNum) {
+    device_t *flash = DEVDESC(FLASHINT, flashNum)->dd_reg;
+    if ((flash->d_status == NOTINSTALLED) || ((int)flash->d_data1 < LOGAREAEND + STACKEXTPAGES + SHADOWPAGES) ||
+        traceSinkDevice(flashNum)) {
+        return FALSE;
+    }
+    if ((flashNum == SHMFLASH) && (SHMBLOCK < LOGAREAEND) &&
+        (SHMBLOCK + (SHMSEGMENTS * SHMMAXPAGES) > FLASHLOGBASE)) {
+        return FALSE;
+    }
+    int block;
+    for (block = FLASHLOGBASE; block < LOGAREAEND; block++) {
+        if (reservedBlock(flashNum, block)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* ========================================================================
+ * Function: recoverLog
+ *
+ * Description: Reads both checkpoint blocks of a device and loads the map
+ *              of the valid one with the higher number, or the identity
+ *              map if neither is valid; every slot the map does not name
+ *              is free, and the head starts on a free segment
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void recoverLog(int flashNum) {
+    flashLogCkpt_PTR ckpt = (flashLogCkpt_PTR)FLASH_DMABUFFER_ADDR(flashNum);
+    diskRequest_t request;
+    int found = FALSE;
+    int i, copy;
+
+    for (i = 0; i < FLASHLOGBLOCKS; i++) {
+        logMap[flashNum][i] = i;
+    }
+    logSeq[flashNum] = 0;
+
+    acquireDevice(FLASHINT, flashNum, &request, LOGCKPT, SYSTEMASID);
+    for (copy = 0; copy < 2; copy++) {
+        if ((flashRW(READ, flashNum, LOGCKPT + copy, (memaddr)ckpt) == READY) && validCheckpoint(ckpt) &&
+            (!found || (ckpt->lc_seq > logSeq[flashNum]))) {
+            for (i = 0; i < FLASHLOGBLOCKS; i++) {
+                logMap[flashNum][i] = ckpt->lc_map[i];
+            }
+            logSeq[flashNum] = ckpt->lc_seq;
+            found = TRUE;
+        }
+    }
+    releaseDevice(FLASHINT, flashNum, 2);
+
+    for (i = 0; i < LOGSLOTS; i++) {
+        logOwner[flashNum][i] = LOGFREE;
+    }
+    for (i = 0; i < FLASHLOGBLOCKS; i++) {
+        logOwner[flashNum][logMap[flashNum][i]] = i;
+    }
+    logChanged[flashNum] = FALSE;
+    logHead[flashNum] = freeSegment(flashNum, 0);
+}
+
+/* ========================================================================
+ * Function: validCheckpoint
+ *
+ * Description: Checks the magic number and checksum of a checkpoint and
+ *              that its map names distinct slots
+ *
+ * Parameters:
+ *              ckpt - Checkpoint read from flash
+ *
+ * Returns:
+ *              TRUE if its map can be loaded
+ * ======================================================================== */
+int validCheckpoint(flashLogCkpt_PTR ckpt) {
+    if (ckpt->lc_magic != LOGMAGIC) {
+        return FALSE;
+    }
+    unsigned int sum = ckpt->lc_magic + ckpt->lc_seq;
+    unsigned int used = 0;
+    int i;
+    for (i = 0; i < FLASHLOGBLOCKS; i++) {
+        int slot = ckpt->lc_map[i];
+        if ((slot < 0) || (slot >= LOGSLOTS) || (used & (1U << slot))) {
+            return FALSE;
+        }
+        used |= (1U << slot);
+        sum += (unsigned int)slot << (i % 16);
+    }
+    return sum == ckpt->lc_sum;
+}
+
+/* ========================================================================
+ * Function: checkpointLog
+ *
+ * Description: Writes a log's map, with the next number, over the older
+ *              of its two checkpoints. Once it is on flash the slots that
+ *              were stale when the map was taken are free again (and
+ *              writers waiting for space are woken); if the write fails
+ *              they stay stale and the log stays changed
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void checkpointLog(int flashNum) {
+    SYSCALL(PASSEREN, (int)&logCkptMutex[flashNum], 0, 0);
+
+    /* Take the map and the stale slots it no longer names */
+    short map[FLASHLOGBLOCKS];
+    unsigned int stale = 0;
+    int i;
+    SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+    for (i = 0; i < FLASHLOGBLOCKS; i++) {
+        map[i] = logMap[flashNum][i];
+    }
+    for (i = 0; i < LOGSLOTS; i++) {
+        if (logOwner[flashNum][i] == LOGSTALE) {
+            stale |= (1U << i);
+        }
+    }
+    unsigned int seq = ++logSeq[flashNum];
+    logChanged[flashNum] = FALSE;
+    SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+
+    /* Write it through the device's DMA buffer under its grant */
+    flashLogCkpt_PTR ckpt = (flashLogCkpt_PTR)FLASH_DMABUFFER_ADDR(flashNum);
+    diskRequest_t request;
+    acquireDevice(FLASHINT, flashNum, &request, LOGCKPT, SYSTEMASID);
+    ckpt->lc_magic = LOGMAGIC;
+    ckpt->lc_seq = seq;
+    ckpt->lc_sum = LOGMAGIC + seq;
+    for (i = 0; i < FLASHLOGBLOCKS; i++) {
+        ckpt->lc_map[i] = map[i];
+        ckpt->lc_sum += (unsigned int)map[i] << (i % 16);
+    }
+    int status = flashRW(WRITE, flashNum, LOGCKPT + (seq & 1), (memaddr)ckpt);
+    releaseDevice(FLASHINT, flashNum, 1);
+
+    /* Only now may the stale slots be written over */
+    SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+    if (status == READY) {
+        for (i = 0; i < LOGSLOTS; i++) {
+            if (stale & (1U << i)) {
+                logOwner[flashNum][i] = LOGFREE;
+            }
+        }
+        wakeWriters(flashNum);
+    } else {
+        logChanged[flashNum] = TRUE;
+    }
+    SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+
+    SYSCALL(VERHOGEN, (int)&logCkptMutex[flashNum], 0, 0);
+}
+
+/* ========================================================================
+ * Function: allocSlot
+ *
+ * Description: Takes the free slot at or after the log head. The head
+ *              moves on one slot at a time, and from the end of a segment
+ *              to the next wholly free one if there is any. Called with
+ *              the log mutex held
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              The slot, NOBLOCK if every slot is in use
+ * ======================================================================== */
+int allocSlot(int flashNum) {
+    int tries;
+    for (tries = 0; tries < LOGSLOTS; tries++) {
+        int slot = logHead[flashNum];
+        int next = (slot + 1) % LOGSLOTS;
+        if ((next % LOGSEGBLOCKS) == 0) {
+            next = freeSegment(flashNum, next);
+        }
+        logHead[flashNum] = next;
+        if (logOwner[flashNum][slot] == LOGFREE) {
+            return slot;
+        }
+    }
+    return NOBLOCK;
+}
+
+/* ========================================================================
+ * Function: freeSegment
+ *
+ * Description: Finds the first wholly free segment at or after a slot's,
+ *              wrapping around. Called with the log mutex held
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *              from - Slot to start at (first of a segment)
+ *
+ * Returns:
+ *              First slot of the segment, or from if none is free
+ * ======================================================================== */
+int freeSegment(int flashNum, int from) {
+    int k;
+    for (k = 0; k < LOGSEGS; k++) {
+        int seg = ((from / LOGSEGBLOCKS) + k) % LOGSEGS;
+        int i = seg * LOGSEGBLOCKS;
+        while ((i < (seg + 1) * LOGSEGBLOCKS) && (logOwner[flashNum][i] == LOGFREE)) {
+            i++;
+        }
+        if (i == (seg + 1) * LOGSEGBLOCKS) {
+            return seg * LOGSEGBLOCKS;
+        }
+    }
+    return from;
+}
+
+/* ========================================================================
+ * Function: cleanSegment
+ *
+ * Description: Moves each live block of a full segment to a slot at the
+ *              head, copying it through the device's DMA buffer under one
+ *              grant. A block written by a U-proc meanwhile keeps the
+ *              U-proc's copy. The segment's slots are then stale, to be
+ *              freed by the next checkpoint
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *              segment - Segment to clean (no free or writing slots)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void cleanSegment(int flashNum, int segment) {
+    memaddr buffer = FLASH_DMABUFFER_ADDR(flashNum);
+    diskRequest_t request;
+    int moved = 0;
+    int slot;
+
+    acquireDevice(FLASHINT, flashNum, &request, FLASHLOGBASE + (segment * LOGSEGBLOCKS), SYSTEMASID);
+    for (slot = segment * LOGSEGBLOCKS; slot < (segment + 1) * LOGSEGBLOCKS; slot++) {
+        SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+        int logical = logOwner[flashNum][slot];
+        int target = (logical >= 0) ? allocSlot(flashNum) : NOBLOCK;
+        if (target != NOBLOCK) {
+            logOwner[flashNum][target] = LOGWRITING;
+        }
+        SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+        if (target == NOBLOCK) {
+            continue;
+        }
+
+        int status = flashRW(READ, flashNum, FLASHLOGBASE + slot, buffer);
+        if (status == READY) {
+            status = flashRW(WRITE, flashNum, FLASHLOGBASE + target, buffer);
+        }
+        moved += 2;
+
+        SYSCALL(PASSEREN, (int)&logMutex[flashNum], 0, 0);
+        if ((status == READY) && (logMap[flashNum][logical] == slot)) {
+            logOwner[flashNum][slot] = LOGSTALE;
+            logMap[flashNum][logical] = target;
+            logOwner[flashNum][target] = logical;
+            logChanged[flashNum] = TRUE;
+        } else {
+            logOwner[flashNum][target] = LOGFREE;
+        }
+        wakeWriters(flashNum);
+        SYSCALL(VERHOGEN, (int)&logMutex[flashNum], 0, 0);
+    }
+    releaseDevice(FLASHINT, flashNum, MAX(moved, 1));
+}
+
+/* ========================================================================
+ * Function: wakeWriters
+ *
+ * Description: Wakes every writer waiting for a free slot of a log, to
+ *              look again. Called with the log mutex held whenever a slot
+ *              stops being written or becomes free
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void wakeWriters(int flashNum) {
+    while (logSpaceWaiters[flashNum] > 0) {
+        logSpaceWaiters[flashNum]--;
+        SYSCALL(VERHOGEN, (int)&logSpaceSem[flashNum], 0, 0);
+    }
+}
@@ -0,0 +1,231 @@
+/******************************* futex.c *************************************
+ *
+ * Module: Futexes
+ *
+ * Description:
+ * This module lets U-procs sharing memory build locks and condition
+ * variables out of plain words in that memory, taking a trap only when
+ * they have to wait. SYS46 blocks the caller only if the word at a1 still
+ * holds the value in a2; SYS47 wakes up to a2 U-procs waiting on the word
+ * at a1. An uncontended lock is taken and released in user mode alone.
+ *
+ * Implementation:
+ * Waiters sleep on a nucleus semaphore in a small hashed wait table, so
+ * the ASL queues them; an entry is free while its semaphore is 0. A word
+ * is keyed by its virtual address in a key space that is the U-proc's
+ * ASID for a private page, or FUTEXSHARED plus the segment number for a
+ * shared segment page (mapped at the same address by every attacher).
+ * The key therefore survives the page being evicted and reloaded into
+ * another frame while someone waits on it, and the page is not held
+ * resident across the sleep.
+ *
+ * The word is read through the caller's page table and frame with
+ * interrupts off (readResidentWord), which keeps the frame in place for
+ * the compare just as pinning it would; when the page is not resident it
+ * is touched to fault it in and the compare retried. The compare and the
+ * P happen with interrupts off, and SYS47 counts the waiters with them
+ * off too, so a wake between a waiter's compare and its sleep can not be
+ * lost: the P is done before anything else of the Support Level runs.
+ *
+ * Policy Decisions:
+ * - Return Values: SYS46 returns SUCCESS once woken, or ERROR at once if
+ *   the word did not hold the value (or its page could not be faulted
+ *   in, or the table is full); a woken waiter must check the word again.
+ *   SYS47 returns the number of U-procs woken
+ * - Alignment: A word address not word aligned, or a negative wake count,
+ *   terminates the U-proc
+ * - Table Size: FUTEXSLOTS entries, twice MAXUPROC, so every U-proc can
+ *   wait on a different word at once
+ *
+ * Functions:
+ * - initFutexes: Frees every wait table entry
+ * - futexWaitSyscallHandler: Implements SYS46 (FUTEXWAIT)
+ * - futexWakeSyscallHandler: Implements SYS47 (FUTEXWAKE)
+ * - futexSpace: Returns the key space of a user word
+ * - futexSlot: Finds (or claims) the wait table entry of a key
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/futex.h"
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN futex_t futexTable[FUTEXSLOTS];          /* Words someone waits on */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN int futexSpace(support_PTR supportStruct, memaddr vAddress);
+HIDDEN futex_PTR futexSlot(int space, memaddr vAddress, int claim);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initFutexes
+ *
+ * Description: Frees every entry of the futex wait table
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initFutexes() {
+    int slot;
+    for (slot = 0; slot < FUTEXSLOTS; slot++) {
+        futexTable[slot].fx_space = NOSEGMENT;
+        futexTable[slot].fx_addr = 0;
+        futexTable[slot].fx_sem = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: futexWaitSyscallHandler
+ *
+ * Description: Implements SYS46: blocks until a SYS47 on the word at a1
+ *              (validated by the dispatch table) if it still holds a2
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *                              (a1: word address, a2: expected value)
+ *
+ * Returns:
+ *              SUCCESS once woken, ERROR if the word did not hold a2 or
+ *              the caller could not wait
+ * ======================================================================== */
+int futexWaitSyscallHandler(support_PTR supportStruct) {
+    state_PTR exceptState = &supportStruct->sup_exceptState[GENERALEXCEPT];
+    memaddr vAddress = exceptState->s_a1;
+    int expected = exceptState->s_a2;
+
+    if (vAddress & (WORDLEN - 1)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    int space = futexSpace(supportStruct, vAddress);
+
+    int tries;
+    for (tries = 0; tries < FUTEXRETRIES; tries++) {
+        setInterrupts(OFF);
+        int word;
+        if (readResidentWord(supportStruct, vAddress, &word)) {
+            futex_PTR slot = NULL;
+            if (word == expected) {
+                slot = futexSlot(space, vAddress, TRUE);
+            }
+            if (slot != NULL) {
+                /* Sleep before any waker can look at the entry */
+                SYSCALL(PASSEREN, (int)&slot->fx_sem, 0, 0);
+            }
+            setInterrupts(ON);
+            return (slot != NULL) ? SUCCESS : ERROR;
+        }
+        setInterrupts(ON);
+
+        /* Not resident: fault the page in and compare again */
+        volatile int *touch = (int *)vAddress;
+        word = *touch;
+    }
+    return ERROR;
+}
+
+/* ========================================================================
+ * Function: futexWakeSyscallHandler
+ *
+ * Description: Implements SYS47: wakes up to a2 of the U-procs waiting on
+ *              the word at a1, longest waiting first
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *                              (a1: word address, a2: most to wake)
+ *
+ * Returns:
+ *              The number of U-procs woken
+ * ======================================================================== */
+int futexWakeSyscallHandler(support_PTR supportStruct) {
+    state_PTR exceptState = &supportStruct->sup_exceptState[GENERALEXCEPT];
+    memaddr vAddress = exceptState->s_a1;
+    int count = exceptState->s_a2;
+
+    if ((vAddress & (WORDLEN - 1)) || (count < 0)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    int space = futexSpace(supportStruct, vAddress);
+
+    int woken = 0;
+    setInterrupts(OFF);
+    futex_PTR slot = futexSlot(space, vAddress, FALSE);
+    while ((slot != NULL) && (woken < count) && (slot->fx_sem < 0)) {
+        SYSCALL(VERHOGEN, (int)&slot->fx_sem, 0, 0);
+        woken++;
+    }
+    setInterrupts(ON);
+    return woken;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: futexSpace
+ *
+ * Description: Returns the key space of a user word: shared segment
+ *              pages are keyed alike for every attached U-proc, private
+ *              ones by the ASID
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *              vAddress - User address of the word
+ *
+ * Returns:
+ *              FUTEXSHARED plus the segment number, or the ASID
+ * ======================================================================== */
+HIDDEN int futexSpace(support_PTR supportStruct, memaddr vAddress) {
+    int segment = sharedSegment(supportStruct->sup_asid, vAddress);
+    return (segment != NOSEGMENT) ? (FUTEXSHARED + segment) : supportStruct->sup_asid;
+}
+
+/* ========================================================================
+ * Function: futexSlot
+ *
+ * Description: Finds the wait table entry someone waits on for a key,
+ *              claiming a free one for it if asked. Entries are freed by
+ *              their last waiter leaving, not removed, so every entry is
+ *              looked at from the key's hash on. Called with interrupts off
+ *
+ * Parameters:
+ *              space - Key space (futexSpace)
+ *              vAddress - User address of the word
+ *              claim - TRUE to claim a free entry if none matches
+ *
+ * Returns:
+ *              The entry, or NULL if none matches (and none is free to claim)
+ * ======================================================================== */
+HIDDEN futex_PTR futexSlot(int space, memaddr vAddress, int claim) {
+    unsigned int slot = (((vAddress >> 2) + space) * ASLHASHMULT) >> (32 - FUTEXHASHBITS);
+    futex_PTR free = NULL;
+    int probes;
+    for (probes = 0; probes < FUTEXSLOTS; probes++) {
+        futex_PTR entry = &futexTable[slot];
+        if (entry->fx_sem < 0) {
+            if ((entry->fx_space == space) && (entry->fx_addr == vAddress)) {
+                return entry;
+            }
+        } else if (free == NULL) {
+            free = entry;
+        }
+        slot = (slot + 1) & (FUTEXSLOTS - 1);
+    }
+
+    if (claim && (free != NULL)) {
+        free->fx_space = space;
+        free->fx_addr = vAddress;
+    }
+    return claim ? free : NULL;
+}
@@ -0,0 +1,364 @@
+/******************************* inherit.c *************************************
+ *
+ * Module: Priority Inheritance
+ *
+ * Description:
+ * This module turns chosen semaphores (the swap pool mutex and the device
+ * mutexes) into priority-inheriting mutexes, so a U-proc holding one is
+ * not kept off the CPU by processes on higher MLFQ levels while the
+ * processes waiting for the mutex wait with it.
+ *
+ * Implementation:
+ * The Support Level makes a binary semaphore a mutex once with the
+ * nucleus-only MAKEMUTEX call; from then on SYS3 and SYS4 on it are
+ * mutex-flavored. Mutexes live in a static open-addressing table keyed by
+ * semaphore address (hashed like the ASL, linear probing) that records
+ * each one's owner. A P that takes the mutex makes the caller the owner;
+ * a P that blocks raises the owner (and, if the owner is itself blocked
+ * on a mutex, that owner, and so on) to the waiter's level, saving its
+ * own level in p_basePriority. A V hands the mutex to the process it
+ * wakes, raised to the best level still waiting, and puts the releaser
+ * back on its own level, or on the best level still waiting on another
+ * mutex it holds. A raised process that is ready is moved to its new
+ * level's queue at once. Levels are only used by the MLFQ class, so under
+ * stride scheduling only the owners are tracked.
+ *
+ * Functions:
+ * - initMutexes: Empties the mutex owner table.
+ * - makeMutex: Makes a semaphore a priority-inheriting mutex.
+ * - mutexAcquired: Records a P on a mutex, boosting its owner if it blocked.
+ * - mutexReleased: Hands a mutex to the process a V woke.
+ * - mutexOwnerGone: Forgets a terminated process's mutexes.
+ * - ownsContendedMutex: Checks if anyone waits on a mutex a process holds.
+ * - mutexSlot: Finds the entry of a mutex.
+ * - boostOwners: Raises the owners along a chain of blocked mutexes.
+ * - restoreLevel: Puts a releaser back on the level it is owed.
+ * - bestWaiter: Returns the highest level waiting on a mutex.
+ * - setLevel: Changes a process's level, requeueing it if ready.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/inherit.h"
+#include "../h/scheduler.h"
+
+/******************** Module Variables ********************/
+HIDDEN mutex_t mutexes[MUTEXSLOTS];        /* Owner of each mutex (m_semAdd NULL for a free slot) */
+
+/******************** Function Prototypes ********************/
+HIDDEN mutex_PTR mutexSlot(int *semAdd);
+HIDDEN void boostOwners(mutex_PTR mutex, int level);
+HIDDEN void restoreLevel(pcb_PTR p);
+HIDDEN int bestWaiter(int *semAdd);
+HIDDEN void setLevel(pcb_PTR p, int level);
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initMutexes
+ *
+ * Description: Empties the mutex owner table.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initMutexes() {
+    int slot;
+    for (slot = 0; slot < MUTEXSLOTS; slot++) {
+        mutexes[slot].m_semAdd = NULL;
+        mutexes[slot].m_owner = NULL;
+    }
+}
+
+/* ========================================================================
+ * Function: makeMutex
+ *
+ * Description: Makes a semaphore a priority-inheriting mutex (MAKEMUTEX).
+ *              It must be free (value 1) and stays a mutex for good.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *
+ * Returns:
+ *              0 on success, -1 if the semaphore is not free or the table
+ *              is full
+ * ======================================================================== */
+int makeMutex(int *semAdd) {
+    if (*semAdd != 1) {
+        return -1;
+    }
+
+    unsigned int slot = (((unsigned int)semAdd >> 2) * ASLHASHMULT) >> (32 - MUTEXHASHBITS);
+    int probes;
+    for (probes = 0; probes < MUTEXSLOTS; probes++) {
+        if ((mutexes[slot].m_semAdd == semAdd) || (mutexes[slot].m_semAdd == NULL)) {
+            mutexes[slot].m_semAdd = semAdd;
+            mutexes[slot].m_owner = NULL;
+            return 0;
+        }
+        slot = (slot + 1) & (MUTEXSLOTS - 1);
+    }
+    return -1;
+}
+
+/* ========================================================================
+ * Function: mutexAcquired
+ *
+ * Description: Records a P on a semaphore, if it is a mutex. A P that got
+ *              the mutex makes the process its owner; one that is about to
+ *              block raises the owners in its way to its level.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address (already decremented)
+ *              p - Process doing the P
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void mutexAcquired(int *semAdd, pcb_PTR p) {
+    if (!PRIORITYINHERIT) {
+        return;
+    }
+    mutex_PTR mutex = mutexSlot(semAdd);
+    if (mutex == NULL) {
+        return;
+    }
+
+    if (*semAdd >= 0) {
+        mutex->m_owner = p;
+    } else if (SCHEDCLASS == MLFQCLASS) {
+        boostOwners(mutex, p->priority);
+    }
+}
+
+/* ========================================================================
+ * Function: mutexReleased
+ *
+ * Description: Records a V on a semaphore, if it is a mutex. The releaser
+ *              goes back to the level it is owed and the woken process, if
+ *              any, becomes the owner, raised to the best level still
+ *              waiting.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address (already incremented)
+ *              woken - Process the V woke, or NULL
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void mutexReleased(int *semAdd, pcb_PTR woken) {
+    if (!PRIORITYINHERIT) {
+        return;
+    }
+    mutex_PTR mutex = mutexSlot(semAdd);
+    if (mutex == NULL) {
+        return;
+    }
+
+    pcb_PTR releaser = mutex->m_owner;
+    mutex->m_owner = (woken != mkEmptyProcQ()) ? woken : NULL;
+    if (SCHEDCLASS != MLFQCLASS) {
+        return;
+    }
+    if (releaser != NULL) {
+        restoreLevel(releaser);
+    }
+    if ((woken != mkEmptyProcQ()) && (*semAdd < 0)) {
+        boostOwners(mutex, bestWaiter(semAdd));
+    }
+}
+
+/* ========================================================================
+ * Function: mutexOwnerGone
+ *
+ * Description: Forgets a terminated process as the owner of any mutex.
+ *              Its holder's cleanup (terminateUProcess) still does the V.
+ *
+ * Parameters:
+ *              p - Process being freed
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void mutexOwnerGone(pcb_PTR p) {
+    if (!PRIORITYINHERIT) {
+        return;
+    }
+    int slot;
+    for (slot = 0; slot < MUTEXSLOTS; slot++) {
+        if (mutexes[slot].m_owner == p) {
+            mutexes[slot].m_owner = NULL;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: ownsContendedMutex
+ *
+ * Description: Tells whether a process holds a mutex that other processes
+ *              are blocked on (its semaphore is negative).
+ *
+ * Parameters:
+ *              p - Pointer to the process
+ *
+ * Returns:
+ *              TRUE if it holds a contended mutex, else FALSE
+ * ======================================================================== */
+int ownsContendedMutex(pcb_PTR p) {
+    if (!PRIORITYINHERIT) {
+        return FALSE;
+    }
+    int slot;
+    for (slot = 0; slot < MUTEXSLOTS; slot++) {
+        if ((mutexes[slot].m_owner == p) && (*mutexes[slot].m_semAdd < 0)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* ========================================================================
+ * Function: mutexSlot
+ *
+ * Description: Finds the entry of a mutex.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *
+ * Returns:
+ *              Its entry, or NULL if the semaphore is not a mutex
+ * ======================================================================== */
+HIDDEN mutex_PTR mutexSlot(int *semAdd) {
+    unsigned int slot = (((unsigned int)semAdd >> 2) * ASLHASHMULT) >> (32 - MUTEXHASHBITS);
+    int probes;
+    for (probes = 0; probes < MUTEXSLOTS; probes++) {
+        mutex_PTR mutex = &mutexes[slot];
+        if (mutex->m_semAdd == semAdd) {
+            return mutex;
+        }
+        if (mutex->m_semAdd == NULL) {
+            return NULL;
+        }
+        slot = (slot + 1) & (MUTEXSLOTS - 1);
+    }
+    return NULL;
+}
+
+/* ========================================================================
+ * Function: boostOwners
+ *
+ * Description: Raises a mutex's owner to a level, then the owner of the
+ *              mutex that owner is blocked on, and so on. The chain ends at
+ *              a process already at that level or better, or not blocked
+ *              on a mutex; it visits at most MAXPROC owners.
+ *
+ * Parameters:
+ *              mutex - Mutex a process waits for
+ *              level - Level of the waiter
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void boostOwners(mutex_PTR mutex, int level) {
+    int hops;
+    for (hops = 0; (hops < MAXPROC) && (mutex != NULL) && (mutex->m_owner != NULL); hops++) {
+        pcb_PTR owner = mutex->m_owner;
+        if (owner->priority <= level) {
+            return;
+        }
+        if (owner->p_basePriority == NOBOOST) {
+            owner->p_basePriority = owner->priority;
+        }
+        setLevel(owner, level);
+        mutex = (owner->p_semAdd != NULL) ? mutexSlot(owner->p_semAdd) : NULL;
+    }
+}
+
+/* ========================================================================
+ * Function: restoreLevel
+ *
+ * Description: Puts a process that released a mutex back on its own level,
+ *              or on the best level still waiting on a mutex it holds.
+ *
+ * Parameters:
+ *              p - Process that released a mutex
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void restoreLevel(pcb_PTR p) {
+    if (p->p_basePriority == NOBOOST) {
+        return;
+    }
+
+    int level = p->p_basePriority;
+    int slot;
+    for (slot = 0; slot < MUTEXSLOTS; slot++) {
+        if ((mutexes[slot].m_owner == p) && (*mutexes[slot].m_semAdd < 0)) {
+            level = MIN(level, bestWaiter(mutexes[slot].m_semAdd));
+        }
+    }
+
+    if (level == p->p_basePriority) {
+        p->p_basePriority = NOBOOST;
+    }
+    setLevel(p, level);
+}
+
+/* ========================================================================
+ * Function: bestWaiter
+ *
+ * Description: Returns the highest (lowest numbered) level of the
+ *              processes blocked on a semaphore.
+ *
+ * Parameters:
+ *              semAdd - Semaphore address
+ *
+ * Returns:
+ *              That level, LOWESTLEVEL if none is blocked
+ * ======================================================================== */
+HIDDEN int bestWaiter(int *semAdd) {
+    int level = LOWESTLEVEL;
+    pcb_PTR head = headBlocked(semAdd);
+    if (head == NULL) {
+        return level;
+    }
+
+    pcb_PTR p = head;
+    do {
+        level = MIN(level, p->priority);
+        p = p->p_next;
+    } while (p != head);
+    return level;
+}
+
+/* ========================================================================
+ * Function: setLevel
+ *
+ * Description: Changes a process's MLFQ level, moving it to the new level's
+ *              ready queue if it is ready.
+ *
+ * Parameters:
+ *              p - Process
+ *              level - New level
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void setLevel(pcb_PTR p, int level) {
+    if (p->priority == level) {
+        return;
+    }
+    if (p->p_readyLevel != NOTREADY) {
+        getProcess(p);
+        p->priority = level;
+        insertReadyQueue(p);
+    } else {
+        p->priority = level;
+    }
+}
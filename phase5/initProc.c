@@ -7,6 +7,13 @@
  * the Support Level environment, creating and launching user processes, and 
  * serving as the parent for all user processes in the system.
  * 
+ * How many U-procs run, and where each one's image and backing store
+ * live, is read at boot from a configuration block (sector CONFIGSECTOR
+ * of disk CONFIGDISK): a CONFIGMAGIC word, the U-proc count (at most
+ * MAXUPROC) and a flash device, first block and length per ASID, so
+ * several ASIDs can page from one device. Without a valid block all
+ * MAXUPROC U-procs run, ASID n from the whole of flash n - 1.
+ * 
  * For each user process:
  * 1. A support structure is allocated with a unique ASID (Address Space ID)
  * 2. Page tables are initialized with all entries initially invalid
@@ -14,13 +21,42 @@
  * 4. Dedicated stack space is allocated in the kernel area for handling exceptions
  * 5. The process is created with appropriate privileges (user mode)
  *
+ * With BOOTFASTSTART, every U-proc is created before any of their text
+ * pages are fingerprinted for sharing (a flash read per text page), so
+ * the first U-proc starts as soon as the configuration is read; test()
+ * fingerprints them afterwards. test() stamps the end of each Support
+ * Level boot phase (markBootPhase) and, with BOOTREPORT set, prints every
+ * phase reached on printer PERFPRINTER once the U-procs are running.
+ *
  * Process synchronization is handled through a master semaphore that tracks 
  * process termination. The test waits for all child processes to terminate before
- * terminating.
+ * terminating. A U-proc can also restart itself from its image with SYS43,
+ * keeping its ASID and resident text frames, or clone itself with SYS48
+ * (FORK) into a free ASID: the clone shares the parent's resident pages
+ * copy-on-write and returns 0 where the parent gets the clone's ASID. The
+ * test also waits for every clone. A U-proc may also run threads in its
+ * address space (SYS49-51, thread.c). A configured U-proc that saved itself
+ * with SYS61 (checkpoint.c) and has not exited since is created resuming
+ * that checkpoint instead of at the start of its image. With PERFSUMMARY set it then prints the nucleus-wide and
+ * per-ASID performance counters on printer PERFPRINTER, one line per
+ * block followed by every non-zero SYSCALL, line and device count, the
+ * contention statistics of every semaphore a P ever blocked on, and the
+ * exit record of every U-proc.
  *
  * Functions:
  * - test: Entry point for the Support Level initialization and U-proc creation
+ * - readUProcConfig: Reads the U-proc count and backing regions at boot
+ * - validImage: Checks one configured backing region
  * - createUProcess: Creates a U-process using a predefined support structure
+ * - respawnSyscallHandler: Implements SYS43 (RESPAWN)
+ * - forkSyscallHandler: Implements SYS48 (FORK)
+ * - initExceptContexts: Points a U-proc's or thread's exception contexts at its handlers
+ * - initialUProcState: Builds the state a U-proc starts its image in
+ * - printPerfSummary: Prints the performance counters at shutdown
+ * - printBootReport: Prints the boot phase times
+ * - printCount: Prints one labelled counter line
+ * - appendText: Appends a string to a line being built
+ * - appendNumber: Appends a decimal number to a line being built
  * 
  * Written by Aryah Rao and Anish Reddy
  *
@@ -37,10 +73,64 @@ extern void genExceptionHandler();
 extern void initSupportStructFreeList();
 extern support_PTR allocateSupportStruct();
 extern void initSwapPool();
+extern void registerText(support_PTR supportStruct);
+extern void fingerprintText(support_PTR supportStruct);
+extern void setBackingStore(int asid, int flashNum, int base, int blocks);
+extern void stripeBackingStores();
 extern void pager();
 extern void uTLB_RefillHandler();
+extern void resetAddressSpace(support_PTR supportStruct);
+extern int cloneAddressSpace(support_PTR parent, support_PTR child);
+extern void discardClone(support_PTR supportStruct);
+extern void resumeState(state_t *state);
 /* deldayDaemon.c */
 extern void initADL();
+/* deviceSupportDMA.c */
+extern void initDiskQueues();
+extern int diskTransfer(int operation, int diskNum, int linearSector, memaddr bufferAddr, int asid);
+extern void resetIOShare(int asid, int parent);
+/* blockCache.c */
+extern void initBlockCache();
+extern void flushBlockCache();
+/* asyncIO.c */
+extern void initAsyncIO();
+/* diskVolume.c */
+extern void initDiskVolume();
+/* flashLog.c */
+extern void initFlashLogs();
+extern void syncFlashLogs();
+/* traceSink.c */
+extern void initTraceSink();
+extern void syncTraceSink();
+/* checkpoint.c */
+extern void initCheckpoints(uprocConfig_PTR config);
+extern void resumeFromCheckpoint(state_PTR state, int asid);
+/* terminalDaemon.c */
+extern void initTerminals();
+extern void drainTerminals();
+/* printerSpooler.c */
+extern void initPrinters();
+extern void drainPrinters();
+extern int spoolPrinterOutput(int printNum, char *charAddress, int length);
+/* userSemaphore.c */
+extern void initUserSemaphores();
+/* mailbox.c */
+extern void initMailboxes();
+extern void openMailbox(int asid);
+/* reaper.c */
+extern void initReaper();
+extern int readExit(int asid, exitRecord_PTR buffer);
+/* futex.c */
+extern void initFutexes();
+/* thread.c */
+extern void initThreads();
+extern int liveThreads(int asid);
+/* waitAny.c */
+extern void initWaiters();
+/* network.c */
+extern void initNetwork();
+/* slab.c */
+extern int kmemCacheStats(int sizeClass, kmemStat_PTR stats);
 
 /*----------------------------------------------------------------------------*/
 /* Global variables */
@@ -48,10 +138,35 @@ extern void initADL();
 int masterSema4;                             /* Master semaphore for synchronization */
 int deviceMutex[DEVICE_COUNT];               /* Semaphores for device mutual exclusion */
 
+/* Stride scheduling tickets of each U-proc, indexed by ASID - 1 */
+HIDDEN const int uprocTickets[MAXUPROC] = {
+    DEFAULTTICKETS, DEFAULTTICKETS, DEFAULTTICKETS, DEFAULTTICKETS,
+    DEFAULTTICKETS, DEFAULTTICKETS, DEFAULTTICKETS, DEFAULTTICKETS
+};
+
+/* Resource group of each U-proc, indexed by ASID - 1 */
+HIDDEN const int uprocGroup[MAXUPROC] = {
+    RGDEFAULT, RGDEFAULT, RGDEFAULT, RGDEFAULT,
+    RGDEFAULT, RGDEFAULT, RGDEFAULT, RGDEFAULT
+};
+
+HIDDEN uprocConfig_t uprocConfig;            /* U-proc count and backing regions read at boot */
+HIDDEN int forkedUProcs;                     /* Clones created by SYS48, waited for too */
+HIDDEN int forkMutex;                        /* Semaphore for forkedUProcs */
+HIDDEN support_PTR uprocSupport[MAXUPROC + 1]; /* Support structure each configured U-proc was created with */
+
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
 /*----------------------------------------------------------------------------*/
+HIDDEN void readUProcConfig();
+HIDDEN int validImage(uprocConfig_PTR config, int asid);
 HIDDEN int createUProcess(int processID);
+HIDDEN void initialUProcState(state_PTR state, int processID);
+HIDDEN void printPerfSummary();
+HIDDEN void printBootReport();
+HIDDEN void printCount(char *label, int index, unsigned int value);
+HIDDEN int appendText(char *line, int length, char *text);
+HIDDEN int appendNumber(char *line, int length, unsigned int value);
 
 /*----------------------------------------------------------------------------*/
 /* Global Function Implementations */
@@ -70,33 +185,169 @@ HIDDEN int createUProcess(int processID);
  *              None
  * ======================================================================== */
 void test() {
+    markBootPhase(BOOTTEST);
     int i; /* Initialize device semaphores */
     for (i = 0; i < DEVICE_COUNT; i++) {
         deviceMutex[i] = 1;
+        SYSCALL(MAKEMUTEX, (int)&deviceMutex[i], 0, 0); /* Holders inherit their waiters' level */
+    }
+    for (i = 0; i < DEVDESCCOUNT; i++) {
+        deviceTable[i].dd_mutex = &deviceMutex[i]; /* Drivers find their mutex through the device table */
     }
     initADL(); /* Initialize the Active Delay List */
+    initDiskQueues(); /* Initialize the per-disk request queues */
+    initBlockCache(); /* Initialize the block cache for SYS14-17 */
+    initAsyncIO(); /* Initialize the asynchronous I/O workers */
+    initDiskVolume(); /* Stripe the user disks into one volume */
+    initTerminals(); /* Initialize the terminal output rings and writers */
+    initPrinters(); /* Initialize the printer spools and their daemons */
+    initUserSemaphores(); /* Zero the named semaphores */
+    initMailboxes(); /* Empty the U-proc mailboxes */
+    initReaper(); /* No exits recorded yet */
+    initFutexes(); /* No one waits on a user word */
+    initThreads(); /* Free every thread slot */
+    initWaiters(); /* No one waits in SYS53 */
+    markBootPhase(BOOTDRIVERS);
     initSupportStructFreeList(); /* Initialize the free list of support structures */
     initSwapPool(); /* Initialize the Swap Pool data structure */
+    initNetwork(); /* Launch the NIC daemons (they post receive frames from the swap pool) */
+    markBootPhase(BOOTSWAPPOOL);
     masterSema4 = 0; /* Initialize the master semaphore for synchronization */
+    forkedUProcs = 0;
+    forkMutex = 1;
+    readUProcConfig(); /* How many U-procs, paging from where */
 
-    /* Create user processes */
+    /* Page each configured ASID from its region; set them all first, so no clone takes one */
     int asid;
-    for (asid = 1; asid <= MAXUPROC; asid++) {
+    for (asid = 1; asid <= uprocConfig.uc_count; asid++) {
+        uprocImage_PTR image = &uprocConfig.uc_image[asid - 1];
+        setBackingStore(asid, image->ui_flash, image->ui_base, image->ui_blocks);
+    }
+    stripeBackingStores(); /* Spread their write-backs over the configured devices */
+    initTraceSink(); /* Stream the binary trace to a flash device no region uses */
+    initFlashLogs(); /* Recover the flash logs clear of every region and the trace */
+    initCheckpoints(&uprocConfig); /* Find the U-procs to resume from their checkpoints */
+    markBootPhase(BOOTCONFIG);
+
+    /* Create user processes */
+    for (asid = 1; asid <= uprocConfig.uc_count; asid++) {
         if (createUProcess(asid) != SUCCESS) { /* Failed to create U-proc */
             SYSCALL(TERMINATEPROCESS, 0, 0, 0); /* Nuke it! */
         }
+        markBootPhase(BOOTFIRSTUPROC);
     }
+    markBootPhase(BOOTUPROCS);
 
-    /* After all U-procs have been created, wait on the master semaphore for each user process */
-    for (asid = 1; asid <= MAXUPROC; asid++) {
+    /* Off the critical path: fingerprint the running U-procs' text, so later faults share it */
+    for (asid = 1; BOOTFASTSTART && (asid <= uprocConfig.uc_count); asid++) {
+        fingerprintText(uprocSupport[asid]);
+    }
+    markBootPhase(BOOTTEXTPRINTS);
+    if (BOOTREPORT && PRINTSPOOLED) {
+        printBootReport();
+    }
+
+    /* After all U-procs have been created, wait on the master semaphore for
+     * each user process and each clone (a clone is counted before its parent exits) */
+    for (i = 0; i < uprocConfig.uc_count + forkedUProcs; i++) {
         SYSCALL(PASSEREN, (int)&masterSema4, 0, 0); 
     }
+    /* Write back the block cache and finish terminal output before the daemons go down with us */
+    flushBlockCache();
+    syncFlashLogs();
+    syncTraceSink();
+    drainTerminals();
+    if (PERFSUMMARY && PERFSTATS && PRINTSPOOLED) {
+        printPerfSummary();
+    }
+    drainPrinters();
+
     /* All children have terminated, now terminate the test process */
     SYSCALL(TERMINATEPROCESS, 0, 0, 0);
     PANIC(); /* Should never get here */
 }
 
 
+/* ========================================================================
+ * Function: readUProcConfig
+ *
+ * Description: Reads the boot configuration block from disk CONFIGDISK
+ *              (through ASID 1's disk DMA buffer, unused until U-procs
+ *              run) into uprocConfig. A missing disk, a read error, a
+ *              wrong magic word, a count outside 1..MAXUPROC or an invalid
+ *              or overlapping region selects the default: MAXUPROC
+ *              U-procs, ASID n on all of flash n - 1.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void readUProcConfig() {
+    uprocConfig_PTR block = (uprocConfig_PTR)DISK_DMABUFFER_ADDR(0);
+    int valid = (DEVDESC(DISKINT, CONFIGDISK)->dd_reg->d_status != NOTINSTALLED) &&
+                (diskTransfer(READBLK, CONFIGDISK, CONFIGSECTOR, (memaddr)block, SYSTEMASID) == READY) &&
+                (block->uc_magic == CONFIGMAGIC) && (block->uc_count >= 1) && (block->uc_count <= MAXUPROC);
+
+    int i;
+    for (i = 0; valid && (i < block->uc_count); i++) {
+        valid = validImage(block, i + 1);
+    }
+
+    uprocConfig.uc_magic = CONFIGMAGIC;
+    uprocConfig.uc_count = valid ? block->uc_count : MAXUPROC;
+    for (i = 0; i < uprocConfig.uc_count; i++) {
+        uprocImage_PTR image = &uprocConfig.uc_image[i];
+        image->ui_flash = valid ? block->uc_image[i].ui_flash : i;
+        image->ui_base = valid ? block->uc_image[i].ui_base : 0;
+        image->ui_blocks = valid ? block->uc_image[i].ui_blocks : TODEVEND;
+        if (image->ui_blocks == TODEVEND) {
+            image->ui_blocks = DEVDESC(FLASHINT, image->ui_flash)->dd_reg->d_data1 - image->ui_base;
+        }
+    }
+}
+
+
+/* ========================================================================
+ * Function: validImage
+ *
+ * Description: Checks one configured backing region: an installed flash
+ *              device, at least REGIONMIN blocks inside it, and no overlap
+ *              with the regions of lower ASIDs on the same device
+ * 
+ * Parameters:
+ *              config - Configuration block read from disk
+ *              asid - ASID whose region to check (the lower ones are already checked)
+ * 
+ * Returns:
+ *              TRUE if the region is usable, else FALSE
+ * ======================================================================== */
+int validImage(uprocConfig_PTR config, int asid) {
+    uprocImage_PTR image = &config->uc_image[asid - 1];
+    if ((image->ui_flash < 0) || (image->ui_flash >= DEV_PER_LINE) || (image->ui_base < 0) ||
+        (DEVDESC(FLASHINT, image->ui_flash)->dd_reg->d_status == NOTINSTALLED)) {
+        return FALSE;
+    }
+    int deviceBlocks = DEVDESC(FLASHINT, image->ui_flash)->dd_reg->d_data1;
+    int blocks = (image->ui_blocks == TODEVEND) ? (deviceBlocks - image->ui_base) : image->ui_blocks;
+    if ((blocks < REGIONMIN) || (image->ui_base > deviceBlocks - blocks)) {
+        return FALSE;
+    }
+
+    uprocImage_PTR lower = config->uc_image;
+    int i;
+    for (i = 0; i < asid - 1; i++) {
+        int lowerBlocks = (lower[i].ui_blocks == TODEVEND) ? (deviceBlocks - lower[i].ui_base) : lower[i].ui_blocks;
+        if ((lower[i].ui_flash == image->ui_flash) && (image->ui_base < lower[i].ui_base + lowerBlocks) &&
+            (lower[i].ui_base < image->ui_base + blocks)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
 /* ========================================================================
  * Function: createUProcess
  *
@@ -128,24 +379,425 @@ int createUProcess(int processID) {
     /* Update stack page */
     newSupport->sup_pageTable[MAXPAGES-1].pte_entryHI = ALLOFF | (UPAGESTACK + (processID << ASIDSHIFT));
 
-    /* For PGFAULTEXCEPT */
-    newSupport->sup_exceptContext[PGFAULTEXCEPT].c_pc = (memaddr)pager;
-    newSupport->sup_exceptContext[PGFAULTEXCEPT].c_status = ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
-    newSupport->sup_exceptContext[PGFAULTEXCEPT].c_stackPtr = (memaddr) (UPROC_TLB_STACK(processID));
-
-    /* For GENERALEXCEPT */
-    newSupport->sup_exceptContext[GENERALEXCEPT].c_pc = (memaddr)genExceptionHandler;
-    newSupport->sup_exceptContext[GENERALEXCEPT].c_status = ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
-    newSupport->sup_exceptContext[GENERALEXCEPT].c_stackPtr = (memaddr) (UPROC_GEN_STACK(processID));
+    /* Fingerprint its text pages (in its configured region) so U-procs running the same image share them;
+     * with BOOTFASTSTART test() does it once every U-proc is running */
+    registerText(newSupport);
+    if (!BOOTFASTSTART) {
+        fingerprintText(newSupport);
+    }
+    uprocSupport[processID] = newSupport;
+    joinGroup(processID, uprocGroup[processID - 1]);
+    resetIOShare(processID, UNOCCUPIED);
+    initExceptContexts(newSupport, UPROC_TLB_STACK(processID), UPROC_GEN_STACK(processID));
     
     /* Initial processor state */
     state_t initialState;
-    initialState.s_pc = UTEXTSTART;
-    initialState.s_t9 = UTEXTSTART;
-    initialState.s_sp = USTACKPAGE;
-    initialState.s_entryHI = processID << ASIDSHIFT;
-    initialState.s_status = ALLOFF | STATUS_KUp | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+    initialUProcState(&initialState, processID);
+    resumeFromCheckpoint(&initialState, processID); /* Or restore its last SYS61 */
 
     /* Create user process */
-    return SYSCALL(CREATEPROCESS, (int)&initialState, (int)newSupport, 0);
+    return SYSCALL(CREATEPROCESS, (int)&initialState, (int)newSupport, groupTickets(processID, uprocTickets[processID - 1]));
+}
+
+
+/* ========================================================================
+ * Function: respawnSyscallHandler
+ *
+ * Description: Implements SYS43: restarts the calling U-proc at the start
+ *              of its image. Its data, BSS and stack pages start over while
+ *              its clean text frames stay resident, so a restart costs no
+ *              text reads; the ASID, support structure and mailbox are
+ *              kept. Needs IMAGESHADOW, which keeps the flash image intact.
+ *              Only the main thread restarts, with no other thread running
+ *              in the address space it resets.
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *
+ * Returns:
+ *              Does not return on success, ERROR without IMAGESHADOW, from
+ *              a thread or while the U-proc has threads running
+ * ======================================================================== */
+int respawnSyscallHandler(support_PTR supportStruct) {
+    if (!IMAGESHADOW || (supportStruct->sup_thread != NOTHREAD) || (liveThreads(supportStruct->sup_asid) > 0)) {
+        return ERROR;
+    }
+
+    resetAddressSpace(supportStruct);
+
+    state_t initialState;
+    initialUProcState(&initialState, supportStruct->sup_asid);
+    resumeState(&initialState);
+    return ERROR; /* Should never get here */
+}
+
+
+/* ========================================================================
+ * Function: forkSyscallHandler
+ *
+ * Description: Implements SYS48: clones the calling U-proc into a free
+ *              ASID (one never configured, or whose U-proc terminated).
+ *              The clone gets a copy-on-write copy of the address space
+ *              and segments, an open mailbox, the parent's tickets and I/O
+ *              weight, and resumes after the SYSCALL with 0 in v0 (called
+ *              from a thread, the clone is a copy of that thread alone, in
+ *              a copy of the address space it shares). Needs IMAGESHADOW,
+ *              which keeps the flash image the clone pages from intact.
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *
+ * Returns:
+ *              The clone's ASID, or ERROR without IMAGESHADOW or if no
+ *              ASID or support structure is free or the clone could not
+ *              be created
+ * ======================================================================== */
+int forkSyscallHandler(support_PTR supportStruct) {
+    if (!IMAGESHADOW) {
+        return ERROR;
+    }
+    support_PTR child = allocateSupportStruct();
+    if (child == NULL) {
+        return ERROR;
+    }
+    int asid = cloneAddressSpace(supportStruct->sup_space, child);
+    if (asid == ERROR) {
+        return ERROR;
+    }
+    openMailbox(asid);
+    joinGroup(asid, groupOf(supportStruct->sup_asid));
+    resetIOShare(asid, supportStruct->sup_asid);
+    initExceptContexts(child, UPROC_TLB_STACK(asid), UPROC_GEN_STACK(asid));
+
+    /* The clone resumes where the parent does, under its own ASID */
+    state_t childState;
+    copyWords((unsigned int *)&childState, (unsigned int *)&supportStruct->sup_exceptState[GENERALEXCEPT],
+              sizeof(state_t) / WORDLEN);
+    childState.s_v0 = 0;
+    childState.s_entryHI = (childState.s_entryHI & ~ASIDMASK) | (asid << ASIDSHIFT);
+
+    /* Count it before it can exit, so test waits for it */
+    SYSCALL(PASSEREN, (int)&forkMutex, 0, 0);
+    forkedUProcs++;
+    SYSCALL(VERHOGEN, (int)&forkMutex, 0, 0);
+    if (SYSCALL(CREATEPROCESS, (int)&childState, (int)child,
+                groupTickets(asid, uprocTickets[supportStruct->sup_asid - 1])) != SUCCESS) {
+        SYSCALL(PASSEREN, (int)&forkMutex, 0, 0);
+        forkedUProcs--;
+        SYSCALL(VERHOGEN, (int)&forkMutex, 0, 0);
+        discardClone(child);
+        return ERROR;
+    }
+    return asid;
+}
+
+
+/* ========================================================================
+ * Function: initExceptContexts
+ *
+ * Description: Points a U-proc's (or a thread's) exception contexts at
+ *              the pager and the general exception handler, on its kernel
+ *              stacks
+ * 
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc or thread
+ *              tlbStack - Top of its page fault stack
+ *              genStack - Top of its general exception stack
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initExceptContexts(support_PTR supportStruct, memaddr tlbStack, memaddr genStack) {
+    /* For PGFAULTEXCEPT */
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_pc = (memaddr)pager;
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_status = ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_stackPtr = tlbStack;
+
+    /* For GENERALEXCEPT */
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_pc = (memaddr)genExceptionHandler;
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_status = ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_stackPtr = genStack;
+}
+
+
+/* ========================================================================
+ * Function: initialUProcState
+ *
+ * Description: Builds the processor state a U-proc starts in: user mode
+ *              with interrupts and the PLT on, at the start of its text
+ *              with the stack at the top of its address space
+ * 
+ * Parameters:
+ *              state - State to fill in
+ *              processID - ASID of the U-proc
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initialUProcState(state_PTR state, int processID) {
+    state->s_pc = UTEXTSTART;
+    state->s_t9 = UTEXTSTART;
+    state->s_sp = USTACKPAGE;
+    state->s_entryHI = processID << ASIDSHIFT;
+    state->s_status = ALLOFF | STATUS_KUp | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+}
+
+
+/* ========================================================================
+ * Function: printPerfSummary
+ *
+ * Description: Spools the performance counters on printer PERFPRINTER:
+ *              the main counters of the nucleus-wide block and of each
+ *              ASID, one line each, then the non-zero nucleus-wide
+ *              SYSCALL, interrupt line and device counts, then (with
+ *              CPUCOUNT > 1) each processor's interrupts per line, then
+ *              the contended semaphores (by decimal address), then the
+ *              kernel object caches in use, then the exit record of each
+ *              U-proc
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void printPerfSummary() {
+    char line[PERFLINELEN];
+    perfBlock_t block;
+    int asid;
+    for (asid = 0; asid < PERFBLOCKS; asid++) {
+        readPerf(asid, &block);
+        int length = appendText(line, 0, "perf asid ");
+        length = appendNumber(line, length, asid);
+        length = appendText(line, length, ": cs ");
+        length = appendNumber(line, length, block.pb_count[PERF_CSWITCH]);
+        length = appendText(line, length, " pre ");
+        length = appendNumber(line, length, block.pb_count[PERF_PREEMPT]);
+        length = appendText(line, length, " tlb ");
+        length = appendNumber(line, length, block.pb_count[PERF_TLBREFILL]);
+        length = appendText(line, length, " pf ");
+        length = appendNumber(line, length, block.pb_count[PERF_PAGEFAULT]);
+        length = appendText(line, length, " ev ");
+        length = appendNumber(line, length, block.pb_count[PERF_EVICTION]);
+        length = appendText(line, length, " wb ");
+        length = appendNumber(line, length, block.pb_count[PERF_WRITEBACK]);
+        length = appendText(line, length, " bp ");
+        length = appendNumber(line, length, block.pb_count[PERF_BLOCKEDP]);
+        length = appendText(line, length, " wv ");
+        length = appendNumber(line, length, block.pb_count[PERF_WAKINGV]);
+        length = appendText(line, length, "\n");
+        spoolPrinterOutput(PERFPRINTER, line, length);
+    }
+
+    /* The breakdowns of the nucleus-wide block */
+    readPerf(0, &block);
+    int i;
+    for (i = 0; i < PERFSYSCALLS; i++) {
+        printCount("perf sys ", MINSYSCALL + i, block.pb_count[PERF_SYSCALL + i]);
+    }
+    for (i = 0; i < PERFLINES; i++) {
+        printCount("perf line ", i, block.pb_count[PERF_LINE + i]);
+    }
+    for (i = 0; i < DEVICE_COUNT; i++) {
+        printCount("perf dev ", i, block.pb_count[PERF_DEVICE + i]);
+    }
+
+    /* Interrupts each processor took, per line, when there are several */
+    int cpu;
+    for (cpu = 0; (CPUCOUNT > 1) && (cpu < CPUCOUNT); cpu++) {
+        int length = appendText(line, 0, "perf cpu ");
+        length = appendNumber(line, length, cpu);
+        length = appendText(line, length, ":");
+        for (i = IPIINT; i <= TERMINT; i++) {
+            length = appendText(line, length, " ");
+            length = appendNumber(line, length, cpuInterruptCount(cpu, i));
+        }
+        length = appendText(line, length, "\n");
+        spoolPrinterOutput(PERFPRINTER, line, length);
+    }
+
+    /* Semaphores a P blocked on: acquisitions, blocked ones, total and longest wait */
+    lockStat_t chunk[LOCKCHUNK];
+    int first = 0;
+    int received;
+    do {
+        received = readLockStats(chunk, first, LOCKCHUNK);
+        first += received;
+        for (i = 0; i < received; i++) {
+            if (chunk[i].ls_contended == 0) {
+                continue;
+            }
+            int length = appendText(line, 0, "perf lock ");
+            length = appendNumber(line, length, (unsigned int)chunk[i].ls_semAdd);
+            length = appendText(line, length, ": acq ");
+            length = appendNumber(line, length, chunk[i].ls_acquires);
+            length = appendText(line, length, " cont ");
+            length = appendNumber(line, length, chunk[i].ls_contended);
+            length = appendText(line, length, " wait ");
+            length = appendNumber(line, length, chunk[i].ls_totalWait);
+            length = appendText(line, length, " max ");
+            length = appendNumber(line, length, chunk[i].ls_maxWait);
+            length = appendText(line, length, "\n");
+            spoolPrinterOutput(PERFPRINTER, line, length);
+        }
+    } while (received == LOCKCHUNK);
+
+    /* Kernel object caches that grew: object size, frames, objects in use and free, allocations, failures */
+    kmemStat_t cache;
+    for (i = 0; kmemCacheStats(i, &cache) == SUCCESS; i++) {
+        if ((cache.ks_allocs == 0) && (cache.ks_failures == 0)) {
+            continue;
+        }
+        int length = appendText(line, 0, "perf kmem ");
+        length = appendNumber(line, length, cache.ks_size);
+        length = appendText(line, length, ": frames ");
+        length = appendNumber(line, length, cache.ks_frames);
+        length = appendText(line, length, " used ");
+        length = appendNumber(line, length, cache.ks_inUse);
+        length = appendText(line, length, " free ");
+        length = appendNumber(line, length, cache.ks_free);
+        length = appendText(line, length, " alloc ");
+        length = appendNumber(line, length, cache.ks_allocs);
+        length = appendText(line, length, " fail ");
+        length = appendNumber(line, length, cache.ks_failures);
+        length = appendText(line, length, "\n");
+        spoolPrinterOutput(PERFPRINTER, line, length);
+    }
+
+    /* How each U-proc ended: reason (1 for a trap), CPU time, faults and device operations */
+    exitRecord_t record;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (!readExit(asid, &record)) {
+            continue;
+        }
+        int length = appendText(line, 0, "perf exit ");
+        length = appendNumber(line, length, asid);
+        length = appendText(line, length, ": trap ");
+        length = appendNumber(line, length, record.er_reason);
+        length = appendText(line, length, " cpu ");
+        length = appendNumber(line, length, record.er_cpuTime);
+        length = appendText(line, length, " pf ");
+        length = appendNumber(line, length, record.er_faults);
+        length = appendText(line, length, " io ");
+        length = appendNumber(line, length, record.er_ioCount);
+        length = appendText(line, length, "\n");
+        spoolPrinterOutput(PERFPRINTER, line, length);
+    }
+}
+
+/* ========================================================================
+ * Function: printBootReport
+ *
+ * Description: Spools the boot phases reached so far on printer
+ *              PERFPRINTER, one line each: the TOD the phase ended at and
+ *              how long it took after the previous phase reached, both in
+ *              microseconds (0 for a phase that ended before the one
+ *              listed above it, as a U-proc's first run can)
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void printBootReport() {
+    char line[PERFLINELEN];
+    cpu_t previous = 0;
+    int phase;
+    for (phase = 0; phase < BOOTPHASES; phase++) {
+        cpu_t ended = bootTOD[phase];
+        if (ended == 0) {
+            continue; /* Not reached yet */
+        }
+        int length = appendText(line, 0, "boot ");
+        length = appendNumber(line, length, phase);
+        length = appendText(line, length, ": at ");
+        length = appendNumber(line, length, ended);
+        length = appendText(line, length, " took ");
+        length = appendNumber(line, length, (ended > previous) ? (ended - previous) : 0);
+        length = appendText(line, length, "\n");
+        spoolPrinterOutput(PERFPRINTER, line, length);
+        previous = ended;
+    }
+}
+
+/* ========================================================================
+ * Function: printCount
+ *
+ * Description: Spools "<label><index>: <value>" on printer PERFPRINTER
+ *              unless the value is zero
+ * 
+ * Parameters:
+ *              label - Text before the index
+ *              index - SYSCALL number, line or device index (may be negative)
+ *              value - Counter value
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void printCount(char *label, int index, unsigned int value) {
+    if (value == 0) {
+        return;
+    }
+
+    char line[PERFLINELEN];
+    int length = appendText(line, 0, label);
+    if (index < 0) {
+        length = appendText(line, length, "-");
+        index = -index;
+    }
+    length = appendNumber(line, length, index);
+    length = appendText(line, length, ": ");
+    length = appendNumber(line, length, value);
+    length = appendText(line, length, "\n");
+    spoolPrinterOutput(PERFPRINTER, line, length);
+}
+
+/* ========================================================================
+ * Function: appendText
+ *
+ * Description: Appends a string to a line, dropping what does not fit in
+ *              PERFLINELEN characters
+ * 
+ * Parameters:
+ *              line - Line being built
+ *              length - Characters already in it
+ *              text - NUL-terminated string to append
+ * 
+ * Returns:
+ *              The new length of the line
+ * ======================================================================== */
+int appendText(char *line, int length, char *text) {
+    while ((*text != EOS) && (length < PERFLINELEN)) {
+        line[length++] = *text++;
+    }
+    return length;
+}
+
+/* ========================================================================
+ * Function: appendNumber
+ *
+ * Description: Appends an unsigned number in decimal to a line, dropping
+ *              what does not fit in PERFLINELEN characters
+ * 
+ * Parameters:
+ *              line - Line being built
+ *              length - Characters already in it
+ *              value - Number to append
+ * 
+ * Returns:
+ *              The new length of the line
+ * ======================================================================== */
+int appendNumber(char *line, int length, unsigned int value) {
+    char digits[PERFDIGITS];
+    int count = 0;
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while ((count > 0) && (length < PERFLINELEN)) {
+        line[length++] = digits[--count];
+    }
+    return length;
 }
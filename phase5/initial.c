@@ -12,6 +12,15 @@
  * and ASL data structures, creates the first process running the test function,
  * initializes system semaphores, and finally calls the scheduler to begin
  * execution.
+ * With CPUCOUNT above one, the boot processor then gives each other
+ * processor a Pass Up Vector and a nucleus stack (a slab frame), routes
+ * every device interrupt to itself, and starts the processor with INITCPU
+ * in startCPU, which takes the nucleus lock and enters the scheduler. The
+ * boot processor holds the lock from main on, so the others wait until it
+ * has initialized everything and first leaves the nucleus.
+ * Each boot phase is stamped with the TOD it ended at (markBootPhase), by
+ * main for the nucleus and by test() and the pager for the Support Level,
+ * so SYS56 and the boot report can tell where boot time goes.
  * 
  * Functions:
  * - main: Entry point to the PandOS nucleus. Initializes system data structures,
@@ -20,6 +29,9 @@
  *                           exception handlers and their stack pointers.
  * - initializeSystemVariables: Initializes system variables.
  * - createFirstProcess: Creates the first process running the test function.
+ * - startCPUs: Starts every processor but the boot one.
+ * - startCPU: Entry point of a started processor.
+ * - markBootPhase: Stamps the end of a boot phase.
  *
  * Written by Aryah Rao and Anish Reddy
  *
@@ -32,11 +44,11 @@
 /* System process management variables */
 int processCount;                       /* Number of processes in system */
 int softBlockCount;                     /* Number of blocked processes */
-pcb_PTR readyQueueHigh;                 /* Ready queue (High Priority) */
-pcb_PTR readyQueueLow;                  /* Ready queue (Low Priority) */
-pcb_PTR currentProcess;                 /* Currently executing process */
+readyQueue_t readyQueues[MAXCPUS];     /* MLFQ ready queues of each processor */
+pcb_PTR cpuProcess[MAXCPUS];           /* Process each processor executes */
 int deviceSemaphores[DEVICE_COUNT];     /* Array of device semaphores */
-cpu_t startTOD;                         /* Time of day at system start */
+cpu_t cpuStartTOD[MAXCPUS];             /* Time of day each processor's process was charged up to */
+cpu_t bootTOD[BOOTPHASES];              /* Time of day each boot phase ended (0 until it does) */
 
 /******************** External Declarations ********************/
 /* External declaration for the test & uTLB_RefillHandler function provided by Phase 2 Test */
@@ -47,6 +59,8 @@ extern void uTLB_RefillHandler();
 HIDDEN void initializePassUpVector();
 HIDDEN void initializeSystemVariables();
 HIDDEN pcb_PTR createFirstProcess();
+HIDDEN void startCPUs();
+HIDDEN void startCPU();
 
 /******************** Function Definitions ********************/
 
@@ -63,15 +77,51 @@ HIDDEN pcb_PTR createFirstProcess();
  *              Does not return
  * ======================================================================== */
 void main() {
+    /* The boot processor runs the nucleus alone until it first leaves it */
+    acquireKernel();
+
+    /* No boot phase has ended yet */
+    int phase;
+    for (phase = 0; phase < BOOTPHASES; phase++) {
+        bootTOD[phase] = 0;
+    }
+
     /* Initialize Pass Up Vector */
     /* Set up the system's exception handlers and associated stack pointers */
     initializePassUpVector();
+    markBootPhase(BOOTPASSUP);
     
+    /* Precompute the device descriptors used by the interrupt path and drivers */
+    initDeviceTable();
+    markBootPhase(BOOTDEVICES);
+
+    /* Initialize the kernel frames that let the PCB and semaphore pools grow */
+    initSlab();
+
+    /* Start the other processors (they wait for the nucleus lock); their
+     * stacks are taken before the pools can grow into the slab */
+    if (CPUCOUNT > 1) {
+        startCPUs();
+    }
+    markBootPhase(BOOTSLAB);
+
     /* Initialize PCBs */
     initPcbs();
+    markBootPhase(BOOTPCBS);
     
     /* Initialize ASL */
     initASL();
+    markBootPhase(BOOTASL);
+
+    /* Initialize scheduler quanta */
+    initScheduler();
+    initTrace();
+    initProfiler();
+    initLockStats();
+    initMutexes();
+    initDevStats();
+    initResourceGroups();
+    initTimers();
     
     /* Initialize global variables */
     initializeSystemVariables();
@@ -82,11 +132,12 @@ void main() {
         PANIC();  /* If no PCBs are available, panic */
     }
 
-    /* Load System-wide interval timer with 100ms interval */
-    LDIT(CLOCKINTERVAL);
+    /* Load System-wide interval timer for the first 100ms tick */
+    armPseudoClock();
 
     /* Read Start time */
     STCK(startTOD);
+    markBootPhase(BOOTNUCLEUS);
 
     /* Call scheduler */
     scheduler();
@@ -138,15 +189,23 @@ HIDDEN void initializeSystemVariables() {
     processCount = 0;
     softBlockCount = 0;
 
-    /* Initialize ready queues */
-    readyQueueHigh = mkEmptyProcQ();
-    readyQueueLow = mkEmptyProcQ();
+    /* Initialize the ready queues of every processor */
+    int i;
+    int cpu;
+    for (cpu = 0; cpu < MAXCPUS; cpu++) {
+        for (i = 0; i < SCHEDLEVELS; i++) {
+            readyQueues[cpu].rq_tail[i] = mkEmptyProcQ();
+        }
+        readyQueues[cpu].rq_bitmap = 0;
+        readyQueues[cpu].rq_count = 0;
+    }
 
-    /* Initialize current process */
-    currentProcess = mkEmptyProcQ();
+    /* Initialize current process of every processor */
+    for (i = 0; i < MAXCPUS; i++) {
+        cpuProcess[i] = mkEmptyProcQ();
+    }
     
     /* Initialize device semaphores */
-    int i;
     for (i = 0; i < DEVICE_COUNT; i++) {
         deviceSemaphores[i] = 0;
     }
@@ -184,10 +243,91 @@ HIDDEN pcb_PTR createFirstProcess() {
         /* Set stack pointer to top of RAM */
         firstProcess->p_s.s_sp = RAMTOP;
         
-        /* Add to high priority ready queue and update process count */
-        insertProcQ(&readyQueueHigh, firstProcess);
+        /* Add to the highest priority ready queue and update process count */
+        insertReadyQueue(firstProcess);
         processCount++;
     }
     
     return firstProcess;
 }
+
+/* ========================================================================
+ * Function: startCPUs
+ *
+ * Description: Programs the Interrupt Routing Table (routeInterrupts), then
+ *              gives each other processor a Pass Up Vector and a slab
+ *              frame as its nucleus stack (shared by both handlers, as on
+ *              the boot processor) and starts it at startCPU in kernel
+ *              mode with interrupts off. Processors without a stack frame
+ *              are left stopped.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void startCPUs() {
+    routeInterrupts();
+
+    int cpu;
+    for (cpu = BOOTCPU + 1; cpu < CPUCOUNT; cpu++) {
+        memaddr stack = allocSlabFrame();
+        if (stack == NOFRAME) {
+            return; /* No stack: the remaining processors stay stopped */
+        }
+
+        passupvector_t *passupvector = PASSUPOF(cpu);
+        passupvector->tlb_refll_handler = (memaddr)uTLB_RefillHandler;
+        passupvector->tlb_refll_stackPtr = stack + PAGESIZE;
+        passupvector->execption_handler = (memaddr)exceptionHandler;
+        passupvector->exception_stackPtr = stack + PAGESIZE;
+
+        state_t startState;
+        startState.s_entryHI = 0;
+        startState.s_cause = 0;
+        startState.s_status = ALLOFF; /* Kernel mode, interrupts off */
+        startState.s_pc = (memaddr)startCPU;
+        startState.s_t9 = (memaddr)startCPU;
+        startState.s_sp = stack + PAGESIZE;
+        INITCPU(cpu, &startState);
+    }
+}
+
+/* ========================================================================
+ * Function: startCPU
+ *
+ * Description: Entry point of a processor started by startCPUs. Waits for
+ *              the nucleus lock, then schedules like any kernel exit.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              Does not return
+ * ======================================================================== */
+HIDDEN void startCPU() {
+    acquireKernel();
+    STCK(startTOD);
+    scheduler();
+}
+
+/* ========================================================================
+ * Function: markBootPhase
+ *
+ * Description: Stamps the end of a boot phase with the time of day. Only
+ *              the first stamp of a phase counts, so callers on paths that
+ *              run again (the pager) need not check. Runs in kernel mode,
+ *              from the nucleus or the Support Level.
+ * 
+ * Parameters:
+ *              phase - Boot phase (BOOTPASSUP..BOOTTEXTPRINTS)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void markBootPhase(int phase) {
+    if (bootTOD[phase] == 0) {
+        STCK(bootTOD[phase]);
+    }
+}
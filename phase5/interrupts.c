@@ -8,14 +8,30 @@
  * acknowledges interrupts, and manages process wakeups for I/O completion.
  *
  * Implementation:
- * The module uses a priority-based approach to handle interrupts, checking
- * the cause register to determine which interrupt occurred. It contains specific
+ * The module drains every pending interrupt on each kernel entry: the
+ * pseudo-clock, every device with its bit set on every pending line (in
+ * line priority order), and the PLT last. For terminals, the transmit and
+ * receive halves are serviced independently in the same pass. It contains specific
  * handlers for timer-related interrupts and device I/O interrupts. For device
  * interrupts, it identifies the specific device, acknowledges the interrupt,
  * and unblocks any process waiting for the device. For timer interrupts, it
  * handles PLT (processor local timer) interrupts, which occur when a process's
  * time quantum expires, and IT (interval timer) interrupts, which initiates a
  * system clock tick every 100ms.
+ *
+ * Tickless Policy:
+ * When TICKLESS is set, the interval timer is only armed while a process is
+ * blocked on the pseudo-clock semaphore or on the timer wheel. A tick wakes
+ * every pseudo-clock waiter and the wheel sleepers now due, and re-arms the
+ * timer only for the next tick with a sleeper; the next WAITCLOCK re-arms
+ * it for the next CLOCKINTERVAL boundary of the TOD clock. Ticks stay on
+ * the same 100ms grid without waking an idle CPU for nothing.
+ *
+ * With ONESHOTTIMER also set the timer is armed for the exact TOD of the
+ * earliest WAITUNTIL deadline instead of the tick after it, so a sleeper
+ * wakes on time rather than up to a tick late. Such an interrupt may fall
+ * between ticks: pseudo-clock waiters are then left blocked (clockDue has
+ * not passed) and the timer is re-armed for whichever comes first.
  * 
  * Time Policy:
  * The module updates the current process's CPU time, stores quantum left and 
@@ -23,14 +39,70 @@
  * interrupts. This ensures that the time spent in the nucleus is FREE. The current
  * process is then loaded with the remaining quantum.
  * 
+ * Device Table:
+ * initDeviceTable precomputes a descriptor per device semaphore (register
+ * block, semaphore and, once the Support Level sets it, mutex) and the
+ * lowest set bit of every possible device bitmap, so finding and servicing
+ * an interrupting device is a couple of table loads. The drivers use the
+ * same descriptors.
+ * 
+ * Deferred Policy:
+ * With DEFERIRQ set a device interrupt is split in two. The top half
+ * (handleNonTimerInterrupt) only reads the status, writes the ACK and
+ * queues a deferred_t record. The bottom half (wakeDeviceWaiter: the V,
+ * status hand-off, time charges, device statistics and latency stamps)
+ * runs from drainDeferred, DEFERBUDGET records at a time. Between batches
+ * the Cause register is polled and any device line that became pending is
+ * acknowledged at once. The nucleus never enables interrupts, so the
+ * handling is not shorter overall, but the wait before a new device is
+ * acknowledged is bounded by one batch instead of by every completion
+ * drained in this entry. The queue is always empty when the nucleus
+ * leaves, so no waiter is left unwoken and the scheduler never idles with
+ * work queued. A device completes at most once before its waiter is woken
+ * and issues the next command, so DEFERSLOTS records always suffice.
+ * 
+ * Latency Stamps:
+ * The handler reads the TOD clock on entry and again as each waiter is
+ * woken, feeding the interrupt-to-run latency histograms kept in trace.c;
+ * the scheduler closes each stamp when the woken process next runs.
+ * 
+ * Profiling:
+ * Each PLT interrupt samples the PC of the process it interrupts for the
+ * profiler (profiler.c). When the profiler set the PLT to a sampling
+ * interval shorter than the quantum, quantum is left over and the process
+ * simply resumes with it.
+ * 
+ * Interrupt Routing:
+ * With CPUCOUNT > 1, routeInterrupts programs the Interrupt Routing Table
+ * by IRQROUTING. IRQBOOT sends every source to the boot processor.
+ * IRQSPREAD gives device D on line L to processor (L + D) % CPUCOUNT, so
+ * the devices of a line land on different processors. IRQDYNAMIC lets the
+ * hardware pick the processor with the lowest task priority; the scheduler
+ * sets its TPR to TPRIDLE while it waits and TPRBUSY once it dispatches, so
+ * interrupts go to an idle processor when there is one. The interval timer
+ * stays on the boot processor, where the pseudo-clock is kept. Any
+ * processor may take any device interrupt: the handler runs under the
+ * nucleus lock and drains the line's bitmap, so a processor that finds a
+ * device already acknowledged simply finds nothing to do. Each processor
+ * counts the interrupts it took per line (cpuInterruptCount). Line 0
+ * carries the inter-processor messages of TLB shootdowns (exceptions.c).
+ * 
  * Functions:
+ * - initDeviceTable: Precomputes the device descriptors and bit lookup.
+ * - routeInterrupts: Programs the Interrupt Routing Table.
+ * - cpuInterruptCount: Returns the interrupts a processor took on a line.
  * - interruptHandler: Main interrupt handler that routes interrupts to appropriate
  *                      handlers.
  * - handlePLT: Handles processor local timer interrupts.
+ * - armPseudoClock: Arms the interval timer for the next tick boundary.
+ * - armTimerTick: Arms the interval timer for a given tick.
+ * - armTimerAt: Arms the interval timer for a given TOD.
  * - handlePseudoClock: Handles interval timer interrupts.
- * - handleNonTimerInterrupt: Handles device I/O interrupts.
- * - getDeviceNumber: Identifies the specific device that generated an interrupt.
- * - acknowledge: Acknowledges an interrupt for a specific device.
+ * - serviceDeviceLines: Runs the top half of every pending device line.
+ * - handleNonTimerInterrupt: Acknowledges all pending device I/O interrupts on a line.
+ * - completeDevice: Queues a device completion, or finishes it at once.
+ * - drainDeferred: Runs the queued bottom halves in batches, polling between.
+ * - wakeDeviceWaiter: Unblocks the process waiting on a device semaphore.
  *
  * Written by Aryah Rao and Anish Reddy
  *
@@ -39,14 +111,111 @@
 /******************** Included Header Files ********************/
 #include "../h/interrupts.h"
 
+/******************** Global Variables ********************/
+devDesc_t deviceTable[DEVDESCCOUNT];    /* Per-device registers, semaphores and mutexes */
+
+/******************** Module Variables ********************/
+HIDDEN cpu_t armedTOD = 0;              /* TOD the interval timer is armed for (0 if stopped) */
+HIDDEN cpu_t clockDue = 0;              /* Tick boundary the pseudo-clock waiters wait for (0 if none) */
+HIDDEN int lowestDevice[DEVMAPSIZE];    /* Lowest set bit of each interrupt device bitmap */
+HIDDEN cpu_t interruptTOD;              /* Time of day at entry of the current interrupt */
+HIDDEN unsigned int cpuInterrupts[MAXCPUS][PERFLINES]; /* Interrupts each processor took per line */
+HIDDEN deferred_t deferQueue[DEFERSLOTS];   /* Completions awaiting their bottom half, oldest at deferHead */
+HIDDEN int deferHead = 0;               /* Slot of the oldest queued completion */
+HIDDEN int deferCount = 0;              /* Completions queued */
+
 /******************** Function Prototypes ********************/
 HIDDEN void handlePseudoClock();
-HIDDEN void handlePLT();
+HIDDEN void handlePLT(int quantumLeft);
+HIDDEN void serviceDeviceLines(unsigned int cause);
 HIDDEN void handleNonTimerInterrupt(int line);
-HIDDEN int getDeviceNumber(unsigned int devMap);
+HIDDEN void completeDevice(int *devSemaphore, unsigned int status, int line);
+HIDDEN void drainDeferred();
+HIDDEN void wakeDeviceWaiter(int *devSemaphore, unsigned int status, int line, cpu_t entryTOD);
 
 /******************** Function Definitions ********************/
 
+/* ========================================================================
+ * Function: initDeviceTable
+ *
+ * Description: Fills in the device descriptor of every device semaphore and
+ *              the lowest-set-bit table for interrupt device bitmaps.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initDeviceTable() {
+    devregarea_t* devRegisterArea = (devregarea_t*) RAMBASEADDR;
+    int i;
+    for (i = 0; i < DEVDESCCOUNT; i++) {
+        /* Terminal receivers share the register block of their terminal */
+        int regIndex = (i < TERMRECVINDEX(0)) ? i : (i - DEV_PER_LINE);
+        deviceTable[i].dd_reg = &devRegisterArea->devreg[regIndex];
+        deviceTable[i].dd_sem = &deviceSemaphores[i];
+        deviceTable[i].dd_mutex = NULL;
+    }
+
+    /* lowestDevice[0] is never used: a line only interrupts with a bit set */
+    lowestDevice[0] = 0;
+    int map;
+    for (map = 1; map < DEVMAPSIZE; map++) {
+        int bit = 0;
+        while (!(map & (1 << bit))) {
+            bit++;
+        }
+        lowestDevice[map] = bit;
+    }
+}
+
+/* ========================================================================
+ * Function: routeInterrupts
+ *
+ * Description: Programs every Interrupt Routing Table entry by IRQROUTING.
+ *              The interval timer entries always name the boot processor.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void routeInterrupts() {
+    unsigned int *irt = (unsigned int *)IRTBASE;
+    int line;
+    for (line = ITINT; line <= TERMINT; line++) {
+        int dev;
+        for (dev = 0; dev < DEV_PER_LINE; dev++) {
+            unsigned int entry = IRTSTATIC(BOOTCPU);
+            if ((line != ITINT) && (IRQROUTING == IRQSPREAD)) {
+                entry = IRTSTATIC((line + dev) % CPUCOUNT);
+            } else if ((line != ITINT) && (IRQROUTING == IRQDYNAMIC)) {
+                entry = IRTDYNAMIC((1 << CPUCOUNT) - 1);
+            }
+            irt[IRTINDEX(line, dev)] = entry;
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: cpuInterruptCount
+ *
+ * Description: Returns how many times a processor entered the nucleus for
+ *              an interrupt on a line.
+ * 
+ * Parameters:
+ *              cpu - Processor number
+ *              line - Interrupt line (IPIINT..TERMINT)
+ * 
+ * Returns:
+ *              Its interrupt count on that line
+ * ======================================================================== */
+unsigned int cpuInterruptCount(int cpu, int line) {
+    return cpuInterrupts[cpu][line];
+}
+
 /* ========================================================================
  * Function: interruptHandler
  *
@@ -61,7 +230,12 @@ HIDDEN int getDeviceNumber(unsigned int devMap);
  * ======================================================================== */
 void interruptHandler() {
     /* Get old processor state from BIOS data page */
-    state_t* interruptState = (state_t*) BIOSDATAPAGE;
+    state_t* interruptState = EXCSTATE(CPUID());
+
+    /* Stamp the entry for the interrupt-to-run latency histograms */
+    if (LATENCYSTATS) {
+        STCK(interruptTOD);
+    }
 
     /* Update current process state and get remaining quantum */
     int quantumLeft = updateCurrentProcess(interruptState);
@@ -69,35 +243,41 @@ void interruptHandler() {
     /* Get the interrupt cause bits from cause register */
     int cause = interruptState->s_cause;
 
-    /* Process the interrupt based on its type - checking interrupt pending bits */
-    if (cause & PLTINTERRUPT) {
-        /* Processor Local Timer interrupt (quantum expired) */
-        handlePLT();
-    } else if (cause & ITINTERRUPT) {
+    /* Unknown interrupt type - critical error */
+    if ((cause & (IPIINTERRUPT | PLTINTERRUPT | ITINTERRUPT | DEVINTERRUPTS)) == 0) {
+        PANIC();
+    }
+
+    /* Drain every pending source before resuming: the pseudo-clock, then each
+     * device line in priority order, and the PLT last since it takes the
+     * current process off the CPU */
+    if (cause & IPIINTERRUPT) {
+        /* Another processor asks for a TLB flush, or to reap a process it
+         * terminated (done on entry by exceptionHandler) */
+        perfCount(PERF_LINE + IPIINT, 0);
+        cpuInterrupts[CPUID()][IPIINT]++;
+        *((unsigned int *)IPIINBOX) = 0;
+        releaseShootdowns(CPUID());
+    }
+    if (cause & ITINTERRUPT) {
         /* Interval Timer interrupt (pseudoclock) */
+        perfCount(PERF_LINE + ITINT, 0);
+        cpuInterrupts[CPUID()][ITINT]++;
         handlePseudoClock();
-    } else if (cause & DISKINTERRUPT) {
-        /* Disk device interrupt */
-        handleNonTimerInterrupt(DISKINT);
-    } else if (cause & FLASHINTERRUPT) {
-        /* Flash device interrupt */
-        handleNonTimerInterrupt(FLASHINT);
-    } else if (cause & NETWORKINTERRUPT) {
-        /* Network device interrupt */
-        handleNonTimerInterrupt(NETWINT);
-    } else if (cause & PRINTERINTERRUPT) {
-        /* Printer device interrupt */
-        handleNonTimerInterrupt(PRNTINT);
-    } else if (cause & TERMINTERRUPT) {
-        /* Terminal device interrupt */
-        handleNonTimerInterrupt(TERMINT);
-    } else {
-        /* Unknown interrupt type - critical error */
-        PANIC();
+    }
+    serviceDeviceLines(cause);
+    drainDeferred();
+    if (cause & PLTINTERRUPT) {
+        /* Processor Local Timer interrupt (quantum expired) */
+        perfCount(PERF_LINE + PLTINT, 0);
+        cpuInterrupts[CPUID()][PLTINT]++;
+        handlePLT(quantumLeft);
     }
 
     /* Resume execution of current process or call scheduler */
     if (currentProcess != mkEmptyProcQ()) {
+        /* Interrupt handling is not charged to the interrupted process */
+        STCK(startTOD);
         loadProcessState(&currentProcess->p_s, quantumLeft);
     } else {
         /* No current process - call scheduler to select next process */
@@ -109,23 +289,36 @@ void interruptHandler() {
  * Function: handlePLT
  *
  * Description: Handles Processor Local Timer (PLT) interrupts which occur
- *              when a process's time quantum expires.
+ *              when a process's time quantum expires, or at a profiler
+ *              sampling interval with quantum left over.
  * 
  * Parameters:
- *              None
+ *              quantumLeft - Quantum the current process has left
  * 
  * Returns:
  *              None (control returns to interruptHandler)
  * ======================================================================== */
-HIDDEN void handlePLT() {
+HIDDEN void handlePLT(int quantumLeft) {
     /* Current process state and CPU time have been updated in interruptHandler */
 
     /* Acknowledge the interrupt by resetting the interval timer */
     setTIMER(CLOCKINTERVAL);
 
     if (currentProcess != mkEmptyProcQ()) {
-        /* Move process from high to low priority queue when quantum expires */
-        insertProcQ(&readyQueueLow, currentProcess);
+        profileSample(currentProcess);
+    }
+
+    /* Only a sampling interval passed: the process keeps its quantum */
+    if (quantumLeft > 0) {
+        return;
+    }
+
+    if (currentProcess != mkEmptyProcQ()) {
+        /* Quantum expired: demote the process one level and requeue it */
+        traceEvent(TRACE_PREEMPT, currentProcess, NULL);
+        perfCount(PERF_PREEMPT, processASID(currentProcess));
+        demoteProcess(currentProcess);
+        insertReadyQueue(currentProcess);
 
         /* Reset current process pointer - a new process will be selected */
         currentProcess = mkEmptyProcQ();
@@ -134,6 +327,67 @@ HIDDEN void handlePLT() {
     /* Returns to interruptHandler which will either resume process or call scheduler */
 }
 
+/* ========================================================================
+ * Function: armPseudoClock
+ *
+ * Description: Makes sure the interval timer fires at the next
+ *              CLOCKINTERVAL boundary of the TOD clock.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void armPseudoClock() {
+    if (clockDue == 0) {
+        cpu_t currentTOD;
+        STCK(currentTOD);
+        clockDue = ((currentTOD / CLOCKINTERVAL) + 1) * CLOCKINTERVAL;
+    }
+    armTimerAt(clockDue);
+}
+
+/* ========================================================================
+ * Function: armTimerTick
+ *
+ * Description: With TICKLESS set, arms the interval timer for the given
+ *              tick of the TOD clock unless it is already armed for that
+ *              tick or an earlier one. A tick already passed fires at once.
+ *              Without TICKLESS the timer reloads itself every tick.
+ * 
+ * Parameters:
+ *              tick - Tick number (TOD / CLOCKINTERVAL) to fire at
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void armTimerTick(unsigned int tick) {
+    armTimerAt(tick * CLOCKINTERVAL);
+}
+
+/* ========================================================================
+ * Function: armTimerAt
+ *
+ * Description: With TICKLESS set, arms the interval timer to fire once at
+ *              the given TOD unless it is already armed for that time or
+ *              an earlier one. A time already passed fires at once.
+ * 
+ * Parameters:
+ *              fireTOD - Time of day to fire at
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void armTimerAt(cpu_t fireTOD) {
+    if (TICKLESS && ((armedTOD == 0) || (fireTOD < armedTOD))) {
+        cpu_t currentTOD;
+        STCK(currentTOD);
+        LDIT((fireTOD > currentTOD) ? (fireTOD - currentTOD) : 1);
+        armedTOD = fireTOD;
+    }
+}
+
 /* ========================================================================
  * Function: handlePseudoClock
  *
@@ -149,29 +403,86 @@ HIDDEN void handlePLT() {
 HIDDEN void handlePseudoClock() {
     /* Current process state and CPU time have been updated in interruptHandler */
 
-    /* Acknowledge the interrupt by reloading the interval timer */
-    LDIT(CLOCKINTERVAL);
+    if (TICKLESS) {
+        /* Acknowledge the interrupt and leave the timer stopped until the next WAITCLOCK */
+        STOPIT();
+        armedTOD = 0;
+    } else {
+        /* Acknowledge the interrupt by reloading the interval timer */
+        LDIT(CLOCKINTERVAL);
+    }
     
-    /* Wake up all processes blocked on pseudoclock semaphore */
+    /* Wake up all processes blocked on pseudoclock semaphore, once their tick has come */
+    cpu_t currentTOD;
+    STCK(currentTOD);
+    int clockTicked = (!TICKLESS) || ((clockDue != 0) && (currentTOD >= clockDue));
+    if (clockTicked) {
+        clockDue = 0;
+        perfCount(PERF_DEVICE + (DEVICE_COUNT - 1), 0);
+    }
     pcb_PTR p;
-    while ((p = removeBlocked(&deviceSemaphores[DEVICE_COUNT-1])) != mkEmptyProcQ()) {
-        /* Decrement soft block count and add process to high priority ready queue */
+    while (clockTicked && ((p = removeBlocked(&deviceSemaphores[DEVICE_COUNT-1])) != mkEmptyProcQ())) {
+        /* Decrement soft block count and add process to the ready queue of its level */
+        chargeBlockedTime(p, currentTOD);
+        recordWakeLatency(p, ITINT, interruptTOD, currentTOD);
+        traceEvent(TRACE_UNBLOCK, p, &deviceSemaphores[DEVICE_COUNT-1]);
         softBlockCount--;
-        insertProcQ(&readyQueueHigh, p);
+        insertReadyQueue(p);
     }
     
     /* Reset pseudoclock semaphore to initial state */
-    deviceSemaphores[DEVICE_COUNT-1] = 0;
+    if (clockTicked) {
+        deviceSemaphores[DEVICE_COUNT-1] = 0;
+    } else if (clockDue != 0) {
+        armTimerAt(clockDue); /* Fired early for a deadline: the tick is still owed */
+    }
+
+    /* Ready the WAITUNTIL sleepers whose deadline passed, then keep the
+     * timer armed for the next tick (or exact deadline) that has any left */
+    expireTimers(currentTOD);
+    if (TICKLESS && (nextTimerTick() != 0)) {
+        if (ONESHOTTIMER) {
+            armTimerAt(nextTimerDeadline());
+        } else {
+            armTimerTick(nextTimerTick());
+        }
+    }
 
     /* Returns to interruptHandler which will either resume process or call scheduler */
 }
 
 /* ========================================================================
- * Function: handleDeviceInterrupt
+ * Function: serviceDeviceLines
  *
- * Description: Handles interrupts from I/O devices by identifying the specific
- *              device, acknowledging the interrupt, and unblocking any waiting
- *              process.
+ * Description: Runs the top half of every device line pending in a Cause
+ *              value, in line priority order.
+ * 
+ * Parameters:
+ *              cause - Cause register value
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void serviceDeviceLines(unsigned int cause) {
+    int line;
+    for (line = DISKINT; line <= TERMINT; line++) {
+        if (cause & LINEINTERRUPT(line)) {
+            /* Device interrupts on this line */
+            perfCount(PERF_LINE + line, 0);
+            cpuInterrupts[CPUID()][line]++;
+            handleNonTimerInterrupt(line);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: handleNonTimerInterrupt
+ *
+ * Description: Handles interrupts from I/O devices on one line. Every device
+ *              with its bit set in the line's interrupt device bitmap is
+ *              acknowledged and its completion handed to completeDevice,
+ *              so devices that completed together cost one kernel entry
+ *              instead of one each.
  * 
  * Parameters:
  *              line - Interrupt line number (3-7)
@@ -182,86 +493,149 @@ HIDDEN void handlePseudoClock() {
 HIDDEN void handleNonTimerInterrupt(int line) {
     /* Access device registers from RAMBASE address */
     devregarea_t* devRegisterArea = (devregarea_t*) RAMBASEADDR;
-    
+
     /* Get the interrupt device map for this line */
-    unsigned int devMap = devRegisterArea->interrupt_dev[line - MAPINT];
-    
-    /* Identify which specific device triggered the interrupt */
-    int devNum = getDeviceNumber(devMap);
-    
-    /* Calculate device semaphore index based on line and device number */
-    int devSemaphore = ((line - MAPINT) * DEV_PER_LINE) + devNum;
+    unsigned int devMap = devRegisterArea->interrupt_dev[line - MAPINT] & (DEVMAPSIZE - 1);
+
+    while (devMap != 0) {
+        /* Identify the next device that triggered the interrupt */
+        int devNum = lowestDevice[devMap];
+        devMap &= (devMap - 1);
     
-    /* Acknowledge the interrupt and get device status code */
-    unsigned int status;
-
-    /* Special handling for terminal devices */
-    if (line == TERMINT) {
-        /* Check if it's a transmit or receive interrupt by examining status bit */
-        if ((devRegisterArea->devreg[devSemaphore].t_transm_status & TRANSM_BIT) != READY) {
-            /* Transmit interrupt (write operation) */
-            status = devRegisterArea->devreg[devSemaphore].t_transm_status;
-            /* Acknowledge the interrupt by writing ACK to the command register */
-            devRegisterArea->devreg[devSemaphore].t_transm_command = ACK;
+        /* Look up the device's descriptor */
+        devDesc_PTR desc = DEVDESC(line, devNum);
+        device_t *reg = desc->dd_reg;
+
+        /* Special handling for terminal devices: a full-duplex terminal can
+         * complete a transmit and a receive together, so both halves are
+         * checked, acknowledged and V-ed in this one pass */
+        if (line == TERMINT) {
+            unsigned int transmStatus = reg->t_transm_status;
+            unsigned int recvStatus = reg->t_recv_status;
+
+            if (TERMHALFDONE(transmStatus)) {
+                /* Transmit interrupt (write operation): acknowledge by writing ACK */
+                reg->t_transm_command = ACK;
+                completeDevice(desc->dd_sem, transmStatus, line);
+            }
+            if (TERMHALFDONE(recvStatus)) {
+                /* Receive interrupt (read operation): acknowledge by writing ACK */
+                reg->t_recv_command = ACK;
+                completeDevice(TERMRECVDESC(devNum)->dd_sem, recvStatus, line);
+            }
         } else {
-            /* Receive interrupt (read operation) */
-            status = devRegisterArea->devreg[devSemaphore].t_recv_status;
+            /* Standard handling for non-terminal devices */
+            unsigned int status = reg->d_status;
             /* Acknowledge the interrupt by writing ACK to the command register */
-            devRegisterArea->devreg[devSemaphore].t_recv_command = ACK;
-            devSemaphore += DEV_PER_LINE;
+            reg->d_command = ACK;
+            completeDevice(desc->dd_sem, status, line);
         }
-    } else {
-        /* Standard handling for non-terminal devices */
-        status = devRegisterArea->devreg[devSemaphore].d_status;
-        /* Acknowledge the interrupt by writing ACK to the command register */
-        devRegisterArea->devreg[devSemaphore].d_command = ACK;
     }
     
-    /* Perform V operation to unblock any process waiting on this device */
-    pcb_PTR unblockedProcess = verhogen(&deviceSemaphores[devSemaphore]);
+    /* Returns to interruptHandler which will either resume process or call scheduler */
+}
 
-    /* If a process was unblocked, pass the device status to it */
-    if (unblockedProcess != mkEmptyProcQ()) {
-        unblockedProcess->p_s.s_v0 = status;
-        softBlockCount--;
+/* ========================================================================
+ * Function: completeDevice
+ *
+ * Description: Queues an acknowledged device completion for its bottom
+ *              half. Without DEFERIRQ (or, defensively, with the queue
+ *              full) the waiter is woken at once instead.
+ * 
+ * Parameters:
+ *              devSemaphore - Address of the device semaphore
+ *              status - Device status read before the ACK
+ *              line - Interrupt line of the device
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void completeDevice(int *devSemaphore, unsigned int status, int line) {
+    if (!DEFERIRQ || (deferCount == DEFERSLOTS)) {
+        wakeDeviceWaiter(devSemaphore, status, line, interruptTOD);
+        return;
     }
-    
-    /* Returns to interruptHandler which will either resume process or call scheduler */
+
+    deferred_PTR record = &deferQueue[(deferHead + deferCount) % DEFERSLOTS];
+    record->df_index = devSemaphore - deviceSemaphores;
+    record->df_status = status;
+    record->df_line = line;
+    record->df_tod = interruptTOD;
+    deferCount++;
 }
 
 /* ========================================================================
- * Function: getDeviceNumber
+ * Function: drainDeferred
  *
- * Description: Identifies the specific device number that generated an interrupt
- *              by analyzing the interrupt pending bits.
+ * Description: Runs the bottom half of every queued completion, oldest
+ *              first, DEFERBUDGET at a time. After each batch the device
+ *              lines that became pending meanwhile are acknowledged (their
+ *              completions join the queue), so no device waits for more
+ *              than one batch. Returns with the queue empty.
  * 
  * Parameters:
- *              devMap - Bitmask of pending device interrupts
+ *              None
  * 
  * Returns:
- *              Device number (0-7) or ERROR if no device found
+ *              None
  * ======================================================================== */
-HIDDEN int getDeviceNumber(unsigned int devMap) {
-    /* Check each bit position to identify which device triggered the interrupt */
-    if (devMap & (PROCINTERRUPT >> 8)) {
-        return PROCINT;          /* Processor interrupt (0) */
-    } else if (devMap & (PLTINTERRUPT >> 8)) {
-        return PLTINT;           /* Processor local timer (1) */
-    } else if (devMap & (ITINTERRUPT >> 8)) {
-        return ITINT;            /* Interval timer (2) */
-    } else if (devMap & (DISKINTERRUPT >> 8)) {
-        return DISKINT;          /* Disk device (3) */
-    } else if (devMap & (FLASHINTERRUPT >> 8)) {
-        return FLASHINT;         /* Flash device (4) */
-    } else if (devMap & (NETWORKINTERRUPT >> 8)) {
-        return NETWINT;          /* Network device (5) */
-    } else if (devMap & (PRINTERINTERRUPT >> 8)) {
-        return PRNTINT;          /* Printer device (6) */
-    } else if (devMap & (TERMINTERRUPT >> 8)) {
-        return TERMINT;          /* Terminal device (7) */
-    } else {
-        /* No matching device found - critical error */
-        PANIC();
-        return ERROR;            /* -1, should never reach here */
+HIDDEN void drainDeferred() {
+    while (deferCount > 0) {
+        int done;
+        for (done = 0; (done < DEFERBUDGET) && (deferCount > 0); done++) {
+            deferred_t record = deferQueue[deferHead];
+            deferHead = (deferHead + 1) % DEFERSLOTS;
+            deferCount--;
+            wakeDeviceWaiter(&deviceSemaphores[record.df_index], record.df_status,
+                             record.df_line, record.df_tod);
+        }
+
+        /* Poll for devices that interrupted during the batch */
+        unsigned int pending = getCAUSE() & DEVINTERRUPTS;
+        if (pending != 0) {
+            if (LATENCYSTATS) {
+                STCK(interruptTOD);
+            }
+            serviceDeviceLines(pending);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: wakeDeviceWaiter
+ *
+ * Description: Performs a V on a device semaphore and hands the device
+ *              status to the process it unblocks, if any. The wake-up is
+ *              timed once for its blocked time and latency histogram, and
+ *              a page-in holding up a mutex is queued to run next.
+ * 
+ * Parameters:
+ *              devSemaphore - Address of the device semaphore
+ *              status - Device status to return in v0
+ *              line - Interrupt line of the device
+ *              entryTOD - TOD of the interrupt entry that acknowledged it
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void wakeDeviceWaiter(int *devSemaphore, unsigned int status, int line, cpu_t entryTOD) {
+    /* Perform V operation to unblock any process waiting on this device */
+    devCompleted(devSemaphore - deviceSemaphores, status);
+    pcb_PTR unblockedProcess = verhogen(devSemaphore);
+    int asid = (unblockedProcess != mkEmptyProcQ()) ? processASID(unblockedProcess) : 0;
+    perfCount(PERF_DEVICE + (devSemaphore - deviceSemaphores), asid);
+
+    /* If a process was unblocked, pass the device status to it */
+    if (unblockedProcess != mkEmptyProcQ()) {
+        unblockedProcess->p_s.s_v0 = status;
+        softBlockCount--;
+
+        cpu_t currentTOD;
+        STCK(currentTOD);
+        chargeBlockedTime(unblockedProcess, currentTOD);
+        recordWakeLatency(unblockedProcess, line, entryTOD, currentTOD);
+
+        /* A page-in others are queued behind runs next */
+        expeditePageIn(unblockedProcess);
     }
 }
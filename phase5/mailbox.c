@@ -0,0 +1,285 @@
+/******************************* mailbox.c ***********************************
+ *
+ * Module: Message Passing
+ *
+ * Description:
+ * This module gives every ASID a mailbox of MAILBOXSLOTS messages, so
+ * U-procs can pass data to each other without going through a device.
+ * SYS36 sends a message to an ASID's mailbox, blocking while it is full;
+ * SYS37 takes the oldest message from the caller's own mailbox, blocking
+ * while it is empty.
+ *
+ * A message of up to MSGINLINE bytes is copied into the mailbox slot. A
+ * page message (a whole page-aligned page) is not copied at all: the
+ * sender's frame is detached from its page table (detachUserPage) and
+ * waits in the slot, busy, until the receiver's page table maps it
+ * (attachUserPage). Only if the receiver's buffer cannot take the frame
+ * (not a page-aligned page, a text page, or one busy with I/O) is the
+ * frame copied out and freed.
+ *
+ * Policy Decisions:
+ * - Sizes: A message is 0 to MSGINLINE bytes or exactly PAGESIZE bytes at
+ *   a page-aligned address; anything else terminates the U-proc, as does
+ *   an ASID outside 1..MAXUPROC or a buffer outside user space
+ * - Page Ownership: Sending a page gives it away. Afterwards the sender's
+ *   page reads back its last written-back (or zero-fill) contents
+ * - Non-Resident Pages: A page message whose page is not resident is
+ *   touched to fault it in, up to MSGRETRIES times; a page that still
+ *   cannot be detached (text, shared, busy) makes SYS36 return ERROR
+ * - Termination: A terminating U-proc's mailbox is closed: its queued
+ *   messages are dropped (their frames freed) and later sends to it
+ *   return ERROR
+ * - Locking: mailboxMutex guards the slots and is never held across a
+ *   user memory access, so it is never held while paging; it may be held
+ *   when swapPoolMutex is taken, never the other way round
+ *
+ * Functions:
+ * - initMailboxes: Empties every mailbox
+ * - closeMailbox: Drops a terminating U-proc's messages
+ * - openMailbox: Reopens a closed mailbox for a clone taking its ASID
+ * - msgSendSyscallHandler: Implements SYS36 (MSGSEND)
+ * - msgReceiveSyscallHandler: Implements SYS37 (MSGRECEIVE)
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/mailbox.h"
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN message_t mailboxes[MAXUPROC + 1][MAILBOXSLOTS]; /* Queued messages of each ASID */
+HIDDEN int mailHead[MAXUPROC + 1];              /* Slot of each mailbox's oldest message */
+HIDDEN int mailCount[MAXUPROC + 1];             /* Messages queued in each mailbox */
+HIDDEN int mailClosed[MAXUPROC + 1];            /* The ASID terminated: its mail is dropped */
+HIDDEN int mailReady[MAXUPROC + 1];             /* Semaphores counting queued messages */
+HIDDEN int mailRoom[MAXUPROC + 1];              /* Semaphores counting free slots */
+HIDDEN int mailboxMutex;                        /* Semaphore for the mailbox slots */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initMailboxes
+ *
+ * Description: Empties and opens every mailbox
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initMailboxes() {
+    int asid;
+    for (asid = 0; asid <= MAXUPROC; asid++) {
+        mailHead[asid] = 0;
+        mailCount[asid] = 0;
+        mailClosed[asid] = FALSE;
+        mailReady[asid] = 0;
+        mailRoom[asid] = MAILBOXSLOTS;
+    }
+    mailboxMutex = 1;
+}
+
+/* ========================================================================
+ * Function: closeMailbox
+ *
+ * Description: Closes a terminating U-proc's mailbox: queued page
+ *              messages give their frames back and senders blocked on the
+ *              full mailbox are let through, to find it closed
+ *
+ * Parameters:
+ *              asid - ASID of the terminating U-proc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void closeMailbox(int asid) {
+    SYSCALL(PASSEREN, (int)&mailboxMutex, 0, 0);
+    mailClosed[asid] = TRUE;
+    while (mailCount[asid] > 0) {
+        message_PTR message = &mailboxes[asid][mailHead[asid]];
+        if (message->msg_frame != NOSWAPFRAME) {
+            releaseMessageFrame(message->msg_frame);
+        }
+        mailHead[asid] = (mailHead[asid] + 1) % MAILBOXSLOTS;
+        mailCount[asid]--;
+        SYSCALL(VERHOGEN, (int)&mailRoom[asid], 0, 0);
+    }
+    SYSCALL(VERHOGEN, (int)&mailboxMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: openMailbox
+ *
+ * Description: Reopens the mailbox of an ASID a clone is taking. It was
+ *              emptied when it closed; the message count its old U-proc
+ *              never received is dropped
+ *
+ * Parameters:
+ *              asid - ASID of the clone
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void openMailbox(int asid) {
+    SYSCALL(PASSEREN, (int)&mailboxMutex, 0, 0);
+    mailClosed[asid] = FALSE;
+    mailReady[asid] = 0;
+    SYSCALL(VERHOGEN, (int)&mailboxMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: msgSendSyscallHandler
+ *
+ * Description: Handles SYS36 (MSGSEND). Sends the a3 bytes at a2 to the
+ *              mailbox of ASID a1, waiting for a free slot. An inline
+ *              message is copied into the slot; a page message moves the
+ *              sender's frame into it
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              SUCCESS if the message is queued, ERROR if the page could
+ *              not be detached or the receiver has terminated
+ * ======================================================================== */
+int msgSendSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    int target = exceptState->s_a1;
+    char *buffer = (char *)exceptState->s_a2;
+    int length = exceptState->s_a3;
+
+    /* Validate parameters */
+    int pageMessage = (length == PAGESIZE);
+    if ((target < 1) || (target > MAXUPROC) || (length < 0) ||
+        ((length > MSGINLINE) && !pageMessage) ||
+        (pageMessage && ((memaddr)buffer & (PAGESIZE - 1))) ||
+        ((length > 0) && (!validateUserAddress((memaddr)buffer) ||
+                          !validateUserAddress((memaddr)(buffer + length - 1))))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Copy an inline message before waiting: the buffer may fault */
+    char data[MSGINLINE];
+    int i;
+    if (!pageMessage) {
+        for (i = 0; i < length; i++) {
+            data[i] = buffer[i];
+        }
+    }
+
+    /* Wait for a free slot */
+    SYSCALL(PASSEREN, (int)&mailRoom[target], 0, 0);
+
+    /* Take the page's frame, faulting the page in if it is not resident */
+    int frameNum = NOSWAPFRAME;
+    int tries;
+    for (tries = 0; pageMessage && (frameNum == NOSWAPFRAME) && (tries < MSGRETRIES); tries++) {
+        frameNum = detachUserPage(supportStruct, (memaddr)buffer);
+        if (frameNum == NOSWAPFRAME) {
+            data[0] = *((volatile char *)buffer);
+        }
+    }
+    if (pageMessage && (frameNum == NOSWAPFRAME)) {
+        SYSCALL(VERHOGEN, (int)&mailRoom[target], 0, 0);
+        return ERROR;
+    }
+
+    /* Queue the message */
+    SYSCALL(PASSEREN, (int)&mailboxMutex, 0, 0);
+    if (mailClosed[target]) {
+        if (frameNum != NOSWAPFRAME) {
+            releaseMessageFrame(frameNum);
+        }
+        SYSCALL(VERHOGEN, (int)&mailboxMutex, 0, 0);
+        SYSCALL(VERHOGEN, (int)&mailRoom[target], 0, 0);
+        return ERROR;
+    }
+    message_PTR message = &mailboxes[target][(mailHead[target] + mailCount[target]) % MAILBOXSLOTS];
+    message->msg_sender = supportStruct->sup_asid;
+    message->msg_length = length;
+    message->msg_frame = frameNum;
+    for (i = 0; (i < length) && !pageMessage; i++) {
+        message->msg_data[i] = data[i];
+    }
+    mailCount[target]++;
+    SYSCALL(VERHOGEN, (int)&mailboxMutex, 0, 0);
+
+    /* Wake the receiver */
+    SYSCALL(VERHOGEN, (int)&mailReady[target], 0, 0);
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * Function: msgReceiveSyscallHandler
+ *
+ * Description: Handles SYS37 (MSGRECEIVE). Takes the oldest message from
+ *              the caller's mailbox, waiting for one, into the buffer at
+ *              a1 of a2 bytes. A page message whose buffer is a whole
+ *              page-aligned page is mapped there; otherwise as much of the
+ *              message as fits is copied. If a3 is not 0 the sender's ASID
+ *              is stored at that user address
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Number of bytes delivered
+ * ======================================================================== */
+int msgReceiveSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    char *buffer = (char *)exceptState->s_a1;
+    int capacity = exceptState->s_a2;
+    int *senderOut = (int *)exceptState->s_a3;
+    int asid = supportStruct->sup_asid;
+
+    /* Validate parameters (callers with no sender buffer pass 0) */
+    if ((capacity < 0) ||
+        ((capacity > 0) && (!validateUserAddress((memaddr)buffer) ||
+                            !validateUserAddress((memaddr)(buffer + capacity - 1)))) ||
+        ((senderOut != 0) && !validateUserAddress((memaddr)senderOut))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Take the oldest message, copying an inline one out of the slot */
+    SYSCALL(PASSEREN, (int)&mailReady[asid], 0, 0);
+    SYSCALL(PASSEREN, (int)&mailboxMutex, 0, 0);
+    message_PTR message = &mailboxes[asid][mailHead[asid]];
+    int sender = message->msg_sender;
+    int length = message->msg_length;
+    int frameNum = message->msg_frame;
+    char data[MSGINLINE];
+    int i;
+    for (i = 0; (i < length) && (frameNum == NOSWAPFRAME); i++) {
+        data[i] = message->msg_data[i];
+    }
+    mailHead[asid] = (mailHead[asid] + 1) % MAILBOXSLOTS;
+    mailCount[asid]--;
+    SYSCALL(VERHOGEN, (int)&mailboxMutex, 0, 0);
+    SYSCALL(VERHOGEN, (int)&mailRoom[asid], 0, 0);
+
+    /* Deliver it */
+    int delivered = MIN(length, capacity);
+    if (frameNum == NOSWAPFRAME) {
+        for (i = 0; i < delivered; i++) {
+            buffer[i] = data[i];
+        }
+    } else if ((capacity < PAGESIZE) || ((memaddr)buffer & (PAGESIZE - 1)) ||
+               !attachUserPage(supportStruct, (memaddr)buffer, frameNum)) {
+        /* The frame cannot be mapped there: copy it and free it */
+        char *page = (char *)FRAMETOADDR(frameNum);
+        for (i = 0; i < delivered; i++) {
+            buffer[i] = page[i];
+        }
+        releaseMessageFrame(frameNum);
+    }
+
+    if (senderOut != 0) {
+        *senderOut = sender;
+    }
+    return delivered;
+}
@@ -0,0 +1,176 @@
+/******************************* memOps.c *************************************
+ *
+ * Module: Word Copy and Fill
+ *
+ * Description:
+ * This module holds the copy and fill loops the kernel otherwise hand-rolls
+ * word by word: DMA bounce and block cache copies (copyBlock), processor
+ * state copies (copyState), support structure resets and zero-fill pages.
+ * There is no libc to provide memcpy or memset.
+ *
+ * Implementation:
+ * MIPS-I has no multi-word load or store, so each loop iteration moves a
+ * burst of BURSTWORDS words: all of them are loaded into registers before
+ * any is stored, letting the loads issue back to back and filling each
+ * load delay slot with the next load instead of a nop, and the loop
+ * overhead (compare, branch, two pointer increments) is paid once per
+ * burst instead of once per word. The page routines need no tail since a
+ * page is a whole number of bursts; the general ones finish any words
+ * past the last burst one at a time. All addresses must be word aligned.
+ *
+ * Functions:
+ * - copyWords: Copies a number of words.
+ * - setWords: Fills a number of words with one value.
+ * - copyPage: Copies a page.
+ * - zeroPage: Zeroes a page.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/memOps.h"
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: copyWords
+ *
+ * Description: Copies words from src to dest in bursts of BURSTWORDS. The
+ *              areas must not overlap.
+ *
+ * Parameters:
+ *              dest - First word to write
+ *              src - First word to read
+ *              words - Number of words to copy
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void copyWords(unsigned int *dest, unsigned int *src, int words) {
+    while (words >= BURSTWORDS) {
+        unsigned int w0 = src[0];
+        unsigned int w1 = src[1];
+        unsigned int w2 = src[2];
+        unsigned int w3 = src[3];
+        unsigned int w4 = src[4];
+        unsigned int w5 = src[5];
+        unsigned int w6 = src[6];
+        unsigned int w7 = src[7];
+        dest[0] = w0;
+        dest[1] = w1;
+        dest[2] = w2;
+        dest[3] = w3;
+        dest[4] = w4;
+        dest[5] = w5;
+        dest[6] = w6;
+        dest[7] = w7;
+        dest += BURSTWORDS;
+        src += BURSTWORDS;
+        words -= BURSTWORDS;
+    }
+
+    /* The words past the last burst */
+    while (words > 0) {
+        *dest++ = *src++;
+        words--;
+    }
+}
+
+/* ========================================================================
+ * Function: setWords
+ *
+ * Description: Stores one value into words starting at dest, in bursts of
+ *              BURSTWORDS.
+ *
+ * Parameters:
+ *              dest - First word to write
+ *              value - Value to store
+ *              words - Number of words to fill
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void setWords(unsigned int *dest, unsigned int value, int words) {
+    while (words >= BURSTWORDS) {
+        dest[0] = value;
+        dest[1] = value;
+        dest[2] = value;
+        dest[3] = value;
+        dest[4] = value;
+        dest[5] = value;
+        dest[6] = value;
+        dest[7] = value;
+        dest += BURSTWORDS;
+        words -= BURSTWORDS;
+    }
+
+    /* The words past the last burst */
+    while (words > 0) {
+        *dest++ = value;
+        words--;
+    }
+}
+
+/* ========================================================================
+ * Function: copyPage
+ *
+ * Description: Copies one page from src to dest. The pages must not
+ *              overlap.
+ *
+ * Parameters:
+ *              dest - Address of the destination page
+ *              src - Address of the source page
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void copyPage(unsigned int *dest, unsigned int *src) {
+    unsigned int *end = src + (PAGESIZE / WORDLEN);
+    while (src < end) {
+        unsigned int w0 = src[0];
+        unsigned int w1 = src[1];
+        unsigned int w2 = src[2];
+        unsigned int w3 = src[3];
+        unsigned int w4 = src[4];
+        unsigned int w5 = src[5];
+        unsigned int w6 = src[6];
+        unsigned int w7 = src[7];
+        dest[0] = w0;
+        dest[1] = w1;
+        dest[2] = w2;
+        dest[3] = w3;
+        dest[4] = w4;
+        dest[5] = w5;
+        dest[6] = w6;
+        dest[7] = w7;
+        dest += BURSTWORDS;
+        src += BURSTWORDS;
+    }
+}
+
+/* ========================================================================
+ * Function: zeroPage
+ *
+ * Description: Zeroes one page.
+ *
+ * Parameters:
+ *              dest - Address of the page
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void zeroPage(unsigned int *dest) {
+    unsigned int *end = dest + (PAGESIZE / WORDLEN);
+    while (dest < end) {
+        dest[0] = 0;
+        dest[1] = 0;
+        dest[2] = 0;
+        dest[3] = 0;
+        dest[4] = 0;
+        dest[5] = 0;
+        dest[6] = 0;
+        dest[7] = 0;
+        dest += BURSTWORDS;
+    }
+}
@@ -0,0 +1,545 @@
+/******************************* network.c ***********************************
+ *
+ * Module: Network Driver
+ *
+ * Description:
+ * This module drives the network adapters (interrupt line NETWINT) and
+ * gives U-procs two calls: SYS54 (NETSEND) queues a packet for a NIC and
+ * SYS55 (NETRECV) takes the oldest packet a NIC received. Packets travel
+ * in whole frames, the way page messages do, so a U-proc that sends or
+ * receives at a page-aligned page pays for no copies at all.
+ *
+ * Implementation:
+ * Each installed NIC gets a receiver and a transmitter daemon. The
+ * receiver keeps a ring of NETRXRING receive buffers, frames taken off
+ * the free-frame stack (takeTransitFrame) and posted before any packet
+ * arrives. It reads each packet straight into the next posted frame and
+ * hands the filled frame to SYS55, which maps it at the caller's page
+ * (attachUserPage) and posts a fresh frame in the slot it emptied. The
+ * transmitter drains a ring of NETTXRING queued frames: SYS54 detaches
+ * the sender's page (detachUserPage) or copies into a transit frame, and
+ * the transmitter writes the frames back to back, then frees them and
+ * wakes the senders waiting for room once per NETTXBATCH packets, so the
+ * ring and its mutex are touched once per batch instead of per packet.
+ *
+ * Policy Decisions:
+ * - Zero-Copy Receive: A SYS55 buffer that is a whole page-aligned page
+ *   (a2 >= PAGESIZE) has the packet's frame mapped there, dirty; the
+ *   page's old contents are gone. Any other buffer, or a page that cannot
+ *   take the frame (text, shared, busy), gets a copy of as much of the
+ *   packet as fits, and the frame is posted again
+ * - Zero-Copy Send: With NETGIVEPAGE in a3, a page-aligned buffer gives
+ *   its page away, as a page message does: afterwards the page reads back
+ *   its last written-back (or zero-fill) contents. Without it, or if the
+ *   page cannot be detached, the packet is copied into a transit frame
+ * - Frames: Posted and queued frames count against the pin limit. A slot
+ *   left empty when no frame could be had is refilled later (the
+ *   receiver retries every NETRETRY microseconds), so the receive ring
+ *   shrinks under memory pressure instead of evicting pages. SYS54 fails
+ *   with ERROR when it needs a transit frame and none is free
+ * - Flow Control: SYS54 blocks only while the transmit ring is full and
+ *   SYS55 only while no packet has arrived. A receive ring full of
+ *   undelivered packets stops the receiver; the NIC keeps further
+ *   packets queued until SYS55 makes room
+ * - Errors: A failed transmission is recorded and the next SYS54 on that
+ *   NIC returns ERROR. Receive errors drop the packet
+ * - Device Status: A completion may be reported early by a stale V left
+ *   on the device semaphore by an arrival interrupt, so every command
+ *   re-reads the status register and waits again while the NIC is BUSY
+ * - Parameter Validation: A NIC outside 0..DEV_PER_LINE-1, a length
+ *   outside 1..NETPACKETMAX or a buffer outside user space terminates
+ *   the U-proc. A NIC that is not installed makes both calls return ERROR
+ * - Locking: The NIC's device mutex guards its rings and is never held
+ *   across a user memory access; it may be held when swapPoolMutex is
+ *   taken, never the other way round
+ *
+ * Functions:
+ * - initNetwork: Empties the rings and launches each installed NIC's daemons
+ * - netSendSyscallHandler: Implements SYS54 (NETSEND)
+ * - netRecvSyscallHandler: Implements SYS55 (NETRECV)
+ * - netPacketReady: Checks if SYS55 on a NIC would return at once
+ * - netReceiver: Receiver daemon of one NIC
+ * - netTransmitter: Transmitter daemon of one NIC
+ * - netCommand: Runs one NIC command and waits for its completion
+ * - postFrame: Puts a frame in an empty receive slot
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/network.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* waitAny.c */
+extern void notifyWaiters(int kind, int asid, int handle);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int netUp[DEV_PER_LINE];                         /* The NIC is installed and its daemons run */
+HIDDEN int rxFrame[DEV_PER_LINE][NETRXRING];            /* Frame of each receive slot (or NOSWAPFRAME) */
+HIDDEN int rxLength[DEV_PER_LINE][NETRXRING];           /* Length of the packet in each filled slot */
+HIDDEN int rxHead[DEV_PER_LINE];                        /* Slot of the oldest received packet */
+HIDDEN int rxCount[DEV_PER_LINE];                       /* Received packets waiting for SYS55 */
+HIDDEN int rxWaiters[DEV_PER_LINE];                     /* U-procs waiting on rxReady */
+HIDDEN int rxReady[DEV_PER_LINE];                       /* SYS55 waits here for a packet */
+HIDDEN int rxStalled[DEV_PER_LINE];                     /* The receiver is parked on rxSpace */
+HIDDEN int rxSpace[DEV_PER_LINE];                       /* Receiver waits here for an emptied slot */
+HIDDEN int txFrame[DEV_PER_LINE][NETTXRING];            /* Frame of each queued packet */
+HIDDEN int txLength[DEV_PER_LINE][NETTXRING];           /* Length of each queued packet */
+HIDDEN int txHead[DEV_PER_LINE];                        /* Slot of the oldest queued packet */
+HIDDEN int txCount[DEV_PER_LINE];                       /* Packets queued or being sent */
+HIDDEN int txIdle[DEV_PER_LINE];                        /* The transmitter is parked on txData */
+HIDDEN int txData[DEV_PER_LINE];                        /* Transmitter waits here for packets */
+HIDDEN int txWaiters[DEV_PER_LINE];                     /* U-procs waiting on txRoom */
+HIDDEN int txRoom[DEV_PER_LINE];                        /* SYS54 waits here for a free slot */
+HIDDEN int txError[DEV_PER_LINE];                       /* Status of a failed transmission (or READY) */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void netReceiver(int nicNum);
+HIDDEN void netTransmitter(int nicNum);
+HIDDEN int netCommand(int nicNum, int command, memaddr buffer, int length);
+HIDDEN int postFrame(int nicNum, int slot, int frameNum);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initNetwork
+ *
+ * Description: Empties every NIC's rings and, for each installed NIC,
+ *              launches a receiver and a transmitter daemon. The receive
+ *              frames are posted by the receiver once the swap pool is
+ *              up. Called after the device mutexes are set up
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initNetwork() {
+    int i;
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        int slot;
+        for (slot = 0; slot < NETRXRING; slot++) {
+            rxFrame[i][slot] = NOSWAPFRAME;
+        }
+        rxHead[i] = 0;
+        rxCount[i] = 0;
+        rxWaiters[i] = 0;
+        rxReady[i] = 0;
+        rxStalled[i] = FALSE;
+        rxSpace[i] = 0;
+        txHead[i] = 0;
+        txCount[i] = 0;
+        txIdle[i] = FALSE;
+        txData[i] = 0;
+        txWaiters[i] = 0;
+        txRoom[i] = 0;
+        txError[i] = READY;
+        netUp[i] = (DEVDESC(NETWINT, i)->dd_reg->d_status != NOTINSTALLED);
+    }
+
+    /* Launch both daemons of each installed NIC, with its number in a0 */
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        if (!netUp[i]) {
+            continue;
+        }
+        state_t daemonState;
+        daemonState.s_pc = (memaddr)netReceiver;
+        daemonState.s_t9 = (memaddr)netReceiver;
+        daemonState.s_sp = NET_STACK(i);
+        daemonState.s_a0 = i;
+        daemonState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+        daemonState.s_entryHI = 0; /* ASID 0 */
+        SYSCALL(CREATEPROCESS, (int)&daemonState, 0, 0);
+
+        daemonState.s_pc = (memaddr)netTransmitter;
+        daemonState.s_t9 = (memaddr)netTransmitter;
+        daemonState.s_sp = NET_STACK(DEV_PER_LINE + i);
+        SYSCALL(CREATEPROCESS, (int)&daemonState, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: netSendSyscallHandler
+ *
+ * Description: Handles SYS54 (NETSEND). Queues the a2-byte packet at a1
+ *              for NIC a3, waiting while its transmit ring is full. With
+ *              NETGIVEPAGE in a3 and a page-aligned a1 the page's frame
+ *              is queued instead of a copy
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              SUCCESS if the packet is queued, ERROR if the NIC is not
+ *              installed, no transit frame is free or an earlier packet
+ *              on the NIC failed to send
+ * ======================================================================== */
+int netSendSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    char *buffer = (char *)exceptState->s_a1;
+    int length = exceptState->s_a2;
+    int nicNum = exceptState->s_a3 & ~NETGIVEPAGE;
+    int givePage = ((exceptState->s_a3 & NETGIVEPAGE) && !((memaddr)buffer & (PAGESIZE - 1)));
+
+    /* Validate parameters */
+    if ((nicNum < 0) || (nicNum >= DEV_PER_LINE) || (length < 1) || (length > NETPACKETMAX) ||
+        !validateUserAddress((memaddr)buffer) || !validateUserAddress((memaddr)(buffer + length - 1))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    if (!netUp[nicNum]) {
+        return ERROR;
+    }
+
+    /* Take the page's frame, faulting the page in if it is not resident */
+    int frameNum = NOSWAPFRAME;
+    int tries;
+    for (tries = 0; givePage && (frameNum == NOSWAPFRAME) && (tries < MSGRETRIES); tries++) {
+        frameNum = detachUserPage(supportStruct, (memaddr)buffer);
+        if (frameNum == NOSWAPFRAME) {
+            (void)*((volatile char *)buffer);
+        }
+    }
+
+    /* Otherwise copy the packet into a frame of its own */
+    if (frameNum == NOSWAPFRAME) {
+        frameNum = takeTransitFrame();
+        if (frameNum == NOSWAPFRAME) {
+            return ERROR;
+        }
+        char *packet = (char *)FRAMETOADDR(frameNum);
+        int i;
+        for (i = 0; i < length; i++) {
+            packet[i] = buffer[i];
+        }
+    }
+
+    /* Queue it, waiting for room */
+    int *netMutex = DEVDESC(NETWINT, nicNum)->dd_mutex;
+    SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    while (txCount[nicNum] == NETTXRING) {
+        txWaiters[nicNum]++;
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&txRoom[nicNum], 0, 0);
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    }
+    int slot = (txHead[nicNum] + txCount[nicNum]) % NETTXRING;
+    txFrame[nicNum][slot] = frameNum;
+    txLength[nicNum][slot] = length;
+    txCount[nicNum]++;
+    int status = txError[nicNum];
+    txError[nicNum] = READY;
+    if (txIdle[nicNum]) {
+        txIdle[nicNum] = FALSE;
+        SYSCALL(VERHOGEN, (int)&txData[nicNum], 0, 0);
+    }
+    SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+
+    return (status == READY) ? SUCCESS : ERROR;
+}
+
+/* ========================================================================
+ * Function: netRecvSyscallHandler
+ *
+ * Description: Handles SYS55 (NETRECV). Takes the oldest packet NIC a3
+ *              received, waiting for one, into the buffer at a1 of a2
+ *              bytes. A whole page-aligned page has the packet's frame
+ *              mapped there; otherwise as much of the packet as fits is
+ *              copied. The emptied receive slot gets a frame again
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Number of bytes delivered, or ERROR if the NIC is not
+ *              installed
+ * ======================================================================== */
+int netRecvSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    char *buffer = (char *)exceptState->s_a1;
+    int capacity = exceptState->s_a2;
+    int nicNum = exceptState->s_a3;
+
+    /* Validate parameters */
+    if ((nicNum < 0) || (nicNum >= DEV_PER_LINE) || (capacity < 0) ||
+        ((capacity > 0) && (!validateUserAddress((memaddr)buffer) ||
+                            !validateUserAddress((memaddr)(buffer + capacity - 1))))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    if (!netUp[nicNum]) {
+        return ERROR;
+    }
+
+    /* Take the oldest packet, waiting for one */
+    int *netMutex = DEVDESC(NETWINT, nicNum)->dd_mutex;
+    SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    while (rxCount[nicNum] == 0) {
+        rxWaiters[nicNum]++;
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&rxReady[nicNum], 0, 0);
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    }
+    int slot = rxHead[nicNum];
+    int frameNum = rxFrame[nicNum][slot];
+    int length = rxLength[nicNum][slot];
+    rxFrame[nicNum][slot] = NOSWAPFRAME;
+    rxHead[nicNum] = (slot + 1) % NETRXRING;
+    rxCount[nicNum]--;
+    SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+
+    /* Deliver it: map the frame, or copy it and post it again */
+    int delivered = MIN(length, capacity);
+    int refill = frameNum;
+    if ((capacity >= PAGESIZE) && !((memaddr)buffer & (PAGESIZE - 1)) &&
+        attachUserPage(supportStruct, (memaddr)buffer, frameNum)) {
+        refill = takeTransitFrame();
+    } else {
+        char *packet = (char *)FRAMETOADDR(frameNum);
+        int i;
+        for (i = 0; i < delivered; i++) {
+            buffer[i] = packet[i];
+        }
+    }
+
+    /* Post the emptied slot's new frame (the receiver retries if there is none) */
+    if (!postFrame(nicNum, slot, refill) && (refill != NOSWAPFRAME)) {
+        releaseMessageFrame(refill);
+    }
+    return delivered;
+}
+
+/* ========================================================================
+ * Function: netPacketReady
+ *
+ * Description: Checks if a NIC has a received packet, for SYS53
+ *
+ * Parameters:
+ *              nicNum - NIC number (0-7)
+ *
+ * Returns:
+ *              TRUE if SYS55 on the NIC would return at once
+ * ======================================================================== */
+int netPacketReady(int nicNum) {
+    if (!netUp[nicNum]) {
+        return TRUE; /* SYS55 returns ERROR at once */
+    }
+    int *netMutex = DEVDESC(NETWINT, nicNum)->dd_mutex;
+    SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    int ready = (rxCount[nicNum] > 0);
+    SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+    return ready;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: netReceiver
+ *
+ * Description: Receiver daemon for one NIC. Turns on the arrival
+ *              interrupt, then reads each packet into the frame posted in
+ *              the slot after the last received packet and wakes a SYS55
+ *              caller. Sleeps on the arrival interrupt while the NIC has
+ *              nothing queued, and on rxSpace while the ring is full
+ *
+ * Parameters:
+ *              nicNum - NIC number (0-7)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void netReceiver(int nicNum) {
+    devDesc_PTR nic = DEVDESC(NETWINT, nicNum);
+    int *netMutex = nic->dd_mutex;
+    netCommand(nicNum, NETCONFIGURE, NETCONFINT, 0);
+
+    while (TRUE) {
+        /* Find the next slot to fill */
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+        if (rxCount[nicNum] == NETRXRING) {
+            /* Every slot holds a packet: park until SYS55 takes one */
+            rxStalled[nicNum] = TRUE;
+            SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&rxSpace[nicNum], 0, 0);
+            continue;
+        }
+        int slot = (rxHead[nicNum] + rxCount[nicNum]) % NETRXRING;
+        int frameNum = rxFrame[nicNum][slot];
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+
+        /* Post a frame there if it lost its own */
+        if (frameNum == NOSWAPFRAME) {
+            frameNum = takeTransitFrame();
+            if (frameNum == NOSWAPFRAME) {
+                cpu_t currTime;
+                STCK(currTime);
+                SYSCALL(WAITUNTIL, (int)(currTime + NETRETRY), 0, 0);
+            } else if (!postFrame(nicNum, slot, frameNum)) {
+                releaseMessageFrame(frameNum);
+            }
+            continue;
+        }
+
+        /* Read the next packet straight into the frame */
+        int status = netCommand(nicNum, NETREADNET, FRAMETOADDR(frameNum), 0);
+        int length = nic->dd_reg->d_data1;
+        if ((status & NETSTATUSMASK) != READY) {
+            continue; /* Drop it */
+        }
+        if (length <= 0) {
+            /* Nothing queued: sleep until a packet arrives */
+            setInterrupts(OFF);
+            if (!(nic->dd_reg->d_status & NETREADPENDING)) {
+                SYSCALL(WAITIO, NETWINT, nicNum, 0);
+            }
+            setInterrupts(ON);
+            continue;
+        }
+
+        /* Hand it to SYS55 */
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+        rxLength[nicNum][slot] = MIN(length, NETPACKETMAX);
+        rxCount[nicNum]++;
+        if (rxWaiters[nicNum] > 0) {
+            rxWaiters[nicNum]--;
+            SYSCALL(VERHOGEN, (int)&rxReady[nicNum], 0, 0);
+        }
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+        notifyWaiters(WAITNET, 0, nicNum);
+    }
+}
+
+/* ========================================================================
+ * Function: netTransmitter
+ *
+ * Description: Transmitter daemon for one NIC. Sends up to NETTXBATCH
+ *              queued packets back to back, then frees their frames and
+ *              slots and wakes the SYS54 callers waiting for room in one
+ *              pass. Parks on txData while the ring is empty
+ *
+ * Parameters:
+ *              nicNum - NIC number (0-7)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void netTransmitter(int nicNum) {
+    int *netMutex = DEVDESC(NETWINT, nicNum)->dd_mutex;
+
+    while (TRUE) {
+        /* Take the next batch */
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+        if (txCount[nicNum] == 0) {
+            /* Nothing to send: park until a SYS54 fills the ring */
+            txIdle[nicNum] = TRUE;
+            SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&txData[nicNum], 0, 0);
+            continue;
+        }
+        int batch = MIN(txCount[nicNum], NETTXBATCH);
+        int frames[NETTXBATCH];
+        int lengths[NETTXBATCH];
+        int i;
+        for (i = 0; i < batch; i++) {
+            int slot = (txHead[nicNum] + i) % NETTXRING;
+            frames[i] = txFrame[nicNum][slot];
+            lengths[i] = txLength[nicNum][slot];
+        }
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+
+        /* Send it, keeping the first failure */
+        int failure = READY;
+        for (i = 0; i < batch; i++) {
+            int status = netCommand(nicNum, NETWRITENET, FRAMETOADDR(frames[i]), lengths[i]);
+            if (((status & NETSTATUSMASK) != READY) && (failure == READY)) {
+                failure = status & NETSTATUSMASK;
+            }
+        }
+        for (i = 0; i < batch; i++) {
+            releaseMessageFrame(frames[i]);
+        }
+
+        /* Complete the whole batch at once */
+        SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+        txHead[nicNum] = (txHead[nicNum] + batch) % NETTXRING;
+        txCount[nicNum] -= batch;
+        if (failure != READY) {
+            txError[nicNum] = failure;
+        }
+        for (i = 0; (i < batch) && (txWaiters[nicNum] > 0); i++) {
+            txWaiters[nicNum]--;
+            SYSCALL(VERHOGEN, (int)&txRoom[nicNum], 0, 0);
+        }
+        SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: netCommand
+ *
+ * Description: Issues a command to a NIC and waits for it to complete.
+ *              Waits again while the NIC still reports BUSY, since a
+ *              stale V from an arrival interrupt ends a WAITIO early
+ *
+ * Parameters:
+ *              nicNum - NIC number (0-7)
+ *              command - NETREADNET, NETWRITENET or NETCONFIGURE
+ *              buffer - DATA0: physical buffer address or configuration
+ *              length - DATA1: bytes to send (0 otherwise)
+ *
+ * Returns:
+ *              The completion status
+ * ======================================================================== */
+int netCommand(int nicNum, int command, memaddr buffer, int length) {
+    device_t *nicReg = DEVDESC(NETWINT, nicNum)->dd_reg;
+
+    /* Atomically issue the command and wait for it */
+    setInterrupts(OFF);
+    nicReg->d_data0 = buffer;
+    nicReg->d_data1 = length;
+    nicReg->d_command = command;
+    int status = SYSCALL(WAITIO, NETWINT, nicNum, 0);
+    while ((nicReg->d_status & NETSTATUSMASK) == BUSY) {
+        status = SYSCALL(WAITIO, NETWINT, nicNum, 0);
+    }
+    setInterrupts(ON);
+    return status;
+}
+
+/* ========================================================================
+ * Function: postFrame
+ *
+ * Description: Puts a frame in an empty receive slot and wakes the
+ *              receiver if it parked on a full ring
+ *
+ * Parameters:
+ *              nicNum - NIC number (0-7)
+ *              slot - The receive slot
+ *              frameNum - Frame to post there (NOSWAPFRAME only wakes)
+ *
+ * Returns:
+ *              TRUE if posted, FALSE if the slot already has a frame
+ * ======================================================================== */
+int postFrame(int nicNum, int slot, int frameNum) {
+    int *netMutex = DEVDESC(NETWINT, nicNum)->dd_mutex;
+    SYSCALL(PASSEREN, (int)netMutex, 0, 0);
+    int posted = (rxFrame[nicNum][slot] == NOSWAPFRAME);
+    if (posted) {
+        rxFrame[nicNum][slot] = frameNum;
+    }
+    if (rxStalled[nicNum]) {
+        rxStalled[nicNum] = FALSE;
+        SYSCALL(VERHOGEN, (int)&rxSpace[nicNum], 0, 0);
+    }
+    SYSCALL(VERHOGEN, (int)netMutex, 0, 0);
+    return posted;
+}
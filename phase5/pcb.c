@@ -23,9 +23,12 @@
 * Helpers:
 *
 * resetPcb      -   Reset a PCB to its initial values
+* growPcbs      -   Carve a fresh kernel frame into free PCBs
 *
 * We implement operations for a circular DLL queue.
 * The free list of PCBs is implemented as a circular DLL.
+* It starts with the MAXPROC static PCBs and grows one slab frame at a
+* time when it runs dry, so MAXPROC no longer caps the process count.
 * The child list of a parent is implemented as a circular DLL.
 *
 *****************************************************************************/
@@ -35,10 +38,12 @@
 
 
 #include "../h/pcb.h"
+#include "../h/slab.h"
 
 
 /******************** Hidden Helper Function Declarations *********************/
 HIDDEN void resetPcb(pcb_PTR p);        /* Reset a PCB to its initial values */ 
+HIDDEN void growPcbs();                 /* Carve a kernel frame into free PCBs */
 
 
 /******************** Hidden Global Variables **********************/
@@ -82,6 +87,8 @@ void freePcb(pcb_PTR p) {
  *               Pointer to the allocated PCB
  * ======================================================================== */
 pcb_PTR allocPcb() {
+    if (pcbFreeTail == NULL)
+        growPcbs();
     if (pcbFreeTail == NULL)
         return NULL;
     
@@ -435,6 +442,65 @@ HIDDEN void resetPcb(pcb_PTR p) {
         p->p_s.s_reg[i] = 0;
     
     p->p_semAdd         = NULL;
+    p->p_semd           = NULL;
     p->p_supportStruct  = NULL;
     p->p_time           = 0;
+
+    /* New processes start at the highest scheduling level */
+    p->priority         = HIGHESTLEVEL;
+    p->earlyExits       = 0;
+    p->p_readyLevel     = NOTREADY;
+    p->p_basePriority   = NOBOOST;
+    p->p_readyCPU       = BOOTCPU;
+    p->p_lastCPU        = BOOTCPU;
+    p->p_killed         = FALSE;
+
+    /* Stride scheduling starts every process with the default share */
+    p->p_tickets        = DEFAULTTICKETS;
+    p->p_pass           = 0;
+    p->p_passTime       = 0;
+    p->p_groupTime      = 0;
+
+    /* Clear the CPU time breakdown */
+    p->p_userTime       = 0;
+    p->p_supportTime    = 0;
+    p->p_kernelTime     = 0;
+    p->p_blockedTime    = 0;
+    p->p_blockStart     = 0;
+
+    /* No pending interrupt wake-up */
+    p->p_wakeLine       = NOLINE;
+    p->p_irqTOD         = 0;
+    p->p_wakeTOD        = 0;
+
+    /* Not on the timer wheel */
+    p->p_timerNext      = mkEmptyProcQ();
+    p->p_timerPrev      = mkEmptyProcQ();
+    p->p_timerSlot      = NOSLOT;
+    p->p_deadline       = 0;
+}
+
+/* ========================================================================
+ * Function: growPcbs
+ *
+ * Description: Takes a kernel frame from the slab and adds every PCB that
+ *              fits in it to the free list. Does nothing if RAM is exhausted.
+ * 
+ * Parameters:
+ *               None
+ * 
+ * Returns:
+ *               None
+ * ======================================================================== */
+HIDDEN void growPcbs() {
+    memaddr frame = allocSlabFrame();
+    if (frame == NOFRAME)
+        return;
+
+    pcb_PTR slab = (pcb_PTR) frame;
+    int i;
+    for (i = 0; i < (int)(PAGESIZE / sizeof(pcb_t)); i++) {
+        resetPcb(&slab[i]);
+        insertProcQ(&pcbFreeTail, &slab[i]);
+    }
 }
@@ -0,0 +1,260 @@
+/******************************* printerSpooler.c *****************************
+ *
+ * Module: Printer Spooler
+ *
+ * Description:
+ * This module spools printer output so SYS11 does not hold a U-proc for a
+ * device round trip per character. Each printer has a spool ring of
+ * PRINTSPOOLSIZE characters in kernel memory; SYS11 copies its string into
+ * the spool and returns, and a spool daemon per installed printer (on its
+ * own small stack) prints the spooled characters one WAITIO at a time.
+ *
+ * Policy Decisions:
+ * - Blocking: SYS11 only blocks while its printer's spool is full, and is
+ *   woken as the daemon frees space. A string longer than the free space
+ *   is spooled in pieces, in order
+ * - Mutual Exclusion: The printer's device mutex now guards its spool;
+ *   only the spool daemon touches the device. It is held while copying
+ *   from user memory, which may page fault (the pager never takes it)
+ * - Spool Size: The spool is a kernel memory ring several strings deep
+ *   rather than a backing store region; a print job that outgrows it
+ *   throttles its producer instead of spilling to flash or disk
+ * - Errors: A failed print drops that character and is recorded; the next
+ *   SYS11 on the printer returns its negative status and spools nothing
+ * - Draining: test() calls drainPrinters before terminating, so spooled
+ *   output is not lost when the daemons go down with it
+ *
+ * Functions:
+ * - initPrinters: Empties the spools and launches the spool daemons
+ * - spoolPrinterOutput: Copies a SYS11 string into a printer's spool
+ * - drainPrinters: Waits until every spool has been printed
+ * - printerDaemon: Spool daemon printing one printer's spool
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/printerSpooler.h"
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN char spool[DEV_PER_LINE][PRINTSPOOLSIZE];    /* Spool ring of each printer */
+HIDDEN int spoolHead[DEV_PER_LINE];                 /* Index of the next character to print */
+HIDDEN int spoolCount[DEV_PER_LINE];                /* Characters waiting in the spool */
+HIDDEN int daemonIdle[DEV_PER_LINE];                /* The daemon is parked on spoolData */
+HIDDEN int spoolData[DEV_PER_LINE];                 /* Daemon waits here for characters */
+HIDDEN int spoolWaiters[DEV_PER_LINE];              /* U-procs waiting for spool space */
+HIDDEN int spoolSpace[DEV_PER_LINE];                /* They wait here */
+HIDDEN int printDrainWaiting[DEV_PER_LINE];         /* test() is waiting for the spool to empty */
+HIDDEN int printDrainSem[DEV_PER_LINE];             /* It waits here */
+HIDDEN int printError[DEV_PER_LINE];                /* Last failed print status (READY if none) */
+HIDDEN int printerInstalled[DEV_PER_LINE];          /* A spool daemon serves the printer */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void printerDaemon(int printNum);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initPrinters
+ *
+ * Description: Empties every spool and, with PRINTSPOOLED set, launches
+ *              one spool daemon per installed printer. Called after the
+ *              device mutexes are set up
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initPrinters() {
+    int i;
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        spoolHead[i] = 0;
+        spoolCount[i] = 0;
+        daemonIdle[i] = FALSE;
+        spoolData[i] = 0;
+        spoolWaiters[i] = 0;
+        spoolSpace[i] = 0;
+        printDrainWaiting[i] = FALSE;
+        printDrainSem[i] = 0;
+        printError[i] = READY;
+        printerInstalled[i] = FALSE;
+    }
+
+    /* Launch a daemon for each installed printer, on the stacks after the terminal daemons' */
+    if (PRINTSPOOLED) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            if (DEVDESC(PRNTINT, i)->dd_reg->d_status == NOTINSTALLED) {
+                continue;
+            }
+            printerInstalled[i] = TRUE;
+            state_t daemonState;
+            daemonState.s_pc = (memaddr)printerDaemon;
+            daemonState.s_t9 = (memaddr)printerDaemon;
+            daemonState.s_sp = TERM_STACK((2 * DEV_PER_LINE) + i);
+            daemonState.s_a0 = i;
+            daemonState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+            daemonState.s_entryHI = 0; /* ASID 0 */
+            SYSCALL(CREATEPROCESS, (int)&daemonState, 0, 0);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: spoolPrinterOutput
+ *
+ * Description: Copies a string into a printer's spool, waiting for space
+ *              as needed, and wakes the spool daemon
+ *
+ * Parameters:
+ *              printNum - Printer number (0-7)
+ *              charAddress - User address of the string (already validated)
+ *              length - Length of the string (any, for SYS41)
+ *
+ * Returns:
+ *              length once it is all spooled, or the negative status of
+ *              an earlier failed print (or of an absent printer)
+ * ======================================================================== */
+int spoolPrinterOutput(int printNum, char *charAddress, int length) {
+    int *spoolMutex = DEVDESC(PRNTINT, printNum)->dd_mutex;
+
+    /* No daemon would ever print it */
+    if (!printerInstalled[printNum]) {
+        return -NOTINSTALLED;
+    }
+
+    /* Gain spool mutual exclusion */
+    SYSCALL(PASSEREN, (int)spoolMutex, 0, 0);
+
+    /* Report an error the daemon ran into */
+    if (printError[printNum] != READY) {
+        int status = printError[printNum];
+        printError[printNum] = READY;
+        SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+        return -status;
+    }
+
+    int index = 0;
+    while (index < length) {
+        if (spoolCount[printNum] == PRINTSPOOLSIZE) {
+            /* Spool full: wait for the daemon to free space */
+            spoolWaiters[printNum]++;
+            SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&spoolSpace[printNum], 0, 0);
+            SYSCALL(PASSEREN, (int)spoolMutex, 0, 0);
+            continue;
+        }
+
+        /* Append as much as fits */
+        while ((index < length) && (spoolCount[printNum] < PRINTSPOOLSIZE)) {
+            spool[printNum][(spoolHead[printNum] + spoolCount[printNum]) % PRINTSPOOLSIZE] = charAddress[index];
+            spoolCount[printNum]++;
+            index++;
+        }
+        if (daemonIdle[printNum]) {
+            daemonIdle[printNum] = FALSE;
+            SYSCALL(VERHOGEN, (int)&spoolData[printNum], 0, 0);
+        }
+    }
+
+    /* Release spool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+    return index;
+}
+
+/* ========================================================================
+ * Function: drainPrinters
+ *
+ * Description: Waits until every printer's spool daemon has printed all
+ *              spooled output
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void drainPrinters() {
+    if (!PRINTSPOOLED) {
+        return;
+    }
+    int i;
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        int *spoolMutex = DEVDESC(PRNTINT, i)->dd_mutex;
+        SYSCALL(PASSEREN, (int)spoolMutex, 0, 0);
+        if (spoolCount[i] > 0) {
+            printDrainWaiting[i] = TRUE;
+            SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&printDrainSem[i], 0, 0);
+        } else {
+            SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: printerDaemon
+ *
+ * Description: Spool daemon for one printer. Prints the spool's oldest
+ *              character, then takes it off the spool, waking one U-proc
+ *              waiting for space and, once the spool is empty, test() if
+ *              it is draining. Parks on spoolData while the spool is empty
+ *
+ * Parameters:
+ *              printNum - Printer number (0-7)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void printerDaemon(int printNum) {
+    devDesc_PTR printer = DEVDESC(PRNTINT, printNum);
+    int *spoolMutex = printer->dd_mutex;
+
+    while (TRUE) {
+        SYSCALL(PASSEREN, (int)spoolMutex, 0, 0);
+        if (spoolCount[printNum] == 0) {
+            /* Nothing to print: park until a SYS11 fills the spool */
+            daemonIdle[printNum] = TRUE;
+            SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&spoolData[printNum], 0, 0);
+            continue;
+        }
+        char nextChar = spool[printNum][spoolHead[printNum]];
+        SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+
+        printer->dd_reg->d_data0 = nextChar; /* Character to write */
+
+        /* Atomically write a character to the printer device */
+        setInterrupts(OFF);
+        printer->dd_reg->d_command = PRINTCHR;
+        int status = SYSCALL(WAITIO, PRNTINT, printNum, 0);
+        setInterrupts(ON);
+
+        SYSCALL(PASSEREN, (int)spoolMutex, 0, 0);
+        if (status != READY) { /* Write failed */
+            printError[printNum] = status;
+        }
+        spoolHead[printNum] = (spoolHead[printNum] + 1) % PRINTSPOOLSIZE;
+        spoolCount[printNum]--;
+        if (spoolWaiters[printNum] > 0) {
+            spoolWaiters[printNum]--;
+            SYSCALL(VERHOGEN, (int)&spoolSpace[printNum], 0, 0);
+        }
+        if ((spoolCount[printNum] == 0) && printDrainWaiting[printNum]) {
+            printDrainWaiting[printNum] = FALSE;
+            SYSCALL(VERHOGEN, (int)&printDrainSem[printNum], 0, 0);
+        }
+        SYSCALL(VERHOGEN, (int)spoolMutex, 0, 0);
+    }
+}
@@ -0,0 +1,226 @@
+/******************************* profiler.c *************************************
+ *
+ * Module: PC Sampling Profiler
+ *
+ * Description:
+ * This module keeps a histogram of program counter samples for each ASID,
+ * so hot spots in user code can be found without instrumenting the
+ * binaries. A U-proc starts, stops and reads its own profile with SYS33.
+ *
+ * Implementation:
+ * handlePLT samples the PC of the process it interrupts. Without an
+ * interval that happens only when the quantum expires. With an interval,
+ * loadProcessState sets the PLT to at most that interval and banks the
+ * rest of the quantum here; the next kernel entry takes the bank back
+ * (profileBanked), so quantum accounting is unchanged, and a PLT interrupt
+ * that leaves quantum over is a sample only: the process keeps running.
+ * A PC in [KUSEG, KUSEG + (PROFBUCKETS << PROFSHIFT)) counts in its
+ * bucket, any other PC (support level code, the stack) in ph_other.
+ *
+ * Functions:
+ * - initProfiler: Stops and empties every profile.
+ * - startProfile: Empties an ASID's profile and starts sampling it.
+ * - stopProfile: Stops sampling an ASID.
+ * - readProfile: Copies out an ASID's profile.
+ * - profileSample: Records the PC of a process if its ASID is sampled.
+ * - profileTimer: Returns the PLT value for a quantum, banking the rest.
+ * - profileBanked: Takes back the quantum banked past the PLT.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/profiler.h"
+#include "../h/initial.h"          /* For currentProcess */
+
+/******************** Module Variables ********************/
+HIDDEN profHist_t profiles[MAXUPROC + 1];       /* Profile of each ASID (0 unused) */
+HIDDEN int profiling[MAXUPROC + 1];             /* The ASID is being sampled */
+HIDDEN unsigned int sampleInterval[MAXUPROC + 1]; /* Its interval (0 for quantum expiry only) */
+HIDDEN unsigned int quantumBank[MAXCPUS];       /* Quantum each processor held back from its PLT */
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initProfiler
+ *
+ * Description: Stops and empties every profile.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initProfiler() {
+    int asid;
+    for (asid = 0; asid <= MAXUPROC; asid++) {
+        profiling[asid] = FALSE;
+        sampleInterval[asid] = 0;
+    }
+    int cpu;
+    for (cpu = 0; cpu < MAXCPUS; cpu++) {
+        quantumBank[cpu] = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: startProfile
+ *
+ * Description: Empties an ASID's profile and starts sampling it, at the
+ *              given interval or only on quantum expiry. The interval
+ *              takes effect from the ASID's next dispatch.
+ *
+ * Parameters:
+ *              asid - ASID to sample (1..MAXUPROC)
+ *              interval - Sampling interval (us), 0 for quantum expiry only
+ *
+ * Returns:
+ *              0 on success, -1 if the ASID or interval is invalid
+ * ======================================================================== */
+int startProfile(int asid, unsigned int interval) {
+    if (!PROFILING || (asid < 1) || (asid > MAXUPROC) ||
+        ((interval != 0) && (interval < PROFMININTERVAL))) {
+        return -1;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    profiles[asid].ph_samples = 0;
+    profiles[asid].ph_other = 0;
+    int bucket;
+    for (bucket = 0; bucket < PROFBUCKETS; bucket++) {
+        profiles[asid].ph_count[bucket] = 0;
+    }
+    sampleInterval[asid] = interval;
+    profiling[asid] = TRUE;
+    setSTATUS(status);
+    return 0;
+}
+
+/* ========================================================================
+ * Function: stopProfile
+ *
+ * Description: Stops sampling an ASID. Its profile is kept for reading.
+ *
+ * Parameters:
+ *              asid - ASID to stop sampling
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void stopProfile(int asid) {
+    if ((asid >= 1) && (asid <= MAXUPROC)) {
+        profiling[asid] = FALSE;
+    }
+}
+
+/* ========================================================================
+ * Function: readProfile
+ *
+ * Description: Copies an ASID's profile into buffer with interrupts off,
+ *              so the snapshot is consistent. Sampling goes on.
+ *
+ * Parameters:
+ *              asid - ASID of the profile
+ *              buffer - Destination profile (in kernel memory)
+ *
+ * Returns:
+ *              Number of samples taken, -1 if the ASID is invalid
+ * ======================================================================== */
+int readProfile(int asid, profHist_PTR buffer) {
+    if ((asid < 1) || (asid > MAXUPROC)) {
+        return -1;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    buffer->ph_samples = profiles[asid].ph_samples;
+    buffer->ph_other = profiles[asid].ph_other;
+    int bucket;
+    for (bucket = 0; bucket < PROFBUCKETS; bucket++) {
+        buffer->ph_count[bucket] = profiles[asid].ph_count[bucket];
+    }
+    setSTATUS(status);
+    return buffer->ph_samples;
+}
+
+/* ========================================================================
+ * Function: profileSample
+ *
+ * Description: Counts the saved PC of a process in its ASID's profile if
+ *              that ASID is being sampled. Called by handlePLT.
+ *
+ * Parameters:
+ *              p - Process interrupted by the PLT
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void profileSample(pcb_PTR p) {
+    if (!PROFILING || (p->p_supportStruct == NULL)) {
+        return;
+    }
+    int asid = p->p_supportStruct->sup_asid;
+    if (!profiling[asid]) {
+        return;
+    }
+
+    profHist_PTR profile = &profiles[asid];
+    memaddr offset = p->p_s.s_pc - KUSEG;
+    profile->ph_samples++;
+    if ((p->p_s.s_pc >= KUSEG) && ((offset >> PROFSHIFT) < PROFBUCKETS)) {
+        profile->ph_count[offset >> PROFSHIFT]++;
+    } else {
+        profile->ph_other++;
+    }
+}
+
+/* ========================================================================
+ * Function: profileTimer
+ *
+ * Description: Returns the value for the PLT when the current process is
+ *              loaded with a quantum. If its ASID is sampled at an interval
+ *              shorter than the quantum, the PLT gets the interval and the
+ *              rest of the quantum is banked for profileBanked.
+ *
+ * Parameters:
+ *              quantum - Quantum the process is loaded with
+ *
+ * Returns:
+ *              Value to set the PLT to
+ * ======================================================================== */
+unsigned int profileTimer(unsigned int quantum) {
+    quantumBank[CPUID()] = 0;
+    if (!PROFILING || (currentProcess->p_supportStruct == NULL)) {
+        return quantum;
+    }
+
+    int asid = currentProcess->p_supportStruct->sup_asid;
+    unsigned int interval = sampleInterval[asid];
+    if (profiling[asid] && (interval != 0) && (quantum > interval)) {
+        quantumBank[CPUID()] = quantum - interval;
+        return interval;
+    }
+    return quantum;
+}
+
+/* ========================================================================
+ * Function: profileBanked
+ *
+ * Description: Returns and clears the quantum banked by profileTimer.
+ *              Called on kernel entry, where it is added to the PLT value
+ *              to give the quantum really left.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              Quantum banked past the PLT (0 if none)
+ * ======================================================================== */
+unsigned int profileBanked() {
+    unsigned int banked = quantumBank[CPUID()];
+    quantumBank[CPUID()] = 0;
+    return banked;
+}
@@ -0,0 +1,226 @@
+/******************************* reaper.c ************************************
+ *
+ * Module: Exit Records
+ *
+ * Description:
+ * This module keeps a record of every U-proc termination, so a supervisor
+ * learns which U-proc ended, why, and what it used instead of only that
+ * something finished. terminateUProcess queues the record of the U-proc
+ * it terminates; SYS44 takes the oldest queued record, blocking until
+ * there is one unless REAPNOWAIT is set in a2.
+ *
+ * A record holds the ASID, the exit reason (EXITSYS9 for SYS9, EXITTRAP
+ * for a trap or bad SYSCALL arguments), the CPU time the U-proc used, and
+ * with PERFSTATS set the page faults it took and the device operations it
+ * waited for (taken from its performance counter block).
+ *
+ * Policy Decisions:
+ * - Queue: Up to EXITRECORDS records wait in a ring; when it is full the
+ *   oldest one is dropped, so a termination never blocks on a supervisor
+ *   that does not reap. exitSem counts the queued records
+ * - Last Exit: The latest record of each ASID is also kept apart from the
+ *   queue, so test() can report every exit at shutdown whether or not it
+ *   was reaped
+ * - Locking: The ring is only touched with interrupts off, and never
+ *   across a user memory access
+ *
+ * Functions:
+ * - initReaper: Empties the exit record queue
+ * - recordExit: Queues the exit record of the terminating U-proc
+ * - readExit: Copies out an ASID's last exit record
+ * - reapSyscallHandler: Implements SYS44 (REAP)
+ * - copyExitRecord: Copies one exit record
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/reaper.h"
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN exitRecord_t exitQueue[EXITRECORDS];     /* Records not reaped yet, oldest at exitHead */
+HIDDEN int exitHead;                            /* Slot of the oldest queued record */
+HIDDEN int exitCount;                           /* Records queued */
+HIDDEN int exitSem;                             /* Semaphore counting queued records */
+HIDDEN exitRecord_t lastExit[MAXUPROC + 1];     /* Latest record of each ASID */
+HIDDEN int exited[MAXUPROC + 1];                /* The ASID has a record in lastExit */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void copyExitRecord(exitRecord_PTR src, exitRecord_PTR dest);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initReaper
+ *
+ * Description: Empties the exit record queue and forgets every exit
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initReaper() {
+    exitHead = 0;
+    exitCount = 0;
+    exitSem = 0;
+    int asid;
+    for (asid = 0; asid <= MAXUPROC; asid++) {
+        exited[asid] = FALSE;
+    }
+}
+
+/* ========================================================================
+ * Function: recordExit
+ *
+ * Description: Builds the exit record of the current U-proc and queues
+ *              it, dropping the oldest record if the queue is full. Called
+ *              by terminateUProcess while the U-proc still runs, so its CPU
+ *              time is still readable.
+ *
+ * Parameters:
+ *              asid - ASID of the terminating U-proc
+ *              reason - EXITSYS9 or EXITTRAP
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void recordExit(int asid, int reason) {
+    exitRecord_t record;
+    record.er_asid = asid;
+    record.er_reason = reason;
+    record.er_cpuTime = SYSCALL(GETCPUTIME, 0, 0, 0);
+    record.er_faults = 0;
+    record.er_ioCount = 0;
+
+    perfBlock_t block;
+    if (PERFSTATS && (readPerf(asid, &block) >= 0)) {
+        record.er_faults = block.pb_count[PERF_PAGEFAULT];
+        int i;
+        for (i = 0; i < DEVICE_COUNT; i++) {
+            record.er_ioCount += block.pb_count[PERF_DEVICE + i];
+        }
+    }
+
+    setInterrupts(OFF);
+    copyExitRecord(&record, &lastExit[asid]);
+    exited[asid] = TRUE;
+    int wake = (exitCount < EXITRECORDS);
+    if (wake) {
+        copyExitRecord(&record, &exitQueue[(exitHead + exitCount) % EXITRECORDS]);
+        exitCount++;
+    } else {
+        /* Full: the newest record takes the oldest one's slot */
+        copyExitRecord(&record, &exitQueue[exitHead]);
+        exitHead = (exitHead + 1) % EXITRECORDS;
+    }
+    setInterrupts(ON);
+
+    if (wake) {
+        SYSCALL(VERHOGEN, (int)&exitSem, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: readExit
+ *
+ * Description: Copies the latest exit record of an ASID, reaped or not
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              buffer - Destination record (in kernel memory)
+ *
+ * Returns:
+ *              TRUE if the ASID has exited, else FALSE
+ * ======================================================================== */
+int readExit(int asid, exitRecord_PTR buffer) {
+    if ((asid < 1) || (asid > MAXUPROC)) {
+        return FALSE;
+    }
+
+    setInterrupts(OFF);
+    int found = exited[asid];
+    if (found) {
+        copyExitRecord(&lastExit[asid], buffer);
+    }
+    setInterrupts(ON);
+    return found;
+}
+
+/* ========================================================================
+ * Function: reapSyscallHandler
+ *
+ * Description: Implements SYS44: takes the oldest queued exit record and
+ *              copies it to the caller's buffer (validated by the dispatch
+ *              table). Waits for an exit unless REAPNOWAIT is set.
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *                              (a1: record buffer, a2: flags)
+ *
+ * Returns:
+ *              The ASID reaped, ERROR if REAPNOWAIT is set and no record
+ *              is queued
+ * ======================================================================== */
+int reapSyscallHandler(support_PTR supportStruct) {
+    state_PTR exceptState = &supportStruct->sup_exceptState[GENERALEXCEPT];
+    exitRecord_PTR buffer = (exitRecord_PTR)exceptState->s_a1;
+    int flags = exceptState->s_a2;
+
+    if (flags & REAPNOWAIT) {
+        /* Take a unit of exitSem only if one is there */
+        setInterrupts(OFF);
+        int queued = (exitSem > 0);
+        if (queued) {
+            exitSem--;
+        }
+        setInterrupts(ON);
+        if (!queued) {
+            return ERROR;
+        }
+    } else {
+        SYSCALL(PASSEREN, (int)&exitSem, 0, 0);
+    }
+
+    exitRecord_t record;
+    setInterrupts(OFF);
+    copyExitRecord(&exitQueue[exitHead], &record);
+    exitHead = (exitHead + 1) % EXITRECORDS;
+    exitCount--;
+    setInterrupts(ON);
+
+    /* The copy out may fault, so it is done with interrupts on */
+    copyExitRecord(&record, buffer);
+    return record.er_asid;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: copyExitRecord
+ *
+ * Description: Copies one exit record field by field
+ *
+ * Parameters:
+ *              src - Record to copy
+ *              dest - Destination record
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void copyExitRecord(exitRecord_PTR src, exitRecord_PTR dest) {
+    dest->er_asid = src->er_asid;
+    dest->er_reason = src->er_reason;
+    dest->er_cpuTime = src->er_cpuTime;
+    dest->er_faults = src->er_faults;
+    dest->er_ioCount = src->er_ioCount;
+}
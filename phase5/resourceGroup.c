@@ -0,0 +1,287 @@
+/******************************* resourceGroup.c *************************************
+ *
+ * Module: Resource Groups
+ *
+ * Description:
+ * This module puts every U-proc in one of RGROUPS resource groups when it
+ * is created (a clone joins its parent's) and keeps the limits that isolate
+ * the groups from each other: a share of the CPU, a most resident frames
+ * and an I/O weight. The scheduler, the pager and the device queues each
+ * enforce one of them, and SYS58 reports a group's limits and usage.
+ *
+ * Implementation:
+ * The group table is constant; RGDEFAULT has no limits, so a U-proc left
+ * in it is scheduled, paged and queued exactly as without groups.
+ * - CPU: The scheduler calls chargeGroup whenever it makes a process
+ *   ready. The CPU time the process used since its last charge is added to
+ *   its group, and once a group's members used more than rg_cpuShare
+ *   percent of the GROUPPERIOD (times CPUCOUNT) the group is over its
+ *   share: under MLFQ its members are queued on the lowest level until the
+ *   period ends, so they run only on time the other groups leave. Under
+ *   stride scheduling the tickets of each member (groupTickets) are scaled
+ *   by the share instead.
+ * - Memory: A U-proc whose group holds rg_maxFrames frames replaces a frame
+ *   of the group's own on a page fault (reuseFrame), even with free frames
+ *   in the pool.
+ * - I/O: A member starts with the weight rg_ioWeight in the device queues'
+ *   deficit round robin (resetIOShare), and SYS57 can not raise it higher.
+ *
+ * Functions:
+ * - initResourceGroups: Empties every group and starts the first period.
+ * - joinGroup: Puts a new U-proc in a group.
+ * - leaveGroup: Takes a terminated U-proc out of its group.
+ * - groupOf: Returns the group of an ASID.
+ * - groupTickets: Scales stride tickets by an ASID's group CPU share.
+ * - groupFrameLimit: Returns the resident frame limit of an ASID's group.
+ * - groupIOWeight: Returns the I/O weight of an ASID's group.
+ * - chargeGroup: Charges a process's CPU time to its group.
+ * - readGroupStats: Copies out a group's limits and usage.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/resourceGroup.h"
+#include "../h/trace.h"
+
+/******************** External Functions ********************/
+/* vmSupport.c */
+extern int groupResident(int group);
+/* deviceSupportDMA.c */
+extern void readIOShare(int asid, ioShare_PTR share);
+
+/******************** Module Variables ********************/
+/* The limits of each group: CPU share (percent), resident frames, I/O weight */
+HIDDEN const resourceGroup_t groupLimits[RGROUPS] = {
+    {100, RGNOLIMIT, DEFAULTIOWEIGHT},      /* RGDEFAULT: no limits */
+    {100, RGNOLIMIT, 4},                    /* Latency-sensitive tenants: four times the I/O weight */
+    {50, 16, DEFAULTIOWEIGHT},              /* Batch tenants: half the CPU and 16 frames */
+    {25, 8, DEFAULTIOWEIGHT}                /* Background tenants: a quarter of the CPU and 8 frames */
+};
+HIDDEN int asidGroup[MAXUPROC + 1];         /* Group of each ASID (NOGROUP if none) */
+HIDDEN int groupMembers[RGROUPS];           /* Live U-procs in each group */
+HIDDEN int groupThrottled[RGROUPS];         /* Times a member was made ready over the share */
+HIDDEN cpu_t groupCpuTime[RGROUPS];         /* CPU time charged to each group since boot */
+HIDDEN cpu_t groupPeriodTime[RGROUPS];      /* CPU time charged to each group this period */
+HIDDEN cpu_t periodStart;                   /* TOD the current GROUPPERIOD began at */
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initResourceGroups
+ *
+ * Description: Takes every ASID out of the groups, empties their usage
+ *              and starts the first period.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initResourceGroups() {
+    int i;
+    for (i = 0; i <= MAXUPROC; i++) {
+        asidGroup[i] = NOGROUP;
+    }
+    for (i = 0; i < RGROUPS; i++) {
+        groupMembers[i] = 0;
+        groupThrottled[i] = 0;
+        groupCpuTime[i] = 0;
+        groupPeriodTime[i] = 0;
+    }
+    STCK(periodStart);
+}
+
+/* ========================================================================
+ * Function: joinGroup
+ *
+ * Description: Puts a new U-proc in a group, RGDEFAULT if the group number
+ *              is invalid.
+ *
+ * Parameters:
+ *              asid - ASID of the new U-proc
+ *              group - Group to join
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void joinGroup(int asid, int group) {
+    if ((group < 0) || (group >= RGROUPS)) {
+        group = RGDEFAULT;
+    }
+    leaveGroup(asid);
+    asidGroup[asid] = group;
+    groupMembers[group]++;
+}
+
+/* ========================================================================
+ * Function: leaveGroup
+ *
+ * Description: Takes a terminated U-proc out of its group, if it is in
+ *              one. Its CPU time stays charged to the group.
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void leaveGroup(int asid) {
+    if (asidGroup[asid] != NOGROUP) {
+        groupMembers[asidGroup[asid]]--;
+        asidGroup[asid] = NOGROUP;
+    }
+}
+
+/* ========================================================================
+ * Function: groupOf
+ *
+ * Description: Returns the group of an ASID.
+ *
+ * Parameters:
+ *              asid - ASID (0 for kernel processes)
+ *
+ * Returns:
+ *              Its group, NOGROUP for ASID 0 or a U-proc in none
+ * ======================================================================== */
+int groupOf(int asid) {
+    return ((asid > 0) && (asid <= MAXUPROC)) ? asidGroup[asid] : NOGROUP;
+}
+
+/* ========================================================================
+ * Function: groupTickets
+ *
+ * Description: Scales the stride tickets of a process of an ASID by its
+ *              group's CPU share, keeping at least one.
+ *
+ * Parameters:
+ *              asid - ASID of the process
+ *              tickets - Tickets it would have without groups
+ *
+ * Returns:
+ *              The tickets to create it with
+ * ======================================================================== */
+int groupTickets(int asid, int tickets) {
+    int group = groupOf(asid);
+    if (group == NOGROUP) {
+        return tickets;
+    }
+    return MAX((tickets * groupLimits[group].rg_cpuShare) / 100, 1);
+}
+
+/* ========================================================================
+ * Function: groupFrameLimit
+ *
+ * Description: Returns the most frames the members of an ASID's group may
+ *              hold together.
+ *
+ * Parameters:
+ *              asid - ASID of a U-proc
+ *
+ * Returns:
+ *              The limit, RGNOLIMIT if there is none
+ * ======================================================================== */
+int groupFrameLimit(int asid) {
+    int group = groupOf(asid);
+    return (group == NOGROUP) ? RGNOLIMIT : groupLimits[group].rg_maxFrames;
+}
+
+/* ========================================================================
+ * Function: groupIOWeight
+ *
+ * Description: Returns the I/O weight the members of an ASID's group
+ *              start with and may not exceed.
+ *
+ * Parameters:
+ *              asid - ASID of a U-proc
+ *
+ * Returns:
+ *              The weight, DEFAULTIOWEIGHT for an ASID in no group
+ * ======================================================================== */
+int groupIOWeight(int asid) {
+    int group = groupOf(asid);
+    return (group == NOGROUP) ? DEFAULTIOWEIGHT : groupLimits[group].rg_ioWeight;
+}
+
+/* ========================================================================
+ * Function: chargeGroup
+ *
+ * Description: Charges the CPU time a process used since its last charge
+ *              to its group, first starting a new period if the current
+ *              one is over, and tells whether the group is now over its
+ *              share of the period. Called by the scheduler, in the
+ *              nucleus, whenever it makes a process ready.
+ *
+ * Parameters:
+ *              p - Process being made ready
+ *
+ * Returns:
+ *              TRUE if it belongs to a group over its CPU share, else FALSE
+ * ======================================================================== */
+int chargeGroup(pcb_PTR p) {
+    cpu_t currTime;
+    STCK(currTime);
+    if (currTime - periodStart >= GROUPPERIOD) {
+        int i;
+        for (i = 0; i < RGROUPS; i++) {
+            groupPeriodTime[i] = 0;
+        }
+        periodStart = currTime;
+    }
+
+    cpu_t used = p->p_time - p->p_groupTime;
+    p->p_groupTime = p->p_time;
+    int group = groupOf(processASID(p));
+    if (group == NOGROUP) {
+        return FALSE;
+    }
+    groupCpuTime[group] += used;
+    groupPeriodTime[group] += used;
+
+    cpu_t budget = (GROUPPERIOD / 100) * groupLimits[group].rg_cpuShare * CPUCOUNT;
+    if (groupPeriodTime[group] < budget) {
+        return FALSE;
+    }
+    groupThrottled[group]++;
+    return TRUE;
+}
+
+/* ========================================================================
+ * Function: readGroupStats
+ *
+ * Description: Copies a group's limits and usage into buffer: its live
+ *              members, the frames they hold, the blocks they moved, and
+ *              the CPU time charged to it. The usage keeps counting; it is
+ *              not cleared.
+ *
+ * Parameters:
+ *              group - Group number
+ *              buffer - Destination statistics (in kernel memory)
+ *
+ * Returns:
+ *              The group number, -1 if it is invalid
+ * ======================================================================== */
+int readGroupStats(int group, groupStat_PTR buffer) {
+    if ((group < 0) || (group >= RGROUPS)) {
+        return -1;
+    }
+
+    buffer->gs_limits = groupLimits[group];
+    buffer->gs_members = groupMembers[group];
+    buffer->gs_resident = groupResident(group);
+    buffer->gs_ioBlocks = 0;
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (asidGroup[asid] == group) {
+            ioShare_t share;
+            readIOShare(asid, &share);
+            buffer->gs_ioBlocks += share.is_blocks;
+        }
+    }
+    buffer->gs_throttled = groupThrottled[group];
+    buffer->gs_cpuTime = groupCpuTime[group];
+    buffer->gs_periodTime = groupPeriodTime[group];
+    return group;
+}
@@ -8,10 +8,95 @@
  * ready queues, and handles CPU time allocation.
  *
  * Implementation:
- * The module implements a two-level priority scheduler with round-robin 
- * time slicing. High priority processes are always scheduled before low 
- * priority ones. The scheduler also handles deadlock detection and system
- * shutdown when no more processes exist.
+ * The module implements a multi-level feedback queue (MLFQ) scheduler with
+ * SCHEDLEVELS round-robin ready queues. A lower level number is always
+ * scheduled first. New and woken processes enter at their current level,
+ * a process whose quantum expires is demoted one level, and a process that
+ * blocks before its quantum expires PROMOTELIMIT times in a row is promoted
+ * one level. Every BOOSTINTERVAL microseconds all ready processes are moved
+ * back to the highest level so CPU-bound processes can not starve.
+ * The ready queue keeps a bitmap of non-empty levels, so picking the next
+ * process is a find-first-set, and each PCB records the level it is queued
+ * on (p_readyLevel), so removing a specific PCB is constant time.
+ * Each level has its own time quantum, starting at QUANTUM doubled once per
+ * level. Every ADAPTWINDOW slices the quantum of a level is doubled when most
+ * of them ran to expiry (fewer PLT interrupts for batch work) and halved when
+ * few did (quicker turnaround for interactive work), within MINQUANTUM and
+ * MAXQUANTUM. With SCHEDCLASS set to STRIDECLASS the levels are bypassed:
+ * every process stays on the highest level with the base quantum and the
+ * ready process with the smallest pass (CPU time charged per ticket) runs
+ * next, so each process receives CPU time in proportion to its tickets.
+ * With HANDOFF set, a SYS4 that wakes a process switches to it
+ * at once and donates the rest of the caller's quantum (wake affinity).
+ * With FAULTBOOST set, a process whose page-in I/O completes while it
+ * holds a contended mutex, or while others wait for the swap pool mutex
+ * it must take back to map the page, is queued at the head of the
+ * highest level instead of the tail of its own, so it runs next and the
+ * convoy of faulters behind those mutexes drains sooner. The Support Level
+ * marks a page-in in progress with sup_faultMutex.
+ * With TLBPRELOAD set, dispatching a U-proc other than the last one
+ * dispatched first writes its RECENTPAGES most recently used resident pages
+ * into the TLB, saving the refills it would take right after a switch. The
+ * scheduler also handles deadlock detection and system shutdown when no more
+ * processes exist.
+ * With TIMEPAGE set, every load of a process state first rewrites the time
+ * page (a slab frame the Support Level maps read-only into each U-proc)
+ * with the dispatch TOD, the pseudo-clock tick count and the dispatched
+ * process's CPU time, bracketed by a sequence counter, so a U-proc can
+ * read its time without a SYS10 trap.
+ * Every process made ready is charged to its U-proc's resource group
+ * (chargeGroup); under MLFQ a process whose group is over its CPU share
+ * for the current period is queued on the lowest level instead of its own,
+ * without changing its level.
+ * With IDLEWORK set, the scheduler lets the Support Level do bounded swap
+ * pool work (idleWork) before waiting with nothing ready; anything that
+ * blocks is handed to a helper process, which is then dispatched.
+ *
+ * With CPUCOUNT above one every processor runs this scheduler under the
+ * nucleus lock (spinlock.c), which loadProcessState and the idle wait
+ * release. Each processor has its own ready queues and takes from them
+ * first; with nothing there it steals from the peer with the most ready
+ * processes. A process is queued on the processor it last ran on, for its
+ * cache and TLB warmth, unless that processor is idle (it would only see
+ * the process at its next poll), in which case the processor readying it
+ * takes it. The boot processor may run any process. The others run only
+ * processes about to resume in user mode (kernel mode ones are always
+ * queued on the boot processor, and stealing skips them), so the Support
+ * Level, which relies on disabling interrupts for mutual exclusion, never
+ * runs on two processors at once; they keep their TLB across dispatches,
+ * noting the ASIDs they load (noteTLBASID) so a TLBSHOOTDOWN asks only them
+ * to clear it, and do a flush they were asked for on entering the scheduler
+ * if the IPI has not come yet. Each processor has its own time page, the
+ * one the TLB refill handler maps on it. A processor with nothing to run
+ * waits at most CPUPOLL microseconds (its PLT) before looking again, since
+ * a process readied by another processor raises no interrupt here; a
+ * processor other than the boot one never halts or detects deadlock, and
+ * the boot one does so only when no other processor runs a process.
+ *
+ * Functions:
+ * - initScheduler: Initializes the per-level quanta and boost timestamp.
+ * - loadProcessState: Loads a process state and starts its quantum.
+ * - getProcess: Removes the next (or a specific) process from the ready queues,
+ *               stealing from another processor if the local ones are empty.
+ * - scheduler: Dispatches the next ready process, waits or halts.
+ * - insertReadyQueue: Adds a process to the ready queue of its level.
+ * - promoteProcess: Credits an early exit and promotes the process if earned.
+ * - demoteProcess: Moves a process whose quantum expired down one level.
+ * - handoffProcess: Requeues the caller and runs a woken process in its place.
+ * - expeditePageIn: Runs a page-in holding up a mutex next.
+ * - chargeStride: Charges new CPU time to a process's stride pass.
+ * - pickStride: Removes a queue's ready process with the smallest pass.
+ * - boostReadyQueues: Moves every ready process to the highest level.
+ * - removeReadyQueue: Unlinks a PCB from its level and maintains the bitmap.
+ * - firstSetBit: Returns the index of the lowest set bit of a bitmap.
+ * - recordSlice: Records how a slice ended and adapts the level's quantum.
+ * - preloadTLB: Writes a U-proc's recently used pages into the TLB.
+ * - takeProcess: Removes the next process of one processor's ready queues.
+ * - stealProcess: Takes a process from the busiest other processor.
+ * - userRunnable: Tells whether a process may run off the boot processor.
+ * - pickRemote: Removes a queue's next process a non-boot processor may run.
+ * - othersRunning: Tells whether another processor runs a process.
+ * - idleWait: Releases the nucleus lock and waits for an interrupt.
  *
  * Written by Aryah Rao and Anish Reddy
  *
@@ -20,17 +105,95 @@
 /******************** Included Header Files ********************/
 #include "../h/scheduler.h"
 
+/******************** Global Variables ********************/
+memaddr cpuTimePage[MAXCPUS];           /* Frame of each processor's U-proc time page (NOFRAME if none) */
+
+/******************** Module Variables ********************/
+HIDDEN cpu_t lastBoostTOD;              /* Time of day of the last starvation boost */
+HIDDEN unsigned int globalPass;         /* Pass of the most recently dispatched process */
+HIDDEN unsigned int levelQuantum[SCHEDLEVELS];  /* Current quantum of each level */
+HIDDEN int levelSlices[SCHEDLEVELS];            /* Slices ended at each level in this window */
+HIDDEN int levelFullSlices[SCHEDLEVELS];        /* Slices that ran to expiry in this window */
+HIDDEN int lastPreloadASID[MAXCPUS];            /* ASID whose pages each TLB was last preloaded with */
+
+/* Bit index lookup for the De Bruijn find-first-set */
+HIDDEN const int debruijnIndex[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+/******************** Function Prototypes ********************/
+HIDDEN void chargeStride(pcb_PTR p);
+HIDDEN pcb_PTR pickStride(readyQueue_t *queue);
+HIDDEN void boostReadyQueues();
+HIDDEN pcb_PTR removeReadyQueue(pcb_PTR p);
+HIDDEN int firstSetBit(unsigned int map);
+HIDDEN void recordSlice(int level, int fullSlice);
+HIDDEN void preloadTLB(pcb_PTR p);
+HIDDEN pcb_PTR takeProcess(readyQueue_t *queue, int anyMode);
+HIDDEN pcb_PTR stealProcess(int cpu);
+HIDDEN int userRunnable(pcb_PTR p);
+HIDDEN pcb_PTR pickRemote(readyQueue_t *queue);
+HIDDEN int othersRunning();
+HIDDEN void idleWait(unsigned int poll);
+
 /******************** Function Definitions ********************/
 
+/* ========================================================================
+ * Function: initScheduler
+ *
+ * Description: Initializes the per-level time quanta, the adaptation
+ *              windows and the starvation boost timestamp, and with
+ *              TIMEPAGE set takes and clears each processor's time page
+ *              frame (the slab must be initialized first).
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initScheduler() {
+    unsigned int quantum = QUANTUM;
+    int level;
+    for (level = HIGHESTLEVEL; level < SCHEDLEVELS; level++) {
+        levelQuantum[level] = MIN(quantum, MAXQUANTUM);
+        levelSlices[level] = 0;
+        levelFullSlices[level] = 0;
+        quantum <<= 1; /* Lower levels hold batch work: longer slices */
+    }
+
+    globalPass = 0;
+    STCK(lastBoostTOD);
+
+    int cpu;
+    for (cpu = 0; cpu < MAXCPUS; cpu++) {
+        lastPreloadASID[cpu] = UNOCCUPIED;
+        cpuTimePage[cpu] = NOFRAME;
+        if (TIMEPAGE && (cpu < CPUCOUNT)) {
+            cpuTimePage[cpu] = allocSlabFrame();
+        }
+        if (cpuTimePage[cpu] != NOFRAME) {
+            timePage_PTR page = (timePage_PTR)cpuTimePage[cpu];
+            page->tp_sequence = 0;
+            page->tp_tod = lastBoostTOD;
+            page->tp_ticks = lastBoostTOD / CLOCKINTERVAL;
+            page->tp_cpuTime = 0;
+        }
+    }
+}
+
 /* ========================================================================
  * Function: loadProcessState
  *
  * Description: Loads a process state into the processor and starts execution.
- *              Sets up the process quantum timer and updates system time.
+ *              Sets up the process quantum timer. Callers set startTOD from
+ *              their last TOD read, so no extra clock read happens here.
  * 
  * Parameters:
  *              state - Pointer to the process state to be loaded
- *              quantum - Time quantum value to assign (0 for default QUANTUM)
+ *              quantum - Time quantum value to assign (0 for the full quantum
+ *                        of the current process's level)
  * 
  * Returns:
  *              This function does not return (control passes to the loaded process)
@@ -41,17 +204,37 @@ void loadProcessState(state_t *state, unsigned int quantum) {
         PANIC(); /* Handle error */
     }
 
-    /* Set Processor Local Timer */
-    if (quantum > 0) {
-        setTIMER(quantum); /* Set the timer to the provided quantum */
-    } else {
-        setTIMER(QUANTUM); /* Set the timer to the default quantum */
+    /* Set Processor Local Timer (to the sampling interval if the profiler
+     * banks the rest of the quantum) */
+    if (quantum == 0) {
+        quantum = levelQuantum[currentProcess->priority]; /* Full quantum of the process's level */
     }
+    setTIMER(profileTimer(quantum));
 
-    /* Update system start time */
-    STCK(startTOD);
+    /* startTOD was set by the caller's last TOD read (one read per kernel entry) */
+
+    /* Publish the time to the U-procs' time page */
+    if (TIMEPAGE && (timePage != NOFRAME)) {
+        timePage_PTR page = (timePage_PTR)timePage;
+        page->tp_sequence++;
+        page->tp_tod = startTOD;
+        page->tp_ticks = startTOD / CLOCKINTERVAL;
+        page->tp_cpuTime = currentProcess->p_time;
+        page->tp_sequence++;
+    }
+
+    /* This TLB may hold the process's entries from now on (shootdowns) */
+    if ((CPUCOUNT > 1) && (CPUID() != BOOTCPU)) {
+        noteTLBASID(CPUID(), currentProcess);
+    }
+
+    /* Tell dynamic interrupt routing this processor is busy */
+    if ((CPUCOUNT > 1) && (IRQROUTING == IRQDYNAMIC)) {
+        *((unsigned int *)TPRADDR) = TPRBUSY;
+    }
 
     /* Load processor state and transfer control */
+    releaseKernel();
     LDST(state);
 }
 
@@ -60,7 +243,8 @@ void loadProcessState(state_t *state, unsigned int quantum) {
  *
  * Description: Gets the next process to run from the ready queues based on 
  *              priority. If a specific process is requested, it attempts to
- *              remove that process.
+ *              remove that process. Otherwise the executing processor's
+ *              queues are tried first, then stolen from.
  * 
  * Parameters:
  *              process - Pointer to a specific process to remove, or NULL to
@@ -70,28 +254,22 @@ void loadProcessState(state_t *state, unsigned int quantum) {
  *              Pointer to the selected process, or NULL if no process is available
  * ======================================================================== */
 pcb_PTR getProcess(pcb_PTR process) {
-    /* If process is not NULL, use outProcQ to remove specific process from ready queues */
+    /* If process is not NULL, unlink it from the level it is tagged with */
     if (process != mkEmptyProcQ()) {
-        /* First check high priority queue */
-        pcb_PTR removedProcess = outProcQ(&readyQueueHigh, process);
-
-        /* If not in high priority queue, check low priority queue */
-        if (removedProcess != mkEmptyProcQ()) {
-            return removedProcess;
+        if (process->p_readyLevel == NOTREADY) {
+            return mkEmptyProcQ(); /* Not on any ready queue */
         }
-        return outProcQ(&readyQueueLow, process);
+        return removeReadyQueue(process);
     }
     
-    /* Process is NULL, use removeProcQ to get the next process in queue order */
-    /* First check high priority queue */
-    pcb_PTR removedProcess = removeProcQ(&readyQueueHigh);
-    
-    /* If high priority queue is empty, check low priority queue */
-    if (removedProcess != mkEmptyProcQ()) {
-        return removedProcess;
+    /* Process is NULL, take the head of the highest non-empty local level
+     * (every process queued here may run here) */
+    int cpu = CPUID();
+    pcb_PTR p = takeProcess(&readyQueues[cpu], TRUE);
+    if ((p == mkEmptyProcQ()) && (CPUCOUNT > 1)) {
+        p = stealProcess(cpu);
     }
-    
-    return removeProcQ(&readyQueueLow);
+    return p;
 }
 
 /* ========================================================================
@@ -107,27 +285,57 @@ pcb_PTR getProcess(pcb_PTR process) {
  *              This function does not return (except in case of HALT or PANIC)
  * ======================================================================== */
 void scheduler() {
+    int cpu = CPUID();
+
+    /* Do a TLB flush asked of this processor, so shootdowns waiting on it go on */
+    if ((cpu != BOOTCPU) && releaseShootdowns(cpu)) {
+        lastPreloadASID[cpu] = UNOCCUPIED;
+    }
+
+    /* Periodically lift every ready process back to the highest level */
+    cpu_t currentTOD;
+    STCK(currentTOD);
+    if ((currentTOD - lastBoostTOD) >= BOOSTINTERVAL) {
+        boostReadyQueues();
+        lastBoostTOD = currentTOD;
+    }
+
     /* Get next process from ready queue based on priority */
     currentProcess = getProcess(mkEmptyProcQ());
 
     /* If a process is available, load it and start execution */
     if (currentProcess != mkEmptyProcQ()) {
-        /* Load process state and start execution with default quantum */
+        currentProcess->p_lastCPU = cpu;
+        /* Its CPU time starts now (nucleus time before this belonged to others) */
+        startTOD = currentTOD;
+        traceEvent(TRACE_DISPATCH, currentProcess, NULL);
+        perfDispatch(currentProcess);
+        recordRunLatency(currentProcess, currentTOD);
+        preloadTLB(currentProcess);
+
+        /* Load process state and start execution with its level's quantum */
         loadProcessState(&currentProcess->p_s, 0);
     }
+    /* Nothing this processor may run: only the boot processor halts or panics */
+    else if (cpu != BOOTCPU) {
+        idleWait(CPUPOLL);
+    }
     /* No ready processes */
     else if (processCount > 0) {
         /* Check if there are blocked processes waiting for events */
         if (softBlockCount > 0) {
-            /* Processes exist but are blocked - enter wait state */
-            /* Set timer to maximum value to prevent timer interrupts during wait */
-            setTIMER(MAXINT);
-
-            /* Enable all interrupts and wait for an interrupt to unblock processes */
-            setSTATUS(ALLOFF | STATUS_IEc | CAUSE_IP_MASK);
+            /* Spend the idle time on bounded swap pool work; run a helper it readied */
+            if (IDLEWORK && idleWork()) {
+                scheduler();
+            }
 
-            /* Wait for interrupt */
-            WAIT();
+            /* Processes exist but are blocked - enter wait state (polling for
+             * processes other processors make ready, if any run) */
+            idleWait(othersRunning() ? CPUPOLL : 0);
+        }
+        else if (othersRunning()) {
+            /* The processes running elsewhere may block or come back here */
+            idleWait(CPUPOLL);
         }
         else {
             /* Deadlock detected: processes exist but none are ready or blocked */
@@ -139,3 +347,574 @@ void scheduler() {
         HALT();
     }
 }
+
+/* ========================================================================
+ * Function: insertReadyQueue
+ *
+ * Description: Adds a process to the tail of the ready queue matching its
+ *              current priority level, on the processor it last ran on if
+ *              that one is busy and may run it, else on the executing
+ *              processor if it may, else on the boot processor. Under
+ *              stride scheduling the CPU time used since the last charge
+ *              is added to its pass first. Its resource group is charged
+ *              too, and under MLFQ it goes to the lowest level while the
+ *              group is over its CPU share.
+ * 
+ * Parameters:
+ *              p - Pointer to the process to make ready
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void insertReadyQueue(pcb_PTR p) {
+    if (SCHEDCLASS == STRIDECLASS) {
+        chargeStride(p);
+    }
+    int level = p->priority;
+    if (chargeGroup(p) && (SCHEDCLASS != STRIDECLASS)) {
+        level = LOWESTLEVEL;
+    }
+
+    int cpu = p->p_lastCPU;
+    if ((cpu != CPUID()) && (cpuProcess[cpu] == mkEmptyProcQ())) {
+        cpu = CPUID(); /* Idle there: it would only look at its next poll */
+    }
+    if ((cpu != BOOTCPU) && !userRunnable(p)) {
+        cpu = BOOTCPU;
+    }
+
+    readyQueue_t *queue = &readyQueues[cpu];
+    insertProcQ(&queue->rq_tail[level], p);
+    p->p_readyLevel = level;
+    p->p_readyCPU = cpu;
+    queue->rq_bitmap |= (1U << level);
+    queue->rq_count++;
+}
+
+/* ========================================================================
+ * Function: promoteProcess
+ *
+ * Description: Credits a process that gave up the CPU before its quantum
+ *              expired. After PROMOTELIMIT consecutive early exits the
+ *              process rises one level.
+ * 
+ * Parameters:
+ *              p - Pointer to the process that blocked
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void promoteProcess(pcb_PTR p) {
+    if (SCHEDCLASS == STRIDECLASS) {
+        return; /* Stride scheduling does not use the levels */
+    }
+    recordSlice(p->priority, FALSE);
+    p->earlyExits++;
+
+    /* A process boosted by a mutex waiter moves its own level */
+    int *level = (p->p_basePriority != NOBOOST) ? &p->p_basePriority : &p->priority;
+
+    /* Promote one level once enough early exits have been seen */
+    if ((p->earlyExits >= PROMOTELIMIT) && (*level > HIGHESTLEVEL)) {
+        (*level)--;
+        p->earlyExits = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: demoteProcess
+ *
+ * Description: Moves a process whose quantum expired down one level and
+ *              clears its early exit credit.
+ * 
+ * Parameters:
+ *              p - Pointer to the preempted process
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void demoteProcess(pcb_PTR p) {
+    if (SCHEDCLASS == STRIDECLASS) {
+        return; /* Stride scheduling does not use the levels */
+    }
+    recordSlice(p->priority, TRUE);
+    p->earlyExits = 0;
+
+    /* A process boosted by a mutex waiter keeps the waiter's level */
+    int *level = (p->p_basePriority != NOBOOST) ? &p->p_basePriority : &p->priority;
+    if (*level < LOWESTLEVEL) {
+        (*level)++;
+    }
+}
+
+/* ========================================================================
+ * Function: handoffProcess
+ *
+ * Description: Puts the current process back on its ready queue and runs
+ *              the target process (already made ready by a V) for the rest
+ *              of the current quantum. Used by SYS4 in HANDOFF mode so a
+ *              waker/waiter pair skips the trip through the ready queue.
+ *              The caller's level is left alone: handing off is neither an
+ *              early exit nor a quantum expiry.
+ * 
+ * Parameters:
+ *              target - Ready process to run next
+ *              quantum - Remaining quantum donated to the target
+ * 
+ * Returns:
+ *              This function does not return (control passes to target)
+ * ======================================================================== */
+void handoffProcess(pcb_PTR target, unsigned int quantum) {
+    /* Pull the target off its ready queue before requeueing the caller */
+    getProcess(target);
+    insertReadyQueue(currentProcess);
+
+    /* Run the target with the donated slice */
+    currentProcess = target;
+    currentProcess->p_lastCPU = CPUID();
+    traceEvent(TRACE_DISPATCH, currentProcess, NULL);
+    perfDispatch(currentProcess);
+    preloadTLB(currentProcess);
+    loadProcessState(&currentProcess->p_s, quantum);
+}
+
+/* ========================================================================
+ * Function: expeditePageIn
+ *
+ * Description: Called for a process a device interrupt just readied. If
+ *              it is a U-proc in the middle of a page-in (sup_faultMutex
+ *              set) and either holds a mutex others are blocked on or
+ *              others are blocked on the mutex the page-in takes back,
+ *              it is moved to the head of the highest level of its ready
+ *              queue, so the next dispatch there picks it. Its own level
+ *              is left alone. Stride scheduling picks by pass, so there
+ *              it is left where it is.
+ * 
+ * Parameters:
+ *              p - Pointer to the process just made ready
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void expeditePageIn(pcb_PTR p) {
+    support_PTR supportStruct = p->p_supportStruct;
+    if (!FAULTBOOST || (SCHEDCLASS == STRIDECLASS) || (p->p_readyLevel == NOTREADY) ||
+        (supportStruct == NULL) || (supportStruct->sup_faultMutex == NULL)) {
+        return;
+    }
+    if ((*supportStruct->sup_faultMutex >= 0) && !ownsContendedMutex(p)) {
+        return;
+    }
+
+    /* Queue it first: linked in after the tail, the tail stays put */
+    readyQueue_t *queue = &readyQueues[p->p_readyCPU];
+    removeReadyQueue(p);
+    pcb_PTR tail = queue->rq_tail[HIGHESTLEVEL];
+    insertProcQ(&queue->rq_tail[HIGHESTLEVEL], p);
+    if (!emptyProcQ(tail)) {
+        queue->rq_tail[HIGHESTLEVEL] = tail;
+    }
+    p->p_readyLevel = HIGHESTLEVEL;
+    queue->rq_bitmap |= (1U << HIGHESTLEVEL);
+    queue->rq_count++;
+}
+
+/* ========================================================================
+ * Function: chargeStride
+ *
+ * Description: Advances a process's pass by the CPU time (p_time) it used
+ *              since its last charge, scaled by STRIDEONE over its tickets.
+ *              A process returning from a long block is moved up to the
+ *              current global pass so it can not bank credit while asleep.
+ *              Passes are compared by signed difference, so wrap-around of
+ *              the counters is harmless.
+ * 
+ * Parameters:
+ *              p - Pointer to the process becoming ready
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void chargeStride(pcb_PTR p) {
+    p->p_pass += ((unsigned int)(p->p_time - p->p_passTime) * STRIDEONE) / p->p_tickets;
+    p->p_passTime = p->p_time;
+
+    if ((int)(p->p_pass - globalPass) < 0) {
+        p->p_pass = globalPass;
+    }
+}
+
+/* ========================================================================
+ * Function: pickStride
+ *
+ * Description: Removes the process with the smallest pass from a ready
+ *              queue (all stride processes live on the highest level) and
+ *              makes its pass the global pass.
+ * 
+ * Parameters:
+ *              queue - Non-empty ready queue to pick from
+ * 
+ * Returns:
+ *              Pointer to the selected process
+ * ======================================================================== */
+HIDDEN pcb_PTR pickStride(readyQueue_t *queue) {
+    pcb_PTR head = headProcQ(queue->rq_tail[HIGHESTLEVEL]);
+    pcb_PTR best = head;
+    pcb_PTR p;
+    for (p = head->p_next; p != head; p = p->p_next) {
+        if ((int)(p->p_pass - best->p_pass) < 0) {
+            best = p;
+        }
+    }
+
+    globalPass = best->p_pass;
+    return removeReadyQueue(best);
+}
+
+/* ========================================================================
+ * Function: boostReadyQueues
+ *
+ * Description: Moves every ready process to the tail of the highest level
+ *              queue, preserving their relative order, so processes stuck
+ *              in the lower levels get to run again (their level is
+ *              reset, but insertReadyQueue still queues one whose group is
+ *              over its CPU share on the lowest). Every processor's queues
+ *              are boosted.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void boostReadyQueues() {
+    int cpu;
+    for (cpu = 0; cpu < CPUCOUNT; cpu++) {
+        readyQueue_t *queue = &readyQueues[cpu];
+
+        /* Only the levels below the highest need to be drained */
+        unsigned int lowerLevels = queue->rq_bitmap & ~(1U << HIGHESTLEVEL);
+        pcb_PTR p;
+        while (lowerLevels != 0) {
+            /* Detach the level first: a process over its group's share goes back to the lowest */
+            int level = firstSetBit(lowerLevels);
+            pcb_PTR drained = queue->rq_tail[level];
+            queue->rq_tail[level] = mkEmptyProcQ();
+            queue->rq_bitmap &= ~(1U << level);
+            while ((p = removeProcQ(&drained)) != mkEmptyProcQ()) {
+                queue->rq_count--;
+                p->priority = HIGHESTLEVEL;
+                p->p_basePriority = NOBOOST;
+                p->earlyExits = 0;
+                insertReadyQueue(p);
+            }
+            lowerLevels &= ~(1U << level);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: removeReadyQueue
+ *
+ * Description: Unlinks a PCB from the ready queue of the processor and
+ *              level it is tagged with, clearing the tag and, if the level
+ *              became empty, its bit in the non-empty bitmap.
+ * 
+ * Parameters:
+ *              p - Pointer to a PCB currently on a ready queue
+ * 
+ * Returns:
+ *              Pointer to the removed PCB
+ * ======================================================================== */
+HIDDEN pcb_PTR removeReadyQueue(pcb_PTR p) {
+    readyQueue_t *queue = &readyQueues[p->p_readyCPU];
+    int level = p->p_readyLevel;
+    outProcQ(&queue->rq_tail[level], p);
+    p->p_readyLevel = NOTREADY;
+    queue->rq_count--;
+
+    if (emptyProcQ(queue->rq_tail[level])) {
+        queue->rq_bitmap &= ~(1U << level);
+    }
+    return p;
+}
+
+/* ========================================================================
+ * Function: firstSetBit
+ *
+ * Description: Returns the index of the least significant set bit using a
+ *              De Bruijn multiply (MIPS-I has no count-leading-zeros).
+ * 
+ * Parameters:
+ *              map - Non-zero bitmap
+ * 
+ * Returns:
+ *              Index (0-31) of the lowest set bit
+ * ======================================================================== */
+HIDDEN int firstSetBit(unsigned int map) {
+    return debruijnIndex[((map & (~map + 1)) * DEBRUIJN32) >> DEBRUIJNSHIFT];
+}
+
+/* ========================================================================
+ * Function: recordSlice
+ *
+ * Description: Records how a slice at a level ended. Once ADAPTWINDOW slices
+ *              have been seen, the level's quantum doubles if at least
+ *              ADAPTHIGH of them ran to expiry and halves if fewer than
+ *              ADAPTLOW did.
+ * 
+ * Parameters:
+ *              level - Level the slice ran at
+ *              fullSlice - TRUE if the quantum expired, FALSE if the process
+ *                          blocked early
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void recordSlice(int level, int fullSlice) {
+    levelSlices[level]++;
+    if (fullSlice) {
+        levelFullSlices[level]++;
+    }
+
+    if (levelSlices[level] < ADAPTWINDOW) {
+        return;
+    }
+
+    /* Window complete: adapt the quantum and start a new window */
+    if (levelFullSlices[level] >= ADAPTHIGH) {
+        levelQuantum[level] = MIN(levelQuantum[level] << 1, MAXQUANTUM);
+    } else if (levelFullSlices[level] < ADAPTLOW) {
+        levelQuantum[level] = MAX(levelQuantum[level] >> 1, MINQUANTUM);
+    }
+    levelSlices[level] = 0;
+    levelFullSlices[level] = 0;
+}
+
+/* ========================================================================
+ * Function: preloadTLB
+ *
+ * Description: Before a U-proc is dispatched, writes the resident pages
+ *              among those it touched last (recorded in its support
+ *              structure by the TLB refill handler and the pager) into
+ *              TLB entries 0 to RECENTPAGES-1 with TLBWI. Pages already in
+ *              the TLB are skipped, so no VPN is ever entered twice.
+ *              Nothing is done for processes without a support structure
+ *              or when the same ASID runs again, since its entries are
+ *              still there.
+ * 
+ * Parameters:
+ *              p - Process about to be dispatched
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void preloadTLB(pcb_PTR p) {
+    support_PTR supportStruct = p->p_supportStruct;
+    int cpu = CPUID();
+    if (!TLBPRELOAD || (supportStruct == NULL) || (supportStruct->sup_asid == lastPreloadASID[cpu])) {
+        return;
+    }
+    lastPreloadASID[cpu] = supportStruct->sup_asid;
+    supportStruct = supportStruct->sup_space; /* A thread's pages are in its U-proc's page table */
+
+    int i;
+    for (i = 0; i < RECENTPAGES; i++) {
+        pageTableEntry_PTR pte = &supportStruct->sup_pageTable[supportStruct->sup_recentPages[i]];
+        if (pte->pte_entryLO & VALIDON) {
+            setENTRYHI(pte->pte_entryHI);
+            TLBP();
+            if ((getINDEX() >> PROBESHIFT) & ON) {
+                /* Not in the TLB yet */
+                setINDEX(i << TLBINDEXSHIFT);
+                setENTRYHI(pte->pte_entryHI);
+                setENTRYLO(pte->pte_entryLO);
+                TLBWI();
+            }
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: takeProcess
+ *
+ * Description: Removes the next process of one processor's ready queues:
+ *              the head of the highest non-empty level (the smallest pass
+ *              under stride scheduling), or with anyMode off the next one
+ *              a processor other than the boot one may run.
+ * 
+ * Parameters:
+ *              queue - Ready queues to take from
+ *              anyMode - TRUE if the taker may run kernel mode processes
+ * 
+ * Returns:
+ *              Pointer to the removed process, or NULL if there is none
+ * ======================================================================== */
+HIDDEN pcb_PTR takeProcess(readyQueue_t *queue, int anyMode) {
+    if (queue->rq_bitmap == 0) {
+        return mkEmptyProcQ();
+    }
+    if (!anyMode) {
+        return pickRemote(queue);
+    }
+    if (SCHEDCLASS == STRIDECLASS) {
+        return pickStride(queue);
+    }
+    int level = firstSetBit(queue->rq_bitmap);
+    return removeReadyQueue(headProcQ(queue->rq_tail[level]));
+}
+
+/* ========================================================================
+ * Function: stealProcess
+ *
+ * Description: Takes a process for an idle processor from the other
+ *              processor with the most ready processes, moving on to the
+ *              next busiest if none of its processes may run here.
+ * 
+ * Parameters:
+ *              cpu - The stealing (executing) processor
+ * 
+ * Returns:
+ *              Pointer to the stolen process, or NULL if there is none
+ * ======================================================================== */
+HIDDEN pcb_PTR stealProcess(int cpu) {
+    unsigned int tried = (1U << cpu);
+    while (TRUE) {
+        int victim = -1;
+        int peer;
+        for (peer = 0; peer < CPUCOUNT; peer++) {
+            if (!(tried & (1U << peer)) && (readyQueues[peer].rq_count > 0) &&
+                ((victim < 0) || (readyQueues[peer].rq_count > readyQueues[victim].rq_count))) {
+                victim = peer;
+            }
+        }
+        if (victim < 0) {
+            return mkEmptyProcQ();
+        }
+
+        pcb_PTR p = takeProcess(&readyQueues[victim], cpu == BOOTCPU);
+        if (p != mkEmptyProcQ()) {
+            return p;
+        }
+        tried |= (1U << victim);
+    }
+}
+
+/* ========================================================================
+ * Function: userRunnable
+ *
+ * Description: Tells whether a process may run on a processor other than
+ *              the boot one: its saved state resumes in user mode (a
+ *              U-proc outside its Support Level handlers).
+ * 
+ * Parameters:
+ *              p - Process to look at
+ * 
+ * Returns:
+ *              TRUE if it may, else FALSE
+ * ======================================================================== */
+HIDDEN int userRunnable(pcb_PTR p) {
+    return ((p->p_s.s_status & STATUS_KUp) != ALLOFF) && (p->p_supportStruct != NULL);
+}
+
+/* ========================================================================
+ * Function: pickRemote
+ *
+ * Description: Removes the next process of a ready queue that a processor
+ *              other than the boot one may run: the first one, in level
+ *              order, that is userRunnable. Under stride scheduling the
+ *              one among them with the smallest pass.
+ * 
+ * Parameters:
+ *              queue - Ready queues to pick from
+ * 
+ * Returns:
+ *              Pointer to the selected process, or NULL if there is none
+ * ======================================================================== */
+HIDDEN pcb_PTR pickRemote(readyQueue_t *queue) {
+    pcb_PTR best = mkEmptyProcQ();
+    unsigned int levels = queue->rq_bitmap;
+    while ((levels != 0) && (best == mkEmptyProcQ())) {
+        int level = firstSetBit(levels);
+        pcb_PTR head = headProcQ(queue->rq_tail[level]);
+        pcb_PTR p = head;
+        do {
+            if (userRunnable(p) &&
+                ((best == mkEmptyProcQ()) || ((int)(p->p_pass - best->p_pass) < 0))) {
+                best = p;
+                if (SCHEDCLASS != STRIDECLASS) {
+                    break; /* Queue order: the first one wins */
+                }
+            }
+            p = p->p_next;
+        } while (p != head);
+        levels &= ~(1U << level);
+    }
+
+    if (best == mkEmptyProcQ()) {
+        return mkEmptyProcQ();
+    }
+    if (SCHEDCLASS == STRIDECLASS) {
+        globalPass = best->p_pass;
+    }
+    return removeReadyQueue(best);
+}
+
+/* ========================================================================
+ * Function: othersRunning
+ *
+ * Description: Tells whether a processor other than the executing one has
+ *              a process dispatched.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              TRUE if one does, else FALSE
+ * ======================================================================== */
+HIDDEN int othersRunning() {
+    int cpu;
+    for (cpu = 0; cpu < CPUCOUNT; cpu++) {
+        if ((cpu != CPUID()) && (cpuProcess[cpu] != mkEmptyProcQ())) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* ========================================================================
+ * Function: idleWait
+ *
+ * Description: Releases the nucleus lock and waits with interrupts on.
+ *              With a poll interval the PLT is enabled to fire after it,
+ *              so the processor looks at the ready queue again even if no
+ *              device interrupt comes; otherwise the PLT is held off.
+ * 
+ * Parameters:
+ *              poll - Microseconds until the PLT fires, 0 for no PLT
+ * 
+ * Returns:
+ *              Does not return (the interrupt enters the nucleus afresh)
+ * ======================================================================== */
+HIDDEN void idleWait(unsigned int poll) {
+    /* Dynamic interrupt routing prefers this processor while it waits */
+    if ((CPUCOUNT > 1) && (IRQROUTING == IRQDYNAMIC)) {
+        *((unsigned int *)TPRADDR) = TPRIDLE;
+    }
+
+    if (poll == 0) {
+        /* Set timer to maximum value to prevent timer interrupts during wait */
+        setTIMER(MAXINT);
+
+        /* Enable all interrupts and wait for an interrupt to unblock processes */
+        releaseKernel();
+        setSTATUS(ALLOFF | STATUS_IEc | CAUSE_IP_MASK);
+    } else {
+        setTIMER(poll);
+        releaseKernel();
+        setSTATUS(ALLOFF | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE);
+    }
+
+    /* Wait for interrupt (with TICKLESS the pseudo-clock may be stopped, so this can be a device) */
+    WAIT();
+}
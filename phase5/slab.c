@@ -0,0 +1,407 @@
+/******************************* slab.c **************************************
+ *
+ * Module: Kernel Slab Frames
+ *
+ * Description:
+ * This module hands out whole RAM frames to the nucleus so the PCB and
+ * semaphore descriptor free lists can grow past their static tables, and
+ * carves frames into size-class caches so kernel code can allocate
+ * objects whose number or size is only known at run time (kmemAlloc).
+ *
+ * Implementation:
+ * The SLABFRAMES frames just below the DMA buffers (SLABSTART to SLABEND)
+ * are kept out of the swap pool and belong to nobody else. Frames are
+ * handed out from a stack of freed frames first, then in address order by
+ * bumping a cursor, and kmemFree gives frames back to that stack, so both
+ * directions are constant time. A frame carved into PCBs or descriptors
+ * stays on that free list for good.
+ *
+ * A size-class cache owns some frames, each holding objects of one power
+ * of two size from 16 bytes to PAGESIZE / 2. Every frame keeps its own
+ * list of free objects, linked through their first word, and a count of
+ * objects in use; the frames of a cache with a free object are on the
+ * cache's partial list. kmemAlloc takes an object from the first partial
+ * frame (growing the cache by a frame if there is none); kmemFree finds
+ * the object's frame from its address, so it needs no size, and puts it
+ * back. A frame left empty goes back to the frame stack unless it is the
+ * cache's only partial frame, which is kept so a cache that alternates
+ * between one allocation and one free does not trade frames every time.
+ *
+ * Policy Decisions:
+ * - Capacity: KMEMFRAMES of the slab frames are there for the caches;
+ *   all frames come from one pool, so whole-frame users and caches share
+ *   what is free
+ * - Locking: The frame pool and caches are used by the nucleus and by
+ *   support level code, so every call disables interrupts and (with more
+ *   than one processor) takes slabLock
+ * - Statistics: Each cache counts its frames, the objects in use and
+ *   free, and the calls served and failed (kmemCacheStats)
+ *
+ * Functions:
+ * - initSlab: Sets the cursor and limit from the installed RAM.
+ * - allocSlabFrame: Returns a free frame, or NOFRAME.
+ * - kmemAlloc: Allocates an object from the smallest size class that fits.
+ * - kmemFree: Returns an object from kmemAlloc to its cache.
+ * - kmemCacheStats: Copies out the usage statistics of one size class.
+ * - takeFrame: Takes a frame from the freed stack or the cursor.
+ * - releaseFrame: Puts a frame on the freed stack.
+ * - growCache: Carves a new frame into objects of one size class.
+ * - unlinkPartial: Takes a frame off its cache's partial list.
+ * - lockSlab: Disables interrupts and takes slabLock.
+ * - unlockSlab: Releases slabLock and restores the interrupt state.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/slab.h"
+
+/******************** Module Variables ********************/
+HIDDEN memaddr slabNext = NOFRAME;     /* Next frame to hand out */
+HIDDEN memaddr slabLimit = NOFRAME;    /* First address past the slab frames */
+HIDDEN memaddr freedFrames = NOFRAME;  /* Stack of frames given back, linked through their first word */
+HIDDEN volatile unsigned int slabLock = 0;  /* Guards the frames and caches across processors */
+
+HIDDEN int frameClass[SLABFRAMES];          /* Size class of each slab frame, KMEMWHOLE or KMEMFREE */
+HIDDEN memaddr frameObjects[SLABFRAMES];    /* Free objects in each cache frame, linked through their first word */
+HIDDEN int frameUsed[SLABFRAMES];           /* Objects in use in each cache frame */
+HIDDEN int partialNext[SLABFRAMES];         /* Next frame on its cache's partial list */
+HIDDEN int partialPrev[SLABFRAMES];         /* Previous frame on its cache's partial list */
+HIDDEN int partialHead[KMEMCLASSES];        /* First frame of each cache with a free object */
+HIDDEN kmemStat_t cacheStats[KMEMCLASSES];  /* Usage statistics of each cache */
+
+/******************** Helper Function Prototypes ********************/
+HIDDEN memaddr takeFrame();
+HIDDEN void releaseFrame(memaddr frame);
+HIDDEN int growCache(int sizeClass);
+HIDDEN void unlinkPartial(int sizeClass, int frameIndex);
+HIDDEN unsigned int lockSlab();
+HIDDEN void unlockSlab(unsigned int status);
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initSlab
+ *
+ * Description: Sets the slab cursor and limit and empties the caches.
+ *              RAMTOP is read from the bus registers, so this must run at
+ *              boot rather than at compile time.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initSlab() {
+    slabNext = SLABSTART;
+    slabLimit = SLABEND;
+    freedFrames = NOFRAME;
+
+    int i;
+    for (i = 0; i < SLABFRAMES; i++) {
+        frameClass[i] = KMEMFREE;
+        frameObjects[i] = NOFRAME;
+        frameUsed[i] = 0;
+        partialNext[i] = NOSLAB;
+        partialPrev[i] = NOSLAB;
+    }
+    for (i = 0; i < KMEMCLASSES; i++) {
+        partialHead[i] = NOSLAB;
+        cacheStats[i].ks_size = 1 << (KMEMMINSHIFT + i);
+        cacheStats[i].ks_frames = 0;
+        cacheStats[i].ks_inUse = 0;
+        cacheStats[i].ks_free = 0;
+        cacheStats[i].ks_allocs = 0;
+        cacheStats[i].ks_failures = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: allocSlabFrame
+ *
+ * Description: Takes a free kernel frame, to be used whole.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              Address of the frame, or NOFRAME if RAM is exhausted
+ * ======================================================================== */
+memaddr allocSlabFrame() {
+    unsigned int status = lockSlab();
+    memaddr frame = takeFrame();
+    if (frame != NOFRAME) {
+        frameClass[SLABINDEX(frame)] = KMEMWHOLE;
+    }
+    unlockSlab(status);
+    return frame;
+}
+
+/* ========================================================================
+ * Function: kmemAlloc
+ *
+ * Description: Allocates an object of at least size bytes from the
+ *              smallest size class that fits, growing that cache by a
+ *              frame if all of its objects are taken.
+ *
+ * Parameters:
+ *              size - Bytes needed (1 to KMEMMAXSIZE)
+ *
+ * Returns:
+ *              Address of the object (aligned to its class size), or
+ *              NOFRAME if the size is out of range or RAM is exhausted
+ * ======================================================================== */
+memaddr kmemAlloc(int size) {
+    if ((size < 1) || (size > KMEMMAXSIZE)) {
+        return NOFRAME;
+    }
+    int sizeClass = 0;
+    while ((1 << (KMEMMINSHIFT + sizeClass)) < size) {
+        sizeClass++;
+    }
+
+    unsigned int status = lockSlab();
+    int frameIndex = partialHead[sizeClass];
+    if (frameIndex == NOSLAB) {
+        frameIndex = growCache(sizeClass);
+        if (frameIndex == NOSLAB) {
+            cacheStats[sizeClass].ks_failures++;
+            unlockSlab(status);
+            return NOFRAME;
+        }
+    }
+
+    /* Pop an object from the frame; a full frame leaves the partial list */
+    memaddr object = frameObjects[frameIndex];
+    frameObjects[frameIndex] = *((memaddr *)object);
+    frameUsed[frameIndex]++;
+    if (frameObjects[frameIndex] == NOFRAME) {
+        unlinkPartial(sizeClass, frameIndex);
+    }
+    cacheStats[sizeClass].ks_inUse++;
+    cacheStats[sizeClass].ks_free--;
+    cacheStats[sizeClass].ks_allocs++;
+    unlockSlab(status);
+    return object;
+}
+
+/* ========================================================================
+ * Function: kmemFree
+ *
+ * Description: Returns an object from kmemAlloc to its cache. The size
+ *              class is found from the object's frame. A frame left empty
+ *              goes back to the frame pool unless it is the cache's only
+ *              partial frame.
+ *
+ * Parameters:
+ *              object - Address returned by kmemAlloc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void kmemFree(memaddr object) {
+    unsigned int status = lockSlab();
+    int frameIndex = SLABINDEX(object);
+    int sizeClass = frameClass[frameIndex];
+
+    /* Push the object; a full frame rejoins the partial list */
+    int wasFull = (frameObjects[frameIndex] == NOFRAME);
+    *((memaddr *)object) = frameObjects[frameIndex];
+    frameObjects[frameIndex] = object;
+    frameUsed[frameIndex]--;
+    cacheStats[sizeClass].ks_inUse--;
+    cacheStats[sizeClass].ks_free++;
+    if (wasFull) {
+        partialPrev[frameIndex] = NOSLAB;
+        partialNext[frameIndex] = partialHead[sizeClass];
+        if (partialHead[sizeClass] != NOSLAB) {
+            partialPrev[partialHead[sizeClass]] = frameIndex;
+        }
+        partialHead[sizeClass] = frameIndex;
+    }
+
+    /* Give an empty frame back, keeping one partial frame per cache */
+    if ((frameUsed[frameIndex] == 0) &&
+        ((partialHead[sizeClass] != frameIndex) || (partialNext[frameIndex] != NOSLAB))) {
+        unlinkPartial(sizeClass, frameIndex);
+        cacheStats[sizeClass].ks_frames--;
+        cacheStats[sizeClass].ks_free -= PAGESIZE / cacheStats[sizeClass].ks_size;
+        frameClass[frameIndex] = KMEMFREE;
+        frameObjects[frameIndex] = NOFRAME;
+        releaseFrame(SLABSTART + (frameIndex * PAGESIZE));
+    }
+    unlockSlab(status);
+}
+
+/* ========================================================================
+ * Function: kmemCacheStats
+ *
+ * Description: Copies out the usage statistics of one size class.
+ *
+ * Parameters:
+ *              sizeClass - Class index (0 to KMEMCLASSES - 1)
+ *              stats - Buffer to fill
+ *
+ * Returns:
+ *              SUCCESS, or ERROR if the class does not exist
+ * ======================================================================== */
+int kmemCacheStats(int sizeClass, kmemStat_PTR stats) {
+    if ((sizeClass < 0) || (sizeClass >= KMEMCLASSES)) {
+        return ERROR;
+    }
+    unsigned int status = lockSlab();
+    *stats = cacheStats[sizeClass];
+    unlockSlab(status);
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * Function: takeFrame
+ *
+ * Description: Takes a frame from the stack of freed frames, or else the
+ *              next one past the cursor. Called with slabLock held.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              Address of the frame, or NOFRAME if none is left
+ * ======================================================================== */
+HIDDEN memaddr takeFrame() {
+    memaddr frame = freedFrames;
+    if (frame != NOFRAME) {
+        freedFrames = *((memaddr *)frame);
+        return frame;
+    }
+    if ((slabNext == NOFRAME) || ((slabNext + PAGESIZE) > slabLimit)) {
+        return NOFRAME;
+    }
+    frame = slabNext;
+    slabNext += PAGESIZE;
+    return frame;
+}
+
+/* ========================================================================
+ * Function: releaseFrame
+ *
+ * Description: Puts a frame on the stack of freed frames. Called with
+ *              slabLock held.
+ *
+ * Parameters:
+ *              frame - Address of the frame
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void releaseFrame(memaddr frame) {
+    *((memaddr *)frame) = freedFrames;
+    freedFrames = frame;
+}
+
+/* ========================================================================
+ * Function: growCache
+ *
+ * Description: Takes a frame, links all its objects of one size class
+ *              into its free list and puts it on the cache's partial
+ *              list. Called with slabLock held.
+ *
+ * Parameters:
+ *              sizeClass - Class index
+ *
+ * Returns:
+ *              Index of the new frame, or NOSLAB if none is left
+ * ======================================================================== */
+HIDDEN int growCache(int sizeClass) {
+    memaddr frame = takeFrame();
+    if (frame == NOFRAME) {
+        return NOSLAB;
+    }
+
+    int frameIndex = SLABINDEX(frame);
+    unsigned int size = cacheStats[sizeClass].ks_size;
+    int i;
+    frameObjects[frameIndex] = NOFRAME;
+    for (i = (PAGESIZE / size) - 1; i >= 0; i--) {
+        memaddr object = frame + (i * size);
+        *((memaddr *)object) = frameObjects[frameIndex];
+        frameObjects[frameIndex] = object;
+    }
+    frameClass[frameIndex] = sizeClass;
+    frameUsed[frameIndex] = 0;
+    partialPrev[frameIndex] = NOSLAB;
+    partialNext[frameIndex] = partialHead[sizeClass];
+    if (partialHead[sizeClass] != NOSLAB) {
+        partialPrev[partialHead[sizeClass]] = frameIndex;
+    }
+    partialHead[sizeClass] = frameIndex;
+    cacheStats[sizeClass].ks_frames++;
+    cacheStats[sizeClass].ks_free += PAGESIZE / size;
+    return frameIndex;
+}
+
+/* ========================================================================
+ * Function: unlinkPartial
+ *
+ * Description: Takes a frame off its cache's partial list. Called with
+ *              slabLock held.
+ *
+ * Parameters:
+ *              sizeClass - Class index
+ *              frameIndex - Slab frame index
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void unlinkPartial(int sizeClass, int frameIndex) {
+    if (partialPrev[frameIndex] != NOSLAB) {
+        partialNext[partialPrev[frameIndex]] = partialNext[frameIndex];
+    } else {
+        partialHead[sizeClass] = partialNext[frameIndex];
+    }
+    if (partialNext[frameIndex] != NOSLAB) {
+        partialPrev[partialNext[frameIndex]] = partialPrev[frameIndex];
+    }
+    partialNext[frameIndex] = NOSLAB;
+    partialPrev[frameIndex] = NOSLAB;
+}
+
+/* ========================================================================
+ * Function: lockSlab
+ *
+ * Description: Disables interrupts, so a holder is never preempted, and
+ *              takes slabLock when more than one processor runs.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              The Status register to restore with unlockSlab
+ * ======================================================================== */
+HIDDEN unsigned int lockSlab() {
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    if (CPUCOUNT > 1) {
+        acquireSpin(&slabLock);
+    }
+    return status;
+}
+
+/* ========================================================================
+ * Function: unlockSlab
+ *
+ * Description: Releases slabLock and restores the interrupt state.
+ *
+ * Parameters:
+ *              status - Status register returned by lockSlab
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void unlockSlab(unsigned int status) {
+    if (CPUCOUNT > 1) {
+        releaseSpin(&slabLock);
+    }
+    setSTATUS(status);
+}
@@ -0,0 +1,109 @@
+/******************************* spinlock.c *************************************
+ *
+ * Module: Nucleus Lock
+ *
+ * Description:
+ * This module provides the spinlocks the nucleus needs once more than one
+ * processor runs it (CPUCOUNT > 1): the PCB pool, the ASL, the ready
+ * queues and every other nucleus table are shared by all processors.
+ *
+ * Implementation:
+ * A lock is a word that is 0 when free and 1 when taken; acquireSpin
+ * retries the uMPS3 CAS instruction until it swaps 0 for 1. The nucleus
+ * takes one coarse lock, kernelLock: exceptionHandler acquires it on every
+ * kernel entry, and it is released right before the processor leaves the
+ * nucleus (the LDST in loadProcessState, the LDCXT of a pass up, and the
+ * WAIT of an idle processor). The nucleus runs with interrupts off, so a
+ * processor never re-enters it while holding the lock. The TLB refill
+ * handler only reads page tables and never takes it. With one processor
+ * the lock is never touched.
+ *
+ * Functions:
+ * - acquireSpin: Spins until a lock is taken.
+ * - releaseSpin: Releases a lock.
+ * - acquireKernel: Takes the nucleus lock on kernel entry.
+ * - releaseKernel: Releases the nucleus lock before leaving the nucleus.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/spinlock.h"
+
+/******************** Module Variables ********************/
+HIDDEN volatile unsigned int kernelLock = 0;   /* The coarse nucleus lock */
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: acquireSpin
+ *
+ * Description: Spins until the lock is taken. While it is held elsewhere
+ *              only plain reads are issued, so the waiting processors do
+ *              not keep the bus busy with CAS.
+ * 
+ * Parameters:
+ *              lock - Lock word (0 free, 1 taken)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void acquireSpin(volatile unsigned int *lock) {
+    while (!CAS((unsigned int *)lock, 0, 1)) {
+        while (*lock != 0) {
+            ; /* Held by another processor */
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: releaseSpin
+ *
+ * Description: Releases a lock taken with acquireSpin.
+ * 
+ * Parameters:
+ *              lock - Lock word
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void releaseSpin(volatile unsigned int *lock) {
+    *lock = 0;
+}
+
+/* ========================================================================
+ * Function: acquireKernel
+ *
+ * Description: Takes the nucleus lock. Called first thing on every kernel
+ *              entry and by a processor starting up.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void acquireKernel() {
+    if (CPUCOUNT > 1) {
+        acquireSpin(&kernelLock);
+    }
+}
+
+/* ========================================================================
+ * Function: releaseKernel
+ *
+ * Description: Releases the nucleus lock. Called right before the
+ *              processor leaves the nucleus, with interrupts still off.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void releaseKernel() {
+    if (CPUCOUNT > 1) {
+        releaseSpin(&kernelLock);
+    }
+}
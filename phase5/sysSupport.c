@@ -7,21 +7,71 @@
  * non-TLB exceptions that are passed up from the Nucleus.
  * The module handles user-level system calls (SYS9 and above).
  *
+ * SYSCALLs are dispatched through a table indexed by number. Each entry
+ * names the service and describes the user buffer it takes (the argument
+ * holding its address, the one holding its element count, the element
+ * size and the allowed counts), and the whole buffer is validated in one
+ * place before the service runs. The same place times every call.
+ *
  * Policy Decisions:
- * - Memory Protection: All user-provided addresses are validated to ensure they
- *   fall within user address space (KUSEG), preventing access to kernel memory
+ * - Memory Protection: Every page a described buffer touches, from its
+ *   first byte to its last, must be user memory (validateUserAddress),
+ *   preventing access to kernel memory. Services in other modules check their own
+ *   arguments, since their limits depend on the device, sector or page
  * - Error Handling: Invalid parameters or addresses result in immediate process
  *   termination
+ * - Buffered Output: With TERMBUFFERED set, SYS12 returns once its string
+ *   is in the terminal's transmit ring (terminalDaemon.c); a transmit
+ *   error is reported by the next SYS12
+ * - Spooled Printing: With PRINTSPOOLED set, SYS11 returns once its string
+ *   is in the printer's spool (printerSpooler.c); a print error is
+ *   reported by the next SYS11
+ * - Batching: SYS31 runs up to BATCHMAX records of {number, a1, a2, a3,
+ *   result} in order within one trap, writing each call's v0 back to its
+ *   record. A nested SYS31 record gets ERROR. With BATCHSTOPFAIL set in a3
+ *   it stops after the first negative result
+ * - Streaming: SYS41 and SYS42 are SYS11 and SYS12 without the
+ *   MAXSTRINGLEN limit: the buffer may span any number of pages, and the
+ *   device (or its spool or ring) is taken once for the whole transfer
+ * - Type-Ahead: With TYPEAHEAD set, SYS13 takes a whole line from the
+ *   terminal's input ring, filled by a reader daemon that keeps the
+ *   receiver armed
+ * - Counters: Every Support Level SYSCALL is counted by number, a batch
+ *   once as SYS31 and once per record. SYS32 copies the counter block of
+ *   one ASID (or with a2 = 0 the nucleus-wide block, with a2 = SELFASID
+ *   the caller's own) to the user buffer
+ * - Profiling: SYS33 only starts, stops and reads the caller's own PC
+ *   profile; a U-proc cannot sample another ASID
+ * - Contention: SYS34 copies the per-semaphore contention statistics kept
+ *   by the nucleus (contention.c) to the user array
+ * - Call Statistics: Every call is timed from dispatch to the service's
+ *   return, so a call that blocks counts its waiting time. SYS40 copies the
+ *   count, total and longest time of one SYSCALL number
 
  * Functions:
  * - genExceptionHandler: Routes exceptions to appropriate handlers based on cause
  * - syscallExceptionHandler: Dispatches user-level SYSCALL requests
+ * - dispatchSyscall: Validates and performs one SYSCALL described by the saved state
+ * - validateArguments: Checks the user buffer a table entry describes
+ * - runBatch: Implements batched SYSCALLs for SYS31
  * - programTrapExceptionHandler: Handles program traps passed up to Support Level
  * - getCurrentSupportStruct: Helper to get current process's support structure
  * - getTimeOfDay: Retrieves current time of day for SYS10
- * - writePrinter: Implements printer write operations for SYS11
- * - writeTerminal: Implements terminal write operations for SYS12
+ * - writePrinter: Implements printer write operations for SYS11 and SYS41
+ * - writeTerminal: Implements terminal write operations for SYS12 and SYS42
  * - readTerminal: Implements terminal read operations for SYS13
+ * - getCpuTimes: Returns the CPU time breakdown for SYS21
+ * - readTrace: Drains scheduler trace events into a user buffer for SYS22
+ * - getLatency: Copies one line's interrupt latency histograms for SYS23
+ * - getCounters: Copies one performance counter block for SYS32
+ * - profile: Starts, stops or reads the caller's PC profile for SYS33
+ * - getLockStats: Copies the semaphore contention statistics for SYS34
+ * - getDevStats: Copies one device's utilization statistics for SYS35
+ * - getSysStats: Copies one SYSCALL number's call statistics for SYS40
+ * - getBootTimes: Copies the boot phase times for SYS56
+ * - getGroupStats: Copies one resource group's limits and usage for SYS58
+ * - unusedSyscall: Table entry for the numbers with no service
+ * - terminate, delay, delayMicro: Table entries for SYS9, SYS18 and SYS28
  *
  * Written by Aryah Rao & Anish Reddy
  *
@@ -34,25 +84,146 @@
 /*----------------------------------------------------------------------------*/
 /* vmSupport.c */
 extern void terminateUProcess(int *mutex);
+extern void exitUProcess(int *mutex, int reason);
 extern void setInterrupts(int toggle);
 extern void resumeState(state_PTR state);
 extern int validateUserAddress(memaddr address);
 /* deldayDaemon.c */
 extern void delaySyscallHandler(support_PTR supportStruct);
+extern void delayMicroSyscallHandler(support_PTR supportStruct);
 /* deviceSupportDMA.c */
 extern int diskPutSyscallHandler(support_PTR supportStruct);
 extern int diskGetSyscallHandler(support_PTR supportStruct);
+extern int diskPutVSyscallHandler(support_PTR supportStruct);
+extern int diskGetVSyscallHandler(support_PTR supportStruct);
+extern int ioShareSyscallHandler(support_PTR supportStruct);
+/* terminalDaemon.c */
+extern int bufferTerminalOutput(int termNum, char *charAddress, int length);
+extern int readBufferedLine(int termNum, char *charAddress);
+/* printerSpooler.c */
+extern int spoolPrinterOutput(int printNum, char *charAddress, int length);
+/* asyncIO.c */
+extern int aioSubmitSyscallHandler(support_PTR supportStruct);
+extern int aioWaitSyscallHandler(support_PTR supportStruct);
 extern int flashPutSyscallHandler(support_PTR supportStruct);
 extern int flashGetSyscallHandler(support_PTR supportStruct);
+/* userSemaphore.c */
+extern int pSemTimedSyscallHandler(support_PTR supportStruct);
+extern int vSemNamedSyscallHandler(support_PTR supportStruct);
+extern int pSemNamedSyscallHandler(support_PTR supportStruct);
+/* mailbox.c */
+extern int msgSendSyscallHandler(support_PTR supportStruct);
+extern int msgReceiveSyscallHandler(support_PTR supportStruct);
+/* initProc.c */
+extern int respawnSyscallHandler(support_PTR supportStruct);
+extern int forkSyscallHandler(support_PTR supportStruct);
+/* reaper.c */
+extern int reapSyscallHandler(support_PTR supportStruct);
+/* futex.c */
+extern int futexWaitSyscallHandler(support_PTR supportStruct);
+extern int futexWakeSyscallHandler(support_PTR supportStruct);
+/* thread.c */
+extern int threadCreateSyscallHandler(support_PTR supportStruct);
+extern int threadJoinSyscallHandler(support_PTR supportStruct);
+extern int threadExitSyscallHandler(support_PTR supportStruct);
+/* waitAny.c */
+extern int waitAnySyscallHandler(support_PTR supportStruct);
+/* network.c */
+extern int netSendSyscallHandler(support_PTR supportStruct);
+extern int netRecvSyscallHandler(support_PTR supportStruct);
+/* diskVolume.c */
+extern int volumePutSyscallHandler(support_PTR supportStruct);
+extern int volumeGetSyscallHandler(support_PTR supportStruct);
+/* checkpoint.c */
+extern int checkpointSyscallHandler(support_PTR supportStruct);
 
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
 /*----------------------------------------------------------------------------*/
 HIDDEN void programTrapExceptionHandler();
-HIDDEN cpu_t getTimeOfDay();
+HIDDEN void dispatchSyscall(support_PTR supportStruct);
+HIDDEN void validateArguments(sysEntry_PTR entry, state_PTR exceptState);
+HIDDEN int runBatch(support_PTR supportStruct);
+HIDDEN int unusedSyscall(support_PTR supportStruct);
+HIDDEN int terminate(support_PTR supportStruct);
+HIDDEN int getTimeOfDay(support_PTR supportStruct);
 HIDDEN int writePrinter(support_PTR supportStruct);
 HIDDEN int writeTerminal(support_PTR supportStruct);
 HIDDEN int readTerminal(support_PTR supportStruct);
+HIDDEN int delay(support_PTR supportStruct);
+HIDDEN int getCpuTimes(support_PTR supportStruct);
+HIDDEN int readTrace(support_PTR supportStruct);
+HIDDEN int getLatency(support_PTR supportStruct);
+HIDDEN int getCounters(support_PTR supportStruct);
+HIDDEN int profile(support_PTR supportStruct);
+HIDDEN int getLockStats(support_PTR supportStruct);
+HIDDEN int getDevStats(support_PTR supportStruct);
+HIDDEN int delayMicro(support_PTR supportStruct);
+HIDDEN int getSysStats(support_PTR supportStruct);
+HIDDEN int getBootTimes(support_PTR supportStruct);
+HIDDEN int getGroupStats(support_PTR supportStruct);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+/* The services by number (from SUPMINSYSCALL), with the buffer each takes:
+ * handler, buffer argument, count argument, element size, count range */
+HIDDEN sysEntry_t syscallTable[SUPSYSCALLS] = {
+    {terminate,                 NOARG, NOARG, 0, 0, 0},                             /* SYS9: TERMINATE */
+    {getTimeOfDay,              NOARG, NOARG, 0, 0, 0},                             /* SYS10: GET TOD */
+    {writePrinter,              1, 2, 1, 1, MAXSTRINGLEN},                          /* SYS11: WRITE TO PRINTER */
+    {writeTerminal,             1, 2, 1, 1, MAXSTRINGLEN},                          /* SYS12: WRITE TO TERMINAL */
+    {readTerminal,              1, NOARG, 1, 1, 1},                                 /* SYS13: READ FROM TERMINAL */
+    {diskPutSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS14: Disk Put */
+    {diskGetSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS15: Disk Get */
+    {flashPutSyscallHandler,    NOARG, NOARG, 0, 0, 0},                             /* SYS16: Flash Put */
+    {flashGetSyscallHandler,    NOARG, NOARG, 0, 0, 0},                             /* SYS17: Flash Get */
+    {delay,                     NOARG, NOARG, 0, 0, 0},                             /* SYS18: DELAY */
+    {unusedSyscall,             NOARG, NOARG, 0, 0, 0},                             /* SYS19: unused */
+    {unusedSyscall,             NOARG, NOARG, 0, 0, 0},                             /* SYS20: unused */
+    {getCpuTimes,               1, NOARG, sizeof(cpuTimes_t), 1, 1},                /* SYS21: GET CPU TIMES */
+    {readTrace,                 1, 2, sizeof(traceEvent_t), 0, MAXINT},             /* SYS22: READ TRACE */
+    {getLatency,                2, NOARG, sizeof(latencyHist_t), 1, 1},             /* SYS23: GET LATENCY */
+    {diskPutVSyscallHandler,    NOARG, NOARG, 0, 0, 0},                             /* SYS24: Vectored Disk Put */
+    {diskGetVSyscallHandler,    NOARG, NOARG, 0, 0, 0},                             /* SYS25: Vectored Disk Get */
+    {aioSubmitSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS26: Async I/O Submit */
+    {aioWaitSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS27: Async I/O Wait */
+    {delayMicro,                NOARG, NOARG, 0, 0, 0},                             /* SYS28: Microsecond Delay */
+    {pSemTimedSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS29: Timed P on a named semaphore */
+    {vSemNamedSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS30: V on a named semaphore */
+    {runBatch,                  1, 2, sizeof(batchRecord_t), 1, BATCHMAX},          /* SYS31: BATCHED SYSCALLS */
+    {getCounters,               1, NOARG, sizeof(perfBlock_t), 1, 1},               /* SYS32: GET PERFORMANCE COUNTERS */
+    {profile,                   NOARG, NOARG, 0, 0, 0},                             /* SYS33: PC SAMPLING PROFILER */
+    {getLockStats,              1, 2, sizeof(lockStat_t), 0, MAXINT},               /* SYS34: GET SEMAPHORE CONTENTION */
+    {getDevStats,               1, NOARG, sizeof(devStat_t), 1, 1},                 /* SYS35: GET DEVICE STATISTICS */
+    {msgSendSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS36: SEND MESSAGE */
+    {msgReceiveSyscallHandler,  NOARG, NOARG, 0, 0, 0},                             /* SYS37: RECEIVE MESSAGE */
+    {shmAttachSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS38: ATTACH SHARED SEGMENT */
+    {pSemNamedSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS39: P on a named semaphore */
+    {getSysStats,               2, NOARG, sizeof(sysStat_t), 1, 1},                 /* SYS40: GET SYSCALL STATISTICS */
+    {writePrinter,              1, 2, 1, 1, MAXINT},                                /* SYS41: STREAM TO PRINTER */
+    {writeTerminal,             1, 2, 1, 1, MAXINT},                                /* SYS42: STREAM TO TERMINAL */
+    {respawnSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS43: RESPAWN */
+    {reapSyscallHandler,        1, NOARG, sizeof(exitRecord_t), 1, 1},              /* SYS44: REAP */
+    {pinPagesSyscallHandler,    1, 2, PAGESIZE, 1, WIREMAXPAGES},                   /* SYS45: PIN PAGES */
+    {futexWaitSyscallHandler,   1, NOARG, WORDLEN, 1, 1},                           /* SYS46: WAIT ON A USER WORD */
+    {futexWakeSyscallHandler,   1, NOARG, WORDLEN, 1, 1},                           /* SYS47: WAKE WAITERS ON A USER WORD */
+    {forkSyscallHandler,        NOARG, NOARG, 0, 0, 0},                             /* SYS48: FORK */
+    {threadCreateSyscallHandler, NOARG, NOARG, 0, 0, 0},                            /* SYS49: CREATE THREAD */
+    {threadJoinSyscallHandler,  NOARG, NOARG, 0, 0, 0},                             /* SYS50: JOIN THREAD */
+    {threadExitSyscallHandler,  NOARG, NOARG, 0, 0, 0},                             /* SYS51: EXIT THREAD */
+    {diskMapSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS52: MAP DISK SECTORS */
+    {waitAnySyscallHandler,     1, 2, sizeof(waitEvent_t), 1, WAITANYMAX},          /* SYS53: WAIT FOR ANY EVENT */
+    {netSendSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS54: SEND A PACKET */
+    {netRecvSyscallHandler,     NOARG, NOARG, 0, 0, 0},                             /* SYS55: RECEIVE A PACKET */
+    {getBootTimes,              1, NOARG, sizeof(bootTimes_t), 1, 1},               /* SYS56: GET BOOT PHASE TIMES */
+    {ioShareSyscallHandler,     1, NOARG, sizeof(ioShare_t), 1, 1},                 /* SYS57: SET I/O WEIGHT AND READ I/O SHARE */
+    {getGroupStats,             1, NOARG, sizeof(groupStat_t), 1, 1},               /* SYS58: GET RESOURCE GROUP STATISTICS */
+    {volumePutSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS59: WRITE TO THE DISK VOLUME */
+    {volumeGetSyscallHandler,   NOARG, NOARG, 0, 0, 0},                             /* SYS60: READ FROM THE DISK VOLUME */
+    {checkpointSyscallHandler,  NOARG, NOARG, 0, 0, 0},                             /* SYS61: CHECKPOINT THE CALLING U-PROC */
+};
+HIDDEN sysStat_t syscallStats[SUPSYSCALLS];    /* Call statistics by number */
 
 /*----------------------------------------------------------------------------*/
 /* Global Function Implementations */
@@ -127,55 +298,154 @@ void syscallExceptionHandler(support_PTR supportStruct) {
     /* Increment PC to next instruction */
     exceptState->s_pc += WORDLEN;
 
-    /* Dispatch based on SYSCALL number */
-    switch (exceptState->s_a0) {
-        case TERMINATE:     /* SYS9: TERMINATE */
-            terminateUProcess(NULL);
-            break;
-            
-        case GET_TOD:       /* SYS10: GET TOD */
-            exceptState->s_v0 = getTimeOfDay();
-            break;
-            
-        case WRITEPRINTER:  /* SYS11: WRITE TO PRINTER */
-            exceptState->s_v0 = writePrinter(supportStruct);
-            break;
-            
-        case WRITETERMINAL: /* SYS12: WRITE TO TERMINAL */
-            exceptState->s_v0 = writeTerminal(supportStruct);
-            break;
-            
-        case READTERMINAL:  /* SYS13: READ FROM TERMINAL */
-            exceptState->s_v0 = readTerminal(supportStruct);
-            break;
+    dispatchSyscall(supportStruct);
 
-        case DISK_PUT:      /* SYS14: Disk Put */
-            exceptState->s_v0 = diskPutSyscallHandler(supportStruct);
-            break;
+    /* Return to user process */
+    resumeState(exceptState);    
+}
 
-        case DISK_GET:      /* SYS15: Disk Get */
-            exceptState->s_v0 = diskGetSyscallHandler(supportStruct);
-            break;
+/******************************************************************************
+ *
+ * Function: dispatchSyscall
+ *
+ * Description:
+ *   Performs the Support Level SYSCALL whose number and arguments are in
+ *   a0-a3 of the saved exception state, leaving its result in v0. The
+ *   number selects the syscallTable entry, whose user buffer is validated
+ *   before the service runs; the call is then timed into syscallStats.
+ *
+ * Parameters:
+ *   supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *   None (the result is in the saved v0)
+ *
+ *****************************************************************************/
+void dispatchSyscall(support_PTR supportStruct) {
+    /* Access the saved exception state */
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    int number = exceptState->s_a0;
+    perfCountSyscall(number, supportStruct->sup_asid);
 
-        case FLASH_PUT:     /* SYS16: Flash Put */
-            exceptState->s_v0 = flashPutSyscallHandler(supportStruct);
-            break;
+    /* Unknown SYSCALL number */
+    if ((number < SUPMINSYSCALL) || (number > SUPMAXSYSCALL)) {
+        programTrapExceptionHandler();
+    }
 
-        case FLASH_GET:     /* SYS17: Flash Get */
-            exceptState->s_v0 = flashGetSyscallHandler(supportStruct);
-            break;
+    sysEntry_PTR entry = &syscallTable[number - SUPMINSYSCALL];
+    validateArguments(entry, exceptState);
 
-        case DELAY:         /* SYS18: DELAY */
-            delaySyscallHandler(supportStruct);
-            break;
-            
-        default:            /* Unknown SYSCALL number */
-            programTrapExceptionHandler();
-            break;
+    /* Run the service, timing it */
+    cpu_t start, end;
+    STCK(start);
+    exceptState->s_v0 = entry->se_handler(supportStruct);
+    STCK(end);
+
+    sysStat_PTR stat = &syscallStats[number - SUPMINSYSCALL];
+    setInterrupts(OFF);
+    stat->ss_calls++;
+    stat->ss_totalTime += end - start;
+    if ((end - start) > stat->ss_maxTime) {
+        stat->ss_maxTime = end - start;
     }
+    setInterrupts(ON);
+}
 
-    /* Return to user process */
-    resumeState(exceptState);    
+/******************************************************************************
+ *
+ * Function: validateArguments
+ *
+ * Description: Checks the user buffer a SYSCALL table entry describes: its
+ *              element count must be in the entry's range, and unless it is
+ *              empty every page from its first byte to its last must be
+ *              user memory (with no wrap past the top of memory).
+ *              Terminates the U-proc otherwise.
+ *
+ * Parameters:
+ *              entry - The SYSCALL's table entry
+ *              exceptState - Saved state holding the arguments in a1-a3
+ *
+ * Returns:
+ *              None (only if the arguments are valid)
+ *
+ *****************************************************************************/
+void validateArguments(sysEntry_PTR entry, state_PTR exceptState) {
+    if (entry->se_buffer == NOARG) {
+        return;
+    }
+
+    /* a0-a3 are consecutive registers, so argument n is n past a0 */
+    memaddr buffer = (&exceptState->s_a0)[entry->se_buffer];
+    int count = 1;
+    if (entry->se_count != NOARG) {
+        count = (&exceptState->s_a0)[entry->se_count];
+    }
+
+    if ((count < entry->se_minCount) || (count > entry->se_maxCount)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    if (count == 0) {
+        return;
+    }
+    if (!validateUserAddress(buffer) || ((memaddr)count > (0 - buffer) / entry->se_size)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Every page up to the last byte (user pages are not contiguous) */
+    memaddr lastPage = (buffer + (count * entry->se_size) - 1) & VPNMASK;
+    memaddr page = buffer & VPNMASK;
+    while (page != lastPage) {
+        page += PAGESIZE;
+        if (!validateUserAddress(page)) {
+            terminateUProcess(NULL); /* Nuke it! */
+        }
+    }
+}
+
+/******************************************************************************
+ *
+ * Function: runBatch
+ *
+ * Description: Runs the SYS31 records at a1 (a2 of them) in order, each
+ *              through dispatchSyscall as if it had trapped by itself, and
+ *              writes each result back to its record. A nested SYS31 record
+ *              gets ERROR. With BATCHSTOPFAIL set in a3 the batch ends
+ *              after the first negative result.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Number of records run
+ *
+ *****************************************************************************/
+int runBatch(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    batchRecord_PTR records = (batchRecord_PTR)exceptState->s_a1;
+    int count = exceptState->s_a2;
+    int flags = exceptState->s_a3;
+
+    /* The records were validated by dispatchSyscall */
+    int done = 0;
+    while (done < count) {
+        /* Load the record into the saved state and run it */
+        int result = ERROR;
+        if (records[done].br_number != BATCH) {
+            exceptState->s_a0 = records[done].br_number;
+            exceptState->s_a1 = records[done].br_a1;
+            exceptState->s_a2 = records[done].br_a2;
+            exceptState->s_a3 = records[done].br_a3;
+            dispatchSyscall(supportStruct);
+            result = exceptState->s_v0;
+        }
+
+        records[done].br_result = result;
+        done++;
+        if ((flags & BATCHSTOPFAIL) && (result < 0)) {
+            break;
+        }
+    }
+    return done;
 }
 
 /******************************************************************************
@@ -222,6 +492,43 @@ void programTrapExceptionHandler() {
 }
 
 
+/******************************************************************************
+ *
+ * Function: unusedSyscall
+ *
+ * Description: Table entry for a SYSCALL number with no service: treated
+ *              as a Program Trap, like a number outside the table.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Does not return
+ *
+ *****************************************************************************/
+int unusedSyscall(support_PTR supportStruct) {
+    programTrapExceptionHandler();
+    return ERROR;
+}
+
+/******************************************************************************
+ *
+ * Function: terminate
+ *
+ * Description: Terminates the calling U-proc. This implements SYS9.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Does not return
+ *
+ *****************************************************************************/
+int terminate(support_PTR supportStruct) {
+    exitUProcess(NULL, EXITSYS9);
+    return ERROR;
+}
+
 /******************************************************************************
  *
  * Function: getTimeOfDay
@@ -231,17 +538,17 @@ void programTrapExceptionHandler() {
  *   This implements the functionality for SYS10.
  *
  * Parameters:
- *   None.
+ *   supportStruct - Pointer to the process's support structure (unused)
  *
  * Returns:
  *   Current time of day value.
  *
  *****************************************************************************/
-cpu_t getTimeOfDay() {
+int getTimeOfDay(support_PTR supportStruct) {
     /* Retrieve current time of day */
     cpu_t currentTime;
     STCK(currentTime);
-    return currentTime;
+    return (int)currentTime;
 }
 
 
@@ -250,7 +557,9 @@ cpu_t getTimeOfDay() {
  * Function: writePrinter
  *
  * Description: Writes a character string to the printer device associated 
- *              with the process
+ *              with the process, holding the device for the whole string.
+ *              With PRINTSPOOLED set the string is only copied into the
+ *              printer's spool. SYS41 runs it on strings of any length
  *
  * Parameters:
  *              supportStruct - Pointer to the process's support structure
@@ -264,31 +573,30 @@ int writePrinter(support_PTR supportStruct) {
     int length = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
     int printNum = supportStruct->sup_asid-1;
 
-    /* Validate address and length */
-    if ((((memaddr)charAddress < KUSEG)) || (length <= 0) || (length > MAXSTRINGLEN)) {
-        terminateUProcess(NULL); /* Nuke it! */
+    /* Hand the string to the printer's spool daemon */
+    if (PRINTSPOOLED) {
+        return spoolPrinterOutput(printNum, charAddress, length);
     }
 
-    /* Calculate device semaphore index based on line and device number */
-    int printerMutex = ((PRNTINT - MAPINT) * DEV_PER_LINE) + (printNum);
+    /* Look up the printer's descriptor */
+    devDesc_PTR printer = DEVDESC(PRNTINT, printNum);
         
     /* Gain device mutex for the printer device */
-    SYSCALL(PASSEREN, (int)&deviceMutex[printerMutex], 0, 0);
+    SYSCALL(PASSEREN, (int)printer->dd_mutex, 0, 0);
 
     int index = 0; /* Number of characters written */
-    devregarea_t* devRegisterArea = (devregarea_t*) RAMBASEADDR;
 
     while (index < length) {
-        devRegisterArea->devreg[printerMutex].d_data0 = *charAddress; /* Character to write */
+        printer->dd_reg->d_data0 = *charAddress; /* Character to write */
 
         /* Atomically write a character to the printer device */
         setInterrupts(OFF);
-        devRegisterArea->devreg[printerMutex].d_command = PRINTCHR;
+        printer->dd_reg->d_command = PRINTCHR;
         int status = SYSCALL(WAITIO, PRNTINT, printNum, 0);
         setInterrupts(ON);
 
         if (status != READY) { /* Write failed */
-            SYSCALL(VERHOGEN, (int)&deviceMutex[printerMutex], 0, 0);
+            SYSCALL(VERHOGEN, (int)printer->dd_mutex, 0, 0);
             return -status;
         }
         /* Next character */
@@ -297,7 +605,7 @@ int writePrinter(support_PTR supportStruct) {
     }
 
     /* Release device mutex for the printer device */
-    SYSCALL(VERHOGEN, (int)&deviceMutex[printerMutex], 0, 0);
+    SYSCALL(VERHOGEN, (int)printer->dd_mutex, 0, 0);
 
     return index; /* Return the number of characters written */
 }
@@ -307,7 +615,10 @@ int writePrinter(support_PTR supportStruct) {
  * Function: writeTerminal
  *
  * Description: Writes a character string to the terminal device associated 
- *              with the process
+ *              with the process, holding the device for the whole string.
+ *              With TERMBUFFERED set the string is only copied into the
+ *              terminal's transmit ring. SYS42 runs it on strings of any
+ *              length
  *
  * Parameters:
  *              supportStruct - Pointer to the process's support structure
@@ -321,29 +632,28 @@ int writeTerminal(support_PTR supportStruct) {
     int length = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
     int termNum = supportStruct->sup_asid-1;
 
-    /* Validate address and length */
-    if (((memaddr)charAddress < KUSEG) || (length <= 0) || (length > MAXSTRINGLEN)) {
-        terminateUProcess(NULL); /* Nuke it! */
+    /* Hand the string to the terminal's writer daemon */
+    if (TERMBUFFERED) {
+        return bufferTerminalOutput(termNum, charAddress, length);
     }
 
-    /* Calculate device semaphore index based on line and device number */
-    int termMutex = ((TERMINT - MAPINT) * DEV_PER_LINE) + (termNum);
+    /* Look up the terminal transmitter's descriptor */
+    devDesc_PTR terminal = DEVDESC(TERMINT, termNum);
 
     /* Gain device mutex for the terminal device */
-    SYSCALL(PASSEREN, (int)&deviceMutex[termMutex], 0, 0);
+    SYSCALL(PASSEREN, (int)terminal->dd_mutex, 0, 0);
 
     int index = 0; /* Number of characters written */
-    devregarea_t* devRegisterArea = (devregarea_t*) RAMBASEADDR;
 
     while (index < length) {
         /* Atomically write a character to the terminal device */
         setInterrupts(OFF);
-        devRegisterArea->devreg[termMutex].t_transm_command = *charAddress << BYTELEN | PRINTCHR;
+        terminal->dd_reg->t_transm_command = *charAddress << BYTELEN | PRINTCHR;
         int status = SYSCALL(WAITIO, TERMINT, termNum, 0);
         setInterrupts(ON);
 
         if ((status & TERMSTATMASK) != RECVD) { /* Write failed */
-            SYSCALL(VERHOGEN, (int)&deviceMutex[termMutex], 0, 0);
+            SYSCALL(VERHOGEN, (int)terminal->dd_mutex, 0, 0);
             return -status;
         }
         /* Next character */
@@ -352,7 +662,7 @@ int writeTerminal(support_PTR supportStruct) {
     }
 
     /* Release device mutex for the terminal device */
-    SYSCALL(VERHOGEN, (int)&deviceMutex[termMutex], 0, 0);
+    SYSCALL(VERHOGEN, (int)terminal->dd_mutex, 0, 0);
 
     return index; /* Return the number of characters written */
 }
@@ -364,6 +674,7 @@ int writeTerminal(support_PTR supportStruct) {
  * Description:
  *   Reads a line of input from the terminal device associated with the process.
  *   Reading continues until a newline character is encountered or an error occurs.
+ *   With TYPEAHEAD set the line comes from the terminal's input ring.
  *   This implements the functionality for SYS13.
  *
  * Parameters:
@@ -377,30 +688,29 @@ int readTerminal(support_PTR supportStruct) {
     char *charAddress = (char*)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
     int termNum = supportStruct->sup_asid-1;
 
-    /* Validate address */
-    if ((memaddr)charAddress < KUSEG) {
-        terminateUProcess(NULL); /* Nuke it! */
+    /* Take a line the terminal's reader daemon has already collected */
+    if (TYPEAHEAD) {
+        return readBufferedLine(termNum, charAddress);
     }
 
-    /* Calculate device semaphore index based on line and device number */
-    int termMutex = ((TERMINT - MAPINT) * DEV_PER_LINE) + (termNum) + DEV_PER_LINE;
+    /* Look up the terminal receiver's descriptor */
+    devDesc_PTR terminal = TERMRECVDESC(termNum);
         
     /* Gain device mutex for the terminal device */
-    SYSCALL(PASSEREN, (int)&deviceMutex[termMutex], 0, 0);
+    SYSCALL(PASSEREN, (int)terminal->dd_mutex, 0, 0);
 
     int index = 0; /* Number of characters read */
-    devregarea_t* devRegisterArea = (devregarea_t*) RAMBASEADDR;
     int running = TRUE;
 
     while (running) {
         /* Atomically read a character from the terminal device */
         setInterrupts(OFF);
-        devRegisterArea->devreg[termMutex - DEV_PER_LINE].t_recv_command = PRINTCHR;
+        terminal->dd_reg->t_recv_command = PRINTCHR;
         int status = SYSCALL(WAITIO, TERMINT, termNum, 1);
         setInterrupts(ON);
 
         if ((status & TERMSTATMASK) != RECVD) {  /* Read failed */
-            SYSCALL(VERHOGEN, (int)&deviceMutex[termMutex], 0, 0);
+            SYSCALL(VERHOGEN, (int)terminal->dd_mutex, 0, 0);
             return -status;
         }
         index++; /* Increment the number of characters read */
@@ -419,7 +729,401 @@ int readTerminal(support_PTR supportStruct) {
     }
 
     /* Release device mutex for the terminal device */
-    SYSCALL(VERHOGEN, (int)&deviceMutex[termMutex], 0, 0);
+    SYSCALL(VERHOGEN, (int)terminal->dd_mutex, 0, 0);
 
     return index; /* Return the number of characters read */
 }
+
+/******************************************************************************
+ *
+ * Function: delay
+ *
+ * Description: Sleeps the calling U-proc for a1 seconds with the Delay
+ *              Daemon. This implements SYS18.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              SUCCESS
+ *
+ *****************************************************************************/
+int delay(support_PTR supportStruct) {
+    delaySyscallHandler(supportStruct);
+    return SUCCESS;
+}
+
+/******************************************************************************
+ *
+ * Function: getCpuTimes
+ *
+ * Description: Copies the calling U-proc's CPU time breakdown (user,
+ *              support, nucleus and soft-blocked time) into the cpuTimes_t
+ *              whose user address is in a1. This implements SYS21.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Total CPU time of the process
+ *
+ *****************************************************************************/
+int getCpuTimes(support_PTR supportStruct) {
+    cpuTimes_PTR userTimes = (cpuTimes_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+
+    /* Ask the nucleus for the breakdown, then copy it out */
+    cpuTimes_t times;
+    cpu_t total = SYSCALL(GETCPUTIME, (int)&times, 0, 0);
+    *userTimes = times;
+
+    return (int)total;
+}
+
+/******************************************************************************
+ *
+ * Function: readTrace
+ *
+ * Description: Drains up to a2 scheduler trace events into the user buffer
+ *              at a1. Events are fetched from the nucleus TRACECHUNK at a
+ *              time into a local buffer, since the nucleus must not touch
+ *              (possibly unmapped) user pages. This implements SYS22.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Number of events copied
+ *
+ *****************************************************************************/
+int readTrace(support_PTR supportStruct) {
+    traceEvent_PTR userEvents = (traceEvent_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int maxEvents = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    traceEvent_t chunk[TRACECHUNK];
+    int copied = 0;
+    int received;
+    do {
+        int request = MIN(maxEvents - copied, TRACECHUNK);
+        received = SYSCALL(DRAINTRACE, (int)chunk, request, 0);
+
+        int i;
+        for (i = 0; i < received; i++) {
+            userEvents[copied++] = chunk[i];
+        }
+    } while ((received == TRACECHUNK) && (copied < maxEvents));
+
+    return copied;
+}
+
+/******************************************************************************
+ *
+ * Function: getLatency
+ *
+ * Description: Copies the interrupt latency histograms of the line in a1
+ *              (ITINT..TERMINT) into the latencyHist_t whose user address
+ *              is in a2. lh_count[LAT_DEVICE] times interrupt entry to the
+ *              V that woke the waiter, lh_count[LAT_SCHED] that V to the
+ *              waiter's next dispatch, and lh_count[LAT_TOTAL] the sum.
+ *              This implements SYS23.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              0 on success, -1 if the line has no histograms
+ *
+ *****************************************************************************/
+int getLatency(support_PTR supportStruct) {
+    int line = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    latencyHist_PTR userHist = (latencyHist_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    /* Ask the nucleus for the histograms, then copy them out */
+    latencyHist_t hist;
+    int status = SYSCALL(READLATENCY, line, (int)&hist, 0);
+    if (status == 0) {
+        int kind, bucket;
+        for (kind = 0; kind < LATKINDS; kind++) {
+            for (bucket = 0; bucket < LATBUCKETS; bucket++) {
+                userHist->lh_count[kind][bucket] = hist.lh_count[kind][bucket];
+            }
+        }
+    }
+
+    return status;
+}
+
+/******************************************************************************
+ *
+ * Function: getCounters
+ *
+ * Description: Copies the performance counter block of the ASID in a2
+ *              (0 for the nucleus-wide block, SELFASID for the caller's
+ *              own) into the perfBlock_t whose
+ *              user address is in a1. The snapshot is taken into a local
+ *              block first, since it is read with interrupts off and the
+ *              user page may fault. This implements SYS32.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              PERFCOUNTS on success, -1 if there is no such block
+ *
+ *****************************************************************************/
+int getCounters(support_PTR supportStruct) {
+    perfBlock_PTR userBlock = (perfBlock_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int asid = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+    if (asid == SELFASID) {
+        asid = supportStruct->sup_asid;
+    }
+
+    perfBlock_t block;
+    int status = readPerf(asid, &block);
+    if (status == PERFCOUNTS) {
+        int counter;
+        for (counter = 0; counter < PERFCOUNTS; counter++) {
+            userBlock->pb_count[counter] = block.pb_count[counter];
+        }
+    }
+
+    return status;
+}
+
+/******************************************************************************
+ *
+ * Function: profile
+ *
+ * Description: Controls the caller's PC sampling profile. With a1 =
+ *              PROFSTART the profile is emptied and sampled every a2
+ *              microseconds (0 for quantum expiry only, else at least
+ *              PROFMININTERVAL); PROFSTOP stops sampling; PROFREAD copies
+ *              the profile into the profHist_t whose user address is in
+ *              a2. This implements SYS33.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Samples taken for PROFREAD, otherwise 0 on success;
+ *              -1 for an invalid operation or interval
+ *
+ *****************************************************************************/
+int profile(support_PTR supportStruct) {
+    int operation = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int argument = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    if (operation == PROFSTART) {
+        return startProfile(supportStruct->sup_asid, argument);
+    }
+    if (operation == PROFSTOP) {
+        stopProfile(supportStruct->sup_asid);
+        return 0;
+    }
+    if (operation != PROFREAD) {
+        return ERROR;
+    }
+
+    /* Validate the buffer (SYS33 takes one only for PROFREAD) */
+    profHist_PTR userProfile = (profHist_PTR)argument;
+    if (!validateUserAddress(argument) ||
+        !validateUserAddress(argument + sizeof(profHist_t) - 1)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Snapshot the profile, then copy it out */
+    profHist_t hist;
+    int samples = readProfile(supportStruct->sup_asid, &hist);
+    userProfile->ph_samples = hist.ph_samples;
+    userProfile->ph_other = hist.ph_other;
+    int bucket;
+    for (bucket = 0; bucket < PROFBUCKETS; bucket++) {
+        userProfile->ph_count[bucket] = hist.ph_count[bucket];
+    }
+
+    return samples;
+}
+
+/******************************************************************************
+ *
+ * Function: getLockStats
+ *
+ * Description: Copies up to a2 semaphore contention entries into the user
+ *              array at a1. Entries are fetched LOCKCHUNK at a time into a
+ *              local buffer, since the table is read with interrupts off
+ *              and the user pages may fault. This implements SYS34.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              Number of entries copied
+ *
+ *****************************************************************************/
+int getLockStats(support_PTR supportStruct) {
+    lockStat_PTR userStats = (lockStat_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int maxStats = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    lockStat_t chunk[LOCKCHUNK];
+    int copied = 0;
+    int received;
+    do {
+        int request = MIN(maxStats - copied, LOCKCHUNK);
+        received = readLockStats(chunk, copied, request);
+
+        int i;
+        for (i = 0; i < received; i++) {
+            userStats[copied++] = chunk[i];
+        }
+    } while ((received == LOCKCHUNK) && (copied < maxStats));
+
+    return copied;
+}
+
+/******************************************************************************
+ *
+ * Function: getDevStats
+ *
+ * Description: Copies the utilization statistics of device a2 (numbered as
+ *              the device semaphores: devregarea_t order, terminal
+ *              receivers last) into the devStat_t at a1. The statistics
+ *              are snapshotted into a local buffer with interrupts off and
+ *              then copied out, since the user page may fault. This
+ *              implements SYS35.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              The device number, -1 if it is invalid
+ *
+ *****************************************************************************/
+int getDevStats(support_PTR supportStruct) {
+    devStat_PTR userStat = (devStat_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int device = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    devStat_t stat;
+    int status = readDevStats(device, &stat);
+    if (status == device) {
+        userStat->ds_busyTime = stat.ds_busyTime;
+        int code;
+        for (code = 0; code < DEVCMDCODES; code++) {
+            userStat->ds_ops[code] = stat.ds_ops[code];
+        }
+        userStat->ds_bytes = stat.ds_bytes;
+        userStat->ds_errors = stat.ds_errors;
+        userStat->ds_lastError = stat.ds_lastError;
+        userStat->ds_waiters = stat.ds_waiters;
+        userStat->ds_command = stat.ds_command;
+        userStat->ds_issueTOD = stat.ds_issueTOD;
+    }
+
+    return status;
+}
+
+/******************************************************************************
+ *
+ * Function: delayMicro
+ *
+ * Description: Sleeps the calling U-proc for a1 microseconds with the Delay
+ *              Daemon. This implements SYS28.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              SUCCESS
+ *
+ *****************************************************************************/
+int delayMicro(support_PTR supportStruct) {
+    delayMicroSyscallHandler(supportStruct);
+    return SUCCESS;
+}
+
+/******************************************************************************
+ *
+ * Function: getSysStats
+ *
+ * Description: Copies the call statistics of the Support Level SYSCALL
+ *              number in a1 into the sysStat_t at a2. The statistics are
+ *              snapshotted with interrupts off and then copied out, since
+ *              the user page may fault. This implements SYS40.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              The SYSCALL number, -1 if it is not a Support Level one
+ *
+ *****************************************************************************/
+int getSysStats(support_PTR supportStruct) {
+    int number = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    sysStat_PTR userStat = (sysStat_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+    if ((number < SUPMINSYSCALL) || (number > SUPMAXSYSCALL)) {
+        return ERROR;
+    }
+
+    sysStat_t stat;
+    setInterrupts(OFF);
+    stat = syscallStats[number - SUPMINSYSCALL];
+    setInterrupts(ON);
+    *userStat = stat;
+
+    return number;
+}
+
+/******************************************************************************
+ *
+ * Function: getBootTimes
+ *
+ * Description: Copies the time of day each boot phase ended at (0 for a
+ *              phase not reached yet) into the bootTimes_t at a1, so a
+ *              U-proc can see where boot time went. This implements SYS56.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              The number of boot phases (BOOTPHASES)
+ *
+ *****************************************************************************/
+int getBootTimes(support_PTR supportStruct) {
+    bootTimes_PTR userTimes = (bootTimes_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+
+    bootTimes_t times;
+    int phase;
+    for (phase = 0; phase < BOOTPHASES; phase++) {
+        times.bt_phase[phase] = bootTOD[phase];
+    }
+    *userTimes = times;
+
+    return BOOTPHASES;
+}
+
+/******************************************************************************
+ *
+ * Function: getGroupStats
+ *
+ * Description: Copies the limits and usage of resource group a2 into the
+ *              groupStat_t at a1. The statistics are gathered into a local
+ *              buffer first, since the user page may fault. This
+ *              implements SYS58.
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the process's support structure
+ *
+ * Returns:
+ *              The group number, -1 if it is invalid
+ *
+ *****************************************************************************/
+int getGroupStats(support_PTR supportStruct) {
+    groupStat_PTR userStat = (groupStat_PTR)supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+    int group = supportStruct->sup_exceptState[GENERALEXCEPT].s_a2;
+
+    groupStat_t stat;
+    int status = readGroupStats(group, &stat);
+    if (status == group) {
+        *userStat = stat;
+    }
+
+    return status;
+}
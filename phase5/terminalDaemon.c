@@ -0,0 +1,450 @@
+/******************************* terminalDaemon.c ******************************
+ *
+ * Module: Terminal Daemons
+ *
+ * Description:
+ * This module buffers terminal output so SYS12 does not hold a U-proc for
+ * a device round trip per character. Each terminal transmitter has a ring
+ * of TERMRINGSIZE characters in kernel memory; SYS12 copies the string into
+ * it and returns, and a writer daemon per terminal (on its own small stack)
+ * takes characters off the ring and transmits them one WAITIO at a time.
+ *
+ * Input is buffered the same way in reverse: with TYPEAHEAD set a reader
+ * daemon per installed terminal keeps its receiver armed and collects
+ * characters into a TERMINPUTSIZE input ring whether or not anyone is
+ * reading, counting the complete lines in it. SYS13 waits only until the
+ * ring holds a line and then copies the whole line out at once.
+ *
+ * Policy Decisions:
+ * - Blocking: SYS12 only blocks while its terminal's ring is full, and is
+ *   woken as the writer frees space. A string longer than the free space
+ *   is buffered in pieces, in order
+ * - Mutual Exclusion: The transmitter's device mutex now guards its ring;
+ *   only the writer daemon touches the device. It is held while copying
+ *   from user memory, which may page fault (the pager never takes it)
+ * - Errors: A failed transmission drops that character and is recorded;
+ *   the next SYS12 on the terminal returns its negative status and buffers
+ *   nothing
+ * - Line Discipline: SYS13 returns one line, up to and including its
+ *   newline. A ring filled without a newline is returned as one line so a
+ *   long line can not wedge the reader. While the ring is full the reader
+ *   daemon stops receiving, leaving further input in the device
+ * - Input Errors: A failed receive stops the reader daemon; the next SYS13
+ *   with no complete line buffered returns its negative status and
+ *   restarts it
+ * - Mutual Exclusion (input): The receiver's device mutex guards its ring
+ * - Readiness: A terminal is ready for SYS53 when SYS13 would not block;
+ *   the reader daemon wakes SYS53 callers watching it whenever it leaves
+ *   the ring in that state
+ * - Draining: test() calls drainTerminals before terminating, so buffered
+ *   output is not lost when the daemons go down with it
+ *
+ * Functions:
+ * - initTerminals: Empties the rings and launches the writer daemons
+ * - bufferTerminalOutput: Copies a SYS12 string into a terminal's ring
+ * - drainTerminals: Waits until every ring has been transmitted
+ * - readBufferedLine: Copies a buffered input line to a SYS13 caller
+ * - terminalInputReady: Checks if SYS13 would find a line without waiting
+ * - terminalWriter: Writer daemon transmitting one terminal's ring
+ * - terminalReader: Reader daemon filling one terminal's input ring
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/terminalDaemon.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* waitAny.c */
+extern void notifyWaiters(int kind, int asid, int handle);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN char termRing[DEV_PER_LINE][TERMRINGSIZE];   /* Transmit ring of each terminal */
+HIDDEN int ringHead[DEV_PER_LINE];                  /* Index of the next character to transmit */
+HIDDEN int ringCount[DEV_PER_LINE];                 /* Characters waiting in the ring */
+HIDDEN int writerIdle[DEV_PER_LINE];                /* The writer is parked on ringData */
+HIDDEN int ringData[DEV_PER_LINE];                  /* Writer waits here for characters */
+HIDDEN int spaceWaiters[DEV_PER_LINE];              /* U-procs waiting for ring space */
+HIDDEN int ringSpace[DEV_PER_LINE];                 /* They wait here */
+HIDDEN int drainWaiting[DEV_PER_LINE];              /* test() is waiting for the ring to empty */
+HIDDEN int drainSem[DEV_PER_LINE];                  /* It waits here */
+HIDDEN int termError[DEV_PER_LINE];                 /* Last failed transmit status (READY if none) */
+HIDDEN char inputRing[DEV_PER_LINE][TERMINPUTSIZE]; /* Type-ahead ring of each terminal */
+HIDDEN int inputHead[DEV_PER_LINE];                 /* Index of the oldest buffered character */
+HIDDEN int inputCount[DEV_PER_LINE];                /* Characters buffered */
+HIDDEN int inputLines[DEV_PER_LINE];                /* Newlines among them */
+HIDDEN int inputError[DEV_PER_LINE];                /* Failed receive status (READY if none) */
+HIDDEN int readerStopped[DEV_PER_LINE];             /* The reader daemon waits on inputSpace */
+HIDDEN int inputSpace[DEV_PER_LINE];                /* It waits here for space or an error to be taken */
+HIDDEN int lineWaiting[DEV_PER_LINE];               /* A SYS13 caller waits on lineReady */
+HIDDEN int lineReady[DEV_PER_LINE];                 /* It waits here for a line */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void terminalWriter(int termNum);
+HIDDEN void terminalReader(int termNum);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initTerminals
+ *
+ * Description: Empties every transmit and input ring and, with
+ *              TERMBUFFERED set, launches one writer daemon per terminal
+ *              and, with TYPEAHEAD set, one reader daemon per installed
+ *              terminal. Called after the device mutexes are set up
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initTerminals() {
+    int i;
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        ringHead[i] = 0;
+        ringCount[i] = 0;
+        writerIdle[i] = FALSE;
+        ringData[i] = 0;
+        spaceWaiters[i] = 0;
+        ringSpace[i] = 0;
+        drainWaiting[i] = FALSE;
+        drainSem[i] = 0;
+        termError[i] = READY;
+        inputHead[i] = 0;
+        inputCount[i] = 0;
+        inputLines[i] = 0;
+        inputError[i] = READY;
+        readerStopped[i] = FALSE;
+        inputSpace[i] = 0;
+        lineWaiting[i] = FALSE;
+        lineReady[i] = 0;
+    }
+
+    /* Launch the writers, each with its terminal number in a0 */
+    if (TERMBUFFERED) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            state_t writerState;
+            writerState.s_pc = (memaddr)terminalWriter;
+            writerState.s_t9 = (memaddr)terminalWriter;
+            writerState.s_sp = TERM_STACK(i);
+            writerState.s_a0 = i;
+            writerState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+            writerState.s_entryHI = 0; /* ASID 0 */
+            SYSCALL(CREATEPROCESS, (int)&writerState, 0, 0);
+        }
+    }
+
+    /* Launch a reader for each installed terminal, on the stacks after the writers' */
+    if (TYPEAHEAD) {
+        for (i = 0; i < DEV_PER_LINE; i++) {
+            if ((TERMRECVDESC(i)->dd_reg->t_recv_status & TERMSTATMASK) == NOTINSTALLED) {
+                continue;
+            }
+            state_t readerState;
+            readerState.s_pc = (memaddr)terminalReader;
+            readerState.s_t9 = (memaddr)terminalReader;
+            readerState.s_sp = TERM_STACK(DEV_PER_LINE + i);
+            readerState.s_a0 = i;
+            readerState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+            readerState.s_entryHI = 0; /* ASID 0 */
+            SYSCALL(CREATEPROCESS, (int)&readerState, 0, 0);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: bufferTerminalOutput
+ *
+ * Description: Copies a string into a terminal's transmit ring, waiting
+ *              for space as needed, and wakes the writer
+ *
+ * Parameters:
+ *              termNum - Terminal number (0-7)
+ *              charAddress - User address of the string (already validated)
+ *              length - Length of the string (any, for SYS42)
+ *
+ * Returns:
+ *              length once it is all buffered, or the negative status of
+ *              an earlier failed transmission
+ * ======================================================================== */
+int bufferTerminalOutput(int termNum, char *charAddress, int length) {
+    int *ringMutex = DEVDESC(TERMINT, termNum)->dd_mutex;
+
+    /* Gain ring mutual exclusion */
+    SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+
+    /* Report an error the writer ran into */
+    if (termError[termNum] != READY) {
+        int status = termError[termNum];
+        termError[termNum] = READY;
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+        return -status;
+    }
+
+    int index = 0;
+    while (index < length) {
+        if (ringCount[termNum] == TERMRINGSIZE) {
+            /* Ring full: wait for the writer to free space */
+            spaceWaiters[termNum]++;
+            SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&ringSpace[termNum], 0, 0);
+            SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+            continue;
+        }
+
+        /* Append as much as fits */
+        while ((index < length) && (ringCount[termNum] < TERMRINGSIZE)) {
+            termRing[termNum][(ringHead[termNum] + ringCount[termNum]) % TERMRINGSIZE] = charAddress[index];
+            ringCount[termNum]++;
+            index++;
+        }
+        if (writerIdle[termNum]) {
+            writerIdle[termNum] = FALSE;
+            SYSCALL(VERHOGEN, (int)&ringData[termNum], 0, 0);
+        }
+    }
+
+    /* Release ring mutual exclusion */
+    SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+    return index;
+}
+
+/* ========================================================================
+ * Function: readBufferedLine
+ *
+ * Description: Waits until the terminal's input ring holds a complete
+ *              line (or is full, or the reader hit an error) and copies
+ *              that line to the caller
+ *
+ * Parameters:
+ *              termNum - Terminal number (0-7)
+ *              charAddress - User address to copy the line to (validated)
+ *
+ * Returns:
+ *              Number of characters copied (newline included), or the
+ *              negative status of a failed receive
+ * ======================================================================== */
+int readBufferedLine(int termNum, char *charAddress) {
+    int *ringMutex = TERMRECVDESC(termNum)->dd_mutex;
+
+    /* Gain ring mutual exclusion */
+    SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+
+    /* Wait for a line */
+    while ((inputLines[termNum] == 0) && (inputCount[termNum] < TERMINPUTSIZE) &&
+           (inputError[termNum] == READY)) {
+        lineWaiting[termNum] = TRUE;
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&lineReady[termNum], 0, 0);
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+    }
+
+    int index = 0;
+    if ((inputLines[termNum] == 0) && (inputCount[termNum] < TERMINPUTSIZE)) {
+        /* No line, only an error: report it */
+        index = -inputError[termNum];
+        inputError[termNum] = READY;
+    } else {
+        /* Copy out one line */
+        int running = TRUE;
+        while (running && (inputCount[termNum] > 0)) {
+            char recvChar = inputRing[termNum][inputHead[termNum]];
+            inputHead[termNum] = (inputHead[termNum] + 1) % TERMINPUTSIZE;
+            inputCount[termNum]--;
+            charAddress[index] = recvChar;
+            index++;
+            if (recvChar == NEWLINE) {
+                inputLines[termNum]--;
+                running = FALSE;
+            }
+        }
+    }
+
+    /* Restart a reader that stopped for space or an error */
+    if (readerStopped[termNum] && (inputError[termNum] == READY)) {
+        readerStopped[termNum] = FALSE;
+        SYSCALL(VERHOGEN, (int)&inputSpace[termNum], 0, 0);
+    }
+
+    /* Release ring mutual exclusion */
+    SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+    return index;
+}
+
+/* ========================================================================
+ * Function: terminalInputReady
+ *
+ * Description: Checks if a terminal's input ring holds a line, is full or
+ *              has a receive error to report, so SYS13 would not block
+ *
+ * Parameters:
+ *              termNum - Terminal number (0-7)
+ *
+ * Returns:
+ *              TRUE if SYS13 on the terminal would return at once
+ * ======================================================================== */
+int terminalInputReady(int termNum) {
+    int *ringMutex = TERMRECVDESC(termNum)->dd_mutex;
+    SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+    int ready = (inputLines[termNum] > 0) || (inputCount[termNum] == TERMINPUTSIZE) ||
+                (inputError[termNum] != READY);
+    SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+    return ready;
+}
+
+/* ========================================================================
+ * Function: drainTerminals
+ *
+ * Description: Waits until every terminal's writer has transmitted all
+ *              buffered output
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void drainTerminals() {
+    if (!TERMBUFFERED) {
+        return;
+    }
+    int i;
+    for (i = 0; i < DEV_PER_LINE; i++) {
+        int *ringMutex = DEVDESC(TERMINT, i)->dd_mutex;
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+        if (ringCount[i] > 0) {
+            drainWaiting[i] = TRUE;
+            SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&drainSem[i], 0, 0);
+        } else {
+            SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: terminalWriter
+ *
+ * Description: Writer daemon for one terminal. Transmits the ring's oldest
+ *              character, then takes it off the ring, waking one U-proc
+ *              waiting for space and, once the ring is empty, test() if it
+ *              is draining. Parks on ringData while the ring is empty
+ *
+ * Parameters:
+ *              termNum - Terminal number (0-7)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void terminalWriter(int termNum) {
+    devDesc_PTR terminal = DEVDESC(TERMINT, termNum);
+    int *ringMutex = terminal->dd_mutex;
+
+    while (TRUE) {
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+        if (ringCount[termNum] == 0) {
+            /* Nothing to send: park until a SYS12 fills the ring */
+            writerIdle[termNum] = TRUE;
+            SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&ringData[termNum], 0, 0);
+            continue;
+        }
+        char nextChar = termRing[termNum][ringHead[termNum]];
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+
+        /* Atomically write a character to the terminal device */
+        setInterrupts(OFF);
+        terminal->dd_reg->t_transm_command = nextChar << BYTELEN | PRINTCHR;
+        int status = SYSCALL(WAITIO, TERMINT, termNum, 0);
+        setInterrupts(ON);
+
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+        if ((status & TERMSTATMASK) != RECVD) { /* Write failed */
+            termError[termNum] = status;
+        }
+        ringHead[termNum] = (ringHead[termNum] + 1) % TERMRINGSIZE;
+        ringCount[termNum]--;
+        if (spaceWaiters[termNum] > 0) {
+            spaceWaiters[termNum]--;
+            SYSCALL(VERHOGEN, (int)&ringSpace[termNum], 0, 0);
+        }
+        if ((ringCount[termNum] == 0) && drainWaiting[termNum]) {
+            drainWaiting[termNum] = FALSE;
+            SYSCALL(VERHOGEN, (int)&drainSem[termNum], 0, 0);
+        }
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+    }
+}
+
+/* ========================================================================
+ * Function: terminalReader
+ *
+ * Description: Reader daemon for one terminal. Keeps a receive command
+ *              outstanding, appends each character to the input ring and
+ *              wakes a waiting SYS13 caller when a line is complete (or
+ *              the ring fills). Stops on inputSpace while the ring is full
+ *              or a receive error has not been reported yet
+ *
+ * Parameters:
+ *              termNum - Terminal number (0-7)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void terminalReader(int termNum) {
+    devDesc_PTR terminal = TERMRECVDESC(termNum);
+    int *ringMutex = terminal->dd_mutex;
+
+    while (TRUE) {
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+        if ((inputCount[termNum] == TERMINPUTSIZE) || (inputError[termNum] != READY)) {
+            /* No room, or an error to report first: wait for SYS13 */
+            readerStopped[termNum] = TRUE;
+            SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+            SYSCALL(PASSEREN, (int)&inputSpace[termNum], 0, 0);
+            continue;
+        }
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+
+        /* Atomically read a character from the terminal device */
+        setInterrupts(OFF);
+        terminal->dd_reg->t_recv_command = PRINTCHR;
+        int status = SYSCALL(WAITIO, TERMINT, termNum, 1);
+        setInterrupts(ON);
+
+        SYSCALL(PASSEREN, (int)ringMutex, 0, 0);
+        if ((status & TERMSTATMASK) != RECVD) { /* Read failed */
+            inputError[termNum] = status;
+        } else {
+            char recvChar = status >> BYTELEN;
+            inputRing[termNum][(inputHead[termNum] + inputCount[termNum]) % TERMINPUTSIZE] = recvChar;
+            inputCount[termNum]++;
+            if (recvChar == NEWLINE) {
+                inputLines[termNum]++;
+            }
+        }
+        int ready = (inputLines[termNum] > 0) || (inputCount[termNum] == TERMINPUTSIZE) ||
+                    (inputError[termNum] != READY);
+        if (lineWaiting[termNum] && ready) {
+            lineWaiting[termNum] = FALSE;
+            SYSCALL(VERHOGEN, (int)&lineReady[termNum], 0, 0);
+        }
+        SYSCALL(VERHOGEN, (int)ringMutex, 0, 0);
+        if (ready) {
+            notifyWaiters(WAITTERM, 0, termNum);
+        }
+    }
+}
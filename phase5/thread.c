@@ -0,0 +1,353 @@
+/******************************* thread.c ************************************
+ *
+ * Module: Threads
+ *
+ * Description:
+ * This module lets a U-proc run more than one activity in its address
+ * space. SYS49 starts a thread at the user address in a1, with its user
+ * stack pointer at a2 and a3 in a0; SYS50 waits for a thread of the same
+ * U-proc to exit and returns its exit value; SYS51 ends the calling
+ * thread with the value in a1. Threads overlap one another's I/O waits
+ * and, with CPUCOUNT > 1, run on several processors at once.
+ *
+ * Implementation:
+ * A thread is one more process with a support structure of its own, for
+ * its exception states and contexts (on the kernel stacks of its slot,
+ * THREAD_TLB_STACK and THREAD_GEN_STACK), whose sup_space points at the
+ * support structure of the U-proc's main thread. That one holds the page
+ * table, so the refill handler and the pager map the same pages whichever
+ * thread runs, and everything keyed by ASID (mailbox, futexes, segments,
+ * wired pages, counters) is shared. Futexes (SYS46/47) are the locks and
+ * condition variables between threads.
+ *
+ * Policy Decisions:
+ * - Slots: MAXTHREADS slots are shared by all U-procs; SYS49 fails with
+ *   ERROR when none (or no support structure) is free. A slot is freed
+ *   when its thread is joined, or when its U-proc exits
+ * - Creators: Only a U-proc's main thread creates threads: a thread is a
+ *   nucleus child of its creator, and the nucleus ends a process's
+ *   children with it, so a thread's own children would die with it
+ * - Exits: SYS9 or a trap in a thread ends just that thread (exit value 0,
+ *   or ERROR after a trap). SYS9 or a trap in the main thread waits for
+ *   the U-proc's other threads to end before its address space is torn
+ *   down, since they run in it; threads that never exit keep it waiting
+ * - Joins: Any thread of the U-proc may join another one (not itself),
+ *   once; a second join or an unknown thread fails with ERROR
+ * - Stacks: The caller provides each thread's user stack (the top of a
+ *   word-aligned area of its address space); a bad entry point or stack
+ *   pointer terminates the caller
+ *
+ * Functions:
+ * - initThreads: Frees every thread slot
+ * - threadCreateSyscallHandler: Implements SYS49 (THREADCREATE)
+ * - threadJoinSyscallHandler: Implements SYS50 (THREADJOIN)
+ * - threadExitSyscallHandler: Implements SYS51 (THREADEXIT)
+ * - exitThread: Ends the calling thread
+ * - waitForThreads: Waits until a U-proc's threads have ended
+ * - liveThreads: Counts a U-proc's threads still running
+ * - threadSlot: Finds a U-proc's thread by its thread number
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/thread.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* vmSupport.c */
+extern void deallocateSupportStruct(support_PTR supportStruct);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN thread_t threads[MAXTHREADS];            /* Thread slots */
+HIDDEN int threadJoined[MAXTHREADS];            /* A join of the slot's thread is waiting or done */
+HIDDEN int exitWaiting[MAXUPROC + 1];           /* A main thread waits for its threads to end */
+HIDDEN int threadsDone[MAXUPROC + 1];           /* Semaphores it waits on */
+HIDDEN int threadMutex;                         /* Semaphore for the thread slots */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN thread_PTR threadSlot(int asid, int threadNum);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initThreads
+ *
+ * Description: Frees every thread slot
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initThreads() {
+    int slot;
+    for (slot = 0; slot < MAXTHREADS; slot++) {
+        threads[slot].th_state = THREADFREE;
+        threads[slot].th_asid = UNOCCUPIED;
+        threads[slot].th_value = 0;
+        threads[slot].th_joinSem = 0;
+        threadJoined[slot] = FALSE;
+    }
+    int asid;
+    for (asid = 0; asid <= MAXUPROC; asid++) {
+        exitWaiting[asid] = FALSE;
+        threadsDone[asid] = 0;
+    }
+    threadMutex = 1;
+}
+
+/* ========================================================================
+ * Function: threadCreateSyscallHandler
+ *
+ * Description: Implements SYS49: starts a thread of the calling U-proc at
+ *              a1 with its stack pointer at a2 and a3 in a0, in user mode
+ *              with interrupts and the PLT on, like the main thread
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling thread
+ *                              (a1: entry point, a2: stack top, a3: argument)
+ *
+ * Returns:
+ *              The new thread's number (1..MAXTHREADS), or ERROR if the
+ *              caller is not the main thread or no slot or support
+ *              structure is free
+ * ======================================================================== */
+int threadCreateSyscallHandler(support_PTR supportStruct) {
+    state_PTR exceptState = &supportStruct->sup_exceptState[GENERALEXCEPT];
+    memaddr entry = exceptState->s_a1;
+    memaddr stackTop = exceptState->s_a2;
+    int argument = exceptState->s_a3;
+    int asid = supportStruct->sup_asid;
+
+    /* Validate parameters */
+    if (!validateUserAddress(entry) || (entry & (WORDLEN - 1)) ||
+        !validateUserAddress(stackTop - WORDLEN) || (stackTop & (WORDLEN - 1))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    if (supportStruct->sup_thread != NOTHREAD) {
+        return ERROR;
+    }
+
+    /* Claim a slot and a support structure */
+    SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    int slot = 0;
+    while ((slot < MAXTHREADS) && (threads[slot].th_state != THREADFREE)) {
+        slot++;
+    }
+    support_PTR threadSupport = (slot < MAXTHREADS) ? allocateSupportStruct() : NULL;
+    if (threadSupport == NULL) {
+        SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+        return ERROR;
+    }
+    threads[slot].th_state = THREADRUNNING;
+    threads[slot].th_asid = asid;
+    threads[slot].th_value = 0;
+    threads[slot].th_joinSem = 0;
+    threadJoined[slot] = FALSE;
+    SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+
+    /* Its own exception handling, in its U-proc's address space */
+    threadSupport->sup_asid = asid;
+    threadSupport->sup_space = supportStruct->sup_space;
+    threadSupport->sup_thread = slot;
+    initExceptContexts(threadSupport, THREAD_TLB_STACK(slot), THREAD_GEN_STACK(slot));
+
+    state_t threadState;
+    setWords((unsigned int *)&threadState, 0, sizeof(state_t) / WORDLEN);
+    threadState.s_pc = entry;
+    threadState.s_t9 = entry;
+    threadState.s_sp = stackTop;
+    threadState.s_a0 = argument;
+    threadState.s_entryHI = asid << ASIDSHIFT;
+    threadState.s_status = ALLOFF | STATUS_KUp | STATUS_IEc | CAUSE_IP_MASK | STATUS_TE;
+    if (SYSCALL(CREATEPROCESS, (int)&threadState, (int)threadSupport, groupTickets(asid, DEFAULTTICKETS)) != SUCCESS) {
+        SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+        threads[slot].th_state = THREADFREE;
+        threads[slot].th_asid = UNOCCUPIED;
+        SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+        deallocateSupportStruct(threadSupport);
+        return ERROR;
+    }
+    return slot + 1;
+}
+
+/* ========================================================================
+ * Function: threadJoinSyscallHandler
+ *
+ * Description: Implements SYS50: waits for the thread numbered a1 of the
+ *              caller's U-proc to exit, then frees its slot
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling thread
+ *                              (a1: thread number)
+ *
+ * Returns:
+ *              The thread's exit value, or ERROR if it is not a thread of
+ *              the caller's U-proc, is the caller or is joined already
+ * ======================================================================== */
+int threadJoinSyscallHandler(support_PTR supportStruct) {
+    int threadNum = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+
+    SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    thread_PTR thread = threadSlot(supportStruct->sup_asid, threadNum);
+    if ((thread == NULL) || (threadNum - 1 == supportStruct->sup_thread) || threadJoined[threadNum - 1]) {
+        SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+        return ERROR;
+    }
+    threadJoined[threadNum - 1] = TRUE;
+    SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+
+    /* Wait for it to exit */
+    SYSCALL(PASSEREN, (int)&thread->th_joinSem, 0, 0);
+
+    SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    int value = thread->th_value;
+    thread->th_state = THREADFREE;
+    thread->th_asid = UNOCCUPIED;
+    SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+    return value;
+}
+
+/* ========================================================================
+ * Function: threadExitSyscallHandler
+ *
+ * Description: Implements SYS51: ends the calling thread with exit value a1
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling thread
+ *                              (a1: exit value)
+ *
+ * Returns:
+ *              Does not return for a thread, ERROR for a main thread (which
+ *              ends with SYS9)
+ * ======================================================================== */
+int threadExitSyscallHandler(support_PTR supportStruct) {
+    if (supportStruct->sup_thread == NOTHREAD) {
+        return ERROR;
+    }
+    exitThread(supportStruct, supportStruct->sup_exceptState[GENERALEXCEPT].s_a1);
+    return ERROR; /* Should never get here */
+}
+
+/* ========================================================================
+ * Function: exitThread
+ *
+ * Description: Ends the calling thread: records its exit value, frees its
+ *              support structure, wakes its joiner (and its main thread,
+ *              if that waits to exit) and terminates its process. The
+ *              joiner may reuse the slot's stacks at once, so the wake-up
+ *              is the last thing done on them
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling thread
+ *              value - Exit value
+ *
+ * Returns:
+ *              None (does not return)
+ * ======================================================================== */
+void exitThread(support_PTR supportStruct, int value) {
+    int slot = supportStruct->sup_thread;
+    int asid = supportStruct->sup_asid;
+    deallocateSupportStruct(supportStruct);
+
+    SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    threads[slot].th_state = THREADEXITED;
+    threads[slot].th_value = value;
+    if (exitWaiting[asid]) {
+        exitWaiting[asid] = FALSE;
+        SYSCALL(VERHOGEN, (int)&threadsDone[asid], 0, 0);
+    }
+    SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+
+    SYSCALL(VERHOGEN, (int)&threads[slot].th_joinSem, 0, 0);
+    SYSCALL(TERMINATEPROCESS, 0, 0, 0);
+}
+
+/* ========================================================================
+ * Function: waitForThreads
+ *
+ * Description: Waits until none of a U-proc's threads is running, then
+ *              frees the slots of those never joined. Called by its main
+ *              thread as it exits
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void waitForThreads(int asid) {
+    SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    while (liveThreads(asid) > 0) {
+        exitWaiting[asid] = TRUE;
+        SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+        SYSCALL(PASSEREN, (int)&threadsDone[asid], 0, 0);
+        SYSCALL(PASSEREN, (int)&threadMutex, 0, 0);
+    }
+    int slot;
+    for (slot = 0; slot < MAXTHREADS; slot++) {
+        if ((threads[slot].th_asid == asid) && !threadJoined[slot]) {
+            threads[slot].th_state = THREADFREE;
+            threads[slot].th_asid = UNOCCUPIED;
+            threads[slot].th_joinSem = 0;
+        }
+    }
+    SYSCALL(VERHOGEN, (int)&threadMutex, 0, 0);
+}
+
+/* ========================================================================
+ * Function: liveThreads
+ *
+ * Description: Counts a U-proc's threads that have not exited (a snapshot
+ *              unless the caller holds the thread slots)
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *
+ * Returns:
+ *              The number of its running threads
+ * ======================================================================== */
+int liveThreads(int asid) {
+    int count = 0;
+    int slot;
+    for (slot = 0; slot < MAXTHREADS; slot++) {
+        if ((threads[slot].th_asid == asid) && (threads[slot].th_state == THREADRUNNING)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: threadSlot
+ *
+ * Description: Finds a U-proc's thread by its thread number. Called with
+ *              the thread slots held
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              threadNum - Thread number (1..MAXTHREADS)
+ *
+ * Returns:
+ *              Its slot, or NULL if the U-proc has no such thread
+ * ======================================================================== */
+thread_PTR threadSlot(int asid, int threadNum) {
+    if ((threadNum < 1) || (threadNum > MAXTHREADS) || (threads[threadNum - 1].th_state == THREADFREE) ||
+        (threads[threadNum - 1].th_asid != asid)) {
+        return NULL;
+    }
+    return &threads[threadNum - 1];
+}
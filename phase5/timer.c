@@ -0,0 +1,247 @@
+/******************************* timer.c *************************************
+ *
+ * Module: Nucleus Timer Wheel
+ *
+ * Description:
+ * This module holds the processes blocked in WAITUNTIL, each until its own
+ * TOD deadline, so a sleeper is readied only once its deadline has passed
+ * instead of every waiter being woken on every pseudo-clock tick to check.
+ *
+ * Implementation:
+ * The wheel has TIMERSLOTS slots, one per pseudo-clock tick modulo
+ * TIMERSLOTS. A deadline is rounded up to the first tick at or after it
+ * (TICKOF) and the process is linked into that tick's slot through its
+ * p_timerNext/p_timerPrev fields, so insertion and removal are constant
+ * time. On each tick expireTimers visits only the slots of the ticks that
+ * passed since the last call; a slot may also hold processes due on a
+ * later turn of the wheel, which are left in place. With TICKLESS set the
+ * interrupt module arms the interval timer for nextTimerTick, skipping
+ * ticks whose slots are empty. With ONESHOTTIMER set it arms the timer for
+ * nextTimerDeadline instead, the exact earliest deadline of that tick, so
+ * expireTimers may run part way through a tick; it then also visits the
+ * slot of the tick in progress, expiring only the deadlines already passed.
+ *
+ * A waiting process is also blocked on a semaphore (the caller's, for a
+ * timed P, or timerSem otherwise), so termination and V need no special
+ * case beyond taking it off the wheel. Waiters count as soft-blocked.
+ *
+ * Functions:
+ * - initTimers: Empties the wheel.
+ * - insertTimer: Puts a process on the wheel slot of its deadline.
+ * - removeTimer: Takes a process off the wheel.
+ * - expireTimers: Wakes every process whose deadline has passed.
+ * - nextTimerTick: Returns the tick of the next occupied slot.
+ * - nextTimerDeadline: Returns the earliest deadline due on that tick.
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/timer.h"
+
+/******************** Module Variables ********************/
+HIDDEN pcb_PTR timerWheel[TIMERSLOTS];  /* Head of each slot's list */
+HIDDEN int timerCount;                  /* Processes on the wheel */
+HIDDEN unsigned int lastTick;           /* Last tick whose slot was expired */
+
+/******************** Function Prototypes ********************/
+HIDDEN void expireSlot(int slot, cpu_t currentTOD);
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initTimers
+ *
+ * Description: Empties the wheel and starts it at the current tick.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initTimers() {
+    int slot;
+    for (slot = 0; slot < TIMERSLOTS; slot++) {
+        timerWheel[slot] = mkEmptyProcQ();
+    }
+    timerCount = 0;
+
+    cpu_t currentTOD;
+    STCK(currentTOD);
+    lastTick = currentTOD / CLOCKINTERVAL;
+}
+
+/* ========================================================================
+ * Function: insertTimer
+ *
+ * Description: Records a process's deadline and links it at the head of
+ *              the slot of the first tick at or after the deadline.
+ * 
+ * Parameters:
+ *              p - Process to put on the wheel
+ *              deadline - TOD the process waits for
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void insertTimer(pcb_PTR p, cpu_t deadline) {
+    int slot = TICKOF(deadline) & TIMERMASK;
+
+    p->p_deadline = deadline;
+    p->p_timerSlot = slot;
+    p->p_timerPrev = mkEmptyProcQ();
+    p->p_timerNext = timerWheel[slot];
+    if (timerWheel[slot] != mkEmptyProcQ()) {
+        timerWheel[slot]->p_timerPrev = p;
+    }
+    timerWheel[slot] = p;
+    timerCount++;
+}
+
+/* ========================================================================
+ * Function: removeTimer
+ *
+ * Description: Unlinks a process from its wheel slot.
+ * 
+ * Parameters:
+ *              p - Process on the wheel
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void removeTimer(pcb_PTR p) {
+    if (p->p_timerPrev != mkEmptyProcQ()) {
+        p->p_timerPrev->p_timerNext = p->p_timerNext;
+    } else {
+        timerWheel[p->p_timerSlot] = p->p_timerNext;
+    }
+    if (p->p_timerNext != mkEmptyProcQ()) {
+        p->p_timerNext->p_timerPrev = p->p_timerPrev;
+    }
+    p->p_timerSlot = NOSLOT;
+    timerCount--;
+}
+
+/* ========================================================================
+ * Function: expireTimers
+ *
+ * Description: Visits the slots of every tick since the last call (each
+ *              slot at most once), and with ONESHOTTIMER the slot of the
+ *              tick in progress, and readies the processes whose deadline
+ *              has passed.
+ * 
+ * Parameters:
+ *              currentTOD - Time of day of the tick
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void expireTimers(cpu_t currentTOD) {
+    unsigned int currentTick = currentTOD / CLOCKINTERVAL;
+    unsigned int tick = lastTick;
+    int visited = 0;
+
+    while ((timerCount > 0) && (tick != currentTick) && (visited < TIMERSLOTS)) {
+        tick++;
+        visited++;
+        expireSlot(tick & TIMERMASK, currentTOD);
+    }
+    lastTick = currentTick;
+
+    /* A one-shot interrupt may land part way through the next tick */
+    if (ONESHOTTIMER && (timerCount > 0)) {
+        expireSlot((currentTick + 1) & TIMERMASK, currentTOD);
+    }
+}
+
+/* ========================================================================
+ * Function: nextTimerDeadline
+ *
+ * Description: Finds the earliest deadline among the processes of the
+ *              first occupied slot that are due on its first turn. If all
+ *              of them are due on later turns, the tick itself is returned
+ *              so waking for it just finds nothing to expire.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              Deadline TOD, or 0 if the wheel is empty
+ * ======================================================================== */
+cpu_t nextTimerDeadline() {
+    unsigned int tick = nextTimerTick();
+    if (tick == 0) {
+        return 0;
+    }
+
+    cpu_t earliest = tick * CLOCKINTERVAL;
+    pcb_PTR p = timerWheel[tick & TIMERMASK];
+    while (p != mkEmptyProcQ()) {
+        if ((TICKOF(p->p_deadline) == tick) && (p->p_deadline < earliest)) {
+            earliest = p->p_deadline;
+        }
+        p = p->p_timerNext;
+    }
+    return earliest;
+}
+
+/* ========================================================================
+ * Function: expireSlot
+ *
+ * Description: Readies the processes in one slot whose deadline has
+ *              passed. A woken process leaves its semaphore as if the P
+ *              had never happened and gets TIMEDOUT in v0.
+ * 
+ * Parameters:
+ *              slot - Wheel slot to visit
+ *              currentTOD - Time of day of the interrupt
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+HIDDEN void expireSlot(int slot, cpu_t currentTOD) {
+    pcb_PTR p = timerWheel[slot];
+    while (p != mkEmptyProcQ()) {
+        pcb_PTR next = p->p_timerNext;
+        if (p->p_deadline <= currentTOD) {
+            /* Deadline passed: undo the P and make the process ready */
+            int *semAdd = p->p_semAdd;
+            removeTimer(p);
+            outBlocked(p);
+            (*semAdd)++;
+            softBlockCount--;
+            p->p_s.s_v0 = TIMEDOUT;
+            chargeBlockedTime(p, currentTOD);
+            traceEvent(TRACE_UNBLOCK, p, semAdd);
+            insertReadyQueue(p);
+        }
+        p = next;
+    }
+}
+
+/* ========================================================================
+ * Function: nextTimerTick
+ *
+ * Description: Finds the first tick after the last expired one whose slot
+ *              is occupied. Its processes may be due on a later turn of the
+ *              wheel; waking for it then just finds nothing to expire.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              Tick number, or 0 if the wheel is empty
+ * ======================================================================== */
+unsigned int nextTimerTick() {
+    if (timerCount == 0) {
+        return 0;
+    }
+
+    unsigned int tick = lastTick + 1;
+    while (timerWheel[tick & TIMERMASK] == mkEmptyProcQ()) {
+        tick++;
+    }
+    return tick;
+}
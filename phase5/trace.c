@@ -0,0 +1,395 @@
+/******************************* trace.c *************************************
+ *
+ * Module: Scheduler Trace and Latency Histograms
+ *
+ * Description:
+ * This module keeps a fixed-size ring of scheduler events (dispatch,
+ * preemption, block and unblock) stamped with the TOD clock, the PCB and
+ * its ASID, so run-queue latency and preemption patterns can be studied
+ * without printing from inside the system.
+ *
+ * Implementation:
+ * The ring is a static array of TRACESIZE events indexed by free-running
+ * head and tail counters masked with TRACEMASK, so recording never
+ * allocates. When the ring is full the oldest event is overwritten. The nucleus-only DRAINTRACE call copies events out
+ * oldest first; the Support Level exposes it to U-procs as SYS22.
+ *
+ * Latency Histograms:
+ * A process woken by an interrupt carries three stamps: the TOD at entry
+ * of that interrupt, the TOD of the V that woke it, and the TOD of its next
+ * dispatch. Each gap is counted in a per-line log2 histogram, so device
+ * and handler delay (LAT_DEVICE) can be told apart from ready queue delay
+ * (LAT_SCHED). The cost is one TOD read per interrupt and per wake-up; the
+ * dispatch reuses the scheduler's reading. The nucleus-only READLATENCY
+ * call copies out one line; the Support Level exposes it as SYS23.
+ *
+ * Performance Counters:
+ * PERFBLOCKS statically allocated blocks of PERFCOUNTS counters: block 0
+ * counts every event, block asid only those of that U-proc (kernel
+ * processes only reach block 0). Events are context switches, PLT
+ * preemptions, each SYSCALL number, TLB refills, page faults, evictions,
+ * dirty write-backs, P operations that blocked, V operations that woke a
+ * process, and interrupts per line and per device. An interrupt line is
+ * only counted in block 0; a device completion is also counted for the
+ * ASID of the process it wakes. perfCount runs with interrupts off, so
+ * the Support Level may count too. The Support Level copies a block out
+ * with readPerf for SYS32, and test() prints a summary at shutdown.
+ *
+ * Binary Trace:
+ * Scheduler events, interrupts, paging events and SYSCALLs are also
+ * passed to the binary trace sink (traceSink.c), which streams them to
+ * flash. The sink classifies nothing itself: traceEvent, perfCount and
+ * perfCountSyscall pick the record kind.
+ *
+ * Functions:
+ * - initTrace: Empties the trace ring and the latency histograms.
+ * - traceEvent: Records one event.
+ * - drainTrace: Copies out and removes up to a given number of events.
+ * - recordWakeLatency: Stamps a process woken by an interrupt.
+ * - recordRunLatency: Counts a woken process's latencies at dispatch.
+ * - readLatency: Copies out the histograms of one line.
+ * - latencyBucket: Returns the log2 bucket of a latency.
+ * - perfCount: Counts one event nucleus-wide and for an ASID.
+ * - perfCountSyscall: Counts one SYSCALL by number.
+ * - perfDispatch: Counts a context switch if a new process is dispatched.
+ * - readPerf: Copies out one counter block.
+ * - processASID: Returns the ASID of a process (0 for kernel processes).
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+/******************** Included Header Files ********************/
+#include "../h/trace.h"
+
+/******************** Module Variables ********************/
+HIDDEN traceEvent_t traceRing[TRACESIZE];  /* Event storage */
+HIDDEN unsigned int traceHead;             /* Index of the oldest event */
+HIDDEN unsigned int traceTail;             /* Index of the next free slot */
+HIDDEN latencyHist_t latencyHist[LATLINES]; /* Histograms of lines ITINT..TERMINT */
+perfBlock_t perfBlocks[PERFBLOCKS];         /* Nucleus-wide counters, then each ASID's */
+HIDDEN pcb_PTR lastDispatched[MAXCPUS];     /* Process each processor dispatched last (for PERF_CSWITCH) */
+
+/******************** Function Prototypes ********************/
+HIDDEN int latencyBucket(cpu_t latency);
+extern void traceRecord(int kind, unsigned int event, int asid, unsigned int arg); /* traceSink.c */
+
+/******************** Function Definitions ********************/
+
+/* ========================================================================
+ * Function: initTrace
+ *
+ * Description: Empties the trace ring, the latency histograms and the
+ *              performance counters.
+ * 
+ * Parameters:
+ *              None
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initTrace() {
+    traceHead = 0;
+    traceTail = 0;
+
+    int line, kind, bucket;
+    for (line = 0; line < LATLINES; line++) {
+        for (kind = 0; kind < LATKINDS; kind++) {
+            for (bucket = 0; bucket < LATBUCKETS; bucket++) {
+                latencyHist[line].lh_count[kind][bucket] = 0;
+            }
+        }
+    }
+
+    int block, counter;
+    for (block = 0; block < PERFBLOCKS; block++) {
+        for (counter = 0; counter < PERFCOUNTS; counter++) {
+            perfBlocks[block].pb_count[counter] = 0;
+        }
+    }
+    int cpu;
+    for (cpu = 0; cpu < MAXCPUS; cpu++) {
+        lastDispatched[cpu] = NULL;
+    }
+}
+
+/* ========================================================================
+ * Function: traceEvent
+ *
+ * Description: Records a scheduler event at the tail of the ring,
+ *              overwriting the oldest event if the ring is full, and
+ *              passes it to the binary trace sink.
+ * 
+ * Parameters:
+ *              type - TRACE_DISPATCH, TRACE_PREEMPT, TRACE_BLOCK or TRACE_UNBLOCK
+ *              p - Process the event is about
+ *              semAdd - Semaphore involved (NULL if none)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void traceEvent(int type, pcb_PTR p, int *semAdd) {
+    if (TRACESINK) {
+        traceRecord(TRK_SCHED, type, processASID(p), (unsigned int)p);
+    }
+    if (!TRACING) {
+        return;
+    }
+
+    /* Full ring: drop the oldest event */
+    if ((traceTail - traceHead) == TRACESIZE) {
+        traceHead++;
+    }
+
+    traceEvent_PTR event = &traceRing[traceTail & TRACEMASK];
+    STCK(event->te_tod);
+    event->te_type = type;
+    event->te_pcb = p;
+    event->te_asid = processASID(p);
+    event->te_semAdd = semAdd;
+    traceTail++;
+}
+
+/* ========================================================================
+ * Function: drainTrace
+ *
+ * Description: Copies up to maxEvents events, oldest first, into buffer
+ *              and removes them from the ring.
+ * 
+ * Parameters:
+ *              buffer - Destination array
+ *              maxEvents - Capacity of the destination array
+ * 
+ * Returns:
+ *              Number of events copied
+ * ======================================================================== */
+int drainTrace(traceEvent_PTR buffer, int maxEvents) {
+    int count = 0;
+    while ((count < maxEvents) && (traceHead != traceTail)) {
+        buffer[count] = traceRing[traceHead & TRACEMASK];
+        traceHead++;
+        count++;
+    }
+    return count;
+}
+
+/* ========================================================================
+ * Function: recordWakeLatency
+ *
+ * Description: Counts the interrupt-to-V latency of a process just woken
+ *              by an interrupt and stamps it so its dispatch can be timed.
+ * 
+ * Parameters:
+ *              p - Process being woken
+ *              line - Interrupt line that woke it (ITINT..TERMINT)
+ *              irqTOD - Time of day at entry of the interrupt handler
+ *              wakeTOD - Time of day of the V
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void recordWakeLatency(pcb_PTR p, int line, cpu_t irqTOD, cpu_t wakeTOD) {
+    if (!LATENCYSTATS) {
+        return;
+    }
+
+    latencyHist[line - ITINT].lh_count[LAT_DEVICE][latencyBucket(wakeTOD - irqTOD)]++;
+    p->p_wakeLine = line;
+    p->p_irqTOD = irqTOD;
+    p->p_wakeTOD = wakeTOD;
+}
+
+/* ========================================================================
+ * Function: recordRunLatency
+ *
+ * Description: Called as a process is dispatched. If an interrupt woke it,
+ *              counts its V-to-dispatch and interrupt-to-dispatch latencies
+ *              and clears the stamp.
+ * 
+ * Parameters:
+ *              p - Process being dispatched
+ *              runTOD - Time of day of the dispatch
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void recordRunLatency(pcb_PTR p, cpu_t runTOD) {
+    if (p->p_wakeLine == NOLINE) {
+        return;
+    }
+
+    latencyHist_PTR hist = &latencyHist[p->p_wakeLine - ITINT];
+    hist->lh_count[LAT_SCHED][latencyBucket(runTOD - p->p_wakeTOD)]++;
+    hist->lh_count[LAT_TOTAL][latencyBucket(runTOD - p->p_irqTOD)]++;
+    p->p_wakeLine = NOLINE;
+}
+
+/* ========================================================================
+ * Function: readLatency
+ *
+ * Description: Copies the histograms of one interrupt line into buffer.
+ *              The histograms keep counting; they are not cleared.
+ * 
+ * Parameters:
+ *              line - Interrupt line (ITINT..TERMINT)
+ *              buffer - Destination histograms
+ * 
+ * Returns:
+ *              0 on success, -1 if line has no histograms
+ * ======================================================================== */
+int readLatency(int line, latencyHist_PTR buffer) {
+    if ((line < ITINT) || (line > TERMINT)) {
+        return -1;
+    }
+    /* Copied a word at a time: a struct assignment this large would call memcpy */
+    int kind, bucket;
+    for (kind = 0; kind < LATKINDS; kind++) {
+        for (bucket = 0; bucket < LATBUCKETS; bucket++) {
+            buffer->lh_count[kind][bucket] = latencyHist[line - ITINT].lh_count[kind][bucket];
+        }
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Function: latencyBucket
+ *
+ * Description: Returns the log2 bucket of a latency: bucket b holds
+ *              [2^b, 2^(b+1)) microseconds, bucket 0 also holds 0, and the
+ *              last bucket holds everything above.
+ * 
+ * Parameters:
+ *              latency - Latency in microseconds
+ * 
+ * Returns:
+ *              Bucket index (0..LATBUCKETS-1)
+ * ======================================================================== */
+HIDDEN int latencyBucket(cpu_t latency) {
+    int bucket = 0;
+    while ((latency > 1) && (bucket < (LATBUCKETS - 1))) {
+        latency >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/* ========================================================================
+ * Function: perfCount
+ *
+ * Description: Counts one event in the nucleus-wide block and, for a
+ *              U-proc, in its ASID's block. Interrupts are off meanwhile,
+ *              so Support Level callers do not lose counts to preemption.
+ *              Paging events and interrupts also go to the binary trace
+ *              sink.
+ * 
+ * Parameters:
+ *              counter - PERF_* counter index
+ *              asid - ASID the event belongs to (0 for none)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void perfCount(int counter, int asid) {
+    if (TRACESINK && (counter >= PERF_TLBREFILL) && (counter <= PERF_WRITEBACK)) {
+        traceRecord(TRK_PAGING, counter, asid, 0);
+    } else if (TRACESINK && (counter >= PERF_LINE)) {
+        traceRecord(TRK_INTERRUPT, counter - PERF_LINE, asid, 0);
+    }
+    if (!PERFSTATS) {
+        return;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    perfBlocks[0].pb_count[counter]++;
+    if ((asid > 0) && (asid < PERFBLOCKS)) {
+        perfBlocks[asid].pb_count[counter]++;
+    }
+    setSTATUS(status);
+}
+
+/* ========================================================================
+ * Function: perfCountSyscall
+ *
+ * Description: Counts one SYSCALL under its number and passes it to the
+ *              binary trace sink. Numbers outside the counted range are
+ *              only traced.
+ * 
+ * Parameters:
+ *              number - SYSCALL number (a0)
+ *              asid - ASID of the caller (0 for kernel processes)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void perfCountSyscall(int number, int asid) {
+    if (TRACESINK) {
+        traceRecord(TRK_SYSCALL, number, asid, 0);
+    }
+    if ((number >= MINSYSCALL) && (number < (MINSYSCALL + PERFSYSCALLS))) {
+        perfCount(PERF_SYSCALL + (number - MINSYSCALL), asid);
+    }
+}
+
+/* ========================================================================
+ * Function: perfDispatch
+ *
+ * Description: Called as a process is dispatched. Counts a context switch
+ *              unless it is the process that ran last on this processor.
+ * 
+ * Parameters:
+ *              p - Process being dispatched
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void perfDispatch(pcb_PTR p) {
+    if (p != lastDispatched[CPUID()]) {
+        perfCount(PERF_CSWITCH, processASID(p));
+        lastDispatched[CPUID()] = p;
+    }
+}
+
+/* ========================================================================
+ * Function: readPerf
+ *
+ * Description: Copies one counter block into buffer with interrupts off,
+ *              so the snapshot is consistent. The counters keep counting;
+ *              they are not cleared.
+ * 
+ * Parameters:
+ *              asid - ASID of the block, or 0 for the nucleus-wide block
+ *              buffer - Destination block (in kernel memory)
+ * 
+ * Returns:
+ *              PERFCOUNTS on success, -1 if there is no such block
+ * ======================================================================== */
+int readPerf(int asid, perfBlock_PTR buffer) {
+    if ((asid < 0) || (asid >= PERFBLOCKS)) {
+        return -1;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    int counter;
+    for (counter = 0; counter < PERFCOUNTS; counter++) {
+        buffer->pb_count[counter] = perfBlocks[asid].pb_count[counter];
+    }
+    setSTATUS(status);
+    return PERFCOUNTS;
+}
+
+/* ========================================================================
+ * Function: processASID
+ *
+ * Description: Returns the ASID of a process.
+ * 
+ * Parameters:
+ *              p - Process
+ * 
+ * Returns:
+ *              Its ASID, or 0 for kernel processes
+ * ======================================================================== */
+int processASID(pcb_PTR p) {
+    return (p->p_supportStruct != NULL) ? p->p_supportStruct->sup_asid : 0;
+}
@@ -0,0 +1,360 @@
+/******************************* traceSink.c *************************************
+ *
+ * Module: Binary Trace Sink
+ *
+ * Description:
+ * This module streams a continuous binary trace of scheduler, interrupt,
+ * paging and syscall events to a flash device given over to it, so long
+ * runs can be traced without the bounded trace ring or character output.
+ * Recording only fills a record in RAM; a writer daemon moves whole pages
+ * of records to flash.
+ *
+ * Record Format:
+ * Each record is TRACERECSIZE (16) bytes, little-endian as uMPS3 stores
+ * them (traceRecord_t):
+ *   bytes 0-3    tr_tod    low word of the TOD clock (microseconds)
+ *   byte  4      tr_kind   TRK_* kind below
+ *   byte  5      tr_cpu    processor that recorded it
+ *   bytes 6-7    tr_asid   ASID (0 for kernel processes)
+ *   bytes 8-11   tr_event  event within the kind
+ *   bytes 12-15  tr_arg    argument of the event
+ * Kinds: TRK_SCHED (event TRACE_DISPATCH, _PREEMPT, _BLOCK or _UNBLOCK,
+ * arg the PCB), TRK_INTERRUPT (event the interrupt line, or PERFLINES
+ * plus the device semaphore index of a completion), TRK_PAGING (event
+ * PERF_TLBREFILL, _PAGEFAULT, _EVICTION or _WRITEBACK) and TRK_SYSCALL
+ * (event the SYSCALL number, nucleus or Support Level). A flash block
+ * holds one page of TRACEPAGERECS records. Its first is a header: kind
+ * TRK_PAGE, tr_asid TRACEMAGIC, tr_event the page's sequence number and
+ * tr_arg the records dropped before the page. Pages go to consecutive
+ * blocks from block 0, wrapping at the end of the device, so the decoder
+ * (harness/tracedump.c) orders them by sequence number. A TRK_NONE
+ * record ends a page written short at shutdown.
+ *
+ * Policy Decisions:
+ * - Device: The highest-numbered installed flash device that no U-proc
+ *   region and no shared segment uses at boot is claimed; with none, the
+ *   sink stays off. U-procs may not name its blocks, a clone may not take
+ *   it as a spare region, and it holds no flash log
+ * - Double Buffering: Records fill one of two page buffers in RAM. A full
+ *   page is handed to the writer and recording moves to the other; if
+ *   that one has not been written yet, records are dropped (and counted
+ *   in the next header) rather than making the recorder wait
+ * - Low Overhead: traceRecord runs with interrupts off under its own
+ *   spinlock, from the nucleus and the Support Level alike, and only
+ *   stores 16 bytes. The hooks are traceEvent, perfCount and
+ *   perfCountSyscall in trace.c
+ * - Writer: A kernel daemon with TRACETICKETS stride tickets writes each
+ *   full page straight from its buffer (one flash write per page), then
+ *   sleeps TRACEFLUSH microseconds once nothing is left
+ * - Shutdown: test() calls syncTraceSink, which stops recording and
+ *   writes the page in progress
+ *
+ * Functions:
+ * - initTraceSink: Claims a flash device and launches the trace writer
+ * - traceRecord: Appends one trace record
+ * - traceSinkDevice: Checks if a flash device holds the trace
+ * - syncTraceSink: Writes out the buffered records and stops recording
+ * - traceWriter: The trace writer daemon
+ * - writeTracePages: Writes the full pages to flash, oldest first
+ * - startTracePage: Starts a page in a buffer with its header
+ *
+ * Written by Aryah Rao and Anish Reddy
+ *
+ ***************************************************************************/
+
+#include "../h/traceSink.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* vmSupport.c */
+extern int reservedBlock(int flashNum, int block);
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN void traceWriter();
+HIDDEN int writeTracePages();
+HIDDEN void startTracePage(int buffer);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN traceRecord_t sinkBuffer[2][TRACEPAGERECS];  /* The two page buffers */
+HIDDEN unsigned int sinkSeq[2];                     /* Sequence number of the page in each buffer */
+HIDDEN int sinkFull[2];                             /* The buffer waits for the writer */
+HIDDEN int sinkCurrent;                             /* Buffer being filled */
+HIDDEN int sinkFill;                                /* Records in it */
+HIDDEN unsigned int sinkNextSeq;                    /* Sequence number of the next page */
+HIDDEN unsigned int sinkDropped;                    /* Records dropped so far */
+HIDDEN int sinkRecording;                           /* Records are being taken */
+HIDDEN volatile unsigned int sinkLock;              /* Guards the buffers */
+HIDDEN int sinkFlash;                               /* Flash device holding the trace (NOBLOCK if none) */
+HIDDEN int sinkBlocks;                              /* Its size in blocks */
+HIDDEN int sinkBlock;                               /* Block the next page goes to */
+HIDDEN int sinkWriteMutex;                          /* One writer of pages at a time */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initTraceSink
+ *
+ * Description: Claims the highest-numbered installed flash device that no
+ *              region or shared segment uses, launches the trace writer
+ *              and starts recording. Called once at boot after the backing
+ *              regions are set
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initTraceSink() {
+    sinkLock = 0;
+    sinkRecording = FALSE;
+    sinkFull[0] = FALSE;
+    sinkFull[1] = FALSE;
+    sinkNextSeq = 0;
+    sinkDropped = 0;
+    sinkBlock = 0;
+    sinkWriteMutex = 1;
+    sinkFlash = NOBLOCK;
+    if (!TRACESINK) {
+        return;
+    }
+
+    /* Find a device nothing else uses */
+    int flashNum;
+    for (flashNum = DEV_PER_LINE - 1; (flashNum >= 0) && (sinkFlash == NOBLOCK); flashNum--) {
+        device_t *flash = DEVDESC(FLASHINT, flashNum)->dd_reg;
+        int free = (flash->d_status != NOTINSTALLED) && (flash->d_data1 > 0) && (flashNum != SHMFLASH);
+        int block;
+        for (block = 0; free && (block < (int)flash->d_data1); block++) {
+            free = !reservedBlock(flashNum, block);
+        }
+        if (free) {
+            sinkFlash = flashNum;
+            sinkBlocks = flash->d_data1;
+        }
+    }
+    if (sinkFlash == NOBLOCK) {
+        return;
+    }
+
+    /* Launch the writer */
+    state_t writerState;
+    writerState.s_pc = (memaddr)traceWriter;
+    writerState.s_t9 = (memaddr)traceWriter;
+    writerState.s_sp = TRACER_STACK;
+    writerState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+    writerState.s_entryHI = 0; /* ASID 0 */
+    SYSCALL(CREATEPROCESS, (int)&writerState, 0, TRACETICKETS);
+
+    /* Start recording */
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    acquireSpin(&sinkLock);
+    startTracePage(0);
+    sinkRecording = TRUE;
+    releaseSpin(&sinkLock);
+    setSTATUS(status);
+}
+
+/* ========================================================================
+ * Function: traceRecord
+ *
+ * Description: Appends one record to the page being filled. A full page
+ *              goes to the writer and recording moves to the other buffer;
+ *              if the writer still has that one, the record is dropped.
+ *              Runs with interrupts off, from the nucleus or the Support
+ *              Level
+ *
+ * Parameters:
+ *              kind - TRK_SCHED, TRK_INTERRUPT, TRK_PAGING or TRK_SYSCALL
+ *              event - Event within the kind
+ *              asid - ASID the event is about (0 for kernel processes)
+ *              arg - Argument of the event
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void traceRecord(int kind, unsigned int event, int asid, unsigned int arg) {
+    if (!TRACESINK || !sinkRecording) {
+        return;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    acquireSpin(&sinkLock);
+    if (sinkRecording && (sinkFill == TRACEPAGERECS) && !sinkFull[1 - sinkCurrent]) {
+        sinkFull[sinkCurrent] = TRUE;
+        startTracePage(1 - sinkCurrent);
+    }
+    if (!sinkRecording) {
+        /* Stopped while we waited for the lock */
+    } else if (sinkFill == TRACEPAGERECS) {
+        sinkDropped++;
+    } else {
+        cpu_t now;
+        STCK(now);
+        traceRecord_PTR record = &sinkBuffer[sinkCurrent][sinkFill];
+        record->tr_tod = (unsigned int)now;
+        record->tr_kind = kind;
+        record->tr_cpu = CPUID();
+        record->tr_asid = asid;
+        record->tr_event = event;
+        record->tr_arg = arg;
+        sinkFill++;
+    }
+    releaseSpin(&sinkLock);
+    setSTATUS(status);
+}
+
+/* ========================================================================
+ * Function: traceSinkDevice
+ *
+ * Description: Checks if a flash device was claimed for the trace
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *
+ * Returns:
+ *              TRUE if the device holds the trace
+ * ======================================================================== */
+int traceSinkDevice(int flashNum) {
+    return TRACESINK && (sinkFlash != NOBLOCK) && (flashNum == sinkFlash);
+}
+
+/* ========================================================================
+ * Function: syncTraceSink
+ *
+ * Description: Stops recording, ends the page in progress with TRK_NONE
+ *              records and writes every buffered page. Called by test()
+ *              before shutdown
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void syncTraceSink() {
+    if (!TRACESINK || (sinkFlash == NOBLOCK)) {
+        return;
+    }
+
+    unsigned int status = getSTATUS();
+    setSTATUS(status & ~STATUS_IEc);
+    acquireSpin(&sinkLock);
+    if (sinkRecording) {
+        sinkRecording = FALSE;
+        while (sinkFill < TRACEPAGERECS) {
+            traceRecord_PTR record = &sinkBuffer[sinkCurrent][sinkFill];
+            record->tr_tod = 0;
+            record->tr_kind = TRK_NONE;
+            record->tr_cpu = 0;
+            record->tr_asid = 0;
+            record->tr_event = 0;
+            record->tr_arg = 0;
+            sinkFill++;
+        }
+        sinkFull[sinkCurrent] = TRUE;
+    }
+    releaseSpin(&sinkLock);
+    setSTATUS(status);
+
+    writeTracePages();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: traceWriter
+ *
+ * Description: The trace writer daemon. Writes the full pages, and sleeps
+ *              TRACEFLUSH microseconds whenever there were none
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void traceWriter() {
+    while (TRUE) {
+        if (writeTracePages() == 0) {
+            cpu_t currTime;
+            STCK(currTime);
+            SYSCALL(WAITUNTIL, (int)(currTime + TRACEFLUSH), 0, 0);
+        }
+    }
+}
+
+/* ========================================================================
+ * Function: writeTracePages
+ *
+ * Description: Writes each full buffer, oldest page first, to the next
+ *              block of the trace device and gives it back to recording.
+ *              The records of a page that fails to write count as dropped
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              Number of pages written
+ * ======================================================================== */
+int writeTracePages() {
+    int written = 0;
+    SYSCALL(PASSEREN, (int)&sinkWriteMutex, 0, 0);
+    while (sinkFull[0] || sinkFull[1]) {
+        int buffer = (sinkFull[0] && (!sinkFull[1] || (sinkSeq[0] < sinkSeq[1]))) ? 0 : 1;
+        int result = flashTransfer(WRITE, sinkFlash, sinkBlock, (memaddr)sinkBuffer[buffer], SYSTEMASID);
+        sinkBlock = (sinkBlock + 1) % sinkBlocks;
+
+        unsigned int status = getSTATUS();
+        setSTATUS(status & ~STATUS_IEc);
+        acquireSpin(&sinkLock);
+        if (result != READY) {
+            sinkDropped += TRACEPAGERECS - 1;
+        }
+        sinkFull[buffer] = FALSE;
+        releaseSpin(&sinkLock);
+        setSTATUS(status);
+        written++;
+    }
+    SYSCALL(VERHOGEN, (int)&sinkWriteMutex, 0, 0);
+    return written;
+}
+
+/* ========================================================================
+ * Function: startTracePage
+ *
+ * Description: Makes a buffer the one being filled and writes its page
+ *              header. Called with the sink lock held
+ *
+ * Parameters:
+ *              buffer - Buffer to fill (0 or 1)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void startTracePage(int buffer) {
+    cpu_t now;
+    STCK(now);
+    traceRecord_PTR header = &sinkBuffer[buffer][0];
+    header->tr_tod = (unsigned int)now;
+    header->tr_kind = TRK_PAGE;
+    header->tr_cpu = CPUID();
+    header->tr_asid = TRACEMAGIC;
+    header->tr_event = sinkNextSeq;
+    header->tr_arg = sinkDropped;
+    sinkSeq[buffer] = sinkNextSeq;
+    sinkNextSeq++;
+    sinkCurrent = buffer;
+    sinkFill = 1;
+}
@@ -0,0 +1,201 @@
+/******************************* userSemaphore.c *****************************
+ *
+ * Module: User Semaphores
+ *
+ * Description:
+ * This module gives U-procs counting semaphores. The nucleus P and V are
+ * kernel-mode only, so the Support Level keeps a table of USERSEMS named
+ * semaphores in kernel memory, identified by their index, and performs the
+ * P and V on a U-proc's behalf. The nucleus semaphore and its ASL queue
+ * back each one directly.
+ *
+ * SYS39 is a plain P. SYS29 is a P that gives up at a deadline: it is the
+ * nucleus WAITUNTIL call on the named semaphore, so the U-proc sits on the
+ * semaphore and on the nucleus timer wheel at once. A V takes it off the wheel, and the
+ * deadline takes it off the semaphore with outBlocked, leaving the count as
+ * if the P had never happened.
+ *
+ * The handlers run with interrupts off around a look at the value, so a
+ * P on an available semaphore and a V with no one waiting just change the
+ * value, without a nucleus syscall; only a P that has to block and a V
+ * that wakes someone go through the nucleus (and its ASL queue). A V
+ * that leaves a unit also wakes any SYS53 caller watching the semaphore.
+ *
+ * Policy Decisions:
+ * - Naming: Semaphores are shared by every U-proc; the ID is the agreement
+ * - Initial Value: Every semaphore starts at 0 when test() starts
+ * - Timeouts: a2 is a relative timeout in microseconds; 0 tries the P
+ *   without blocking
+ * - Statistics: A fast-path P is counted in the contention statistics as
+ *   an uncontended one, as if it had gone through the nucleus
+ * - Error Handling: An ID outside the table or a negative timeout
+ *   terminates the U-proc
+ *
+ * Functions:
+ * - initUserSemaphores: Zeroes the named semaphores
+ * - pSemTimedSyscallHandler: Implements SYS29 (PSEMTIMED)
+ * - vSemNamedSyscallHandler: Implements SYS30 (VSEMNAMED)
+ * - pSemNamedSyscallHandler: Implements SYS39 (PSEMNAMED)
+ * - tryTakeSemaphore: Takes a unit of a semaphore if one is available (also for SYS53)
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/userSemaphore.h"
+
+/*----------------------------------------------------------------------------*/
+/* Foward Declarations for External Functions */
+/*----------------------------------------------------------------------------*/
+/* waitAny.c */
+extern void notifyWaiters(int kind, int asid, int handle);
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN int userSems[USERSEMS];                  /* The named semaphores */
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initUserSemaphores
+ *
+ * Description: Sets every named semaphore to 0
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initUserSemaphores() {
+    int i;
+    for (i = 0; i < USERSEMS; i++) {
+        userSems[i] = 0;
+    }
+}
+
+/* ========================================================================
+ * Function: pSemTimedSyscallHandler
+ *
+ * Description: Handles SYS29 (PSEMTIMED). Performs a P on the named
+ *              semaphore a1 that gives up after a2 microseconds
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              SUCCESS if the semaphore was acquired, TIMEDOUT if the
+ *              timeout passed first
+ * ======================================================================== */
+int pSemTimedSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    int semId = exceptState->s_a1;
+    int micros = exceptState->s_a2;
+
+    /* Validate parameters */
+    if ((semId < 0) || (semId >= USERSEMS) || (micros < 0)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Fast path: an available semaphore needs no nucleus call */
+    if (tryTakeSemaphore(semId)) {
+        return SUCCESS;
+    }
+    if (micros == 0) {
+        return TIMEDOUT;
+    }
+
+    /* P on the semaphore and the timer wheel together */
+    cpu_t currTime;
+    STCK(currTime);
+    cpu_t deadline = (micros > (MAXINT - currTime)) ? MAXINT : (currTime + micros);
+    return SYSCALL(WAITUNTIL, (int)deadline, (int)&userSems[semId], 0);
+}
+
+/* ========================================================================
+ * Function: vSemNamedSyscallHandler
+ *
+ * Description: Handles SYS30 (VSEMNAMED). Performs a V on the named
+ *              semaphore a1, readying the U-proc that has waited longest
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              SUCCESS
+ * ======================================================================== */
+int vSemNamedSyscallHandler(support_PTR supportStruct) {
+    int semId = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+
+    /* Validate parameters */
+    if ((semId < 0) || (semId >= USERSEMS)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    /* Fast path: with no one waiting, just count the unit */
+    setInterrupts(OFF);
+    if (userSems[semId] >= 0) {
+        userSems[semId]++;
+        setInterrupts(ON);
+        notifyWaiters(WAITSEM, 0, semId);
+        return SUCCESS;
+    }
+    setInterrupts(ON);
+
+    SYSCALL(VERHOGEN, (int)&userSems[semId], 0, 0);
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * Function: pSemNamedSyscallHandler
+ *
+ * Description: Handles SYS39 (PSEMNAMED). Performs a P on the named
+ *              semaphore a1, blocking on its ASL queue until a V if it is
+ *              not available
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              SUCCESS
+ * ======================================================================== */
+int pSemNamedSyscallHandler(support_PTR supportStruct) {
+    int semId = supportStruct->sup_exceptState[GENERALEXCEPT].s_a1;
+
+    /* Validate parameters */
+    if ((semId < 0) || (semId >= USERSEMS)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+
+    if (!tryTakeSemaphore(semId)) {
+        SYSCALL(PASSEREN, (int)&userSems[semId], 0, 0);
+    }
+    return SUCCESS;
+}
+
+/* ========================================================================
+ * Function: tryTakeSemaphore
+ *
+ * Description: Takes a unit of a named semaphore if one is available,
+ *              with interrupts off so no nucleus P, V or timeout on it
+ *              interleaves. Also how SYS53 takes a ready semaphore
+ *
+ * Parameters:
+ *              semId - ID of the semaphore (already validated)
+ *
+ * Returns:
+ *              TRUE if a unit was taken, FALSE if the caller must block
+ * ======================================================================== */
+int tryTakeSemaphore(int semId) {
+    setInterrupts(OFF);
+    int taken = (userSems[semId] > 0);
+    if (taken) {
+        userSems[semId]--;
+        lockAcquired(&userSems[semId], FALSE);
+    }
+    setInterrupts(ON);
+    return taken;
+}
@@ -8,21 +8,259 @@
  * management of the swap pool.
  *
  * Policy Decisions:
- * - Page Replacement: The module implements a modified FIFO algorithm, it checks
- *   if there are any unoccupied frames first, otherwise it chooses the next frame
+ * - Page Replacement: The module checks if there are any unoccupied frames
+ *   first. Otherwise, with REPLACEMENT set to FIFOPOLICY it chooses the next
+ *   frame in FIFO order, and with CLOCKPOLICY it runs CLOCK (second chance):
+ *   uMPS3 has no hardware reference bits, so uTLB_RefillHandler sets a
+ *   software referenced bit in the frame's swap pool entry. When the clock
+ *   hand passes a referenced frame it clears the bit and drops the frame's
+ *   TLB entry, so the next access refills and marks it again; the first
+ *   frame found unreferenced is evicted. Hot pages such as the stack page
+ *   stay resident.
  * - Process Termination: When a process terminates, all its physical frames and
  *   swap entries are immediately reclaimed for use by other processes
+ * - Read-Ahead: A fault on the page right after the last one a U-proc
+ *   faulted or read ahead counts as in order. Each in-order fault doubles
+ *   the U-proc's window, up to READAHEADMAX, and that many following pages
+ *   are read into free or clean frames in the same critical section. They
+ *   are valid in the page table but not referenced and not in the TLB, so
+ *   an unused guess is the first thing CLOCK evicts. Any other fault
+ *   resets the window
+ * - Dirty Tracking: Every page is loaded read-only and clean (D bit off).
+ *   The first write to a data page raises a TLB-Modification exception,
+ *   which the pager answers by setting the D bit in the page table and TLB
+ *   and marking the frame dirty, so only pages actually written are ever
+ *   written back. A write to a text page is still fatal
+ * - Page Cleaner: With PAGECLEANER set, a kernel daemon wakes every
+ *   CLEANINTERVAL and writes back the dirty, unreferenced frames among the
+ *   CLEANAHEAD frames after the replacement pointer, so evictions mostly
+ *   find clean frames and cost a single read. A cleaned page is mapped
+ *   read-only again, so its next write re-dirties it as above
+ * - Clustered Write-Back: The cleaner writes a dirty page together with
+ *   the dirty, unreferenced pages of the same ASID at the VPNs next to it
+ *   (up to WBCLUSTER, found through the reverse index), all made busy and
+ *   written in one release of the mutex in ascending block order (image
+ *   pages ascend through the shadow blocks, stack pages descend from the
+ *   top of the region). When the pager has to write back a dirty victim
+ *   it leaves the victim's neighbours to the cleaner as a hint and wakes
+ *   it, so the faulter only waits for its own page
+ * - Idle Work: With IDLEWORK set, the scheduler calls idleWork before it
+ *   waits for an interrupt with nothing ready. If no one holds the swap
+ *   pool mutex, it zeroes up to IDLEZEROBATCH free frames, stopping as
+ *   soon as an interrupt is pending, and a zero-fill fault that gets a
+ *   zeroed frame skips the zeroing. Writing back blocks, so the nucleus
+ *   never does it: if a frame ahead of the replacement pointer is one the
+ *   cleaner would write back, idleWork wakes the cleaner for an early
+ *   pass, at most once per CLEANINTERVAL sleep. The free-frame stack is
+ *   an O(1) LIFO, so there is nothing to compact
+ * - Compressed Tier: With COMPRESSSWAP set, initSwapPool keeps up to
+ *   ZSWAPFRAMES frames out of the pool as an arena of ZCHUNKWORDS-word
+ *   chunks. backingStoreRW writes a private page back by compressing it
+ *   (runs of ZMINRUN or more equal words as a count and the word, other
+ *   words literally) into a chain of chunks, and goes to flash only if the
+ *   page does not fit in ZMAXWORDS words or the free chunks. A read takes
+ *   the arena copy first; the copy stays there, since a clean page is
+ *   evicted without a write, until the page is written back again (which
+ *   replaces or, on overflow, drops it) or the ASID's frames are cleared.
+ *   Shared segment pages always go to flash. The arena has its own mutex,
+ *   taken after the swap pool mutex and never held across device I/O
+ * - Wired Pages: SYS45 keeps up to WIREMAXPAGES pages of a U-proc resident
+ *   (faulting them in first) by setting its bit in their frames' wiredBy
+ *   masks, and clears it again with PINRELEASE. Replacement, the local
+ *   victim search and page messages pass over a wired frame, and a wiring
+ *   U-proc's bits are dropped when its frames are cleared. Wired frames
+ *   and frames pinned for zero-copy transfers share pinLimit, so the
+ *   pager always finds a frame; a wired page is resident, so its
+ *   zero-copy transfers never fall back to the DMA buffers
+ * - Pool Size: initSwapPool gives the swap pool every frame between the end
+ *   of the kernel image (SWAPPOOLSTART) and the kernel slab frames below the
+ *   DMA buffers and stacks (SWAPPOOLEND), less the frames its own metadata
+ *   takes at the top of that range, so the pool grows with installed RAM
+ * - Metadata Layout: The pool's metadata is a structure of arrays. The
+ *   valid, dirty, referenced, busy, zeroed and wired states are bitmaps
+ *   (a word covers 32 frames), and the other fields are arrays of the
+ *   narrowest type that holds them, so the clock hand, the cleaner's
+ *   look-ahead and the scans for busy or wired frames read a few words
+ *   instead of a whole entry per frame. An (asid, vpn) hash chains every
+ *   occupied frame through frameHashNext, so the victim cache is searched
+ *   by page instead of frame by frame
+ * - Zero-Fill: With ZEROFILL set, pages with nothing in the image (the
+ *   stack page, and BSS pages past the .text and .data file sizes the aout
+ *   header gives the first time page 0 is loaded) are zeroed in RAM on a
+ *   fault instead of read. A page stays zero-fill until it is first
+ *   written back, after which it is read like any other
+ * - Shared Text: With SHAREDTEXT set, every text page of a new U-proc is
+ *   fingerprinted (FNV-1a over its flash block), by createUProcess or,
+ *   with BOOTFASTSTART, by test() once every U-proc is running; until then
+ *   the U-proc shares no text. A fault on a
+ *   text page that another U-proc with the same image and page fingerprint
+ *   has resident maps that frame instead of reading a copy. The frame's
+ *   swap pool entry keeps a reference count and a sharer mask (one bit per
+ *   ASID), so eviction and TLB updates reach every sharer's page table, and
+ *   a terminating owner hands the frame to another sharer
+ * - Victim Cache: An evicted page is unmapped (and written back if dirty)
+ *   but its frame is kept intact on a FIFO of up to VICTIMCACHE frames;
+ *   the frame actually reused is the oldest one on it. A fault on a page
+ *   still in the cache just maps the frame again with no device I/O
+ * - Fault-Frequency Control: With PFFCONTROL set, each fault updates the
+ *   U-proc's fault count and smoothed inter-fault time. A gap under PFFLOWER
+ *   grows its resident-set limit by a frame (up to rssCeiling), a gap over
+ *   PFFUPPER shrinks it (down to RSSFLOOR). Once the pool has no free frame,
+ *   a U-proc at its limit replaces one of its own frames. When the limits
+ *   of the live U-procs add up to more than the pool, the one faulting
+ *   fastest drops to the floor and is suspended for up to PFFSUSPEND (a
+ *   termination wakes it early) so the others can make progress
+ * - Group Frame Limits: A U-proc whose resource group (resourceGroup.c)
+ *   holds its rg_maxFrames frames replaces a frame of its own, or of the
+ *   member holding the most, before it looks at free frames or the
+ *   replacement pointer, so one group can not take the whole pool
+ * - Frame Locking: The swap pool mutex only guards the pool's bookkeeping.
+ *   A fault reserves its frame (unmapping the old page and marking the
+ *   frame busy) and then releases the mutex for the write-back and read,
+ *   so faults on different flash devices overlap; the page cleaner writes
+ *   the same way. Busy frames are skipped by replacement, the cleaner and
+ *   the victim cache, a fault on a page still being written back waits
+ *   for that write, and a terminating U-proc waits for the cleaner to be
+ *   done with its frames. A zero-copy DMA transfer pins its user frame by
+ *   marking it busy the same way (pinUserPage)
+ * - Page Messages: A page-sized IPC message moves its frame instead of its
+ *   bytes. detachUserPage unmaps a resident private data page from the
+ *   sender and keeps the frame busy, owned by nobody, while it waits in
+ *   a mailbox; attachUserPage maps it in the receiver's page table dirty
+ *   (it has no backing store copy there), freeing the frame the receiver
+ *   had for that page. The sender's page reads back its last written-back
+ *   (or zero-fill) contents. Frames in transit count against pinLimit.
+ *   The network driver moves packets in frames the same way, posting
+ *   free frames (takeTransitFrame) as its receive buffers
+ * - Shared Segments: SYS38 attaches an ASID to one of SHMSEGMENTS named
+ *   segments, a range of data pages fixed by its first attacher and the
+ *   same page numbers in every attached ASID. A fault on a segment page
+ *   maps another attacher's resident frame (through the shared text
+ *   sharer mask, so eviction and cleaning reach every mapping) or reads
+ *   it from the segments' region of flash SHMFLASH, whichever ASID
+ *   faults. A new segment starts zero-fill. Segment pages are never read
+ *   ahead or moved by page messages. A terminating attacher writes back
+ *   the dirty segment frames only it maps while others remain attached;
+ *   the last one to go deletes the segment
+ * - Disk Maps: SYS52 maps up to DISKMAPMAXPAGES sectors of a disk (one
+ *   sector is one page) at a range of data pages. It is a segment too,
+ *   in one of the DISKMAPS slots after the named ones, found by its disk,
+ *   first sector and range, so every U-proc mapping the same sectors at
+ *   the same pages shares the frames; a map overlapping a different map
+ *   of those sectors fails. Its pages are read from and written back to
+ *   the sectors (never zero-fill, compressed or read ahead), so a scan of
+ *   disk data costs one transfer per page and no copies. The pages are
+ *   written back when a U-proc's exit or respawn leaves nobody else
+ *   mapping them. Mapping drops the sectors from the block cache (writing
+ *   back a dirty copy); SYS14/15 on a mapped sector bypass the frames
+ * - Stack Growth: Below the stack page (page USTACKNUM) the stack may grow
+ *   by up to STACKEXTPAGES more pages, down to USTACKLIMIT. They are pages
+ *   MAXPAGES and up, kept in a second-level table that a U-proc only gets
+ *   (one per ASID, linked from sup_stackTable) the first time it faults
+ *   there, so small U-procs carry no extra page table. Their backing store
+ *   is the top STACKEXTPAGES blocks of the U-proc's backing region, and
+ *   they start zero-fill
+ * - Backing Regions: Each ASID's backing store is a region of blocks on a
+ *   flash device set at creation from the boot configuration
+ *   (setBackingStore): the image from its first block, the shadow and
+ *   stack extension blocks at its end. By default ASID n has all of flash
+ *   n - 1; several ASIDs can share a device with disjoint regions
+ * - Swap Striping: With SWAPSTRIPE set, the configured ASIDs are put in
+ *   stripe groups of up to STRIPEWIDTH whose regions sit on different
+ *   flash devices (stripeBackingStores, at boot before any U-proc runs).
+ *   The shadow and stack blocks of a group are then shared out so slot s
+ *   of the group's k-th ASID lives at slot s of the region of member
+ *   (k + s) mod width: each region still holds one slot of each number,
+ *   but an ASID's consecutive pages land on different devices, so one
+ *   U-proc's page-ins, cleaner write-backs and clustered runs queue on
+ *   several devices at once. The grouping never changes, so a clone
+ *   taking a configured ASID takes its slots too. Image pages are still
+ *   read from the image's own region
+ * - Image Shadow: With IMAGESHADOW set, a data page below MAXPAGES is never
+ *   written back over its image block. It goes to its shadow block, one of
+ *   the SHADOWPAGES blocks below the stack extension blocks, and the
+ *   ASID's shadow mask sends later reads of the page there, so the flash
+ *   image stays as it was loaded for as long as the U-proc runs
+ * - Respawn: SYS43 restarts the calling U-proc from its image. Its
+ *   segments are flushed and detached and every frame it owns is freed
+ *   except clean text frames, which stay resident (or in the victim
+ *   cache) and shared; the data, BSS and stack pages and the shadow mask
+ *   start over, so they are read from the intact image or zeroed again.
+ *   The ASID, support structure, mailbox and fingerprints are kept
+ * - Fork: SYS48 clones the calling U-proc into a free ASID. The child's
+ *   page table maps every frame the parent has resident: text and segment
+ *   frames shared as usual, private pages read-only in both as
+ *   copy-on-write sharers of one frame. The first write to such a page
+ *   (a TLB-Modification) copies it into a frame of the writer's own; the
+ *   last sharer left keeps the original. A copy-on-write frame is never
+ *   cached as a victim: evicting it writes it back for every sharer, and
+ *   a sharer taking it over marks it dirty, since no backing store but
+ *   the old owner's holds it. The backing store is cloned lazily. Pages
+ *   still in the image are read from the parent's image (the child's
+ *   region records whose image it runs, which IMAGESHADOW keeps intact),
+ *   zero-fill pages stay zero-fill, and only a page whose latest copy is
+ *   one of the parent's own written-back (shadow, stack or compressed)
+ *   copies is faulted in at the fork to be shared. An ASID no configured
+ *   U-proc uses gets the default region, all of flash asid - 1, if no
+ *   other region is on that device
+ * - Checkpoints: SYS61 (checkpoint.c) saves a U-proc's private pages that
+ *   differ from its image: the resident ones first, then those only in its
+ *   own backing store (snapshotPages). The rest are read from the image or
+ *   zero-filled again after a restore, which maps the saved pages dirty
+ * - Page-in Boost: While the pager's I/O for a fault is under way, the
+ *   faulting thread's sup_faultMutex points at the swap pool mutex. If
+ *   that I/O ends while faulters wait on the swap pool mutex (or on any
+ *   mutex the thread holds), the scheduler queues it to run next
+ *   (FAULTBOOST), so it maps its page and gives the mutex up sooner
+ * - Threads: A thread's support structure (SYS49) holds its own
+ *   exception states and contexts but points (sup_space) at its U-proc's,
+ *   which holds the page table, so the refill handler, the pager and every
+ *   routine taking a caller's support structure page in that one. The
+ *   owner's own sup_space points at itself
+ * - Frame Lists: Unoccupied frames sit on a free-frame stack and each ASID
+ *   keeps a doubly linked list of the frames it owns (both threaded through
+ *   the swap pool entries), so taking a free frame, handing a victim to a
+ *   new owner and reclaiming a terminated U-proc's frames are O(1) per frame
+ * - Time Page: With TIMEPAGE set the refill handler maps UTIMEPAGE, one page
+ *   above the last U-proc page, to the nucleus time page frame, valid but
+ *   not dirty, so a write to it is a TLB-Modification and terminates the
+ *   U-proc. It is no page table's page and never in the swap pool
  *
  * Functions:
  * - pager: Handles TLB miss exceptions by loading pages into memory
+ * - registerText: Registers a new U-proc for text sharing, with nothing shared yet
+ * - fingerprintText: Fingerprints a registered U-proc's text pages for sharing
+ * - setBackingStore: Sets the flash region an ASID pages from
+ * - stripeBackingStores: Groups the configured regions into swap stripes
+ * - formStripe: Makes a set of ASIDs one stripe group
+ * - swapBlock: Locates a private page's shadow or stack block
+ * - reservedBlock: Checks if a flash block is part of a U-proc's backing store
+ * - pageCleaner: Daemon that writes back dirty frames ahead of eviction
+ * - idleWork: Zeroes free frames and wakes the cleaner while the nucleus idles
+ * - pinPagesSyscallHandler: Implements SYS45 (PINPAGES)
  * - uTLB_RefillHandler: Low-level handler for TLB refill events
  * - initSupportStructFreeList: Initializes support structures for processes
  * - allocateSupportStruct: Allocates a support structure for a new process
  * - initSwapPool: Initializes the swap pool data structure
- * - terminateUProcess: Cleans up resources when a user process terminates
+ * - terminateUProcess: Terminates a user process for a trap
+ * - exitUProcess: Cleans up resources when a user process terminates
+ * - resetAddressSpace: Resets a respawning U-proc to its image, keeping text frames
+ * - cloneAddressSpace: Clones a U-proc's address space copy-on-write (SYS48)
+ * - discardClone: Frees a clone whose U-proc could not be created
  * - setInterrupts: Enables/disables interrupts for critical sections
  * - resumeState: Resumes execution of a process from a saved state
  * - validateUserAddress: Checks if an address is in user space
+ * - pinUserPage: Pins a resident user page for a zero-copy device transfer
+ * - unpinUserPage: Releases a page pinned by pinUserPage
+ * - readResidentWord: Reads a user word through its frame if the page is resident
+ * - sharedSegment: Finds the shared segment holding a user address
+ * - detachUserPage: Takes a resident page's frame from a U-proc for a message
+ * - attachUserPage: Maps a message's frame as a page of the receiving U-proc
+ * - releaseMessageFrame: Frees the frame of a message that was not attached
+ * - takeTransitFrame: Takes a free frame to carry data in transit (a packet)
+ * - snapshotPages: Lists the pages a checkpoint of a U-proc must save
+ * - shmAttachSyscallHandler: Implements SYS38 (SHMATTACH)
+ * - diskMapSyscallHandler: Implements SYS52 (DISKMAP)
  * - clearSwapPoolEntries: Clears swap pool entries for a given ASID
  * - allocateSupportStruct: Allocates a support structure from the free list
  * - deallocateSupportStruct: Returns a support structure to the free list
@@ -30,8 +268,73 @@
  * - resetSupportStruct: Resets a support structure
  * - updateFrameNum: Updates the next frame number for page replacement
  * - backingStoreRW: Reads or writes a page to/from the backing store
- * - updateTLB: Updates the TLB with a new page table entry
+ * - updateTLB: Updates the TLB entries of every sharer of a frame
+ * - dropTLBEntry: Removes every sharer's entry for a frame from the TLB
+ * - updatePageTLB: Updates the TLB entry of one page table entry
+ * - dropPageTLB: Removes the TLB entry of one page table entry
+ * - sweepFrameTLB: Drops every TLB entry mapping a frame in one pass
+ * - purgeASIDTLB: Drops every TLB entry of an ASID in one pass
+ * - shootdownTLB: Waits until other processors drop some ASIDs' TLB entries
+ * - sharerPTE: Finds a sharer's page table entry for a frame
+ * - findSharedText: Finds a resident frame holding an identical text page
+ * - shareFrame: Maps a resident text frame for one more U-proc
+ * - releaseSharedFrames: Drops a terminating U-proc from frames others own
+ * - unmapFrame: Unmaps a frame's page from every U-proc mapping it
+ * - reserveFrame: Takes a frame from its owner and marks it busy for I/O
+ * - fillFrame: Writes back and reads a reserved frame without the swap pool mutex
+ * - writeBackPending: Checks if a page's write-back is still in flight
+ * - ownsBusyFrame: Checks if an ASID owns a frame the cleaner is writing
+ * - waitForFrames: Blocks until a busy frame's I/O finishes
+ * - wakeFrameWaiters: Wakes the U-procs waiting on busy frames
+ * - loadPage: Fills a frame with a page, from the backing store or zeroed
+ * - markZeroFillPages: Marks the BSS pages given by the aout header as zero-fill
+ * - reuseFrame: Picks a frame to load into, passing victims through the victim cache
+ * - localVictim: Picks one of an ASID's own frames to replace
+ * - groupVictim: Picks a frame of a resource group at its frame limit
+ * - groupResident: Counts the frames the members of a resource group hold
+ * - pffFault: Updates a U-proc's fault rate and resident-set limit
+ * - cacheVictim: Adds an evicted frame to the victim cache
+ * - reclaimVictim: Takes a U-proc's page back out of the victim cache
+ * - removeVictim: Removes a frame from the victim cache
+ * - installPage: Maps a freshly read frame into a U-proc's page table
+ * - readAhead: Speculatively loads the pages after an in-order fault
+ * - cleanFrame: Writes back a dirty frame and maps its page read-only
+ * - cleanCluster: Writes back a run of an ASID's dirty pages around a page
+ * - clusterPage: Finds a neighbouring page a clustered write-back may take
+ * - beginClean: Maps a dirty frame's page read-only and marks it busy
+ * - endClean: Ends a frame's write-back, re-dirtying it if that failed
+ * - redirtyPage: Makes a cleaned page writable again after a TLB-Modification
+ * - linkOwnedFrame: Adds a frame to its owner's list
+ * - unlinkOwnedFrame: Removes a frame from its owner's list
+ * - poolMetaBytes: Sizes the swap pool metadata for a number of frames
+ * - placePoolMeta: Lays the swap pool metadata arrays out from an address
+ * - setFrameFlag: Sets or clears a frame's bit in a state bitmap
+ * - atomicSetFrame: Sets a frame's bit without the swap pool mutex
+ * - nextMarkedFrame: Finds the next frame with its bit set in a state bitmap
+ * - setWiredBy: Sets a frame's wiring ASIDs, keeping the wired bitmap in step
+ * - pageBucket: Hashes an (asid, vpn) to its reverse index bucket
+ * - setFrameOwner: Changes the page a frame holds, keeping the reverse index
+ * - findPage: Looks an (asid, vpn) up in the reverse index
+ * - recordRecentPage: Records a faulted page for the dispatch-time TLB preload
+ * - pageNumber: Maps a user page address to its page number
+ * - pageEntry: Finds a page's page table entry, attaching the stack table
+ * - clearZeroFill: Records that a page has a backing store copy
  * - isTextPage: Checks if a page is a text page
+ * - segmentOf: Finds the shared segment an ASID's page belongs to
+ * - findSegmentFrame: Finds another attacher's resident frame for a segment page
+ * - flushSegments: Writes back the segment frames only a terminating ASID maps
+ * - detachSegments: Detaches a terminating ASID from its segments
+ * - attachSegment: Attaches an ASID to a named segment or a disk map
+ * - diskMapSlot: Finds or frees the segment slot for a disk map
+ * - freeFrame: Returns an unmapped frame to the free-frame stack
+ * - freeASID: Finds an ASID a clone can take
+ * - spareRegion: Gives an ASID no U-proc was configured with the default region
+ * - clonePage: Maps one of a parent's pages in its clone
+ * - copySharedPage: Gives a writer its own copy of a copy-on-write page
+ * - cowFrame: Checks if a frame holds a private page several ASIDs share
+ * - leaveFrame: Drops an ASID from a shared frame it no longer maps
+ * - handOffFrame: Gives a shared frame to the lowest-numbered remaining sharer
+ * - releaseASID: Lets a clone take a terminated U-proc's ASID
  *
  * Written by Aryah Rao & Anish Reddy
  *
@@ -46,26 +349,189 @@
 extern support_PTR getCurrentSupportStruct();
 /* scheduler.c */
 extern void loadProcessState(state_PTR state, unsigned int quantum);
+/* mailbox.c */
+extern void closeMailbox(int asid);
+/* reaper.c */
+extern void recordExit(int asid, int reason);
+/* exceptions.c */
+extern pcb_PTR verhogen(int *semAdd);
+/* thread.c */
+extern void exitThread(support_PTR supportStruct, int value);
+extern void waitForThreads(int asid);
+/* blockCache.c */
+extern void lockBlockCache();
+extern void unlockBlockCache();
+extern int dropCachedBlock(int line, int devNum, int block);
+/* traceSink.c */
+extern int traceSinkDevice(int flashNum);
+/* checkpoint.c */
+extern void dropCheckpoint(int asid);
+
+/*----------------------------------------------------------------------------*/
+/* Global variables */
+/*----------------------------------------------------------------------------*/
+unsigned int tlbRefills;                        /* TLB refills served since boot */
 
 /*----------------------------------------------------------------------------*/
 /* Module variables */
 /*----------------------------------------------------------------------------*/
-HIDDEN support_t supportStructures[MAXUPROC+1]; /* Static array of support structures */
+HIDDEN support_t supportStructures[MAXUPROC + MAXTHREADS + 1]; /* Static array of support structures (U-procs and threads) */
 HIDDEN support_PTR supportFreeList = NULL;      /* Head of the support structure free list */
-HIDDEN swapPoolEntry_t swapPool[SWAPPOOLSIZE];  /* Swap Pool data structure */
+HIDDEN int supportMutex;                        /* Semaphore for the support structure free list */
+/* Swap pool metadata, one array per field (placed above the frames): state bits first, then by size */
+HIDDEN unsigned int *validMap;                  /* Bit per frame: it holds a page mapped in its owner's page table */
+HIDDEN unsigned int *dirtyMap;                  /* Bit per frame: its page differs from the backing store */
+HIDDEN unsigned int *referencedMap;             /* Bit per frame: set by a TLB refill since the clock hand last passed */
+HIDDEN unsigned int *busyMap;                   /* Bit per frame: I/O on it is running without the swap pool mutex */
+HIDDEN unsigned int *zeroedMap;                 /* Bit per frame: free and already holding zeros (set while idle) */
+HIDDEN unsigned int *wiredMap;                  /* Bit per frame: some ASID keeps it resident with SYS45 */
+HIDDEN pageTableEntry_PTR *framePte;            /* Owner's page table entry of each frame */
+HIDDEN unsigned int *frameSharers;              /* Bit per ASID mapping each frame (the owner included) */
+HIDDEN unsigned int *frameWbSharers;            /* Copy-on-write sharers a busy frame is also written back for */
+HIDDEN unsigned int *frameWiredBy;              /* Bit per ASID keeping each frame resident with SYS45 */
+HIDDEN short *frameVpn;                         /* Page number each frame holds */
+HIDDEN short *frameWbVpn;                       /* Page number of the old page a busy frame is writing back */
+HIDDEN short *frameNext;                        /* Next frame on the free stack or the owner's list */
+HIDDEN short *framePrev;                        /* Previous frame on the owner's list */
+HIDDEN short *frameHashNext;                    /* Next frame in the same (asid, vpn) hash bucket */
+HIDDEN signed char *frameAsid;                  /* Owner of each frame (UNOCCUPIED if none) */
+HIDDEN signed char *frameWbAsid;                /* ASID of the old page a busy frame is writing back (or UNOCCUPIED) */
+HIDDEN signed char *frameRefCount;              /* Number of ASIDs mapping each frame */
+HIDDEN int pageHash[PAGEBUCKETS];               /* First occupied frame of each (asid, vpn) hash bucket */
+HIDDEN int swapPoolSize;                        /* Frames in the swap pool, sized from RAM at boot */
 HIDDEN int swapPoolMutex;                       /* Semaphore for Swap Pool access */
-HIDDEN int nextFrameNum;                        /* Next integer for FIFO replacement */
+HIDDEN int nextFrameNum;                        /* FIFO replacement pointer / clock hand */
+HIDDEN int freeFrames;                          /* Top of the free-frame stack */
+HIDDEN int ownedFrames[MAXUPROC + 1];           /* Head of each ASID's owned-frame list */
+HIDDEN int nextFaultPage[MAXUPROC + 1];         /* Page each ASID faults on next if it runs in order */
+HIDDEN int readAheadWindow[MAXUPROC + 1];       /* Pages each ASID reads ahead on its next in-order fault */
+HIDDEN unsigned int zeroFillPages[MAXUPROC + 1]; /* Pages of each ASID with no backing store copy yet */
+HIDDEN unsigned int zeroFillStack[MAXUPROC + 1]; /* Same for each ASID's stack extension pages */
+HIDDEN unsigned int shadowPages[MAXUPROC + 1];  /* Pages of each ASID whose latest copy is in its shadow block */
+HIDDEN int backingFlash[MAXUPROC + 1];          /* Flash device holding each ASID's backing store */
+HIDDEN int backingBase[MAXUPROC + 1];           /* First block of its region (the image) */
+HIDDEN int backingEnd[MAXUPROC + 1];            /* Block past its region (0 until configured) */
+HIDDEN int stripeWidth[MAXUPROC + 1];           /* Regions in each ASID's stripe group (0 if unstriped) */
+HIDDEN int stripeIndex[MAXUPROC + 1];           /* Its position in the group */
+HIDDEN int stripeMember[MAXUPROC + 1][STRIPEWIDTH]; /* The group's ASIDs, in position order */
+HIDDEN int imageASID[MAXUPROC + 1];             /* ASID whose region holds each ASID's image (itself unless cloned) */
+HIDDEN pageTableEntry_t stackTables[MAXUPROC + 1][STACKEXTPAGES]; /* Second-level tables for stack growth */
+HIDDEN support_PTR asidSupport[MAXUPROC + 1];   /* Support structure of each live ASID, for the sharer map */
+HIDDEN int textPending[MAXUPROC + 1];           /* Its text is registered but not yet fingerprinted */
+HIDDEN int victimCache[MAX(VICTIMCACHE, 1)];    /* Evicted but intact frames, oldest first */
+HIDDEN int victimCount;                         /* Frames in the victim cache */
+HIDDEN int victimLimit;                         /* Victim cache capacity, bounded by the pool size */
+HIDDEN int residentFrames[MAXUPROC + 1];        /* Length of each ASID's owned-frame list */
+HIDDEN int rssCeiling;                          /* Most frames the controller grants one ASID */
+HIDDEN int pffSem;                              /* U-procs suspended by the fault-frequency controller */
+HIDDEN int frameWaitSem;                        /* U-procs waiting for a busy frame's I/O to finish */
+HIDDEN int writeBacks;                          /* Busy frames with a write-back in flight */
+HIDDEN int pinnedFrames;                        /* Frames pinned for zero-copy transfers */
+HIDDEN int pinLimit;                            /* Most frames pinned at once */
+HIDDEN int wiredFrames;                         /* Frames wired by SYS45 (they count against pinLimit too) */
+HIDDEN int wiredPages[MAXUPROC + 1];            /* Pages each ASID has wired */
+HIDDEN shmSegment_t segments[SEGMENTS];         /* The named shared segments, then the disk maps */
+HIDDEN int swapPoolReady = FALSE;               /* initSwapPool has run (idleWork may look at the pool) */
+HIDDEN int cleanerSem;                          /* The page cleaner sleeps here between passes */
+HIDDEN int cleanerWakeable;                     /* Its sleep ran a full CLEANINTERVAL, so idleWork may cut it short */
+HIDDEN int clusterAsid;                         /* ASID whose evicted dirty page's neighbours the cleaner writes next */
+HIDDEN int clusterVpn;                          /* Page number of that evicted page */
+HIDDEN memaddr zswapArena;                      /* First frame of the compressed arena */
+HIDDEN int zswapNext[MAX(ZCHUNKS, 1)];          /* Next chunk in a page's chain or on the free stack */
+HIDDEN int zswapFree;                           /* Top of the free chunk stack */
+HIDDEN int zswapFreeCount;                      /* Chunks on it */
+HIDDEN int zswapHead[MAXUPROC + 1][MAXPAGES + STACKEXTPAGES]; /* First chunk of each page's compressed copy */
+HIDDEN unsigned int zswapBuffer[ZMAXWORDS];     /* A page compressed, before or after its chunks */
+HIDDEN int zswapMutex;                          /* Semaphore for the compressed arena */
+HIDDEN unsigned int freeASIDs;                  /* ASIDs a clone may take (ASIDBIT per ASID) */
 
 /*----------------------------------------------------------------------------*/
 /* Helper Function Prototypes */
 /*----------------------------------------------------------------------------*/
-HIDDEN void deallocateSupportStruct(support_PTR supportStruct);
+void deallocateSupportStruct(support_PTR supportStruct); /* Not HIDDEN: thread.c frees thread Support Structures */
 HIDDEN void resetSupportStruct(support_PTR supportStruct);
 HIDDEN int updateFrameNum();
 HIDDEN int backingStoreRW(int operation, int frameNum, int processASID, int pageNum);
-HIDDEN void clearSwapPoolEntries(int asid);
+HIDDEN void clearSwapPoolEntries(int asid, int keepText);
 HIDDEN void updateTLB(int victimNum);
+HIDDEN void dropTLBEntry(int frameNum);
+HIDDEN void updatePageTLB(pageTableEntry_PTR pte);
+HIDDEN void dropPageTLB(pageTableEntry_PTR pte);
+HIDDEN void sweepFrameTLB(int frameNum);
+HIDDEN void purgeASIDTLB(int asid);
+HIDDEN void shootdownTLB(unsigned int asids);
+HIDDEN pageTableEntry_PTR sharerPTE(int frameNum, int asid);
+HIDDEN int findSharedText(support_PTR supportStruct, int pageNum);
+HIDDEN void shareFrame(int frameNum, support_PTR supportStruct, int pageNum, int referenced);
+HIDDEN void releaseSharedFrames(support_PTR supportStruct, int keepText);
+HIDDEN void unmapFrame(int frameNum);
+HIDDEN void reserveFrame(int frameNum);
+HIDDEN int fillFrame(int frameNum, support_PTR supportStruct, int pageNum, int referenced, int source);
+HIDDEN int writeBackPending(int asid, int pageNum);
+HIDDEN int ownsBusyFrame(int asid);
+HIDDEN void waitForFrames();
+HIDDEN void wakeFrameWaiters();
+HIDDEN int loadPage(int frameNum, int processASID, int pageNum);
+HIDDEN void markZeroFillPages(int asid, memaddr *header);
+HIDDEN int reuseFrame(support_PTR supportStruct);
+HIDDEN int localVictim(int asid);
+HIDDEN int groupVictim(int asid);
+HIDDEN int pffFault(support_PTR supportStruct);
+HIDDEN int cacheVictim(int frameNum);
+HIDDEN int reclaimVictim(support_PTR supportStruct, int pageNum);
+HIDDEN void removeVictim(int frameNum);
+HIDDEN void installPage(int frameNum, support_PTR supportStruct, int pageNum, int referenced);
+HIDDEN void readAhead(support_PTR supportStruct, int pageNum);
+HIDDEN void pageCleaner();
+HIDDEN void cleanFrame(int frameNum);
+HIDDEN void cleanCluster(int asid, int pageNum);
+HIDDEN int clusterPage(int asid, int pageNum, int neighbour);
+HIDDEN void beginClean(int frameNum);
+HIDDEN void endClean(int frameNum, int asid, int pageNum, int status);
+HIDDEN int cleanCandidate(int frameNum);
+HIDDEN int zswapStore(int frameNum, int asid, int pageNum);
+HIDDEN int zswapLoad(int frameNum, int asid, int pageNum);
+HIDDEN void dropCompressed(int asid);
+HIDDEN int compressPage(unsigned int *page);
+HIDDEN int runLength(unsigned int *page, int index);
+HIDDEN void freeChunks(int chunk);
+HIDDEN int wirePage(support_PTR supportStruct, memaddr vAddress);
+HIDDEN void unwirePage(support_PTR supportStruct, memaddr vAddress);
+HIDDEN void unwireASID(int asid);
+HIDDEN void redirtyPage(support_PTR supportStruct, memaddr vAddress);
+HIDDEN int poolMetaBytes(int frames);
+HIDDEN memaddr placePoolMeta(memaddr base, int frames);
+HIDDEN void setFrameFlag(unsigned int *map, int frameNum, int on);
+HIDDEN void atomicSetFrame(unsigned int *map, int frameNum);
+HIDDEN int nextMarkedFrame(unsigned int *map, int frameNum);
+HIDDEN void setWiredBy(int frameNum, unsigned int wiredBy);
+HIDDEN int pageBucket(int asid, int vpn);
+HIDDEN void setFrameOwner(int frameNum, int asid, int vpn);
+HIDDEN int findPage(int asid, int vpn, int valid);
+HIDDEN void linkOwnedFrame(int frameNum);
+HIDDEN void unlinkOwnedFrame(int frameNum);
+HIDDEN void recordRecentPage(support_PTR supportStruct, int pageNum);
+HIDDEN int pageNumber(memaddr vAddress);
+HIDDEN pageTableEntry_PTR pageEntry(support_PTR supportStruct, int pageNum);
+HIDDEN void clearZeroFill(int asid, int pageNum);
 HIDDEN int isTextPage(int pageNum, support_PTR supportStruct);
+HIDDEN int segmentOf(int asid, int pageNum);
+HIDDEN int findSegmentFrame(support_PTR supportStruct, int pageNum);
+HIDDEN void flushSegments(int asid);
+HIDDEN void detachSegments(int asid);
+HIDDEN int attachSegment(support_PTR supportStruct, int asid, int segment, int basePage, int pages, int disk, int sector);
+HIDDEN int diskMapSlot(int disk, int sector, int basePage, int pages);
+HIDDEN void freeFrame(int frameNum);
+HIDDEN int freeASID();
+HIDDEN int spareRegion(int asid);
+HIDDEN void swapBlock(int asid, int pageNum, int *flashNum, int *blockNum);
+HIDDEN void formStripe(int *members, int width);
+HIDDEN int clonePage(support_PTR parent, support_PTR child, int pageNum);
+HIDDEN int copySharedPage(support_PTR supportStruct, int pageNum, int source);
+HIDDEN int cowFrame(int frameNum);
+HIDDEN void leaveFrame(int frameNum, int asid);
+HIDDEN void handOffFrame(int frameNum, int asid);
+HIDDEN void releaseASID(int asid);
 
 /*----------------------------------------------------------------------------*/
 /* Global Function Implementations */
@@ -87,10 +553,11 @@ HIDDEN int isTextPage(int pageNum, support_PTR supportStruct);
  *****************************************************************************/
 void initSupportStructFreeList() {
     supportFreeList = NULL;  /* Initialize the free list as empty */
+    supportMutex = 1;
     
     /* Add all support structures to the free list */
     int i;
-    for (i = 0; i < MAXUPROC; i++) {
+    for (i = 0; i < MAXUPROC + MAXTHREADS; i++) {
         deallocateSupportStruct(&supportStructures[i]);
     }
 }
@@ -111,12 +578,16 @@ void initSupportStructFreeList() {
  *
  *****************************************************************************/
 support_PTR allocateSupportStruct() {
-    if (supportFreeList == NULL)
+    SYSCALL(PASSEREN, (int)&supportMutex, 0, 0);
+    if (supportFreeList == NULL) {
+        SYSCALL(VERHOGEN, (int)&supportMutex, 0, 0);
         return NULL;  /* No free support structures */
+    }
     
     /* Remove the first support structure from free list */
     support_PTR allocatedSupportStruct = supportFreeList;
     supportFreeList = allocatedSupportStruct->sup_next;
+    SYSCALL(VERHOGEN, (int)&supportMutex, 0, 0);
     
     /* Reset the support structure */
     resetSupportStruct(allocatedSupportStruct);
@@ -129,7 +600,9 @@ support_PTR allocateSupportStruct() {
  * Function: initSwapPool
  *
  * Description: Initializes the swap pool data structure and related semaphore.
- *              Sets all entries to an invalid state and prepares the FIFO
+ *              Sizes the pool from the RAM left between SWAPPOOLSTART and
+ *              SWAPPOOLEND, lays its metadata arrays out in the top frames
+ *              of that range, sets every frame unoccupied and prepares the
  *              replacement algorithm.
  *
  * Parameters:
@@ -139,20 +612,376 @@ support_PTR allocateSupportStruct() {
  *              None
  * ======================================================================== */
 void initSwapPool() {
+    /* Take as many frames as fit alongside their metadata */
+    int freePages = (SWAPPOOLEND - SWAPPOOLSTART) / PAGESIZE;
+    swapPoolSize = freePages;
+    while ((swapPoolSize > 0) &&
+           ((swapPoolSize + ((poolMetaBytes(swapPoolSize) + PAGESIZE - 1) / PAGESIZE)) > freePages)) {
+        swapPoolSize--;
+    }
+    if (swapPoolSize <= 0) {
+        PANIC(); /* Not enough RAM for even one frame */
+    }
+    placePoolMeta(FRAMETOADDR(swapPoolSize), swapPoolSize);
+    setWords(validMap, 0, POOLMAPS * MAPWORDS(swapPoolSize)); /* Every state bit clear */
+    tlbRefills = 0;
+
+    /* The compressed arena takes the top frames, leaving the pool at least three quarters */
+    int arenaFrames = COMPRESSSWAP ? MIN(ZSWAPFRAMES, swapPoolSize / 4) : 0;
+    swapPoolSize -= arenaFrames;
+    zswapArena = FRAMETOADDR(swapPoolSize);
+    zswapFree = NOCHUNK;
+    zswapFreeCount = 0;
+    int chunk;
+    for (chunk = (arenaFrames * (PAGESIZE / (ZCHUNKWORDS * WORDLEN))) - 1; chunk >= 0; chunk--) {
+        zswapNext[chunk] = zswapFree;
+        zswapFree = chunk;
+        zswapFreeCount++;
+    }
+    zswapMutex = 1;
+
+    /* Every frame starts on the free-frame stack and no ASID owns any */
+    freeFrames = NOSWAPFRAME;
+    freeASIDs = 0;
     int i;
-    for (i = 0; i < SWAPPOOLSIZE; i++) {
-        swapPool[i].asid = UNOCCUPIED;
-        swapPool[i].vpn = FALSE;
-        swapPool[i].valid = FALSE;
-        swapPool[i].dirty = FALSE;
-        swapPool[i].pte = NULL;
+    for (i = 0; i <= MAXUPROC; i++) {
+        if (i > 0) {
+            freeASIDs |= ASIDBIT(i); /* Until setBackingStore gives it to a configured U-proc */
+        }
+        imageASID[i] = i;
+        ownedFrames[i] = NOSWAPFRAME;
+        nextFaultPage[i] = 0;
+        readAheadWindow[i] = 0;
+        zeroFillPages[i] = PAGEBIT(USTACKNUM);
+        zeroFillStack[i] = ALLSTACKEXT;
+        asidSupport[i] = NULL;
+        textPending[i] = FALSE;
+        residentFrames[i] = 0;
+        wiredPages[i] = 0;
+        stripeWidth[i] = 0;
+        int page;
+        for (page = 0; page < (MAXPAGES + STACKEXTPAGES); page++) {
+            zswapHead[i][page] = NOCHUNK;
+        }
+    }
+    for (i = swapPoolSize - 1; i >= 0; i--) {
+        frameNext[i] = freeFrames;
+        framePrev[i] = NOSWAPFRAME;
+        freeFrames = i;
+    }
+
+    for (i = 0; i < swapPoolSize; i++) {
+        frameAsid[i] = UNOCCUPIED;
+        frameVpn[i] = 0;
+        framePte[i] = NULL;
+        frameSharers[i] = 0;
+        frameRefCount[i] = 0;
+        frameWbAsid[i] = UNOCCUPIED;
+        frameWbVpn[i] = 0;
+        frameWbSharers[i] = 0;
+        frameWiredBy[i] = 0;
+        frameHashNext[i] = NOSWAPFRAME;
+    }
+    for (i = 0; i < PAGEBUCKETS; i++) {
+        pageHash[i] = NOSWAPFRAME;
     }
 
     /* Initialize the FIFO replacement pointer */
     nextFrameNum = 0;
 
-    /* Initialize the Swap Pool semaphore */
+    /* Keep at most half the pool as victims */
+    victimCount = 0;
+    victimLimit = MIN(VICTIMCACHE, swapPoolSize / 2);
+
+    /* No U-proc needs more frames than it has pages */
+    rssCeiling = MAX(MIN(MAXPAGES + STACKEXTPAGES, swapPoolSize), RSSFLOOR);
+    pffSem = 0;
+
+    /* No frame is busy yet; pins leave a frame for every faulting U-proc and the cleaner */
+    frameWaitSem = 0;
+    writeBacks = 0;
+    pinnedFrames = 0;
+    wiredFrames = 0;
+    pinLimit = MAX(swapPoolSize - (MAXUPROC + 2), 0);
+
+    /* No shared segment or disk map exists yet */
+    int segment;
+    for (segment = 0; segment < SEGMENTS; segment++) {
+        segments[segment].sh_basePage = 0;
+        segments[segment].sh_pages = 0;
+        segments[segment].sh_attached = 0;
+        segments[segment].sh_zeroFill = 0;
+        segments[segment].sh_disk = NODISKMAP;
+        segments[segment].sh_sector = 0;
+    }
+
+    /* Initialize the Swap Pool semaphore; its holder inherits its waiters' level */
     swapPoolMutex = 1;
+    SYSCALL(MAKEMUTEX, (int)&swapPoolMutex, 0, 0);
+    cleanerSem = 0;
+    cleanerWakeable = FALSE;
+    clusterAsid = UNOCCUPIED;
+    clusterVpn = 0;
+    swapPoolReady = TRUE;
+
+    /* Launch the page cleaner */
+    if (PAGECLEANER) {
+        state_t cleanerState;
+        cleanerState.s_pc = (memaddr)pageCleaner;
+        cleanerState.s_t9 = (memaddr)pageCleaner;
+        cleanerState.s_sp = CLEANER_STACK;
+        cleanerState.s_status = ALLOFF | STATUS_IEc | STATUS_TE; /* Kernel, interrupts on */
+        cleanerState.s_entryHI = 0; /* ASID 0 */
+        SYSCALL(CREATEPROCESS, (int)&cleanerState, 0, 0);
+    }
+}
+
+
+/* ========================================================================
+ * Function: registerText
+ *
+ * Description: Registers a new U-proc's support structure for the sharer
+ *              map, with none of its text shared until fingerprintText
+ *              has run. Called before the U-proc is created
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the new U-proc (ASID set)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void registerText(support_PTR supportStruct) {
+    int asid = supportStruct->sup_asid;
+    supportStruct->sup_textPages = 0;
+    textPending[asid] = SHAREDTEXT;
+    asidSupport[asid] = supportStruct;
+}
+
+/* ========================================================================
+ * Function: fingerprintText
+ *
+ * Description: With SHAREDTEXT set, reads the text-only pages of a
+ *              registered U-proc's image from flash (through the flash
+ *              DMA buffer) and records an FNV-1a fingerprint of each.
+ *              Page 0 holds the aout header, so its fingerprint also
+ *              identifies the image. The U-proc may already be running
+ *              (BOOTFASTSTART), so the fingerprints are published under
+ *              the swap pool mutex, the page count last, and only if the
+ *              ASID still belongs to that U-proc. On a read error no
+ *              pages are shared
+ *
+ * Parameters:
+ *              supportStruct - Support structure passed to registerText
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void fingerprintText(support_PTR supportStruct) {
+    int asid = supportStruct->sup_asid;
+    if (!SHAREDTEXT) {
+        return;
+    }
+
+    int flashNum = backingFlash[asid];
+    memaddr bufferAddr = FLASH_DMABUFFER_ADDR(flashNum);
+    unsigned int *word = (unsigned int *)bufferAddr;
+    unsigned int prints[MAXPAGES];
+
+    /* Gain the flash device's grant, charged to the U-proc */
+    diskRequest_t request;
+    acquireDevice(FLASHINT, flashNum, &request, backingBase[asid], asid);
+
+    int textPages = 1;
+    int pageNum;
+    for (pageNum = 0; pageNum < textPages; pageNum++) {
+        if (flashRW(READ, flashNum, backingBase[asid] + pageNum, bufferAddr) != READY) {
+            pageNum = 0; /* Share nothing */
+            break;
+        }
+        if (pageNum == 0) {
+            /* Pages past the .text file size also hold data */
+            textPages = MIN(word[AOUTTEXTFILESIZE] / PAGESIZE, USTACKNUM);
+        }
+        unsigned int print = FNVOFFSET;
+        int i;
+        for (i = 0; i < (PAGESIZE / WORDLEN); i++) {
+            print = (print ^ word[i]) * FNVPRIME;
+        }
+        prints[pageNum] = print;
+    }
+
+    /* Release the flash device's grant */
+    releaseDevice(FLASHINT, flashNum, pageNum);
+    textPages = MIN(pageNum, textPages);
+
+    /* Publish them, unless the U-proc is gone or its ASID was reused */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    if (textPending[asid] && (asidSupport[asid] == supportStruct)) {
+        for (pageNum = 0; pageNum < textPages; pageNum++) {
+            supportStruct->sup_textPrint[pageNum] = prints[pageNum];
+        }
+        supportStruct->sup_textPages = textPages;
+        textPending[asid] = FALSE;
+    }
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/* ========================================================================
+ * Function: setBackingStore
+ *
+ * Description: Sets the flash region an ASID pages from. Called when the
+ *              U-proc is created, before registerText, with a region
+ *              of at least REGIONMIN blocks checked against the device.
+ *              The region outlives the U-proc, so a write-back still in
+ *              flight after it terminates finds its block. Every
+ *              configured ASID is set before any U-proc runs, so no clone
+ *              takes one before its U-proc is created.
+ *
+ * Parameters:
+ *              asid - ASID of the new U-proc
+ *              flashNum - Flash device holding its backing store
+ *              base - First block of the region (its image)
+ *              blocks - Blocks in the region
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void setBackingStore(int asid, int flashNum, int base, int blocks) {
+    backingFlash[asid] = flashNum;
+    backingBase[asid] = base;
+    backingEnd[asid] = base + blocks;
+    imageASID[asid] = asid;
+    freeASIDs &= ~ASIDBIT(asid);
+}
+
+
+/* ========================================================================
+ * Function: stripeBackingStores
+ *
+ * Description: Puts the ASIDs with a region into stripe groups, in ASID
+ *              order: a group closes at STRIPEWIDTH members or when the
+ *              next region is on a device the group already uses. Called
+ *              once at boot, after every configured region is set and
+ *              before any U-proc runs; ASIDs given a region later (clones
+ *              on a spare one) stay unstriped.
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void stripeBackingStores() {
+    int members[STRIPEWIDTH];
+    int width = 0;
+    int asid;
+    for (asid = 1; SWAPSTRIPE && (asid <= MAXUPROC); asid++) {
+        if (backingEnd[asid] == 0) {
+            continue;
+        }
+        int clash = FALSE;
+        int i;
+        for (i = 0; i < width; i++) {
+            clash |= (backingFlash[members[i]] == backingFlash[asid]);
+        }
+        if (clash) {
+            formStripe(members, width);
+            width = 0;
+        }
+        members[width++] = asid;
+        if (width == STRIPEWIDTH) {
+            formStripe(members, width);
+            width = 0;
+        }
+    }
+    formStripe(members, width);
+}
+
+
+/* ========================================================================
+ * Function: formStripe
+ *
+ * Description: Makes a set of ASIDs one stripe group. A group of one is
+ *              left unstriped.
+ *
+ * Parameters:
+ *              members - The ASIDs, in position order
+ *              width - How many there are
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void formStripe(int *members, int width) {
+    if (width < 2) {
+        return;
+    }
+    int k;
+    for (k = 0; k < width; k++) {
+        int asid = members[k];
+        stripeWidth[asid] = width;
+        stripeIndex[asid] = k;
+        int i;
+        for (i = 0; i < width; i++) {
+            stripeMember[asid][i] = members[i];
+        }
+    }
+}
+
+
+/* ========================================================================
+ * Function: swapBlock
+ *
+ * Description: Locates the block a private page is written back to: its
+ *              slot in the shadow and stack area (slot p for image page p,
+ *              counting down from the top for stack extension pages), in
+ *              the region of the stripe member that slot rotates to
+ *
+ * Parameters:
+ *              asid - ASID owning the page
+ *              pageNum - Page number (below MAXPAGES only with IMAGESHADOW)
+ *              flashNum - Set to the flash device
+ *              blockNum - Set to the block on it
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void swapBlock(int asid, int pageNum, int *flashNum, int *blockNum) {
+    int slot = (pageNum >= MAXPAGES) ? (SHADOWPAGES + STACKEXTPAGES - 1 - (pageNum - MAXPAGES)) : pageNum;
+    int region = asid;
+    if (stripeWidth[asid] > 1) {
+        region = stripeMember[asid][(stripeIndex[asid] + slot) % stripeWidth[asid]];
+    }
+    *flashNum = backingFlash[region];
+    *blockNum = backingEnd[region] - STACKEXTPAGES - SHADOWPAGES + slot;
+}
+
+
+/* ========================================================================
+ * Function: reservedBlock
+ *
+ * Description: Checks if a flash block belongs to a U-proc's backing
+ *              store: the image pages at the start of its region, or the
+ *              shadow and stack extension blocks at its end. User flash
+ *              requests must not touch these.
+ *
+ * Parameters:
+ *              flashNum - Flash device number
+ *              block - Block number on the device
+ *
+ * Returns:
+ *              TRUE if the block is reserved, else FALSE
+ * ======================================================================== */
+int reservedBlock(int flashNum, int block) {
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if ((backingEnd[asid] != 0) && (backingFlash[asid] == flashNum) &&
+            (((block >= backingBase[asid]) && (block < backingBase[asid] + MAXPAGES)) ||
+             ((block >= backingEnd[asid] - STACKEXTPAGES - SHADOWPAGES) && (block < backingEnd[asid])))) {
+            return TRUE;
+        }
+    }
+    return FALSE;
 }
 
 
@@ -169,88 +998,93 @@ void initSwapPool() {
  *              None
  * ======================================================================== */
 void pager() {
-    support_PTR currentProcessSupport = (support_PTR)SYSCALL(GETSUPPORTPTR, 0, 0, 0);
-    state_PTR exceptionState = &currentProcessSupport->sup_exceptState[PGFAULTEXCEPT];
+    support_PTR threadSupport = (support_PTR)SYSCALL(GETSUPPORTPTR, 0, 0, 0);
+    state_PTR exceptionState = &threadSupport->sup_exceptState[PGFAULTEXCEPT];
+    support_PTR currentProcessSupport = threadSupport->sup_space; /* A thread faults in its U-proc's pages */
     memaddr vAddress = exceptionState->s_entryHI & VPNMASK;
 
     /* Why are we here? */
     int cause = (exceptionState->s_cause & CAUSE_EXCCODE_MASK) >> CAUSE_EXCCODE_SHIFT;
 
-    /* If TLB-Modification */
-    if (cause == TLBMOD) {
-        terminateUProcess(NULL); /* NUKE IT! */
-    }
-
     /* Validate the address is in user space */
     if (!validateUserAddress(vAddress)) {
         terminateUProcess(NULL); /* NUKE IT! */
     }
 
-    /* Gain swap pool mutual exclusion */
-    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    /* If TLB-Modification: the first write to a clean data page marks it dirty */
+    if (cause == TLBMOD) {
+        redirtyPage(currentProcessSupport, vAddress);
+        resumeState(exceptionState);
+    }
 
-    /* Pick the next frame number */
-    int frameNum = updateFrameNum();
+    perfCount(PERF_PAGEFAULT, currentProcessSupport->sup_asid);
+    markBootPhase(BOOTFIRSTRUN); /* Only the first fault since boot counts */
 
-    int status;
-    int processASID = currentProcessSupport->sup_asid;
-    /* If frame number is occupied */
-    if ((swapPool[frameNum].asid != UNOCCUPIED)){
-        /* Update that U-proc's page table & TLB atomically */
-        setInterrupts(OFF);
-        swapPool[frameNum].pte->pte_entryLO &= ~VALIDON;
-        updateTLB(frameNum);
-        setInterrupts(ON);
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
 
-        if (swapPool[frameNum].dirty) {
-            status = backingStoreRW(WRITE, frameNum, swapPool[frameNum].asid, swapPool[frameNum].vpn);
-            if (status != READY) {
-                terminateUProcess(&swapPoolMutex);
-                return;
-            }
-        }
+    /* Let the worst offender wait out memory pressure */
+    if (PFFCONTROL && pffFault(currentProcessSupport)) {
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+        cpu_t currTime;
+        STCK(currTime);
+        SYSCALL(WAITUNTIL, (int)(currTime + PFFSUSPEND), (int)&pffSem, 0);
+        SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
     }
+
     /* Get page number */
-    int pageNum = USTACKNUM;
-    if ((KUSEG <= vAddress) && (vAddress <= LASTUPROCPAGE)) {
-        pageNum = (vAddress - KUSEG) >> VPNSHIFT;
-    }
+    int pageNum = pageNumber(vAddress);
 
-    /* Read the page from backing store */
-    status = backingStoreRW(READ, frameNum, processASID, pageNum);
-    if (status != READY) {
-        terminateUProcess(&swapPoolMutex);
-        return;
+    int processASID = currentProcessSupport->sup_asid;
+    /* Wait until no busy frame is still writing this page back */
+    while (writeBackPending(processASID, pageNum)) {
+        waitForFrames();
     }
 
-    /* Update the swap pool entry */
-    swapPool[frameNum].asid = processASID;
-    swapPool[frameNum].vpn = pageNum;
-    swapPool[frameNum].valid = TRUE;
-    swapPool[frameNum].pte = &currentProcessSupport->sup_pageTable[pageNum];
-
-    /* Get frame address */
-    memaddr frameAddress = FRAMETOADDR(frameNum);
-
-    /* Update this U-proc's page table and TLB atomically */
-    setInterrupts(OFF);
-    if (isTextPage(pageNum, currentProcessSupport)) { /* .text is read-only */
-        swapPool[frameNum].pte->pte_entryLO = frameAddress | VALIDON;
-        swapPool[frameNum].dirty = FALSE;
+    /* Map another U-proc's copy of an identical text page or of the same
+     * segment page if one is resident */
+    int frameNum = findSharedText(currentProcessSupport, pageNum);
+    if (frameNum == NOSWAPFRAME) {
+        frameNum = findSegmentFrame(currentProcessSupport, pageNum);
+    }
+    if (frameNum != NOSWAPFRAME) {
+        shareFrame(frameNum, currentProcessSupport, pageNum, TRUE);
+    } else if ((frameNum = reclaimVictim(currentProcessSupport, pageNum)) != NOSWAPFRAME) {
+        /* Minor fault: the page is still intact in the victim cache */
+        installPage(frameNum, currentProcessSupport, pageNum, TRUE);
     } else {
-        swapPool[frameNum].pte->pte_entryLO = frameAddress | VALIDON | DIRTYON;
-        swapPool[frameNum].dirty = TRUE;
+        /* Pick and reserve a frame, unmapping its page if needed */
+        frameNum = reuseFrame(currentProcessSupport);
+        reserveFrame(frameNum);
+
+        /* Write back its old page and read ours (or zero it) without the
+         * swap pool mutex, then map the page for this U-proc. Marked as a
+         * page-in, the scheduler runs it next when the I/O ends if faulters
+         * are queued on the swap pool mutex */
+        threadSupport->sup_faultMutex = &swapPoolMutex;
+        int status = fillFrame(frameNum, currentProcessSupport, pageNum, TRUE, NOSWAPFRAME);
+        threadSupport->sup_faultMutex = NULL;
+        if (status != READY) {
+            terminateUProcess(&swapPoolMutex);
+            return;
+        }
     }
-    updateTLB(frameNum);
-    setInterrupts(ON);
+
+    /* Remember the page for the TLB preload on the next dispatch */
+    recordRecentPage(currentProcessSupport, pageNum);
 
     /* If this is the header page */
     if (pageNum == 0) {
-        memaddr *header = (memaddr *)(frameAddress);
+        memaddr *header = (memaddr *)(FRAMETOADDR(frameNum));
+        if (currentProcessSupport->sup_textSize == 0) {
+            markZeroFillPages(processASID, header); /* First load: find the BSS */
+        }
         currentProcessSupport->sup_textSize = header[3]; /* 0x000C */
-        swapPool[frameNum].dirty = FALSE;
     }
 
+    /* Fetch the following pages too if this U-proc is faulting in order */
+    readAhead(currentProcessSupport, pageNum);
+
     /* Release swap pool mutual exclusion */
     SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
 
@@ -262,7 +1096,14 @@ void pager() {
 /* ========================================================================
  * Function: uTLB_RefillHandler
  *
- * Description: Refills TLB from the page table in physical memory
+ * Description: Refills TLB from the page table in physical memory. This is
+ *              the hottest exception, so it makes no calls and does no
+ *              address validation: PAGEINDEX maps the missing VPN straight
+ *              to its page table slot. Only if that slot holds a different
+ *              VPN does it look further, in the stack extension table;
+ *              for any other address an invalid entry is written, so the
+ *              retried access raises a TLB-Invalid exception and the pager
+ *              rejects the address
  *
  * Parameters:
  *              None
@@ -271,38 +1112,56 @@ void pager() {
  *              None
  * ======================================================================== */
 void uTLB_RefillHandler() {
-    state_PTR exceptionState = (state_PTR)BIOSDATAPAGE;
-    memaddr vAddress = exceptionState->s_entryHI & VPNMASK;
+    state_PTR exceptionState = EXCSTATE(CPUID());
+    unsigned int entryHI = exceptionState->s_entryHI;
+    support_PTR supportStruct = currentProcess->p_supportStruct->sup_space;
+    pageTableEntry_PTR pte = &supportStruct->sup_pageTable[PAGEINDEX(entryHI)];
+    tlbRefills++;
+    if (PERFSTATS) {
+        /* Counted in place: this handler makes no calls */
+        perfBlocks[0].pb_count[PERF_TLBREFILL]++;
+        perfBlocks[supportStruct->sup_asid].pb_count[PERF_TLBREFILL]++;
+    }
 
-    /* Validate the address is in user space */
-    if (!validateUserAddress(vAddress)) {
-        terminateUProcess(NULL); /* NUKE IT! */
+    /* Remember the page for the TLB preload on the next dispatch */
+    supportStruct->sup_recentPages[supportStruct->sup_recentNext] = PAGEINDEX(entryHI);
+    supportStruct->sup_recentNext = (supportStruct->sup_recentNext + 1) % RECENTPAGES;
+
+    /* Update the page table entry into the TLB */
+    unsigned int entryLO = pte->pte_entryLO;
+    int swapFrame = TRUE;
+    if (pte->pte_entryHI != entryHI) {
+        entryLO = 0; /* Not one of this U-proc's pages */
+        /* Unless it is in the stack extension (second-level table) */
+        unsigned int vpn = entryHI & VPNMASK;
+        if ((supportStruct->sup_stackTable != NULL) && (vpn >= USTACKLIMIT) && (vpn < UPAGESTACK)) {
+            entryLO = supportStruct->sup_stackTable[STACKEXTINDEX(vpn)].pte_entryLO;
+        }
+        /* Or the nucleus time page, valid but never writable */
+        if (TIMEPAGE && (vpn == UTIMEPAGE) && (timePage != NOFRAME)) {
+            entryLO = timePage | VALIDON;
+            swapFrame = FALSE;
+        }
     }
+    setENTRYHI(entryHI);
+    setENTRYLO(entryLO);
 
-    /* Get page number */
-    int pageNum = USTACKNUM;
-    if ((KUSEG <= vAddress) && (vAddress <= LASTUPROCPAGE)) {
-        pageNum = (vAddress - KUSEG) >> VPNSHIFT;
+    /* Record the reference for the CLOCK replacement policy */
+    if ((REPLACEMENT == CLOCKPOLICY) && swapFrame && (entryLO & VALIDON)) {
+        atomicSetFrame(referencedMap, ADDRTOFRAME(entryLO & PFNMASK));
     }
-    
-    /* Update the page table entry into the TLB */
-    setENTRYHI(currentProcess->p_supportStruct->sup_pageTable[pageNum].pte_entryHI);
-    setENTRYLO(currentProcess->p_supportStruct->sup_pageTable[pageNum].pte_entryLO);
 
-    /* Write the TLB in a random location */
+    /* Write the TLB in a random location and restore the processor state */
     TLBWR();
-
-    /* Restore the processor state */
-    resumeState(exceptionState);
+    LDST(exceptionState);
 }
 
 
 /* ========================================================================
  * Function: terminateUProcess
  *
- * Description: Terminates the current user process with proper cleanup.
- *              Releases any held mutexes, frees the support structure,
- *               clears swap pool and updates the master semaphore.
+ * Description: Terminates the current user process for a trap or bad
+ *              SYSCALL arguments (see exitUProcess).
  *
  * Parameters:
  *              mutex - Semaphore that needs to be released (or NULL)
@@ -311,306 +1170,4112 @@ void uTLB_RefillHandler() {
  *              None
  * ======================================================================== */
 extern void terminateUProcess(int *mutex) {
+    exitUProcess(mutex, EXITTRAP);
+}
+
+
+/* ========================================================================
+ * Function: exitUProcess
+ *
+ * Description: Terminates the current user process with proper cleanup.
+ *              Releases any held mutex first (the cleanup takes the swap
+ *              pool mutex itself). A thread just ends (exitThread); a
+ *              U-proc's main thread waits for its other threads, then
+ *              closes its mailbox, frees the support structure, clears
+ *              swap pool, queues its exit record and updates the master
+ *              semaphore.
+ *
+ * Parameters:
+ *              mutex - Semaphore that needs to be released (or NULL)
+ *              reason - EXITSYS9 or EXITTRAP, for the exit record
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void exitUProcess(int *mutex, int reason) {
     /* Get the current support structure */
     support_PTR supportStruct = getCurrentSupportStruct();
+    int asid = UNOCCUPIED;
+
+    /* Release mutex if held */
+    if (mutex != NULL) {
+        SYSCALL(VERHOGEN, (int) mutex, 0, 0);
+    }
+
+    /* A thread ends alone, with ERROR as its exit value after a trap */
+    if ((supportStruct != NULL) && (supportStruct->sup_thread != NOTHREAD)) {
+        exitThread(supportStruct, (reason == EXITTRAP) ? ERROR : 0);
+    }
     
     /* Clear the current process's pages in swap pool */
     if (supportStruct != NULL) {
-        clearSwapPoolEntries(supportStruct->sup_asid);
+        asid = supportStruct->sup_asid;
+        /* Its threads run in the address space cleared below: let them finish */
+        waitForThreads(asid);
+        /* Drop undelivered messages (and their frames) first */
+        closeMailbox(supportStruct->sup_asid);
+        flushSegments(supportStruct->sup_asid);
+        clearSwapPoolEntries(supportStruct->sup_asid, FALSE);
+        detachSegments(supportStruct->sup_asid);
         
         /* Free the support structure */
         deallocateSupportStruct(supportStruct);
-    }
-
-    /* Release mutex if held */
-    if (mutex != NULL) {
-        SYSCALL(VERHOGEN, (int) mutex, 0, 0);
+        recordExit(asid, reason);
+        /* A U-proc that ran to its end is not resumed at the next boot */
+        if (CHECKPOINTS) {
+            dropCheckpoint(asid);
+        }
     }
 
     /* Update master semaphore to indicate process termination */
     SYSCALL(VERHOGEN, (int)&masterSema4, 0, 0);
 
+    /* Last: a clone taking the ASID runs on its exception stacks */
+    if (asid != UNOCCUPIED) {
+        releaseASID(asid);
+    }
+
     /* Terminate the process */
     SYSCALL(TERMINATEPROCESS, 0, 0, 0);
 }
 
 
-/* =======================================================================
- * Function: setInterrupts
+/* ========================================================================
+ * Function: resetAddressSpace
  *
- * Description: Enables or disables interrupts
+ * Description: Puts a respawning U-proc's address space back to its image.
+ *              Its segments are flushed and detached and its frames freed,
+ *              except clean text frames, which stay resident for the new
+ *              run. Once no write-back of its pages is in flight, every
+ *              other page is invalidated and starts over from the image:
+ *              the shadow mask is cleared and the BSS and stack pages are
+ *              zero-fill again. The U-proc must not call it with
+ *              asynchronous I/O outstanding.
  *
  * Parameters:
- *              toggle - ON to enable interrupts, OFF to disable interrupts
+ *              supportStruct - Support structure of the respawning U-proc
  *
  * Returns:
  *              None
  * ======================================================================== */
-void setInterrupts(int toggle) {
-    /* Get current status register value */
-    unsigned int status = getSTATUS();
+void resetAddressSpace(support_PTR supportStruct) {
+    int asid = supportStruct->sup_asid;
+    flushSegments(asid);
+    clearSwapPoolEntries(asid, TRUE);
+    detachSegments(asid);
 
-    if (toggle == ON) {
-        /* Enable interrupts */
-        status |= STATUS_IEc;
-    } else {
-        /* Disable interrupts */
-        status &= (~STATUS_IEc);
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    setInterrupts(OFF);
+    int pageNum;
+    for (pageNum = 0; pageNum < MAXPAGES; pageNum++) {
+        if (!isTextPage(pageNum, supportStruct)) {
+            supportStruct->sup_pageTable[pageNum].pte_entryLO = ALLOFF | DIRTYON;
+        }
     }
-    /* Set the status register */
-    setSTATUS(status);
-}
+    supportStruct->sup_stackTable = NULL;
+    shadowPages[asid] = 0;
+    zeroFillPages[asid] = PAGEBIT(USTACKNUM);
+    zeroFillStack[asid] = ALLSTACKEXT;
 
+    /* Find the BSS again now if the header page stayed mapped, else on its next load */
+    pageTableEntry_PTR header = &supportStruct->sup_pageTable[0];
+    if (header->pte_entryLO & VALIDON) {
+        markZeroFillPages(asid, (memaddr *)(header->pte_entryLO & PFNMASK));
+    } else {
+        supportStruct->sup_textSize = 0;
+    }
 
-/* ========================================================================
- * Function: resumeState
- * 
- * Description: Resumes execution with a given processor state
- * 
- * Parameters:
- *              state - Processor state to load
- * 
- * Returns:
- *              None (transfers control to loaded state)
- * ======================================================================== */
-void resumeState(state_t *state) {
-    /* Load the processor state */
-    LDST(state);
+    /* Release swap pool mutual exclusion */
+    setInterrupts(ON);
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
 }
 
 
 /* ========================================================================
- * Function: validateUserAddress
+ * Function: cloneAddressSpace
  *
- * Description: Validates if a given memory address is within user space
+ * Description: Gives a new support structure a copy-on-write clone of a
+ *              U-proc's address space under a free ASID. The clone runs
+ *              the parent's image (same text size and fingerprints, the
+ *              image read from the region the parent's came from) with
+ *              the parent's zero-fill pages and segments. Every page the
+ *              parent has resident is mapped in the clone (clonePage): a
+ *              text or segment frame shared as usual, a private frame
+ *              read-only in both. The parent's TLB entries are shot down,
+ *              since its private pages lost their write permission. Needs
+ *              IMAGESHADOW, which keeps the image intact.
  *
  * Parameters:
- *              vAddress - Pointer to memory address to validate
+ *              parent - Support structure of the calling U-proc
+ *              child - Support structure just allocated for the clone
  *
  * Returns:
- *              TRUE if address is valid,
- *              FALSE if address is invalid
+ *              The clone's ASID, or ERROR if no ASID is free or a page
+ *              could not be read (the support structure is freed then)
  * ======================================================================== */
-int validateUserAddress(memaddr vAddress) {
-    return (((KUSEG <= vAddress) && (vAddress <= LASTUPROCPAGE)) || (vAddress == UPAGESTACK));
-}
+int cloneAddressSpace(support_PTR parent, support_PTR child) {
+    int parentASID = parent->sup_asid;
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    int asid = freeASID();
+    if (asid == UNOCCUPIED) {
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+        deallocateSupportStruct(child);
+        return ERROR;
+    }
+    freeASIDs &= ~ASIDBIT(asid);
+
+    /* Start with nothing resident, the parent's image and its page table layout */
+    child->sup_asid = asid;
+    int pageNum;
+    for (pageNum = 0; pageNum < MAXPAGES; pageNum++) {
+        child->sup_pageTable[pageNum].pte_entryHI = (parent->sup_pageTable[pageNum].pte_entryHI & ~ASIDMASK) |
+                                                    (asid << ASIDSHIFT);
+        child->sup_pageTable[pageNum].pte_entryLO = ALLOFF | DIRTYON;
+    }
+    child->sup_textSize = parent->sup_textSize;
+    child->sup_textPages = parent->sup_textPages;
+    for (pageNum = 0; pageNum < parent->sup_textPages; pageNum++) {
+        child->sup_textPrint[pageNum] = parent->sup_textPrint[pageNum];
+    }
+    asidSupport[asid] = child;
+    textPending[asid] = FALSE; /* Shares the parent's fingerprints, if it has them yet */
+    imageASID[asid] = imageASID[parentASID];
+    zeroFillPages[asid] = zeroFillPages[parentASID];
+    zeroFillStack[asid] = zeroFillStack[parentASID];
+    shadowPages[asid] = 0;
+    nextFaultPage[asid] = 0;
+    readAheadWindow[asid] = 0;
+    int segment;
+    for (segment = 0; segment < SEGMENTS; segment++) {
+        if (segments[segment].sh_attached & ASIDBIT(parentASID)) {
+            segments[segment].sh_attached |= ASIDBIT(asid);
+        }
+    }
+
+    /* Map the parent's pages, stack extension included if it has grown */
+    int status = READY;
+    for (pageNum = 0; (pageNum < MAXPAGES + STACKEXTPAGES) && (status == READY); pageNum++) {
+        if ((pageNum >= MAXPAGES) && (parent->sup_stackTable == NULL)) {
+            break;
+        }
+        status = clonePage(parent, child, pageNum);
+    }
+    shootdownTLB(ASIDBIT(parentASID));
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    if (status != READY) {
+        discardClone(child);
+        return ERROR;
+    }
+    return asid;
+}
+
+
+/* ========================================================================
+ * Function: discardClone
+ *
+ * Description: Undoes cloneAddressSpace for a clone that never ran (its
+ *              process could not be created): it leaves the frames it
+ *              shares and its segments, and its ASID and support
+ *              structure are freed
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the clone
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void discardClone(support_PTR supportStruct) {
+    int asid = supportStruct->sup_asid;
+    clearSwapPoolEntries(asid, FALSE);
+    detachSegments(asid);
+    releaseASID(asid);
+    deallocateSupportStruct(supportStruct);
+}
+
+
+/* =======================================================================
+ * Function: setInterrupts
+ *
+ * Description: Enables or disables interrupts
+ *
+ * Parameters:
+ *              toggle - ON to enable interrupts, OFF to disable interrupts
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void setInterrupts(int toggle) {
+    /* Get current status register value */
+    unsigned int status = getSTATUS();
+
+    if (toggle == ON) {
+        /* Enable interrupts */
+        status |= STATUS_IEc;
+    } else {
+        /* Disable interrupts */
+        status &= (~STATUS_IEc);
+    }
+    /* Set the status register */
+    setSTATUS(status);
+}
+
+
+/* ========================================================================
+ * Function: resumeState
+ * 
+ * Description: Resumes execution with a given processor state
+ * 
+ * Parameters:
+ *              state - Processor state to load
+ * 
+ * Returns:
+ *              None (transfers control to loaded state)
+ * ======================================================================== */
+void resumeState(state_t *state) {
+    /* Load the processor state */
+    LDST(state);
+}
+
+
+/* ========================================================================
+ * Function: validateUserAddress
+ *
+ * Description: Validates if a given memory address is within user space:
+ *              in a KUSEG page, the stack page or a stack extension page
+ *
+ * Parameters:
+ *              vAddress - Pointer to memory address to validate
+ *
+ * Returns:
+ *              TRUE if address is valid,
+ *              FALSE if address is invalid
+ * ======================================================================== */
+int validateUserAddress(memaddr vAddress) {
+    /* Any byte of a valid page is valid */
+    vAddress &= VPNMASK;
+    return (((KUSEG <= vAddress) && (vAddress <= LASTUPROCPAGE)) || (vAddress == UPAGESTACK) ||
+            ((USTACKLIMIT <= vAddress) && (vAddress < UPAGESTACK)));
+}
+
+/******************************************************************************
+ *
+ * Function: pinUserPage
+ *
+ * Description: Lets a DMA transfer use a user page's frame directly. The
+ *              page must be page-aligned and resident in a frame that is
+ *              not busy; a device write into it (deviceWrites) also needs
+ *              a private, non-text page, which is then marked dirty and
+ *              writable. The frame is made busy, so replacement, the
+ *              cleaner and the owner's termination leave it alone until
+ *              unpinUserPage. At most pinLimit frames are pinned at once,
+ *              so every faulting U-proc and the cleaner can still get one
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *              vAddress - User address of the page (already validated)
+ *              deviceWrites - TRUE if the device will write the frame
+ *
+ * Returns:
+ *              The pinned frame number, or NOSWAPFRAME to use a bounce buffer
+ *
+ *****************************************************************************/
+int pinUserPage(support_PTR supportStruct, memaddr vAddress, int deviceWrites) {
+    supportStruct = supportStruct->sup_space;
+    if (vAddress & (PAGESIZE - 1)) {
+        return NOSWAPFRAME;
+    }
+    int pageNum = pageNumber(vAddress);
+    if (deviceWrites && isTextPage(pageNum, supportStruct)) {
+        return NOSWAPFRAME;
+    }
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    int frameNum = NOSWAPFRAME;
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+    if (pte->pte_entryLO & VALIDON) {
+        int candidate = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+        if (TESTFRAME(validMap, candidate) && !TESTFRAME(busyMap, candidate) && ((pinnedFrames + wiredFrames) < pinLimit) &&
+            !(deviceWrites && (frameRefCount[candidate] > 1))) {
+            frameNum = candidate;
+            pinnedFrames++;
+            SETFRAME(busyMap, frameNum);
+            frameWbAsid[frameNum] = UNOCCUPIED;
+            if (deviceWrites) {
+                setInterrupts(OFF);
+                pte->pte_entryLO |= DIRTYON;
+                SETFRAME(dirtyMap, frameNum);
+                SETFRAME(referencedMap, frameNum);
+                updateTLB(frameNum);
+                setInterrupts(ON);
+            }
+        }
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return frameNum;
+}
+
+/******************************************************************************
+ *
+ * Function: unpinUserPage
+ *
+ * Description: Ends a zero-copy transfer: the frame is no longer busy and
+ *              anyone waiting for a busy frame is woken
+ *
+ * Parameters:
+ *              frameNum - Frame returned by pinUserPage
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void unpinUserPage(int frameNum) {
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    CLEARFRAME(busyMap, frameNum);
+    pinnedFrames--;
+    wakeFrameWaiters();
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+/******************************************************************************
+ *
+ * Function: readResidentWord
+ *
+ * Description: Reads a word of a U-proc's memory through its page table
+ *              and frame (kseg0), without touching the TLB, if the page is
+ *              resident. Must be called with interrupts off: no support
+ *              level code can run, so the frame stays in place (as if
+ *              pinned) until they are turned on again
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              vAddress - Word-aligned user address (already validated)
+ *              word - Where to put the word
+ *
+ * Returns:
+ *              TRUE if the page was resident and the word read, else FALSE
+ *
+ *****************************************************************************/
+int readResidentWord(support_PTR supportStruct, memaddr vAddress, int *word) {
+    pageTableEntry_PTR pte = pageEntry(supportStruct->sup_space, pageNumber(vAddress));
+    if (!(pte->pte_entryLO & VALIDON)) {
+        return FALSE;
+    }
+    *word = *((int *)((pte->pte_entryLO & PFNMASK) + (vAddress & ~VPNMASK)));
+    return TRUE;
+}
+
+/******************************************************************************
+ *
+ * Function: sharedSegment
+ *
+ * Description: Finds the shared segment a U-proc's address belongs to
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              vAddress - User address
+ *
+ * Returns:
+ *              The segment number, or NOSEGMENT for a private page
+ *
+ *****************************************************************************/
+int sharedSegment(int asid, memaddr vAddress) {
+    return segmentOf(asid, pageNumber(vAddress));
+}
+
+/******************************************************************************
+ *
+ * Function: detachUserPage
+ *
+ * Description: Takes the frame of a U-proc's page for a page message. The
+ *              page must be resident, private, not text or shared
+ *              segment, and in a frame
+ *              that is not busy. It is unmapped from the U-proc without a
+ *              write-back, and the frame, owned by no one, stays busy so
+ *              replacement and the cleaner leave it alone until
+ *              attachUserPage or releaseMessageFrame
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the sending U-proc
+ *              vAddress - Page-aligned user address of the page (validated)
+ *
+ * Returns:
+ *              The detached frame number, or NOSWAPFRAME if the page
+ *              cannot be detached now
+ *
+ *****************************************************************************/
+int detachUserPage(support_PTR supportStruct, memaddr vAddress) {
+    supportStruct = supportStruct->sup_space;
+    int pageNum = pageNumber(vAddress);
+    if (isTextPage(pageNum, supportStruct) || (segmentOf(supportStruct->sup_asid, pageNum) != NOSEGMENT)) {
+        return NOSWAPFRAME;
+    }
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    int frameNum = NOSWAPFRAME;
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+    if (pte->pte_entryLO & VALIDON) {
+        int candidate = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+        if (TESTFRAME(validMap, candidate) && !TESTFRAME(busyMap, candidate) && (frameWiredBy[candidate] == 0) &&
+            (frameRefCount[candidate] == 1) && ((pinnedFrames + wiredFrames) < pinLimit)) {
+            frameNum = candidate;
+            unmapFrame(frameNum);
+            unlinkOwnedFrame(frameNum);
+            setFrameOwner(frameNum, UNOCCUPIED, 0);
+            CLEARFRAME(dirtyMap, frameNum);
+            CLEARFRAME(referencedMap, frameNum);
+            framePte[frameNum] = NULL;
+            frameSharers[frameNum] = 0;
+            frameRefCount[frameNum] = 0;
+            SETFRAME(busyMap, frameNum);
+            frameWbAsid[frameNum] = UNOCCUPIED;
+            pinnedFrames++;
+        }
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return frameNum;
+}
+
+/******************************************************************************
+ *
+ * Function: attachUserPage
+ *
+ * Description: Maps a frame from detachUserPage as a U-proc's page, dirty
+ *              and writable, since its backing store copy is stale. The
+ *              frame the U-proc had for the page (resident or in the victim
+ *              cache) goes back on the free-frame stack. Fails if the page
+ *              is text or a segment page, is shared or busy, or has a
+ *              write-back in flight
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the receiving U-proc
+ *              vAddress - Page-aligned user address of the page (validated)
+ *              frameNum - Frame returned by detachUserPage
+ *
+ * Returns:
+ *              TRUE if the frame is mapped, FALSE if the caller must copy
+ *              it and call releaseMessageFrame
+ *
+ *****************************************************************************/
+int attachUserPage(support_PTR supportStruct, memaddr vAddress, int frameNum) {
+    supportStruct = supportStruct->sup_space;
+    int pageNum = pageNumber(vAddress);
+    if (isTextPage(pageNum, supportStruct) || (segmentOf(supportStruct->sup_asid, pageNum) != NOSEGMENT)) {
+        return FALSE;
+    }
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    if (writeBackPending(supportStruct->sup_asid, pageNum)) {
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+        return FALSE;
+    }
+
+    /* Free the frame holding the page's old contents, if any */
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+    int oldFrame = NOSWAPFRAME;
+    if (pte->pte_entryLO & VALIDON) {
+        oldFrame = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+        if (TESTFRAME(busyMap, oldFrame) || (frameRefCount[oldFrame] > 1) || frameWiredBy[oldFrame]) {
+            SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+            return FALSE;
+        }
+        unmapFrame(oldFrame);
+    } else {
+        oldFrame = reclaimVictim(supportStruct, pageNum);
+    }
+    if (oldFrame != NOSWAPFRAME) {
+        freeFrame(oldFrame);
+    }
+
+    /* Map the message frame in its place, dirty */
+    CLEARFRAME(busyMap, frameNum);
+    pinnedFrames--;
+    installPage(frameNum, supportStruct, pageNum, TRUE);
+    setInterrupts(OFF);
+    pte->pte_entryLO |= DIRTYON;
+    SETFRAME(dirtyMap, frameNum);
+    updateTLB(frameNum);
+    setInterrupts(ON);
+    wakeFrameWaiters();
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return TRUE;
+}
+
+/******************************************************************************
+ *
+ * Function: releaseMessageFrame
+ *
+ * Description: Returns a frame from detachUserPage that was copied out or
+ *              whose message was dropped to the free-frame stack
+ *
+ * Parameters:
+ *              frameNum - Frame returned by detachUserPage
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void releaseMessageFrame(int frameNum) {
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    CLEARFRAME(busyMap, frameNum);
+    CLEARFRAME(validMap, frameNum);
+    framePrev[frameNum] = NOSWAPFRAME;
+    frameNext[frameNum] = freeFrames;
+    freeFrames = frameNum;
+    pinnedFrames--;
+    wakeFrameWaiters();
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+/******************************************************************************
+ *
+ * Function: takeTransitFrame
+ *
+ * Description: Takes a frame off the free-frame stack to carry data that
+ *              belongs to no page yet, such as a posted receive buffer.
+ *              Like a detached page it is owned by no one and busy until
+ *              attachUserPage or releaseMessageFrame, and it counts
+ *              against pinLimit. Never evicts a page to make room
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              The frame number, or NOSWAPFRAME if no frame is free or the
+ *              pin limit is reached
+ *
+ *****************************************************************************/
+int takeTransitFrame() {
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    int frameNum = freeFrames;
+    if ((frameNum != NOSWAPFRAME) && ((pinnedFrames + wiredFrames) < pinLimit)) {
+        freeFrames = frameNext[frameNum];
+        setFrameOwner(frameNum, UNOCCUPIED, 0);
+        SETFRAME(validMap, frameNum);
+        CLEARFRAME(dirtyMap, frameNum);
+        CLEARFRAME(referencedMap, frameNum);
+        framePte[frameNum] = NULL;
+        frameSharers[frameNum] = 0;
+        frameRefCount[frameNum] = 0;
+        SETFRAME(busyMap, frameNum);
+        frameWbAsid[frameNum] = UNOCCUPIED;
+        CLEARFRAME(zeroedMap, frameNum);
+        pinnedFrames++;
+    } else {
+        frameNum = NOSWAPFRAME;
+    }
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return frameNum;
+}
+
+/******************************************************************************
+ *
+ * Function: snapshotPages
+ *
+ * Description: Lists the pages a checkpoint of a U-proc must save: first
+ *              the private, non-text pages it has resident (its working
+ *              set), then those whose latest copy is one of its own
+ *              written-back (shadow, stack or compressed) copies or is
+ *              still being written back. Pages still in the image or
+ *              still zero-fill are left out; a restored U-proc reads them
+ *              from there again. A page in the victim cache is put back
+ *              in the page table first, as for a fork. Fails for a U-proc
+ *              attached to a shared segment or disk map, or running an
+ *              image that is not its own (a clone), since a restore could
+ *              bring back neither
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              pages - Where to list the page numbers (CKPTPAGES entries)
+ *              hot - Where to put how many of them are resident
+ *
+ * Returns:
+ *              The number of pages listed, or ERROR
+ *
+ *****************************************************************************/
+int snapshotPages(support_PTR supportStruct, unsigned char *pages, int *hot) {
+    supportStruct = supportStruct->sup_space;
+    int asid = supportStruct->sup_asid;
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    int count = (imageASID[asid] == asid) ? 0 : ERROR;
+    int segment;
+    for (segment = 0; segment < SEGMENTS; segment++) {
+        if (segments[segment].sh_attached & ASIDBIT(asid)) {
+            count = ERROR;
+        }
+    }
+
+    int pass, pageNum;
+    for (pass = 0; (count != ERROR) && (pass < 2); pass++) {
+        for (pageNum = 0; pageNum < MAXPAGES + STACKEXTPAGES; pageNum++) {
+            if ((pageNum < MAXPAGES) ? isTextPage(pageNum, supportStruct) : (supportStruct->sup_stackTable == NULL)) {
+                continue;
+            }
+            int resident = (pageEntry(supportStruct, pageNum)->pte_entryLO & VALIDON) != 0;
+            int listed = resident;
+            if (pass == 1) {
+                /* Not resident: in the victim cache, or only in its own backing store */
+                int frameNum = resident ? NOSWAPFRAME : reclaimVictim(supportStruct, pageNum);
+                if (frameNum != NOSWAPFRAME) {
+                    installPage(frameNum, supportStruct, pageNum, FALSE);
+                }
+                listed = !resident &&
+                         ((frameNum != NOSWAPFRAME) || writeBackPending(asid, pageNum) ||
+                          (COMPRESSSWAP && (zswapHead[asid][pageNum] != NOCHUNK)) ||
+                          ((pageNum < MAXPAGES) ? (shadowPages[asid] & PAGEBIT(pageNum))
+                                                : !(zeroFillStack[asid] & PAGEBIT(pageNum - MAXPAGES))));
+            }
+            if (listed) {
+                pages[count++] = pageNum;
+            }
+        }
+        if (pass == 0) {
+            *hot = count;
+        }
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return count;
+}
+
+/******************************************************************************
+ *
+ * Function: shmAttachSyscallHandler
+ *
+ * Description: Handles SYS38 (SHMATTACH). Attaches the caller to shared
+ *              segment a1 at the page-aligned KUSEG address a2, a3 pages
+ *              long. The first attacher creates the segment (zero-fill)
+ *              and fixes its range; later attachers must give the same
+ *              range. Whatever the caller had in those pages is dropped
+ *              without a write-back. Synchronize on the segment with the
+ *              named semaphores (SYS29/SYS30)
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *
+ * Returns:
+ *              SUCCESS if attached (or already attached at that range),
+ *              ERROR if the range differs from the segment's, overlaps
+ *              another segment of the caller or holds text pages
+ *
+ *****************************************************************************/
+int shmAttachSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    int segment = exceptState->s_a1;
+    memaddr vAddress = exceptState->s_a2;
+    int pages = exceptState->s_a3;
+    int asid = supportStruct->sup_asid;
+    supportStruct = supportStruct->sup_space; /* Attach for all of its U-proc's threads */
+
+    /* Validate parameters */
+    if ((segment < 0) || (segment >= SHMSEGMENTS) || (pages < 1) || (pages > SHMMAXPAGES) ||
+        (vAddress & (PAGESIZE - 1)) || (vAddress < KUSEG) ||
+        (vAddress > LASTUPROCPAGE - ((pages - 1) * PAGESIZE))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    int basePage = (vAddress - KUSEG) >> VPNSHIFT;
+    int pageNum;
+    for (pageNum = basePage; pageNum < basePage + pages; pageNum++) {
+        if (isTextPage(pageNum, supportStruct)) {
+            return ERROR;
+        }
+    }
+
+    return attachSegment(supportStruct, asid, segment, basePage, pages, NODISKMAP, 0);
+}
+
+/******************************************************************************
+ *
+ * Function: diskMapSyscallHandler
+ *
+ * Description: Handles SYS52 (DISKMAP). Maps a2 sectors of a disk, from
+ *              the first sector a3 gives (DISKMAPADDR(disk, sector)), at
+ *              the page-aligned KUSEG address a1, so faults read the pages
+ *              straight from the sectors and dirty pages are written back
+ *              to them. Whatever the caller had in those pages is dropped
+ *              without a write-back. Mapping the same sectors at the same
+ *              address as another U-proc shares its frames
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *
+ * Returns:
+ *              SUCCESS if mapped (or already mapped there), ERROR if the
+ *              range holds text pages or overlaps another segment of the
+ *              caller, the sectors overlap a different map, every map
+ *              slot is taken or a cached copy could not be written back
+ *
+ *****************************************************************************/
+int diskMapSyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    memaddr vAddress = exceptState->s_a1;
+    int pages = exceptState->s_a2;
+    int disk = ((unsigned int)exceptState->s_a3) >> DISKMAPSHIFT;
+    int sector = exceptState->s_a3 & ((1 << DISKMAPSHIFT) - 1);
+    int asid = supportStruct->sup_asid;
+    supportStruct = supportStruct->sup_space; /* Map for all of its U-proc's threads */
+
+    /* Validate parameters */
+    if ((pages < 1) || (pages > DISKMAPMAXPAGES) ||
+        (vAddress & (PAGESIZE - 1)) || (vAddress < KUSEG) ||
+        (vAddress > LASTUPROCPAGE - ((pages - 1) * PAGESIZE)) ||
+        !validUserBlock(DISKINT, disk, sector) || (sector + pages > diskSectors(disk))) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    int basePage = (vAddress - KUSEG) >> VPNSHIFT;
+    int pageNum;
+    for (pageNum = basePage; pageNum < basePage + pages; pageNum++) {
+        if (isTextPage(pageNum, supportStruct)) {
+            return ERROR;
+        }
+    }
+
+    /* From now on the frames hold the sectors, not the block cache */
+    if (BLOCKCACHE) {
+        int status = READY;
+        lockBlockCache();
+        int i;
+        for (i = 0; (i < pages) && (status == READY); i++) {
+            status = dropCachedBlock(DISKINT, disk, sector + i);
+        }
+        unlockBlockCache();
+        if (status != READY) {
+            return ERROR;
+        }
+    }
+
+    return attachSegment(supportStruct, asid, NOSEGMENT, basePage, pages, disk, sector);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/******************************************************************************
+ *
+ * Function: deallocateSupportStruct
+ *
+ * Description: Adds a support structure structure to the free list
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the support structure to be freed
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void deallocateSupportStruct(support_PTR supportStruct) {
+    if (supportStruct == NULL)
+        return; /* No free support structures */
+    
+    /* Add to free list (insert at front) */
+    SYSCALL(PASSEREN, (int)&supportMutex, 0, 0);
+    supportStruct->sup_next = supportFreeList;
+    supportFreeList = supportStruct;
+    SYSCALL(VERHOGEN, (int)&supportMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: resetSupportStruct
+ *
+ * Description: Resets a support structure to its initial values
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the support structure to reset
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void resetSupportStruct(support_PTR supportStruct) {
+    /* Return if no support structure */
+    if (supportStruct == NULL)
+        return;
+    
+    supportStruct->sup_asid = UNOCCUPIED; /* Reset ASID */
+    supportStruct->sup_textSize = 0; /* Reset text size */
+    supportStruct->sup_stackTable = NULL; /* No stack growth yet */
+    supportStruct->sup_faultCount = 0; /* Reset fault-frequency state */
+    supportStruct->sup_lastFault = 0;
+    supportStruct->sup_faultGap = 0;
+    supportStruct->sup_rssLimit = RSSFLOOR;
+    supportStruct->sup_space = supportStruct; /* Its own address space until it is a thread */
+    supportStruct->sup_faultMutex = NULL; /* No page-in under way */
+    supportStruct->sup_thread = NOTHREAD;
+    
+    /* Reset exception states */
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_pc = 0;
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_status = 0;
+    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_stackPtr = 0;
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_pc = 0;
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_status = 0;
+    supportStruct->sup_exceptContext[GENERALEXCEPT].c_stackPtr = 0;
+
+    /* Reset page table entries */
+    setWords((unsigned int *)supportStruct->sup_pageTable, 0,
+             MAXPAGES * (sizeof(pageTableEntry_t) / WORDLEN));
+
+    /* Reset TLB preload history */
+    int i;
+    supportStruct->sup_recentNext = 0;
+    for (i = 0; i < RECENTPAGES; i++) {
+        supportStruct->sup_recentPages[i] = USTACKNUM;
+    }
+    supportStruct->sup_next = NULL; /* Reset next pointer in free list */
+}
+
+
+/* ========================================================================
+ * Function: updateFrameNum
+ *
+ * Description: Updates the frame number for page replacement
+ *              Optimization: Pop the free-frame stack if there are any
+ *              unoccupied frames before getting the next frame number using
+ *              FIFO or CLOCK, never stopping at a busy frame (there are
+ *              more frames than U-procs plus the cleaner). Under CLOCK
+ *              each referenced frame the hand passes gets a second chance:
+ *              its bit is cleared and its TLB entry dropped
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              The next frame number to be used
+ * ======================================================================== */
+int updateFrameNum() {
+    /* Take an empty frame if there is one */
+    if (freeFrames != NOSWAPFRAME) {
+        int frameNum = freeFrames;
+        freeFrames = frameNext[frameNum];
+        return frameNum;
+    }
+    /* Update the FIFO index / advance the clock hand, passing busy frames */
+    nextFrameNum = (nextFrameNum + 1) % swapPoolSize;
+    while (TESTFRAME(busyMap, nextFrameNum) || frameWiredBy[nextFrameNum] ||
+           ((REPLACEMENT == CLOCKPOLICY) && TESTFRAME(referencedMap, nextFrameNum))) {
+        if (!TESTFRAME(busyMap, nextFrameNum) && !frameWiredBy[nextFrameNum]) {
+            /* Second chance: forget the reference until the page is touched again */
+            setInterrupts(OFF);
+            CLEARFRAME(referencedMap, nextFrameNum);
+            dropTLBEntry(nextFrameNum);
+            setInterrupts(ON);
+        }
+        nextFrameNum = (nextFrameNum + 1) % swapPoolSize;
+    }
+    return nextFrameNum;
+}
+
+
+/* ========================================================================
+ * Function: backingStoreRW
+ *
+ * Description: Performs read or write operations on flash device backing
+ *              store, or on the sectors of a disk-mapped page
+ *
+ * Parameters:
+ *              operation - The operation to perform (READ or WRITE)
+ *              frameNum - The frame number to operate on
+ *              processASID - The asid of which backing store to operate on
+ *              pageNum - The page number to operate on
+ *
+ * Returns:
+ *              SUCCESS if operation completed successfully
+ *              ERROR if there was a problem
+ * ======================================================================== */
+int backingStoreRW(int operation, int frameNum, int processASID, int pageNum) {
+    /* Get frame address */
+    int frameAddress = FRAMETOADDR(frameNum);
+    int segment = segmentOf(processASID, pageNum);
+
+    /* A private page goes to (and comes from) the compressed arena when it can */
+    if (COMPRESSSWAP && (segment == NOSEGMENT)) {
+        int cached = (operation == WRITE) ? zswapStore(frameNum, processASID, pageNum)
+                                          : zswapLoad(frameNum, processASID, pageNum);
+        if (cached) {
+            return READY;
+        }
+    }
+
+    /* A disk map's pages are its sectors */
+    if ((segment != NOSEGMENT) && (segments[segment].sh_disk != NODISKMAP)) {
+        int diskStatus = diskTransfer((operation == WRITE) ? WRITEBLK : READBLK, segments[segment].sh_disk,
+                                      segments[segment].sh_sector + (pageNum - segments[segment].sh_basePage),
+                                      frameAddress, processASID);
+        if ((operation == WRITE) && (diskStatus == READY)) {
+            perfCount(PERF_WRITEBACK, processASID);
+        }
+        return diskStatus;
+    }
+
+    /* Image pages sit at their own block of the region the image came from
+     * (a clone's parent's), stack extension pages at the top of its own */
+    int flashNum = backingFlash[imageASID[processASID]];
+    int blockNum = backingBase[imageASID[processASID]] + pageNum;
+    if (segment != NOSEGMENT) {
+        /* Shared segment pages live in the segments' region of SHMFLASH */
+        flashNum = SHMFLASH;
+        blockNum = SHMBLOCK + (segment * SHMMAXPAGES) + (pageNum - segments[segment].sh_basePage);
+    } else if ((pageNum >= MAXPAGES) ||
+               (IMAGESHADOW && ((operation == WRITE) || (shadowPages[processASID] & PAGEBIT(pageNum))))) {
+        /* Data written back goes to its shadow block, below the stack blocks (striped, see swapBlock) */
+        swapBlock(processASID, pageNum, &flashNum, &blockNum);
+    }
+
+    /* Look up the flash device's descriptor */
+    devDesc_PTR flash = DEVDESC(FLASHINT, flashNum);
+
+    /* Gain the flash device's grant, charged to the page's owner */
+    diskRequest_t request;
+    acquireDevice(FLASHINT, flashNum, &request, blockNum, processASID);
+
+    /* Memory address */
+    flash->dd_reg->d_data0 = frameAddress; 
+
+    /* Read a page from the flash device */
+    setInterrupts(OFF);
+    flash->dd_reg->d_command = (blockNum << FLASHSHIFT) | operation;
+    int status = SYSCALL(WAITIO, FLASHINT, flashNum, FALSE);
+    setInterrupts(ON);
+
+    /* Release the flash device's grant */
+    releaseDevice(FLASHINT, flashNum, 1);
+
+    if ((operation == WRITE) && (status == READY)) {
+        perfCount(PERF_WRITEBACK, processASID);
+        if (IMAGESHADOW && (segment == NOSEGMENT) && (pageNum < MAXPAGES)) {
+            setInterrupts(OFF);
+            shadowPages[processASID] |= PAGEBIT(pageNum);
+            setInterrupts(ON);
+        }
+    }
+
+    /* Return the status of the operation */
+    return status;
+}
+
+
+/* ========================================================================
+ * Function: clearSwapPoolEntries
+ *
+ * Description: Clears all swap pool entries belonging to the process with
+ *              the specified ASID by walking its owned-frame list, and pushes
+ *              the frames onto the free-frame stack. For a respawn the
+ *              ASID's text frames are kept on its list, still mapped
+ * 
+ * Parameters:
+ *              asid - The ASID of the process whose entries should be cleared
+ *              keepText - TRUE to keep its text frames (SYS43)
+ * 
+ * Returns:
+ *              None
+ * ======================================================================== */
+void clearSwapPoolEntries(int asid, int keepText) {
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    /* Let the page cleaner finish with our frames */
+    while (ownsBusyFrame(asid)) {
+        waitForFrames();
+    }
+    /* Its wired pages are no longer held */
+    unwireASID(asid);
+    setInterrupts(OFF);
+    /* Drop all of this ASID's TLB entries in one sweep */
+    purgeASIDTLB(asid);
+    /* Leave the shared text frames other U-procs own */
+    support_PTR supportStruct = asidSupport[asid];
+    if (supportStruct != NULL) {
+        releaseSharedFrames(supportStruct, keepText);
+    }
+    /* And on the other processors, before any of its frames is reused */
+    shootdownTLB(ASIDBIT(asid));
+    /* Clear all swap pool entries for the current process */
+    int i = ownedFrames[asid];
+    ownedFrames[asid] = NOSWAPFRAME;
+    residentFrames[asid] = 0;
+    while (i != NOSWAPFRAME) {
+        int next = frameNext[i];
+        if (keepText && (supportStruct != NULL) && (frameVpn[i] < MAXPAGES) &&
+            isTextPage(frameVpn[i], supportStruct) && (segmentOf(asid, frameVpn[i]) == NOSEGMENT)) {
+            /* A respawn keeps its text frames where they are */
+            linkOwnedFrame(i);
+            i = next;
+            continue;
+        }
+        if (!TESTFRAME(validMap, i)) {
+            removeVictim(i);
+        }
+        if (frameRefCount[i] > 1) {
+            /* Hand a shared frame to the lowest-numbered remaining sharer */
+            handOffFrame(i, asid);
+            i = next;
+            continue;
+        }
+        setFrameOwner(i, UNOCCUPIED, 0);
+        CLEARFRAME(validMap, i);
+        CLEARFRAME(dirtyMap, i);
+        CLEARFRAME(referencedMap, i);
+        framePte[i] = NULL;
+        frameSharers[i] = 0;
+        frameRefCount[i] = 0;
+
+        /* Return the frame to the free-frame stack */
+        framePrev[i] = NOSWAPFRAME;
+        frameNext[i] = freeFrames;
+        freeFrames = i;
+        i = next;
+    }
+    nextFaultPage[asid] = 0;
+    readAheadWindow[asid] = 0;
+    zeroFillPages[asid] = PAGEBIT(USTACKNUM);
+    zeroFillStack[asid] = ALLSTACKEXT;
+    dropCompressed(asid);
+    shadowPages[asid] = 0;
+    if (!keepText) {
+        asidSupport[asid] = NULL;
+        textPending[asid] = FALSE;
+        leaveGroup(asid);
+    }
+    /* Wake a suspended U-proc: there is room again */
+    if (pffSem < 0) {
+        SYSCALL(VERHOGEN, (int)&pffSem, 0, 0);
+    }
+    /* Release swap pool mutual exclusion */
+    setInterrupts(ON);
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: updateTLB
+ *
+ * Description: Updates the TLB entry, if present, of every U-proc mapping
+ *              the frame. When a frame with TLBSWEEPMIN or more sharers
+ *              has been unmapped, their entries are dropped in one sweep
+ *              instead. Must be called with interrupts off. Only this
+ *              processor's TLB is updated: callers taking a permission away
+ *              shoot down the other processors' entries (shootdownTLB).
+ *
+ * Parameters:
+ *              frameNum - Frame number whose entries to update
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void updateTLB(int frameNum){
+    if (frameRefCount[frameNum] <= 1) {
+        updatePageTLB(framePte[frameNum]);
+        return;
+    }
+    if ((frameRefCount[frameNum] >= TLBSWEEPMIN) && !(framePte[frameNum]->pte_entryLO & VALIDON)) {
+        sweepFrameTLB(frameNum); /* Unmapped from many sharers: one pass */
+        return;
+    }
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (frameSharers[frameNum] & ASIDBIT(asid)) {
+            updatePageTLB(sharerPTE(frameNum, asid));
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: dropTLBEntry
+ *
+ * Description: Removes the TLB entry of every U-proc mapping a frame, if
+ *              present, probing per sharer or, with TLBSWEEPMIN or more
+ *              sharers, in one sweep. The page table entries stay valid,
+ *              so the next access just refills. Must be called with
+ *              interrupts off.
+ *
+ * Parameters:
+ *              frameNum - Frame number whose TLB entries to drop
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void dropTLBEntry(int frameNum) {
+    if (frameRefCount[frameNum] <= 1) {
+        dropPageTLB(framePte[frameNum]);
+        return;
+    }
+    if (frameRefCount[frameNum] >= TLBSWEEPMIN) {
+        sweepFrameTLB(frameNum); /* Many sharers: one pass beats a probe each */
+        return;
+    }
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (frameSharers[frameNum] & ASIDBIT(asid)) {
+            dropPageTLB(sharerPTE(frameNum, asid));
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: updatePageTLB
+ *
+ * Description: Updates the TLB entry of a page table entry if present
+ *
+ * Parameters:
+ *              pageTableEntry - Page table entry to write to the TLB
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void updatePageTLB(pageTableEntry_PTR pageTableEntry) {
+    /* Set the EntryHi register with the VPN and ASID */
+    setENTRYHI(pageTableEntry->pte_entryHI);
+    TLBP(); /* Probe TLB */
+
+    /* Check if matching entry was found */
+    unsigned int index = getINDEX();
+    if (!((index >> PROBESHIFT) & ON)) {
+        /* Set EntryHi and EntryLo */
+        setENTRYHI(pageTableEntry->pte_entryHI);
+        setENTRYLO(pageTableEntry->pte_entryLO);
+
+        TLBWI(); /* Update TLB */
+    } /* If match not found, we'll end up in uTLB_RefillHandler */
+}
+
+
+/******************************************************************************
+ *
+ * Function: dropPageTLB
+ *
+ * Description: Removes the TLB entry of a page table entry, if present, by
+ *              overwriting it with an EntryHi in the unmapped kernel space
+ *              (unique per TLB index) that no access can match
+ *
+ * Parameters:
+ *              pageTableEntry - Page table entry whose TLB entry to drop
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void dropPageTLB(pageTableEntry_PTR pageTableEntry) {
+    setENTRYHI(pageTableEntry->pte_entryHI);
+    TLBP(); /* Probe TLB */
+
+    /* Overwrite the matching entry, if any */
+    unsigned int index = getINDEX();
+    if (!((index >> PROBESHIFT) & ON)) {
+        setENTRYHI(index << VPNSHIFT);
+        setENTRYLO(0);
+        TLBWI();
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: sweepFrameTLB
+ *
+ * Description: Drops every TLB entry that maps a frame, whichever ASID it
+ *              belongs to, with one pass of indexed reads over the TLB.
+ *              Must be called with interrupts off.
+ *
+ * Parameters:
+ *              frameNum - Frame number whose TLB entries to drop
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void sweepFrameTLB(int frameNum) {
+    unsigned int frameAddress = FRAMETOADDR(frameNum);
+    int i;
+    for (i = 0; i < TLBSIZE; i++) {
+        setINDEX(i << TLBINDEXSHIFT);
+        TLBR();
+        if ((getENTRYLO() & PFNMASK) == frameAddress) {
+            setENTRYHI((i << TLBINDEXSHIFT) << VPNSHIFT);
+            setENTRYLO(0);
+            TLBWI();
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: purgeASIDTLB
+ *
+ * Description: Drops every TLB entry tagged with an ASID, with one pass of
+ *              indexed reads over the TLB, so a terminated U-proc's entries
+ *              stop taking TLB slots from live ones. Must be called with
+ *              interrupts off.
+ *
+ * Parameters:
+ *              asid - ASID whose TLB entries to drop
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void purgeASIDTLB(int asid) {
+    int i;
+    for (i = 0; i < TLBSIZE; i++) {
+        setINDEX(i << TLBINDEXSHIFT);
+        TLBR();
+        if (((getENTRYHI() & ASIDMASK) >> ASIDSHIFT) == asid) {
+            setENTRYHI((i << TLBINDEXSHIFT) << VPNSHIFT);
+            setENTRYLO(0);
+            TLBWI();
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: shootdownTLB
+ *
+ * Description: With several processors, waits until every other processor
+ *              whose TLB may hold entries of the given ASIDs has cleared
+ *              it (the nucleus sends them one IPI). Called after a
+ *              permission was taken away in the page tables: unmapping,
+ *              cleaning or releasing frames. Granting one needs no
+ *              shootdown, and neither does only dropping an entry to
+ *              sample references, which just misses remote ones.
+ *
+ * Parameters:
+ *              asids - ASID mask (ASIDBIT) of the U-procs whose entries changed
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void shootdownTLB(unsigned int asids) {
+    if (CPUCOUNT > 1) {
+        int cpu = 0;
+        while (cpu < CPUCOUNT) {
+            cpu = SYSCALL(TLBSHOOTDOWN, asids, cpu, 0);
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: sharerPTE
+ *
+ * Description: Returns the page table entry through which a sharer maps a
+ *              frame. Shared frames hold text, segment pages or a clone's
+ *              copy-on-write pages, all at the same page number in every
+ *              sharer
+ *
+ * Parameters:
+ *              frameNum - Frame number
+ *              asid - ASID of the sharer
+ *
+ * Returns:
+ *              Pointer to the sharer's page table entry
+ *
+ *****************************************************************************/
+pageTableEntry_PTR sharerPTE(int frameNum, int asid) {
+    return pageEntry(asidSupport[asid], frameVpn[frameNum]);
+}
+
+
+/******************************************************************************
+ *
+ * Function: findSharedText
+ *
+ * Description: Looks for a resident frame holding the same text page of
+ *              the same image in another U-proc: same number of text pages,
+ *              same header page fingerprint and same page fingerprint
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *              pageNum - Page number that faulted
+ *
+ * Returns:
+ *              The frame number, or NOSWAPFRAME if there is none
+ *
+ *****************************************************************************/
+int findSharedText(support_PTR supportStruct, int pageNum) {
+    if (pageNum >= supportStruct->sup_textPages) {
+        return NOSWAPFRAME;
+    }
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        support_PTR other = asidSupport[asid];
+        if ((other != NULL) && (other != supportStruct) &&
+            (other->sup_textPages == supportStruct->sup_textPages) &&
+            (other->sup_textPrint[0] == supportStruct->sup_textPrint[0]) &&
+            (other->sup_textPrint[pageNum] == supportStruct->sup_textPrint[pageNum]) &&
+            (other->sup_pageTable[pageNum].pte_entryLO & VALIDON)) {
+            return ADDRTOFRAME(other->sup_pageTable[pageNum].pte_entryLO & PFNMASK);
+        }
+    }
+    return NOSWAPFRAME;
+}
+
+
+/******************************************************************************
+ *
+ * Function: shareFrame
+ *
+ * Description: Adds a U-proc to the sharers of a resident text, segment
+ *              or copy-on-write frame and maps the frame, read-only, in its
+ *              page table
+ *
+ * Parameters:
+ *              frameNum - Frame number holding the text page
+ *              supportStruct - Support structure of the new sharer
+ *              pageNum - Page number to map
+ *              referenced - Whether to set the CLOCK referenced bit
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void shareFrame(int frameNum, support_PTR supportStruct, int pageNum, int referenced) {
+    frameSharers[frameNum] |= ASIDBIT(supportStruct->sup_asid);
+    frameRefCount[frameNum]++;
+    if (referenced) {
+        SETFRAME(referencedMap, frameNum);
+    }
+
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+    setInterrupts(OFF);
+    pte->pte_entryLO = FRAMETOADDR(frameNum) | VALIDON;
+    updatePageTLB(pte);
+    setInterrupts(ON);
+}
+
+
+/******************************************************************************
+ *
+ * Function: releaseSharedFrames
+ *
+ * Description: Removes a terminating U-proc from the sharers of the text,
+ *              shared segment and copy-on-write frames it maps but another
+ *              U-proc owns (its TLB entries go in clearSwapPoolEntries'
+ *              ASID purge). A respawning U-proc stays a sharer of the text
+ *              frames. Called with the swap pool mutex held and interrupts
+ *              off
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the terminating U-proc
+ *              keepText - TRUE to leave the text frames mapped (SYS43)
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void releaseSharedFrames(support_PTR supportStruct, int keepText) {
+    int asid = supportStruct->sup_asid;
+    int pageNum;
+    for (pageNum = 0; pageNum < MAXPAGES + STACKEXTPAGES; pageNum++) {
+        if ((pageNum >= MAXPAGES) && (supportStruct->sup_stackTable == NULL)) {
+            break; /* The stack never grew */
+        }
+        pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+        if ((pte->pte_entryLO & VALIDON) && !(keepText && isTextPage(pageNum, supportStruct))) {
+            int frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+            if ((frameAsid[frameNum] != asid) && (frameSharers[frameNum] & ASIDBIT(asid))) {
+                pte->pte_entryLO &= ~VALIDON;
+                leaveFrame(frameNum, asid);
+            }
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: unmapFrame
+ *
+ * Description: Invalidates the page held by an occupied frame in the page
+ *              table and TLB of every U-proc mapping it. The frame keeps
+ *              its contents and dirty state, so it can go to the victim
+ *              cache; any write-back happens when the frame is reserved
+ *
+ * Parameters:
+ *              frameNum - Frame number to unmap
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void unmapFrame(int frameNum) {
+    /* Update the page table & TLB of every U-proc mapping it atomically */
+    setInterrupts(OFF);
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (frameSharers[frameNum] & ASIDBIT(asid)) {
+            sharerPTE(frameNum, asid)->pte_entryLO &= ~VALIDON;
+        }
+    }
+    shootdownTLB(frameSharers[frameNum]);
+    updateTLB(frameNum);
+    CLEARFRAME(validMap, frameNum);
+    setInterrupts(ON);
+}
+
+
+/******************************************************************************
+ *
+ * Function: reserveFrame
+ *
+ * Description: Takes a frame away from its owner (if any) for a new page:
+ *              unmaps it or takes it out of the victim cache, remembers a
+ *              dirty page's (asid, vpn) for fillFrame to write back (and,
+ *              for a copy-on-write frame, the other sharers it is written
+ *              back for whether or not it is dirty), and
+ *              marks the frame busy so no other fault, the page cleaner
+ *              or a termination touches it while its I/O runs without the
+ *              swap pool mutex. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Frame number to reserve
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void reserveFrame(int frameNum) {
+    if (frameAsid[frameNum] != UNOCCUPIED) {
+        perfCount(PERF_EVICTION, frameAsid[frameNum]);
+        if (TESTFRAME(validMap, frameNum)) {
+            unmapFrame(frameNum);
+        } else {
+            removeVictim(frameNum);
+        }
+        if (cowFrame(frameNum)) {
+            frameWbSharers[frameNum] = frameSharers[frameNum] & ~ASIDBIT(frameAsid[frameNum]);
+        }
+        if (TESTFRAME(dirtyMap, frameNum)) {
+            frameWbAsid[frameNum] = frameAsid[frameNum];
+        }
+        if (TESTFRAME(dirtyMap, frameNum) || frameWbSharers[frameNum]) {
+            frameWbVpn[frameNum] = frameVpn[frameNum];
+            writeBacks++;
+        }
+        unlinkOwnedFrame(frameNum);
+    }
+    setFrameOwner(frameNum, UNOCCUPIED, 0);
+    CLEARFRAME(validMap, frameNum);
+    CLEARFRAME(dirtyMap, frameNum);
+    CLEARFRAME(referencedMap, frameNum);
+    framePte[frameNum] = NULL;
+    frameSharers[frameNum] = 0;
+    frameRefCount[frameNum] = 0;
+    SETFRAME(busyMap, frameNum);
+}
+
+
+/******************************************************************************
+ *
+ * Function: fillFrame
+ *
+ * Description: Brings a page into a reserved frame. The swap pool mutex is
+ *              released for the device I/O (writing back the frame's old
+ *              page if it was dirty or copy-on-write, then reading or
+ *              zeroing the new one, or copying it from a busy source frame),
+ *              so faults on other flash devices overlap; the flash device
+ *              mutex still orders I/O on the same device. Reacquires the
+ *              mutex, clears the busy state, wakes U-procs waiting on busy
+ *              frames and maps the page. A private page written back is
+ *              left to the cleaner as a clustering hint. On failure the
+ *              frame goes back on the free-frame stack. Called with the
+ *              swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Reserved frame number
+ *              supportStruct - Support structure of the owning U-proc
+ *              pageNum - Page number to load
+ *              referenced - Initial CLOCK referenced bit
+ *              source - Frame to copy the page from, or NOSWAPFRAME to load it
+ *
+ * Returns:
+ *              READY if the page is mapped, else the device status
+ *
+ *****************************************************************************/
+int fillFrame(int frameNum, support_PTR supportStruct, int pageNum, int referenced, int source) {
+    int wbAsid = frameWbAsid[frameNum];
+    int wbVpn = frameWbVpn[frameNum];
+    unsigned int wbSharers = frameWbSharers[frameNum];
+
+    /* Release swap pool mutual exclusion for the I/O */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    int status = READY;
+    if (wbAsid != UNOCCUPIED) {
+        status = backingStoreRW(WRITE, frameNum, wbAsid, wbVpn);
+    }
+    int asid;
+    for (asid = 1; (asid <= MAXUPROC) && (status == READY); asid++) {
+        if (wbSharers & ASIDBIT(asid)) {
+            status = backingStoreRW(WRITE, frameNum, asid, wbVpn);
+        }
+    }
+    if ((status == READY) && (source != NOSWAPFRAME)) {
+        CLEARFRAME(zeroedMap, frameNum);
+        copyPage((unsigned int *)FRAMETOADDR(frameNum), (unsigned int *)FRAMETOADDR(source));
+    } else if (status == READY) {
+        status = loadPage(frameNum, supportStruct->sup_asid, pageNum);
+    }
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    /* The old page is on its backing stores now (or lost, if that failed) */
+    if ((wbAsid != UNOCCUPIED) || wbSharers) {
+        for (asid = 1; (asid <= MAXUPROC) && (status == READY); asid++) {
+            if ((asid == wbAsid) || (wbSharers & ASIDBIT(asid))) {
+                clearZeroFill(asid, wbVpn);
+            }
+        }
+        frameWbAsid[frameNum] = UNOCCUPIED;
+        frameWbSharers[frameNum] = 0;
+        writeBacks--;
+
+        /* Leave the dirty page's neighbours to the cleaner */
+        if (PAGECLEANER && (wbAsid != UNOCCUPIED) && (segmentOf(wbAsid, wbVpn) == NOSEGMENT)) {
+            clusterAsid = wbAsid;
+            clusterVpn = wbVpn;
+            if (cleanerSem < 0) {
+                SYSCALL(VERHOGEN, (int)&cleanerSem, 0, 0);
+            }
+        }
+    }
+    CLEARFRAME(busyMap, frameNum);
+    wakeFrameWaiters();
+
+    if (status != READY) {
+        frameNext[frameNum] = freeFrames;
+        framePrev[frameNum] = NOSWAPFRAME;
+        freeFrames = frameNum;
+        return status;
+    }
+    installPage(frameNum, supportStruct, pageNum, referenced);
+    return READY;
+}
+
+
+/******************************************************************************
+ *
+ * Function: writeBackPending
+ *
+ * Description: Checks whether a U-proc's page is being written back from a
+ *              busy frame; reading it before that finishes would get the
+ *              stale copy
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              pageNum - Page number
+ *
+ * Returns:
+ *              TRUE if a write-back of the page is in flight, else FALSE
+ *
+ *****************************************************************************/
+int writeBackPending(int asid, int pageNum) {
+    if (writeBacks == 0) {
+        return FALSE;
+    }
+    int segment = segmentOf(asid, pageNum);
+    int i;
+    for (i = nextMarkedFrame(busyMap, 0); i != NOSWAPFRAME; i = nextMarkedFrame(busyMap, i + 1)) {
+        if ((frameWbVpn[i] == pageNum) &&
+            (((frameWbAsid[i] != UNOCCUPIED) &&
+              ((frameWbAsid[i] == asid) ||
+               ((segment != NOSEGMENT) && (segmentOf(frameWbAsid[i], pageNum) == segment)))) ||
+             (frameWbSharers[i] & ASIDBIT(asid)))) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/******************************************************************************
+ *
+ * Function: ownsBusyFrame
+ *
+ * Description: Checks whether any frame on an ASID's owned-frame list is
+ *              busy (only the page cleaner and zero-copy transfers leave
+ *              owned frames busy)
+ *
+ * Parameters:
+ *              asid - ASID to check
+ *
+ * Returns:
+ *              TRUE if one of its frames is busy, else FALSE
+ *
+ *****************************************************************************/
+int ownsBusyFrame(int asid) {
+    int frameNum = ownedFrames[asid];
+    while (frameNum != NOSWAPFRAME) {
+        if (TESTFRAME(busyMap, frameNum)) {
+            return TRUE;
+        }
+        frameNum = frameNext[frameNum];
+    }
+    return FALSE;
+}
+
+
+/******************************************************************************
+ *
+ * Function: waitForFrames
+ *
+ * Description: Releases the swap pool mutex, blocks until some busy frame
+ *              finishes its I/O and then reacquires the mutex. Interrupts
+ *              are off between the release and the block, so the wake-up
+ *              can not be missed. Callers recheck what they waited for
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void waitForFrames() {
+    setInterrupts(OFF);
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    SYSCALL(PASSEREN, (int)&frameWaitSem, 0, 0);
+    setInterrupts(ON);
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: wakeFrameWaiters
+ *
+ * Description: Wakes every U-proc blocked in waitForFrames
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void wakeFrameWaiters() {
+    while (frameWaitSem < 0) {
+        SYSCALL(VERHOGEN, (int)&frameWaitSem, 0, 0);
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: loadPage
+ *
+ * Description: Fills a frame with a U-proc's page. A zero-fill page (one
+ *              never written back) is zeroed in RAM with no device I/O;
+ *              any other page is read from the backing store
+ *
+ * Parameters:
+ *              frameNum - Frame number to fill
+ *              processASID - The asid of the owning U-proc
+ *              pageNum - The page number to load
+ *
+ * Returns:
+ *              READY if the frame holds the page, else the device status
+ *
+ *****************************************************************************/
+int loadPage(int frameNum, int processASID, int pageNum) {
+    int segment = segmentOf(processASID, pageNum);
+    int zeroFill;
+    if (segment != NOSEGMENT) {
+        zeroFill = segments[segment].sh_zeroFill & PAGEBIT(pageNum - segments[segment].sh_basePage);
+    } else {
+        zeroFill = ZEROFILL && ((pageNum < MAXPAGES) ? (zeroFillPages[processASID] & PAGEBIT(pageNum))
+                                                     : (zeroFillStack[processASID] & PAGEBIT(pageNum - MAXPAGES)));
+    }
+    /* A frame zeroed while the nucleus idled holds the page already */
+    int zeroed = TESTFRAME(zeroedMap, frameNum);
+    CLEARFRAME(zeroedMap, frameNum);
+    if (zeroFill) {
+        if (!zeroed) {
+            zeroPage((unsigned int *)FRAMETOADDR(frameNum));
+        }
+        return READY;
+    }
+    return backingStoreRW(READ, frameNum, processASID, pageNum);
+}
+
+
+/******************************************************************************
+ *
+ * Function: markZeroFillPages
+ *
+ * Description: Marks every page past the end of the flash image (the .text
+ *              and .data file sizes in the aout header) up to the stack
+ *              page as zero-fill. Called the first time page 0 is loaded,
+ *              before any of those pages can have been written back
+ *
+ * Parameters:
+ *              asid - The ASID of the U-proc
+ *              header - The aout header at the start of page 0
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void markZeroFillPages(int asid, memaddr *header) {
+    int imagePages = (header[AOUTTEXTFILESIZE] + header[AOUTDATAFILESIZE] + PAGESIZE - 1) / PAGESIZE;
+    int pageNum;
+    for (pageNum = MAX(imagePages, 1); pageNum < USTACKNUM; pageNum++) {
+        zeroFillPages[asid] |= PAGEBIT(pageNum);
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: reuseFrame
+ *
+ * Description: Chooses a frame to load a page into; the caller reserves
+ *              it. A U-proc whose resource group is at its frame limit
+ *              gets a frame of the group (see groupVictim), and one at its
+ *              resident-set limit with no free frame left gets one of its
+ *              own (see localVictim). Otherwise: a
+ *              free frame, a frame the replacement pointer lands on that
+ *              is already in the victim cache, or else the oldest cached
+ *              frame once the pointer's victim has been unmapped into the
+ *              cache. A copy-on-write victim skips the cache: the cache
+ *              keeps a frame for its owner only, and the other sharers'
+ *              copies must be written back. Busy frames are never chosen.
+ *              Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *
+ * Returns:
+ *              The frame number
+ *
+ *****************************************************************************/
+int reuseFrame(support_PTR supportStruct) {
+    /* A group at its frame limit replaces the group's own frames */
+    int asid = supportStruct->sup_asid;
+    int groupFrame = groupVictim(asid);
+    if (groupFrame != NOSWAPFRAME) {
+        return groupFrame;
+    }
+
+    /* A U-proc at its resident-set limit replaces its own frames */
+    if (PFFCONTROL && (freeFrames == NOSWAPFRAME) && (ownedFrames[asid] != NOSWAPFRAME) &&
+        (residentFrames[asid] >= supportStruct->sup_rssLimit)) {
+        int frameNum = localVictim(asid);
+        if (frameNum != NOSWAPFRAME) {
+            return frameNum;
+        }
+    }
+
+    while (TRUE) {
+        int frameNum = updateFrameNum();
+        if ((frameAsid[frameNum] == UNOCCUPIED) || !TESTFRAME(validMap, frameNum) || cowFrame(frameNum)) {
+            return frameNum;
+        }
+        unmapFrame(frameNum);
+        frameNum = cacheVictim(frameNum);
+        if (frameNum != NOSWAPFRAME) {
+            return frameNum;
+        }
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: localVictim
+ *
+ * Description: Runs a second-chance pass over an ASID's own frames: a
+ *              cached frame or the first unreferenced one is taken, and
+ *              referenced frames passed over lose their bit and TLB entry.
+ *              If every frame was referenced, the first one is taken.
+ *              Busy frames are skipped. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              asid - ASID whose frames to choose from
+ *
+ * Returns:
+ *              The frame number to replace, or NOSWAPFRAME if all are busy
+ *
+ *****************************************************************************/
+int localVictim(int asid) {
+    int frameNum = ownedFrames[asid];
+    while (frameNum != NOSWAPFRAME) {
+        if (TESTFRAME(busyMap, frameNum) || frameWiredBy[frameNum]) {
+            frameNum = frameNext[frameNum];
+            continue; /* Being cleaned, or wired */
+        }
+        if (!TESTFRAME(validMap, frameNum) || !TESTFRAME(referencedMap, frameNum)) {
+            return frameNum;
+        }
+        setInterrupts(OFF);
+        CLEARFRAME(referencedMap, frameNum);
+        dropTLBEntry(frameNum);
+        setInterrupts(ON);
+        frameNum = frameNext[frameNum];
+    }
+    /* Every frame was referenced: take the first one not busy or wired */
+    frameNum = ownedFrames[asid];
+    while ((frameNum != NOSWAPFRAME) && (TESTFRAME(busyMap, frameNum) || frameWiredBy[frameNum])) {
+        frameNum = frameNext[frameNum];
+    }
+    return frameNum;
+}
+
+
+/******************************************************************************
+ *
+ * Function: groupVictim
+ *
+ * Description: Enforces the frame limit of an ASID's resource group. If
+ *              its members hold the limit or more, one of the ASID's own
+ *              frames is chosen (see localVictim), or one of the member
+ *              holding the most if the ASID has none yet. Called with the
+ *              swap pool mutex held
+ *
+ * Parameters:
+ *              asid - ASID of the faulting U-proc
+ *
+ * Returns:
+ *              The frame number to replace, or NOSWAPFRAME if the group is
+ *              under its limit (or every candidate frame is busy)
+ *
+ *****************************************************************************/
+int groupVictim(int asid) {
+    int limit = groupFrameLimit(asid);
+    int group = groupOf(asid);
+    if ((limit == RGNOLIMIT) || (groupResident(group) < limit)) {
+        return NOSWAPFRAME;
+    }
+
+    /* Replace the largest member's frames if the ASID holds none */
+    int victimAsid = asid;
+    if (ownedFrames[asid] == NOSWAPFRAME) {
+        int i;
+        for (i = 1; i <= MAXUPROC; i++) {
+            if ((groupOf(i) == group) && (residentFrames[i] > residentFrames[victimAsid])) {
+                victimAsid = i;
+            }
+        }
+    }
+    return localVictim(victimAsid);
+}
+
+
+/******************************************************************************
+ *
+ * Function: groupResident
+ *
+ * Description: Counts the swap pool frames the members of a resource group
+ *              hold. Reads the owned-frame list lengths without the swap
+ *              pool mutex, so the count may be a fault behind
+ *
+ * Parameters:
+ *              group - Group number
+ *
+ * Returns:
+ *              The number of frames
+ *
+ *****************************************************************************/
+int groupResident(int group) {
+    int asid;
+    int frames = 0;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if (groupOf(asid) == group) {
+            frames += residentFrames[asid];
+        }
+    }
+    return frames;
+}
+
+
+/******************************************************************************
+ *
+ * Function: pffFault
+ *
+ * Description: The page-fault-frequency controller. Charges a fault to the
+ *              U-proc, adapts its resident-set limit to the time since its
+ *              last fault and, when the limits of all live U-procs exceed
+ *              the pool, decides whether it is the one to suspend: the
+ *              fastest faulter (smallest smoothed gap) among them. Called
+ *              with the swap pool mutex held
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *
+ * Returns:
+ *              TRUE if the U-proc should be suspended, else FALSE
+ *
+ *****************************************************************************/
+int pffFault(support_PTR supportStruct) {
+    cpu_t currTime;
+    STCK(currTime);
+    cpu_t gap = currTime - supportStruct->sup_lastFault;
+    supportStruct->sup_lastFault = currTime;
+    supportStruct->sup_faultCount++;
+    if (supportStruct->sup_faultCount == 1) {
+        return FALSE; /* No gap to go by yet */
+    }
+    supportStruct->sup_faultGap = ((supportStruct->sup_faultGap * 3) + gap) / 4;
+
+    /* Faulting often: grant a frame; rarely: take one back */
+    if (gap < PFFLOWER) {
+        supportStruct->sup_rssLimit = MIN(supportStruct->sup_rssLimit + 1, rssCeiling);
+    } else if (gap > PFFUPPER) {
+        supportStruct->sup_rssLimit = MAX(supportStruct->sup_rssLimit - 1, RSSFLOOR);
+    }
+
+    /* Does the demand fit in the pool, and if not, who faults fastest? */
+    int demand = 0;
+    int live = 0;
+    support_PTR worst = NULL;
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        support_PTR other = asidSupport[asid];
+        if (other != NULL) {
+            demand += other->sup_rssLimit;
+            live++;
+            if ((other->sup_faultCount > 1) &&
+                ((worst == NULL) || (other->sup_faultGap < worst->sup_faultGap))) {
+                worst = other;
+            }
+        }
+    }
+    if ((demand <= swapPoolSize) || (live <= 1) || (worst != supportStruct)) {
+        return FALSE;
+    }
+    supportStruct->sup_rssLimit = RSSFLOOR;
+    return TRUE;
+}
+
+
+/******************************************************************************
+ *
+ * Function: cacheVictim
+ *
+ * Description: Puts a just evicted (unmapped and clean) frame at the end of
+ *              the victim cache. It stays on its owner's list, sharing by
+ *              others ends. When the cache is full the oldest frame leaves
+ *              it to be reused
+ *
+ * Parameters:
+ *              frameNum - Frame number just evicted
+ *
+ * Returns:
+ *              The frame to reuse now: frameNum itself if there is no
+ *              cache, the oldest cached frame if it was full, otherwise
+ *              NOSWAPFRAME (the caller evicts another)
+ *
+ *****************************************************************************/
+int cacheVictim(int frameNum) {
+    if (victimLimit == 0) {
+        return frameNum;
+    }
+
+    /* Make room by letting the oldest victim go */
+    int oldest = NOSWAPFRAME;
+    if (victimCount == victimLimit) {
+        oldest = victimCache[0];
+        removeVictim(oldest);
+    }
+
+    CLEARFRAME(validMap, frameNum);
+    CLEARFRAME(referencedMap, frameNum);
+    frameSharers[frameNum] = ASIDBIT(frameAsid[frameNum]);
+    frameRefCount[frameNum] = 1;
+    victimCache[victimCount] = frameNum;
+    victimCount++;
+    return oldest;
+}
+
+
+/******************************************************************************
+ *
+ * Function: reclaimVictim
+ *
+ * Description: Looks for a U-proc's page in the victim cache (for a segment
+ *              page, any attacher's copy of it) through the reverse index
+ *              and takes its frame out of the cache if found
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *              pageNum - Page number that faulted
+ *
+ * Returns:
+ *              The frame still holding the page, or NOSWAPFRAME
+ *
+ *****************************************************************************/
+int reclaimVictim(support_PTR supportStruct, int pageNum) {
+    if (victimCount == 0) {
+        return NOSWAPFRAME;
+    }
+    int frameNum = findPage(supportStruct->sup_asid, pageNum, FALSE);
+    int segment = segmentOf(supportStruct->sup_asid, pageNum);
+    if ((frameNum == NOSWAPFRAME) && (segment != NOSEGMENT)) {
+        int asid;
+        for (asid = 1; (asid <= MAXUPROC) && (frameNum == NOSWAPFRAME); asid++) {
+            if (segments[segment].sh_attached & ASIDBIT(asid)) {
+                frameNum = findPage(asid, pageNum, FALSE);
+            }
+        }
+    }
+    if (frameNum != NOSWAPFRAME) {
+        removeVictim(frameNum);
+    }
+    return frameNum;
+}
+
+
+/******************************************************************************
+ *
+ * Function: removeVictim
+ *
+ * Description: Removes a frame from the victim cache, keeping the others in
+ *              age order
+ *
+ * Parameters:
+ *              frameNum - Frame number in the victim cache
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void removeVictim(int frameNum) {
+    int i = 0;
+    while ((i < victimCount) && (victimCache[i] != frameNum)) {
+        i++;
+    }
+    if (i == victimCount) {
+        return; /* Not cached */
+    }
+    victimCount--;
+    for (; i < victimCount; i++) {
+        victimCache[i] = victimCache[i + 1];
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: installPage
+ *
+ * Description: Records a frame just read from the backing store as holding
+ *              pageNum of the given U-proc and maps it in its page table,
+ *              read-only and clean. A write to a data page later makes it
+ *              dirty through redirtyPage. A dirty victim reclaimed from the
+ *              victim cache is mapped dirty again
+ *
+ * Parameters:
+ *              frameNum - Frame number holding the page
+ *              supportStruct - Support structure of the owning U-proc
+ *              pageNum - Page number loaded into the frame
+ *              referenced - Initial CLOCK referenced bit
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void installPage(int frameNum, support_PTR supportStruct, int pageNum, int referenced) {
+    /* A victim reclaimed by its owner still holds the page, possibly dirty */
+    int keepDirty = (frameVpn[frameNum] == pageNum) && TESTFRAME(dirtyMap, frameNum) &&
+                    ((frameAsid[frameNum] == supportStruct->sup_asid) ||
+                     ((frameAsid[frameNum] != UNOCCUPIED) &&
+                      (segmentOf(frameAsid[frameNum], pageNum) != NOSEGMENT) &&
+                      (segmentOf(frameAsid[frameNum], pageNum) == segmentOf(supportStruct->sup_asid, pageNum))));
+
+    /* Move the frame from its old owner's list (if any) to ours */
+    if (frameAsid[frameNum] != UNOCCUPIED) {
+        unlinkOwnedFrame(frameNum);
+    }
+
+    /* Update the swap pool entry */
+    setFrameOwner(frameNum, supportStruct->sup_asid, pageNum);
+    SETFRAME(validMap, frameNum);
+    setFrameFlag(referencedMap, frameNum, referenced);
+    framePte[frameNum] = pageEntry(supportStruct, pageNum);
+    frameSharers[frameNum] = ASIDBIT(supportStruct->sup_asid);
+    frameRefCount[frameNum] = 1;
+    linkOwnedFrame(frameNum);
+
+    /* Get frame address */
+    memaddr frameAddress = FRAMETOADDR(frameNum);
+
+    /* Update this U-proc's page table and TLB atomically: every page starts
+     * read-only and clean, and the first write to a data page marks it dirty */
+    setInterrupts(OFF);
+    framePte[frameNum]->pte_entryLO = frameAddress | VALIDON;
+    if (keepDirty) {
+        framePte[frameNum]->pte_entryLO |= DIRTYON;
+    }
+    setFrameFlag(dirtyMap, frameNum, keepDirty);
+    updateTLB(frameNum);
+    setInterrupts(ON);
+}
+
+
+/******************************************************************************
+ *
+ * Function: readAhead
+ *
+ * Description: Grows or resets the U-proc's read-ahead window depending on
+ *              whether the fault on pageNum was in order, then loads up to
+ *              that many of the following text/data pages that are not
+ *              resident. Only free or clean frames are used, so read-ahead
+ *              never waits on a write-back; it stops at the first dirty
+ *              victim or failed read. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *              pageNum - Page number that was just faulted in
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void readAhead(support_PTR supportStruct, int pageNum) {
+    int asid = supportStruct->sup_asid;
+
+    /* Adapt the window: double it on an in-order fault, else start over */
+    if ((pageNum != USTACKNUM) && (pageNum == nextFaultPage[asid])) {
+        readAheadWindow[asid] = MIN(MAX(readAheadWindow[asid] * 2, 1), READAHEADMAX);
+    } else {
+        readAheadWindow[asid] = 0;
+    }
+
+    /* Load the window, stopping before the stack page or a segment page */
+    int nextPage = pageNum + 1;
+    int loaded = 0;
+    while ((loaded < readAheadWindow[asid]) && (nextPage < USTACKNUM) &&
+           (segmentOf(asid, nextPage) == NOSEGMENT)) {
+        /* A resident page needs no read */
+        int frameNum = NOSWAPFRAME;
+        if (!(supportStruct->sup_pageTable[nextPage].pte_entryLO & VALIDON)) {
+            frameNum = findSharedText(supportStruct, nextPage);
+        }
+        if (frameNum != NOSWAPFRAME) {
+            shareFrame(frameNum, supportStruct, nextPage, FALSE);
+        } else if (!(supportStruct->sup_pageTable[nextPage].pte_entryLO & VALIDON)) {
+            /* A page still in the victim cache needs no read either */
+            frameNum = reclaimVictim(supportStruct, nextPage);
+            if (frameNum != NOSWAPFRAME) {
+                installPage(frameNum, supportStruct, nextPage, FALSE);
+            } else {
+                if (writeBackPending(asid, nextPage)) {
+                    break; /* Its backing copy is not written yet */
+                }
+                frameNum = updateFrameNum();
+                if ((frameAsid[frameNum] != UNOCCUPIED) && (TESTFRAME(dirtyMap, frameNum) || cowFrame(frameNum))) {
+                    break; /* Never write back just to guess */
+                }
+                reserveFrame(frameNum);
+                if (fillFrame(frameNum, supportStruct, nextPage, FALSE, NOSWAPFRAME) != READY) {
+                    break;
+                }
+            }
+        }
+        loaded++;
+        nextPage++;
+    }
+
+    /* Faulting on the page after the window is in order */
+    nextFaultPage[asid] = nextPage;
+}
+
+
+/* ========================================================================
+ * Function: pageCleaner
+ *
+ * Description: The page cleaner daemon. Every CLEANINTERVAL it looks at the
+ *              CLEANAHEAD frames the replacement pointer reaches next and
+ *              writes back those that are dirty (and, under CLOCK, not
+ *              referenced, since those get a second chance anyway), each
+ *              with its dirty neighbours (see cleanCluster). Woken early by
+ *              a dirty eviction, it first writes the evicted page's
+ *              neighbours
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void pageCleaner() {
+    while (TRUE) {
+        /* Sleep until the next pass, or until idleWork wakes it early */
+        cpu_t currTime;
+        STCK(currTime);
+        int timedOut = SYSCALL(WAITUNTIL, (int)(currTime + CLEANINTERVAL), (int)&cleanerSem, 0);
+
+        /* After an early pass the next sleep runs its full interval */
+        cleanerWakeable = (timedOut == TIMEDOUT);
+
+        /* Gain swap pool mutual exclusion */
+        SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+        /* The neighbours of a dirty page the pager just wrote back */
+        if (clusterAsid != UNOCCUPIED) {
+            int asid = clusterAsid;
+            clusterAsid = UNOCCUPIED;
+            cleanCluster(asid, clusterVpn);
+        }
+
+        int frameNum = nextFrameNum;
+        int i;
+        for (i = 0; i < CLEANAHEAD; i++) {
+            frameNum = (frameNum + 1) % swapPoolSize;
+            if (cleanCandidate(frameNum)) {
+                if (segmentOf(frameAsid[frameNum], frameVpn[frameNum]) == NOSEGMENT) {
+                    cleanCluster(frameAsid[frameNum], frameVpn[frameNum]);
+                } else {
+                    cleanFrame(frameNum);
+                }
+            }
+        }
+
+        /* Release swap pool mutual exclusion */
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    }
+}
+
+
+/* ========================================================================
+ * Function: idleWork
+ *
+ * Description: Called by the scheduler, with interrupts off, before it
+ *              waits with no process ready. If no one holds the swap pool
+ *              mutex, zeroes up to IDLEZEROBATCH free frames that are not
+ *              zeroed yet, stopping once a device or timer interrupt is
+ *              pending. Then, if the cleaner may be woken early and a frame
+ *              ahead of the replacement pointer needs writing back, wakes
+ *              it; the write itself blocks, so it is left to the cleaner
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              TRUE if the cleaner was made ready, else FALSE
+ * ======================================================================== */
+int idleWork() {
+    if (!IDLEWORK || !swapPoolReady || (swapPoolMutex != 1)) {
+        return FALSE; /* Too early, or the pool is being changed */
+    }
+
+    /* Zero the free frames the next zero-fill faults will be given */
+    int frameNum = freeFrames;
+    int zeroed = 0;
+    int scanned;
+    for (scanned = 0; (scanned < swapPoolSize) && (frameNum != NOSWAPFRAME) &&
+                      (zeroed < IDLEZEROBATCH); scanned++) {
+        if (getCAUSE() & CAUSE_IP_MASK & ~PLTINTERRUPT) {
+            return FALSE; /* Let the interrupt in */
+        }
+        if (!TESTFRAME(zeroedMap, frameNum)) {
+            zeroPage((unsigned int *)FRAMETOADDR(frameNum));
+            atomicSetFrame(zeroedMap, frameNum);
+            zeroed++;
+        }
+        frameNum = frameNext[frameNum];
+    }
+
+    /* Start the cleaner's next pass now if it would find work */
+    if (!PAGECLEANER || !cleanerWakeable || (cleanerSem >= 0)) {
+        return FALSE;
+    }
+    frameNum = nextFrameNum;
+    int i;
+    for (i = 0; i < CLEANAHEAD; i++) {
+        frameNum = (frameNum + 1) % swapPoolSize;
+        if (cleanCandidate(frameNum)) {
+            cleanerWakeable = FALSE;
+            return (verhogen(&cleanerSem) != mkEmptyProcQ());
+        }
+    }
+    return FALSE;
+}
+
+
+/* ========================================================================
+ * Function: cleanCandidate
+ *
+ * Description: Checks if the cleaner writes a frame back: it holds a valid
+ *              page, is dirty, not busy and, under CLOCK, not referenced
+ *              (a referenced frame gets a second chance anyway)
+ *
+ * Parameters:
+ *              frameNum - Frame number to check
+ *
+ * Returns:
+ *              TRUE if the frame should be cleaned, else FALSE
+ * ======================================================================== */
+int cleanCandidate(int frameNum) {
+    return ((frameAsid[frameNum] != UNOCCUPIED) && TESTFRAME(validMap, frameNum) &&
+            !TESTFRAME(busyMap, frameNum) && TESTFRAME(dirtyMap, frameNum) &&
+            !((REPLACEMENT == CLOCKPOLICY) && TESTFRAME(referencedMap, frameNum)));
+}
+
+
+/* ========================================================================
+ * Function: zswapStore
+ *
+ * Description: Writes a page back to the compressed arena. Any older copy
+ *              there is dropped first, so if the page does not compress
+ *              into ZMAXWORDS words or there are too few free chunks, the
+ *              caller's flash write leaves the flash copy the only one
+ *
+ * Parameters:
+ *              frameNum - Frame holding the page
+ *              asid - ASID owning the page
+ *              pageNum - Page number (a private page)
+ *
+ * Returns:
+ *              TRUE if the page is in the arena, FALSE to write it to flash
+ * ======================================================================== */
+int zswapStore(int frameNum, int asid, int pageNum) {
+    SYSCALL(PASSEREN, (int)&zswapMutex, 0, 0);
+    freeChunks(zswapHead[asid][pageNum]);
+    zswapHead[asid][pageNum] = NOCHUNK;
+
+    int words = compressPage((unsigned int *)FRAMETOADDR(frameNum));
+    int chunks = (words + ZCHUNKWORDS - 1) / ZCHUNKWORDS;
+    int stored = (words >= 0) && (chunks <= zswapFreeCount);
+    if (stored) {
+        /* Copy the compressed words into a chain of free chunks, in order */
+        int *link = &zswapHead[asid][pageNum];
+        int i;
+        for (i = 0; i < chunks; i++) {
+            int chunk = zswapFree;
+            zswapFree = zswapNext[chunk];
+            zswapFreeCount--;
+            *link = chunk;
+            link = &zswapNext[chunk];
+
+            copyWords((unsigned int *)(zswapArena + (chunk * ZCHUNKWORDS * WORDLEN)),
+                      &zswapBuffer[i * ZCHUNKWORDS], ZCHUNKWORDS);
+        }
+        *link = NOCHUNK;
+    }
+    SYSCALL(VERHOGEN, (int)&zswapMutex, 0, 0);
+    return stored;
+}
+
+
+/* ========================================================================
+ * Function: zswapLoad
+ *
+ * Description: Reads a page from the compressed arena if it has a copy,
+ *              decompressing it into the frame. The copy is kept
+ *
+ * Parameters:
+ *              frameNum - Frame to fill
+ *              asid - ASID owning the page
+ *              pageNum - Page number (a private page)
+ *
+ * Returns:
+ *              TRUE if the frame holds the page, FALSE to read it from flash
+ * ======================================================================== */
+int zswapLoad(int frameNum, int asid, int pageNum) {
+    SYSCALL(PASSEREN, (int)&zswapMutex, 0, 0);
+    int chunk = zswapHead[asid][pageNum];
+    if (chunk == NOCHUNK) {
+        SYSCALL(VERHOGEN, (int)&zswapMutex, 0, 0);
+        return FALSE;
+    }
+
+    /* Gather the chain, then expand the tokens into the frame */
+    int words = 0;
+    while (chunk != NOCHUNK) {
+        copyWords(&zswapBuffer[words], (unsigned int *)(zswapArena + (chunk * ZCHUNKWORDS * WORDLEN)),
+                  ZCHUNKWORDS);
+        words += ZCHUNKWORDS;
+        chunk = zswapNext[chunk];
+    }
+    unsigned int *page = (unsigned int *)FRAMETOADDR(frameNum);
+    int in = 0;
+    int out = 0;
+    while ((out < (PAGESIZE / WORDLEN)) && (in < words)) {
+        unsigned int header = zswapBuffer[in++];
+        int count = header & ~ZRUNBIT;
+        if (header & ZRUNBIT) {
+            unsigned int word = zswapBuffer[in++];
+            while ((count-- > 0) && (out < (PAGESIZE / WORDLEN))) {
+                page[out++] = word;
+            }
+        } else {
+            while ((count-- > 0) && (out < (PAGESIZE / WORDLEN))) {
+                page[out++] = zswapBuffer[in++];
+            }
+        }
+    }
+    SYSCALL(VERHOGEN, (int)&zswapMutex, 0, 0);
+    return TRUE;
+}
+
+
+/* ========================================================================
+ * Function: dropCompressed
+ *
+ * Description: Frees every compressed copy of an ASID's pages. Called when
+ *              its frames are cleared, with no write-back of them in flight
+ *
+ * Parameters:
+ *              asid - ASID whose copies are dropped
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void dropCompressed(int asid) {
+    if (!COMPRESSSWAP) {
+        return;
+    }
+    SYSCALL(PASSEREN, (int)&zswapMutex, 0, 0);
+    int page;
+    for (page = 0; page < (MAXPAGES + STACKEXTPAGES); page++) {
+        freeChunks(zswapHead[asid][page]);
+        zswapHead[asid][page] = NOCHUNK;
+    }
+    SYSCALL(VERHOGEN, (int)&zswapMutex, 0, 0);
+}
+
+
+/* ========================================================================
+ * Function: compressPage
+ *
+ * Description: Compresses a page into zswapBuffer as a sequence of tokens.
+ *              A header with ZRUNBIT set is followed by one word repeated
+ *              (header & ~ZRUNBIT) times; any other header is followed by
+ *              that many literal words. Gives up once the output would
+ *              pass ZMAXWORDS. Called with the arena mutex held
+ *
+ * Parameters:
+ *              page - Address of the page
+ *
+ * Returns:
+ *              Words written, -1 if the page does not compress enough
+ * ======================================================================== */
+int compressPage(unsigned int *page) {
+    int in = 0;
+    int out = 0;
+    while (in < (PAGESIZE / WORDLEN)) {
+        int run = runLength(page, in);
+        if (run >= ZMINRUN) {
+            if ((out + 2) > ZMAXWORDS) {
+                return -1;
+            }
+            zswapBuffer[out++] = ZRUNBIT | run;
+            zswapBuffer[out++] = page[in];
+            in += run;
+        } else {
+            /* Literal words up to the next run worth encoding */
+            if (out >= ZMAXWORDS) {
+                return -1;
+            }
+            int header = out++;
+            int start = in;
+            do {
+                if (out >= ZMAXWORDS) {
+                    return -1;
+                }
+                zswapBuffer[out++] = page[in++];
+            } while ((in < (PAGESIZE / WORDLEN)) && (runLength(page, in) < ZMINRUN));
+            zswapBuffer[header] = in - start;
+        }
+    }
+    return out;
+}
+
+
+/* ========================================================================
+ * Function: runLength
+ *
+ * Description: Counts the words equal to page[index] starting there
+ *
+ * Parameters:
+ *              page - Address of the page
+ *              index - Word to start at
+ *
+ * Returns:
+ *              Length of the run (at least 1)
+ * ======================================================================== */
+int runLength(unsigned int *page, int index) {
+    int run = 1;
+    while (((index + run) < (PAGESIZE / WORDLEN)) && (page[index + run] == page[index])) {
+        run++;
+    }
+    return run;
+}
+
+
+/* ========================================================================
+ * Function: freeChunks
+ *
+ * Description: Pushes a chain of arena chunks onto the free chunk stack.
+ *              Called with the arena mutex held
+ *
+ * Parameters:
+ *              chunk - First chunk of the chain (NOCHUNK for none)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void freeChunks(int chunk) {
+    while (chunk != NOCHUNK) {
+        int next = zswapNext[chunk];
+        zswapNext[chunk] = zswapFree;
+        zswapFree = chunk;
+        zswapFreeCount++;
+        chunk = next;
+    }
+}
+
+
+/* ========================================================================
+ * Function: pinPagesSyscallHandler
+ *
+ * Description: Implements SYS45: wires the pages [a1, a1 + a2 pages) of
+ *              the caller so they are never evicted, or with PINRELEASE in
+ *              a3 unwires them. The range is validated by the dispatch
+ *              table. Wiring is all or nothing: if a page can not be wired
+ *              (a shared segment page, a frame in a page message, a limit
+ *              reached) the pages wired by this call are unwired again
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the calling U-proc
+ *                              (a1: first page, a2: pages, a3: flags)
+ *
+ * Returns:
+ *              SUCCESS, or ERROR if a1 is not page aligned or a page could
+ *              not be wired
+ * ======================================================================== */
+int pinPagesSyscallHandler(support_PTR supportStruct) {
+    state_PTR exceptState = &supportStruct->sup_exceptState[GENERALEXCEPT];
+    memaddr start = exceptState->s_a1;
+    int pages = exceptState->s_a2;
+    int flags = exceptState->s_a3;
+    if (start & (PAGESIZE - 1)) {
+        return ERROR;
+    }
+    supportStruct = supportStruct->sup_space;
+
+    int i;
+    if (flags & PINRELEASE) {
+        for (i = 0; i < pages; i++) {
+            unwirePage(supportStruct, start + (i * PAGESIZE));
+        }
+        return SUCCESS;
+    }
+
+    for (i = 0; i < pages; i++) {
+        if (!wirePage(supportStruct, start + (i * PAGESIZE))) {
+            /* Undo this call's wiring (pages wired before it are kept) */
+            while (i-- > 0) {
+                unwirePage(supportStruct, start + (i * PAGESIZE));
+            }
+            return ERROR;
+        }
+    }
+    return SUCCESS;
+}
+
+
+/* ========================================================================
+ * Function: wirePage
+ *
+ * Description: Faults a page of the U-proc in, then sets its ASID's bit in
+ *              the frame's wiredBy mask. The page may be evicted between
+ *              the fault and the mutex, so this is tried WIRERETRIES times.
+ *              A page the U-proc has wired already counts as wired once
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              vAddress - Page-aligned user address (validated)
+ *
+ * Returns:
+ *              TRUE if the page is wired, else FALSE
+ * ======================================================================== */
+int wirePage(support_PTR supportStruct, memaddr vAddress) {
+    int asid = supportStruct->sup_asid;
+    int pageNum = pageNumber(vAddress);
+    if (segmentOf(asid, pageNum) != NOSEGMENT) {
+        return FALSE; /* Segment frames come and go with their attachments */
+    }
+
+    int attempt;
+    for (attempt = 0; attempt < WIRERETRIES; attempt++) {
+        /* Touch the page so the pager makes it resident */
+        volatile unsigned int touch = *(volatile unsigned int *)vAddress;
+        (void)touch;
+
+        /* Gain swap pool mutual exclusion */
+        SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+        int wired = FALSE;
+        int retry = FALSE;
+        pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+        if (!(pte->pte_entryLO & VALIDON)) {
+            retry = TRUE; /* Evicted again before the mutex */
+        } else {
+            int frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+            if (frameWiredBy[frameNum] & ASIDBIT(asid)) {
+                wired = TRUE;
+            } else if (TESTFRAME(validMap, frameNum) && (wiredPages[asid] < WIREMAXPAGES) &&
+                       ((frameWiredBy[frameNum] != 0) || ((pinnedFrames + wiredFrames) < pinLimit))) {
+                if (frameWiredBy[frameNum] == 0) {
+                    wiredFrames++;
+                }
+                setWiredBy(frameNum, frameWiredBy[frameNum] | ASIDBIT(asid));
+                wiredPages[asid]++;
+                wired = TRUE;
+            }
+        }
+        /* Release swap pool mutual exclusion */
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+        if (!retry) {
+            return wired;
+        }
+    }
+    return FALSE;
+}
+
+
+/* ========================================================================
+ * Function: unwirePage
+ *
+ * Description: Clears the U-proc's bit in the wiredBy mask of a page's
+ *              frame. A page it has not wired is left alone
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              vAddress - Page-aligned user address (validated)
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void unwirePage(support_PTR supportStruct, memaddr vAddress) {
+    int asid = supportStruct->sup_asid;
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNumber(vAddress));
+    if (pte->pte_entryLO & VALIDON) {
+        int frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+        if (frameWiredBy[frameNum] & ASIDBIT(asid)) {
+            setWiredBy(frameNum, frameWiredBy[frameNum] & ~ASIDBIT(asid));
+            wiredPages[asid]--;
+            if (frameWiredBy[frameNum] == 0) {
+                wiredFrames--;
+            }
+        }
+    }
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/* ========================================================================
+ * Function: unwireASID
+ *
+ * Description: Clears an ASID's bit in every frame's wiredBy mask (a shared
+ *              text frame it wired may be owned by another ASID). Called
+ *              with the swap pool mutex held
+ *
+ * Parameters:
+ *              asid - ASID whose wired pages are released
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void unwireASID(int asid) {
+    int frameNum;
+    for (frameNum = nextMarkedFrame(wiredMap, 0); (frameNum != NOSWAPFRAME) && (wiredPages[asid] > 0);
+         frameNum = nextMarkedFrame(wiredMap, frameNum + 1)) {
+        if (frameWiredBy[frameNum] & ASIDBIT(asid)) {
+            setWiredBy(frameNum, frameWiredBy[frameNum] & ~ASIDBIT(asid));
+            wiredPages[asid]--;
+            if (frameWiredBy[frameNum] == 0) {
+                wiredFrames--;
+            }
+        }
+    }
+    wiredPages[asid] = 0;
+}
+
+
+/******************************************************************************
+ *
+ * Function: cleanFrame
+ *
+ * Description: Maps a dirty frame's page read-only and clean, then writes
+ *              it to its owner's backing store. A write by the owner after
+ *              the page went read-only faults (TLB-Modification) and waits
+ *              so it can not be lost. The frame is busy during the write,
+ *              which runs without the swap pool mutex, so it is neither
+ *              evicted nor reclaimed meanwhile. If the write fails the page
+ *              is left writable and dirty for the pager. Called with the
+ *              swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Frame number to clean
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void cleanFrame(int frameNum) {
+    /* Write it back with the frame busy instead of holding the mutex */
+    int asid = frameAsid[frameNum];
+    int pageNum = frameVpn[frameNum];
+    beginClean(frameNum);
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    int status = backingStoreRW(WRITE, frameNum, asid, pageNum);
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    endClean(frameNum, asid, pageNum, status);
+    wakeFrameWaiters();
+}
+
+
+/******************************************************************************
+ *
+ * Function: cleanCluster
+ *
+ * Description: Writes back an ASID's dirty page (if it is a candidate, see
+ *              cleanCandidate) together with the unbroken run of candidate
+ *              pages next to it, up to WBCLUSTER pages. All of them are
+ *              made clean, read-only and busy first, then written in
+ *              ascending flash block order in a single release of the swap
+ *              pool mutex. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              asid - ASID owning the pages
+ *              pageNum - Page number the run is built around
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void cleanCluster(int asid, int pageNum) {
+    int frames[WBCLUSTER];
+    int pages[WBCLUSTER];
+    int count = 0;
+
+    /* The run below the page, then the page, then the run above it */
+    int low = pageNum;
+    while ((count < (WBCLUSTER - 1)) && (clusterPage(asid, low - 1, pageNum) != NOSWAPFRAME)) {
+        low--;
+        count++;
+    }
+    int page;
+    count = 0;
+    for (page = low; page < pageNum; page++) {
+        pages[count] = page;
+        frames[count++] = clusterPage(asid, page, pageNum);
+    }
+    int centre = findPage(asid, pageNum, TRUE);
+    if ((centre != NOSWAPFRAME) && cleanCandidate(centre)) {
+        pages[count] = pageNum;
+        frames[count++] = centre;
+    }
+    for (page = pageNum + 1; count < WBCLUSTER; page++) {
+        int frameNum = clusterPage(asid, page, pageNum);
+        if (frameNum == NOSWAPFRAME) {
+            break;
+        }
+        pages[count] = page;
+        frames[count++] = frameNum;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    /* Stack pages sit at descending blocks: write them highest page first */
+    int i;
+    if (pageNum >= MAXPAGES) {
+        for (i = 0; i < count / 2; i++) {
+            int frameNum = frames[i];
+            frames[i] = frames[count - 1 - i];
+            frames[count - 1 - i] = frameNum;
+            page = pages[i];
+            pages[i] = pages[count - 1 - i];
+            pages[count - 1 - i] = page;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        beginClean(frames[i]);
+    }
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    int status[WBCLUSTER];
+    for (i = 0; i < count; i++) {
+        status[i] = backingStoreRW(WRITE, frames[i], asid, pages[i]);
+    }
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+    for (i = 0; i < count; i++) {
+        endClean(frames[i], asid, pages[i], status[i]);
+    }
+    wakeFrameWaiters();
+}
+
+
+/******************************************************************************
+ *
+ * Function: clusterPage
+ *
+ * Description: Checks if a clustered write-back around a page may take a
+ *              neighbouring page of the same ASID: it must be a private
+ *              page in the same part of the backing store (image pages or
+ *              stack extension pages, whose blocks run in opposite
+ *              directions), resident and a clean candidate. Called with the
+ *              swap pool mutex held
+ *
+ * Parameters:
+ *              asid - ASID owning the pages
+ *              pageNum - Neighbouring page number
+ *              neighbour - Page number the run is built around
+ *
+ * Returns:
+ *              The frame holding the neighbour, or NOSWAPFRAME
+ *
+ *****************************************************************************/
+int clusterPage(int asid, int pageNum, int neighbour) {
+    if ((pageNum < 0) || (pageNum >= (MAXPAGES + STACKEXTPAGES)) ||
+        ((pageNum < MAXPAGES) != (neighbour < MAXPAGES)) || (segmentOf(asid, pageNum) != NOSEGMENT)) {
+        return NOSWAPFRAME;
+    }
+    int frameNum = findPage(asid, pageNum, TRUE);
+    return ((frameNum != NOSWAPFRAME) && cleanCandidate(frameNum)) ? frameNum : NOSWAPFRAME;
+}
+
+
+/******************************************************************************
+ *
+ * Function: beginClean
+ *
+ * Description: Maps a dirty frame's page read-only and clean for its
+ *              write-back and marks the frame busy, so it is neither
+ *              evicted nor reclaimed while the mutex is released. Called
+ *              with the swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Frame number to clean
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void beginClean(int frameNum) {
+    setInterrupts(OFF);
+    framePte[frameNum]->pte_entryLO &= ~DIRTYON;
+    if (frameRefCount[frameNum] > 1) {
+        /* A shared segment frame: every sharer's next write re-dirties it */
+        int sharer;
+        for (sharer = 1; sharer <= MAXUPROC; sharer++) {
+            if (frameSharers[frameNum] & ASIDBIT(sharer)) {
+                sharerPTE(frameNum, sharer)->pte_entryLO &= ~DIRTYON;
+            }
+        }
+    }
+    CLEARFRAME(dirtyMap, frameNum);
+    shootdownTLB(frameSharers[frameNum]); /* No writes elsewhere during the write-back */
+    updateTLB(frameNum);
+    setInterrupts(ON);
+    SETFRAME(busyMap, frameNum);
+}
+
+
+/******************************************************************************
+ *
+ * Function: endClean
+ *
+ * Description: Ends a frame's write-back: the frame is no longer busy, and
+ *              the page is left writable and dirty for the pager if the
+ *              write failed. The caller wakes the busy-frame waiters.
+ *              Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Frame number written back
+ *              asid - ASID owning the page
+ *              pageNum - Page number written
+ *              status - Status of the write
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void endClean(int frameNum, int asid, int pageNum, int status) {
+    CLEARFRAME(busyMap, frameNum);
+    if (status == READY) {
+        clearZeroFill(asid, pageNum);
+    } else {
+        setInterrupts(OFF);
+        framePte[frameNum]->pte_entryLO |= DIRTYON;
+        SETFRAME(dirtyMap, frameNum);
+        updateTLB(frameNum);
+        setInterrupts(ON);
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: redirtyPage
+ *
+ * Description: Handles a TLB-Modification exception: the first write to a
+ *              resident data page since it was loaded or cleaned makes it
+ *              writable and dirty. A page in a copy-on-write frame gets a
+ *              frame of its own first (copySharedPage). If the page was
+ *              evicted meanwhile, retrying simply page faults. A write to a
+ *              text page is fatal
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *              vAddress - Faulting virtual page address
+ *
+ * Returns:
+ *              None (the caller retries the instruction)
+ *
+ *****************************************************************************/
+void redirtyPage(support_PTR supportStruct, memaddr vAddress) {
+    /* Get page number */
+    int pageNum = pageNumber(vAddress);
+
+    if (isTextPage(pageNum, supportStruct)) {
+        terminateUProcess(NULL); /* NUKE IT! */
+    }
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+    if (pte->pte_entryLO & VALIDON) {
+        int frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+        if (cowFrame(frameNum)) {
+            if (copySharedPage(supportStruct, pageNum, frameNum) != READY) {
+                terminateUProcess(&swapPoolMutex);
+                return;
+            }
+        } else {
+            setInterrupts(OFF);
+            pte->pte_entryLO |= DIRTYON;
+            SETFRAME(dirtyMap, frameNum);
+            SETFRAME(referencedMap, frameNum);
+            updateTLB(frameNum);
+            setInterrupts(ON);
+        }
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: linkOwnedFrame
+ *
+ * Description: Adds a frame at the head of the owned-frame list of the
+ *              ASID recorded in its swap pool entry
+ *
+ * Parameters:
+ *              frameNum - Frame number to link
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void linkOwnedFrame(int frameNum) {
+    int asid = frameAsid[frameNum];
+    residentFrames[asid]++;
+    framePrev[frameNum] = NOSWAPFRAME;
+    frameNext[frameNum] = ownedFrames[asid];
+    if (ownedFrames[asid] != NOSWAPFRAME) {
+        framePrev[ownedFrames[asid]] = frameNum;
+    }
+    ownedFrames[asid] = frameNum;
+}
+
+
+/******************************************************************************
+ *
+ * Function: unlinkOwnedFrame
+ *
+ * Description: Removes a frame from the owned-frame list of the ASID
+ *              recorded in its swap pool entry
+ *
+ * Parameters:
+ *              frameNum - Frame number to unlink
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void unlinkOwnedFrame(int frameNum) {
+    int prev = framePrev[frameNum];
+    int next = frameNext[frameNum];
+    residentFrames[frameAsid[frameNum]]--;
+    if (prev != NOSWAPFRAME) {
+        frameNext[prev] = next;
+    } else {
+        ownedFrames[frameAsid[frameNum]] = next;
+    }
+    if (next != NOSWAPFRAME) {
+        framePrev[next] = prev;
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: recordRecentPage
+ *
+ * Description: Adds a page to the U-proc's recently used pages for the
+ *              TLB preload on dispatch, unless it is already among them
+ *              or is a stack extension page
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              pageNum - Page number just faulted in
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void recordRecentPage(support_PTR supportStruct, int pageNum) {
+    if (pageNum >= MAXPAGES) {
+        return; /* Only the first-level table is preloaded */
+    }
+    int i;
+    for (i = 0; i < RECENTPAGES; i++) {
+        if (supportStruct->sup_recentPages[i] == pageNum) {
+            return;
+        }
+    }
+    supportStruct->sup_recentPages[supportStruct->sup_recentNext] = pageNum;
+    supportStruct->sup_recentNext = (supportStruct->sup_recentNext + 1) % RECENTPAGES;
+}
+
+
+/******************************************************************************
+ *
+ * Function: pageNumber
+ *
+ * Description: Maps a validated user page address to its page number:
+ *              0-30 for KUSEG pages, USTACKNUM for the stack page and
+ *              MAXPAGES and up for the stack extension, counting down from
+ *              the page below the stack page
+ *
+ * Parameters:
+ *              vAddress - Page address (validateUserAddress already passed)
+ *
+ * Returns:
+ *              The page number
+ *
+ *****************************************************************************/
+int pageNumber(memaddr vAddress) {
+    if ((KUSEG <= vAddress) && (vAddress <= LASTUPROCPAGE)) {
+        return (vAddress - KUSEG) >> VPNSHIFT;
+    }
+    if ((USTACKLIMIT <= vAddress) && (vAddress < UPAGESTACK)) {
+        return MAXPAGES + STACKEXTINDEX(vAddress);
+    }
+    return USTACKNUM;
+}
+
+
+/******************************************************************************
+ *
+ * Function: pageEntry
+ *
+ * Description: Returns the page table entry of a page. A stack extension
+ *              page lives in the second-level table; the first time the
+ *              U-proc needs it, its ASID's table is initialized (all pages
+ *              invalid) and linked from the support structure
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the U-proc
+ *              pageNum - Page number
+ *
+ * Returns:
+ *              Pointer to the page table entry
+ *
+ *****************************************************************************/
+pageTableEntry_PTR pageEntry(support_PTR supportStruct, int pageNum) {
+    if (pageNum < MAXPAGES) {
+        return &supportStruct->sup_pageTable[pageNum];
+    }
+    if (supportStruct->sup_stackTable == NULL) {
+        pageTableEntry_PTR table = stackTables[supportStruct->sup_asid];
+        int i;
+        for (i = 0; i < STACKEXTPAGES; i++) {
+            table[i].pte_entryHI = ALLOFF | ((UPAGESTACK - ((i + 1) << VPNSHIFT)) | (supportStruct->sup_asid << ASIDSHIFT));
+            table[i].pte_entryLO = ALLOFF | DIRTYON;
+        }
+        supportStruct->sup_stackTable = table; /* Visible to the refill handler once complete */
+    }
+    return &supportStruct->sup_stackTable[pageNum - MAXPAGES];
+}
+
+
+/******************************************************************************
+ *
+ * Function: clearZeroFill
+ *
+ * Description: Records that a page has been written to its backing store,
+ *              so it is read from now on instead of zeroed
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              pageNum - Page number
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void clearZeroFill(int asid, int pageNum) {
+    int segment = segmentOf(asid, pageNum);
+    if (segment != NOSEGMENT) {
+        segments[segment].sh_zeroFill &= ~PAGEBIT(pageNum - segments[segment].sh_basePage);
+    } else if (pageNum < MAXPAGES) {
+        zeroFillPages[asid] &= ~PAGEBIT(pageNum);
+    } else {
+        zeroFillStack[asid] &= ~PAGEBIT(pageNum - MAXPAGES);
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: isTextPage
+ *
+ * Description: Determines if a given page number corresponds to a text page
+ *
+ * Parameters:
+ *              pageNum - The page number to check
+ *              sup - Pointer to the support structure
+ *
+ * Returns:
+ *              True if the page is a text page, False otherwise
+ *
+ *****************************************************************************/
+int isTextPage(int pageNum, support_PTR supportStruct) {
+    return (((pageNum * PAGESIZE) < supportStruct->sup_textSize) || (pageNum < supportStruct->sup_textPages));
+}
+
+
+/******************************************************************************
+ *
+ * Function: segmentOf
+ *
+ * Description: Finds the shared segment an ASID's page belongs to, if the
+ *              ASID is attached to one covering it
+ *
+ * Parameters:
+ *              asid - ASID of the U-proc
+ *              pageNum - Page number
+ *
+ * Returns:
+ *              The segment number, or NOSEGMENT
+ *
+ *****************************************************************************/
+int segmentOf(int asid, int pageNum) {
+    int segment;
+    for (segment = 0; segment < SEGMENTS; segment++) {
+        if ((segments[segment].sh_attached & ASIDBIT(asid)) &&
+            (pageNum >= segments[segment].sh_basePage) &&
+            (pageNum < segments[segment].sh_basePage + segments[segment].sh_pages)) {
+            return segment;
+        }
+    }
+    return NOSEGMENT;
+}
+
+
+/******************************************************************************
+ *
+ * Function: findSegmentFrame
+ *
+ * Description: Finds a resident frame holding a segment page that another
+ *              attached U-proc maps, so a fault can share it
+ *
+ * Parameters:
+ *              supportStruct - Support structure of the faulting U-proc
+ *              pageNum - Page number that faulted
+ *
+ * Returns:
+ *              The frame number, or NOSWAPFRAME
+ *
+ *****************************************************************************/
+int findSegmentFrame(support_PTR supportStruct, int pageNum) {
+    int segment = segmentOf(supportStruct->sup_asid, pageNum);
+    if (segment == NOSEGMENT) {
+        return NOSWAPFRAME;
+    }
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        support_PTR other = asidSupport[asid];
+        if ((other != NULL) && (other != supportStruct) &&
+            (segments[segment].sh_attached & ASIDBIT(asid)) &&
+            (other->sup_pageTable[pageNum].pte_entryLO & VALIDON)) {
+            return ADDRTOFRAME(other->sup_pageTable[pageNum].pte_entryLO & PFNMASK);
+        }
+    }
+    return NOSWAPFRAME;
+}
+
+
+/******************************************************************************
+ *
+ * Function: flushSegments
+ *
+ * Description: Writes back the dirty segment frames (resident or in the
+ *              victim cache) that only a terminating U-proc maps, when
+ *              other U-procs stay attached to their segment or it is a
+ *              disk map; the termination would otherwise free them
+ *              unwritten. Frames it shares are handed to another sharer
+ *              by clearSwapPoolEntries
+ *
+ * Parameters:
+ *              asid - ASID of the terminating U-proc
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void flushSegments(int asid) {
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    /* cleanFrame drops the mutex, so rescan after each write; a failed
+     * write leaves the frame dirty, so the writes are bounded */
+    int writes = 0;
+    int frameNum = ownedFrames[asid];
+    while ((frameNum != NOSWAPFRAME) && (writes < MAXPAGES)) {
+        int segment = segmentOf(asid, frameVpn[frameNum]);
+        if ((segment != NOSEGMENT) && TESTFRAME(dirtyMap, frameNum) && !TESTFRAME(busyMap, frameNum) &&
+            (frameRefCount[frameNum] <= 1) &&
+            ((segments[segment].sh_attached & ~ASIDBIT(asid)) || (segments[segment].sh_disk != NODISKMAP))) {
+            cleanFrame(frameNum);
+            writes++;
+            frameNum = ownedFrames[asid];
+            continue;
+        }
+        frameNum = frameNext[frameNum];
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: detachSegments
+ *
+ * Description: Detaches a terminated U-proc from its segments once no
+ *              eviction is still writing back one of its pages (the write
+ *              needs the segment to find its block). A segment left with
+ *              no attachers is deleted
+ *
+ * Parameters:
+ *              asid - ASID of the terminating U-proc
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void detachSegments(int asid) {
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    int pending = TRUE;
+    while (pending) {
+        pending = FALSE;
+        int i;
+        for (i = nextMarkedFrame(busyMap, 0); i != NOSWAPFRAME; i = nextMarkedFrame(busyMap, i + 1)) {
+            if ((frameWbAsid[i] == asid) || (frameWbSharers[i] & ASIDBIT(asid))) {
+                pending = TRUE;
+            }
+        }
+        if (pending) {
+            waitForFrames();
+        }
+    }
+
+    int segment;
+    for (segment = 0; segment < SEGMENTS; segment++) {
+        segments[segment].sh_attached &= ~ASIDBIT(asid);
+        if (segments[segment].sh_attached == 0) {
+            segments[segment].sh_pages = 0;
+            segments[segment].sh_zeroFill = 0;
+            segments[segment].sh_disk = NODISKMAP;
+        }
+    }
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: attachSegment
+ *
+ * Description: Attaches an ASID to a named segment, or to the disk map of
+ *              some sectors, at a range of its pages: waits for the old
+ *              pages' write-backs and pins, creates the segment if no one
+ *              is attached or checks its range, and drops the ASID's own
+ *              copies of the pages
+ *
+ * Parameters:
+ *              supportStruct - Support structure holding the page table
+ *              asid - ASID to attach
+ *              segment - Named segment, or NOSEGMENT for a disk map
+ *              basePage - First page number of the range
+ *              pages - Pages in the range
+ *              disk - Disk of a disk map, or NODISKMAP
+ *              sector - First sector of a disk map
+ *
+ * Returns:
+ *              SUCCESS if attached (or already attached at that range),
+ *              ERROR if the range differs from the segment's or overlaps
+ *              another segment of the ASID, or no disk map slot fits
+ *
+ *****************************************************************************/
+int attachSegment(support_PTR supportStruct, int asid, int segment, int basePage, int pages, int disk, int sector) {
+    int pageNum;
+
+    /* Gain swap pool mutual exclusion */
+    SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
+
+    /* Let write-backs and pins of the old pages finish first: a write-back
+     * after the attach would land in the segment */
+    int waiting = TRUE;
+    while (waiting) {
+        waiting = FALSE;
+        for (pageNum = basePage; pageNum < basePage + pages; pageNum++) {
+            pageTableEntry_PTR pte = &supportStruct->sup_pageTable[pageNum];
+            if (((segmentOf(asid, pageNum) == NOSEGMENT) && writeBackPending(asid, pageNum)) ||
+                ((pte->pte_entryLO & VALIDON) && TESTFRAME(busyMap, ADDRTOFRAME(pte->pte_entryLO & PFNMASK)))) {
+                waiting = TRUE;
+            }
+        }
+        if (waiting) {
+            waitForFrames();
+        }
+    }
+
+    /* A disk map shares the slot of the same sectors at the same pages */
+    if (disk != NODISKMAP) {
+        segment = diskMapSlot(disk, sector, basePage, pages);
+        if (segment == NOSEGMENT) {
+            SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+            return ERROR;
+        }
+    }
+
+    shmSegment_PTR shm = &segments[segment];
+    int status = SUCCESS;
+    if ((shm->sh_attached != 0) && ((shm->sh_basePage != basePage) || (shm->sh_pages != pages))) {
+        status = ERROR; /* The segment lives elsewhere */
+    }
+    int other;
+    for (other = 0; other < SEGMENTS; other++) {
+        if ((other != segment) && (segments[other].sh_attached & ASIDBIT(asid)) &&
+            (basePage < segments[other].sh_basePage + segments[other].sh_pages) &&
+            (segments[other].sh_basePage < basePage + pages)) {
+            status = ERROR; /* Overlaps another of our segments */
+        }
+    }
+    if ((status == ERROR) || (shm->sh_attached & ASIDBIT(asid))) {
+        SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+        return status;
+    }
+
+    /* Drop our private copies of the pages */
+    for (pageNum = basePage; pageNum < basePage + pages; pageNum++) {
+        pageTableEntry_PTR pte = &supportStruct->sup_pageTable[pageNum];
+        int frameNum;
+        if (pte->pte_entryLO & VALIDON) {
+            frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+            unmapFrame(frameNum);
+        } else {
+            frameNum = reclaimVictim(supportStruct, pageNum);
+        }
+        if (frameNum != NOSWAPFRAME) {
+            freeFrame(frameNum);
+        }
+    }
+
+    /* Create the segment (a named one zero-fill, a disk map from its sectors) or join it */
+    if (shm->sh_attached == 0) {
+        shm->sh_basePage = basePage;
+        shm->sh_pages = pages;
+        shm->sh_zeroFill = (disk == NODISKMAP) ? (0xFFFFFFFF >> (32 - pages)) : 0;
+        shm->sh_disk = disk;
+        shm->sh_sector = sector;
+    }
+    shm->sh_attached |= ASIDBIT(asid);
+
+    /* Release swap pool mutual exclusion */
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return SUCCESS;
+}
+
+
+/******************************************************************************
+ *
+ * Function: diskMapSlot
+ *
+ * Description: Finds the disk map of some sectors at a range of pages, or
+ *              a free slot for it. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              disk - Disk number
+ *              sector - First sector
+ *              basePage - First page number of the range
+ *              pages - Pages (and sectors) in the range
+ *
+ * Returns:
+ *              The segment number of the matching or a free slot, or
+ *              NOSEGMENT if a different map overlaps the sectors or no
+ *              slot is free
+ *
+ *****************************************************************************/
+int diskMapSlot(int disk, int sector, int basePage, int pages) {
+    int freeSlot = NOSEGMENT;
+    int segment;
+    for (segment = SHMSEGMENTS; segment < SEGMENTS; segment++) {
+        shmSegment_PTR shm = &segments[segment];
+        if (shm->sh_attached == 0) {
+            if (freeSlot == NOSEGMENT) {
+                freeSlot = segment;
+            }
+        } else if ((shm->sh_disk == disk) && (sector < shm->sh_sector + shm->sh_pages) &&
+                   (shm->sh_sector < sector + pages)) {
+            /* The same map, or one that would cache the sectors twice */
+            return ((shm->sh_sector == sector) && (shm->sh_basePage == basePage) && (shm->sh_pages == pages))
+                   ? segment : NOSEGMENT;
+        }
+    }
+    return freeSlot;
+}
+
+
+/******************************************************************************
+ *
+ * Function: freeFrame
+ *
+ * Description: Takes an unmapped frame (or one out of the victim cache)
+ *              from its owner and puts it on the free-frame stack. Its
+ *              contents are dropped. Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              frameNum - Frame number to free
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void freeFrame(int frameNum) {
+    unlinkOwnedFrame(frameNum);
+    setFrameOwner(frameNum, UNOCCUPIED, 0);
+    CLEARFRAME(validMap, frameNum);
+    CLEARFRAME(dirtyMap, frameNum);
+    CLEARFRAME(referencedMap, frameNum);
+    framePte[frameNum] = NULL;
+    frameSharers[frameNum] = 0;
+    frameRefCount[frameNum] = 0;
+    framePrev[frameNum] = NOSWAPFRAME;
+    frameNext[frameNum] = freeFrames;
+    freeFrames = frameNum;
+}
+
+
+/******************************************************************************
+ *
+ * Function: freeASID
+ *
+ * Description: Finds an ASID a clone can take: one no U-proc was created
+ *              with or whose U-proc has terminated, with a backing store
+ *              region (its configured one, or a spare one). Called with the
+ *              swap pool mutex held
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              The ASID, or UNOCCUPIED if there is none
+ *
+ *****************************************************************************/
+int freeASID() {
+    int asid;
+    for (asid = 1; asid <= MAXUPROC; asid++) {
+        if ((freeASIDs & ASIDBIT(asid)) && (asidSupport[asid] == NULL) &&
+            ((backingEnd[asid] != 0) || spareRegion(asid))) {
+            return asid;
+        }
+    }
+    return UNOCCUPIED;
+}
 
-/*----------------------------------------------------------------------------*/
-/* Helper Function Implementations */
-/*----------------------------------------------------------------------------*/
 
 /******************************************************************************
  *
- * Function: deallocateSupportStruct
+ * Function: spareRegion
  *
- * Description: Adds a support structure structure to the free list
+ * Description: Gives an ASID no U-proc was configured with the default
+ *              region: the whole of flash device asid - 1, if it is
+ *              installed, holds at least REGIONMIN blocks, no other
+ *              ASID pages from it and the trace sink did not claim it.
+ *              Called with the swap pool mutex held
  *
  * Parameters:
- *              supportStruct - Pointer to the support structure to be freed
+ *              asid - ASID without a region
  *
  * Returns:
- *              None
+ *              TRUE if the ASID has a region now, else FALSE
  *
  *****************************************************************************/
-void deallocateSupportStruct(support_PTR supportStruct) {
-    if (supportStruct == NULL)
-        return; /* No free support structures */
-    
-    /* Add to free list (insert at front) */
-    supportStruct->sup_next = supportFreeList;
-    supportFreeList = supportStruct;
+int spareRegion(int asid) {
+    int flashNum = asid - 1;
+    if ((flashNum >= DEVPERINT) ||
+        (DEVDESC(FLASHINT, flashNum)->dd_reg->d_status == NOTINSTALLED) ||
+        (DEVDESC(FLASHINT, flashNum)->dd_reg->d_data1 < REGIONMIN) || traceSinkDevice(flashNum)) {
+        return FALSE;
+    }
+    int other;
+    for (other = 1; other <= MAXUPROC; other++) {
+        if ((backingEnd[other] != 0) && (backingFlash[other] == flashNum)) {
+            return FALSE;
+        }
+    }
+    backingFlash[asid] = flashNum;
+    backingBase[asid] = 0;
+    backingEnd[asid] = DEVDESC(FLASHINT, flashNum)->dd_reg->d_data1;
+    return TRUE;
 }
 
 
 /******************************************************************************
  *
- * Function: resetSupportStruct
+ * Function: clonePage
  *
- * Description: Resets a support structure to its initial values
+ * Description: Maps one of a parent's pages in its clone. A resident
+ *              private page is shared copy-on-write: the parent loses its
+ *              write permission and the clone maps the frame read-only. A
+ *              text or segment frame is shared as usual. A page that is
+ *              not resident is left to the clone's own fault (zero-fill,
+ *              image, segment) unless the parent's latest copy is in its
+ *              own backing store: that one is reclaimed from the victim
+ *              cache or faulted in for the parent first. Called with the
+ *              swap pool mutex held
  *
  * Parameters:
- *              supportStruct - Pointer to the support structure to reset
+ *              parent - Support structure of the parent
+ *              child - Support structure of the clone
+ *              pageNum - Page number
  *
  * Returns:
- *              None
+ *              READY, or the device status if the page could not be read
  *
  *****************************************************************************/
-void resetSupportStruct(support_PTR supportStruct) {
-    /* Return if no support structure */
-    if (supportStruct == NULL)
-        return;
-    
-    supportStruct->sup_asid = UNOCCUPIED; /* Reset ASID */
-    supportStruct->sup_textSize = 0; /* Reset text size */
-    
-    /* Reset exception states */
-    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_pc = 0;
-    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_status = 0;
-    supportStruct->sup_exceptContext[PGFAULTEXCEPT].c_stackPtr = 0;
-    supportStruct->sup_exceptContext[GENERALEXCEPT].c_pc = 0;
-    supportStruct->sup_exceptContext[GENERALEXCEPT].c_status = 0;
-    supportStruct->sup_exceptContext[GENERALEXCEPT].c_stackPtr = 0;
+int clonePage(support_PTR parent, support_PTR child, int pageNum) {
+    int parentASID = parent->sup_asid;
+    int shared = ((pageNum < MAXPAGES) && isTextPage(pageNum, parent)) ||
+                 (segmentOf(parentASID, pageNum) != NOSEGMENT);
+    while (TRUE) {
+        pageTableEntry_PTR pte = pageEntry(parent, pageNum);
+        if (pte->pte_entryLO & VALIDON) {
+            int frameNum = ADDRTOFRAME(pte->pte_entryLO & PFNMASK);
+            if (TESTFRAME(busyMap, frameNum)) {
+                waitForFrames();
+                continue;
+            }
+            if (!shared) {
+                /* The parent's next write makes its own copy (or, alone again, redirties) */
+                setInterrupts(OFF);
+                pte->pte_entryLO &= ~DIRTYON;
+                updatePageTLB(pte);
+                setInterrupts(ON);
+            }
+            shareFrame(frameNum, child, pageNum, FALSE);
+            return READY;
+        }
+        if (shared) {
+            return READY;
+        }
+        if (writeBackPending(parentASID, pageNum)) {
+            waitForFrames();
+            continue;
+        }
+        int frameNum = reclaimVictim(parent, pageNum);
+        if (frameNum != NOSWAPFRAME) {
+            installPage(frameNum, parent, pageNum, FALSE);
+            continue;
+        }
 
-    /* Reset page table entries */
-    int i;
-    for (i = 0; i < MAXPAGES; i++) {
-        supportStruct->sup_pageTable[i].pte_entryHI = 0;
-        supportStruct->sup_pageTable[i].pte_entryLO = 0;
+        /* Only the image, zero-fill or the segment has the page: the clone reads it too */
+        int ownCopy = (COMPRESSSWAP && (zswapHead[parentASID][pageNum] != NOCHUNK)) ||
+                      ((pageNum < MAXPAGES) ? (shadowPages[parentASID] & PAGEBIT(pageNum))
+                                            : !(zeroFillStack[parentASID] & PAGEBIT(pageNum - MAXPAGES)));
+        if (!ownCopy) {
+            return READY;
+        }
+        frameNum = reuseFrame(parent);
+        reserveFrame(frameNum);
+        int status = fillFrame(frameNum, parent, pageNum, FALSE, NOSWAPFRAME);
+        if (status != READY) {
+            return status;
+        }
     }
-    supportStruct->sup_next = NULL; /* Reset next pointer in free list */
 }
 
 
-/* ========================================================================
- * Function: updateFrameNum
+/******************************************************************************
  *
- * Description: Updates the frame number for FIFO page replacement algorithm
- *              Optimization: Check if there are any unoccupied frames before
- *              getting the next frame number using FIFO
+ * Function: copySharedPage
+ *
+ * Description: Gives a U-proc writing a copy-on-write page a frame of its
+ *              own: a new frame is filled from the shared one (busy until
+ *              the copy is done, so no other sharer writes it meanwhile),
+ *              then the writer leaves the shared frame, handing it on if
+ *              it was the owner, and maps its copy dirty. A wire of the
+ *              page moves with it. If another sharer is copying the page
+ *              already, the writer just retries. Called with the swap pool
+ *              mutex held
  *
  * Parameters:
- *              None
+ *              supportStruct - Support structure of the writer
+ *              pageNum - Page number written
+ *              source - Shared frame holding the page
  *
  * Returns:
- *              The next frame number to be used
- * ======================================================================== */
-int updateFrameNum() {
-    /* Check if there is an empty frame */
-    int i;
-    for (i = 0; i < SWAPPOOLSIZE; i++) {
-        if (swapPool[i].asid == UNOCCUPIED) {
-            nextFrameNum = i;
-            return nextFrameNum;
+ *              READY, or the frame's device status if its old page could
+ *              not be written back
+ *
+ *****************************************************************************/
+int copySharedPage(support_PTR supportStruct, int pageNum, int source) {
+    int asid = supportStruct->sup_asid;
+    if (TESTFRAME(busyMap, source)) {
+        waitForFrames();
+        return READY; /* Retry the write */
+    }
+    SETFRAME(busyMap, source);
+    int frameNum = reuseFrame(supportStruct);
+    reserveFrame(frameNum);
+    int status = fillFrame(frameNum, supportStruct, pageNum, TRUE, source);
+
+    if (status == READY) {
+        /* The writer maps its copy now: leave the shared frame, wire included */
+        if (frameAsid[source] == asid) {
+            unlinkOwnedFrame(source);
+            handOffFrame(source, asid);
+        } else {
+            leaveFrame(source, asid);
+        }
+        if (frameWiredBy[source] & ASIDBIT(asid)) {
+            setWiredBy(source, frameWiredBy[source] & ~ASIDBIT(asid));
+            if (frameWiredBy[source] == 0) {
+                wiredFrames--;
+            }
+            setWiredBy(frameNum, ASIDBIT(asid)); /* A reused frame is never wired */
+            wiredFrames++;
         }
+
+        /* Writable at once; other processors may still map the shared frame */
+        pageTableEntry_PTR pte = pageEntry(supportStruct, pageNum);
+        setInterrupts(OFF);
+        pte->pte_entryLO |= DIRTYON;
+        SETFRAME(dirtyMap, frameNum);
+        updateTLB(frameNum);
+        shootdownTLB(ASIDBIT(asid));
+        setInterrupts(ON);
     }
-    /* Update the FIFO index for next time */
-    nextFrameNum = (nextFrameNum + 1) % SWAPPOOLSIZE;
-    return nextFrameNum;
+    CLEARFRAME(busyMap, source);
+    wakeFrameWaiters();
+    return status;
 }
 
 
-/* ========================================================================
- * Function: backingStoreRW
+/******************************************************************************
+ *
+ * Function: cowFrame
  *
- * Description: Performs read or write operations on flash device backing store
+ * Description: Checks if a frame holds a private page several ASIDs share
+ *              after a fork, as opposed to a text or segment frame
  *
  * Parameters:
- *              operation - The operation to perform (READ or WRITE)
- *              frameNum - The frame number to operate on
- *              processASID - The asid of which backing store to operate on
- *              pageNum - The page number to operate on
+ *              frameNum - Frame number to check
  *
  * Returns:
- *              SUCCESS if operation completed successfully
- *              ERROR if there was a problem
- * ======================================================================== */
-int backingStoreRW(int operation, int frameNum, int processASID, int pageNum) {
-    /* Get frame address & flash device number */
-    int frameAddress = FRAMETOADDR(frameNum);
-    int flashNum = processASID - 1;
-
-    /* Calculate device semaphore index based on line and device number */
-    int devMutex = ((FLASHINT - MAPINT) * DEV_PER_LINE) + (flashNum);
-
-    /* Gain device mutex for the flash device */
-    SYSCALL(PASSEREN, (int)&deviceMutex[devMutex], 0, 0);
+ *              TRUE if the frame is copy-on-write, else FALSE
+ *
+ *****************************************************************************/
+int cowFrame(int frameNum) {
+    int asid = frameAsid[frameNum];
+    int pageNum = frameVpn[frameNum];
+    return (frameRefCount[frameNum] > 1) && (asid != UNOCCUPIED) &&
+           !((pageNum < MAXPAGES) && isTextPage(pageNum, asidSupport[asid])) &&
+           (segmentOf(asid, pageNum) == NOSEGMENT);
+}
 
-    /* Memory address */
-    devregarea_t *devRegisterArea = (devregarea_t *)RAMBASEADDR;
-    devRegisterArea->devreg[devMutex].d_data0 = frameAddress; 
 
-    /* Read a page from the flash device */
-    setInterrupts(OFF);
-    devRegisterArea->devreg[devMutex].d_command = (pageNum << FLASHSHIFT) | operation;
-    int status = SYSCALL(WAITIO, FLASHINT, flashNum, FALSE);
-    setInterrupts(ON);
+/******************************************************************************
+ *
+ * Function: leaveFrame
+ *
+ * Description: Drops an ASID from the sharers of a frame another ASID owns
+ *              once the ASID no longer maps it
+ *
+ * Parameters:
+ *              frameNum - Frame number
+ *              asid - ASID leaving it
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void leaveFrame(int frameNum, int asid) {
+    frameSharers[frameNum] &= ~ASIDBIT(asid);
+    frameRefCount[frameNum]--;
+}
 
-    /* Release device mutex for the flash device */
-    SYSCALL(VERHOGEN, (int)&deviceMutex[devMutex], 0, 0);
 
-    /* Return the status of the operation */
-    return status;
+/******************************************************************************
+ *
+ * Function: handOffFrame
+ *
+ * Description: Gives a shared frame its owner is leaving to the lowest-
+ *              numbered remaining sharer. A copy-on-write page is marked
+ *              dirty: the heir's backing store may not have it yet. The
+ *              caller has taken the frame off the old owner's list
+ *
+ * Parameters:
+ *              frameNum - Frame number
+ *              asid - ASID of the owner leaving it
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void handOffFrame(int frameNum, int asid) {
+    int copied = cowFrame(frameNum);
+    leaveFrame(frameNum, asid);
+    int heir = 1;
+    while (!(frameSharers[frameNum] & ASIDBIT(heir))) {
+        heir++;
+    }
+    setFrameOwner(frameNum, heir, frameVpn[frameNum]);
+    framePte[frameNum] = sharerPTE(frameNum, heir);
+    if (copied) {
+        SETFRAME(dirtyMap, frameNum);
+    }
+    linkOwnedFrame(frameNum);
 }
 
 
-/* ========================================================================
- * Function: clearSwapPoolEntries
+/******************************************************************************
+ *
+ * Function: releaseASID
+ *
+ * Description: Lets a clone take a terminated U-proc's ASID. Called once
+ *              no write-back of its pages is in flight and its segments are
+ *              detached
  *
- * Description: Clears all swap pool entries belonging to the process with
- *              the specified ASID
- * 
  * Parameters:
- *              asid - The ASID of the process whose entries should be cleared
- * 
+ *              asid - ASID of the terminated U-proc
+ *
  * Returns:
  *              None
- * ======================================================================== */
-void clearSwapPoolEntries(int asid) {
+ *
+ *****************************************************************************/
+void releaseASID(int asid) {
     /* Gain swap pool mutual exclusion */
     SYSCALL(PASSEREN, (int)&swapPoolMutex, 0, 0);
-    setInterrupts(OFF);
-    /* Clear all swap pool entries for the current process */
-    int i;
-    for (i = 0; i < SWAPPOOLSIZE; i++) {
-        if (swapPool[i].asid == asid){
-            swapPool[i].asid = UNOCCUPIED;
-            swapPool[i].vpn = FALSE;
-            swapPool[i].valid = FALSE;
-            swapPool[i].dirty = FALSE;
-            swapPool[i].pte = NULL;
+    freeASIDs |= ASIDBIT(asid);
+    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+}
+
+
+/******************************************************************************
+ *
+ * Function: poolMetaBytes
+ *
+ * Description: Computes the bytes the swap pool metadata takes for a number
+ *              of frames: the state bitmaps, then the word, halfword and
+ *              byte arrays (placed in that order, so each stays aligned)
+ *
+ * Parameters:
+ *              frames - Number of frames
+ *
+ * Returns:
+ *              The size in bytes
+ *
+ *****************************************************************************/
+int poolMetaBytes(int frames) {
+    return (POOLMAPS * MAPWORDS(frames) * WORDLEN) +
+           (frames * (sizeof(pageTableEntry_PTR) + (3 * sizeof(unsigned int)))) +
+           (frames * 5 * sizeof(short)) +
+           (frames * 3 * sizeof(signed char));
+}
+
+
+/******************************************************************************
+ *
+ * Function: placePoolMeta
+ *
+ * Description: Points every swap pool metadata array into the memory
+ *              starting at base, in the order poolMetaBytes sizes them
+ *
+ * Parameters:
+ *              base - Word-aligned address of the metadata
+ *              frames - Number of frames it describes
+ *
+ * Returns:
+ *              The first address past the metadata
+ *
+ *****************************************************************************/
+memaddr placePoolMeta(memaddr base, int frames) {
+    int mapBytes = MAPWORDS(frames) * WORDLEN;
+    validMap = (unsigned int *)base;
+    dirtyMap = (unsigned int *)(base += mapBytes);
+    referencedMap = (unsigned int *)(base += mapBytes);
+    busyMap = (unsigned int *)(base += mapBytes);
+    zeroedMap = (unsigned int *)(base += mapBytes);
+    wiredMap = (unsigned int *)(base += mapBytes);
+    framePte = (pageTableEntry_PTR *)(base += mapBytes);
+    frameSharers = (unsigned int *)(base += frames * sizeof(pageTableEntry_PTR));
+    frameWbSharers = (unsigned int *)(base += frames * sizeof(unsigned int));
+    frameWiredBy = (unsigned int *)(base += frames * sizeof(unsigned int));
+    frameVpn = (short *)(base += frames * sizeof(unsigned int));
+    frameWbVpn = (short *)(base += frames * sizeof(short));
+    frameNext = (short *)(base += frames * sizeof(short));
+    framePrev = (short *)(base += frames * sizeof(short));
+    frameHashNext = (short *)(base += frames * sizeof(short));
+    frameAsid = (signed char *)(base += frames * sizeof(short));
+    frameWbAsid = (signed char *)(base += frames * sizeof(signed char));
+    frameRefCount = (signed char *)(base += frames * sizeof(signed char));
+    return base + (frames * sizeof(signed char));
+}
+
+
+/******************************************************************************
+ *
+ * Function: setFrameFlag
+ *
+ * Description: Sets or clears a frame's bit in one of the state bitmaps.
+ *              Called with the swap pool mutex held
+ *
+ * Parameters:
+ *              map - State bitmap
+ *              frameNum - Frame number
+ *              on - TRUE to set the bit, FALSE to clear it
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void setFrameFlag(unsigned int *map, int frameNum, int on) {
+    if (on) {
+        SETFRAME(map, frameNum);
+    } else {
+        CLEARFRAME(map, frameNum);
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: atomicSetFrame
+ *
+ * Description: Sets a frame's bit in a state bitmap with compare-and-swap,
+ *              for the two writers that run without the swap pool mutex
+ *              (the TLB refill handler and idleWork): a plain read-modify-
+ *              write of the shared word could undo a concurrent change to
+ *              another frame's bit. A lost set from the other direction
+ *              only costs a reference bit or a zeroed frame
+ *
+ * Parameters:
+ *              map - State bitmap
+ *              frameNum - Frame number
+ *
+ * Returns:
+ *              None
+ *
+ *****************************************************************************/
+void atomicSetFrame(unsigned int *map, int frameNum) {
+    unsigned int *word = &map[frameNum >> 5];
+    unsigned int old = *word;
+    while (!CAS(word, old, old | (1U << (frameNum & 31)))) {
+        old = *word;
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: nextMarkedFrame
+ *
+ * Description: Finds the first frame at or after frameNum whose bit is set
+ *              in a state bitmap, skipping clear words whole
+ *
+ * Parameters:
+ *              map - State bitmap
+ *              frameNum - Frame number to start from
+ *
+ * Returns:
+ *              The frame number, or NOSWAPFRAME if there is none
+ *
+ *****************************************************************************/
+int nextMarkedFrame(unsigned int *map, int frameNum) {
+    while (frameNum < swapPoolSize) {
+        unsigned int bits = map[frameNum >> 5] >> (frameNum & 31);
+        if (bits == 0) {
+            frameNum = (frameNum | 31) + 1; /* Nothing set in the rest of the word */
+            continue;
         }
+        while (!(bits & 1U)) {
+            bits >>= 1;
+            frameNum++;
+        }
+        return (frameNum < swapPoolSize) ? frameNum : NOSWAPFRAME;
     }
-    /* Release swap pool mutual exclusion */
-    setInterrupts(ON);
-    SYSCALL(VERHOGEN, (int)&swapPoolMutex, 0, 0);
+    return NOSWAPFRAME;
 }
 
 
 /******************************************************************************
  *
- * Function: updateTLB
+ * Function: setWiredBy
  *
- * Description: Updates the TLB entry if present
+ * Description: Sets the ASIDs wiring a frame, and its bit in the wired
+ *              bitmap to whether there are any. Called with the swap pool
+ *              mutex held
  *
  * Parameters:
- *              frameNum - Frame number whose
+ *              frameNum - Frame number
+ *              wiredBy - Bit per ASID keeping it resident
  *
  * Returns:
  *              None
  *
  *****************************************************************************/
-void updateTLB(int frameNum){
-    /* Set the EntryHi register with the VPN and ASID */
-    pageTableEntry_PTR pageTableEntry = swapPool[frameNum].pte;
-    setENTRYHI(pageTableEntry->pte_entryHI);
-    TLBP(); /* Probe TLB */
+void setWiredBy(int frameNum, unsigned int wiredBy) {
+    frameWiredBy[frameNum] = wiredBy;
+    setFrameFlag(wiredMap, frameNum, wiredBy != 0);
+}
 
-    /* Check if matching entry was found */
-    unsigned int index = getINDEX();
-    if (!((index >> PROBESHIFT) & ON)) {
-        /* Set EntryHi and EntryLo */
-        setENTRYHI(pageTableEntry->pte_entryHI);
-        setENTRYLO(pageTableEntry->pte_entryLO);
 
-        TLBWI(); /* Update TLB */
-    } /* If match not found, we'll end up in uTLB_RefillHandler */
+/******************************************************************************
+ *
+ * Function: pageBucket
+ *
+ * Description: Hashes an (asid, vpn) pair to a reverse index bucket with
+ *              Fibonacci hashing
+ *
+ * Parameters:
+ *              asid - ASID
+ *              vpn - Page number
+ *
+ * Returns:
+ *              The bucket number
+ *
+ *****************************************************************************/
+int pageBucket(int asid, int vpn) {
+    unsigned int key = ((unsigned int)asid << 16) | (unsigned int)vpn;
+    return (int)((key * PAGEHASHMULT) >> (32 - PAGEHASHBITS));
 }
 
 
 /******************************************************************************
  *
- * Function: isTextPage
+ * Function: setFrameOwner
  *
- * Description: Determines if a given page number corresponds to a text page
+ * Description: Changes the (asid, vpn) a frame holds, moving it between
+ *              reverse index buckets. A frame given UNOCCUPIED leaves the
+ *              index. Called with the swap pool mutex held
  *
  * Parameters:
- *              pageNum - The page number to check
- *              sup - Pointer to the support structure
+ *              frameNum - Frame number
+ *              asid - New owner, or UNOCCUPIED
+ *              vpn - Page number it holds for that owner
  *
  * Returns:
- *              True if the page is a text page, False otherwise
+ *              None
  *
  *****************************************************************************/
-int isTextPage(int pageNum, support_PTR supportStruct) {
-    return ((pageNum * PAGESIZE) < supportStruct->sup_textSize);
+void setFrameOwner(int frameNum, int asid, int vpn) {
+    if (frameAsid[frameNum] != UNOCCUPIED) {
+        int bucket = pageBucket(frameAsid[frameNum], frameVpn[frameNum]);
+        if (pageHash[bucket] == frameNum) {
+            pageHash[bucket] = frameHashNext[frameNum];
+        } else {
+            int prev = pageHash[bucket];
+            while (frameHashNext[prev] != frameNum) {
+                prev = frameHashNext[prev];
+            }
+            frameHashNext[prev] = frameHashNext[frameNum];
+        }
+    }
+
+    frameAsid[frameNum] = asid;
+    frameVpn[frameNum] = vpn;
+    if (asid != UNOCCUPIED) {
+        int bucket = pageBucket(asid, vpn);
+        frameHashNext[frameNum] = pageHash[bucket];
+        pageHash[bucket] = frameNum;
+    }
+}
+
+
+/******************************************************************************
+ *
+ * Function: findPage
+ *
+ * Description: Looks an (asid, vpn) up in the reverse index, taking only a
+ *              frame that holds it mapped (valid) or only one that holds it
+ *              unmapped (in the victim cache). Called with the swap pool
+ *              mutex held
+ *
+ * Parameters:
+ *              asid - ASID owning the page
+ *              vpn - Page number
+ *              valid - TRUE for a mapped frame, FALSE for a cached one
+ *
+ * Returns:
+ *              The frame number, or NOSWAPFRAME if there is none
+ *
+ *****************************************************************************/
+int findPage(int asid, int vpn, int valid) {
+    int frameNum = pageHash[pageBucket(asid, vpn)];
+    while ((frameNum != NOSWAPFRAME) &&
+           ((frameAsid[frameNum] != asid) || (frameVpn[frameNum] != vpn) ||
+            (TESTFRAME(validMap, frameNum) != (unsigned int)(valid != FALSE)))) {
+        frameNum = frameHashNext[frameNum];
+    }
+    return frameNum;
 }
@@ -0,0 +1,280 @@
+/******************************* waitAny.c ***********************************
+ *
+ * Module: Wait-Any
+ *
+ * Description:
+ * This module implements SYS53 (WAITANY), which lets one U-proc serve
+ * several sources of work without blocking on any single one. a1 points
+ * at an array of a2 waitEvent_t entries in the caller's address space,
+ * each naming an asynchronous request (the address of an aiocb_t the
+ * caller submitted with SYS26), a named semaphore (SYS29/30/39), a
+ * terminal with type-ahead input (SYS13) or a NIC's received packets
+ * (SYS55). SYS53 returns the index of the
+ * first entry that is ready, or TIMEDOUT once a3 microseconds pass.
+ *
+ * Implementation:
+ * The nucleus blocks a process on one semaphore, so each caller takes a
+ * waiter slot with a semaphore of its own and a copy of its events. It
+ * registers before it looks at the events, then sleeps on its semaphore
+ * (under WAITUNTIL when it has a deadline) and looks again when woken.
+ * Whoever makes an event ready (the async I/O worker finishing a request,
+ * a V adding a unit to a named semaphore, a terminal reader daemon
+ * completing a line, a NIC receiver daemon queueing a packet) calls notifyWaiters, which V's every registered
+ * waiter watching it, so a completion between the look and the sleep is
+ * never lost. A wake-up for an event someone else consumed first just
+ * makes the waiter look again.
+ *
+ * Policy Decisions:
+ * - Readiness: An async request is ready once it is no longer in flight
+ *   (its aio_status holds the result and SYS27 returns at once). A named
+ *   semaphore is ready when it has a unit, and SYS53 takes that unit, as
+ *   a P would. A terminal is ready when SYS13 would not block: its input
+ *   ring holds a line, is full or has a receive error to report. A NIC
+ *   is ready when it holds a received packet (or is not installed, so
+ *   SYS55 fails at once)
+ * - Order: Entries are looked at in array order, so an earlier entry wins
+ *   when several are ready; only the one returned is consumed
+ * - Timeouts: a3 is a relative timeout in microseconds; 0 looks once
+ *   without blocking and WAITFOREVER never gives up
+ * - Terminals: Without TYPEAHEAD no input is buffered to be ready, so a
+ *   terminal entry makes SYS53 fail with ERROR
+ * - Slots: There is a waiter slot for every U-proc and thread, so SYS53
+ *   always finds one
+ * - Parameter Validation: An unknown kind, a bad control block address,
+ *   semaphore ID, terminal or NIC number, or a negative timeout other than
+ *   WAITFOREVER terminates the U-proc
+ *
+ * Functions:
+ * - initWaiters: Frees every waiter slot
+ * - waitAnySyscallHandler: Implements SYS53 (WAITANY)
+ * - notifyWaiters: Wakes the waiters watching an event
+ * - firstReady: Finds (and consumes) a waiter's first ready event
+ * - validEvent: Checks one event of a SYS53 request
+ *
+ * Written by Aryah Rao & Anish Reddy
+ *
+ *****************************************************************************/
+
+#include "../h/waitAny.h"
+
+/*----------------------------------------------------------------------------*/
+/* Hidden Global Variables */
+/*----------------------------------------------------------------------------*/
+HIDDEN waiter_t waiters[WAITERS];               /* Waiter slots */
+HIDDEN int waiterCount;                         /* Slots in use (notifyWaiters does nothing at 0) */
+HIDDEN int waiterMutex;                         /* Semaphore for the slots */
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Prototypes */
+/*----------------------------------------------------------------------------*/
+HIDDEN int firstReady(waiter_PTR waiter);
+HIDDEN int validEvent(waitEvent_PTR event);
+
+/*----------------------------------------------------------------------------*/
+/* Global Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: initWaiters
+ *
+ * Description: Frees every waiter slot
+ *
+ * Parameters:
+ *              None
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void initWaiters() {
+    int i;
+    for (i = 0; i < WAITERS; i++) {
+        waiters[i].wt_asid = UNOCCUPIED;
+        waiters[i].wt_sem = 0;
+        waiters[i].wt_count = 0;
+    }
+    waiterCount = 0;
+    waiterMutex = 1;
+}
+
+/* ========================================================================
+ * Function: waitAnySyscallHandler
+ *
+ * Description: Handles SYS53 (WAITANY). Blocks until one of the a2 events
+ *              at a1 is ready, or a3 microseconds pass
+ *
+ * Parameters:
+ *              supportStruct - Pointer to the current process's support structure
+ *
+ * Returns:
+ *              Index of the first ready event (a semaphore's unit taken)
+ *              TIMEDOUT if the timeout passed first
+ *              ERROR for a terminal event without TYPEAHEAD
+ * ======================================================================== */
+int waitAnySyscallHandler(support_PTR supportStruct) {
+    state_t *exceptState = &(supportStruct->sup_exceptState[GENERALEXCEPT]);
+    waitEvent_PTR events = (waitEvent_PTR)exceptState->s_a1;
+    int count = exceptState->s_a2;
+    int micros = exceptState->s_a3;
+
+    /* Copy the events, so they can not change after they are checked */
+    waitEvent_t request[WAITANYMAX];
+    int i;
+    for (i = 0; i < count; i++) {
+        request[i] = events[i];
+    }
+
+    /* Validate parameters (dispatchSyscall checked the array itself) */
+    if ((micros < 0) && (micros != WAITFOREVER)) {
+        terminateUProcess(NULL); /* Nuke it! */
+    }
+    for (i = 0; i < count; i++) {
+        if (!validEvent(&request[i])) {
+            terminateUProcess(NULL); /* Nuke it! */
+        }
+        if ((request[i].we_kind == WAITTERM) && !TYPEAHEAD) {
+            return ERROR;
+        }
+    }
+
+    /* Register: from here on every event we watch wakes us */
+    SYSCALL(PASSEREN, (int)&waiterMutex, 0, 0);
+    waiter_PTR waiter = &waiters[0];
+    while (waiter->wt_asid != UNOCCUPIED) {
+        waiter++;
+    }
+    waiter->wt_sem = 0;
+    waiter->wt_count = count;
+    for (i = 0; i < count; i++) {
+        waiter->wt_events[i] = request[i];
+    }
+    waiter->wt_asid = supportStruct->sup_asid;
+    waiterCount++;
+    SYSCALL(VERHOGEN, (int)&waiterMutex, 0, 0);
+
+    /* Look, then sleep until something we watch changes */
+    cpu_t deadline = 0;
+    if (micros > 0) {
+        cpu_t currTime;
+        STCK(currTime);
+        deadline = (micros > (MAXINT - currTime)) ? MAXINT : (currTime + micros);
+    }
+    int ready = firstReady(waiter);
+    int status = SUCCESS;
+    while ((ready == NOEVENT) && (micros != 0) && (status != TIMEDOUT)) {
+        if (micros == WAITFOREVER) {
+            SYSCALL(PASSEREN, (int)&waiter->wt_sem, 0, 0);
+        } else {
+            status = SYSCALL(WAITUNTIL, (int)deadline, (int)&waiter->wt_sem, 0);
+        }
+        ready = firstReady(waiter);
+    }
+
+    /* Leave; no V reaches the slot after this */
+    SYSCALL(PASSEREN, (int)&waiterMutex, 0, 0);
+    waiter->wt_asid = UNOCCUPIED;
+    waiterCount--;
+    SYSCALL(VERHOGEN, (int)&waiterMutex, 0, 0);
+
+    return (ready == NOEVENT) ? TIMEDOUT : ready;
+}
+
+/* ========================================================================
+ * Function: notifyWaiters
+ *
+ * Description: Wakes every waiter watching an event that may have become
+ *              ready. Called by the event's producer, holding none of the
+ *              locks firstReady takes
+ *
+ * Parameters:
+ *              kind - WAITAIO, WAITSEM, WAITTERM or WAITNET
+ *              asid - ASID that submitted the request (WAITAIO only)
+ *              handle - Control block address, semaphore ID, terminal or NIC
+ *
+ * Returns:
+ *              None
+ * ======================================================================== */
+void notifyWaiters(int kind, int asid, int handle) {
+    if (waiterCount == 0) {
+        return; /* No one to wake: skip the mutex */
+    }
+
+    SYSCALL(PASSEREN, (int)&waiterMutex, 0, 0);
+    int i;
+    for (i = 0; i < WAITERS; i++) {
+        waiter_PTR waiter = &waiters[i];
+        if ((waiter->wt_asid == UNOCCUPIED) || ((kind == WAITAIO) && (waiter->wt_asid != asid))) {
+            continue;
+        }
+        int j;
+        for (j = 0; j < waiter->wt_count; j++) {
+            if ((waiter->wt_events[j].we_kind == kind) && (waiter->wt_events[j].we_handle == handle)) {
+                SYSCALL(VERHOGEN, (int)&waiter->wt_sem, 0, 0);
+                break;
+            }
+        }
+    }
+    SYSCALL(VERHOGEN, (int)&waiterMutex, 0, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Helper Function Implementations */
+/*----------------------------------------------------------------------------*/
+
+/* ========================================================================
+ * Function: firstReady
+ *
+ * Description: Finds a registered waiter's first ready event, taking a
+ *              semaphore's unit if that is the one
+ *
+ * Parameters:
+ *              waiter - The caller's waiter slot
+ *
+ * Returns:
+ *              Index of the event, or NOEVENT if none is ready
+ * ======================================================================== */
+int firstReady(waiter_PTR waiter) {
+    int i;
+    for (i = 0; i < waiter->wt_count; i++) {
+        waitEvent_PTR event = &waiter->wt_events[i];
+        int ready;
+        if (event->we_kind == WAITAIO) {
+            ready = !aioInFlight(waiter->wt_asid, event->we_handle);
+        } else if (event->we_kind == WAITSEM) {
+            ready = tryTakeSemaphore(event->we_handle);
+        } else if (event->we_kind == WAITTERM) {
+            ready = terminalInputReady(event->we_handle);
+        } else {
+            ready = netPacketReady(event->we_handle);
+        }
+        if (ready) {
+            return i;
+        }
+    }
+    return NOEVENT;
+}
+
+/* ========================================================================
+ * Function: validEvent
+ *
+ * Description: Checks one event of a SYS53 request
+ *
+ * Parameters:
+ *              event - The event (copied from the caller)
+ *
+ * Returns:
+ *              TRUE if its kind and handle are usable, else FALSE
+ * ======================================================================== */
+int validEvent(waitEvent_PTR event) {
+    int handle = event->we_handle;
+    switch (event->we_kind) {
+        case WAITAIO:
+            return ((handle & (WORDLEN - 1)) == 0) && validateUserAddress(handle);
+        case WAITSEM:
+            return (handle >= 0) && (handle < USERSEMS);
+        case WAITTERM:
+        case WAITNET:
+            return (handle >= 0) && (handle < DEV_PER_LINE);
+        default:
+            return FALSE;
+    }
+}
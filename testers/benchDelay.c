@@ -0,0 +1,42 @@
+/*	Microbenchmark: DELAY wakeup accuracy. Sleeps ROUNDS times with
+ *	SYS18 (1 second) and SYS28 (MICRODELAY us) and reports the mean and
+ *	largest lateness of the wakeups.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	ROUNDS		5
+#define	MICRODELAY	20000
+
+/* Sleeps ROUNDS times with op(argument) and reports the mean and
+ * largest lateness under the two metric names */
+void measure(char *meanMetric, char *maxMetric, int op, int argument, unsigned int expected) {
+	unsigned int start, late, total = 0, worst = 0;
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		start = benchNow();
+		SYSCALL(op, argument, 0, 0);
+		late = benchNow() - start;
+		late = (late > expected) ? (late - expected) : 0;
+		total += late;
+		if (late > worst)
+			worst = late;
+	}
+
+	benchReport("delay", meanMetric, total / ROUNDS, "us");
+	benchReport("delay", maxMetric, worst, "us");
+}
+
+void main() {
+	print(WRITETERMINAL, "benchDelay starts\n");
+
+	measure("seclate", "seclatemax", DELAY, 1, SECOND);
+	measure("microlate", "microlatemax", DELAYMICRO, MICRODELAY, MICRODELAY);
+
+	print(WRITETERMINAL, "benchDelay completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,48 @@
+/*	Microbenchmark: DISK_PUT and DISK_GET throughput, over BENCHSECTORS
+ *	consecutive sectors and over as many random sectors below
+ *	BENCHSECTORSPAN, on disk BENCHDISK (4KB per sector).
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	BUFFERPAGE	20
+
+/* KB/s for BENCHSECTORS sectors moved in elapsed us */
+unsigned int kbPerSecond(unsigned int elapsed) {
+	unsigned int ms = elapsed / 1000;
+	return (BENCHSECTORS * (PAGESIZE / 1024) * 1000) / ((ms == 0) ? 1 : ms);
+}
+
+/* Moves BENCHSECTORS sectors with op, in order or at random */
+unsigned int pass(int op, int random, unsigned int seed) {
+	unsigned int start;
+	int i, sector, status;
+	int *buffer = (int *)(SEG2 + (BUFFERPAGE * PAGESIZE));
+
+	start = benchNow();
+	for (i = 0; i < BENCHSECTORS; i++) {
+		sector = random ? (benchRandom(&seed) % BENCHSECTORSPAN) : i;
+		buffer[0] = sector;
+		status = SYSCALL(op, (int)buffer, BENCHDISK, sector);
+		if (status != READY) {
+			print(WRITETERMINAL, "benchDisk error: bad disk status\n");
+			SYSCALL(TERMINATE, 0, 0, 0);
+		}
+	}
+	return benchNow() - start;
+}
+
+void main() {
+	print(WRITETERMINAL, "benchDisk starts\n");
+
+	benchReport("disk", "seqput", kbPerSecond(pass(DISK_PUT, FALSE, 0)), "KB/s");
+	benchReport("disk", "seqget", kbPerSecond(pass(DISK_GET, FALSE, 0)), "KB/s");
+	benchReport("disk", "randput", kbPerSecond(pass(DISK_PUT, TRUE, 7)), "KB/s");
+	benchReport("disk", "randget", kbPerSecond(pass(DISK_GET, TRUE, 7)), "KB/s");
+
+	print(WRITETERMINAL, "benchDisk completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,38 @@
+/*	Microbenchmark: FLASH_GET throughput over BENCHFLASHBLOCKS blocks of
+ *	flash BENCHFLASH from block BENCHFLASHBLOCK (above the backing store
+ *	pages), read PASSES times (4KB per block).
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	BUFFERPAGE	20
+#define	PASSES		4
+
+void main() {
+	unsigned int start, elapsed, ms;
+	int i, block, status;
+	int *buffer = (int *)(SEG2 + (BUFFERPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "benchFlash starts\n");
+
+	start = benchNow();
+	for (i = 0; i < PASSES; i++)
+		for (block = 0; block < BENCHFLASHBLOCKS; block++) {
+			status = SYSCALL(FLASH_GET, (int)buffer, BENCHFLASH, BENCHFLASHBLOCK + block);
+			if (status != READY) {
+				print(WRITETERMINAL, "benchFlash error: bad flash status\n");
+				SYSCALL(TERMINATE, 0, 0, 0);
+			}
+		}
+	elapsed = benchNow() - start;
+
+	ms = elapsed / 1000;
+	benchReport("flash", "get",
+		(PASSES * BENCHFLASHBLOCKS * (PAGESIZE / 1024) * 1000) / ((ms == 0) ? 1 : ms), "KB/s");
+
+	print(WRITETERMINAL, "benchFlash completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,53 @@
+/* Helpers shared by the bench* microbenchmarks: the clock, a random
+ * number generator and the machine-parseable result line */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+
+/* Time of day in microseconds (SYS10) */
+unsigned int benchNow() {
+	return SYSCALL(GET_TOD, 0, 0, 0);
+}
+
+
+/* Next number of a linear congruential generator */
+unsigned int benchRandom(unsigned int *seed) {
+	*seed = (*seed * 1103515245) + 12345;
+	return (*seed >> 16);
+}
+
+
+/* Appends str to line at *leng */
+static void append(char *line, int *leng, char *str) {
+	while (*str != EOS)
+		line[(*leng)++] = *str++;
+}
+
+
+/* Prints "bench=<bench> metric=<metric> value=<value> unit=<unit>" */
+void benchReport(char *bench, char *metric, unsigned int value, char *unit) {
+	char line[128];
+	char digits[12];
+	int leng = 0, count = 0;
+
+	append(line, &leng, "bench=");
+	append(line, &leng, bench);
+	append(line, &leng, " metric=");
+	append(line, &leng, metric);
+	append(line, &leng, " value=");
+	do {
+		digits[count++] = '0' + (value % 10);
+		value /= 10;
+	} while (value != 0);
+	while (count > 0)
+		line[leng++] = digits[--count];
+	append(line, &leng, " unit=");
+	append(line, &leng, unit);
+	append(line, &leng, "\n");
+	line[leng] = EOS;
+
+	print(WRITETERMINAL, line);
+}
@@ -0,0 +1,56 @@
+/*	Microbenchmark: page fault and TLB miss cost. The first touch of
+ *	each of PAGES fresh pages of kuseg is a page fault. Touching them
+ *	again, round robin, needs more TLB entries than the TLB holds, so
+ *	(as long as the pages stay resident) each touch is a TLB refill; the
+ *	cost of the same loop on a single page is subtracted.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	FIRSTPAGE	8
+#define	PAGES		22
+#define	PASSES		50
+
+void main() {
+	unsigned int start, faultTime, missTime, hitTime;
+	int i, pass;
+	volatile int *word;
+
+	print(WRITETERMINAL, "benchMemory starts\n");
+
+	/* First touches: one page fault each */
+	start = benchNow();
+	for (i = 0; i < PAGES; i++) {
+		word = (int *)(SEG2 + ((FIRSTPAGE + i) * PAGESIZE));
+		*word = i;
+	}
+	faultTime = benchNow() - start;
+
+	/* Round robin over all the pages: TLB misses */
+	start = benchNow();
+	for (pass = 0; pass < PASSES; pass++)
+		for (i = 0; i < PAGES; i++) {
+			word = (int *)(SEG2 + ((FIRSTPAGE + i) * PAGESIZE));
+			*word += pass;
+		}
+	missTime = benchNow() - start;
+
+	/* The same loop on one page: TLB hits */
+	start = benchNow();
+	for (pass = 0; pass < PASSES; pass++)
+		for (i = 0; i < PAGES; i++) {
+			word = (int *)(SEG2 + (FIRSTPAGE * PAGESIZE));
+			*word += pass;
+		}
+	hitTime = benchNow() - start;
+
+	benchReport("memory", "pagefault", faultTime / PAGES, "us");
+	benchReport("memory", "tlbmiss",
+		(missTime > hitTime) ? ((missTime - hitTime) * 1000) / (PASSES * PAGES) : 0, "ns");
+
+	print(WRITETERMINAL, "benchMemory completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,36 @@
+/*	Microbenchmark: P/V ping-pong latency. benchPingA and benchPingB
+ *	(run together) bounce a token over the named semaphores BENCHPING
+ *	and BENCHPONG (SYS29/SYS30). benchPingA times the round trips; half
+ *	a round trip is one V-to-wakeup hand-over.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	ROUNDS	200
+
+void main() {
+	unsigned int start, elapsed;
+	int i;
+
+	print(WRITETERMINAL, "benchPingA starts\n");
+
+	start = benchNow();
+	for (i = 0; i < ROUNDS; i++) {
+		SYSCALL(VSEMNAMED, BENCHPING, 0, 0);
+		if (SYSCALL(PSEMTIMED, BENCHPONG, BENCHTIMEOUT, 0) != 0) {
+			print(WRITETERMINAL, "benchPingA error: benchPingB did not answer\n");
+			SYSCALL(TERMINATE, 0, 0, 0);
+		}
+	}
+	elapsed = benchNow() - start;
+
+	benchReport("pingpong", "rounds", ROUNDS, "count");
+	benchReport("pingpong", "roundtrip", elapsed / ROUNDS, "us");
+	benchReport("pingpong", "handover", elapsed / (2 * ROUNDS), "us");
+
+	print(WRITETERMINAL, "benchPingA completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,27 @@
+/*	Microbenchmark: the echoing half of the P/V ping-pong (see
+ *	benchPingA). Answers every BENCHPING with a BENCHPONG.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	ROUNDS	200
+
+void main() {
+	int i;
+
+	print(WRITETERMINAL, "benchPingB starts\n");
+
+	for (i = 0; i < ROUNDS; i++) {
+		if (SYSCALL(PSEMTIMED, BENCHPING, BENCHTIMEOUT, 0) != 0) {
+			print(WRITETERMINAL, "benchPingB error: benchPingA did not ping\n");
+			SYSCALL(TERMINATE, 0, 0, 0);
+		}
+		SYSCALL(VSEMNAMED, BENCHPONG, 0, 0);
+	}
+
+	print(WRITETERMINAL, "benchPingB completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,119 @@
+/*	Paging benchmark. Reads its config (working set, access pattern,
+ *	read/write ratio, duration) from block SWAPCONFIGBLOCK of flash
+ *	BENCHFLASH, waiting up to SWAPCONFIGWAIT for benchSwapConfig to write
+ *	it; a block without SWAPMAGIC means the defaults below. It then
+ *	touches its working set in that pattern until the duration is up and
+ *	reports its page faults (its own SYS32 counters), faults per second,
+ *	and the mean time of an access that faulted.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+#include "../h/const.h"
+
+#define	BUFFERPAGE	(SWAPFIRSTPAGE + SWAPMAXPAGES)
+
+/* Uses the defaults for any missing or out of range value */
+void checkConfig(swapConfig_t *config) {
+	if (config->sc_magic != SWAPMAGIC) {
+		config->sc_pages = SWAPMAXPAGES;
+		config->sc_pattern = SWAPRANDOM;
+		config->sc_stride = 3;
+		config->sc_writePercent = 30;
+		config->sc_hotPages = 4;
+		config->sc_hotPercent = 80;
+		config->sc_duration = 5000;
+		config->sc_seed = 1;
+	}
+	if ((config->sc_pages == 0) || (config->sc_pages > SWAPMAXPAGES))
+		config->sc_pages = SWAPMAXPAGES;
+	if (config->sc_pattern > SWAPHOTCOLD)
+		config->sc_pattern = SWAPRANDOM;
+	if ((config->sc_stride == 0) || (config->sc_stride >= config->sc_pages))
+		config->sc_stride = 1;
+	if ((config->sc_hotPages == 0) || (config->sc_hotPages >= config->sc_pages))
+		config->sc_hotPages = 1;
+	if (config->sc_writePercent > 100)
+		config->sc_writePercent = 100;
+	if (config->sc_hotPercent > 100)
+		config->sc_hotPercent = 100;
+}
+
+/* Returns the working set page of the next access */
+unsigned int nextPage(swapConfig_t *config, unsigned int access, unsigned int *seed) {
+	unsigned int cold;
+
+	switch (config->sc_pattern) {
+		case SWAPSEQUENTIAL:
+			return access % config->sc_pages;
+		case SWAPSTRIDED:
+			return (access * config->sc_stride) % config->sc_pages;
+		case SWAPHOTCOLD:
+			if ((benchRandom(seed) % 100) < config->sc_hotPercent)
+				return benchRandom(seed) % config->sc_hotPages;
+			cold = config->sc_pages - config->sc_hotPages;
+			return config->sc_hotPages + (benchRandom(seed) % cold);
+		default:
+			return benchRandom(seed) % config->sc_pages;
+	}
+}
+
+void main() {
+	swapConfig_t config;
+	unsigned int counters[PERFCOUNTS];
+	unsigned int start, now, before, elapsed, faults, seed, access, page, ms;
+	unsigned int slowAccesses = 0, slowTime = 0;
+	int i;
+	volatile int *word;
+
+	print(WRITETERMINAL, "benchSwap starts\n");
+
+	/* Fetch the config, once it is written */
+	SYSCALL(PSEMTIMED, SWAPCONFIGSEM, SWAPCONFIGWAIT, 0);
+	word = (int *)(SEG2 + (BUFFERPAGE * PAGESIZE));
+	config.sc_magic = 0;
+	if (SYSCALL(FLASH_GET, (int)word, BENCHFLASH, SWAPCONFIGBLOCK) == READY)
+		for (i = 0; i < (sizeof(swapConfig_t) / WORDLEN); i++)
+			((int *)&config)[i] = word[i];
+	checkConfig(&config);
+	seed = config.sc_seed;
+
+	SYSCALL(GETCOUNTERS, (int)counters, SELFASID, 0);
+	faults = counters[PERF_PAGEFAULT];
+
+	start = benchNow();
+	now = start;
+	for (access = 0; (now - start) < (config.sc_duration * 1000); access++) {
+		page = nextPage(&config, access, &seed);
+		word = (int *)(SEG2 + ((SWAPFIRSTPAGE + page) * PAGESIZE));
+
+		before = now;
+		if ((benchRandom(&seed) % 100) < config.sc_writePercent)
+			*word = access;
+		else
+			page = *word;
+		now = benchNow();
+
+		if ((now - before) > SWAPSLOWACCESS) {
+			slowAccesses++;
+			slowTime += now - before;
+		}
+	}
+	elapsed = now - start;
+
+	SYSCALL(GETCOUNTERS, (int)counters, SELFASID, 0);
+	faults = counters[PERF_PAGEFAULT] - faults;
+	ms = elapsed / 1000;
+
+	benchReport("swap", "pattern", config.sc_pattern, "id");
+	benchReport("swap", "pages", config.sc_pages, "count");
+	benchReport("swap", "accesses", access, "count");
+	benchReport("swap", "faults", faults, "count");
+	benchReport("swap", "faultrate", (faults * 1000) / ((ms == 0) ? 1 : ms), "faults/s");
+	benchReport("swap", "faulttime", (slowAccesses == 0) ? 0 : (slowTime / slowAccesses), "us");
+
+	print(WRITETERMINAL, "benchSwap completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,61 @@
+/*	Writes the benchSwap config block (block SWAPCONFIGBLOCK of flash
+ *	BENCHFLASH) and signals SWAPCONFIGSEM. The values are compiled in;
+ *	override any of them when building, e.g.
+ *		make benchSwapConfig.umps CONFIG="-DSWAPPAGES=16 -DSWAPPATTERN=3"
+ *	The block stays on the flash, so later runs of benchSwap alone reuse it.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#ifndef SWAPPAGES
+#define SWAPPAGES		SWAPMAXPAGES
+#endif
+#ifndef SWAPPATTERN
+#define SWAPPATTERN		SWAPRANDOM
+#endif
+#ifndef SWAPSTRIDE
+#define SWAPSTRIDE		3
+#endif
+#ifndef SWAPWRITES
+#define SWAPWRITES		30
+#endif
+#ifndef SWAPHOTPAGES
+#define SWAPHOTPAGES	4
+#endif
+#ifndef SWAPHOTPERCENT
+#define SWAPHOTPERCENT	80
+#endif
+#ifndef SWAPDURATION
+#define SWAPDURATION	5000
+#endif
+#ifndef SWAPSEED
+#define SWAPSEED		1
+#endif
+
+#define	BUFFERPAGE	20
+
+void main() {
+	swapConfig_t *config = (swapConfig_t *)(SEG2 + (BUFFERPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "benchSwapConfig starts\n");
+
+	config->sc_magic = SWAPMAGIC;
+	config->sc_pages = SWAPPAGES;
+	config->sc_pattern = SWAPPATTERN;
+	config->sc_stride = SWAPSTRIDE;
+	config->sc_writePercent = SWAPWRITES;
+	config->sc_hotPages = SWAPHOTPAGES;
+	config->sc_hotPercent = SWAPHOTPERCENT;
+	config->sc_duration = SWAPDURATION;
+	config->sc_seed = SWAPSEED;
+
+	if (SYSCALL(FLASH_PUT, (int)config, BENCHFLASH, SWAPCONFIGBLOCK) != READY)
+		print(WRITETERMINAL, "benchSwapConfig error: could not write the config\n");
+	SYSCALL(VSEMNAMED, SWAPCONFIGSEM, 0, 0);
+
+	print(WRITETERMINAL, "benchSwapConfig completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,29 @@
+/*	Microbenchmark: round trip of a null SYSCALL. SYS10 (GET TOD) does
+ *	no work beyond the trap, the Support Level dispatch and the return,
+ *	so the loop time over its count is the round trip cost.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	CALLS	1000
+
+void main() {
+	unsigned int start, elapsed;
+	int i;
+
+	print(WRITETERMINAL, "benchSyscall starts\n");
+
+	start = benchNow();
+	for (i = 0; i < CALLS; i++)
+		SYSCALL(GET_TOD, 0, 0, 0);
+	elapsed = benchNow() - start;
+
+	benchReport("syscall", "calls", CALLS, "count");
+	benchReport("syscall", "roundtrip", elapsed / CALLS, "us");
+
+	print(WRITETERMINAL, "benchSyscall completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,34 @@
+/*	Microbenchmark: terminal output rate. Writes LINES lines of
+ *	LINELEN characters with SYS12 and reports bytes per second.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/bench.h"
+
+#define	LINES	20
+#define	LINELEN	64
+
+void main() {
+	char line[LINELEN];
+	unsigned int start, elapsed, ms;
+	int i;
+
+	print(WRITETERMINAL, "benchTerminal starts\n");
+
+	for (i = 0; i < LINELEN - 1; i++)
+		line[i] = 'a' + (i % 26);
+	line[LINELEN - 1] = '\n';
+
+	start = benchNow();
+	for (i = 0; i < LINES; i++)
+		SYSCALL(WRITETERMINAL, (int)line, LINELEN, 0);
+	elapsed = benchNow() - start;
+
+	ms = elapsed / 1000;
+	benchReport("terminal", "write", (LINES * LINELEN * 1000) / ((ms == 0) ? 1 : ms), "B/s");
+
+	print(WRITETERMINAL, "benchTerminal completed\n");
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
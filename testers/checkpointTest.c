@@ -0,0 +1,71 @@
+/*	Test of checkpoints (SYS61). The program changes a global, a stack
+ *	variable and two zero-fill pages, then checkpoints. On the first
+ *	boot SYS61 returns 0: the program checks its data is still there and
+ *	then waits, without exiting (an exit drops the checkpoint), for the
+ *	machine to be powered off and on again. At the next boot the kernel
+ *	resumes it from the checkpoint, SYS61 returns CKPTRESUMED, and the
+ *	program checks that the global, the stack variable and the pages
+ *	came back intact before it exits.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	CKPTPAGE	20			/* First of the zero-fill pages changed */
+#define	CKPTPAGES	2
+#define	CKPTSTAMP	0x434B5054	/* "CKPT" */
+#define	IMAGEVALUE	5			/* The global's value in the image */
+#define	SAVEDVALUE	42			/* ... and when checkpointed */
+
+int global = IMAGEVALUE;
+
+/* TRUE if the global, marker and the pages hold what was checkpointed */
+int intact(int marker) {
+	int i;
+	int *page = (int *)(SEG2 + (CKPTPAGE * PAGESIZE));
+
+	if ((global != SAVEDVALUE) || (marker != CKPTSTAMP))
+		return FALSE;
+	for (i = 0; i < CKPTPAGES * (PAGESIZE / WORDLEN); i++)
+		if (page[i] != CKPTSTAMP + i)
+			return FALSE;
+	return TRUE;
+}
+
+void main() {
+	int i, status;
+	int marker;
+	int *page = (int *)(SEG2 + (CKPTPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "checkpointTest starts\n");
+
+	global = SAVEDVALUE;
+	marker = CKPTSTAMP;
+	for (i = 0; i < CKPTPAGES * (PAGESIZE / WORDLEN); i++)
+		page[i] = CKPTSTAMP + i;
+
+	status = SYSCALL(CHECKPOINT, 0, 0, 0);
+
+	if (status == CKPTRESUMED) {
+		if (intact(marker))
+			print(WRITETERMINAL, "checkpointTest ok: resumed with its data intact\n");
+		else
+			print(WRITETERMINAL, "checkpointTest error: data lost across the reboot\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	if (status != 0) {
+		print(WRITETERMINAL, "checkpointTest error: checkpoint failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (!intact(marker)) {
+		print(WRITETERMINAL, "checkpointTest error: data changed by the checkpoint\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "checkpointTest ok: checkpoint saved; power the machine off and on to resume it\n");
+
+	/* Stay alive: exiting would drop the checkpoint */
+	while (TRUE)
+		SYSCALL(DELAY, 10, 0, 0);
+}
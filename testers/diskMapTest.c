@@ -0,0 +1,60 @@
+/*	Test of disk-mapped memory (SYS52). The program writes two stamped
+ *	sectors of disk MAPDISK with DISK_PUT, maps them at two kuseg pages
+ *	and checks that reading the pages faults the sectors in. Mapping
+ *	them again at the same address must succeed and mapping sectors
+ *	over the text must fail.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	MAPDISK		1
+#define	MAPSECTOR	200			/* First sector mapped (above benchDisk's) */
+#define	MAPPAGES	2
+#define	BUFFERPAGE	18			/* Page the sectors are written from */
+#define	MAPPAGE		20			/* First kuseg page they are mapped at */
+#define	MAPSTAMP	0x4D415053	/* "MAPS" */
+
+void main() {
+	int i, j, corrupt;
+	int *buffer = (int *)(SEG2 + (BUFFERPAGE * PAGESIZE));
+	int *mapped = (int *)(SEG2 + (MAPPAGE * PAGESIZE));
+	int where = (MAPDISK << DISKMAPSHIFT) | MAPSECTOR;
+
+	print(WRITETERMINAL, "diskMapTest starts\n");
+
+	for (i = 0; i < MAPPAGES; i++) {
+		for (j = 0; j < PAGESIZE / WORDLEN; j++)
+			buffer[j] = MAPSTAMP + (i * PAGESIZE) + j;
+		if (SYSCALL(DISK_PUT, (int)buffer, MAPDISK, MAPSECTOR + i) != READY) {
+			print(WRITETERMINAL, "diskMapTest error: bad disk status\n");
+			SYSCALL(TERMINATE, 0, 0, 0);
+		}
+	}
+
+	if (SYSCALL(DISKMAP, (int)mapped, MAPPAGES, where) != 0) {
+		print(WRITETERMINAL, "diskMapTest error: map failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "diskMapTest ok: sectors mapped\n");
+
+	corrupt = FALSE;
+	for (i = 0; i < MAPPAGES; i++)
+		for (j = 0; j < PAGESIZE / WORDLEN; j++)
+			if (mapped[(i * PAGESIZE / WORDLEN) + j] != MAPSTAMP + (i * PAGESIZE) + j)
+				corrupt = TRUE;
+	if (corrupt)
+		print(WRITETERMINAL, "diskMapTest error: mapped pages differ from the sectors\n");
+	else
+		print(WRITETERMINAL, "diskMapTest ok: mapped pages hold the sectors\n");
+
+	if (SYSCALL(DISKMAP, (int)mapped, MAPPAGES, where) != 0)
+		print(WRITETERMINAL, "diskMapTest error: mapping again failed\n");
+	else if (SYSCALL(DISKMAP, SEG2, 1, where) == 0)
+		print(WRITETERMINAL, "diskMapTest error: mapped over the text\n");
+	else
+		print(WRITETERMINAL, "diskMapTest ok: remap accepted, text refused\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,70 @@
+/*	Test of fork (SYS48). The parent stamps a private page and a global,
+ *	then forks. The clone checks it sees the parent's values, overwrites
+ *	both and signals a named semaphore (SYS30); the parent, once woken
+ *	(SYS29), checks its own copies are unchanged: the clone's writes went
+ *	to copies of the pages, not the parent's frames. A failed check in
+ *	the clone (which prints nothing: its ASID may have no terminal) is
+ *	reported through a second semaphore.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	FORKPAGE	20			/* Private kuseg page both write */
+#define	FORKOK		10			/* Named semaphore the clone signals if its checks pass */
+#define	FORKBAD		11			/* ... and if they fail */
+#define	FORKWAIT	(10 * SECOND)
+#define	PARENTSTAMP	0x50415245	/* "PARE" */
+#define	CLONESTAMP	0x434C4F4E	/* "CLON" */
+
+int global = PARENTSTAMP;
+
+void main() {
+	int child, i, corrupt;
+	int *page = (int *)(SEG2 + (FORKPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "forkTest starts\n");
+
+	for (i = 0; i < PAGESIZE / WORDLEN; i++)
+		page[i] = PARENTSTAMP + i;
+
+	child = SYSCALL(FORK, 0, 0, 0);
+	if (child == 0) {
+		/* The clone: check the parent's values, then write its own */
+		corrupt = (global != PARENTSTAMP);
+		for (i = 0; i < PAGESIZE / WORDLEN; i++) {
+			if (page[i] != PARENTSTAMP + i)
+				corrupt = TRUE;
+			page[i] = CLONESTAMP + i;
+		}
+		global = CLONESTAMP;
+		SYSCALL(VSEMNAMED, corrupt ? FORKBAD : FORKOK, 0, 0);
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (child < 0) {
+		print(WRITETERMINAL, "forkTest error: fork failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "forkTest ok: clone created\n");
+
+	if (SYSCALL(PSEMTIMED, FORKOK, FORKWAIT, 0) != 0) {
+		if (SYSCALL(PSEMTIMED, FORKBAD, 0, 0) == 0)
+			print(WRITETERMINAL, "forkTest error: the clone did not see the parent's pages\n");
+		else
+			print(WRITETERMINAL, "forkTest error: the clone did not finish\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	corrupt = (global != PARENTSTAMP);
+	for (i = 0; i < PAGESIZE / WORDLEN; i++)
+		if (page[i] != PARENTSTAMP + i)
+			corrupt = TRUE;
+
+	if (corrupt)
+		print(WRITETERMINAL, "forkTest error: the clone's writes reached the parent\n");
+	else
+		print(WRITETERMINAL, "forkTest ok: parent's private pages unchanged\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,62 @@
+/*	Test of futexes (SYS46, SYS47), run together with futexTestB. Both
+ *	U-procs attach the same shared segment page (SYS38) and pass a turn
+ *	word back and forth ROUNDS times each, sleeping on it with SYS46 while
+ *	it is the other's turn and waking the other with SYS47 after adding
+ *	one to a shared counter. A lost wake hangs the pair; once futexTestB
+ *	signals it is done the counter must hold both U-procs' turns.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/futex.h"
+
+void main() {
+	int *shared = (int *)(SEG2 + (FUTEXPAGE * PAGESIZE));
+	int *turn = &shared[0];
+	int *counter = &shared[1];
+	int i;
+
+	print(WRITETERMINAL, "futexTestA starts\n");
+
+	if (SYSCALL(SHMATTACH, FUTEXSEG, (int)shared, 1) != 0) {
+		print(WRITETERMINAL, "futexTestA error: attach failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	*turn = ATURN;
+	*counter = 0;
+
+	/* The word does not hold the value: no sleep */
+	if (SYSCALL(FUTEXWAIT, (int)turn, BTURN, 0) == 0) {
+		print(WRITETERMINAL, "futexTestA error: slept on a word that changed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(FUTEXWAKE, (int)turn, 1, 0) != 0) {
+		print(WRITETERMINAL, "futexTestA error: woke a U-proc nobody had put to sleep\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "futexTestA ok: wait and wake without sleepers\n");
+
+	SYSCALL(VSEMNAMED, FUTEXREADY, 0, 0);
+
+	for (i = 0; i < ROUNDS; i++) {
+		while (*turn != ATURN)
+			SYSCALL(FUTEXWAIT, (int)turn, BTURN, 0);
+		(*counter)++;
+		*turn = BTURN;
+		SYSCALL(FUTEXWAKE, (int)turn, 1, 0);
+	}
+
+	if (SYSCALL(PSEMTIMED, FUTEXDONE, FUTEXTIME, 0) != 0) {
+		print(WRITETERMINAL, "futexTestA error: futexTestB did not finish\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	if (*counter != (2 * ROUNDS))
+		print(WRITETERMINAL, "futexTestA error: turns were lost\n");
+	else
+		print(WRITETERMINAL, "futexTestA ok: turns passed without lost wakes\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,39 @@
+/*	Peer of futexTestA (see there): once signalled, attaches the segment
+ *	and takes its ROUNDS turns, then signals back.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/futex.h"
+
+void main() {
+	int *shared = (int *)(SEG2 + (FUTEXPAGE * PAGESIZE));
+	int *turn = &shared[0];
+	int *counter = &shared[1];
+	int i;
+
+	print(WRITETERMINAL, "futexTestB starts\n");
+
+	if (SYSCALL(PSEMTIMED, FUTEXREADY, FUTEXTIME, 0) != 0) {
+		print(WRITETERMINAL, "futexTestB error: futexTestA did not start\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(SHMATTACH, FUTEXSEG, (int)shared, 1) != 0) {
+		print(WRITETERMINAL, "futexTestB error: attach failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	for (i = 0; i < ROUNDS; i++) {
+		while (*turn != BTURN)
+			SYSCALL(FUTEXWAIT, (int)turn, ATURN, 0);
+		(*counter)++;
+		*turn = ATURN;
+		SYSCALL(FUTEXWAKE, (int)turn, 1, 0);
+	}
+
+	print(WRITETERMINAL, "futexTestB ok: took its turns\n");
+	SYSCALL(VSEMNAMED, FUTEXDONE, 0, 0);
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,51 @@
+#ifndef BENCH
+#define BENCH
+
+/************************** BENCH.H ******************************
+*
+*  Shared helpers of the bench* microbenchmarks. Every result is one
+*  terminal line "bench=<name> metric=<metric> value=<n> unit=<unit>"
+*/
+
+#define BENCHDISK		1			/* Disk the disk benchmark uses */
+#define BENCHSECTORS	64			/* Sectors per disk pass */
+#define BENCHSECTORSPAN	128			/* Random sectors are drawn below this */
+#define BENCHFLASH		1			/* Flash the flash benchmark reads */
+#define BENCHFLASHBLOCK	32			/* First block read (above the backing store pages) */
+#define BENCHFLASHBLOCKS	16			/* Blocks per flash pass */
+#define BENCHPING		0			/* Named semaphore benchPingA signals */
+#define BENCHPONG		1			/* Named semaphore benchPingB signals */
+#define BENCHTIMEOUT	(10 * SECOND)	/* Ping-pong P timeout */
+
+/* Paging benchmark (benchSwap) and its flash-resident config block */
+#define SWAPCONFIGBLOCK	48			/* Block of flash BENCHFLASH holding the config */
+#define SWAPCONFIGSEM	2			/* Named semaphore benchSwapConfig signals once written */
+#define SWAPCONFIGWAIT	(2 * SECOND)	/* How long benchSwap waits for it */
+#define SWAPMAGIC		0x53574150	/* "SWAP": the block holds a config */
+#define SWAPFIRSTPAGE	8			/* First kuseg page of the working set */
+#define SWAPMAXPAGES	22			/* Largest working set (pages 8-29) */
+#define SWAPSEQUENTIAL	0			/* Pattern: pages in order */
+#define SWAPSTRIDED		1			/* Pattern: every stride-th page, wrapping */
+#define SWAPRANDOM		2			/* Pattern: uniformly random pages */
+#define SWAPHOTCOLD		3			/* Pattern: hotPercent of accesses to the first hotPages */
+#define SWAPSLOWACCESS	200			/* An access slower than this (us) took a fault */
+
+typedef struct swapConfig_t {
+	unsigned int	sc_magic;		/* SWAPMAGIC */
+	unsigned int	sc_pages;		/* Working set size (pages) */
+	unsigned int	sc_pattern;		/* SWAP* access pattern */
+	unsigned int	sc_stride;		/* Stride of SWAPSTRIDED (pages) */
+	unsigned int	sc_writePercent;	/* Accesses that write */
+	unsigned int	sc_hotPages;	/* Hot pages of SWAPHOTCOLD */
+	unsigned int	sc_hotPercent;	/* Accesses that go to them */
+	unsigned int	sc_duration;	/* Run time (ms) */
+	unsigned int	sc_seed;		/* Random seed */
+} swapConfig_t;
+
+extern unsigned int benchNow ();
+extern void benchReport (char *bench, char *metric, unsigned int value, char *unit);
+extern unsigned int benchRandom (unsigned int *seed);
+
+/***************************************************************/
+
+#endif
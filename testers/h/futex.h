@@ -0,0 +1,20 @@
+#ifndef FUTEXTEST
+#define FUTEXTEST
+
+/************************** FUTEX.H ******************************
+*
+*  Shared values of the futexTestA/futexTestB pair
+*/
+
+#define FUTEXSEG		2			/* Segment both attach */
+#define FUTEXPAGE		27			/* Kuseg page it is attached at */
+#define FUTEXREADY		14			/* Named semaphore futexTestA signals */
+#define FUTEXDONE		15			/* Named semaphore futexTestB signals */
+#define FUTEXTIME		(10 * SECOND)
+#define ROUNDS			20			/* Turns each U-proc takes */
+#define ATURN			0			/* Values of the turn word */
+#define BTURN			1
+
+/*****************************************************************/
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef MAILBOXTEST
+#define MAILBOXTEST
+
+/************************** MAILBOX.H ******************************
+*
+*  Shared values of the mailboxTestA/mailboxTestB pair
+*/
+
+#define MAILGREETING	"hello peer!"	/* Inline message sent */
+#define MAILLENGTH		12			/* Its length, with the terminator */
+#define MAILSTAMP		0x4D41494C	/* "MAIL": words of a good reply */
+#define MAILBAD			0x42414421	/* "BAD!": mailboxTestB's check failed */
+
+/***************************************************************/
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SHMTEST
+#define SHMTEST
+
+/************************** SHM.H ******************************
+*
+*  Shared values of the shmTestA/shmTestB pair
+*/
+
+#define SHMSEG			3			/* Segment both attach */
+#define SHMPAGE			24			/* First kuseg page it is attached at */
+#define SHMPAGES		2
+#define SHMREADY		8			/* Named semaphore shmTestA signals */
+#define SHMDONE			9			/* Named semaphore shmTestB signals */
+#define SHMWAIT			(10 * SECOND)
+#define ASTAMP			0x41414141	/* "AAAA" */
+#define BSTAMP			0x42424242	/* "BBBB" */
+#define SHMBAD			0x42414421	/* "BAD!": shmTestB's check failed */
+
+/***************************************************************/
+
+#endif
@@ -0,0 +1,54 @@
+/*	Test of message passing (SYS36/SYS37), run together with
+ *	mailboxTestB, which must be the U-proc with ASID MAILPEER (set it
+ *	with make mailboxTestA.umps CONFIG="-DMAILPEER=3"). mailboxTestA
+ *	sends it an inline message; mailboxTestB, which learns this
+ *	U-proc's ASID from SYS37, answers with a page message: a whole
+ *	page-aligned page whose frame moves to this U-proc's page. A failed
+ *	check on mailboxTestB's side shows up as a wrong stamp in the page.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/mailbox.h"
+
+#ifndef MAILPEER
+#define	MAILPEER	2			/* ASID of mailboxTestB */
+#endif
+
+#define	RECVPAGE	22			/* Page the reply is received at */
+
+void main() {
+	int sender, length, i, corrupt;
+	int *page = (int *)(SEG2 + (RECVPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "mailboxTestA starts\n");
+
+	if (SYSCALL(MSGSEND, MAILPEER, (int)MAILGREETING, MAILLENGTH) != 0) {
+		print(WRITETERMINAL, "mailboxTestA error: inline send failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "mailboxTestA ok: sent an inline message\n");
+
+	length = SYSCALL(MSGRECEIVE, (int)page, PAGESIZE, (int)&sender);
+	if ((length != PAGESIZE) || (sender != MAILPEER)) {
+		print(WRITETERMINAL, "mailboxTestA error: wrong page message\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	if (page[0] == MAILBAD) {
+		print(WRITETERMINAL, "mailboxTestA error: mailboxTestB got a wrong message\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	corrupt = FALSE;
+	for (i = 0; i < PAGESIZE / WORDLEN; i++)
+		if (page[i] != MAILSTAMP + i)
+			corrupt = TRUE;
+
+	if (corrupt)
+		print(WRITETERMINAL, "mailboxTestA error: page message corrupted\n");
+	else
+		print(WRITETERMINAL, "mailboxTestA ok: page message received intact\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
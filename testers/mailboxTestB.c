@@ -0,0 +1,41 @@
+/*	Peer of mailboxTestA (see there): receives its inline message,
+ *	checks it, and answers the sender with a stamped page message.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/mailbox.h"
+
+#define	SENDPAGE	21			/* Page sent as the reply */
+
+void main() {
+	char buffer[MAILLENGTH];
+	char *greeting = MAILGREETING;
+	int sender, length, i, stamp;
+	int *page = (int *)(SEG2 + (SENDPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "mailboxTestB starts\n");
+
+	length = SYSCALL(MSGRECEIVE, (int)buffer, MAILLENGTH, (int)&sender);
+
+	stamp = MAILSTAMP;
+	if (length != MAILLENGTH)
+		stamp = MAILBAD;
+	for (i = 0; i < length; i++)
+		if (buffer[i] != greeting[i])
+			stamp = MAILBAD;
+	if (stamp == MAILBAD)
+		print(WRITETERMINAL, "mailboxTestB error: wrong inline message\n");
+	else
+		print(WRITETERMINAL, "mailboxTestB ok: inline message received\n");
+
+	for (i = 0; i < PAGESIZE / WORDLEN; i++)
+		page[i] = stamp + i;
+	if (SYSCALL(MSGSEND, sender, (int)page, PAGESIZE) != 0)
+		print(WRITETERMINAL, "mailboxTestB error: page send failed\n");
+	else
+		print(WRITETERMINAL, "mailboxTestB ok: page message sent\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
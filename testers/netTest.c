@@ -0,0 +1,98 @@
+/*	Test of the network calls (SYS54/SYS55). Needs NICs SENDNIC and
+ *	RECVNIC installed on the same network: a broadcast frame sent on
+ *	one arrives on the other. The program sends two stamped frames, one
+ *	copied from a small buffer and one given away as a whole page
+ *	(NETGIVEPAGE), and receives them, the second into a whole page so
+ *	its frame is mapped there. Each receive is preceded by a SYS53 wait
+ *	with a timeout, so a missing peer fails the test instead of hanging
+ *	it; frames that are not the test's (other traffic) are skipped.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	SENDNIC		0
+#define	RECVNIC		1
+#define	FRAMELEN	64			/* Bytes sent (the Ethernet minimum plus the stamp) */
+#define	TYPEOFFSET	12			/* Ethertype, after the two MAC addresses */
+#define	TESTTYPE	0x88B5		/* Local experimental ethertype */
+#define	STAMPOFFSET	16			/* Word-aligned stamp after the header */
+#define	NETSTAMP	0x4E455421	/* "NET!" */
+#define	SENDPAGE	22			/* Page given away by the second send */
+#define	RECVPAGE	23			/* Page the second frame is mapped at */
+#define	NETWAIT		SECOND		/* Longest wait for one frame */
+#define	NETTRIES	8			/* Frames read before giving up on the test's */
+
+typedef struct waitEvent_t {
+	int		we_kind;
+	int		we_handle;
+} waitEvent_t;
+
+waitEvent_t arrival = {WAITNET, RECVNIC};
+int small[FRAMELEN / WORDLEN];
+int received[FRAMELEN / WORDLEN];
+
+/* Fills in a broadcast frame of the test's type carrying stamp */
+void buildFrame(unsigned char *frame, int stamp) {
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		frame[i] = 0xFF;		/* Broadcast */
+		frame[6 + i] = 0;
+	}
+	frame[TYPEOFFSET] = TESTTYPE >> 8;
+	frame[TYPEOFFSET + 1] = TESTTYPE & 0xFF;
+	for (i = TYPEOFFSET + 2; i < FRAMELEN; i++)
+		frame[i] = i;
+	*((int *)(frame + STAMPOFFSET)) = stamp;
+}
+
+/* Receives frames into buffer until the one carrying stamp; FALSE if none came */
+int receiveFrame(unsigned char *buffer, int capacity, int stamp) {
+	int tries, length;
+
+	for (tries = 0; tries < NETTRIES; tries++) {
+		if (SYSCALL(WAITANY, (int)&arrival, 1, NETWAIT) != 0)
+			return FALSE;
+		length = SYSCALL(NETRECV, (int)buffer, capacity, RECVNIC);
+		if (length < 0)
+			return FALSE;
+		if ((length >= FRAMELEN) &&
+			(buffer[TYPEOFFSET] == (TESTTYPE >> 8)) &&
+			(buffer[TYPEOFFSET + 1] == (TESTTYPE & 0xFF)) &&
+			(*((int *)(buffer + STAMPOFFSET)) == stamp))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+void main() {
+	unsigned char *page = (unsigned char *)(SEG2 + (SENDPAGE * PAGESIZE));
+	unsigned char *into = (unsigned char *)(SEG2 + (RECVPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "netTest starts\n");
+
+	buildFrame((unsigned char *)small, NETSTAMP);
+	if (SYSCALL(NETSEND, (int)small, FRAMELEN, SENDNIC) != 0) {
+		print(WRITETERMINAL, "netTest error: send failed (is NIC 0 installed?)\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (!receiveFrame((unsigned char *)received, FRAMELEN, NETSTAMP)) {
+		print(WRITETERMINAL, "netTest error: frame not received (is NIC 1 on the same network?)\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "netTest ok: copied frame received\n");
+
+	buildFrame(page, NETSTAMP + 1);
+	if (SYSCALL(NETSEND, (int)page, FRAMELEN, SENDNIC | NETGIVEPAGE) != 0) {
+		print(WRITETERMINAL, "netTest error: page send failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (!receiveFrame(into, PAGESIZE, NETSTAMP + 1))
+		print(WRITETERMINAL, "netTest error: page frame not received\n");
+	else
+		print(WRITETERMINAL, "netTest ok: page frame received\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,46 @@
+/*	Test of shared segments (SYS38), run together with shmTestB. This
+ *	U-proc attaches a two page segment, checks that a different range of
+ *	it is refused, stamps it and signals shmTestB over a named semaphore
+ *	(SYS30). shmTestB attaches the same segment, checks the stamp and
+ *	writes its own into both pages; once it signals back (SYS29) this
+ *	U-proc must see them in its own pages.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/shm.h"
+
+void main() {
+	int *shared = (int *)(SEG2 + (SHMPAGE * PAGESIZE));
+	int *second = (int *)(SEG2 + ((SHMPAGE + 1) * PAGESIZE));
+
+	print(WRITETERMINAL, "shmTestA starts\n");
+
+	if (SYSCALL(SHMATTACH, SHMSEG, (int)shared, SHMPAGES) != 0) {
+		print(WRITETERMINAL, "shmTestA error: attach failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(SHMATTACH, SHMSEG, (int)shared, SHMPAGES - 1) == 0) {
+		print(WRITETERMINAL, "shmTestA error: attached at a different range\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "shmTestA ok: segment attached\n");
+
+	shared[0] = ASTAMP;
+	SYSCALL(VSEMNAMED, SHMREADY, 0, 0);
+
+	if (SYSCALL(PSEMTIMED, SHMDONE, SHMWAIT, 0) != 0) {
+		print(WRITETERMINAL, "shmTestA error: shmTestB did not answer\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	if (shared[1] == SHMBAD)
+		print(WRITETERMINAL, "shmTestA error: shmTestB did not see this U-proc's write\n");
+	else if ((shared[1] != BSTAMP) || (second[0] != BSTAMP))
+		print(WRITETERMINAL, "shmTestA error: shmTestB's writes are not shared\n");
+	else
+		print(WRITETERMINAL, "shmTestA ok: writes shared both ways\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,36 @@
+/*	Peer of shmTestA (see there): once signalled, attaches the segment,
+ *	checks shmTestA's stamp and writes its own into both pages.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+#include "h/shm.h"
+
+void main() {
+	int *shared = (int *)(SEG2 + (SHMPAGE * PAGESIZE));
+	int *second = (int *)(SEG2 + ((SHMPAGE + 1) * PAGESIZE));
+
+	print(WRITETERMINAL, "shmTestB starts\n");
+
+	if (SYSCALL(PSEMTIMED, SHMREADY, SHMWAIT, 0) != 0) {
+		print(WRITETERMINAL, "shmTestB error: shmTestA did not start\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(SHMATTACH, SHMSEG, (int)shared, SHMPAGES) != 0) {
+		print(WRITETERMINAL, "shmTestB error: attach failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	if (shared[0] != ASTAMP) {
+		print(WRITETERMINAL, "shmTestB error: shmTestA's write is not shared\n");
+		shared[1] = SHMBAD;
+	} else {
+		print(WRITETERMINAL, "shmTestB ok: saw shmTestA's write\n");
+		shared[1] = BSTAMP;
+	}
+	second[0] = BSTAMP;
+	SYSCALL(VSEMNAMED, SHMDONE, 0, 0);
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
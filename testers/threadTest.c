@@ -0,0 +1,76 @@
+/*	Test of threads (SYS49-SYS51). The main thread starts THREADS
+ *	threads, each summing its own range of numbers into a shared array
+ *	and exiting (SYS51) with the sum. Joining each (SYS50) must return
+ *	that sum, the array must hold it (the threads share the address
+ *	space), and a second join of the same thread and a SYS51 from the
+ *	main thread must both fail.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	THREADS		3
+#define	SPAN		100			/* Numbers each thread sums */
+#define	STACKPAGE	26			/* Thread i's stack is page STACKPAGE + i */
+
+int sums[THREADS];
+
+/* Sum of i * SPAN + 1 .. (i + 1) * SPAN */
+int expected(int i) {
+	return (SPAN * ((2 * i * SPAN) + SPAN + 1)) / 2;
+}
+
+/* Thread body: sums its range, stores it and exits with it */
+void worker(int me) {
+	int i, sum;
+
+	sum = 0;
+	for (i = (me * SPAN) + 1; i <= (me + 1) * SPAN; i++)
+		sum += i;
+	sums[me] = sum;
+
+	SYSCALL(THREADEXIT, sum, 0, 0);
+}
+
+void main() {
+	int thread[THREADS];
+	int i, corrupt;
+
+	print(WRITETERMINAL, "threadTest starts\n");
+
+	for (i = 0; i < THREADS; i++) {
+		thread[i] = SYSCALL(THREADCREATE, (int)worker,
+			SEG2 + ((STACKPAGE + i + 1) * PAGESIZE), i);
+		if (thread[i] < 0) {
+			print(WRITETERMINAL, "threadTest error: thread create failed\n");
+			SYSCALL(TERMINATE, 0, 0, 0);
+		}
+	}
+	print(WRITETERMINAL, "threadTest ok: threads created\n");
+
+	corrupt = FALSE;
+	for (i = 0; i < THREADS; i++)
+		if (SYSCALL(THREADJOIN, thread[i], 0, 0) != expected(i))
+			corrupt = TRUE;
+	if (corrupt)
+		print(WRITETERMINAL, "threadTest error: wrong exit value\n");
+	else
+		print(WRITETERMINAL, "threadTest ok: joined every thread\n");
+
+	corrupt = FALSE;
+	for (i = 0; i < THREADS; i++)
+		if (sums[i] != expected(i))
+			corrupt = TRUE;
+	if (corrupt)
+		print(WRITETERMINAL, "threadTest error: threads' writes not shared\n");
+	else
+		print(WRITETERMINAL, "threadTest ok: threads' writes shared\n");
+
+	if ((SYSCALL(THREADJOIN, thread[0], 0, 0) >= 0) || (SYSCALL(THREADEXIT, 0, 0, 0) >= 0))
+		print(WRITETERMINAL, "threadTest error: bad join or exit accepted\n");
+	else
+		print(WRITETERMINAL, "threadTest ok: bad join and exit refused\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,55 @@
+/*	Test of the striped disk volume (SYS59/SYS60). The program writes
+ *	VOLPAGES stamped pages to consecutive volume sectors in one call,
+ *	which spreads them over every user disk installed, reads them back
+ *	into other pages in one call and compares. A request reaching past
+ *	the end of the volume must fail.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	VOLSECTOR	256			/* First volume sector used */
+#define	VOLPAGES	8			/* Pages moved per call (at most VOLUMEMAX) */
+#define	PUTPAGE		8			/* First kuseg page written from */
+#define	GETPAGE		16			/* First kuseg page read into */
+#define	PASTEND		0x100000	/* A sector beyond any volume */
+#define	VOLSTAMP	0x564F4C55	/* "VOLU" */
+
+void main() {
+	int i, corrupt;
+	int *put = (int *)(SEG2 + (PUTPAGE * PAGESIZE));
+	int *get = (int *)(SEG2 + (GETPAGE * PAGESIZE));
+
+	print(WRITETERMINAL, "volumeTest starts\n");
+
+	for (i = 0; i < VOLPAGES * (PAGESIZE / WORDLEN); i++) {
+		put[i] = VOLSTAMP + i;
+		get[i] = 0;
+	}
+
+	if (SYSCALL(VOLUMEPUT, (int)put, VOLSECTOR, VOLPAGES) != VOLPAGES) {
+		print(WRITETERMINAL, "volumeTest error: volume write failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(VOLUMEGET, (int)get, VOLSECTOR, VOLPAGES) != VOLPAGES) {
+		print(WRITETERMINAL, "volumeTest error: volume read failed\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	corrupt = FALSE;
+	for (i = 0; i < VOLPAGES * (PAGESIZE / WORDLEN); i++)
+		if (get[i] != VOLSTAMP + i)
+			corrupt = TRUE;
+	if (corrupt)
+		print(WRITETERMINAL, "volumeTest error: sectors read back differ\n");
+	else
+		print(WRITETERMINAL, "volumeTest ok: sectors read back intact\n");
+
+	if (SYSCALL(VOLUMEGET, (int)get, PASTEND, 1) >= 0)
+		print(WRITETERMINAL, "volumeTest error: read past the end accepted\n");
+	else
+		print(WRITETERMINAL, "volumeTest ok: read past the end refused\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}
@@ -0,0 +1,50 @@
+/*	Test of waiting for any of several events (SYS53) on named
+ *	semaphores. A wait on an idle semaphore must time out; with a unit
+ *	posted (SYS30) on one of two semaphores the wait must return that
+ *	one's index and take the unit.
+ */
+
+#include "h/localLibumps.h"
+#include "h/tconst.h"
+#include "h/print.h"
+
+#define	SEMA		12			/* Named semaphores waited on */
+#define	SEMB		13
+#define	IDLEWAIT	20000		/* Timeout of the wait that finds nothing (us) */
+
+typedef struct waitEvent_t {
+	int		we_kind;			/* WAITAIO, WAITSEM, WAITTERM or WAITNET */
+	int		we_handle;			/* Control block, named semaphore, terminal or NIC */
+} waitEvent_t;
+
+waitEvent_t events[2] = {{WAITSEM, SEMA}, {WAITSEM, SEMB}};
+
+void main() {
+	print(WRITETERMINAL, "waitAnyTest starts\n");
+
+	/* One event, so the result is 0 if ready and 1 (timed out) if not */
+	if (SYSCALL(WAITANY, (int)events, 1, IDLEWAIT) == 0) {
+		print(WRITETERMINAL, "waitAnyTest error: an idle semaphore was ready\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	print(WRITETERMINAL, "waitAnyTest ok: timed out\n");
+
+	/* No timeout from here on: the result is the ready event's index */
+	SYSCALL(VSEMNAMED, SEMB, 0, 0);
+	if (SYSCALL(WAITANY, (int)events, 2, WAITFOREVER) != 1) {
+		print(WRITETERMINAL, "waitAnyTest error: wrong event ready\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+	if (SYSCALL(PSEMTIMED, SEMB, 0, 0) == 0) {
+		print(WRITETERMINAL, "waitAnyTest error: the unit was not taken\n");
+		SYSCALL(TERMINATE, 0, 0, 0);
+	}
+
+	SYSCALL(VSEMNAMED, SEMA, 0, 0);
+	if (SYSCALL(WAITANY, (int)events, 2, WAITFOREVER) != 0)
+		print(WRITETERMINAL, "waitAnyTest error: wrong event ready\n");
+	else
+		print(WRITETERMINAL, "waitAnyTest ok: the posted semaphore was ready\n");
+
+	SYSCALL(TERMINATE, 0, 0, 0);
+}